@@ -64,6 +64,8 @@ CRcInitFile::CRcInitFile()
       _testing(false),
       _threading(false),
       _fdthread(100),
+      _workers(0),
+      _file_cache_size(100),
       _netdebug(false),
       _admin(false),
       _certfile("server.pem"),
@@ -236,6 +238,10 @@ CRcInitFile::parseFile(const std::string& filespec)
                 setThreadingFlag(threads);
 	    else if (extractNumber(num, "fdThread", variable, value) )
 		setFDThread(num);
+	    else if (extractNumber(num, "workerThreads", variable, value) )
+		setWorkerThreads(num);
+	    else if (extractNumber(num, "fileCacheSize", variable, value) )
+		setFileCacheSize(num);
             else if (extractNumber(num, "portOffset", variable, value) )
 		setPortOffset(num);
 
@@ -271,6 +277,8 @@ CRcInitFile::dump(std::ostream& os) const
     os << "\tPort Offset: " << _port_offset << endl;
     os << "\tThreading support: "
          << ((_threading)?"enabled":"disabled") << endl;
+    os << "\tWorker threads: " << _workers << endl;
+    os << "\tFile cache size: " << _file_cache_size << "MB" << endl;
     os << "\tSpecial Testing output for Gnash: "
          << ((_testing)?"enabled":"disabled") << endl;
 
@@ -73,6 +73,16 @@ public:
     /// \brief Set the number of file descriptors per thread.
     void setFDThread(int x) { _fdthread = x; };
 
+    /// \brief Get the number of threads serving network connections.
+    size_t getWorkerThreads() const { return _workers; };
+    /// \brief Set the number of threads serving network connections.
+    void setWorkerThreads(size_t x) { _workers = x; };
+
+    /// \brief Get the megabytes of files kept mapped in memory.
+    size_t getFileCacheSize() const { return _file_cache_size; };
+    /// \brief Set the megabytes of files kept mapped in memory.
+    void setFileCacheSize(size_t x) { _file_cache_size = x; };
+
     /// \brief Get the special testing output option.
     bool getTestingFlag() { return _testing; };
     /// \brief Set the special testing output option.
@@ -166,6 +176,19 @@ public:
     ///		also disabled, as all the file descriptors are watched
     ///		by one one thread as an aid to debugging.
     size_t _fdthread;
+
+    /// \var _workers
+    ///		The number of threads serving network connections
+    ///		when threading is enabled, 0 being one for each
+    ///		cpu. Each thread waits on its own share of the
+    ///		connections.
+    size_t _workers;
+
+    /// \var _file_cache_size
+    ///		The megabytes of the files being served kept mapped
+    ///		in memory and shared by all connections, the least
+    ///		recently used parts being dropped first.
+    size_t _file_cache_size;
     
     /// \var _netdebug
     ///	Toggles very verbose debugging info from the network Network
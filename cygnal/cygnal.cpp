@@ -23,6 +23,8 @@
 #endif
 
 #include <sys/stat.h>
+#include <algorithm>
+#include <cctype>
 #include <list>
 #include <map>
 #include <iostream>
@@ -82,6 +84,8 @@ extern "C"{
 #include "handler.h"
 #include "cache.h"
 #include "cygnal.h"
+#include "reactor.h"
+#include "relay.h"
 
 #ifdef ENABLE_NLS
 # include <locale>
@@ -110,6 +114,12 @@ void connection_handler(Network::thread_params_t *args);
 void event_handler(Network::thread_params_t *args);
 void admin_handler(Network::thread_params_t *args);
 
+static string getPluginPath();
+#ifdef HAVE_SYS_EPOLL_H
+static std::shared_ptr<Reactor::Connection> newConnection(
+    Network::protocols_supported_e protocol, int fd);
+#endif
+
 // Toggles very verbose debugging info from the network Network class
 static bool netdebug = false;
 
@@ -169,6 +179,15 @@ static std::mutex		alldone_mutex;
 static std::condition_variable	noclients;
 static std::mutex		noclients_mutex;
 
+#ifdef HAVE_SYS_EPOLL_H
+// All the network connections are driven by this, once accepted.
+static std::unique_ptr<Reactor> reactor;
+
+// This mutex is held while looking for a Handler to share, or
+// creating it.
+static std::mutex		handlers_mutex;
+#endif
+
 const char *proto_str[] = {
     "NONE",
     "HTTP",
@@ -382,6 +401,7 @@ Cygnal::findHandler(const std::string &path)
 //     GNASH_REPORT_FUNCTION;
     map<std::string, std::shared_ptr<Handler> >::iterator it;
     std::shared_ptr<Handler> hand;
+    std::lock_guard<std::mutex> lock(_mutex);
     it = _handlers.find(path);
     if (it != _handlers.end()) {
 	hand = (*it).second;
@@ -549,6 +569,19 @@ main(int argc, char *argv[])
 	crcfile.setThreadingFlag(false);
     }
 
+    // The files being served are mapped into memory once, and shared
+    // by all the connections sending them.
+    cache.setSegmentLimit(crcfile.getFileCacheSize() * 1024 * 1024);
+
+#ifdef HAVE_SYS_EPOLL_H
+    // The connections for all ports are driven by a pool of threads,
+    // each waiting on its share of them. When threading is disabled,
+    // one thread waits on all of them as an aid to debugging.
+    reactor.reset(new Reactor(crcfile.getThreadingFlag()
+			      ? crcfile.getWorkerThreads() : 1));
+    reactor->start();
+#endif
+
     // Incomming connection handler for port 80, HTTP and
     // RTMPT. As port 80 requires root access, cygnal supports a
     // "port offset" for debugging and development of the
@@ -565,6 +598,7 @@ main(int argc, char *argv[])
         http_data->hostname = hostname;
 	if (crcfile.getThreadingFlag()) {
 	    std::thread http_thread(std::bind(&connection_handler, http_data));
+	    http_thread.detach();
 	} else {
 	    connection_handler(http_data);
 	}
@@ -583,6 +617,7 @@ main(int argc, char *argv[])
         rtmp_data->hostname = hostname;
 	if (crcfile.getThreadingFlag()) {
 	    std::thread rtmp_thread(std::bind(&connection_handler, rtmp_data));
+	    rtmp_thread.detach();
 	} else {
 	    connection_handler(rtmp_data);
 	}
@@ -782,6 +817,15 @@ connection_handler(Network::thread_params_t *args)
 		    proto_str[args->protocol], fd, args->port);
     }
 
+#ifdef HAVE_SYS_EPOLL_H
+    // The reactor accepts the connections, and drives them without
+    // blocking.
+    if (reactor->addListener(fd, std::bind(&newConnection, args->protocol,
+					   std::placeholders::_1))) {
+	return;
+    }
+#endif
+
     // Get the number of cpus in this system. For multicore
     // systems we'll get better load balancing if we keep all the
     // cpus busy. So a pool of threads is started for each cpu,
@@ -937,18 +981,7 @@ connection_handler(Network::thread_params_t *args)
 		args->filespec = key;
 		args->entry = rtmp;
 		
-		string cgiroot;
-		char *env = std::getenv("CYGNAL_PLUGINS");
-		if (env != 0) {
-		    cgiroot = env;
-		}
-		if (crcfile.getCgiRoot().size() > 0) {
-		    cgiroot += ":" + crcfile.getCgiRoot();
-		    log_network(_("Cygnal Plugin paths are: %s"), cgiroot);
-		} else {
-		    cgiroot = PLUGINSDIR;
-		}
-		hand->scanDir(cgiroot);
+		hand->scanDir(getPluginPath());
 		std::shared_ptr<Handler::cygnal_init_t> init =
 		    hand->initModule(url.path());
 		
@@ -1176,6 +1209,301 @@ event_handler(Network::thread_params_t *args)
 	
 } // end of event_handler
 
+// The paths to look in for the plugins of RTMP applications.
+static string
+getPluginPath()
+{
+    string cgiroot;
+    char *env = std::getenv("CYGNAL_PLUGINS");
+    if (env != 0) {
+	cgiroot = env;
+    }
+    if (crcfile.getCgiRoot().size() > 0) {
+	cgiroot += ":" + crcfile.getCgiRoot();
+	log_network(_("Cygnal Plugin paths are: %s"), cgiroot);
+    } else {
+	cgiroot = PLUGINSDIR;
+    }
+    return cgiroot;
+}
+
+#ifdef HAVE_SYS_EPOLL_H
+
+namespace {
+
+// The longest header of an HTTP request.
+const size_t MAX_HTTP_HEADER = 64 * 1024;
+
+// An HTTP connection driven by the reactor. Each complete request is
+// given to the HTTPServer, and a file being sent is played a page at
+// a time as the socket drains. Pipelined requests wait until the
+// reply to the one before has been sent.
+class HTTPConnection : public Reactor::Connection
+{
+public:
+    HTTPConnection(int fd)
+	: Reactor::Connection(fd),
+	  _keepalive(true)
+    {
+	_handler.addClient(fd, Network::HTTP);
+    }
+
+    bool processInput()
+    {
+	while (!_stream && bytesReady()) {
+	    const std::uint8_t *data = input();
+	    const char *end = "\r\n\r\n";
+	    const std::uint8_t *body = std::search(data, data + bytesReady(),
+						   end, end + 4);
+	    if (body == data + bytesReady()) {
+		if (bytesReady() > MAX_HTTP_HEADER) {
+		    log_error(_("HTTP header too long for fd #%d"),
+			      getFileFd());
+		    return false;
+		}
+		return true;
+	    }
+	    body += 4;
+
+	    const size_t length = (body - data) + contentLength(data, body);
+	    if (bytesReady() < length) {
+		return true;
+	    }
+
+	    std::shared_ptr<cygnal::Buffer> buf(new cygnal::Buffer(length));
+	    buf->copy(const_cast<std::uint8_t *>(data), length);
+	    consume(length);
+
+	    std::shared_ptr<HTTPServer> &http =
+		_handler.getHTTPHandler(getFileFd());
+	    // A POST request takes its data from the queue.
+	    if (length > 5 && std::equal(buf->begin(), buf->begin() + 5,
+					 "POST ")) {
+		http->pushChunk(buf);
+	    }
+	    _keepalive = http->http_handler(&_handler, getFileFd(), buf.get());
+
+	    std::shared_ptr<DiskStream> ds = http->getDiskStream();
+	    if (http->getOperation() == HTTP::HTTP_GET && ds
+		&& ds->getState() == DiskStream::PLAY) {
+		_stream = ds;
+	    } else if (!_keepalive) {
+		close();
+		return true;
+	    }
+	}
+	return true;
+    }
+
+    bool processOutput()
+    {
+	if (!_stream) {
+	    return true;
+	}
+	if (!_stream->play(getFileFd(), false)) {
+	    return false;
+	}
+	if (_stream->getState() == DiskStream::PLAY) {
+	    return true;
+	}
+
+	// The reply is done, so the next request can be answered.
+	_stream.reset();
+	if (!_keepalive) {
+	    close();
+	    return true;
+	}
+	return processInput();
+    }
+
+private:
+    // The value of the Content-Length field in a header.
+    static size_t contentLength(const std::uint8_t *start,
+				const std::uint8_t *end)
+    {
+	const std::string header(start, end);
+	const std::string field = "\ncontent-length:";
+	std::string::const_iterator it = std::search(header.begin(),
+	    header.end(), field.begin(), field.end(),
+	    [](char a, char b) { return std::tolower(a) == b; });
+	if (it == header.end()) {
+	    return 0;
+	}
+	const size_t pos = (it - header.begin()) + field.size();
+	return std::strtoul(header.c_str() + pos, 0, 10);
+    }
+
+    Handler _handler;
+    std::shared_ptr<DiskStream> _stream;
+    bool _keepalive;
+};
+
+// An RTMP connection driven by the reactor. The handshakes are read
+// as they arrive, then the NetConnection is given a Handler shared by
+// all the clients of the same application, and all later messages
+// are reassembled by RTMP::parse() and go to rtmp_message().
+class RTMPConnection : public Reactor::Connection
+{
+public:
+    RTMPConnection(int fd)
+	: Reactor::Connection(fd),
+	  _state(HANDSHAKE)
+    {
+	_args.tid = 0;
+	_args.port = 0;
+	_args.netfd = fd;
+	_args.entry = &_rtmp;
+	_args.handler = 0;
+	_args.buffer = 0;
+	_args.protocol = Network::RTMP;
+    }
+
+    bool processInput()
+    {
+	const size_t handshake = RTMP_HANDSHAKE_VERSION_SIZE
+	    + RTMP_HANDSHAKE_SIZE;
+
+	switch (_state) {
+	  case HANDSHAKE:
+	      if (bytesReady() < handshake) {
+		  return true;
+	      }
+	      _handshake.reset(new cygnal::Buffer(handshake));
+	      _handshake->copy(const_cast<std::uint8_t *>(input()), handshake);
+	      consume(handshake);
+	      _rtmp.handShakeResponse(getFileFd(), *_handshake);
+	      _state = CONNECT;
+	      // fall through
+	  case CONNECT:
+	  {
+	      // The second handshake is followed by the connect() INVOKE.
+	      if (bytesReady() < RTMP_HANDSHAKE_SIZE + RTMP_MAX_HEADER_SIZE) {
+		  return true;
+	      }
+	      std::uint8_t *ptr = const_cast<std::uint8_t *>(input());
+	      std::shared_ptr<RTMP::rtmp_head_t> head =
+		  _rtmp.decodeHeader(ptr + RTMP_HANDSHAKE_SIZE);
+	      if (!head) {
+		  return false;
+	      }
+	      // Every chunk after the first has a one byte header.
+	      const size_t length = RTMP_HANDSHAKE_SIZE + head->head_size
+		  + head->bodysize + (head->bodysize ?
+		      (head->bodysize - 1) / RTMP_VIDEO_PACKET_SIZE : 0);
+	      if (bytesReady() < length) {
+		  return true;
+	      }
+	      cygnal::Buffer handshake2(length);
+	      handshake2.copy(ptr, length);
+	      consume(length);
+
+	      std::shared_ptr<cygnal::Element> tcurl =
+		  _rtmp.finishClientHandShake(getFileFd(), *_handshake,
+					      handshake2);
+	      _handshake.reset();
+	      if (!tcurl || !startHandler(*tcurl)) {
+		  return false;
+	      }
+	      _state = MESSAGES;
+	  }
+	  // fall through
+	  case MESSAGES:
+	  {
+	      // Messages are often split over several reads, so only
+	      // the complete ones are processed, the rest kept in the
+	      // input until more arrives.
+	      const int used = rtmp_handler(&_args, input(), bytesReady());
+	      if (used < 0) {
+		  return false;
+	      }
+	      consume(used);
+	      return true;
+	  }
+	}
+	return true;
+    }
+
+    void processClose()
+    {
+	if (_hand) {
+	    _hand->removeClient(getFileFd());
+	}
+	Relay &relay = Relay::getDefaultInstance();
+	relay.unsubscribe(this);
+	if (!_rtmp.getPublishing().empty()) {
+	    relay.removePublisher(_rtmp.getPublishing());
+	    _rtmp.setPublishing("");
+	}
+    }
+
+private:
+    // Find the Handler of the application named by the tcUrl, or
+    // create it and load its plugin.
+    bool startHandler(cygnal::Element &tcurl)
+    {
+	URL url(tcurl.to_string());
+	string key = url.hostname() + url.path();
+
+	std::lock_guard<std::mutex> lock(handlers_mutex);
+	_hand = cyg.findHandler(key);
+	if (!_hand) {
+	    log_network(_("Creating new %s Handler for: %s for fd %#d"),
+			proto_str[Network::RTMP], key, getFileFd());
+	    _hand.reset(new Handler);
+	    _hand->setNetConnection(_rtmp.getNetConnection());
+	    std::vector<std::shared_ptr<Cygnal::peer_t> > active = cyg.getActive();
+	    for (size_t i = 0; i < active.size(); ++i) {
+		_hand->addRemote(active[i]->fd);
+	    }
+	    _hand->scanDir(getPluginPath());
+	    if (!_hand->initModule(url.path())) {
+		log_error(_("Couldn't load plugin for %s"), key);
+		_hand.reset();
+		return false;
+	    }
+	    cyg.addHandler(key, _hand);
+	}
+	_hand->addClient(getFileFd(), Network::RTMP);
+
+	_args.handler = _hand.get();
+	_args.filespec = key;
+	return true;
+    }
+
+    enum state_e {
+	HANDSHAKE,
+	CONNECT,
+	MESSAGES
+    } _state;
+    RTMPServer _rtmp;
+    std::shared_ptr<Handler> _hand;
+    std::unique_ptr<cygnal::Buffer> _handshake;
+    Network::thread_params_t _args;
+};
+
+} // anonymous namespace
+
+// Make the state machine driving a newly accepted connection.
+static std::shared_ptr<Reactor::Connection>
+newConnection(Network::protocols_supported_e protocol, int fd)
+{
+    log_network(_("*** New %s network connection for fd #%d ***"),
+		proto_str[protocol], fd);
+
+    switch (protocol) {
+      case Network::HTTP:
+	  return std::make_shared<HTTPConnection>(fd);
+      case Network::RTMP:
+	  return std::make_shared<RTMPConnection>(fd);
+      default:
+	  log_error(_("Unsupported network protocol for fd #%d, %d"),
+		    fd, protocol);
+	  return std::shared_ptr<Reactor::Connection>();
+    }
+}
+
+#endif // HAVE_SYS_EPOLL_H
+
 // local Variables:
 // mode: C++
 // indent-tabs-mode: nil
@@ -62,6 +62,7 @@ public:
     void probePeers(std::vector<std::shared_ptr<peer_t> > &peers);
 
     void addHandler(const std::string &path, std::shared_ptr<Handler> x) {
+	std::lock_guard<std::mutex> lock(_mutex);
  	_handlers[path] = x;
     };
 
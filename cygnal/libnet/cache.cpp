@@ -25,10 +25,17 @@
 #include <mutex>
 #include <sys/types.h>
 #include <sys/stat.h>
+#include <fcntl.h>
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
 #include <string>
 #include <map>
 #include <iostream>
 #include <unistd.h>
+#if !defined(_WIN32) && !defined(__amigaos4__)
+#include <sys/mman.h>
+#endif
 
 #include "cache.h"
 #include "log.h"
@@ -43,14 +50,61 @@ static std::mutex cache_mutex;
 namespace gnash
 {
 
+FileSegment::FileSegment(std::shared_ptr<const int> file, off_t offset,
+                         size_t size, off_t filesize, time_t modified)
+    : _file(file),
+      _data(nullptr),
+      _offset(offset),
+      _size(size),
+      _filesize(filesize),
+      _modified(modified)
+{
+//    GNASH_REPORT_FUNCTION;
+#if !defined(_WIN32) && !defined(__amigaos4__)
+    void *data = mmap(nullptr, _size, PROT_READ, MAP_SHARED, *_file, _offset);
+    if (data == MAP_FAILED) {
+        log_error(_("Couldn't map %d bytes of fd #%d into memory: %s"),
+                  _size, *_file, strerror(errno));
+        return;
+    }
+    _data = static_cast<std::uint8_t *>(data);
+#else
+    std::uint8_t *data = new std::uint8_t[_size];
+    if (lseek(*_file, _offset, SEEK_SET) != _offset
+        || read(*_file, data, _size) != static_cast<ssize_t>(_size)) {
+        log_error(_("Couldn't read %d bytes of fd #%d: %s"),
+                  _size, *_file, strerror(errno));
+        delete[] data;
+        return;
+    }
+    _data = data;
+#endif
+}
+
+FileSegment::~FileSegment()
+{
+//    GNASH_REPORT_FUNCTION;
+    if (_data) {
+#if !defined(_WIN32) && !defined(__amigaos4__)
+        munmap(_data, _size);
+#else
+        delete[] _data;
+#endif
+    }
+}
+
 Cache::Cache() 
+    : _segment_bytes(0),
+      _segment_limit(CACHE_LIMIT)
 #ifdef USE_STATS_CACHE
-    : _pathname_lookups(0),
+    , _pathname_lookups(0),
       _pathname_hits(0),
       _response_lookups(0),
       _response_hits(0),
       _file_lookups(0),
-      _file_hits(0)
+      _file_hits(0),
+      _segment_lookups(0),
+      _segment_hits(0)
 #endif
 {
 //    GNASH_REPORT_FUNCTION;
@@ -178,6 +232,120 @@ Cache::removeFile(const std::string &name)
     _files.erase(name);
 }
 
+std::shared_ptr<FileSegment>
+Cache::findSegment(const std::string &filespec, off_t offset)
+{
+//    GNASH_REPORT_FUNCTION;
+    struct stat st;
+    if (stat(filespec.c_str(), &st) < 0 || offset < 0
+        || offset >= st.st_size) {
+        return std::shared_ptr<FileSegment>();
+    }
+    const off_t start = offset - (offset % SEGMENT_SIZE);
+    const segment_key_t key(filespec, start);
+
+    std::lock_guard<std::mutex> lock(cache_mutex);
+#ifdef USE_STATS_CACHE
+    clock_gettime (CLOCK_REALTIME, &_last_access);
+    _segment_lookups++;
+#endif
+
+    // Another segment of the same file shares its descriptor, unless
+    // the file has changed since, when all its segments are stale.
+    std::shared_ptr<const int> file;
+    std::map<segment_key_t, std::pair<std::shared_ptr<FileSegment>,
+        std::list<segment_key_t>::iterator> >::iterator it
+        = _segments.lower_bound(segment_key_t(filespec, 0));
+    if (it != _segments.end() && it->first.first == filespec) {
+        std::shared_ptr<FileSegment> &seg = it->second.first;
+        if (seg->getFileSize() != st.st_size
+            || seg->getModified() != st.st_mtime) {
+            log_network(_("File %s has changed, mapping it again"), filespec);
+            while (it != _segments.end() && it->first.first == filespec) {
+                _segment_bytes -= it->second.first->size();
+                _lru.erase(it->second.second);
+                _segments.erase(it++);
+            }
+        } else {
+            file = seg->getFile();
+        }
+    }
+
+    it = _segments.find(key);
+    if (it != _segments.end()) {
+#ifdef USE_STATS_CACHE
+        _segment_hits++;
+#endif
+        _lru.splice(_lru.begin(), _lru, it->second.second);
+        return it->second.first;
+    }
+
+    if (!file) {
+        const int fd = ::open(filespec.c_str(), O_RDONLY);
+        if (fd < 0) {
+            log_error(_("Couldn't open %s: %s"), filespec, strerror(errno));
+            return std::shared_ptr<FileSegment>();
+        }
+        file.reset(new int(fd), [](const int *fd) {
+            ::close(*fd);
+            delete fd;
+        });
+    }
+
+    const size_t size = std::min<off_t>(SEGMENT_SIZE, st.st_size - start);
+    std::shared_ptr<FileSegment> seg(new FileSegment(file, start, size,
+                                                     st.st_size, st.st_mtime));
+    if (!seg->data()) {
+        return std::shared_ptr<FileSegment>();
+    }
+
+    _lru.push_front(key);
+    _segments[key] = std::make_pair(seg, _lru.begin());
+    _segment_bytes += size;
+    trimSegments();
+
+    return seg;
+}
+
+void
+Cache::removeSegments(const std::string &filespec)
+{
+//    GNASH_REPORT_FUNCTION;
+    std::lock_guard<std::mutex> lock(cache_mutex);
+    std::map<segment_key_t, std::pair<std::shared_ptr<FileSegment>,
+        std::list<segment_key_t>::iterator> >::iterator it
+        = _segments.lower_bound(segment_key_t(filespec, 0));
+    while (it != _segments.end() && it->first.first == filespec) {
+        _segment_bytes -= it->second.first->size();
+        _lru.erase(it->second.second);
+        _segments.erase(it++);
+    }
+}
+
+void
+Cache::setSegmentLimit(size_t bytes)
+{
+//    GNASH_REPORT_FUNCTION;
+    std::lock_guard<std::mutex> lock(cache_mutex);
+    _segment_limit = bytes;
+    trimSegments();
+}
+
+// The cache_mutex must be held.
+void
+Cache::trimSegments()
+{
+    // The newest segment is kept even when it alone is over the limit.
+    while (_segment_bytes > _segment_limit && _lru.size() > 1) {
+        std::map<segment_key_t, std::pair<std::shared_ptr<FileSegment>,
+            std::list<segment_key_t>::iterator> >::iterator it
+            = _segments.find(_lru.back());
+        _segment_bytes -= it->second.first->size();
+        _segments.erase(it);
+        _lru.pop_back();
+    }
+}
+
 #ifdef USE_STATS_CACHE
 string
 Cache::stats(bool xml) const
@@ -205,6 +373,11 @@ Cache::stats(bool xml) const
 	     << "		<Total>"     << _files.size()     << "</Total>" << endl
 	     << "		<Hits>"     << _file_hits        << "</Hits>" << endl
 	     << "       </Files>" << endl;
+	text << "	<Segments>" << endl
+	     << "		<Total>"     << _segments.size()  << "</Total>" << endl
+	     << "		<Bytes>"     << _segment_bytes    << "</Bytes>" << endl
+	     << "		<Hits>"     << _segment_hits     << "</Hits>" << endl
+	     << "       </Segments>" << endl;
     } else {
 	text << "Time since last access:  " << std::fixed << time << " seconds ago." << endl;
 	
@@ -219,6 +392,11 @@ Cache::stats(bool xml) const
 	text << "Files in cache: " << _files.size() << ", accessed "
 	     << _file_lookups << " times" << endl;
 	text << "	File hits from cache: " << _file_hits << endl;
+
+	text << "Segments in cache: " << _segments.size() << ", "
+	     << _segment_bytes << " bytes, accessed "
+	     << _segment_lookups << " times" << endl;
+	text << "	Segment hits from cache: " << _segment_hits << endl;
     }
     
     map<std::string, std::shared_ptr<DiskStream> >::const_iterator data;
@@ -276,6 +454,9 @@ Cache::dump(std::ostream& os) const
         os << "-----------------------------" << endl;
     }
 
+    os << "Segment cache has " << _segments.size() << " segments, "
+       << _segment_bytes << " of " << _segment_limit << " bytes." << endl;
+
 #ifdef USE_STATS_CACHE
     this->stats(false);
 #endif
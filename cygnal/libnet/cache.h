@@ -25,7 +25,13 @@
 
 #include <string>
 #include <map> 
+#include <list>
+#include <memory>
 #include <iostream>
+#include <ctime>
+#include <cstdint>
+#include <sys/types.h>
+#include <boost/noncopyable.hpp>
 
 #include "statistics.h"
 #include "diskstream.h"
@@ -39,9 +45,52 @@ namespace gnash {
 // max size of files to map enirely into the cache
 static const size_t CACHE_LIMIT = 102400000;
 
+// the size of each part of a file mapped by the cache
+static const size_t SEGMENT_SIZE = 1024 * 1024;
+
 // forward instatiate
 //class DiskStream;
 
+/// \class FileSegment
+///	A read-only memory mapping of part of a file, shared by all the
+///	connections sending it, so popular files are only read once. The
+///	file stays open as long as any of its segments is used, so it
+///	can also be sent with sendfile().
+class DSOEXPORT FileSegment : boost::noncopyable {
+public:
+    /// \brief Map part of a file.
+    ///
+    /// @param file The open file, closed when the last segment using
+    ///		it goes away.
+    ///
+    /// @param offset The page aligned offset in the file.
+    FileSegment(std::shared_ptr<const int> file, off_t offset, size_t size,
+                off_t filesize, time_t modified);
+    ~FileSegment();
+
+    /// \brief The mapped data, or 0 if the file couldn't be mapped.
+    const std::uint8_t *data() const { return _data; };
+    size_t size() const { return _size; };
+
+    /// \brief The offset in the file of the first byte.
+    off_t offset() const { return _offset; };
+
+    int getFileFd() const { return *_file; };
+    off_t getFileSize() const { return _filesize; };
+    time_t getModified() const { return _modified; };
+
+    /// \brief The open file, to keep it open while sending from it.
+    std::shared_ptr<const int> getFile() const { return _file; };
+
+private:
+    std::shared_ptr<const int> _file;
+    std::uint8_t *_data;
+    off_t  _offset;
+    size_t _size;
+    off_t  _filesize;
+    time_t _modified;
+};
+
 /// \class Cache
 //
 class DSOEXPORT Cache {
@@ -61,6 +110,29 @@ public:
     void addFile(const std::string &name, std::shared_ptr<DiskStream > &file);
     std::shared_ptr<DiskStream> & findFile(const std::string &name);
     void removeFile(const std::string &name);
+
+    /// \brief Find the mapped segment of a file holding an offset.
+    ///	Segments are mapped when first asked for. When more than the
+    ///	segment limit is mapped, the least recently used ones are
+    ///	dropped, though connections still sending them keep them.
+    ///	A file changed on disk is mapped again.
+    ///
+    /// @param filespec The full path of the file.
+    ///
+    /// @param offset The offset in the file.
+    ///
+    /// @return The segment, or an empty pointer if the file can't be
+    ///		read or the offset is past its end.
+    std::shared_ptr<FileSegment> findSegment(const std::string &filespec,
+                                             off_t offset);
+    void removeSegments(const std::string &filespec);
+
+    /// \brief Set the most bytes of files kept mapped.
+    void setSegmentLimit(size_t bytes);
+    size_t getSegmentLimit() const { return _segment_limit; };
+
+    /// \brief The number of bytes of files mapped.
+    size_t getSegmentBytes() const { return _segment_bytes; };
     
     ///  \brief Dump the internal data of this class in a human readable form.
     /// @remarks This should only be used for debugging purposes.
@@ -82,6 +154,20 @@ private:
     ///		The cache of Distream handles to often played files.
     std::map<std::string, std::shared_ptr<DiskStream> > _files;
 
+    /// Drop the least recently used segments over the limit.
+    void trimSegments();
+
+    /// \var Cache::_segments
+    ///		The mapped segments of files by path and offset, each
+    ///		with its place in _lru, which has the most recently
+    ///		used first.
+    typedef std::pair<std::string, off_t> segment_key_t;
+    std::list<segment_key_t> _lru;
+    std::map<segment_key_t, std::pair<std::shared_ptr<FileSegment>,
+                                      std::list<segment_key_t>::iterator> > _segments;
+    size_t _segment_bytes;
+    size_t _segment_limit;
+
     /// \brief Cache file statistics variables are defined here.
 #ifdef USE_STATS_CACHE
     struct timespec _last_access;
@@ -91,6 +177,8 @@ private:
     long	_response_hits;
     long	_file_lookups;
     long	_file_hits;
+    long	_segment_lookups;
+    long	_segment_hits;
 #endif
 };
 
@@ -23,6 +23,7 @@
 #include <string>
 #include <vector>
 #include <deque>
+#include <functional>
 
 #include "cque.h"
 #include "log.h"
@@ -34,7 +35,63 @@ using std::deque;
 namespace gnash
 {
 
+BufferPool::BufferPool(size_t count, size_t size)
+    : _free(count),
+      _size(size)
+{
+//    GNASH_REPORT_FUNCTION;
+}
+
+BufferPool::~BufferPool()
+{
+//    GNASH_REPORT_FUNCTION;
+    cygnal::Buffer *buf;
+    while (_free.pop(buf)) {
+	delete buf;
+    }
+}
+
+BufferPool &
+BufferPool::getDefaultInstance()
+{
+//    GNASH_REPORT_FUNCTION;
+    // This is never destroyed, as the Buffers it hands out may be
+    // dropped by other static objects as the program exits.
+    static BufferPool *pool = new BufferPool(1024, cygnal::NETBUFSIZE);
+    return *pool;
+}
+
+std::shared_ptr<cygnal::Buffer>
+BufferPool::get(size_t nbytes)
+{
+//    GNASH_REPORT_FUNCTION;
+    if (nbytes > _size) {
+	return std::shared_ptr<cygnal::Buffer>(new cygnal::Buffer(nbytes));
+    }
+    cygnal::Buffer *buf = nullptr;
+    if (!_free.pop(buf)) {
+	buf = new cygnal::Buffer(_size);
+    }
+    return std::shared_ptr<cygnal::Buffer>(buf,
+	std::bind(&BufferPool::recycle, this, std::placeholders::_1));
+}
+
+void
+BufferPool::recycle(cygnal::Buffer *buf)
+{
+//    GNASH_REPORT_FUNCTION;
+    // A Buffer that was resized isn't kept, nor any when the pool is
+    // full.
+    buf->setSeekPointer(buf->reference());
+    if ((buf->size() != _size) || !_free.push(buf)) {
+	delete buf;
+    }
+}
+
 CQue::CQue()
+    : _ring(nullptr),
+      _capacity(DEFAULT_CAPACITY),
+      _overflow(0)
 {
 //    GNASH_REPORT_FUNCTION;
 #ifdef USE_STATS_QUEUE
@@ -46,18 +103,57 @@ CQue::CQue()
     _name = "default";
 }
 
+CQue::CQue(const std::string &str, size_t capacity)
+    : _name(str),
+      _ring(nullptr),
+      _capacity(capacity),
+      _overflow(0)
+{
+//    GNASH_REPORT_FUNCTION;
+#ifdef USE_STATS_QUEUE
+    _stats.totalbytes = 0;
+    _stats.totalin = 0;
+    _stats.totalout = 0;
+    clock_gettime (CLOCK_REALTIME, &_stats.start);
+#endif
+}
+
 CQue::~CQue()
 {
 //    GNASH_REPORT_FUNCTION;
-//    clear();
-    que_t::iterator it;
-    std::lock_guard<std::mutex> lock(_mutex);
-//     for (it = _que.begin(); it != _que.end(); it++) {
-// 	std::shared_ptr<cygnal::Buffer> ptr = *(it);
-// 	if (ptr->size()) {	// FIXME: we probably want to delete ptr anyway,
-// 	    delete ptr;		// but if we do, this will core dump.
-// 	}
-//     }
+    delete _ring.load();
+}
+
+CQue::ring_t &
+CQue::ring()
+{
+    ring_t *ring = _ring.load(std::memory_order_acquire);
+    if (!ring) {
+	// Two threads may both make one, only the first is kept.
+	ring_t *made = new ring_t(_capacity);
+	if (_ring.compare_exchange_strong(ring, made)) {
+	    ring = made;
+	} else {
+	    delete made;
+	}
+    }
+    return *ring;
+}
+
+void
+CQue::park()
+{
+    ring_t *ring = _ring.load(std::memory_order_acquire);
+    if (!ring) {
+	return;
+    }
+    que_t parked;
+    std::shared_ptr<cygnal::Buffer> buf;
+    while (ring->pop(buf)) {
+	parked.push_back(buf);
+    }
+    _que.insert(_que.begin(), parked.begin(), parked.end());
+    _overflow = _que.size();
 }
 
 // Wait for a condition variable to trigger
@@ -89,20 +185,26 @@ size_t
 CQue::size()
 {
 //    GNASH_REPORT_FUNCTION;
-    std::lock_guard<std::mutex> lock(_mutex);
-    return _que.size();
+    ring_t *ring = _ring.load(std::memory_order_acquire);
+    return (ring ? ring->size() : 0) + _overflow.load();
 }
 
 bool
 CQue::push(std::shared_ptr<cygnal::Buffer> data)
 {
 //     GNASH_REPORT_FUNCTION;
-    std::lock_guard<std::mutex> lock(_mutex);
-    _que.push_back(data);
 #ifdef USE_STATS_QUEUE
     _stats.totalbytes += data->size();
     _stats.totalin++;
 #endif
+    // Once anything has overflowed, newer data has to go after it.
+    if (!_overflow.load(std::memory_order_acquire)
+	&& ring().push(std::move(data))) {
+	return true;
+    }
+    std::lock_guard<std::mutex> lock(_mutex);
+    _que.push_back(data);
+    ++_overflow;
     return true;
 }
 
@@ -111,8 +213,9 @@ bool
 CQue::push(std::uint8_t *data, int nbytes)
 {
 //    GNASH_REPORT_FUNCTION;
-    std::shared_ptr<cygnal::Buffer> buf(new cygnal::Buffer);
-    std::copy(data, data + nbytes, buf->reference());
+    std::shared_ptr<cygnal::Buffer> buf =
+	BufferPool::getDefaultInstance().get(nbytes);
+    buf->copy(data, nbytes);
     return push(buf);
 }
 
@@ -123,14 +226,21 @@ CQue::pop()
 {
 //    GNASH_REPORT_FUNCTION;
     std::shared_ptr<cygnal::Buffer> buf;
-    std::lock_guard<std::mutex> lock(_mutex);
-    if (_que.size()) {
-        buf = _que.front();
-        _que.pop_front();
+    ring_t *ring = _ring.load(std::memory_order_acquire);
+    if (!(ring && ring->pop(buf)) && _overflow.load(std::memory_order_acquire)) {
+	std::lock_guard<std::mutex> lock(_mutex);
+	// Pushes use the ring again once the overflow is empty.
+	if (_que.size()) {
+	    buf = _que.front();
+	    _que.pop_front();
+	    --_overflow;
+	}
+    }
 #ifdef USE_STATS_QUEUE
+    if (buf) {
 	_stats.totalout++;
-#endif
     }
+#endif
     return buf;
 }
 
@@ -139,6 +249,16 @@ std::shared_ptr<cygnal::Buffer>
 CQue::peek()
 {
 //    GNASH_REPORT_FUNCTION;
+    ring_t *ring = _ring.load(std::memory_order_acquire);
+    if (ring) {
+	std::shared_ptr<cygnal::Buffer> *front = ring->front();
+	if (front) {
+	    return *front;
+	}
+    }
+    if (!_overflow.load(std::memory_order_acquire)) {
+	return std::shared_ptr<cygnal::Buffer>();
+    }
     std::lock_guard<std::mutex> lock(_mutex);
     if (_que.size()) {
         return _que.front();
@@ -146,13 +266,26 @@ CQue::peek()
     return std::shared_ptr<cygnal::Buffer>();
 }
 
+std::shared_ptr<cygnal::Buffer>
+CQue::operator[] (int index)
+{
+    std::lock_guard<std::mutex> lock(_mutex);
+    park();
+    if (index < 0 || static_cast<size_t>(index) >= _que.size()) {
+	return std::shared_ptr<cygnal::Buffer>();
+    }
+    return _que[index];
+}
+
 // Return the size of the queues
 void
 CQue::clear()
 {
 //    GNASH_REPORT_FUNCTION;
     std::lock_guard<std::mutex> lock(_mutex);
+    park();
     _que.clear();
+    _overflow = 0;
 }
 
 // Remove a range of elements
@@ -164,6 +297,7 @@ CQue::remove(std::shared_ptr<cygnal::Buffer> begin, std::shared_ptr<cygnal::Buff
     deque<std::shared_ptr<cygnal::Buffer> >::iterator start;
     deque<std::shared_ptr<cygnal::Buffer> >::iterator stop;
     std::lock_guard<std::mutex> lock(_mutex);
+    park();
     std::shared_ptr<cygnal::Buffer> ptr;
     for (it = _que.begin(); it != _que.end(); ++it) {
 	ptr = *(it);
@@ -176,6 +310,7 @@ CQue::remove(std::shared_ptr<cygnal::Buffer> begin, std::shared_ptr<cygnal::Buff
 	}
     }
     _que.erase(start, stop);
+    _overflow = _que.size();
 }
 
 // Remove an element
@@ -185,6 +320,7 @@ CQue::remove(std::shared_ptr<cygnal::Buffer> element)
     GNASH_REPORT_FUNCTION;
     deque<std::shared_ptr<cygnal::Buffer> >::iterator it;
     std::lock_guard<std::mutex> lock(_mutex);
+    park();
     for (it = _que.begin(); it != _que.end(); ) {
 	std::shared_ptr<cygnal::Buffer> ptr = *(it);
 	if (ptr->reference() == element->reference()) {
@@ -193,6 +329,7 @@ CQue::remove(std::shared_ptr<cygnal::Buffer> element)
 	    ++it;
 	}
     }
+    _overflow = _que.size();
 }
 
 // Merge sucessive buffers into one single larger buffer. This is for some
@@ -201,14 +338,20 @@ std::shared_ptr<cygnal::Buffer>
 CQue::merge()
 {
 //     GNASH_REPORT_FUNCTION;
-    
-    return merge(_que.front());
+    std::shared_ptr<cygnal::Buffer> front = peek();
+    if (!front) {
+	return front;
+    }
+    return merge(front);
 }
 
 std::shared_ptr<cygnal::Buffer>
 CQue::merge(std::shared_ptr<cygnal::Buffer> start)
 {
 //     GNASH_REPORT_FUNCTION;
+    std::lock_guard<std::mutex> lock(_mutex);
+    park();
+
     // Find iterator to first element to merge
     que_t::iterator from = std::find(_que.begin(), _que.end(), start); 
     if (from == _que.end()) {
@@ -250,6 +393,7 @@ CQue::merge(std::shared_ptr<cygnal::Buffer> start)
 
     // Finally erase all merged elements, and replace with the composite one
     _que.erase(from, to);
+    _overflow = _que.size();
     //que_t::iterator nextIter = _que.erase(from, to);
 //    _que.insert(nextIter, newbuf.get()); FIXME:
 
@@ -263,6 +407,7 @@ CQue::dump()
 //    GNASH_REPORT_FUNCTION;
     deque<std::shared_ptr<cygnal::Buffer> >::iterator it;
     std::lock_guard<std::mutex> lock(_mutex);
+    park();
     std::cerr << std::endl << "CQue \"" << _name << "\" has "<< _que.size()
               << " buffers." << std::endl;
     for (it = _que.begin(); it != _que.end(); ++it) {
@@ -21,32 +21,78 @@
 
 #include <string>
 #include <cstdint>
+#include <atomic>
 #include <mutex>
 #include <condition_variable>
 #include <deque>
+#include <boost/noncopyable.hpp>
 
 #include "getclocktime.hpp"
 #include "buffer.h"
 #include "network.h"
+#include "ring.h"
 #include "dsodefs.h" //For DSOEXPORT.
 
 // _definst_ is the default instance name
 namespace gnash
 {
 
+/// \class BufferPool
+///	Recycles the Buffers used to pass network data between threads,
+///	so a packet doesn't cost a heap allocation. A Buffer goes back
+///	to the pool when the last pointer to it is dropped.
+class DSOEXPORT BufferPool : boost::noncopyable {
+public:
+    /// \brief Create a pool.
+    ///
+    /// @param count The most free Buffers kept.
+    ///
+    /// @param size The size of each Buffer.
+    BufferPool(size_t count, size_t size);
+    ~BufferPool();
+
+    /// \brief The pool shared by all queues, holding Buffers of
+    ///	NETBUFSIZE bytes.
+    static BufferPool &getDefaultInstance();
+
+    /// \brief Get an empty Buffer that holds at least nbytes.
+    ///	Buffers larger than the pool's are allocated, and freed
+    ///	when done with.
+    std::shared_ptr<cygnal::Buffer> get(size_t nbytes);
+
+    /// \brief The number of free Buffers waiting to be used.
+    size_t available() const { return _free.size(); };
+
+private:
+    void recycle(cygnal::Buffer *buf);
+
+    Ring<cygnal::Buffer *> _free;
+    const size_t _size;
+};
+
+/// \class CQue
+///	A FIFO of Buffers passed between threads. Pushing and popping
+///	take no locks: the Buffers go through a bounded lock-free Ring,
+///	made on first use so idle queues cost little. When the ring is
+///	full, later Buffers wait in a locked overflow list until it has
+///	room, so a push never fails. peek(), merge(), remove() and
+///	operator[] are only for the thread popping from the que.
 class CQue {
 public:
     typedef std::deque<std::shared_ptr<cygnal::Buffer> > que_t;
 #ifdef USE_STATS_QUEUE
     typedef struct {
 	struct timespec start;
-	int		totalbytes;
-	int		totalin;
-	int		totalout;
+	std::atomic<int> totalbytes;
+	std::atomic<int> totalin;
+	std::atomic<int> totalout;
     } que_stats_t;
 #endif
+    /// The number of Buffers held by the ring of a que.
+    static const size_t DEFAULT_CAPACITY = 1024;
+
     CQue();
-    CQue(const std::string &str) { _name = str; };
+    CQue(const std::string &str, size_t capacity = DEFAULT_CAPACITY);
     ~CQue();
     // Push data onto the que
     bool push(std::uint8_t *data, int nbytes);
@@ -73,7 +119,7 @@ public:
     std::shared_ptr<cygnal::Buffer> DSOEXPORT merge(std::shared_ptr<cygnal::Buffer> begin);
     std::shared_ptr<cygnal::Buffer> DSOEXPORT merge();
 
-    std::shared_ptr<cygnal::Buffer> operator[] (int index) { return _que[index]; };
+    std::shared_ptr<cygnal::Buffer> operator[] (int index);
     
     // Dump the data to the terminal
     void dump();
@@ -83,17 +129,31 @@ public:
     void setName(const std::string &str) { _name = str; }
     const std::string &getName() { return _name; }
 private:
+    typedef Ring<std::shared_ptr<cygnal::Buffer> > ring_t;
+
+    // Get the ring, making it if this is the first use.
+    ring_t &ring();
+
+    // Move everything into the overflow list, so it can be searched
+    // and changed. The _mutex must be held.
+    void park();
+
     // an optional name for the queue, only used for debugging messages to make them unique
     std::string			_name;
-    // The queue itself
+    // The ring holding the oldest elements of the que.
+    std::atomic<ring_t *>	_ring;
+    size_t			_capacity;
+    // The elements that didn't fit in the ring, which are all newer
+    // than those in it. While there are any, pushes go here too.
     que_t			_que;
+    std::atomic<size_t>		_overflow;
 
     // A condition variable used to signal the other thread when the que has data
     std::condition_variable	_cond;
     // This is the mutex used by the condition variable. It needs to be separate from the
     // one used to lock access to the que.
     std::mutex			_cond_mutex;
-    // This is the mutex that controls access to the que.
+    // This is the mutex that controls access to the overflow list.
     std::mutex			_mutex;
 #ifdef USE_STATS_QUEUE
     que_stats_t			_stats;
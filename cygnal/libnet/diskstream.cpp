@@ -47,6 +47,7 @@
 #include "cque.h"
 #include "diskstream.h"
 #include "cache.h"
+#include "reactor.h"
 #include "getclocktime.hpp"
 
 // This is Linux specific, but offers better I/O for sending
@@ -744,6 +745,27 @@ DiskStream::play(int netfd, bool flag)
 	      // continue;
           case PLAY:
 	  {
+	      // A connection driven by a Reactor queues the rest of the
+	      // file at once, for the kernel to send from the shared
+	      // mapping without copying it.
+	      Reactor::Connection *conn = Reactor::Connection::current();
+	      if (conn && (conn->getFileFd() == netfd) && !_filespec.empty()) {
+		  std::shared_ptr<FileSegment> seg =
+		      cache.findSegment(_filespec, _offset);
+		  const off_t end = seg ? std::min<off_t>(_filesize,
+							  seg->getFileSize()) : 0;
+		  if (end > _offset) {
+		      conn->sendFile(seg->getFile(), seg->getFileFd(),
+				     _offset, end - _offset);
+		      log_network(_("Sending file %s, size was: %d"),
+				  _filespec, _filesize);
+		      close();
+		      done = true;
+		      _offset = 0;
+		      break;
+		  }
+	      }
+
 	      size_t ret;
 	      Network net;
 	      if ((_filesize - _offset) < _pagesize) {
@@ -296,6 +296,8 @@ public:
     
     // Pop the first date element off the que
     std::shared_ptr<cygnal::Buffer> DSOEXPORT popChunk() { return _que.pop(); };
+    // Add a data element to the end of the que
+    void DSOEXPORT pushChunk(std::shared_ptr<cygnal::Buffer> buf) { _que.push(buf); };
     // Peek at the first date element witjhout removing it from the que
     std::shared_ptr<cygnal::Buffer> DSOEXPORT peekChunk() { return _que.peek(); };
     // Get the number of elements in the que
@@ -27,6 +27,7 @@
 #include "utility.h"
 #include "log.h"
 #include "network.h"
+#include "reactor.h"
 
 #include <sys/types.h>
 #include <cstring>
@@ -756,6 +757,14 @@ Network::closeNet(int sockfd)
         return true;
     }
 
+    // A Reactor owns the sockets of its connections, and closes them
+    // once the last reply is written.
+    Reactor::Connection *conn = Reactor::Connection::current();
+    if (conn && conn->getFileFd() == sockfd) {
+        conn->close();
+        return true;
+    }
+
     while (retries < 3) {
         if (sockfd) {
             // Shutdown the socket connection
@@ -927,6 +936,14 @@ Network::readNet(int fd, byte_t *buffer, int nbytes, int timeout)
     if (_debug) {
 	log_debug(_("Trying to read %d bytes from fd #%d"), nbytes, fd);
     }
+
+    // When called by a connection driven by a Reactor, the data has
+    // already been read, and waiting for more would block the other
+    // connections.
+    Reactor::Connection *conn = Reactor::Connection::current();
+    if (conn && conn->getFileFd() == fd) {
+        return conn->read(buffer, nbytes);
+    }
 #ifdef NET_TIMING
     if (_timing_debug)
     {
@@ -1119,6 +1136,20 @@ Network::writeNet(int fd, const byte_t *buffer, int nbytes, int timeout)
     // We need a writable, and not const point for byte arithmetic.
     byte_t *bufptr = const_cast<byte_t *>(buffer);
 
+    // A connection driven by a Reactor queues the data, to be written
+    // when the socket can take it. Writing to its socket directly
+    // would mix with the output its worker writes.
+    Reactor::Connection *conn = Reactor::Connection::current();
+    if (conn && conn->getFileFd() == fd) {
+        conn->write(buffer, nbytes);
+        return nbytes;
+    }
+    std::shared_ptr<Reactor::Connection> other = Reactor::Connection::find(fd);
+    if (other) {
+        other->write(buffer, nbytes);
+        return nbytes;
+    }
+
 #ifdef NET_TIMING
     // If we are debugging the tcp/ip timings, get the initial time.
     if (_timing_debug)
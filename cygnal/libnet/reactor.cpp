@@ -0,0 +1,878 @@
+// reactor.cpp:  An event loop for many non-blocking network connections.
+//
+//   Copyright (C) 2005, 2006, 2007, 2008, 2009, 2010, 2011, 2012
+//   Free Software Foundation, Inc
+//
+// This program is free software; you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation; either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program; if not, write to the Free Software
+// Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+//
+
+#ifdef HAVE_CONFIG_H
+#include "gnashconfig.h"
+#endif
+
+#include <algorithm>
+#include <cassert>
+#include <cerrno>
+#include <cstring>
+#include <thread>
+#include <unordered_map>
+
+#ifdef HAVE_SYS_EPOLL_H
+# include <fcntl.h>
+# include <unistd.h>
+# include <netinet/in.h>
+# include <netinet/tcp.h>
+# include <pthread.h>
+# include <signal.h>
+# include <sys/epoll.h>
+# include <sys/eventfd.h>
+# include <sys/sendfile.h>
+# include <sys/socket.h>
+# include <sys/uio.h>
+#endif
+
+#include "log.h"
+#include "reactor.h"
+
+namespace gnash {
+
+namespace {
+
+/// The connection being processed by this thread.
+thread_local Reactor::Connection *processing = 0;
+
+/// The connections of all reactors by socket, so any thread can
+/// queue output to a connection it isn't processing.
+std::mutex registry_mutex;
+std::unordered_map<int, std::weak_ptr<Reactor::Connection> > registry;
+
+/// Sets the connection being processed for the life of a scope.
+class Processing {
+public:
+    Processing(Reactor::Connection *conn) { processing = conn; };
+    ~Processing() { processing = 0; };
+};
+
+/// The most unprocessed input a connection may have. More than this
+/// means the peer is sending faster than it is processed, or sending
+/// garbage.
+const size_t MAX_PENDING_INPUT = 1024 * 1024;
+
+/// The number of bytes read from a socket at once.
+const size_t READ_SIZE = 16 * 1024;
+
+/// The number of buffers written with one system call. RTMP chunks
+/// take two each.
+const int WRITE_BUFFERS = 256;
+
+/// The most bytes of a file sent with one system call, so one large
+/// file doesn't keep the others waiting.
+const size_t SENDFILE_SIZE = 1024 * 1024;
+
+/// The number of times processOutput() is called in a row for one
+/// connection, before the others get a turn.
+const int OUTPUT_ROUNDS = 16;
+
+} // anonymous namespace
+
+Reactor::Connection::Connection(int fd)
+    : _fd(fd),
+      _consumed(0),
+      _written(0),
+      _queued(0),
+      _closing(false),
+      _closed(false),
+      _worker(0)
+{
+}
+
+Reactor::Connection::~Connection()
+{
+}
+
+void
+Reactor::Connection::consume(size_t nbytes)
+{
+    assert(nbytes <= bytesReady());
+    _consumed += nbytes;
+    if (_consumed == _input.size()) {
+        _input.clear();
+        _consumed = 0;
+    }
+}
+
+int
+Reactor::Connection::read(std::uint8_t *data, size_t nbytes)
+{
+    nbytes = std::min(nbytes, bytesReady());
+    if (nbytes) {
+        std::copy(input(), input() + nbytes, data);
+        consume(nbytes);
+    }
+    return nbytes;
+}
+
+size_t
+Reactor::Connection::bytesQueued() const
+{
+    std::lock_guard<std::mutex> lock(_mutex);
+    return _queued;
+}
+
+Reactor::Connection *
+Reactor::Connection::current()
+{
+    return processing;
+}
+
+std::shared_ptr<Reactor::Connection>
+Reactor::Connection::find(int fd)
+{
+    std::lock_guard<std::mutex> lock(registry_mutex);
+    std::unordered_map<int, std::weak_ptr<Connection> >::const_iterator it
+        = registry.find(fd);
+    if (it == registry.end()) {
+        return std::shared_ptr<Connection>();
+    }
+    return it->second.lock();
+}
+
+#ifdef HAVE_SYS_EPOLL_H
+
+/// \struct Reactor::Worker
+///	One thread waiting on its own epoll set.
+struct Reactor::Worker : boost::noncopyable {
+    Worker(Reactor &reactor);
+    ~Worker();
+
+    /// Take a connection, from any thread.
+    void add(std::shared_ptr<Connection> conn);
+
+    /// Have the thread write the queued output of a connection.
+    void wake(int fd);
+
+    /// Stop the thread.
+    void stop();
+
+    void run();
+
+    /// Register the connections given by other threads, and write
+    /// the output queued by them.
+    void update();
+
+    /// Read all input, and process it.
+    bool receive(Connection &conn);
+
+    /// Write as much output as the socket takes, producing more as
+    /// it empties.
+    bool send(Connection &conn);
+
+    /// Close a connection and forget it.
+    void drop(int fd);
+
+    /// Fill in buffers for the unsent part of some output in memory.
+    ///
+    /// @return The number of buffers used.
+    static int gather(const Connection::Output &out, size_t skip,
+                      struct iovec *iov, int room);
+
+    Reactor &reactor;
+    int epfd;
+    int wakefd;
+    std::thread thread;
+    std::atomic<bool> done;
+
+    /// The connections owned by this worker, only used by its thread.
+    std::unordered_map<int, std::shared_ptr<Connection> > connections;
+    std::atomic<size_t> count;
+
+    /// Connections that still had output to produce after their turn.
+    std::vector<int> ready;
+
+    /// Connections and output from other threads.
+    std::mutex mutex;
+    std::vector<std::shared_ptr<Connection> > added;
+    std::vector<int> dirty;
+};
+
+int
+Reactor::Worker::gather(const Connection::Output &out, size_t skip,
+                        struct iovec *iov, int room)
+{
+    if (!out.chunk) {
+        iov[0].iov_base = const_cast<std::uint8_t *>(out.data + skip);
+        iov[0].iov_len = out.size - skip;
+        return 1;
+    }
+
+    // The first chunk is sent as it is, the others after a header.
+    size_t pos = skip;
+    bool header = false;
+    if (skip >= out.chunk) {
+        const size_t rest = skip - out.chunk;
+        const size_t part = rest % (out.chunk + 1);
+        pos = (rest / (out.chunk + 1) + 1) * out.chunk + (part ? part - 1 : 0);
+        header = !part;
+    }
+
+    int count = 0;
+    while (count < room && pos < out.size) {
+        if (header) {
+            iov[count].iov_base = const_cast<std::uint8_t *>(&out.header);
+            iov[count].iov_len = 1;
+            header = false;
+        } else {
+            const size_t end = std::min(out.size,
+                                        (pos / out.chunk + 1) * out.chunk);
+            iov[count].iov_base = const_cast<std::uint8_t *>(out.data + pos);
+            iov[count].iov_len = end - pos;
+            pos = end;
+            header = true;
+        }
+        ++count;
+    }
+    return count;
+}
+
+Reactor::Worker::Worker(Reactor &r)
+    : reactor(r),
+      epfd(epoll_create1(EPOLL_CLOEXEC)),
+      wakefd(eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC)),
+      done(false),
+      count(0)
+{
+    if (epfd < 0 || wakefd < 0) {
+        log_error(_("Couldn't create the reactor event set: %s"),
+                  strerror(errno));
+        return;
+    }
+    struct epoll_event ev;
+    ev.events = EPOLLIN | EPOLLET;
+    ev.data.fd = wakefd;
+    epoll_ctl(epfd, EPOLL_CTL_ADD, wakefd, &ev);
+}
+
+Reactor::Worker::~Worker()
+{
+    stop();
+    while (!connections.empty()) {
+        drop(connections.begin()->first);
+    }
+    ::close(wakefd);
+    ::close(epfd);
+}
+
+void
+Reactor::Worker::add(std::shared_ptr<Connection> conn)
+{
+    conn->_worker = this;
+    ++count;
+    {
+        std::lock_guard<std::mutex> lock(registry_mutex);
+        registry[conn->getFileFd()] = conn;
+    }
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        added.push_back(conn);
+    }
+    std::uint64_t one = 1;
+    ::write(wakefd, &one, sizeof(one));
+}
+
+void
+Reactor::Worker::wake(int fd)
+{
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        dirty.push_back(fd);
+    }
+    std::uint64_t one = 1;
+    ::write(wakefd, &one, sizeof(one));
+}
+
+void
+Reactor::Worker::stop()
+{
+    if (thread.joinable()) {
+        done = true;
+        std::uint64_t one = 1;
+        ::write(wakefd, &one, sizeof(one));
+        thread.join();
+    }
+}
+
+void
+Reactor::Worker::run()
+{
+    const int MAX_EVENTS = 256;
+    struct epoll_event events[MAX_EVENTS];
+
+    // Unlike sendmsg(), sendfile() can't be told not to raise SIGPIPE
+    // when the other end has gone, so this thread ignores it.
+    sigset_t blockset;
+    sigemptyset(&blockset);
+    sigaddset(&blockset, SIGPIPE);
+    pthread_sigmask(SIG_BLOCK, &blockset, 0);
+
+    while (!done) {
+        const int nfds = epoll_wait(epfd, events, MAX_EVENTS,
+                                    ready.empty() ? -1 : 0);
+        if (nfds < 0 && errno != EINTR) {
+            log_error(_("Waiting for network events failed: %s"),
+                      strerror(errno));
+            break;
+        }
+
+        for (int i = 0; i < nfds; ++i) {
+            const int fd = events[i].data.fd;
+            const std::uint32_t what = events[i].events;
+            if (fd == wakefd) {
+                std::uint64_t val;
+                while (::read(wakefd, &val, sizeof(val)) > 0) { }
+                continue;
+            }
+            std::unordered_map<int, std::shared_ptr<Connection> >::iterator
+                it = connections.find(fd);
+            if (it == connections.end()) {
+                reactor.accept(fd);
+                continue;
+            }
+            // Hold on to the connection while its methods run.
+            std::shared_ptr<Connection> conn = it->second;
+            if (what & EPOLLERR) {
+                drop(fd);
+                continue;
+            }
+            if ((what & (EPOLLIN | EPOLLHUP | EPOLLRDHUP))
+                && !receive(*conn)) {
+                drop(fd);
+                continue;
+            }
+            if (!send(*conn)) {
+                drop(fd);
+            }
+        }
+
+        // Give the connections that filled their turn another one.
+        std::vector<int> again;
+        again.swap(ready);
+        for (size_t i = 0; i < again.size(); ++i) {
+            std::unordered_map<int, std::shared_ptr<Connection> >::iterator
+                it = connections.find(again[i]);
+            if (it != connections.end()) {
+                std::shared_ptr<Connection> conn = it->second;
+                if (!send(*conn)) {
+                    drop(again[i]);
+                }
+            }
+        }
+
+        update();
+    }
+}
+
+void
+Reactor::Worker::update()
+{
+    std::vector<std::shared_ptr<Connection> > conns;
+    std::vector<int> fds;
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        conns.swap(added);
+        fds.swap(dirty);
+    }
+
+    for (size_t i = 0; i < conns.size(); ++i) {
+        const int fd = conns[i]->getFileFd();
+        connections[fd] = conns[i];
+        // Adding a socket that already has data reports it at once,
+        // even though the events are edge-triggered.
+        struct epoll_event ev;
+        ev.events = EPOLLIN | EPOLLOUT | EPOLLRDHUP | EPOLLET;
+        ev.data.fd = fd;
+        if (epoll_ctl(epfd, EPOLL_CTL_ADD, fd, &ev) < 0) {
+            log_error(_("Couldn't watch fd #%d: %s"), fd, strerror(errno));
+            drop(fd);
+        }
+    }
+
+    std::sort(fds.begin(), fds.end());
+    fds.erase(std::unique(fds.begin(), fds.end()), fds.end());
+    for (size_t i = 0; i < fds.size(); ++i) {
+        std::unordered_map<int, std::shared_ptr<Connection> >::iterator it
+            = connections.find(fds[i]);
+        if (it != connections.end()) {
+            std::shared_ptr<Connection> conn = it->second;
+            if (!send(*conn)) {
+                drop(fds[i]);
+            }
+        }
+    }
+}
+
+bool
+Reactor::Worker::receive(Connection &conn)
+{
+    while (true) {
+        std::vector<std::uint8_t> &in = conn._input;
+
+        // Input that keeps ending with part of a message is never
+        // consumed to the end, so drop what has been processed. Doing
+        // it only once that is no less than the rest keeps the copying
+        // down to about one per byte.
+        if (conn._consumed && conn._consumed >= in.size() - conn._consumed) {
+            in.erase(in.begin(), in.begin() + conn._consumed);
+            conn._consumed = 0;
+        }
+
+        const size_t size = in.size();
+        in.resize(size + READ_SIZE);
+        const ssize_t ret = ::read(conn._fd, &in[size], READ_SIZE);
+        in.resize(size + std::max<ssize_t>(ret, 0));
+
+        if (ret < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            if (errno == EAGAIN || errno == EWOULDBLOCK) {
+                return true;
+            }
+            log_network(_("Couldn't read from fd #%d: %s"), conn._fd,
+                        strerror(errno));
+            return false;
+        }
+
+        if (ret == 0) {
+            // The other end has closed, but may still be waiting for
+            // the reply to what it sent.
+            conn.close();
+            return true;
+        }
+
+        Processing p(&conn);
+        if (!conn.processInput()) {
+            return false;
+        }
+        if (conn.bytesReady() > MAX_PENDING_INPUT) {
+            log_error(_("Too much unprocessed data for fd #%d, closing"),
+                      conn._fd);
+            return false;
+        }
+    }
+}
+
+bool
+Reactor::Worker::send(Connection &conn)
+{
+    for (int rounds = 0; ; ) {
+        struct iovec iov[WRITE_BUFFERS];
+        int count = 0;
+        int file = -1;
+        off_t offset = 0;
+        size_t length = 0;
+        {
+            std::lock_guard<std::mutex> lock(conn._mutex);
+            // Only this thread removes output, and adding to a deque
+            // doesn't move the rest. Memory is gathered up to the
+            // first part of a file, which is sent on its own.
+            for (std::deque<Connection::Output>::iterator it
+                     = conn._output.begin();
+                 it != conn._output.end() && count < WRITE_BUFFERS; ++it) {
+                const size_t skip = count ? 0 : conn._written;
+                if (it->file >= 0) {
+                    if (!count) {
+                        file = it->file;
+                        offset = it->offset + skip;
+                        length = std::min(it->size - skip, SENDFILE_SIZE);
+                    }
+                    break;
+                }
+                count += gather(*it, skip, iov + count,
+                                WRITE_BUFFERS - count);
+            }
+            if (!count && file < 0 && conn._closing) {
+                return false;
+            }
+        }
+
+        if (!count && file < 0) {
+            if (rounds++ == OUTPUT_ROUNDS) {
+                ready.push_back(conn._fd);
+                return true;
+            }
+            Processing p(&conn);
+            if (!conn.processOutput()) {
+                return false;
+            }
+            std::lock_guard<std::mutex> lock(conn._mutex);
+            if (conn._output.empty()) {
+                return !conn._closing;
+            }
+            continue;
+        }
+
+        ssize_t ret;
+        if (file >= 0) {
+            ret = ::sendfile(conn._fd, file, &offset, length);
+            if (ret == 0) {
+                log_error(_("File sent to fd #%d is shorter than expected"),
+                          conn._fd);
+                return false;
+            }
+        } else {
+            struct msghdr msg;
+            std::memset(&msg, 0, sizeof(msg));
+            msg.msg_iov = iov;
+            msg.msg_iovlen = count;
+            ret = ::sendmsg(conn._fd, &msg, MSG_NOSIGNAL);
+        }
+        if (ret < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            if (errno == EAGAIN || errno == EWOULDBLOCK) {
+                // Wait for the socket to drain.
+                return true;
+            }
+            log_network(_("Couldn't write to fd #%d: %s"), conn._fd,
+                        strerror(errno));
+            return false;
+        }
+
+        std::lock_guard<std::mutex> lock(conn._mutex);
+        conn._queued -= ret;
+        while (ret) {
+            const size_t left = conn._output.front().length() - conn._written;
+            if (static_cast<size_t>(ret) < left) {
+                conn._written += ret;
+                break;
+            }
+            ret -= left;
+            conn._written = 0;
+            conn._output.pop_front();
+        }
+    }
+}
+
+void
+Reactor::Worker::drop(int fd)
+{
+    std::unordered_map<int, std::shared_ptr<Connection> >::iterator it
+        = connections.find(fd);
+    if (it == connections.end()) {
+        return;
+    }
+    std::shared_ptr<Connection> conn = it->second;
+    connections.erase(it);
+    --count;
+    {
+        // The socket may be reused as soon as it is closed.
+        std::lock_guard<std::mutex> lock(registry_mutex);
+        registry.erase(fd);
+    }
+
+    {
+        std::lock_guard<std::mutex> lock(conn->_mutex);
+        conn->_closed = true;
+        conn->_output.clear();
+        conn->_queued = 0;
+    }
+    epoll_ctl(epfd, EPOLL_CTL_DEL, fd, 0);
+    {
+        Processing p(conn.get());
+        conn->processClose();
+    }
+    ::close(fd);
+    log_network(_("Closed connection on fd #%d"), fd);
+}
+
+Reactor::Reactor(size_t workers)
+    : _next(0),
+      _running(false)
+{
+    if (workers == 0) {
+        workers = std::max(1u, std::thread::hardware_concurrency());
+    }
+    for (size_t i = 0; i < workers; ++i) {
+        _workers.push_back(std::unique_ptr<Worker>(new Worker(*this)));
+    }
+}
+
+Reactor::~Reactor()
+{
+    stop();
+}
+
+bool
+Reactor::addListener(int fd, factory_t factory)
+{
+    GNASH_REPORT_FUNCTION;
+
+    const int flags = fcntl(fd, F_GETFL, 0);
+    if (flags < 0 || fcntl(fd, F_SETFL, flags | O_NONBLOCK) < 0) {
+        log_error(_("Couldn't make fd #%d non-blocking: %s"), fd,
+                  strerror(errno));
+        return false;
+    }
+
+    {
+        std::lock_guard<std::mutex> lock(_listener_mutex);
+        _listeners[fd] = factory;
+    }
+
+    struct epoll_event ev;
+    ev.events = EPOLLIN | EPOLLET;
+    ev.data.fd = fd;
+    if (epoll_ctl(_workers[0]->epfd, EPOLL_CTL_ADD, fd, &ev) < 0) {
+        log_error(_("Couldn't watch fd #%d for connections: %s"), fd,
+                  strerror(errno));
+        std::lock_guard<std::mutex> lock(_listener_mutex);
+        _listeners.erase(fd);
+        return false;
+    }
+
+    log_network(_("Accepting connections on fd #%d with %d workers"), fd,
+                _workers.size());
+    return true;
+}
+
+bool
+Reactor::addConnection(std::shared_ptr<Connection> conn)
+{
+    const int fd = conn->getFileFd();
+    const int flags = fcntl(fd, F_GETFL, 0);
+    if (flags < 0 || fcntl(fd, F_SETFL, flags | O_NONBLOCK) < 0) {
+        log_error(_("Couldn't make fd #%d non-blocking: %s"), fd,
+                  strerror(errno));
+        return false;
+    }
+    _workers[_next++ % _workers.size()]->add(conn);
+    return true;
+}
+
+Reactor::factory_t
+Reactor::findListener(int fd)
+{
+    std::lock_guard<std::mutex> lock(_listener_mutex);
+    std::map<int, factory_t>::iterator it = _listeners.find(fd);
+    if (it == _listeners.end()) {
+        return factory_t();
+    }
+    return it->second;
+}
+
+void
+Reactor::accept(int fd)
+{
+    factory_t factory = findListener(fd);
+    if (!factory) {
+        return;
+    }
+
+    while (true) {
+        const int newfd = ::accept4(fd, 0, 0, SOCK_NONBLOCK | SOCK_CLOEXEC);
+        if (newfd < 0) {
+            if (errno == EINTR || errno == ECONNABORTED) {
+                continue;
+            }
+            if (errno != EAGAIN && errno != EWOULDBLOCK) {
+                log_error(_("Couldn't accept a connection on fd #%d: %s"),
+                          fd, strerror(errno));
+            }
+            return;
+        }
+
+        // Most messages are small and answered at once.
+        const int on = 1;
+        setsockopt(newfd, IPPROTO_TCP, TCP_NODELAY, &on, sizeof(on));
+
+        std::shared_ptr<Connection> conn = factory(newfd);
+        if (!conn) {
+            ::close(newfd);
+            continue;
+        }
+        _workers[_next++ % _workers.size()]->add(conn);
+    }
+}
+
+void
+Reactor::start()
+{
+    GNASH_REPORT_FUNCTION;
+
+    if (_running) {
+        return;
+    }
+    _running = true;
+    for (size_t i = 0; i < _workers.size(); ++i) {
+        Worker *worker = _workers[i].get();
+        worker->thread = std::thread(std::bind(&Worker::run, worker));
+    }
+}
+
+void
+Reactor::stop()
+{
+    // The first worker may still be giving connections to the others.
+    for (size_t i = 0; i < _workers.size(); ++i) {
+        _workers[i]->stop();
+    }
+    _workers.clear();
+    _running = false;
+
+    std::lock_guard<std::mutex> lock(_listener_mutex);
+    _listeners.clear();
+}
+
+size_t
+Reactor::connections() const
+{
+    size_t total = 0;
+    for (size_t i = 0; i < _workers.size(); ++i) {
+        total += _workers[i]->count;
+    }
+    return total;
+}
+
+#endif // HAVE_SYS_EPOLL_H
+
+void
+Reactor::Connection::write(const std::uint8_t *data, size_t nbytes)
+{
+    if (!nbytes) {
+        return;
+    }
+    Output out;
+    out.copy.assign(data, data + nbytes);
+    out.size = nbytes;
+    out.chunk = 0;
+    out.file = -1;
+    queue(&out);
+}
+
+void
+Reactor::Connection::write(std::shared_ptr<const void> owner,
+                           const std::uint8_t *data, size_t nbytes,
+                           size_t chunk, std::uint8_t header)
+{
+    if (!nbytes) {
+        return;
+    }
+    Output out;
+    out.owner = owner;
+    out.data = data;
+    out.size = nbytes;
+    out.chunk = chunk;
+    out.header = header;
+    out.file = -1;
+    queue(&out);
+}
+
+void
+Reactor::Connection::write(const std::uint8_t *head, size_t headbytes,
+                           std::shared_ptr<const void> owner,
+                           const std::uint8_t *data, size_t nbytes,
+                           size_t chunk, std::uint8_t header)
+{
+    Output out[2];
+    size_t count = 0;
+    if (headbytes) {
+        out[count].copy.assign(head, head + headbytes);
+        out[count].size = headbytes;
+        out[count].chunk = 0;
+        out[count].file = -1;
+        ++count;
+    }
+    if (nbytes) {
+        out[count].owner = owner;
+        out[count].data = data;
+        out[count].size = nbytes;
+        out[count].chunk = chunk;
+        out[count].header = header;
+        out[count].file = -1;
+        ++count;
+    }
+    if (count) {
+        queue(out, count);
+    }
+}
+
+void
+Reactor::Connection::sendFile(std::shared_ptr<const void> owner, int filefd,
+                              off_t offset, size_t nbytes)
+{
+    if (!nbytes) {
+        return;
+    }
+    Output out;
+    out.owner = owner;
+    out.size = nbytes;
+    out.chunk = 0;
+    out.file = filefd;
+    out.offset = offset;
+    queue(&out);
+}
+
+void
+Reactor::Connection::queue(Output *out, size_t count)
+{
+    bool wake;
+    {
+        std::lock_guard<std::mutex> lock(_mutex);
+        if (_closed || _closing) {
+            return;
+        }
+        wake = _output.empty();
+        for (size_t i = 0; i < count; ++i) {
+            _queued += out[i].length();
+            _output.push_back(std::move(out[i]));
+            Output &back = _output.back();
+            if (!back.copy.empty()) {
+                back.data = &back.copy[0];
+            }
+        }
+    }
+    // The worker writes what its connections queue while processing
+    // them, others have to wake it.
+#ifdef HAVE_SYS_EPOLL_H
+    if (wake && _worker && processing != this) {
+        _worker->wake(_fd);
+    }
+#endif
+}
+
+void
+Reactor::Connection::close()
+{
+    {
+        std::lock_guard<std::mutex> lock(_mutex);
+        if (_closed || _closing) {
+            return;
+        }
+        _closing = true;
+    }
+#ifdef HAVE_SYS_EPOLL_H
+    if (_worker && processing != this) {
+        _worker->wake(_fd);
+    }
+#endif
+}
+
+} // end of gnash namespace
+
+// local Variables:
+// mode: C++
+// indent-tabs-mode: nil
+// End:
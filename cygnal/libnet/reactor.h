@@ -0,0 +1,282 @@
+//
+//   Copyright (C) 2005, 2006, 2007, 2008, 2009, 2010, 2011, 2012
+//   Free Software Foundation, Inc
+//
+// This program is free software; you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation; either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program; if not, write to the Free Software
+// Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+
+#ifndef __REACTOR_H__
+#define __REACTOR_H__
+
+#ifdef HAVE_CONFIG_H
+#include "gnashconfig.h"
+#endif
+
+#include <atomic>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <vector>
+#include <boost/noncopyable.hpp>
+#include <sys/types.h>
+
+#include "dsodefs.h" //For DSOEXPORT.
+
+/// \namespace gnash
+///	This is the main namespace for Gnash and it's libraries.
+namespace gnash {
+
+/// \class Reactor
+///	An event loop for many non-blocking network connections. A
+///	fixed pool of worker threads each waits on its own set of
+///	connections with edge-triggered epoll, so idle connections
+///	cost no threads and no work. Each connection is a state
+///	machine that is given its input as it arrives, and queues its
+///	output to be written when the socket can take it. This is only
+///	available where HAVE_SYS_EPOLL_H is defined.
+class DSOEXPORT Reactor : boost::noncopyable {
+public:
+    struct Worker;
+
+    /// \class Reactor::Connection
+    ///	One non-blocking network connection driven by a Reactor.
+    ///	All the process methods are called by the worker owning the
+    ///	connection, so they never run at the same time. write() and
+    ///	close() may be called from any thread, by those holding a
+    ///	pointer from shared_from_this().
+    class DSOEXPORT Connection
+        : public std::enable_shared_from_this<Connection>,
+          boost::noncopyable {
+    public:
+        Connection(int fd);
+        virtual ~Connection();
+
+        /// \brief Process the input read so far.
+        ///	Complete messages are taken with consume(), partial
+        ///	ones are left for the next call.
+        ///
+        /// @return False to close the connection now.
+        virtual bool processInput() = 0;
+
+        /// \brief Produce more output.
+        ///	This is called when all queued output has been written,
+        ///	so long replies can be sent a part at a time.
+        ///
+        /// @return False to close the connection now.
+        virtual bool processOutput() { return true; };
+
+        /// \brief The connection has been closed.
+        virtual void processClose() { };
+
+        /// \brief The input not consumed yet.
+        const std::uint8_t *input() const
+            { return &_input[_consumed]; };
+        size_t bytesReady() const { return _input.size() - _consumed; };
+
+        /// \brief The size of the input buffer, including input
+        ///	already consumed but not dropped yet.
+        size_t bytesBuffered() const { return _input.size(); };
+
+        /// \brief Drop input that has been processed.
+        void consume(size_t nbytes);
+
+        /// \brief Copy and consume up to nbytes of input.
+        ///
+        /// @return The number of bytes copied, 0 if there is no input.
+        int read(std::uint8_t *data, size_t nbytes);
+
+        /// \brief Queue a copy of data to be written.
+        void write(const std::uint8_t *data, size_t nbytes);
+
+        /// \brief Queue data to be written without copying it.
+        ///
+        /// @param owner Keeps the data alive until it is written.
+        ///
+        /// @param chunk When not 0, the data is split into chunks of
+        ///	this size, each after the first sent after the header
+        ///	byte, which is how RTMP frames the body of a message.
+        void write(std::shared_ptr<const void> owner,
+                   const std::uint8_t *data, size_t nbytes,
+                   size_t chunk = 0, std::uint8_t header = 0);
+
+        /// \brief Queue a copy of a header followed by data written
+        ///	without copying it. Both are queued at once, so nothing
+        ///	written by another thread can come between them.
+        void write(const std::uint8_t *head, size_t headbytes,
+                   std::shared_ptr<const void> owner,
+                   const std::uint8_t *data, size_t nbytes,
+                   size_t chunk = 0, std::uint8_t header = 0);
+
+        /// \brief Queue part of a file to be sent by the kernel with
+        ///	sendfile(), so its data never enters this process.
+        ///
+        /// @param owner Keeps the file descriptor open until the
+        ///	data is sent.
+        void sendFile(std::shared_ptr<const void> owner, int filefd,
+                      off_t offset, size_t nbytes);
+
+        /// \brief Close the connection once the queued output is
+        ///	written.
+        void close();
+
+        /// \brief The number of bytes queued to be written.
+        size_t bytesQueued() const;
+
+        int getFileFd() const { return _fd; };
+
+        /// \brief The connection the calling thread is processing.
+        ///	Network uses this to read and write through the
+        ///	connection when its handlers use the blocking calls.
+        ///
+        /// @return The connection, or 0 outside of the process
+        ///	methods.
+        static Connection *current();
+
+        /// \brief The connection of a socket driven by any Reactor.
+        ///	Output for another connection than the current one has
+        ///	to be queued through this, as its socket is written by
+        ///	its own worker.
+        ///
+        /// @return The connection, or an empty pointer if the socket
+        ///	isn't driven by a Reactor.
+        static std::shared_ptr<Connection> find(int fd);
+
+    private:
+        friend class Reactor;
+        friend struct Reactor::Worker;
+
+        const int _fd;
+
+        /// \var Connection::_input
+        ///	The data read, of which the first _consumed bytes have
+        ///	been processed. The processed bytes are dropped before
+        ///	more is read, once they are no fewer than the rest.
+        ///	Only used by the worker.
+        std::vector<std::uint8_t> _input;
+        size_t _consumed;
+
+        /// \struct Connection::Output
+        ///	One piece of queued output, either memory or part of a
+        ///	file.
+        struct Output {
+            /// The data, when it is a copy.
+            std::vector<std::uint8_t> copy;
+            std::shared_ptr<const void> owner;
+            const std::uint8_t *data;
+            size_t size;
+            size_t chunk;
+            std::uint8_t header;
+            /// The file to send from, or -1 for memory.
+            int file;
+            off_t offset;
+
+            /// The number of bytes sent, with the chunk headers.
+            size_t length() const {
+                return (chunk && size) ? size + (size - 1) / chunk : size;
+            };
+        };
+
+        /// Add output, and wake the worker if this isn't it. All
+        /// count pieces are added together.
+        void queue(Output *out, size_t count = 1);
+
+        /// \var Connection::_output
+        ///	The data waiting to be written, the first _written
+        ///	bytes of the first piece having been sent.
+        std::deque<Output> _output;
+        size_t _written;
+        size_t _queued;
+        bool _closing;
+        bool _closed;
+
+        /// \var Connection::_worker
+        ///	The worker owning this connection, woken when another
+        ///	thread writes.
+        Worker *_worker;
+        mutable std::mutex _mutex;
+    };
+
+    /// \brief Makes a connection for a newly accepted socket.
+    ///
+    /// @return The connection, or an empty pointer to refuse it.
+    typedef std::function<std::shared_ptr<Connection> (int fd)> factory_t;
+
+    /// \brief Create a reactor.
+    ///
+    /// @param workers The number of worker threads, or 0 for one for
+    ///		each cpu.
+    Reactor(size_t workers);
+    ~Reactor();
+
+    /// \brief Accept connections from a listening socket.
+    ///	The socket is made non-blocking, and each new connection
+    ///	is given to the next worker in turn.
+    ///
+    /// @param fd The listening socket.
+    ///
+    /// @param factory Makes the connection for each new socket.
+    ///
+    /// @return True if the socket is being watched.
+    bool addListener(int fd, factory_t factory);
+
+    /// \brief Drive an already connected socket.
+    ///
+    /// @return True if the connection was added.
+    bool addConnection(std::shared_ptr<Connection> conn);
+
+    /// \brief Start the worker threads.
+    void start();
+
+    /// \brief Stop the worker threads and close all connections.
+    void stop();
+
+    /// \brief The number of workers.
+    size_t workers() const { return _workers.size(); };
+
+    /// \brief The number of open connections.
+    size_t connections() const;
+
+private:
+    /// Accept all pending connections on a listening socket.
+    void accept(int fd);
+
+    /// Find the factory for a listening socket.
+    factory_t findListener(int fd);
+
+    std::vector<std::unique_ptr<Worker> > _workers;
+
+    /// \var Reactor::_listeners
+    ///	The factories of each listening socket, which all are
+    ///	watched by the first worker.
+    std::map<int, factory_t> _listeners;
+    std::mutex _listener_mutex;
+
+    /// \var Reactor::_next
+    ///	The worker given the next accepted connection.
+    std::atomic<size_t> _next;
+    bool _running;
+};
+
+} // end of gnash namespace
+
+// __REACTOR_H__
+#endif
+
+// Local Variables:
+// mode: C++
+// indent-tabs-mode: nil
+// End:
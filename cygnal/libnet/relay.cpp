@@ -0,0 +1,351 @@
+// relay.cpp:  Relay live RTMP streams to many subscribers, for Gnash.
+//
+//   Copyright (C) 2005, 2006, 2007, 2008, 2009, 2010, 2011, 2012
+//   Free Software Foundation, Inc
+//
+// This program is free software; you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation; either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program; if not, write to the Free Software
+// Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+
+#ifdef HAVE_CONFIG_H
+#include "gnashconfig.h"
+#endif
+
+#include <algorithm>
+#include <cstring>
+
+#include "log.h"
+#include "cque.h"
+#include "relay.h"
+
+namespace gnash {
+
+namespace {
+
+// The first byte of an FLV video tag has the frame type in the top
+// four bits, and the codec in the bottom four. The first byte of an
+// audio tag has the sound format in the top four bits.
+const int FRAME_KEY = 1;
+const int CODEC_AVC = 7;
+const int SOUND_AAC = 10;
+
+// Data messages start with their name, as an AMF0 string.
+const std::uint8_t AMF0_STRING = 0x02;
+const char METADATA[] = "onMetaData";
+const char SETDATAFRAME[] = "@setDataFrame";
+
+// The size of the AMF0 string at data, when it is the name given.
+size_t
+amfName(const std::uint8_t *data, size_t size, const char *name)
+{
+    const size_t length = std::strlen(name);
+    if ((size < length + 3) || (data[0] != AMF0_STRING)
+        || (((data[1] << 8) | data[2]) != static_cast<int>(length))) {
+        return 0;
+    }
+    return std::memcmp(data + 3, name, length) ? 0 : length + 3;
+}
+
+bool
+isKeyframe(const std::uint8_t *data, size_t size)
+{
+    return size && ((data[0] >> 4) == FRAME_KEY);
+}
+
+// AVC and AAC have a sequence header the decoder needs, as the
+// first message of the stream.
+bool
+isVideoConfig(const std::uint8_t *data, size_t size)
+{
+    return (size > 1) && ((data[0] & 0xf) == CODEC_AVC) && (data[1] == 0);
+}
+
+bool
+isAudioConfig(const std::uint8_t *data, size_t size)
+{
+    return (size > 1) && ((data[0] >> 4) == SOUND_AAC) && (data[1] == 0);
+}
+
+} // anonymous namespace
+
+const size_t Relay::CHUNK_SIZE;
+const size_t Relay::QUEUE_LIMIT;
+const int Relay::DATA_CHANNEL;
+const int Relay::VIDEO_CHANNEL;
+const int Relay::AUDIO_CHANNEL;
+
+Relay::Relay(size_t limit)
+    : _limit(limit),
+      _sent(0),
+      _dropped(0)
+{
+//    GNASH_REPORT_FUNCTION;
+}
+
+Relay::~Relay()
+{
+//    GNASH_REPORT_FUNCTION;
+}
+
+Relay &
+Relay::getDefaultInstance()
+{
+    static Relay relay;
+    return relay;
+}
+
+bool
+Relay::addPublisher(const std::string &name)
+{
+    std::lock_guard<std::mutex> lock(_mutex);
+    std::shared_ptr<Stream> &stream = _streams[name];
+    if (stream) {
+        log_error(_("Stream \"%s\" is already being published"), name);
+        return false;
+    }
+    stream.reset(new Stream);
+    log_network(_("Relaying stream \"%s\""), name);
+    return true;
+}
+
+void
+Relay::removePublisher(const std::string &name)
+{
+    std::lock_guard<std::mutex> lock(_mutex);
+    _streams.erase(name);
+}
+
+bool
+Relay::isPublished(const std::string &name) const
+{
+    return findStream(name) != nullptr;
+}
+
+bool
+Relay::subscribe(const std::string &name,
+                 std::shared_ptr<Reactor::Connection> conn,
+                 std::uint32_t streamid)
+{
+    std::shared_ptr<Stream> stream = findStream(name);
+    if (!stream || !conn) {
+        return false;
+    }
+
+    std::lock_guard<std::mutex> lock(stream->mutex);
+    Subscriber sub;
+    sub.conn = conn;
+    sub.id = conn.get();
+    sub.streamid = streamid;
+    sub.waitkey = true;
+    stream->subscribers.push_back(sub);
+
+    if (stream->metadata) {
+        send(*conn, streamid, stream->metadata);
+    }
+    if (stream->videoconfig) {
+        send(*conn, streamid, stream->videoconfig);
+    }
+    if (stream->audioconfig) {
+        send(*conn, streamid, stream->audioconfig);
+    }
+    return true;
+}
+
+void
+Relay::unsubscribe(const Reactor::Connection *conn)
+{
+    std::vector<std::shared_ptr<Stream> > streams;
+    {
+        std::lock_guard<std::mutex> lock(_mutex);
+        std::map<std::string, std::shared_ptr<Stream> >::iterator it;
+        for (it = _streams.begin(); it != _streams.end(); ++it) {
+            streams.push_back(it->second);
+        }
+    }
+    for (size_t i = 0; i < streams.size(); ++i) {
+        std::lock_guard<std::mutex> lock(streams[i]->mutex);
+        std::vector<Subscriber> &subs = streams[i]->subscribers;
+        subs.erase(std::remove_if(subs.begin(), subs.end(),
+                                  [conn](const Subscriber &sub) {
+                                      return sub.id == conn;
+                                  }),
+                   subs.end());
+    }
+}
+
+size_t
+Relay::publish(const std::string &name, RTMP::content_types_e type,
+               std::uint32_t timestamp, const std::uint8_t *data,
+               size_t size)
+{
+    if ((type != RTMP::AUDIO_DATA) && (type != RTMP::VIDEO_DATA)
+        && (type != RTMP::NOTIFY)) {
+        return 0;
+    }
+    std::shared_ptr<Stream> stream = findStream(name);
+    if (!stream) {
+        return 0;
+    }
+
+    // Encoders publish the metadata with @setDataFrame, which is
+    // for the server. Players are sent only the onMetaData.
+    bool metadata = false;
+    if (type == RTMP::NOTIFY) {
+        const size_t skip = amfName(data, size, SETDATAFRAME);
+        metadata = amfName(data + skip, size - skip, METADATA) != 0;
+        if (metadata) {
+            data += skip;
+            size -= skip;
+        }
+    }
+
+    // Chunked once, for everyone.
+    std::shared_ptr<Message> msg = chunk(type, timestamp, data, size);
+    const bool video = (type == RTMP::VIDEO_DATA);
+    const bool keyframe = video && isKeyframe(data, size);
+
+    // Headers are never dropped, and are kept for those who
+    // subscribe later.
+    bool config = false;
+    std::lock_guard<std::mutex> lock(stream->mutex);
+    if (metadata) {
+        stream->metadata = msg;
+        config = true;
+    } else if (video && isVideoConfig(data, size)) {
+        stream->videoconfig = msg;
+        config = true;
+    } else if (!video && isAudioConfig(data, size)) {
+        stream->audioconfig = msg;
+        config = true;
+    }
+
+    size_t count = 0;
+    std::vector<Subscriber> &subs = stream->subscribers;
+    for (size_t i = 0; i < subs.size(); ) {
+        std::shared_ptr<Reactor::Connection> conn = subs[i].conn.lock();
+        if (!conn) {
+            subs[i] = subs.back();
+            subs.pop_back();
+            continue;
+        }
+        Subscriber &sub = subs[i++];
+        if (!config) {
+            const bool behind = conn->bytesQueued() > _limit;
+            if (video) {
+                if (behind || (sub.waitkey && !keyframe)) {
+                    sub.waitkey = true;
+                    ++_dropped;
+                    continue;
+                }
+                sub.waitkey = false;
+            } else if (behind) {
+                ++_dropped;
+                continue;
+            }
+        }
+        send(*conn, sub.streamid, msg);
+        ++count;
+    }
+    _sent += count;
+
+    return count;
+}
+
+size_t
+Relay::subscribers(const std::string &name) const
+{
+    std::shared_ptr<Stream> stream = findStream(name);
+    if (!stream) {
+        return 0;
+    }
+    std::lock_guard<std::mutex> lock(stream->mutex);
+    return stream->subscribers.size();
+}
+
+std::shared_ptr<Relay::Stream>
+Relay::findStream(const std::string &name) const
+{
+    std::lock_guard<std::mutex> lock(_mutex);
+    std::map<std::string, std::shared_ptr<Stream> >::const_iterator it
+        = _streams.find(name);
+    if (it == _streams.end()) {
+        return std::shared_ptr<Stream>();
+    }
+    return it->second;
+}
+
+std::shared_ptr<Relay::Message>
+Relay::chunk(RTMP::content_types_e type, std::uint32_t timestamp,
+             const std::uint8_t *data, size_t size)
+{
+    std::shared_ptr<Message> msg(new Message);
+    msg->size = size;
+    msg->timestamp = timestamp;
+    msg->type = type;
+    if (type == RTMP::AUDIO_DATA) {
+        msg->channel = AUDIO_CHANNEL;
+    } else if (type == RTMP::VIDEO_DATA) {
+        msg->channel = VIDEO_CHANNEL;
+    } else {
+        msg->channel = DATA_CHANNEL;
+    }
+
+    // Every chunk after the first follows a one byte header.
+    msg->length = size ? size + (size - 1) / CHUNK_SIZE : 0;
+    msg->chunks = BufferPool::getDefaultInstance().get(msg->length);
+    std::uint8_t *ptr = msg->chunks->reference();
+    for (size_t i = 0; i < size; i += CHUNK_SIZE) {
+        if (i) {
+            *ptr++ = RTMP::HEADER_1 | msg->channel;
+        }
+        const size_t partial = std::min(CHUNK_SIZE, size - i);
+        std::copy(data + i, data + i + partial, ptr);
+        ptr += partial;
+    }
+
+    return msg;
+}
+
+void
+Relay::send(Reactor::Connection &conn, std::uint32_t streamid,
+            const std::shared_ptr<Message> &msg)
+{
+    // RTMP::encodeHeader() leaves the timestamp zero, which players
+    // need for audio and video, so the 12 byte header is made here.
+    // Only the stream ID, which is little-endian, differs between
+    // subscribers.
+    std::uint8_t head[RTMP_MAX_HEADER_SIZE];
+    head[0] = RTMP::HEADER_12 | msg->channel;
+    const std::uint32_t timestamp = std::min<std::uint32_t>(msg->timestamp,
+                                                            0xffffff);
+    head[1] = (timestamp >> 16) & 0xff;
+    head[2] = (timestamp >> 8) & 0xff;
+    head[3] = timestamp & 0xff;
+    head[4] = (msg->size >> 16) & 0xff;
+    head[5] = (msg->size >> 8) & 0xff;
+    head[6] = msg->size & 0xff;
+    head[7] = msg->type;
+    std::memcpy(head + 8, &streamid, sizeof(std::uint32_t));
+
+    // Both are queued at once, as the subscriber's own worker may be
+    // writing to it too.
+    conn.write(head, sizeof(head), msg->chunks, msg->chunks->reference(),
+               msg->length);
+}
+
+} // end of gnash namespace
+
+// Local Variables:
+// mode: C++
+// indent-tabs-mode: nil
+// End:
@@ -0,0 +1,191 @@
+//
+//   Copyright (C) 2005, 2006, 2007, 2008, 2009, 2010, 2011, 2012
+//   Free Software Foundation, Inc
+//
+// This program is free software; you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation; either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program; if not, write to the Free Software
+// Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+
+#ifndef __RELAY_H__
+#define __RELAY_H__
+
+#ifdef HAVE_CONFIG_H
+#include "gnashconfig.h"
+#endif
+
+#include <atomic>
+#include <cstdint>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+#include <boost/noncopyable.hpp>
+
+#include "buffer.h"
+#include "reactor.h"
+#include "rtmp.h"
+#include "dsodefs.h" //For DSOEXPORT.
+
+/// \namespace gnash
+///	This is the main namespace for Gnash and it's libraries.
+namespace gnash {
+
+/// \class Relay
+///	Relays live RTMP streams from the client publishing each one to
+///	all the clients playing it. Each message is chunked once, into
+///	a buffer all the subscribers share, so sending it to another
+///	subscriber only costs the 12 byte header giving its own stream
+///	ID. Subscribers whose connections can't keep up have frames
+///	dropped, and after a video frame is dropped get no more video
+///	until the next keyframe, so they never see a broken picture.
+class DSOEXPORT Relay : boost::noncopyable {
+public:
+    /// The chunk size relayed messages are split at, which the
+    /// subscribers have to be told with a Set Chunk Size message.
+    static const size_t CHUNK_SIZE = 4096;
+
+    /// The bytes a subscriber may have waiting to be written before
+    /// frames are dropped.
+    static const size_t QUEUE_LIMIT = 256 * 1024;
+
+    /// The channels the messages are relayed on. As every subscriber
+    /// gets the same chunks, these are the same for all of them.
+    static const int DATA_CHANNEL = 4;
+    static const int VIDEO_CHANNEL = 5;
+    static const int AUDIO_CHANNEL = 6;
+
+    /// \brief Create a relay.
+    ///
+    /// @param limit The bytes a subscriber may have queued before
+    ///		frames are dropped.
+    Relay(size_t limit = QUEUE_LIMIT);
+    ~Relay();
+
+    /// \brief The relay cygnal uses for all its RTMP connections.
+    static Relay &getDefaultInstance();
+
+    /// \brief Start relaying a stream.
+    ///
+    /// @return False if the stream is already being published.
+    bool addPublisher(const std::string &name);
+
+    /// \brief Stop relaying a stream, and drop its subscribers.
+    void removePublisher(const std::string &name);
+
+    /// \brief Whether a stream is being published.
+    bool isPublished(const std::string &name) const;
+
+    /// \brief Add a subscriber to a published stream.
+    ///	The subscriber is first sent the metadata and the codec
+    ///	headers of the stream, then its audio, and its video from
+    ///	the next keyframe.
+    ///
+    /// @param conn The connection of the subscriber, which isn't
+    ///		kept alive by the relay.
+    ///
+    /// @param streamid The stream ID the subscriber plays, as it was
+    ///		in the header of its play() Invoke.
+    ///
+    /// @return False if the stream isn't being published.
+    bool subscribe(const std::string &name,
+                   std::shared_ptr<Reactor::Connection> conn,
+                   std::uint32_t streamid);
+
+    /// \brief Remove a connection from all the streams it plays.
+    void unsubscribe(const Reactor::Connection *conn);
+
+    /// \brief Relay a message to the subscribers of a stream.
+    ///
+    /// @param type AUDIO_DATA, VIDEO_DATA or NOTIFY. Others are
+    ///		ignored.
+    ///
+    /// @param timestamp The absolute timestamp of the message.
+    ///
+    /// @param data The body of the message, which is copied.
+    ///
+    /// @return The number of subscribers it was sent to.
+    size_t publish(const std::string &name, RTMP::content_types_e type,
+                   std::uint32_t timestamp, const std::uint8_t *data,
+                   size_t size);
+
+    /// \brief The number of subscribers of a stream.
+    size_t subscribers(const std::string &name) const;
+
+    /// \brief The messages sent to subscribers, and dropped for them.
+    size_t sent() const { return _sent; };
+    size_t dropped() const { return _dropped; };
+
+private:
+    /// \struct Relay::Message
+    ///	A message chunked for sending, with continuation headers
+    ///	between the chunks. The first header is per subscriber.
+    struct Message {
+        std::shared_ptr<cygnal::Buffer> chunks;
+        size_t size;
+        size_t length;
+        std::uint32_t timestamp;
+        RTMP::content_types_e type;
+        int channel;
+    };
+
+    /// \struct Relay::Subscriber
+    struct Subscriber {
+        std::weak_ptr<Reactor::Connection> conn;
+        const Reactor::Connection *id;
+        std::uint32_t streamid;
+        /// Video was dropped, or none has been sent yet, so no more
+        /// is sent until a keyframe.
+        bool waitkey;
+    };
+
+    /// \struct Relay::Stream
+    struct Stream {
+        std::vector<Subscriber> subscribers;
+        /// The last onMetaData, and the AVC and AAC sequence headers,
+        /// which players need before any frames.
+        std::shared_ptr<Message> metadata;
+        std::shared_ptr<Message> videoconfig;
+        std::shared_ptr<Message> audioconfig;
+        std::mutex mutex;
+    };
+
+    std::shared_ptr<Stream> findStream(const std::string &name) const;
+
+    /// Chunk a message body.
+    std::shared_ptr<Message> chunk(RTMP::content_types_e type,
+                                   std::uint32_t timestamp,
+                                   const std::uint8_t *data, size_t size);
+
+    /// Queue a message for a subscriber, with its own header.
+    void send(Reactor::Connection &conn, std::uint32_t streamid,
+              const std::shared_ptr<Message> &msg);
+
+    const size_t _limit;
+
+    std::map<std::string, std::shared_ptr<Stream> > _streams;
+    mutable std::mutex _mutex;
+
+    std::atomic<size_t> _sent;
+    std::atomic<size_t> _dropped;
+};
+
+} // end of gnash namespace
+
+// __RELAY_H__
+#endif
+
+// Local Variables:
+// mode: C++
+// indent-tabs-mode: nil
+// End:
@@ -0,0 +1,168 @@
+//
+//   Copyright (C) 2008, 2009, 2010, 2011, 2012 Free Software Foundation, Inc.
+//
+// This program is free software; you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation; either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program; if not, write to the Free Software
+// Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+//
+
+#ifndef __RING_H__
+#define __RING_H__
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <utility>
+#include <boost/noncopyable.hpp>
+
+namespace gnash
+{
+
+/// \class Ring
+///	A bounded queue that any number of threads may push to and pop
+///	from without locking. Each slot has a sequence number that says
+///	whether it is free for the push of a given lap around the ring,
+///	or holds the value for the pop of that lap, so threads only
+///	contend on the head or the tail index they claim with a
+///	compare-and-swap.
+template <typename T>
+class Ring : boost::noncopyable {
+public:
+    /// \brief Create a ring.
+    ///
+    /// @param capacity The number of values held, rounded up to a
+    ///		power of two.
+    explicit Ring(size_t capacity)
+    {
+	size_t size = 2;
+	while (size < capacity) {
+	    size <<= 1;
+	}
+	_mask = size - 1;
+	_slots.reset(new Slot[size]);
+	for (size_t i = 0; i < size; ++i) {
+	    _slots[i].seq.store(i, std::memory_order_relaxed);
+	}
+	_head.store(0, std::memory_order_relaxed);
+	_tail.store(0, std::memory_order_relaxed);
+    }
+
+    /// \brief Add a value at the end.
+    ///
+    /// @return False if the ring is full, leaving the value as it was.
+    bool push(T &&value) {
+	size_t pos;
+	Slot *slot = claim(_head, 0, pos);
+	if (!slot) {
+	    return false;
+	}
+	slot->value = std::move(value);
+	slot->seq.store(pos + 1, std::memory_order_release);
+	return true;
+    }
+    bool push(const T &value) {
+	T copy(value);
+	return push(std::move(copy));
+    }
+
+    /// \brief Take the value at the front.
+    ///
+    /// @return False if the ring is empty.
+    bool pop(T &value) {
+	size_t pos;
+	Slot *slot = claim(_tail, 1, pos);
+	if (!slot) {
+	    return false;
+	}
+	value = std::move(slot->value);
+	// Let go of what the value holds now, not a lap later.
+	slot->value = T();
+	slot->seq.store(pos + _mask + 1, std::memory_order_release);
+	return true;
+    }
+
+    /// \brief The value at the front, without taking it.
+    ///	This is only safe in the thread that pops, while no other
+    ///	thread pops.
+    ///
+    /// @return The value, or 0 if the ring is empty.
+    T *front() {
+	const size_t pos = _tail.load(std::memory_order_acquire);
+	Slot &slot = _slots[pos & _mask];
+	if (slot.seq.load(std::memory_order_acquire) == pos + 1) {
+	    return &slot.value;
+	}
+	return 0;
+    }
+
+    /// \brief The number of values held, which may have changed by
+    ///	the time it is returned.
+    size_t size() const {
+	const size_t tail = _tail.load(std::memory_order_acquire);
+	const size_t head = _head.load(std::memory_order_acquire);
+	return (head > tail) ? head - tail : 0;
+    }
+    bool empty() const { return size() == 0; };
+    size_t capacity() const { return _mask + 1; };
+
+private:
+    struct Slot {
+	std::atomic<size_t> seq;
+	T value;
+    };
+
+    /// Claim the slot at an index, which is ready when its sequence
+    /// is the index plus ready.
+    Slot *claim(std::atomic<size_t> &index, size_t ready, size_t &pos) {
+	pos = index.load(std::memory_order_relaxed);
+	while (true) {
+	    Slot &slot = _slots[pos & _mask];
+	    const size_t seq = slot.seq.load(std::memory_order_acquire);
+	    const std::ptrdiff_t diff = static_cast<std::ptrdiff_t>(seq)
+		- static_cast<std::ptrdiff_t>(pos + ready);
+	    if (diff == 0) {
+		if (index.compare_exchange_weak(pos, pos + 1,
+						std::memory_order_relaxed)) {
+		    return &slot;
+		}
+	    } else if (diff < 0) {
+		// Full when pushing, empty when popping.
+		return 0;
+	    } else {
+		// Another thread got this slot first.
+		pos = index.load(std::memory_order_relaxed);
+	    }
+	}
+    }
+
+    std::unique_ptr<Slot[]> _slots;
+    size_t _mask;
+
+    // The head and tail are on their own cache lines, so pushing and
+    // popping threads don't slow each other down.
+    char _pad0[64];
+    std::atomic<size_t> _head;
+    char _pad1[64 - sizeof(std::atomic<size_t>)];
+    std::atomic<size_t> _tail;
+    char _pad2[64 - sizeof(std::atomic<size_t>)];
+};
+
+} // end of gnash namespace
+
+#endif // end of __RING_H__
+
+// local Variables:
+// mode: C++
+// indent-tabs-mode: t
+// End:
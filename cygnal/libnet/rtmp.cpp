@@ -22,11 +22,13 @@
 #include "gnashconfig.h"
 #endif
 
+#include <algorithm>
 #include <iostream>
 #include <string>
 #include <map>
 #include <vector>
 #include <cerrno>
+#include <cstring>
 #include <boost/detail/endian.hpp>
 #include <boost/format.hpp>
 
@@ -36,12 +38,15 @@
 
 #include "log.h"
 #include "amf.h"
+#include "AMFCodec.h"
 #include "rtmp.h"
 #include "cque.h"
 #include "network.h"
 #include "element.h"
 #include "utility.h"
 #include "buffer.h"
+#include "cache.h"
+#include "reactor.h"
 #include "GnashSleep.h"
 
 using std::cerr;
@@ -192,7 +197,8 @@ RTMP::RTMP()
     : _handshake(nullptr),
       _packet_size(0),
       _mystery_word(0),
-      _timeout(1)
+      _timeout(1),
+      _inchunksize(RTMP_VIDEO_PACKET_SIZE)
 {
 //    GNASH_REPORT_FUNCTION;
 
@@ -211,6 +217,8 @@ RTMP::RTMP()
 	_lastsize[i] = 0;
 	_bodysize[i] = 0;
 	_type[i] = RTMP::NONE;
+	_inchannels[i].received = 0;
+	_inchannels[i].mystery_word = 0;
     }
 }
 
@@ -264,32 +272,39 @@ RTMP::decodeHeader(std::uint8_t *in)
 {
     // GNASH_REPORT_FUNCTION;
 
-    std::shared_ptr<RTMP::rtmp_head_t> head(new RTMP::rtmp_head_t);
-    std::uint8_t *tmpptr = in;
+    std::shared_ptr<RTMP::rtmp_head_t> head(new RTMP::rtmp_head_t());
+    if (!decodeHeader(in, *head)) {
+	head.reset();
+    }
 
-    head->channel = *tmpptr & RTMP_INDEX_MASK;
-    // log_network (_("The AMF channel index is %d"), head->channel);
-    
-    head->head_size = headerSize(*tmpptr++);
-    // log_network (_("The header size is %d"), head->head_size);
+    return head;
+}
+
+bool
+RTMP::decodeHeader(const std::uint8_t *in, rtmp_head_t &head)
+{
+    // GNASH_REPORT_FUNCTION;
 
-    // cerr << "FIXME(" << __FUNCTION__ << "): " << hexify(in,
-    // 				head->head_size, false) << endl;
+    const std::uint8_t *tmpptr = in;
+
+    head.channel = *tmpptr & RTMP_INDEX_MASK;
+    // log_network (_("The AMF channel index is %d"), head.channel);
+    
+    head.head_size = headerSize(*tmpptr++);
+    // log_network (_("The header size is %d"), head.head_size);
 
     // Make sure the header size is in range, it has to be between
     // 1-12 bytes.
-    if (head->head_size > RTMP_MAX_HEADER_SIZE) {
+    if (head.head_size > RTMP_MAX_HEADER_SIZE) {
 	log_error(_("RTMP Header size can't be more then %d bytes!!"),
 		  RTMP_MAX_HEADER_SIZE);
-	head.reset();
-	return head;
-    } else if (head->head_size == 0) {
+	return false;
+    } else if (head.head_size == 0) {
 	log_error(_("RTMP Header size can't be zero!"));
-	head.reset();
-	return head;
+	return false;
     }
     
-    if (head->head_size >= 4) {
+    if (head.head_size >= 4) {
         _mystery_word = *tmpptr++;
         _mystery_word = (_mystery_word << 8) + *tmpptr++;
         _mystery_word = (_mystery_word << 8) + *tmpptr++;
@@ -298,71 +313,74 @@ RTMP::decodeHeader(std::uint8_t *in)
 	_mystery_word = 0;
     }
 
-    if (head->head_size >= 8) {
-        head->bodysize = *tmpptr++;
-        head->bodysize = (head->bodysize << 8) + *tmpptr++;
-        head->bodysize = (head->bodysize << 8) + *tmpptr++;
-        head->bodysize = head->bodysize & 0xffffff;
-	_bodysize[head->channel] = head->bodysize;
- 	log_network(_("The body size is: %d"), head->bodysize);
+    if (head.head_size >= 8) {
+        head.bodysize = *tmpptr++;
+        head.bodysize = (head.bodysize << 8) + *tmpptr++;
+        head.bodysize = (head.bodysize << 8) + *tmpptr++;
+        head.bodysize = head.bodysize & 0xffffff;
+	_bodysize[head.channel] = head.bodysize;
+ 	IF_VERBOSE_NETWORK(log_network(_("The body size is: %d"), head.bodysize));
     } else {
 	// If the body size is zero, we reuse the last body size field
 	// from the previous message, 1 and 4 bytes headers all
 	// reuse the previous body size.
-	head->bodysize = _bodysize[head->channel];
-	if (head->bodysize) {
-	    log_network(_("Using previous body size of %d for channel %d"),
-			head->bodysize, head->channel);
+	head.bodysize = _bodysize[head.channel];
+	if (head.bodysize) {
+	    IF_VERBOSE_NETWORK(
+		log_network(_("Using previous body size of %d for channel %d"),
+			    head.bodysize, head.channel));
 	} else {
 	    log_error(_("Previous body size for channel %d is zero!"),
-			head->channel);
-	    head.reset();
-	    return head;
+			head.channel);
+	    return false;
 	}
     }
 
     // the bodysize is limited to two bytes, so if we think we have
     // more than that, something probably screwed up.
-    if (head->bodysize > 65535) {
+    if (head.bodysize > 65535) {
 	log_error(_("Suspicious large RTMP packet body size! %d"),
-		  head->bodysize);
-	head.reset();
-	return head;
+		  head.bodysize);
+	return false;
     }
 
-    if (head->head_size >= 8) {
+    if (head.head_size >= 8) {
 	std::uint8_t byte = *tmpptr;
-        head->type = (content_types_e)byte;
-	_type[head->channel] = head->type;
+        head.type = (content_types_e)byte;
+	_type[head.channel] = head.type;
         tmpptr++;
 #if 0
-	if (head->type <= RTMP::INVOKE ) {
-	    log_network(_("The type is: %s"), content_str[head->type]);
+	if (head.type <= RTMP::INVOKE ) {
+	    log_network(_("The type is: %s"), content_str[head.type]);
 	} else {
-	    log_network(_("The type is: 0x%x"), head->type);
+	    log_network(_("The type is: 0x%x"), head.type);
 	}
 #endif
     } else {
-	if (_type[head->channel] <= RTMP::FLV_DATA) {
-	    log_network(_("Using previous type of %d for channel %d"),
-			head->type, head->channel);
-	    head->type = _type[head->channel];
+	if (_type[head.channel] <= RTMP::FLV_DATA) {
+	    head.type = _type[head.channel];
+	    IF_VERBOSE_NETWORK(
+		log_network(_("Using previous type of %d for channel %d"),
+			    head.type, head.channel));
 	}
     }
 
-    if (head->head_size == 12) {
-        head->src_dest = *(reinterpret_cast<RTMPMsg::rtmp_source_e *>(tmpptr));
-        tmpptr += sizeof(unsigned int);
-//         log_network(_("The source/destination is: %x"), head->src_dest);
+    if (head.head_size == 12) {
+	std::memcpy(&head.src_dest, tmpptr, sizeof(std::uint32_t));
+        tmpptr += sizeof(std::uint32_t);
+//         log_network(_("The source/destination is: %x"), head.src_dest);
     }
 
-    log_network(_("RTMP %s: channel: %d, head size %d, body size: %d"),
-  	      ((head->head_size == 1) ? "same" : content_str[head->type]),
-	      head->channel,
-	      head->head_size,
-	      head->bodysize);
+    // These are only formatted when they're shown, as this is called
+    // for every chunk.
+    IF_VERBOSE_NETWORK(
+	log_network(_("RTMP %s: channel: %d, head size %d, body size: %d"),
+		    ((head.head_size == 1) ? "same" : content_str[head.type]),
+		    head.channel,
+		    head.head_size,
+		    head.bodysize));
 
-    return head;
+    return true;
 }
 
 /// \brief \ Each RTMP header consists of the following:
@@ -379,15 +397,23 @@ RTMP::encodeHeader(int amf_index, rtmp_headersize_e head_size)
 //    GNASH_REPORT_FUNCTION;
     std::shared_ptr<cygnal::Buffer> buf(new cygnal::Buffer(1));
     buf->clear();
-    std::uint8_t *ptr = buf->reference();
-    
-    // Make the channel index & header size byte
-    *ptr = head_size & RTMP_HEADSIZE_MASK;  
-    *ptr += amf_index  & RTMP_INDEX_MASK;
+    encodeHeader(buf->reference(), amf_index, head_size);
 
     return buf;
 }
 
+size_t
+RTMP::encodeHeader(std::uint8_t *out, int amf_index,
+		   rtmp_headersize_e head_size)
+{
+//    GNASH_REPORT_FUNCTION;
+    // Make the channel index & header size byte
+    *out = head_size & RTMP_HEADSIZE_MASK;  
+    *out += amf_index  & RTMP_INDEX_MASK;
+
+    return 1;
+}
+
 // There are 3 size of RTMP headers, 1, 4, 8, and 12.
 std::shared_ptr<cygnal::Buffer>
 RTMP::encodeHeader(int amf_index, rtmp_headersize_e head_size,
@@ -411,7 +437,24 @@ RTMP::encodeHeader(int amf_index, rtmp_headersize_e head_size,
 	  buf.reset(new cygnal::Buffer(12));
 	  break;
     }
-    std::uint8_t *ptr = buf->reference();
+    size_t nbytes = encodeHeader(buf->reference(), amf_index, head_size,
+				 total_size, type, routing);
+    
+    // Manually adjust the seek pointer since we added the data by
+    // walking our own temporary pointer, so none of the regular ways
+    // of setting the seek pointer are appropriate.
+    buf->setSeekPointer(buf->reference() + nbytes);
+    
+    return buf;
+}
+
+size_t
+RTMP::encodeHeader(std::uint8_t *out, int amf_index,
+		   rtmp_headersize_e head_size, size_t total_size,
+		   content_types_e type, RTMPMsg::rtmp_source_e routing)
+{
+//    GNASH_REPORT_FUNCTION;
+    std::uint8_t *ptr = out;
     
     // Make the channel index & header size byte
 //    *ptr = head_size & RTMP_HEADSIZE_MASK;
@@ -437,9 +480,13 @@ RTMP::encodeHeader(int amf_index, rtmp_headersize_e head_size,
 	*ptr = type;
 	ptr++;
 	
-	// Add the routing of the message if the header size is 12, the maximum.
-	if (head_size == HEADER_12 && type != RTMP::USER) {
-	    if (type != RTMP::AUDIO_DATA && type != RTMP::VIDEO_DATA) {
+	// Add the routing of the message if the header size is 12, the
+	// maximum. User Control messages leave it zero.
+	if (head_size == HEADER_12) {
+	    memset(ptr, 0, 4);
+	    if (type == RTMP::USER) {
+		// Nothing to add.
+	    } else if (type != RTMP::AUDIO_DATA && type != RTMP::VIDEO_DATA) {
 		// log_network(_("The routing is: 0x%x"), routing);
 		std::uint32_t swapped = htonl(routing);
 		memcpy(ptr, &swapped, 4);
@@ -454,12 +501,7 @@ RTMP::encodeHeader(int amf_index, rtmp_headersize_e head_size,
 	}
     }
     
-    // Manually adjust the seek pointer since we added the data by
-    // walking our own temporary pointer, so none of the regular ways
-    // of setting the seek pointer are appropriate.
-    buf->setSeekPointer(buf->reference() + buf->size());
-    
-    return buf;
+    return ptr - out;
 }
 
 #if 0
@@ -686,92 +728,112 @@ RTMP::encodeUserControl(user_control_e eventid, std::uint32_t data)
 {
 //    GNASH_REPORT_FUNCTION;
 
-    std::uint32_t swapped = 0;
     std::shared_ptr<cygnal::Buffer> buf;
     if (eventid == STREAM_BUFFER) {
 	buf.reset(new cygnal::Buffer(sizeof(std::uint16_t) * 5));
     } else {
 	buf.reset(new cygnal::Buffer(sizeof(std::uint16_t) * 3));
     }
+    size_t nbytes = encodeUserControl(buf->reference(), eventid, data);
+    buf->setSeekPointer(buf->reference() + nbytes);
+
+    return buf;
+}
+
+size_t
+RTMP::encodeUserControl(std::uint8_t *out, user_control_e eventid,
+			std::uint32_t data)
+{
+//    GNASH_REPORT_FUNCTION;
 
     // Set the type of this ping message
     std::uint16_t typefield = htons(eventid);
-    *buf = typefield;
+    memcpy(out, &typefield, sizeof(std::uint16_t));
+    size_t nbytes = sizeof(std::uint16_t);
     
     // All events have only 4 bytes of data, except Set Buffer, which
     // uses 8 bytes. The 4 bytes is usually the Stream ID except for
-    // Ping and Pong events, which carry a time stamp instead. We
-    // don't actually do anything here, we just parse the data.
+    // Ping and Pong events, which carry a time stamp instead.
+    std::uint32_t swapped = htonl(data);
     switch (eventid) {
       case STREAM_START:
       case STREAM_EOF:
       case STREAM_NODATA:
-	  swapped = data;
-	  cygnal::swapBytes(&swapped, sizeof(std::uint32_t));
-	  *buf += swapped;
-	  break;
-      case STREAM_BUFFER:
-	  buf.reset(new cygnal::Buffer(sizeof(std::uint16_t) * 5));
-	  break;
       case STREAM_LIVE:
       case STREAM_PING:
       case STREAM_PONG:
-	  swapped = data;
-	  cygnal::swapBytes(&swapped, sizeof(std::uint32_t));
-	  *buf += swapped;
+	  memcpy(out + nbytes, &swapped, sizeof(std::uint32_t));
+	  nbytes += sizeof(std::uint32_t);
+	  break;
+      case STREAM_BUFFER:
+	  // The Stream ID, then the buffer length, which isn't known.
+	  memcpy(out + nbytes, &swapped, sizeof(std::uint32_t));
+	  nbytes += sizeof(std::uint32_t);
+	  memset(out + nbytes, 0, sizeof(std::uint32_t));
+	  nbytes += sizeof(std::uint32_t);
 	  break;
       default:
 	  break;
     };
 
-    return buf;
+    return nbytes;
 }
 
 std::shared_ptr<RTMPMsg>
 RTMP::decodeMsgBody(std::uint8_t *data, size_t size)
 {
+//     GNASH_REPORT_FUNCTION;
+    std::shared_ptr<RTMPMsg> msg(new RTMPMsg);
+    if (!decodeMsgBody(data, size, *msg)) {
+	msg.reset();
+    }
+    
+    return msg;
+}
+
+bool
+RTMP::decodeMsgBody(const std::uint8_t *data, size_t size, RTMPMsg &msg)
+{
 //     GNASH_REPORT_FUNCTION;
     cygnal::AMF amf_obj;
-    std::uint8_t *ptr = data;
-    std::uint8_t* tooFar = data + size;
+    // The AMF decoder doesn't change the data, it just isn't const.
+    std::uint8_t *ptr = const_cast<std::uint8_t *>(data);
+    std::uint8_t* tooFar = ptr + size;
     bool status = false;
-    std::shared_ptr<RTMPMsg> msg(new RTMPMsg);
+
+    msg.clear();
+
+    // The name and the stream ID are read where they are, as no
+    // Elements are needed for them.
+    amf::Decoder decoder(data, data + size);
 
     // The first data object is the method name of this object.
-    std::shared_ptr<cygnal::Element> name = amf_obj.extractAMF(ptr, tooFar);
-    if (name) {
-	ptr += name->getDataSize() + cygnal::AMF_HEADER_SIZE; // skip the length bytes too
-    } else {
+    if (decoder.next() != amf::Decoder::STRING) {
 	log_error(_("Name field of RTMP Message corrupted!"));
-	msg.reset();
-	return msg;
+	return false;
     }
+    msg.setMethodName(decoder.string().toString());
+    const std::uint8_t *second = decoder.position();
 
     // The stream ID is the second data object. All messages have
     // these two objects at the minimum.
-    std::shared_ptr<cygnal::Element> streamid = amf_obj.extractAMF(ptr, tooFar);
-    if (streamid) {
-	// Most onStatus messages have the stream ID, but the Data
-	// Start onStatus message is basically just a marker that an
-	// FLV file is coming next. 
-	if (streamid->getType() == cygnal::Element::NUMBER_AMF0) {
-	    ptr += cygnal::AMF0_NUMBER_SIZE + 1;
-	}
-    } else {
+    const amf::Decoder::Event streamid = decoder.next();
+    if (streamid == amf::Decoder::NONE) {
 	log_error(_("Stream ID field of RTMP Message corrupted!"));
-	msg.reset();
-	return msg;
+	return false;
     }
 
-    if (name->to_string() != nullptr) {
-	msg->setMethodName(name->to_string());
+    // Most onStatus messages have the stream ID, but the Data
+    // Start onStatus message is basically just a marker that an
+    // FLV file is coming next. 
+    if (streamid == amf::Decoder::NUMBER) {
+	msg.setTransactionID(decoder.number());
+	ptr += decoder.position() - data;
+    } else {
+	ptr += second - data;
     }
-    
-    double swapped = streamid->to_number();
-//     swapBytes(&swapped, amf::AMF0_NUMBER_SIZE);
-    msg->setTransactionID(swapped);
 
-    if ((msg->getMethodName() == "_result") || (msg->getMethodName() == "_error") || (msg->getMethodName() == "onStatus")) {
+    if ((msg.getMethodName() == "_result") || (msg.getMethodName() == "_error") || (msg.getMethodName() == "onStatus")) {
  	status = true;
     }
     
@@ -785,13 +847,13 @@ RTMP::decodeMsgBody(std::uint8_t *data, size_t size)
         if (el == nullptr) {
 	    break;
 	}
-	msg->addObject(el);
+	msg.addObject(el);
  	if (status) {
-	    msg->checkStatus(el);
+	    msg.checkStatus(el);
 	}
     };
     
-    return msg;
+    return true;
 }
 
 std::shared_ptr<RTMPMsg>
@@ -809,13 +871,22 @@ RTMP::encodeChunkSize(int size)
 {
     GNASH_REPORT_FUNCTION;
 
-    std::uint32_t swapped = htonl(size);
     std::shared_ptr<cygnal::Buffer> buf(new cygnal::Buffer(sizeof(std::uint32_t)));
-    *buf += swapped;
+    buf->setSeekPointer(buf->reference() + encodeChunkSize(buf->reference(), size));
 
     return buf;
 }
 
+size_t
+RTMP::encodeChunkSize(std::uint8_t *out, int size)
+{
+//    GNASH_REPORT_FUNCTION;
+    std::uint32_t swapped = htonl(size);
+    memcpy(out, &swapped, sizeof(std::uint32_t));
+
+    return sizeof(std::uint32_t);
+}
+
 void
 RTMP::decodeChunkSize()
 {
@@ -984,102 +1055,45 @@ RTMP::sendMsg(int fd, int channel, rtmp_headersize_e head_size,
 // GNASH_REPORT_FUNCTION;
     int ret = 0;
 
-#if 0
-    // We got some bogus parameters
-    if (total_size || size 0) {
-	log_error(_("Bogus size parameter in %s!"), __PRETTY_FUNCTION__);
-	return false;
-    }
-#endif
-    
-    // FIXME: This is a temporary hack to make it easier to read hex
-    // dumps from network packet sniffing so all the data is in one
-    // buffer. This matches the Adobe behaviour, but for Gnash/Cygnal,
-    // is a performance hit.
-    
-    // Figure out how many packets it'll take to send this data.
-    int pkts = size/_chunksize[channel];
-    std::shared_ptr<cygnal::Buffer> bigbuf(new cygnal::Buffer(size+pkts+100));
-	
+    // The whole message goes in one buffer, taken from the pool, so
+    // it's sent with one write. When more data is sent than fits in
+    // the chunksize for this channel, it gets broken into chunksize
+    // pieces, and each piece after the first gets a one byte header.
+    const size_t chunksize = _chunksize[channel];
+    const size_t pkts = (data && size) ? (size - 1) / chunksize : 0;
+    std::shared_ptr<cygnal::Buffer> bigbuf = BufferPool::getDefaultInstance()
+	.get(RTMP_MAX_HEADER_SIZE + size + pkts);
+
     // This builds the full header, which is required as the first part
     // of the packet.
-    std::shared_ptr<cygnal::Buffer> head = encodeHeader(channel, head_size,
-					total_size, type, routing);
-    // When more data is sent than fits in the chunksize for this
-    // channel, it gets broken into chunksize pieces, and each piece
-    // after the first packet is sent gets a one byte header instead.
-#if 0
-    std::shared_ptr<cygnal::Buffer> cont_head = encodeHeader(channel, RTMP::HEADER_1);
-#else
-    std::shared_ptr<cygnal::Buffer> cont_head(new cygnal::Buffer(1));
-    std::uint8_t foo = 0xc3;
-    *cont_head = foo;
-#endif
-    
-    size_t partial = _chunksize[channel];
-    size_t nbytes = 0;
-
-    // First send the full header, afterwards we only use continuation
-    // headers, which are only one byte.
-#if 0
-    ret = writeNet(fd, head->reference(), head->size());
-    if (ret == -1) {
-	log_error(_("Couldn't write the full 12 byte RTMP header!"));
-	return false;
-    } else {
-	log_network(_("Wrote the full 12 byte RTMP header."));
-    }
-#else
-    *bigbuf = head;
-#endif
+    std::uint8_t *ptr = bigbuf->reference();
+    ptr += encodeHeader(ptr, channel, head_size, total_size, type, routing);
+    std::uint8_t cont_head;
+    encodeHeader(&cont_head, channel, RTMP::HEADER_1);
 
-    // if (data && size) {
-    // now send the data
-    while (nbytes <= size) {
-	// The last bit of data is usually less than the packet size,
-	// so we write less data of course.
-	if ((size - nbytes) < _chunksize[channel]) {
-	    partial = size - nbytes;
-	}
+    for (size_t nbytes = 0; data && (nbytes < size); nbytes += chunksize) {
 	// After the first packet, only send the single byte
 	// continuation packet.
 	if (nbytes > 0) {
-#if 0
-	    ret = writeNet(fd, *cont_head);
-	    if (ret == -1) {
-		log_error(_("Couldn't write the full 1 byte RTMP continuation header!"));
-		return false;
-	    } else {
-		log_network(_("Wrote the full 1 byte RTMP continuation header"));
-	    }
-#else
-	    *bigbuf += cont_head;
-#endif
+	    *ptr++ = cont_head;
 	}
-        // }
-    
-	// write the data to the client
-#if 0
-	ret = writeNet(fd, data + nbytes, partial);
-	if (ret == -1) {
-	    log_error(_("Couldn't write the RTMP body!"));
-	    return false;
-	} else {
-	    log_network(_("Wrote %d bytes of the RTMP body, %d bytes left."),
-			ret, size-nbytes);
-	}
-#else
-	if (data != nullptr) {
-	    bigbuf->append(data + nbytes, partial);
-	}
-#endif
-	// adjust the accumulator.
-	nbytes += _chunksize[channel];
-    };
-    
-#if 1
-    // bigbuf->dump();
+	// The last bit of data is usually less than the packet size,
+	// so we write less data of course.
+	const size_t partial = std::min(chunksize, size - nbytes);
+	std::copy(data + nbytes, data + nbytes + partial, ptr);
+	ptr += partial;
+    }
+    bigbuf->setSeekPointer(ptr);
     
+    // On a connection driven by a Reactor, the buffer is written as
+    // it is, and goes back to the pool once it has been sent. This
+    // may be another client's connection, owned by another worker.
+    std::shared_ptr<Reactor::Connection> conn = Reactor::Connection::find(fd);
+    if (conn) {
+	conn->write(bigbuf, bigbuf->reference(), bigbuf->allocated());
+	return true;
+    }
+
     ret = writeNet(fd, *bigbuf);
     if (ret == -1) {
 	log_error(_("Couldn't write the RTMP packet!"));
@@ -1087,11 +1101,45 @@ RTMP::sendMsg(int fd, int channel, rtmp_headersize_e head_size,
     } else {
 	log_network(_("Wrote the RTMP packet."));
     }
-#endif
 
     return true;
 }
 
+bool
+RTMP::sendMsg(int fd, int channel, rtmp_headersize_e head_size,
+	      size_t total_size, content_types_e type,
+	      RTMPMsg::rtmp_source_e routing,
+	      std::shared_ptr<FileSegment> segment, off_t offset, size_t size)
+{
+// GNASH_REPORT_FUNCTION;
+    if (!segment || (offset < segment->offset())
+	|| (offset + size > segment->offset() + segment->size())) {
+	log_error(_("RTMP body isn't in the mapped part of the file!"));
+	return false;
+    }
+    std::uint8_t *data = const_cast<std::uint8_t *>(segment->data())
+	+ (offset - segment->offset());
+
+    std::shared_ptr<Reactor::Connection> conn = Reactor::Connection::find(fd);
+    if (!conn) {
+	return sendMsg(fd, channel, head_size, total_size, type, routing,
+		       data, size);
+    }
+
+    // The continuation header between the chunks is the one byte
+    // header for this channel. The header and the body are queued
+    // together, so nothing another thread writes comes between them.
+    std::uint8_t head[RTMP_MAX_HEADER_SIZE];
+    std::uint8_t cont_head;
+    const size_t headsize = encodeHeader(head, channel, head_size,
+					 total_size, type, routing);
+    encodeHeader(&cont_head, channel, RTMP::HEADER_1);
+    conn->write(head, headsize, segment, data, size, _chunksize[channel],
+		cont_head);
+    
+    return true;
+}
+
 #if 0
 // Send a Msg, and expect a response back of some kind.
 RTMPMsg *
@@ -1332,7 +1380,8 @@ RTMP::split(std::uint8_t *data, size_t size)
 	
     // split the buffer at the chunksize boundary
     std::uint8_t *ptr = nullptr;
-    std::shared_ptr<rtmp_head_t> rthead(new rtmp_head_t);
+    rtmp_head_t head;
+    rtmp_head_t *rthead = &head;
     size_t pktsize = 0;
     //size_t nbytes = 0;
     
@@ -1343,8 +1392,7 @@ RTMP::split(std::uint8_t *data, size_t size)
     while ((ptr - data) < static_cast<int>(size)) {
 	// Decode the header of the packet to get the header size, the
 	// body size, and the channel, all of which we need.
-	rthead = decodeHeader(ptr);
-	if (!rthead) {
+	if (!decodeHeader(ptr, *rthead)) {
 	    channels.reset();
 	    return channels;
 	}
@@ -1480,6 +1528,109 @@ RTMP::split(std::uint8_t *data, size_t size)
     return channels;
 }
 
+int
+RTMP::parse(const std::uint8_t *data, size_t size,
+	    const msg_handler_t &handler)
+{
+//    GNASH_REPORT_FUNCTION;
+    const std::uint8_t *ptr = data;
+    const std::uint8_t *end = data + size;
+
+    while (ptr < end) {
+	const size_t head_size = headerSize(*ptr);
+	if (static_cast<size_t>(end - ptr) < head_size) {
+	    break;
+	}
+	channel_state_t &state = _inchannels[*ptr & RTMP_INDEX_MASK];
+
+	// A message that has started only continues with one byte
+	// headers, anything else starts a new message.
+	rtmp_head_t head;
+	if (state.received && (head_size == 1)) {
+	    head = state.head;
+	} else {
+	    if (state.received) {
+		log_error(_("RTMP message on channel %d cut short after %d bytes"),
+			  state.head.channel, state.received);
+		state.received = 0;
+	    }
+	    // The header isn't decoded until the chunk has arrived,
+	    // as decoding it changes the state of the channel.
+	    if (head_size == 1) {
+		head.bodysize = _bodysize[*ptr & RTMP_INDEX_MASK];
+	    } else if (head_size >= 8) {
+		head.bodysize = (ptr[4] << 16) + (ptr[5] << 8) + ptr[6];
+	    } else {
+		head.bodysize = _bodysize[*ptr & RTMP_INDEX_MASK];
+	    }
+	}
+
+	const size_t chunk = std::min(head.bodysize - state.received,
+				      _inchunksize);
+	if (static_cast<size_t>(end - ptr) < head_size + chunk) {
+	    break;
+	}
+	if (!state.received && !decodeHeader(ptr, head)) {
+	    return -1;
+	}
+	const std::uint8_t *body = ptr + head_size;
+	ptr += head_size + chunk;
+
+	// Most messages fit in one chunk, and are used where they are.
+	if (!state.received && (chunk == static_cast<size_t>(head.bodysize))) {
+	    if (!dispatch(head, body, handler)) {
+		return -1;
+	    }
+	    continue;
+	}
+
+	// Otherwise the chunks are gathered in the Buffer for the
+	// channel, which is only ever grown.
+	if (!state.received) {
+	    state.head = head;
+	    state.mystery_word = _mystery_word;
+	    if (!state.body) {
+		state.body.reset(new cygnal::Buffer(head.bodysize));
+	    } else if (state.body->size() < static_cast<size_t>(head.bodysize)) {
+		state.body->resize(head.bodysize);
+	    }
+	}
+	std::copy(body, body + chunk, state.body->reference() + state.received);
+	state.received += chunk;
+	if (state.received == static_cast<size_t>(state.head.bodysize)) {
+	    state.received = 0;
+	    _mystery_word = state.mystery_word;
+	    if (!dispatch(state.head, state.body->reference(), handler)) {
+		return -1;
+	    }
+	}
+    }
+
+    return ptr - data;
+}
+
+// Apply a Chunk Size message before any more chunks are parsed, then
+// pass the message on.
+bool
+RTMP::dispatch(const rtmp_head_t &head, const std::uint8_t *body,
+	       const msg_handler_t &handler)
+{
+//    GNASH_REPORT_FUNCTION;
+    if ((head.type == CHUNK_SIZE) && (head.bodysize >= 4)) {
+	std::uint32_t size;
+	memcpy(&size, body, sizeof(std::uint32_t));
+	size = ntohl(size);
+	if ((size == 0) || (size > 0xffffff)) {
+	    log_error(_("Bad RTMP chunk size %d"), size);
+	    return false;
+	}
+	log_network(_("Setting the chunk size of the data read to %d"), size);
+	_inchunksize = size;
+    }
+    
+    return handler(head, body);
+}
+
 
 } // end of gnash namespace
 
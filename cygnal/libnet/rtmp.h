@@ -21,6 +21,7 @@
 
 #include <deque>
 #include <cstdint>
+#include <functional>
 #include <memory>
 #include <boost/lexical_cast.hpp>
 #include <string>
@@ -39,6 +40,8 @@
 namespace gnash
 {
 
+class FileSegment;
+
 /// \page RTMP RTMP Protocol
 /// \section rtmp_handshake RTMP Handshake
 ///     The headers and data for the initial RTMP handshake differ from
@@ -331,6 +334,32 @@ public:
 					RTMPMsg::rtmp_source_e routing);
     std::shared_ptr<cygnal::Buffer> encodeHeader(int amf_index,
 						rtmp_headersize_e head_size);
+
+    // Encode and decode headers in place, without allocating
+    // anything. The output must have room for RTMP_MAX_HEADER_SIZE
+    // bytes, and the number of bytes written is returned.
+    size_t encodeHeader(std::uint8_t *out, int amf_index,
+			rtmp_headersize_e head_size, size_t total_size,
+			content_types_e type, RTMPMsg::rtmp_source_e routing);
+    size_t encodeHeader(std::uint8_t *out, int amf_index,
+			rtmp_headersize_e head_size);
+    bool decodeHeader(const std::uint8_t *in, rtmp_head_t &head);
+    
+    // Called by parse() with each message once all its chunks have
+    // arrived. The body is only valid until the handler returns.
+    typedef std::function<bool (const rtmp_head_t &head,
+				const std::uint8_t *body)> msg_handler_t;
+
+    // Reassemble the chunks of the messages in the data, calling the
+    // handler with each message completed. A message split over many
+    // reads is kept in a Buffer for its channel that is reused, and
+    // one that fits in a single chunk is passed without copying it.
+    // Chunk Size messages from the other end are applied as they're
+    // parsed. This returns the number of bytes used, which stops
+    // before an incomplete chunk that has to wait for more data, or
+    // -1 if the data is corrupted or the handler returned false.
+    int parse(const std::uint8_t *data, size_t size,
+	      const msg_handler_t &handler);
     
     void addProperty(cygnal::Element &el);
     void addProperty(char *name, cygnal::Element &el);
@@ -350,6 +379,8 @@ public:
     // Decode an RTMP message
     std::shared_ptr<RTMPMsg> decodeMsgBody(std::uint8_t *data, size_t size);
     std::shared_ptr<RTMPMsg> decodeMsgBody(cygnal::Buffer &buf);
+    // Decode into a message that is reused, which is cleared first.
+    bool decodeMsgBody(const std::uint8_t *data, size_t size, RTMPMsg &msg);
     
     virtual std::shared_ptr<rtmp_ping_t> decodePing(std::uint8_t *data);
     std::shared_ptr<rtmp_ping_t> decodePing(cygnal::Buffer &buf);
@@ -357,10 +388,14 @@ public:
     virtual std::shared_ptr<user_event_t> decodeUserControl(std::uint8_t *data);
     std::shared_ptr<user_event_t> decodeUserControl(cygnal::Buffer &buf);
     virtual std::shared_ptr<cygnal::Buffer> encodeUserControl(user_control_e, std::uint32_t data);
+    // Encode the body in place, which needs room for 10 bytes.
+    size_t encodeUserControl(std::uint8_t *out, user_control_e eventid,
+			     std::uint32_t data);
     
     
     // These are handlers for the various types
     virtual std::shared_ptr<cygnal::Buffer> encodeChunkSize(int size);
+    size_t encodeChunkSize(std::uint8_t *out, int size);
     virtual void decodeChunkSize();
 
     virtual std::shared_ptr<cygnal::Buffer> encodeBytesRead();
@@ -409,6 +444,15 @@ public:
     bool sendMsg(int fd, int channel, rtmp_headersize_e head_size,
 		 size_t total_size, content_types_e type,
 		 RTMPMsg::rtmp_source_e routing, std::uint8_t *data, size_t size);
+
+    // Send a message whose body is part of a file mapped by the
+    // Cache. On a connection driven by a Reactor, the chunks are
+    // written straight from the mapping, and only the headers are
+    // copied.
+    bool sendMsg(int fd, int channel, rtmp_headersize_e head_size,
+		 size_t total_size, content_types_e type,
+		 RTMPMsg::rtmp_source_e routing,
+		 std::shared_ptr<FileSegment> segment, off_t offset, size_t size);
     
 #if 0
     // Send a Msg, and expect a response back of some kind.
@@ -453,6 +497,21 @@ public:
 //    queues_t    _channels;
     cygnal::Buffer	_buffer;
     rtmp_handshake_head_t _handshake_header;
+
+    // The message being reassembled by parse() on each channel.
+    typedef struct {
+	rtmp_head_t	head;
+	size_t		received;
+	// The timestamp field of the first chunk, as chunks of other
+	// channels may come between the chunks of this message.
+	int		mystery_word;
+	std::unique_ptr<cygnal::Buffer> body;
+    } channel_state_t;
+    channel_state_t	_inchannels[MAX_AMF_INDEXES];
+    bool dispatch(const rtmp_head_t &head, const std::uint8_t *body,
+		  const msg_handler_t &handler);
+    // The chunk size of the data parsed, set by the other end.
+    size_t		_inchunksize;
 };
 
 } // end of gnash namespace
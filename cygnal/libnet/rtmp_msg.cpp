@@ -65,6 +65,19 @@ RTMPMsg::~RTMPMsg()
 //    GNASH_REPORT_FUNCTION;
 }
 
+// Reset to the state of a new message, so it can be reused.
+void
+RTMPMsg::clear()
+{
+//    GNASH_REPORT_FUNCTION;
+    _routing = FROM_SERVER;
+    _status = APP_SHUTDOWN;
+    _method.clear();
+    _transid = 0;
+    _amfobjs.clear();
+    _channel = 0;
+}
+
 struct RTMPStatusMsgCode {
     const char *msg;
     RTMPMsg::rtmp_status_e code;
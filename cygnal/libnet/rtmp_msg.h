@@ -91,6 +91,7 @@ public:
     } rtmp_source_e;
     RTMPMsg();
     ~RTMPMsg();
+    DSOEXPORT void clear();
     
     void addObject(std::shared_ptr<cygnal::Element> el) { _amfobjs.push_back(el); };
     size_t size() { return _amfobjs.size(); };
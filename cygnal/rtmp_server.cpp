@@ -25,8 +25,10 @@
 #include <iostream>
 #include <string>
 #include <map>
+#include <algorithm>
 #include <cstdlib>
 #include <cstdio>
+#include <cstring>
 
 #include <cstdint>
 #include <boost/detail/endian.hpp>
@@ -53,6 +55,8 @@
 #include "crc.h"
 #include "cache.h"
 #include "diskstream.h"
+#include "reactor.h"
+#include "relay.h"
 #ifdef HAVE_SYS_TIME_H
 # include <sys/time.h>
 #endif 
@@ -74,6 +78,7 @@ RTMPServer::RTMPServer()
     : _filesize(0),
       _streamid(1)
 {
+    std::fill(_clock, _clock + gnash::MAX_AMF_INDEXES, 0);
 //    GNASH_REPORT_FUNCTION;
 //     _inbytes = 0;
 //     _outbytes = 0;
@@ -86,9 +91,26 @@ RTMPServer::~RTMPServer()
 {
 //    GNASH_REPORT_FUNCTION;
     _properties.clear();
+    if (!_publishing.empty()) {
+	Relay::getDefaultInstance().removePublisher(_publishing);
+    }
 //    delete _body;
 }
 
+// The timestamp of a 12 byte header is absolute, the others have the
+// time since the last message on the channel.
+std::uint32_t
+RTMPServer::getTimestamp(const rtmp_head_t &head)
+{
+//    GNASH_REPORT_FUNCTION;
+    if (head.head_size == 12) {
+	_clock[head.channel] = getMysteryWord();
+    } else if (head.head_size >= 4) {
+	_clock[head.channel] += getMysteryWord();
+    }
+    return _clock[head.channel];
+}
+
 
 std::shared_ptr<cygnal::Element>
 RTMPServer::processClientHandShake(int fd)
@@ -105,16 +127,8 @@ RTMPServer::processClientHandShake(int fd)
     // Adjust the timeout for reading from the network
     RTMP::setTimeout(10);
     
-    // These store the information we need from the initial
-    /// NetConnection object.
-    std::unique_ptr<cygnal::Element> nc;
-    std::shared_ptr<cygnal::Buffer>  pkt;
     std::shared_ptr<cygnal::Element> tcurl;
-    std::shared_ptr<cygnal::Element> swfurl;
-    std::shared_ptr<cygnal::Element> encoding;
 
-//     RTMP::rtmp_headersize_e response_head_size = RTMP::HEADER_12;
-    
     // Read the handshake bytes sent by the client when requesting
     // a connection.
     std::shared_ptr<cygnal::Buffer> handshake1 = RTMP::recvMsg(fd);
@@ -140,9 +154,27 @@ RTMPServer::processClientHandShake(int fd)
     } else {
 	log_network("Read second handshake from the client.");
     }
+
+    return finishClientHandShake(fd, *handshake1, *handshake2);
+}
+
+std::shared_ptr<cygnal::Element>
+RTMPServer::finishClientHandShake(int fd, cygnal::Buffer &handshake1,
+				  cygnal::Buffer &handshake2)
+{
+    GNASH_REPORT_FUNCTION;
+
+    // These store the information we need from the initial
+    /// NetConnection object.
+    std::shared_ptr<cygnal::Buffer>  pkt;
+    std::shared_ptr<cygnal::Element> tcurl;
+    std::shared_ptr<cygnal::Element> swfurl;
+    std::shared_ptr<cygnal::Element> encoding;
+
+//     RTMP::rtmp_headersize_e response_head_size = RTMP::HEADER_12;
     
     // Don't assume the data we just read is a handshake.
-    pkt = serverFinish(fd, *handshake1, *handshake2);
+    pkt = serverFinish(fd, handshake1, handshake2);
     // Wmake sure we got data before trying to process it
     if (!pkt) {
 	log_error(_("Didn't receive any data in handshake!"));
@@ -869,7 +901,43 @@ RTMPServer::encodeResult(gnash::RTMPMsg::rtmp_status_e status, const std::string
       case RTMPMsg::NS_PLAY_SWITCH:
       case RTMPMsg::NS_PLAY_UNPUBLISHNOTIFY:
       case RTMPMsg::NS_PUBLISH_BADNAME:
+      {
+	  str->makeString("onStatus");
+
+	  std::shared_ptr<cygnal::Element> level(new Element);
+	  level->makeString("level", "error");
+	  top.addProperty(level);
+
+	  std::shared_ptr<cygnal::Element> code(new Element);
+	  code->makeString("code", "NetStream.Publish.BadName");
+	  top.addProperty(code);
+
+	  std::shared_ptr<cygnal::Element> description(new Element);
+	  description->makeString("description", filename + " is already published.");
+	  top.addProperty(description);
+	  break;
+      }
       case RTMPMsg::NS_PUBLISH_START:
+      {
+	  str->makeString("onStatus");
+
+	  std::shared_ptr<cygnal::Element> level(new Element);
+	  level->makeString("level", "status");
+	  top.addProperty(level);
+
+	  std::shared_ptr<cygnal::Element> code(new Element);
+	  code->makeString("code", "NetStream.Publish.Start");
+	  top.addProperty(code);
+
+	  std::shared_ptr<cygnal::Element> description(new Element);
+	  description->makeString("description", filename + " is now published.");
+	  top.addProperty(description);
+
+	  std::shared_ptr<cygnal::Element> details(new Element);
+	  details->makeString("details", filename);
+	  top.addProperty(details);
+	  break;
+      }
       case RTMPMsg::NS_RECORD_FAILED:
       case RTMPMsg::NS_RECORD_NOACCESS:
       case RTMPMsg::NS_RECORD_START:
@@ -1342,381 +1410,418 @@ RTMPServer::sendToClient(std::vector<int> &fds, std::uint8_t *data,
     return ret;
 }
 
-// This is the thread for all incoming RTMP connections
-bool
-rtmp_handler(Network::thread_params_t *args)
+// Send the start of each disk stream being played to its client.
+static void
+rtmp_send_streams(Handler *hand, RTMPServer *rtmp)
 {
-    GNASH_REPORT_FUNCTION;
-
-    Handler *hand = reinterpret_cast<Handler *>(args->handler);
-    RTMPServer *rtmp = reinterpret_cast<RTMPServer *>(args->entry);
-    // RTMPServer *rtmp = new RTMPServer;
-    
-    string docroot = args->filespec;
-    string url, filespec;
-    url = docroot;
-    bool done = false;
-    std::shared_ptr<RTMPMsg> body;
-    // static bool initialize = true;
-//     bool sendfile = false;
-    log_network("Starting RTMP Handler for fd #%d, cgi-bin is \"%s\"",
-		args->netfd, args->filespec);
-    
-#ifdef USE_STATISTICS
-    struct timespec start;
-    clock_gettime (CLOCK_REALTIME, &start);
-#endif
-
-    // Adjust the timeout
-    rtmp->setTimeout(10);
-    
-    std::shared_ptr<cygnal::Buffer>  pkt;
-    std::shared_ptr<cygnal::Element> tcurl;
-    std::shared_ptr<cygnal::Element> swfurl;
-    std::shared_ptr<cygnal::Buffer> response;
-
-    // Keep track of the network statistics
-    // See if we have any messages waiting. After the initial connect, this is
-    // the main loop for processing messages.
-    
-    // Adjust the timeout
-    rtmp->setTimeout(30);
-//    std::shared_ptr<cygnal::Buffer> buf;
-
-    // If we have active disk streams, send those packets first.
     // 0 is a reserved stream, so we start with 1, as the reserved
     // stream isn't one we care about here.
     log_network("%d active disk streams", hand->getActiveDiskStreams());
     for (int i=1; i <= hand->getActiveDiskStreams(); i++) {
 	hand->getDiskStream(i)->dump();
 	if (hand->getDiskStream(i)->getState() == DiskStream::PLAY) {
-	    std::uint8_t *ptr = hand->getDiskStream(i)->get();
-	    if (ptr) {
+	    std::shared_ptr<FileSegment> seg = cache.findSegment(
+		hand->getDiskStream(i)->getFilespec(), 0);
+	    if (seg) {
+		const size_t size = std::min<size_t>(4096, seg->size());
 		if (rtmp->sendMsg(hand->getClient(i), 8,
-			RTMP::HEADER_8, 4096,
+			RTMP::HEADER_8, size,
 			RTMP::NOTIFY, RTMPMsg::FROM_SERVER,
-			ptr, 4096)) {
+			seg, 0, size)) {
 		}
 	    } else {
 		log_error(_("No stream for client %d"), i);
 	    }
 	}
     }
-    
-    // This is the main message processing loop for rtmp. Most
-    // messages received require a response.
-    do {
-	// If there is no data left from the previous chunk, process
-	// that before reading more data.
-	if (pkt != nullptr) {
-	    log_network("data left from previous packet");
+}
+
+// Process one message from the client, once all its chunks have
+// arrived.
+bool
+rtmp_message(Network::thread_params_t *args, const RTMP::rtmp_head_t &head,
+	     const std::uint8_t *data, bool &done)
+{
+//    GNASH_REPORT_FUNCTION;
+
+    Handler *hand = reinterpret_cast<Handler *>(args->handler);
+    RTMPServer *rtmp = reinterpret_cast<RTMPServer *>(args->entry);
+    std::uint8_t *tmpptr = const_cast<std::uint8_t *>(data);
+    std::shared_ptr<RTMPMsg> body;
+    std::shared_ptr<cygnal::Buffer> response;
+
+    if (head.channel == RTMP_SYSTEM_CHANNEL) {
+	if (head.type == RTMP::USER) {
+	    // Every event has a type and at least one parameter.
+	    if (head.bodysize < 6) {
+		log_error(_("Short User Control message from fd #%d"),
+			  args->netfd);
+		return false;
+	    }
+	    std::shared_ptr<RTMP::user_event_t> user
+		= rtmp->decodeUserControl(tmpptr);
+	    switch (user->type) {
+	      case RTMP::STREAM_START:
+		  log_unimpl(_("Stream Start"));
+		  break;
+	      case RTMP::STREAM_EOF:
+		  log_unimpl(_("Stream EOF"));
+		  break;
+	      case RTMP::STREAM_NODATA:
+		  log_unimpl(_("Stream No Data"));
+		  break;
+	      case RTMP::STREAM_BUFFER:
+		  log_unimpl(_("Stream Set Buffer: %d"), user->param2);
+		  break;
+	      case RTMP::STREAM_LIVE:
+		  log_unimpl("Stream Live");
+		  break;
+	      case RTMP::STREAM_PING:
+	      {
+		  std::shared_ptr<RTMP::rtmp_ping_t> ping
+		      = rtmp->decodePing(tmpptr);
+		  log_network("Processed Ping message from client, type %d",
+			      ping->type);
+		  break;
+	      }
+	      case RTMP::STREAM_PONG:
+		  log_unimpl(_("Stream Pong"));
+		  break;
+	      default:
+		  break;
+	    };
+	} else if (head.type == RTMP::AUDIO_DATA) {
+	    log_network("Got the 1st Audio packet!");
+	} else if (head.type == RTMP::VIDEO_DATA) {
+	    log_network("Got the 1st Video packet!");
+	} else if (head.type == RTMP::WINDOW_SIZE) {
+	    log_network("Got the Window Set Size packet!");
 	} else {
-	    pkt = rtmp->recvMsg(args->netfd);
+	    log_network("Got unknown system message!");
+	    log_network("%s", hexify(tmpptr, head.bodysize, true));
 	}
-	
-	if (pkt != nullptr) {
-	    std::uint8_t *tmpptr = nullptr;
-	    if (pkt->allocated()) {
-		std::shared_ptr<RTMP::queues_t> que = rtmp->split(*pkt);
-		if (!que) {
-		    // FIXME: send _error result
-		    return false;
-		}
-		std::shared_ptr<RTMP::rtmp_head_t> qhead;
-		for (size_t i=0; i<que->size(); i++) {
-		    std::shared_ptr<cygnal::Buffer> bufptr = que->at(i)->pop();
-		    // que->at(i)->dump();
-		    if (bufptr) {
-			// bufptr->dump();
-			qhead = rtmp->decodeHeader(bufptr->reference());
-			if (!qhead) {
-			    return false;
-			}
- 			// log_network("Message for channel #%d", qhead->channel);
-			tmpptr = bufptr->reference() + qhead->head_size;
-			if (qhead->channel == RTMP_SYSTEM_CHANNEL) {
-			    if (qhead->type == RTMP::USER) {
-				std::shared_ptr<RTMP::user_event_t> user
-				    = rtmp->decodeUserControl(tmpptr);
-				switch (user->type) {
-				  case RTMP::STREAM_START:
-				      log_unimpl(_("Stream Start"));
-				      break;
-				  case RTMP::STREAM_EOF:
-				      log_unimpl(_("Stream EOF"));
-				      break;
-				  case RTMP::STREAM_NODATA:
-				      log_unimpl(_("Stream No Data"));
-				      break;
-				  case RTMP::STREAM_BUFFER:
-				      log_unimpl(_("Stream Set Buffer: %d"), user->param2);
-				      break;
-				  case RTMP::STREAM_LIVE:
-				      log_unimpl("Stream Live");
-				      break;
-				  case RTMP::STREAM_PING:
-				  {
-				      std::shared_ptr<RTMP::rtmp_ping_t> ping
-					  = rtmp->decodePing(tmpptr);
-				      log_network("Processed Ping message from client, type %d",
-						  ping->type);
-				      break;
-				  }
-				  case RTMP::STREAM_PONG:
-				      log_unimpl(_("Stream Pong"));
-				      break;
-				  default:
-				      break;
-				};
-			    } else if (qhead->type == RTMP::AUDIO_DATA) {
-				log_network("Got the 1st Audio packet!");
-			    } else if (qhead->type == RTMP::VIDEO_DATA) {
-				log_network("Got the 1st Video packet!");
-			    } else if (qhead->type == RTMP::WINDOW_SIZE) {
-				log_network("Got the Window Set Size packet!");
-			    } else {
-				log_network("Got unknown system message!");
-				bufptr->dump();
-			    }
-			}
-		    }
-		    switch (qhead->type) {
-		      case RTMP::CHUNK_SIZE:
-			  log_unimpl(_("Set Chunk Size"));
-			  break;
-		      case RTMP::BYTES_READ:
-			  log_unimpl(_("Bytes Read"));
-			  break;
-		      case RTMP::ABORT:
-		      case RTMP::USER:
-			  // already handled as this is a system channel message
-			  return true;
-			  break;
-		      case RTMP::WINDOW_SIZE:
-			  log_unimpl(_("Set Window Size"));
-			  break;
-		      case RTMP::SET_BANDWITH:
-			  log_unimpl(_("Set Bandwidth"));
-			  break;
-		      case RTMP::ROUTE:
-		      case RTMP::AUDIO_DATA:
-		      case RTMP::VIDEO_DATA:
-		      case RTMP::SHARED_OBJ:
-			  body = rtmp->decodeMsgBody(tmpptr, qhead->bodysize);
-			  log_network("SharedObject name is \"%s\"",
-				      body->getMethodName());
-			  break;
-		      case RTMP::AMF3_NOTIFY:
-			  log_unimpl(_("RTMP type %d"), qhead->type);
-			  break;
-		      case RTMP::AMF3_SHARED_OBJ:
-			  log_unimpl(_("RTMP type %d"), qhead->type);
-			  break;
-		      case RTMP::AMF3_INVOKE:
-			  log_unimpl(_("RTMP type %d"), qhead->type);
-			  break;
-		      case RTMP::NOTIFY:
-			  log_unimpl(_("RTMP type %d"), qhead->type);
-			  break;
-		      case RTMP::INVOKE:
-		      {
-			  body = rtmp->decodeMsgBody(tmpptr, qhead->bodysize);
-			  if (!body) {
-			      log_error(_("Error INVOKING method \"%s\"!"),
-					body->getMethodName());
-			      continue;
-			  }
-			  log_network("INVOKEing method \"%s\"",
-				      body->getMethodName());
-			  // log_network("%s", hexify(tmpptr, qhead->bodysize, true));
-			  
-			  // These next Invoke methods are for the
-			  // NetStream class, which like NetConnection,
-			  // is a speacial one handled directly by the
-			  // server instead of any cgi-bin plugins.
-			  double transid  = body->getTransactionID();
-			  log_network("The Transaction ID from the client is: %g", transid);
-			  if (body->getMethodName() == "createStream") {
-			      hand->createStream(transid);
-			      response = rtmp->encodeResult(RTMPMsg::NS_CREATE_STREAM, transid);
-			      if (rtmp->sendMsg(args->netfd, qhead->channel,
-					RTMP::HEADER_8, response->allocated(),
-					RTMP::INVOKE, RTMPMsg::FROM_SERVER,
-					*response)) {
-			      }
-			  } else if (body->getMethodName() == "play") {
-			      string filespec;
-			      std::shared_ptr<gnash::RTMPMsg> nc = rtmp->getNetConnection();
-			      std::shared_ptr<cygnal::Element> tcurl = nc->findProperty("tcUrl");
-			      URL url(tcurl->to_string());
-			      filespec += url.hostname() + url.path();
-			      filespec += '/';
-			      filespec += body->at(1)->to_string();
-
-			      if (hand->playStream(filespec)) {
-				  // Send the Set Chunk Size response
+    }
+
+    switch (head.type) {
+      case RTMP::CHUNK_SIZE:
+	  log_unimpl(_("Set Chunk Size"));
+	  break;
+      case RTMP::BYTES_READ:
+	  log_unimpl(_("Bytes Read"));
+	  break;
+      case RTMP::ABORT:
+      case RTMP::USER:
+	  // already handled as this is a system channel message
+	  done = true;
+	  break;
+      case RTMP::WINDOW_SIZE:
+	  log_unimpl(_("Set Window Size"));
+	  break;
+      case RTMP::SET_BANDWITH:
+	  log_unimpl(_("Set Bandwidth"));
+	  break;
+      case RTMP::AUDIO_DATA:
+      case RTMP::VIDEO_DATA:
+      case RTMP::NOTIFY:
+	  // A live stream is passed straight on to the
+	  // clients playing it.
+	  if (!rtmp->getPublishing().empty()) {
+	      Relay::getDefaultInstance().publish(
+		  rtmp->getPublishing(), head.type,
+		  rtmp->getTimestamp(head), tmpptr,
+		  head.bodysize);
+	  } else {
+	      log_unimpl(_("RTMP type %d"), head.type);
+	  }
+	  break;
+      case RTMP::ROUTE:
+      case RTMP::SHARED_OBJ:
+	  body = rtmp->decodeMsgBody(tmpptr, head.bodysize);
+	  log_network("SharedObject name is \"%s\"",
+		      body->getMethodName());
+	  break;
+      case RTMP::AMF3_NOTIFY:
+	  log_unimpl(_("RTMP type %d"), head.type);
+	  break;
+      case RTMP::AMF3_SHARED_OBJ:
+	  log_unimpl(_("RTMP type %d"), head.type);
+	  break;
+      case RTMP::AMF3_INVOKE:
+	  log_unimpl(_("RTMP type %d"), head.type);
+	  break;
+      case RTMP::INVOKE:
+      {
+	  body = rtmp->decodeMsgBody(tmpptr, head.bodysize);
+	  if (!body) {
+	      log_error(_("Couldn't decode an INVOKE from fd #%d!"),
+			args->netfd);
+	      return true;
+	  }
+	  log_network("INVOKEing method \"%s\"",
+		      body->getMethodName());
+	  // log_network("%s", hexify(tmpptr, head.bodysize, true));
+
+	  // These next Invoke methods are for the
+	  // NetStream class, which like NetConnection,
+	  // is a speacial one handled directly by the
+	  // server instead of any cgi-bin plugins.
+	  double transid  = body->getTransactionID();
+	  log_network("The Transaction ID from the client is: %g", transid);
+	  if (body->getMethodName() == "createStream") {
+	      hand->createStream(transid);
+	      response = rtmp->encodeResult(RTMPMsg::NS_CREATE_STREAM, transid);
+	      if (rtmp->sendMsg(args->netfd, head.channel,
+			RTMP::HEADER_8, response->allocated(),
+			RTMP::INVOKE, RTMPMsg::FROM_SERVER,
+			*response)) {
+	      }
+	  } else if (body->getMethodName() == "play") {
+	      string filespec;
+	      std::shared_ptr<gnash::RTMPMsg> nc = rtmp->getNetConnection();
+	      std::shared_ptr<cygnal::Element> tcurl = nc->findProperty("tcUrl");
+	      URL url(tcurl->to_string());
+	      filespec += url.hostname() + url.path();
+	      filespec += '/';
+	      filespec += body->at(1)->to_string();
+
+	      // Play a live stream if one is published
+	      // with this name, rather than a file.
+	      Reactor::Connection *conn = Reactor::Connection::current();
+	      if (conn && Relay::getDefaultInstance().isPublished(filespec)) {
+		  response = rtmp->encodeChunkSize(Relay::CHUNK_SIZE);
+		  rtmp->sendMsg(args->netfd, RTMP_SYSTEM_CHANNEL,
+			RTMP::HEADER_12, response->allocated(),
+			RTMP::CHUNK_SIZE, RTMPMsg::FROM_SERVER,
+			*response);
+		  response = rtmp->encodeResult(RTMPMsg::NS_PLAY_START, body->at(1)->to_string(), transid);
+		  rtmp->sendMsg(args->netfd, head.channel,
+			RTMP::HEADER_8, response->allocated(),
+			RTMP::INVOKE, RTMPMsg::FROM_SERVER,
+			*response);
+		  std::uint32_t streamid;
+		  std::memcpy(&streamid, &head.src_dest, sizeof(streamid));
+		  Relay::getDefaultInstance().subscribe(filespec,
+			conn->shared_from_this(), streamid);
+	      } else if (hand->playStream(filespec)) {
+		  // Send the Set Chunk Size response
 #if 1
-				  response = rtmp->encodeChunkSize(4096);
-				  if (rtmp->sendMsg(args->netfd, RTMP_SYSTEM_CHANNEL,
-					RTMP::HEADER_12, response->allocated(),
-					RTMP::CHUNK_SIZE, RTMPMsg::FROM_SERVER,
-					*response)) {
-				  }
+		  response = rtmp->encodeChunkSize(4096);
+		  if (rtmp->sendMsg(args->netfd, RTMP_SYSTEM_CHANNEL,
+			RTMP::HEADER_12, response->allocated(),
+			RTMP::CHUNK_SIZE, RTMPMsg::FROM_SERVER,
+			*response)) {
+		  }
 #endif
-			      // Send the Play.Resetting response
-				  response = rtmp->encodeResult(RTMPMsg::NS_PLAY_RESET, body->at(1)->to_string(), transid);
-				  if (rtmp->sendMsg(args->netfd, qhead->channel,
-					RTMP::HEADER_8, response->allocated(),
-					RTMP::INVOKE, RTMPMsg::FROM_SERVER,
-					*response)) {
-				  }
-				  // Send the Play.Start response
-				  response = rtmp->encodeResult(RTMPMsg::NS_PLAY_START, body->at(1)->to_string(), transid);
-				  if (rtmp->sendMsg(args->netfd, qhead->channel,
-					RTMP::HEADER_8, response->allocated(),
-					RTMP::INVOKE, RTMPMsg::FROM_SERVER,
-					*response)) {
-				  }
-			      } else {
-				  response = rtmp->encodeResult(RTMPMsg::NS_PLAY_STREAMNOTFOUND, body->at(1)->to_string(), transid);
-				  if (rtmp->sendMsg(args->netfd, qhead->channel,
-					RTMP::HEADER_8, response->allocated(),
-					RTMP::INVOKE, RTMPMsg::FROM_SERVER,
-					*response)) {
-				  }
-			      }
-			      sleep(1); // FIXME: debugging crap
-			      // Send the User Control - Stream Live
-			      response = rtmp->encodeUserControl(RTMP::STREAM_LIVE, 1);
-			      if (rtmp->sendMsg(args->netfd, RTMP_SYSTEM_CHANNEL,
-					RTMP::HEADER_12, response->allocated(),
-					RTMP::USER, RTMPMsg::FROM_SERVER,
-					*response)) {
-			      }
-			      sleep(1); // FIXME: debugging crap
-			      // Send an empty Audio packet to get
-			      // things started.
-			      if (rtmp->sendMsg(args->netfd, 6,
-					RTMP::HEADER_12, 0,
-					RTMP::AUDIO_DATA, RTMPMsg::FROM_SERVER,
-					nullptr, 0)) {
-			      }
-			      // Send an empty Video packet to get
-			      // things started.
-			      if (rtmp->sendMsg(args->netfd, 5,
-					RTMP::HEADER_12, 0,
-					RTMP::VIDEO_DATA, RTMPMsg::FROM_SERVER,
-					nullptr, 0)) {
-			      }
-			      sleep(1); // FIXME: debugging crap
-			      // Send the User Control - Stream Start
-			      response = rtmp->encodeUserControl(RTMP::STREAM_START, 1);
-			      if (rtmp->sendMsg(args->netfd, RTMP_SYSTEM_CHANNEL,
-					RTMP::HEADER_12, response->allocated(),
-					RTMP::USER, RTMPMsg::FROM_SERVER,
-					*response)) {
-			      }			      
-			      int active_stream = hand->getActiveDiskStreams();
-			      std::uint8_t *ptr = hand->getDiskStream(active_stream)->get();
-			      if (ptr) {
-				  log_network("Sending %s to client",
-					      hand->getDiskStream(active_stream)->getFilespec());
-				  if (rtmp->sendMsg(args->netfd, 5,
-					RTMP::HEADER_12, 400,
-					RTMP::NOTIFY, RTMPMsg::FROM_SERVER,
-					ptr, 400)) {
-				      log_network("Sent first page to client");
-				  }
-			      }  
-			  } else if (body->getMethodName() == "seek") {
-			      hand->seekStream();
-			  } else if (body->getMethodName() == "pause") {
-			      hand->pauseStream(transid);
-			  } else if (body->getMethodName() == "close") {
-			      hand->closeStream(transid);
-			  } else if (body->getMethodName() == "resume") {
-			      hand->resumeStream(transid);
-			  } else if (body->getMethodName() == "delete") {
-			      hand->deleteStream(transid);
-			  } else if (body->getMethodName() == "publish") {
-			      hand->publishStream();
-			  } else if (body->getMethodName() == "togglePause") {
-			      hand->togglePause(transid);
-			      // This is a server installation specific  method.
-			  } else if (body->getMethodName() == "FCSubscribe") {
-			      hand->setFCSubscribe(body->at(0)->to_string());
-			  } else if (body->getMethodName() == "_error") {
-			      log_error(_("Received an _error message from the client!"));
-			  } else {
-			      /* size_t ret = */ hand->writeToPlugin(tmpptr, qhead->bodysize);
-			      std::shared_ptr<cygnal::Buffer> result = hand->readFromPlugin();
-			      if (result) {
-				  if (rtmp->sendMsg(args->netfd, qhead->channel,
-						    RTMP::HEADER_8, result->allocated(),
-						    RTMP::INVOKE, RTMPMsg::FROM_SERVER,
-						    *result)) {
-				      log_network("Sent response to client.");
-				  }
-			      }
-			      done = true;
-			  }
-			  break;
-		      }
-		      case RTMP::FLV_DATA:
-			  log_unimpl(_("RTMP type %d"), qhead->type);
-			  break;
-		      default:
-			  log_error (_("ERROR: Unidentified AMF header data type 0x%x"), qhead->type);
-			  break;
-		    };
+	      // Send the Play.Resetting response
+		  response = rtmp->encodeResult(RTMPMsg::NS_PLAY_RESET, body->at(1)->to_string(), transid);
+		  if (rtmp->sendMsg(args->netfd, head.channel,
+			RTMP::HEADER_8, response->allocated(),
+			RTMP::INVOKE, RTMPMsg::FROM_SERVER,
+			*response)) {
+		  }
+		  // Send the Play.Start response
+		  response = rtmp->encodeResult(RTMPMsg::NS_PLAY_START, body->at(1)->to_string(), transid);
+		  if (rtmp->sendMsg(args->netfd, head.channel,
+			RTMP::HEADER_8, response->allocated(),
+			RTMP::INVOKE, RTMPMsg::FROM_SERVER,
+			*response)) {
+		  }
+	      } else {
+		  response = rtmp->encodeResult(RTMPMsg::NS_PLAY_STREAMNOTFOUND, body->at(1)->to_string(), transid);
+		  if (rtmp->sendMsg(args->netfd, head.channel,
+			RTMP::HEADER_8, response->allocated(),
+			RTMP::INVOKE, RTMPMsg::FROM_SERVER,
+			*response)) {
+		  }
+	      }
+	      sleep(1); // FIXME: debugging crap
+	      // Send the User Control - Stream Live
+	      response = rtmp->encodeUserControl(RTMP::STREAM_LIVE, 1);
+	      if (rtmp->sendMsg(args->netfd, RTMP_SYSTEM_CHANNEL,
+			RTMP::HEADER_12, response->allocated(),
+			RTMP::USER, RTMPMsg::FROM_SERVER,
+			*response)) {
+	      }
+	      sleep(1); // FIXME: debugging crap
+	      // Send an empty Audio packet to get
+	      // things started.
+	      if (rtmp->sendMsg(args->netfd, 6,
+			RTMP::HEADER_12, 0,
+			RTMP::AUDIO_DATA, RTMPMsg::FROM_SERVER,
+			nullptr, 0)) {
+	      }
+	      // Send an empty Video packet to get
+	      // things started.
+	      if (rtmp->sendMsg(args->netfd, 5,
+			RTMP::HEADER_12, 0,
+			RTMP::VIDEO_DATA, RTMPMsg::FROM_SERVER,
+			nullptr, 0)) {
+	      }
+	      sleep(1); // FIXME: debugging crap
+	      // Send the User Control - Stream Start
+	      response = rtmp->encodeUserControl(RTMP::STREAM_START, 1);
+	      if (rtmp->sendMsg(args->netfd, RTMP_SYSTEM_CHANNEL,
+			RTMP::HEADER_12, response->allocated(),
+			RTMP::USER, RTMPMsg::FROM_SERVER,
+			*response)) {
+	      }                       
+	      int active_stream = hand->getActiveDiskStreams();
+	      std::shared_ptr<FileSegment> seg = cache.findSegment(
+		  hand->getDiskStream(active_stream)->getFilespec(), 0);
+	      if (seg) {
+		  log_network("Sending %s to client",
+			      hand->getDiskStream(active_stream)->getFilespec());
+		  const size_t size = std::min<size_t>(400, seg->size());
+		  if (rtmp->sendMsg(args->netfd, 5,
+			RTMP::HEADER_12, size,
+			RTMP::NOTIFY, RTMPMsg::FROM_SERVER,
+			seg, 0, size)) {
+		      log_network("Sent first page to client");
+		  }
+	      }  
+	  } else if (body->getMethodName() == "seek") {
+	      hand->seekStream();
+	  } else if (body->getMethodName() == "pause") {
+	      hand->pauseStream(transid);
+	  } else if (body->getMethodName() == "close") {
+	      hand->closeStream(transid);
+	  } else if (body->getMethodName() == "resume") {
+	      hand->resumeStream(transid);
+	  } else if (body->getMethodName() == "delete") {
+	      hand->deleteStream(transid);
+	  } else if (body->getMethodName() == "publish") {
+	      // Live streams are relayed to the clients
+	      // playing them, not kept.
+	      std::shared_ptr<gnash::RTMPMsg> nc = rtmp->getNetConnection();
+	      std::shared_ptr<cygnal::Element> tcurl = nc->findProperty("tcUrl");
+	      URL url(tcurl->to_string());
+	      string filespec = url.hostname() + url.path() + '/'
+		  + body->at(1)->to_string();
+	      RTMPMsg::rtmp_status_e status = RTMPMsg::NS_PUBLISH_BADNAME;
+	      if (rtmp->getPublishing().empty()
+		  && Relay::getDefaultInstance().addPublisher(filespec)) {
+		  rtmp->setPublishing(filespec);
+		  status = RTMPMsg::NS_PUBLISH_START;
+	      }
+	      response = rtmp->encodeResult(status, body->at(1)->to_string(), transid);
+	      rtmp->sendMsg(args->netfd, head.channel,
+		    RTMP::HEADER_8, response->allocated(),
+		    RTMP::INVOKE, RTMPMsg::FROM_SERVER,
+		    *response);
+	  } else if (body->getMethodName() == "togglePause") {
+	      hand->togglePause(transid);
+	      // This is a server installation specific  method.
+	  } else if (body->getMethodName() == "FCSubscribe") {
+	      hand->setFCSubscribe(body->at(0)->to_string());
+	  } else if (body->getMethodName() == "_error") {
+	      log_error(_("Received an _error message from the client!"));
+	  } else {
+	      /* size_t ret = */ hand->writeToPlugin(tmpptr, head.bodysize);
+	      std::shared_ptr<cygnal::Buffer> result = hand->readFromPlugin();
+	      if (result) {
+		  if (rtmp->sendMsg(args->netfd, head.channel,
+				    RTMP::HEADER_8, result->allocated(),
+				    RTMP::INVOKE, RTMPMsg::FROM_SERVER,
+				    *result)) {
+		      log_network("Sent response to client.");
+		  }
+	      }
+	      done = true;
+	  }
+	  break;
+      }
+      case RTMP::FLV_DATA:
+	  log_unimpl(_("RTMP type %d"), head.type);
+	  break;
+      default:
+	  log_error (_("ERROR: Unidentified AMF header data type 0x%x"), head.type);
+	  break;
+    };
+
+    return true;
+}
+
+// This is the thread for all incoming RTMP connections
+bool
+rtmp_handler(Network::thread_params_t *args)
+{
+    GNASH_REPORT_FUNCTION;
+
+    Handler *hand = reinterpret_cast<Handler *>(args->handler);
+    RTMPServer *rtmp = reinterpret_cast<RTMPServer *>(args->entry);
+    bool done = false;
+    log_network("Starting RTMP Handler for fd #%d, cgi-bin is \"%s\"",
+		args->netfd, args->filespec);
     
-// 		    body->dump();
+    // Adjust the timeout
+    rtmp->setTimeout(30);
 
-		    // size_t ret = hand->writeToPlugin(tmpptr, qhead->bodysize);
-#if 0
-		    std::shared_ptr<cygnal::Buffer> result = hand->readFromPlugin();
- 		    if (result) { // FIXME: this needs a real channel number
-			if (rtmp->sendMsg(args->netfd, 0x3, RTMP::HEADER_8, ret,
-					  RTMP::INVOKE, RTMPMsg::FROM_SERVER, *result)) {
-			    log_network("Sent response to client.");
-			}
- 		    }
-#endif		    
-// 		    log_network("RET is: %d", ret);
-		} // end of processing all the messages in the que
-		
-		// we're done processing these packets, so get rid of them
-		pkt.reset();
-
-		
-	    } else {
-		log_network("Never read any data from fd #%d", args->netfd);
-#if 0
-		// Send a ping to reset the new stream
-		std::shared_ptr<cygnal::Buffer> ping_reset =
-		    rtmp->encodePing(RTMP::PING_CLEAR, 0);
-		if (rtmp->sendMsg(args->netfd, RTMP_SYSTEM_CHANNEL,
-			  RTMP::HEADER_12, ping_reset->size(),
-			  RTMP::PING, RTMPMsg::FROM_SERVER, *ping_reset)) {
-		    log_network("Sent Ping to client");
-		} else {
-		    log_error(_("Couldn't send Ping to client!"));
-		}
-#endif
-		// initialize = true;
-		return true;
-	    }
-	} else {
+    // If we have active disk streams, send those packets first.
+    rtmp_send_streams(hand, rtmp);
+    
+    // This is the main message processing loop for rtmp. Most
+    // messages received require a response.
+    do {
+	std::shared_ptr<cygnal::Buffer> pkt = rtmp->recvMsg(args->netfd);
+	if (!pkt) {
 	    // log_error(_("Communication error with client using fd #%d", args->netfd));
 	    rtmp->closeNet(args->netfd);
-	    // initialize = true;
 	    return false;
 	}
+	if (!pkt->allocated()) {
+	    log_network("Never read any data from fd #%d", args->netfd);
+	    return true;
+	}
+	std::shared_ptr<RTMP::queues_t> que = rtmp->split(*pkt);
+	if (!que) {
+	    // FIXME: send _error result
+	    return false;
+	}
+	for (size_t i=0; i<que->size(); i++) {
+	    std::shared_ptr<cygnal::Buffer> bufptr = que->at(i)->pop();
+	    if (!bufptr) {
+		continue;
+	    }
+	    std::shared_ptr<RTMP::rtmp_head_t> qhead
+		= rtmp->decodeHeader(bufptr->reference());
+	    if (!qhead) {
+		return false;
+	    }
+	    if (!rtmp_message(args, *qhead,
+			      bufptr->reference() + qhead->head_size, done)) {
+		return false;
+	    }
+	}
     } while (!done);
     
     return true;
 }
 
+// Process the messages in the data read from a client on a
+// connection driven by a Reactor, which may end with part of a
+// message. This returns the number of bytes used, the rest having
+// to wait for more data, or -1 to close the connection.
+int
+rtmp_handler(Network::thread_params_t *args, const std::uint8_t *data,
+	     size_t size)
+{
+//    GNASH_REPORT_FUNCTION;
+
+    Handler *hand = reinterpret_cast<Handler *>(args->handler);
+    RTMPServer *rtmp = reinterpret_cast<RTMPServer *>(args->entry);
+
+    bool done = false;
+    RTMP::msg_handler_t handler = [args, &done](const RTMP::rtmp_head_t &head,
+						const std::uint8_t *body) {
+	return rtmp_message(args, head, body, done);
+    };
+    const int ret = rtmp->parse(data, size, handler);
+    if (ret > 0) {
+	rtmp_send_streams(hand, rtmp);
+    }
+    return ret;
+}
+
 } // end of gnash namespace
 
 // local Variables:
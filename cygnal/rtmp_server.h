@@ -57,6 +57,19 @@ public:
     ///     handShakeResponse() is used to construct the response packet.
     std::shared_ptr<cygnal::Element> processClientHandShake(int fd);
 
+    /// \method handShakeResponse
+    ///     Construct and send the response to the first handshake
+    ///     from the client.
+    bool handShakeResponse(int fd, cygnal::Buffer &buf);
+
+    /// \method finishClientHandShake
+    ///     This does the rest of processClientHandShake() once both
+    ///     handshakes have been read, the second one followed by the
+    ///     NetConnection::connect() INVOKE. This is used by servers
+    ///     that read the handshakes without blocking.
+    std::shared_ptr<cygnal::Element> finishClientHandShake(int fd,
+			cygnal::Buffer &handshake1, cygnal::Buffer &handshake2);
+
     bool packetSend(cygnal::Buffer &buf);
     bool packetRead(cygnal::Buffer &buf);
     
@@ -109,6 +122,15 @@ public:
     void setNetConnection(gnash::RTMPMsg *msg) { _netconnect.reset(msg); };
     void setNetConnection(std::shared_ptr<gnash::RTMPMsg> msg) { _netconnect = msg; };
     std::shared_ptr<gnash::RTMPMsg> getNetConnection() { return _netconnect;};
+
+    /// \brief The live stream this client publishes to the Relay,
+    ///	which is unpublished when the client goes away.
+    void setPublishing(const std::string &name) { _publishing = name; };
+    const std::string &getPublishing() { return _publishing; };
+
+    /// \brief The absolute timestamp of a message, from the header
+    ///	just decoded.
+    std::uint32_t getTimestamp(const rtmp_head_t &head);
     void dump();
 
 private:
@@ -118,10 +140,6 @@ private:
     ///     initial AMF data from packet.
     std::shared_ptr<cygnal::Buffer> serverFinish(int fd,
 			cygnal::Buffer &handshake1, cygnal::Buffer &handshake2);
-    /// \method handShakeResponse
-    ///     This is only called by processClientHandshake() to
-    ///     construct the handshake response to the client.
-    bool handShakeResponse(int fd, cygnal::Buffer &buf);
     
     /// This is used by the boost tokenizer functions, and is defined
     /// here purely for convienience.
@@ -146,11 +164,27 @@ private:
     ///    that is used to set up the connection. This has all the
     ///    file paths and other information needed by the server.
     std::shared_ptr<gnash::RTMPMsg>	_netconnect;
+    std::string		_publishing;
+    /// \var _clock
+    ///    The timestamp of the last message on each channel.
+    std::uint32_t	_clock[gnash::MAX_AMF_INDEXES];
 };
 
 // This is the thread for all incoming RTMP connections
 bool DSOEXPORT rtmp_handler(gnash::Network::thread_params_t *args);
 
+// Process the messages in data read by a Reactor, which may end with
+// part of a message. Returns the number of bytes used, or -1 to close
+// the connection.
+int DSOEXPORT rtmp_handler(gnash::Network::thread_params_t *args,
+			   const std::uint8_t *data, size_t size);
+
+// Process one complete message from a client. done is set when
+// nothing more is expected from the client for now.
+bool DSOEXPORT rtmp_message(gnash::Network::thread_params_t *args,
+			    const gnash::RTMP::rtmp_head_t &head,
+			    const std::uint8_t *data, bool &done);
+
 } // end of gnash namespace
 // end of _RTMP_SERVER_H_
 #endif
@@ -121,6 +121,18 @@ main (int /*argc*/, char** /*argv*/) {
         runtest.fail ("getFDThread");
     }
 
+    if (crc.getWorkerThreads() == 4) {
+        runtest.pass ("getWorkerThreads");
+    } else {
+        runtest.fail ("getWorkerThreads");
+    }
+
+    if (crc.getFileCacheSize() == 16) {
+        runtest.pass ("getFileCacheSize");
+    } else {
+        runtest.fail ("getFileCacheSize");
+    }
+
     crc.dump();
 }
 
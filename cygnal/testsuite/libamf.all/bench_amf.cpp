@@ -0,0 +1,302 @@
+//
+//   Copyright (C) 2008, 2009, 2010, 2011, 2012 Free Software Foundation, Inc.
+//
+// This program is free software; you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation; either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program; if not, write to the Free Software
+// Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+//
+
+// Encodes and decodes an RTMP connect() invoke, and a large
+// SharedObject of nested objects, with the Element classes of libamf
+// and with the amf::Encoder and amf::Decoder of libbase, in AMF0 and
+// AMF3. Decoding with Elements builds a tree of them, as cygnal does;
+// decoding with the Decoder touches every value and string without
+// copying it. Encoding with Elements builds the tree and encodes it;
+// encoding with the Encoder appends to a reused buffer.
+//
+//	bench_amf [iterations]
+//
+// This is not run as a test; build it with "make bench_amf".
+
+#ifdef HAVE_CONFIG_H
+#include "gnashconfig.h"
+#endif
+
+#include <chrono>
+#include <cstdint>
+#include <cstdlib>
+#include <iostream>
+#include <memory>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include "log.h"
+#include "GnashException.h"
+#include "amf.h"
+#include "buffer.h"
+#include "element.h"
+#include "AMFCodec.h"
+#include "SimpleBuffer.h"
+
+using namespace std;
+using namespace gnash;
+using namespace cygnal;
+
+namespace {
+
+const size_t PROPERTIES = 1000;
+
+// Keeps results from being optimised away.
+size_t sink;
+
+// The names of the SharedObject members, made once.
+vector<string> players;
+
+void
+encodeConnect(amf::Encoder& e)
+{
+    e.writeString("connect");
+    e.writeNumber(1);
+    e.startObject();
+    e.writeKey("app");
+    e.writeString("oflaDemo");
+    e.writeKey("flashVer");
+    e.writeString("LNX 10,0,22,87");
+    e.writeKey("swfUrl");
+    e.writeString("http://localhost:5080/demos/ofla_demo.swf");
+    e.writeKey("tcUrl");
+    e.writeString("rtmp://localhost/oflaDemo");
+    e.writeKey("fpad");
+    e.writeBoolean(false);
+    e.writeKey("capabilities");
+    e.writeNumber(15);
+    e.writeKey("audioCodecs");
+    e.writeNumber(3191);
+    e.writeKey("videoCodecs");
+    e.writeNumber(252);
+    e.writeKey("videoFunction");
+    e.writeNumber(1);
+    e.writeKey("pageUrl");
+    e.writeString("http://localhost:5080/demos/ofla_demo.html");
+    e.writeKey("objectEncoding");
+    e.writeNumber(0);
+    e.end();
+}
+
+// A SharedObject of high scores.
+void
+encodeShared(amf::Encoder& e)
+{
+    e.writeString("scores");
+    e.startObject();
+    for (size_t i = 0; i < PROPERTIES; ++i) {
+        e.writeKey(players[i]);
+        e.startObject();
+        e.writeKey("name");
+        e.writeString(players[i]);
+        e.writeKey("score");
+        e.writeNumber(i * 100);
+        e.writeKey("level");
+        e.writeNumber(i % 10);
+        e.writeKey("active");
+        e.writeBoolean(i & 1);
+        e.end();
+    }
+    e.end();
+}
+
+// The same with Elements.
+std::shared_ptr<Buffer>
+elementsConnect()
+{
+    Element obj;
+    obj.makeObject();
+    obj.addProperty(std::make_shared<Element>("app", "oflaDemo"));
+    obj.addProperty(std::make_shared<Element>("flashVer", "LNX 10,0,22,87"));
+    obj.addProperty(std::make_shared<Element>("swfUrl",
+                "http://localhost:5080/demos/ofla_demo.swf"));
+    obj.addProperty(std::make_shared<Element>("tcUrl",
+                "rtmp://localhost/oflaDemo"));
+    obj.addProperty(std::make_shared<Element>("fpad", false));
+    obj.addProperty(std::make_shared<Element>("capabilities", 15.0));
+    obj.addProperty(std::make_shared<Element>("audioCodecs", 3191.0));
+    obj.addProperty(std::make_shared<Element>("videoCodecs", 252.0));
+    obj.addProperty(std::make_shared<Element>("videoFunction", 1.0));
+    obj.addProperty(std::make_shared<Element>("pageUrl",
+                "http://localhost:5080/demos/ofla_demo.html"));
+    obj.addProperty(std::make_shared<Element>("objectEncoding", 0.0));
+
+    std::shared_ptr<Buffer> name = AMF::encodeString("connect");
+    std::shared_ptr<Buffer> id = AMF::encodeNumber(1);
+    std::shared_ptr<Buffer> body = AMF::encodeElement(obj);
+    std::shared_ptr<Buffer> buf(new Buffer(name->allocated() +
+                id->allocated() + body->allocated()));
+    *buf += name;
+    *buf += id;
+    *buf += body;
+    return buf;
+}
+
+std::shared_ptr<Buffer>
+elementsShared()
+{
+    Element obj;
+    obj.makeObject();
+    for (size_t i = 0; i < PROPERTIES; ++i) {
+        std::shared_ptr<Element> player(new Element);
+        player->makeObject(players[i]);
+        player->addProperty(std::make_shared<Element>("name", players[i]));
+        player->addProperty(std::make_shared<Element>("score", i * 100.0));
+        player->addProperty(std::make_shared<Element>("level",
+                    static_cast<double>(i % 10)));
+        player->addProperty(std::make_shared<Element>("active",
+                    static_cast<bool>(i & 1)));
+        obj.addProperty(player);
+    }
+
+    std::shared_ptr<Buffer> name = AMF::encodeString("scores");
+    std::shared_ptr<Buffer> body = AMF::encodeElement(obj);
+    std::shared_ptr<Buffer> buf(new Buffer(name->allocated() +
+                body->allocated()));
+    *buf += name;
+    *buf += body;
+    return buf;
+}
+
+// Decodes every value as decodeMsgBody() does.
+size_t
+decodeElements(const std::uint8_t* data, size_t size)
+{
+    AMF amf;
+    std::uint8_t* ptr = const_cast<std::uint8_t*>(data);
+    std::uint8_t* tooFar = ptr + size;
+    size_t count = 0;
+    while (ptr < tooFar) {
+        std::shared_ptr<Element> el = amf.extractAMF(ptr, tooFar);
+        if (!el) break;
+        ptr += amf.totalsize();
+        count += el->propertySize() + 1;
+    }
+    return count;
+}
+
+size_t
+decodeEvents(amf::Decoder& d, const std::uint8_t* data, size_t size)
+{
+    d.reset(data, data + size);
+    size_t count = 0;
+    amf::Decoder::Event e;
+    while ((e = d.next()) != amf::Decoder::NONE) {
+        switch (e) {
+            case amf::Decoder::STRING:
+            case amf::Decoder::KEY:
+                count += d.string().size;
+                break;
+            case amf::Decoder::NUMBER:
+                count += d.number() > 0;
+                break;
+            default:
+                ++count;
+        }
+    }
+    return count;
+}
+
+template<typename F>
+void
+measure(const char* name, size_t bytes, int iterations, F f)
+{
+    const std::chrono::steady_clock::time_point start
+        = std::chrono::steady_clock::now();
+    for (int i = 0; i < iterations; ++i) {
+        sink += f();
+    }
+    const double seconds = std::chrono::duration<double>
+        (std::chrono::steady_clock::now() - start).count();
+    cout << name << static_cast<long>(iterations / seconds) << " /s, "
+         << bytes * iterations / seconds / (1024 * 1024) << " MB/s" << endl;
+}
+
+void
+run(const char* title, void (*encode)(amf::Encoder&),
+        std::shared_ptr<Buffer> (*elements)(), int iterations)
+{
+    SimpleBuffer amf0;
+    amf::Encoder e0(amf0);
+    encode(e0);
+    SimpleBuffer amf3;
+    amf::Encoder e3(amf3, amf::AMF3);
+    encode(e3);
+
+    cout << title << ": " << amf0.size() << " bytes of AMF0, "
+         << amf3.size() << " bytes of AMF3" << endl;
+
+    measure("  decode, Elements:     ", amf0.size(), iterations, [&]() {
+        return decodeElements(amf0.data(), amf0.size());
+    });
+    amf::Decoder d(nullptr, nullptr);
+    measure("  decode, Decoder AMF0: ", amf0.size(), iterations, [&]() {
+        return decodeEvents(d, amf0.data(), amf0.size());
+    });
+    amf::Decoder d3(nullptr, nullptr, amf::AMF3);
+    measure("  decode, Decoder AMF3: ", amf3.size(), iterations, [&]() {
+        return decodeEvents(d3, amf3.data(), amf3.size());
+    });
+
+    // Element::encode() can't size every nested object.
+    try {
+        std::shared_ptr<Buffer> buf = elements();
+        measure("  encode, Elements:     ", buf->allocated(), iterations,
+                [&]() {
+            return elements()->allocated();
+        });
+    }
+    catch (const GnashException& e) {
+        cout << "  encode, Elements:     failed: " << e.what() << endl;
+    }
+    SimpleBuffer out;
+    measure("  encode, Encoder AMF0: ", amf0.size(), iterations, [&]() {
+        out.resize(0);
+        amf::Encoder e(out);
+        encode(e);
+        return out.size();
+    });
+    measure("  encode, Encoder AMF3: ", amf3.size(), iterations, [&]() {
+        out.resize(0);
+        amf::Encoder e(out, amf::AMF3);
+        encode(e);
+        return out.size();
+    });
+}
+
+} // anonymous namespace
+
+int
+main(int argc, char *argv[])
+{
+    const int iterations = (argc > 1) ? std::atoi(argv[1]) : 10000;
+
+    LogFile::getDefaultInstance().setVerbosity(0);
+
+    for (size_t i = 0; i < PROPERTIES; ++i) {
+        std::ostringstream key;
+        key << "player" << i;
+        players.push_back(key.str());
+    }
+
+    run("RTMP connect()", encodeConnect, elementsConnect, iterations);
+    run("SharedObject", encodeShared, elementsShared, iterations / 100);
+
+    return sink ? EXIT_SUCCESS : EXIT_FAILURE;
+}
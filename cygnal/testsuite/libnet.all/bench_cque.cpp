@@ -0,0 +1,132 @@
+//
+//   Copyright (C) 2008, 2009, 2010, 2011, 2012 Free Software Foundation, Inc.
+//
+// This program is free software; you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation; either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program; if not, write to the Free Software
+// Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+//
+
+// Measures how many packets a second pass through a CQue, from 1, 4
+// and 16 threads pushing to one thread popping, as the network
+// threads hand data to a protocol handler. The same is measured for
+// a que locked by a mutex, with a new Buffer for each packet, as
+// CQue was before it used a Ring and a BufferPool.
+//
+// This is not run as a test; build it with "make bench_cque". Build
+// libgnashnet with optimization, or the Ring is measured unoptimized.
+
+#ifdef HAVE_CONFIG_H
+#include "gnashconfig.h"
+#endif
+
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <cstdlib>
+#include <deque>
+#include <iostream>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include "log.h"
+#include "buffer.h"
+#include "cque.h"
+
+using namespace std;
+using namespace gnash;
+
+namespace {
+
+// The que as it was, a deque under a mutex.
+class LockedQue
+{
+public:
+    bool push(std::uint8_t *data, int nbytes) {
+        std::shared_ptr<cygnal::Buffer> buf(new cygnal::Buffer);
+        std::copy(data, data + nbytes, buf->reference());
+        std::lock_guard<std::mutex> lock(_mutex);
+        _que.push_back(buf);
+        return true;
+    }
+    std::shared_ptr<cygnal::Buffer> pop() {
+        std::shared_ptr<cygnal::Buffer> buf;
+        std::lock_guard<std::mutex> lock(_mutex);
+        if (_que.size()) {
+            buf = _que.front();
+            _que.pop_front();
+        }
+        return buf;
+    }
+private:
+    std::deque<std::shared_ptr<cygnal::Buffer> > _que;
+    std::mutex _mutex;
+};
+
+// Packets a second through a que.
+template <typename Que>
+double
+measure(int producers, int count, int size)
+{
+    Que que;
+    const std::chrono::steady_clock::time_point start
+        = std::chrono::steady_clock::now();
+    vector<std::thread> threads;
+    for (int p = 0; p < producers; ++p) {
+        threads.push_back(std::thread([&que, count, size]() {
+            vector<std::uint8_t> packet(size, 'x');
+            for (int i = 0; i < count; ++i) {
+                que.push(&packet[0], size);
+            }
+        }));
+    }
+    const long total = static_cast<long>(producers) * count;
+    for (long got = 0; got < total; ) {
+        if (que.pop()) {
+            ++got;
+        } else {
+            std::this_thread::yield();
+        }
+    }
+    for (size_t i = 0; i < threads.size(); ++i) {
+        threads[i].join();
+    }
+    const double seconds = std::chrono::duration<double>
+        (std::chrono::steady_clock::now() - start).count();
+    return total / seconds;
+}
+
+} // anonymous namespace
+
+int
+main(int argc, char *argv[])
+{
+    // The packets each thread pushes, and their size.
+    const int count = (argc > 1) ? std::atoi(argv[1]) : 200000;
+    const int size = (argc > 2) ? std::atoi(argv[2]) : 128;
+
+    LogFile::getDefaultInstance().setVerbosity(0);
+
+    cout << "producers  locked deque (packets/s)  CQue (packets/s)" << endl;
+    const int producers[] = { 1, 4, 16 };
+    for (size_t i = 0; i < sizeof(producers) / sizeof(producers[0]); ++i) {
+        const int each = count / producers[i];
+        const double locked = measure<LockedQue>(producers[i], each, size);
+        const double ring = measure<CQue>(producers[i], each, size);
+        cout << producers[i] << "\t   " << static_cast<long>(locked)
+             << "\t\t\t     " << static_cast<long>(ring)
+             << "  (" << ring / locked << "x)" << endl;
+    }
+
+    return EXIT_SUCCESS;
+}
@@ -0,0 +1,312 @@
+//
+//   Copyright (C) 2008, 2009, 2010, 2011, 2012 Free Software Foundation, Inc.
+//
+// This program is free software; you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation; either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program; if not, write to the Free Software
+// Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+//
+
+// A load generator for the Reactor. Client threads each open
+// connections one after another, send a request, and wait for the
+// reply, measuring the connections per second and the latency of
+// each. Then many idle connections are held open at once.
+//
+// Without a port it serves itself with an echo server in a Reactor.
+// With one, it loads a running server, such as cygnal's HTTP port:
+//
+//	bench_reactor -p 4080 -r "GET /index.html HTTP/1.0\r\n\r\n"
+//
+// This is not run as a test; build it with "make bench_reactor".
+
+#ifdef HAVE_CONFIG_H
+#include "gnashconfig.h"
+#endif
+
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <sys/resource.h>
+#include <sys/socket.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <arpa/inet.h>
+#include <unistd.h>
+#include <getopt.h>
+
+#include "log.h"
+#include "reactor.h"
+
+using namespace std;
+using namespace gnash;
+
+namespace {
+
+typedef std::chrono::steady_clock clock_type;
+
+#ifdef HAVE_SYS_EPOLL_H
+class Echo : public Reactor::Connection
+{
+public:
+    Echo(int fd) : Reactor::Connection(fd) {}
+
+    bool processInput() {
+        write(input(), bytesReady());
+        consume(bytesReady());
+        return true;
+    }
+};
+
+std::shared_ptr<Reactor::Connection>
+makeEcho(int fd)
+{
+    return std::make_shared<Echo>(fd);
+}
+#endif
+
+int
+connectTo(const struct sockaddr_in &addr)
+{
+    int fd = socket(AF_INET, SOCK_STREAM, 0);
+    if (fd < 0) {
+        return -1;
+    }
+    if (connect(fd, reinterpret_cast<const struct sockaddr *>(&addr),
+                sizeof(addr)) < 0) {
+        ::close(fd);
+        return -1;
+    }
+    const int on = 1;
+    setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &on, sizeof(on));
+    return fd;
+}
+
+// Connect, send the request, and read the reply. An echo server
+// replies with as many bytes as sent, other servers close the
+// connection after replying.
+bool
+transact(const struct sockaddr_in &addr, const string &request, bool echo)
+{
+    int fd = connectTo(addr);
+    if (fd < 0) {
+        return false;
+    }
+    bool ok = ::write(fd, request.data(), request.size())
+        == static_cast<ssize_t>(request.size());
+    size_t got = 0;
+    char buf[16384];
+    while (ok) {
+        ssize_t ret = ::read(fd, buf, sizeof(buf));
+        if (ret <= 0) {
+            ok = !echo;
+            break;
+        }
+        got += ret;
+        if (echo && got >= request.size()) {
+            break;
+        }
+    }
+    ::close(fd);
+    return ok && got;
+}
+
+double
+percentile(vector<double> &times, double p)
+{
+    if (times.empty()) {
+        return 0;
+    }
+    const size_t n = std::min(times.size() - 1,
+                              static_cast<size_t>(p * times.size()));
+    std::nth_element(times.begin(), times.begin() + n, times.end());
+    return times[n];
+}
+
+void
+usage()
+{
+    cerr << "Usage: bench_reactor [options]" << endl
+         << "  -c clients    Client threads (default 8)" << endl
+         << "  -n count      Connections made by each client (default 2000)"
+         << endl
+         << "  -i idle       Idle connections to hold (default 10000)" << endl
+         << "  -w workers    Reactor workers when serving itself (default 0,"
+            " one per cpu)" << endl
+         << "  -p port       Load a server on this port instead" << endl
+         << "  -r request    The request to send" << endl;
+}
+
+} // anonymous namespace
+
+int
+main(int argc, char *argv[])
+{
+    size_t clients = 8;
+    size_t count = 2000;
+    size_t idle = 10000;
+    size_t workers = 0;
+    int port = 0;
+    string request(64, 'x');
+
+    int c;
+    while ((c = getopt(argc, argv, "c:n:i:w:p:r:h")) != -1) {
+        switch (c) {
+          case 'c': clients = std::strtoul(optarg, 0, 10); break;
+          case 'n': count = std::strtoul(optarg, 0, 10); break;
+          case 'i': idle = std::strtoul(optarg, 0, 10); break;
+          case 'w': workers = std::strtoul(optarg, 0, 10); break;
+          case 'p': port = std::atoi(optarg); break;
+          case 'r':
+          {
+              // Allow "\r\n" to be given on the command line.
+              request = optarg;
+              string::size_type pos;
+              while ((pos = request.find("\\r\\n")) != string::npos) {
+                  request.replace(pos, 4, "\r\n");
+              }
+              break;
+          }
+          default: usage(); return EXIT_FAILURE;
+        }
+    }
+
+    LogFile::getDefaultInstance().setVerbosity(0);
+
+    // Each idle connection needs two descriptors when serving itself.
+    struct rlimit limit;
+    if (getrlimit(RLIMIT_NOFILE, &limit) == 0) {
+        limit.rlim_cur = limit.rlim_max;
+        setrlimit(RLIMIT_NOFILE, &limit);
+        const size_t most = (limit.rlim_cur - 64) / (port ? 1 : 2);
+        if (idle > most) {
+            cerr << "Only " << most << " idle connections fit in the "
+                 << "descriptor limit" << endl;
+            idle = most;
+        }
+    }
+
+    struct sockaddr_in addr;
+    std::memset(&addr, 0, sizeof(addr));
+    addr.sin_family = AF_INET;
+    addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+
+    const bool echo = !port;
+#ifdef HAVE_SYS_EPOLL_H
+    std::unique_ptr<Reactor> reactor;
+    int lfd = -1;
+    if (echo) {
+        lfd = socket(AF_INET, SOCK_STREAM, 0);
+        bind(lfd, reinterpret_cast<struct sockaddr *>(&addr), sizeof(addr));
+        listen(lfd, 4096);
+        socklen_t len = sizeof(addr);
+        getsockname(lfd, reinterpret_cast<struct sockaddr *>(&addr), &len);
+        reactor.reset(new Reactor(workers));
+        reactor->addListener(lfd, makeEcho);
+        reactor->start();
+        cout << "Serving with " << reactor->workers() << " workers" << endl;
+    } else
+#else
+    if (echo) {
+        cerr << "The Reactor needs epoll, give the port of a server" << endl;
+        return EXIT_FAILURE;
+    } else
+#endif
+    {
+        addr.sin_port = htons(port);
+    }
+
+    // Short connections, one after the other in each client.
+    vector<vector<double> > times(clients);
+    vector<size_t> failed(clients, 0);
+    vector<std::thread> threads;
+    const clock_type::time_point start = clock_type::now();
+    for (size_t i = 0; i < clients; ++i) {
+        threads.push_back(std::thread([&, i]() {
+            for (size_t j = 0; j < count; ++j) {
+                const clock_type::time_point t0 = clock_type::now();
+                if (!transact(addr, request, echo)) {
+                    ++failed[i];
+                    continue;
+                }
+                times[i].push_back(std::chrono::duration<double, std::micro>
+                                   (clock_type::now() - t0).count());
+            }
+        }));
+    }
+    for (size_t i = 0; i < threads.size(); ++i) {
+        threads[i].join();
+    }
+    const double seconds = std::chrono::duration<double>
+        (clock_type::now() - start).count();
+
+    vector<double> all;
+    size_t failures = 0;
+    for (size_t i = 0; i < clients; ++i) {
+        all.insert(all.end(), times[i].begin(), times[i].end());
+        failures += failed[i];
+    }
+    cout << all.size() << " connections in " << seconds << " s: "
+         << all.size() / seconds << " connections/s, "
+         << failures << " failed" << endl;
+    cout << "latency p50 " << percentile(all, 0.50) << " us, p99 "
+         << percentile(all, 0.99) << " us, max "
+         << percentile(all, 1.0) << " us" << endl;
+
+    // Idle connections, then one more request among them.
+    vector<int> held;
+    const clock_type::time_point open = clock_type::now();
+    for (size_t i = 0; i < idle; ++i) {
+        int fd = connectTo(addr);
+        if (fd < 0) {
+            break;
+        }
+        held.push_back(fd);
+    }
+    const double opened = std::chrono::duration<double>
+        (clock_type::now() - open).count();
+    vector<double> busy;
+    for (int i = 0; i < 100; ++i) {
+        const clock_type::time_point t0 = clock_type::now();
+        if (transact(addr, request, echo)) {
+            busy.push_back(std::chrono::duration<double, std::micro>
+                           (clock_type::now() - t0).count());
+        }
+    }
+    cout << "held " << held.size() << " idle connections, opened in "
+         << opened << " s";
+#ifdef HAVE_SYS_EPOLL_H
+    if (reactor) {
+        cout << " (" << reactor->connections() << " in the reactor)";
+    }
+#endif
+    cout << endl << "latency among them p99 " << percentile(busy, 0.99)
+         << " us" << endl;
+
+    for (size_t i = 0; i < held.size(); ++i) {
+        ::close(held[i]);
+    }
+#ifdef HAVE_SYS_EPOLL_H
+    if (reactor) {
+        reactor->stop();
+        ::close(lfd);
+    }
+#endif
+
+    return failures ? EXIT_FAILURE : EXIT_SUCCESS;
+}
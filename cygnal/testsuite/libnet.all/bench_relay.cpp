@@ -0,0 +1,381 @@
+//
+//   Copyright (C) 2008, 2009, 2010, 2011, 2012 Free Software Foundation, Inc.
+//
+// This program is free software; you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation; either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program; if not, write to the Free Software
+// Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+//
+
+// Relays one published stream to many subscribers over loopback
+// connections driven by a Reactor, with one thread reading all the
+// subscriber ends. The stream is published as fast as it can be sent,
+// and the messages a second relayed and the bytes delivered are
+// measured until every subscriber has all it was sent. The Relay is
+// compared with chunking a copy of each message for each subscriber,
+// as RTMP::sendMsg() does when called for every client, with nothing
+// dropped. Then the Relay is run again with its usual queue limit, so
+// subscribers that fall behind have frames dropped.
+//
+//	bench_relay [subscribers [frames]]
+//
+// This is not run as a test; build it with "make bench_relay".
+
+#ifdef HAVE_CONFIG_H
+#include "gnashconfig.h"
+#endif
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include <sys/epoll.h>
+#include <sys/resource.h>
+#include <sys/socket.h>
+#include <netinet/in.h>
+#include <arpa/inet.h>
+#include <fcntl.h>
+#include <unistd.h>
+
+#include "log.h"
+#include "reactor.h"
+#include "relay.h"
+#include "rtmp.h"
+#include "rtmp_msg.h"
+
+using namespace std;
+using namespace gnash;
+
+namespace {
+
+const char *STREAM = "localhost/live/bench";
+
+class Sink : public Reactor::Connection
+{
+public:
+    Sink(int fd) : Reactor::Connection(fd) {}
+
+    bool processInput() {
+        consume(bytesReady());
+        return true;
+    }
+};
+
+std::mutex accepted_mutex;
+vector<std::shared_ptr<Reactor::Connection> > accepted;
+
+std::shared_ptr<Reactor::Connection>
+makeSink(int fd)
+{
+    std::shared_ptr<Reactor::Connection> conn = std::make_shared<Sink>(fd);
+    std::lock_guard<std::mutex> lock(accepted_mutex);
+    accepted.push_back(conn);
+    return conn;
+}
+
+int
+listenLocal(short &port)
+{
+    int fd = socket(AF_INET, SOCK_STREAM, 0);
+    struct sockaddr_in addr;
+    std::memset(&addr, 0, sizeof(addr));
+    addr.sin_family = AF_INET;
+    addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    addr.sin_port = 0;
+    bind(fd, reinterpret_cast<struct sockaddr *>(&addr), sizeof(addr));
+    listen(fd, 1024);
+    socklen_t len = sizeof(addr);
+    getsockname(fd, reinterpret_cast<struct sockaddr *>(&addr), &len);
+    port = ntohs(addr.sin_port);
+    return fd;
+}
+
+int
+connectLocal(short port)
+{
+    int fd = socket(AF_INET, SOCK_STREAM, 0);
+    struct sockaddr_in addr;
+    std::memset(&addr, 0, sizeof(addr));
+    addr.sin_family = AF_INET;
+    addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    addr.sin_port = htons(port);
+    if (connect(fd, reinterpret_cast<struct sockaddr *>(&addr),
+                sizeof(addr)) < 0) {
+        ::close(fd);
+        return -1;
+    }
+    fcntl(fd, F_SETFL, fcntl(fd, F_GETFL) | O_NONBLOCK);
+    return fd;
+}
+
+// Reads everything the subscribers get.
+class Reader
+{
+public:
+    Reader(const vector<int> &fds)
+        : _epoll(epoll_create1(0)),
+          _bytes(0),
+          _done(false)
+    {
+        for (size_t i = 0; i < fds.size(); ++i) {
+            struct epoll_event ev;
+            ev.events = EPOLLIN;
+            ev.data.fd = fds[i];
+            epoll_ctl(_epoll, EPOLL_CTL_ADD, fds[i], &ev);
+        }
+        _thread = std::thread([this]() { run(); });
+    }
+
+    ~Reader() {
+        _done = true;
+        _thread.join();
+        ::close(_epoll);
+    }
+
+    size_t bytes() const { return _bytes; }
+
+private:
+    void run() {
+        struct epoll_event events[256];
+        vector<char> buf(64 * 1024);
+        while (!_done) {
+            int ready = epoll_wait(_epoll, events, 256, 50);
+            for (int i = 0; i < ready; ++i) {
+                ssize_t ret;
+                while ((ret = ::read(events[i].data.fd, &buf[0],
+                                     buf.size())) > 0) {
+                    _bytes += ret;
+                }
+            }
+        }
+    }
+
+    int _epoll;
+    std::atomic<size_t> _bytes;
+    std::atomic<bool> _done;
+    std::thread _thread;
+};
+
+// Fans out through the Relay.
+class Shared
+{
+public:
+    Shared(const vector<std::shared_ptr<Reactor::Connection> > &conns,
+           size_t limit)
+        : _relay(limit)
+    {
+        _relay.addPublisher(STREAM);
+        for (size_t i = 0; i < conns.size(); ++i) {
+            _relay.subscribe(STREAM, conns[i], 1);
+        }
+    }
+
+    void publish(RTMP::content_types_e type, std::uint32_t timestamp,
+                 const vector<std::uint8_t> &data) {
+        _relay.publish(STREAM, type, timestamp, &data[0], data.size());
+    }
+
+    size_t dropped() const { return _relay.dropped(); }
+
+private:
+    Relay _relay;
+};
+
+// Chunks a copy for each subscriber.
+class Copying
+{
+public:
+    Copying(const vector<std::shared_ptr<Reactor::Connection> > &conns,
+            size_t limit)
+        : _conns(conns),
+          _limit(limit),
+          _dropped(0)
+    {
+    }
+
+    void publish(RTMP::content_types_e type, std::uint32_t /* timestamp */,
+                 const vector<std::uint8_t> &data) {
+        const int channel = (type == RTMP::AUDIO_DATA)
+            ? Relay::AUDIO_CHANNEL : Relay::VIDEO_CHANNEL;
+        for (size_t i = 0; i < _conns.size(); ++i) {
+            if (_conns[i]->bytesQueued() > _limit) {
+                ++_dropped;
+                continue;
+            }
+            std::shared_ptr<vector<std::uint8_t> > buf(
+                new vector<std::uint8_t>(RTMP_MAX_HEADER_SIZE + data.size()
+                                         + data.size() / Relay::CHUNK_SIZE));
+            vector<std::uint8_t> &out = *buf;
+            size_t nbytes = _rtmp.encodeHeader(&out[0], channel,
+                                RTMP::HEADER_12, data.size(), type,
+                                RTMPMsg::FROM_SERVER);
+            for (size_t j = 0; j < data.size(); j += Relay::CHUNK_SIZE) {
+                if (j) {
+                    nbytes += _rtmp.encodeHeader(&out[nbytes], channel,
+                                                 RTMP::HEADER_1);
+                }
+                const size_t partial = std::min<size_t>(Relay::CHUNK_SIZE,
+                                                        data.size() - j);
+                std::copy(data.begin() + j, data.begin() + j + partial,
+                          out.begin() + nbytes);
+                nbytes += partial;
+            }
+            _conns[i]->write(buf, &out[0], nbytes);
+        }
+    }
+
+    size_t dropped() const { return _dropped; }
+
+private:
+    vector<std::shared_ptr<Reactor::Connection> > _conns;
+    RTMP _rtmp;
+    const size_t _limit;
+    size_t _dropped;
+};
+
+struct Result {
+    double seconds;
+    size_t messages;
+    size_t bytes;
+    size_t dropped;
+};
+
+// Publish 30 frames a second video, a keyframe a second, with audio
+// between the frames, as fast as it can be relayed.
+template <typename Fanout>
+Result
+measure(const vector<std::shared_ptr<Reactor::Connection> > &conns,
+        const vector<int> &fds, int frames, size_t limit)
+{
+    Reader reader(fds);
+    Fanout fanout(conns, limit);
+    vector<std::uint8_t> key(30000, 0x12);
+    vector<std::uint8_t> inter(4000, 0x22);
+    vector<std::uint8_t> audio(400, 0x2f);
+
+    const std::chrono::steady_clock::time_point start
+        = std::chrono::steady_clock::now();
+    for (int i = 0; i < frames; ++i) {
+        fanout.publish(RTMP::VIDEO_DATA, i * 33,
+                       (i % 30 == 0) ? key : inter);
+        fanout.publish(RTMP::AUDIO_DATA, i * 33 + 16, audio);
+    }
+
+    // Wait for every subscriber to get all it was sent.
+    size_t last = 0;
+    while (true) {
+        std::this_thread::sleep_for(std::chrono::milliseconds(20));
+        size_t queued = 0;
+        for (size_t i = 0; i < conns.size(); ++i) {
+            queued += conns[i]->bytesQueued();
+        }
+        if (!queued && reader.bytes() == last) {
+            break;
+        }
+        last = reader.bytes();
+    }
+
+    Result result;
+    result.seconds = std::chrono::duration<double>
+        (std::chrono::steady_clock::now() - start).count();
+    result.dropped = fanout.dropped();
+    result.messages = frames * 2 * conns.size() - result.dropped;
+    result.bytes = reader.bytes();
+    return result;
+}
+
+void
+report(const char *name, const Result &result, size_t total)
+{
+    cout << name << " " << static_cast<long>(result.messages / result.seconds)
+         << " messages/s, "
+         << result.bytes / result.seconds / (1024 * 1024) << " MB/s, "
+         << 100.0 * result.dropped / total << "% dropped" << endl;
+}
+
+} // anonymous namespace
+
+int
+main(int argc, char *argv[])
+{
+    size_t subscribers = (argc > 1) ? std::atoi(argv[1]) : 1000;
+    const int frames = (argc > 2) ? std::atoi(argv[2]) : 300;
+
+    LogFile::getDefaultInstance().setVerbosity(0);
+
+    // Each subscriber takes two descriptors.
+    struct rlimit limit;
+    if (getrlimit(RLIMIT_NOFILE, &limit) == 0) {
+        limit.rlim_cur = limit.rlim_max;
+        setrlimit(RLIMIT_NOFILE, &limit);
+        const size_t most = (limit.rlim_cur - 64) / 2;
+        if (subscribers > most) {
+            cerr << "Only " << most << " subscribers fit in the "
+                 << "descriptor limit" << endl;
+            subscribers = most;
+        }
+    }
+
+    short port;
+    int lfd = listenLocal(port);
+    Reactor reactor(0);
+    reactor.start();
+    reactor.addListener(lfd, makeSink);
+
+    vector<int> fds;
+    for (size_t i = 0; i < subscribers; ++i) {
+        int fd = connectLocal(port);
+        if (fd < 0) {
+            cerr << "Couldn't connect subscriber " << i << endl;
+            return EXIT_FAILURE;
+        }
+        fds.push_back(fd);
+    }
+    while (reactor.connections() < subscribers) {
+        std::this_thread::sleep_for(std::chrono::milliseconds(10));
+    }
+    vector<std::shared_ptr<Reactor::Connection> > conns;
+    {
+        std::lock_guard<std::mutex> lock(accepted_mutex);
+        conns.swap(accepted);
+    }
+
+    const size_t total = frames * 2 * subscribers;
+    cout << subscribers << " subscribers, " << frames << " frames, "
+         << reactor.workers() << " workers" << endl;
+    const size_t unlimited = static_cast<size_t>(-1);
+    const Result copying = measure<Copying>(conns, fds, frames, unlimited);
+    report("copy each:     ", copying, total);
+    const Result shared = measure<Shared>(conns, fds, frames, unlimited);
+    report("Relay:         ", shared, total);
+    cout << "               (" << (shared.messages / shared.seconds)
+        / (copying.messages / copying.seconds) << "x)" << endl;
+    const Result limited = measure<Shared>(conns, fds, frames,
+                                           Relay::QUEUE_LIMIT);
+    report("Relay, limited:", limited, total);
+
+    conns.clear();
+    reactor.stop();
+    for (size_t i = 0; i < fds.size(); ++i) {
+        ::close(fds[i]);
+    }
+    ::close(lfd);
+
+    return EXIT_SUCCESS;
+}
@@ -0,0 +1,273 @@
+//
+//   Copyright (C) 2008, 2009, 2010, 2011, 2012 Free Software Foundation, Inc.
+//
+// This program is free software; you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation; either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program; if not, write to the Free Software
+// Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+//
+
+// Replays an RTMP stream through the chunk parser, in reads of the
+// size cygnal makes, and measures the messages and bytes a second.
+// RTMP::parse() is compared with reassembling the messages the way
+// RTMP::split() does, with a new header and a new Buffer for each
+// message, and a new RTMPMsg for each Invoke decoded.
+//
+// The stream is a file holding the chunks one end sent after the
+// handshake, as saved from a packet capture. Without one, a stream
+// of audio and video at the default chunk size is made up:
+//
+//	bench_rtmp [file [repeat]]
+//
+// This is not run as a test; build it with "make bench_rtmp".
+
+#ifdef HAVE_CONFIG_H
+#include "gnashconfig.h"
+#endif
+
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <iterator>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "log.h"
+#include "buffer.h"
+#include "rtmp.h"
+#include "rtmp_msg.h"
+
+using namespace std;
+using namespace gnash;
+
+namespace {
+
+// As much as RTMP::recvMsg() reads at once.
+const size_t READ_SIZE = 3074;
+
+// A few seconds of 30 frames a second video, with audio between the
+// frames, and a status message now and then.
+vector<std::uint8_t>
+makeStream(RTMP &rtmp)
+{
+    const std::uint8_t result[] = {
+        0x02, 0x00, 0x07, '_', 'r', 'e', 's', 'u', 'l', 't',
+        0x00, 0x3f, 0xf0, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x05 };
+
+    vector<std::uint8_t> stream;
+    vector<std::uint8_t> body;
+    for (int frame = 0; frame < 300; ++frame) {
+        RTMP::content_types_e type;
+        int channel;
+        if (frame % 30 == 0) {
+            type = RTMP::INVOKE;
+            channel = 3;
+            body.assign(result, result + sizeof(result));
+        } else if (frame % 2) {
+            type = RTMP::AUDIO_DATA;
+            channel = 4;
+            body.assign(200, frame);
+        } else {
+            type = RTMP::VIDEO_DATA;
+            channel = 5;
+            body.assign((frame % 60 == 2) ? 20000 : 3000, frame);
+        }
+        std::uint8_t head[RTMP_MAX_HEADER_SIZE];
+        size_t nbytes = rtmp.encodeHeader(head, channel, RTMP::HEADER_8,
+                              body.size(), type, RTMPMsg::FROM_SERVER);
+        stream.insert(stream.end(), head, head + nbytes);
+        for (size_t i = 0; i < body.size(); i += RTMP_VIDEO_PACKET_SIZE) {
+            if (i) {
+                rtmp.encodeHeader(head, channel, RTMP::HEADER_1);
+                stream.push_back(head[0]);
+            }
+            size_t partial = std::min<size_t>(RTMP_VIDEO_PACKET_SIZE,
+                                              body.size() - i);
+            stream.insert(stream.end(), body.begin() + i,
+                          body.begin() + i + partial);
+        }
+    }
+    return stream;
+}
+
+// Reassembles the messages as RTMP::split() does.
+class Allocating
+{
+public:
+    Allocating()
+        : _chunksize(RTMP_VIDEO_PACKET_SIZE),
+          _messages(0)
+    {
+        std::fill(_lastsize, _lastsize + MAX_AMF_INDEXES, 0);
+    }
+
+    int parse(const std::uint8_t *data, size_t size) {
+        const std::uint8_t *ptr = data;
+        const std::uint8_t *end = data + size;
+        while (ptr < end) {
+            const size_t head_size = _rtmp.headerSize(*ptr);
+            if (static_cast<size_t>(end - ptr) < head_size) {
+                break;
+            }
+            const int channel = *ptr & RTMP_INDEX_MASK;
+            std::shared_ptr<cygnal::Buffer> &msg = _partial[channel];
+            size_t bodysize = _lastsize[channel];
+            if (msg) {
+                bodysize = msg->size();
+            } else if (head_size >= 8) {
+                bodysize = (ptr[4] << 16) + (ptr[5] << 8) + ptr[6];
+            }
+            const size_t received = msg ? msg->allocated() : 0;
+            const size_t chunk = std::min(bodysize - received, _chunksize);
+            if (static_cast<size_t>(end - ptr) < head_size + chunk) {
+                break;
+            }
+            std::shared_ptr<RTMP::rtmp_head_t> head =
+                _rtmp.decodeHeader(const_cast<std::uint8_t *>(ptr));
+            if (!head) {
+                return -1;
+            }
+            _lastsize[channel] = head->bodysize;
+            if (!msg) {
+                msg.reset(new cygnal::Buffer(head->bodysize));
+            }
+            msg->append(const_cast<std::uint8_t *>(ptr) + head_size, chunk);
+            ptr += head_size + chunk;
+            if (msg->allocated() == static_cast<size_t>(head->bodysize)) {
+                _queues[channel].push(msg);
+                std::shared_ptr<cygnal::Buffer> done = _queues[channel].pop();
+                msg.reset();
+                if (head->type == RTMP::CHUNK_SIZE) {
+                    std::uint32_t size;
+                    std::memcpy(&size, done->reference(), sizeof(size));
+                    _chunksize = ntohl(size);
+                } else if (head->type == RTMP::INVOKE) {
+                    std::shared_ptr<RTMPMsg> body =
+                        _rtmp.decodeMsgBody(*done);
+                }
+                ++_messages;
+            }
+        }
+        return ptr - data;
+    }
+
+    size_t messages() { return _messages; }
+
+private:
+    RTMP _rtmp;
+    size_t _chunksize;
+    size_t _lastsize[MAX_AMF_INDEXES];
+    std::shared_ptr<cygnal::Buffer> _partial[MAX_AMF_INDEXES];
+    CQue _queues[MAX_AMF_INDEXES];
+    size_t _messages;
+};
+
+// Reassembles the messages with RTMP::parse().
+class Reusing
+{
+public:
+    Reusing()
+        : _messages(0),
+          _handler([this](const RTMP::rtmp_head_t &head,
+                          const std::uint8_t *body) {
+                        if (head.type == RTMP::INVOKE) {
+                            _rtmp.decodeMsgBody(body, head.bodysize, _msg);
+                        }
+                        ++_messages;
+                        return true;
+                    })
+    {
+    }
+
+    int parse(const std::uint8_t *data, size_t size) {
+        return _rtmp.parse(data, size, _handler);
+    }
+
+    size_t messages() { return _messages; }
+
+private:
+    RTMP _rtmp;
+    RTMPMsg _msg;
+    size_t _messages;
+    RTMP::msg_handler_t _handler;
+};
+
+// Messages a second through a parser, and the messages in the stream.
+template <typename Parser>
+double
+measure(const vector<std::uint8_t> &stream, int repeat, size_t &messages)
+{
+    Parser parser;
+    vector<std::uint8_t> input;
+    const std::chrono::steady_clock::time_point start
+        = std::chrono::steady_clock::now();
+    for (int r = 0; r < repeat; ++r) {
+        for (size_t i = 0; i < stream.size(); i += READ_SIZE) {
+            const size_t nbytes = std::min(READ_SIZE, stream.size() - i);
+            input.insert(input.end(), stream.begin() + i,
+                         stream.begin() + i + nbytes);
+            const int used = parser.parse(&input[0], input.size());
+            if (used < 0) {
+                cerr << "The stream is corrupted" << endl;
+                exit(EXIT_FAILURE);
+            }
+            input.erase(input.begin(), input.begin() + used);
+        }
+    }
+    const double seconds = std::chrono::duration<double>
+        (std::chrono::steady_clock::now() - start).count();
+    messages = parser.messages() / repeat;
+    return parser.messages() / seconds;
+}
+
+} // anonymous namespace
+
+int
+main(int argc, char *argv[])
+{
+    LogFile::getDefaultInstance().setVerbosity(0);
+
+    vector<std::uint8_t> stream;
+    if (argc > 1) {
+        std::ifstream in(argv[1], std::ios::binary);
+        if (!in) {
+            cerr << "Couldn't open " << argv[1] << endl;
+            return EXIT_FAILURE;
+        }
+        stream.assign(std::istreambuf_iterator<char>(in),
+                      std::istreambuf_iterator<char>());
+    } else {
+        RTMP rtmp;
+        stream = makeStream(rtmp);
+    }
+    const int repeat = (argc > 2) ? std::atoi(argv[2]) : 20;
+
+    size_t messages = 0;
+    const double allocating = measure<Allocating>(stream, repeat, messages);
+    const double reusing = measure<Reusing>(stream, repeat, messages);
+    const double mbytes = static_cast<double>(stream.size()) / messages
+        / (1024 * 1024);
+
+    cout << messages << " messages in " << stream.size() << " bytes" << endl;
+    cout << "allocating: " << static_cast<long>(allocating) << " messages/s, "
+         << allocating * mbytes << " MB/s" << endl;
+    cout << "parse():    " << static_cast<long>(reusing) << " messages/s, "
+         << reusing * mbytes << " MB/s  (" << reusing / allocating << "x)"
+         << endl;
+
+    return EXIT_SUCCESS;
+}
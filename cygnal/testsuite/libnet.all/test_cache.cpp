@@ -58,6 +58,7 @@ static void usage (void);
 static void test (void);
 static void test_errors (void);
 static void test_remove (void);
+static void test_segments (void);
 static void create_file(const std::string &, size_t);
 
 static bool dump = false;
@@ -108,11 +109,13 @@ main(int argc, char *argv[])
     test();
     test_errors();
     test_remove();
+    test_segments();
 
     unlink("outbuf1.raw");
     unlink("outbuf2.raw");
     unlink("outbuf3.raw");
     unlink("outbuf4.raw");
+    unlink("outbuf5.raw");
 }
 
 static void
@@ -345,6 +348,80 @@ test_errors (void)
 //      }
 }
 
+static void
+test_segments (void)
+{
+    Cache cache;
+
+    // The data written by create_file()
+    const int range = '~' - '!';
+    const size_t size = SEGMENT_SIZE * 2 + SEGMENT_SIZE / 2;
+    create_file("outbuf5.raw", size);
+
+    std::shared_ptr<FileSegment> first = cache.findSegment("outbuf5.raw", 10);
+    if (first && (first->offset() == 0) && (first->size() == SEGMENT_SIZE)
+        && (first->getFileSize() == static_cast<off_t>(size))
+        && (first->data()[10] == '!' + 10)) {
+        runtest.pass("Cache::findSegment(first)");
+    } else {
+        runtest.fail("Cache::findSegment(first)");
+    }
+
+    std::shared_ptr<FileSegment> last = cache.findSegment("outbuf5.raw", size - 1);
+    const off_t start = SEGMENT_SIZE * 2;
+    if (last && (last->offset() == start) && (last->size() == SEGMENT_SIZE / 2)
+        && (last->data()[0] == '!' + (start % range))
+        && (last->getFileFd() == first->getFileFd())) {
+        runtest.pass("Cache::findSegment(last)");
+    } else {
+        runtest.fail("Cache::findSegment(last)");
+    }
+
+    if (!cache.findSegment("outbuf5.raw", size)
+        && !cache.findSegment("nonexistent.raw", 0)) {
+        runtest.pass("Cache::findSegment(past the end)");
+    } else {
+        runtest.fail("Cache::findSegment(past the end)");
+    }
+
+    if ((cache.findSegment("outbuf5.raw", 0) == first)
+        && (cache.getSegmentBytes() == SEGMENT_SIZE + SEGMENT_SIZE / 2)) {
+        runtest.pass("Cache::findSegment(again)");
+    } else {
+        runtest.fail("Cache::findSegment(again)");
+    }
+
+    // The least recently used segment goes first, but stays mapped
+    // for those still using it.
+    cache.findSegment("outbuf5.raw", SEGMENT_SIZE);
+    cache.setSegmentLimit(SEGMENT_SIZE * 2);
+    if ((cache.getSegmentBytes() == SEGMENT_SIZE * 2)
+        && (cache.findSegment("outbuf5.raw", 0) == first)
+        && (cache.findSegment("outbuf5.raw", start) != last)
+        && (last->data()[1] == '!' + ((start + 1) % range))) {
+        runtest.pass("Cache::setSegmentLimit()");
+    } else {
+        runtest.fail("Cache::setSegmentLimit()");
+    }
+
+    // A changed file is mapped again.
+    create_file("outbuf5.raw", 100);
+    std::shared_ptr<FileSegment> changed = cache.findSegment("outbuf5.raw", 0);
+    if (changed && (changed != first) && (changed->size() == 100)
+        && (cache.getSegmentBytes() == 100)) {
+        runtest.pass("Cache::findSegment(changed file)");
+    } else {
+        runtest.fail("Cache::findSegment(changed file)");
+    }
+
+    cache.removeSegments("outbuf5.raw");
+    if (cache.getSegmentBytes() == 0) {
+        runtest.pass("Cache::removeSegments()");
+    } else {
+        runtest.fail("Cache::removeSegments()");
+    }
+}
+
 /// \brief create a test file to read in later. This lets us create
 /// files of arbitrary sizes.
 void
@@ -37,6 +37,7 @@
 #include <cstring>
 #include <vector>
 #include <cstdint>
+#include <thread>
 
 #ifdef HAVE_DEJAGNU_H
 #include "dejagnu.h"
@@ -48,6 +49,7 @@
 #include "buffer.h"
 #include "network.h"
 #include "cque.h"
+#include "ring.h"
 #include "amf.h"
 
 using namespace cygnal;
@@ -168,5 +170,98 @@ main (int /*argc*/, char** /*argv*/) {
 
 //     que.pop();
 
+     // The ring is bounded, and sized in powers of two.
+     Ring<int> ring(5);
+     int value = 0;
+     bool full = ring.pop(value) == false;
+     for (int j = 0; j < 8; ++j) {
+         full = full && ring.push(j);
+     }
+     full = full && !ring.push(8) && (ring.size() == 8) && (*ring.front() == 0);
+     for (int j = 0; j < 8; ++j) {
+         full = full && ring.pop(value) && (value == j);
+     }
+     if (full && (ring.capacity() == 8) && ring.empty() && !ring.front()) {
+         runtest.pass("Ring::push() and Ring::pop()");
+     } else {
+         runtest.fail("Ring::push() and Ring::pop()");
+     }
+
+     // More than the ring holds waits in the overflow, in order.
+     CQue small("small", 16);
+     std::vector<std::shared_ptr<cygnal::Buffer> > bufs;
+     for (int j = 0; j < 100; ++j) {
+         bufs.push_back(std::shared_ptr<cygnal::Buffer>(new Buffer(8)));
+         small.push(bufs.back());
+     }
+     bool inorder = (small.size() == 100) && (small.peek() == bufs[0])
+         && (small[50] == bufs[50]);
+     for (int j = 0; j < 100; ++j) {
+         inorder = inorder && (small.pop() == bufs[j]);
+     }
+     if (inorder && (small.size() == 0) && !small.pop()) {
+         runtest.pass("CQue overflow");
+     } else {
+         runtest.fail("CQue overflow");
+     }
+
+     // Raw data goes in pooled Buffers, which are used again.
+     BufferPool &pool = BufferPool::getDefaultInstance();
+     std::uint8_t data[] = "hello";
+     small.push(data, 5);
+     std::shared_ptr<cygnal::Buffer> pooled = small.pop();
+     const std::uint8_t *storage = pooled->reference();
+     const size_t available = pool.available();
+     const bool copied = pooled->allocated() == 5
+         && std::equal(data, data + 5, pooled->reference());
+     pooled.reset();
+     if (copied && (pool.available() == available + 1)) {
+         small.push(data, 3);
+         pooled = small.pop();
+     }
+     if (copied && pooled && (pooled->reference() == storage)
+         && (pooled->allocated() == 3)) {
+         runtest.pass("CQue::push(data) uses the BufferPool");
+     } else {
+         runtest.fail("CQue::push(data) uses the BufferPool");
+     }
+     pooled.reset();
+
+     // Many threads push at once, and each one's Buffers come out in
+     // the order they went in.
+     const int PRODUCERS = 4;
+     const int COUNT = 20000;
+     CQue shared("shared", 64);
+     std::vector<std::thread> producers;
+     for (int p = 0; p < PRODUCERS; ++p) {
+         producers.push_back(std::thread([&shared, p, COUNT]() {
+             for (int j = 0; j < COUNT; ++j) {
+                 std::uint8_t id[2] = { std::uint8_t(p), std::uint8_t(j % 256) };
+                 shared.push(id, 2);
+             }
+         }));
+     }
+     std::vector<int> next(PRODUCERS, 0);
+     int received = 0;
+     bool ordered = true;
+     while (received < PRODUCERS * COUNT) {
+         std::shared_ptr<cygnal::Buffer> got = shared.pop();
+         if (!got) {
+             std::this_thread::yield();
+             continue;
+         }
+         const int p = got->reference()[0];
+         ordered = ordered && (got->reference()[1] == next[p] % 256);
+         ++next[p];
+         ++received;
+     }
+     for (size_t p = 0; p < producers.size(); ++p) {
+         producers[p].join();
+     }
+     if (ordered && (shared.size() == 0)) {
+         runtest.pass("CQue with many producers");
+     } else {
+         runtest.fail("CQue with many producers");
+     }
 }
 
@@ -0,0 +1,438 @@
+//
+//   Copyright (C) 2008, 2009, 2010, 2011, 2012 Free Software Foundation, Inc.
+//
+// This program is free software; you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation; either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program; if not, write to the Free Software
+// Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+//
+
+#ifdef HAVE_CONFIG_H
+#include "gnashconfig.h"
+#endif
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <cstring>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <sys/socket.h>
+#include <sys/time.h>
+#include <fcntl.h>
+#include <netinet/in.h>
+#include <arpa/inet.h>
+#include <unistd.h>
+
+#ifdef HAVE_DEJAGNU_H
+#include "dejagnu.h"
+#else
+#include "check.h"
+#endif
+
+#include "log.h"
+#include "network.h"
+#include "reactor.h"
+
+using namespace std;
+using namespace gnash;
+
+TestState runtest;
+
+#ifdef HAVE_SYS_EPOLL_H
+
+namespace {
+
+std::atomic<int> closed(0);
+
+const char *FILENAME = "reactor.raw";
+
+// A body sent in chunks, as RTMP does, and the file sent.
+std::shared_ptr<string> body;
+string filedata;
+
+// The body as sent, with a header byte between the chunks.
+string
+chunked(const string &data, size_t chunk, char header)
+{
+    string out;
+    for (size_t i = 0; i < data.size(); i += chunk) {
+        if (i) {
+            out += header;
+        }
+        out += data.substr(i, chunk);
+    }
+    return out;
+}
+
+// Sends back what it gets, answers "quit" with "bye" and closes.
+// "chunks" and "file" are answered without copying.
+class Echo : public Reactor::Connection
+{
+public:
+    Echo(int fd) : Reactor::Connection(fd) {}
+
+    bool processInput() {
+        const string data(reinterpret_cast<const char *>(input()),
+                          bytesReady());
+        consume(bytesReady());
+        if (data == "chunks") {
+            write(body, reinterpret_cast<const std::uint8_t *>(body->data()),
+                  body->size(), 128, '|');
+            return true;
+        }
+        if (data == "file") {
+            std::shared_ptr<int> file(new int(::open(FILENAME, O_RDONLY)),
+                                      [](int *fd) { ::close(*fd); delete fd; });
+            // Send all but the first byte, from two places.
+            write(reinterpret_cast<const std::uint8_t *>("<"), 1);
+            sendFile(file, *file, 1, filedata.size() - 1);
+            sendFile(file, *file, 1, 10);
+            return true;
+        }
+        if (data == "quit") {
+            write(reinterpret_cast<const std::uint8_t *>("bye"), 3);
+            close();
+            return true;
+        }
+        write(reinterpret_cast<const std::uint8_t *>(data.data()),
+              data.size());
+        return true;
+    }
+
+    void processClose() { ++closed; }
+};
+
+// Uses the blocking Network calls, as the cygnal handlers do.
+class Blocking : public Reactor::Connection
+{
+public:
+    Blocking(int fd) : Reactor::Connection(fd) {}
+
+    bool processInput() {
+        Network net;
+        Network::byte_t buf[8];
+        int ret = net.readNet(getFileFd(), buf, sizeof(buf), 5);
+        if (ret > 0) {
+            net.writeNet(getFileFd(), buf, ret);
+        }
+        if (string(reinterpret_cast<char *>(buf), ret) == "done") {
+            net.closeNet(getFileFd());
+        }
+        return true;
+    }
+};
+
+// Takes whole messages of MESSAGE bytes, which reads usually end
+// in the middle of, as a streaming RTMP publisher's do.
+const size_t MESSAGE = 100;
+std::atomic<size_t> framed(0);
+std::atomic<size_t> buffered(0);
+
+class Framer : public Reactor::Connection
+{
+public:
+    Framer(int fd) : Reactor::Connection(fd) {}
+
+    bool processInput() {
+        buffered = std::max<size_t>(buffered, bytesBuffered());
+        while (bytesReady() >= MESSAGE) {
+            consume(MESSAGE);
+            ++framed;
+        }
+        return true;
+    }
+};
+
+std::shared_ptr<Reactor::Connection> last;
+
+std::shared_ptr<Reactor::Connection>
+makeEcho(int fd)
+{
+    last = std::make_shared<Echo>(fd);
+    return last;
+}
+
+std::shared_ptr<Reactor::Connection>
+makeBlocking(int fd)
+{
+    return std::make_shared<Blocking>(fd);
+}
+
+std::shared_ptr<Reactor::Connection>
+makeFramer(int fd)
+{
+    return std::make_shared<Framer>(fd);
+}
+
+int
+listenLocal(short &port)
+{
+    int fd = socket(AF_INET, SOCK_STREAM, 0);
+    struct sockaddr_in addr;
+    std::memset(&addr, 0, sizeof(addr));
+    addr.sin_family = AF_INET;
+    addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    addr.sin_port = 0;
+    bind(fd, reinterpret_cast<struct sockaddr *>(&addr), sizeof(addr));
+    listen(fd, 1024);
+    socklen_t len = sizeof(addr);
+    getsockname(fd, reinterpret_cast<struct sockaddr *>(&addr), &len);
+    port = ntohs(addr.sin_port);
+    return fd;
+}
+
+int
+connectLocal(short port)
+{
+    int fd = socket(AF_INET, SOCK_STREAM, 0);
+    struct sockaddr_in addr;
+    std::memset(&addr, 0, sizeof(addr));
+    addr.sin_family = AF_INET;
+    addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    addr.sin_port = htons(port);
+    if (connect(fd, reinterpret_cast<struct sockaddr *>(&addr),
+                sizeof(addr)) < 0) {
+        ::close(fd);
+        return -1;
+    }
+    struct timeval tv = { 5, 0 };
+    setsockopt(fd, SOL_SOCKET, SO_RCVTIMEO, &tv, sizeof(tv));
+    return fd;
+}
+
+// Read exactly size bytes, or until the other end closes.
+string
+readSome(int fd, size_t size)
+{
+    string data;
+    char buf[4096];
+    while (data.size() < size) {
+        ssize_t ret = ::read(fd, buf, std::min(sizeof(buf), size - data.size()));
+        if (ret <= 0) {
+            break;
+        }
+        data.append(buf, ret);
+    }
+    return data;
+}
+
+bool
+waitFor(Reactor &reactor, size_t connections)
+{
+    for (int i = 0; i < 500; ++i) {
+        if (reactor.connections() == connections) {
+            return true;
+        }
+        std::this_thread::sleep_for(std::chrono::milliseconds(10));
+    }
+    return false;
+}
+
+} // anonymous namespace
+
+int
+main (int /*argc*/, char** /*argv*/) {
+    gnash::LogFile& dbglogfile = gnash::LogFile::getDefaultInstance();
+    dbglogfile.setVerbosity(0);
+
+    short port, blockport;
+    int lfd = listenLocal(port);
+    int bfd = listenLocal(blockport);
+
+    Reactor reactor(2);
+    reactor.start();
+    if (reactor.workers() == 2 && reactor.addListener(lfd, makeEcho)
+        && reactor.addListener(bfd, makeBlocking)) {
+        runtest.pass ("Reactor::addListener()");
+    } else {
+        runtest.fail ("Reactor::addListener()");
+    }
+
+    int fd = connectLocal(port);
+    ::write(fd, "hello", 5);
+    if (readSome(fd, 5) == "hello") {
+        runtest.pass ("Reactor echo");
+    } else {
+        runtest.fail ("Reactor echo");
+    }
+
+    // Another thread can write to a connection.
+    if (waitFor(reactor, 1)) {
+        last->write(reinterpret_cast<const std::uint8_t *>("push"), 4);
+    }
+    if (readSome(fd, 4) == "push") {
+        runtest.pass ("Reactor::Connection::write() from another thread");
+    } else {
+        runtest.fail ("Reactor::Connection::write() from another thread");
+    }
+
+    // More data than the sockets hold, so writes have to wait for
+    // the socket to drain.
+    string big(4 * 1024 * 1024, 0);
+    for (size_t i = 0; i < big.size(); ++i) {
+        big[i] = i * 7 + i / 4096;
+    }
+    std::thread writer([fd, &big]() {
+        size_t sent = 0;
+        while (sent < big.size()) {
+            ssize_t ret = ::write(fd, big.data() + sent, big.size() - sent);
+            if (ret <= 0) {
+                break;
+            }
+            sent += ret;
+        }
+    });
+    const string back = readSome(fd, big.size());
+    writer.join();
+    if (back == big) {
+        runtest.pass ("Reactor partial writes");
+    } else {
+        runtest.fail ("Reactor partial writes");
+    }
+
+    // Output that isn't copied, large enough to be written in parts.
+    body.reset(new string(1024 * 1024 + 17, 0));
+    for (size_t i = 0; i < body->size(); ++i) {
+        (*body)[i] = 'a' + i % 26;
+    }
+    ::write(fd, "chunks", 6);
+    const string expected = chunked(*body, 128, '|');
+    if (readSome(fd, expected.size()) == expected) {
+        runtest.pass ("Reactor::Connection::write() in chunks");
+    } else {
+        runtest.fail ("Reactor::Connection::write() in chunks");
+    }
+
+    filedata.assign(3 * 1024 * 1024 + 5, 0);
+    for (size_t i = 0; i < filedata.size(); ++i) {
+        filedata[i] = i * 13 + i / 1000;
+    }
+    int file = ::open(FILENAME, O_WRONLY | O_CREAT | O_TRUNC, 0644);
+    ::write(file, filedata.data(), filedata.size());
+    ::close(file);
+    ::write(fd, "file", 4);
+    const string sent = "<" + filedata.substr(1) + filedata.substr(1, 10);
+    if (readSome(fd, sent.size()) == sent) {
+        runtest.pass ("Reactor::Connection::sendFile()");
+    } else {
+        runtest.fail ("Reactor::Connection::sendFile()");
+    }
+    ::unlink(FILENAME);
+
+    // Closing writes the reply first.
+    ::write(fd, "quit", 4);
+    string bye = readSome(fd, 10);
+    if (bye == "bye") {
+        runtest.pass ("Reactor::Connection::close()");
+    } else {
+        runtest.fail ("Reactor::Connection::close()");
+    }
+    ::close(fd);
+    last.reset();
+
+    // The blocking calls read and write through the connection.
+    fd = connectLocal(blockport);
+    ::write(fd, "ping", 4);
+    string pong = readSome(fd, 4);
+    ::write(fd, "done", 4);
+    string done = readSome(fd, 10);
+    if (pong == "ping" && done == "done") {
+        runtest.pass ("Network::readNet() and writeNet() in a Reactor");
+    } else {
+        runtest.fail ("Network::readNet() and writeNet() in a Reactor");
+    }
+    ::close(fd);
+
+    if (waitFor(reactor, 0) && closed == 1) {
+        runtest.pass ("Reactor::Connection::processClose()");
+    } else {
+        runtest.fail ("Reactor::Connection::processClose()");
+    }
+
+    // Many idle connections cost no threads.
+    vector<int> fds;
+    for (int i = 0; i < 500; ++i) {
+        int c = connectLocal(port);
+        if (c >= 0) {
+            fds.push_back(c);
+        }
+    }
+    last.reset();
+    if (fds.size() == 500 && waitFor(reactor, 500)) {
+        runtest.pass ("Reactor holds 500 connections");
+    } else {
+        runtest.fail ("Reactor holds 500 connections");
+    }
+    bool answered = true;
+    for (size_t i = 0; i < fds.size(); i += 50) {
+        ::write(fds[i], "x", 1);
+        answered = answered && readSome(fds[i], 1) == "x";
+    }
+    if (answered) {
+        runtest.pass ("Reactor answers each connection");
+    } else {
+        runtest.fail ("Reactor answers each connection");
+    }
+    for (size_t i = 0; i < fds.size(); ++i) {
+        ::close(fds[i]);
+    }
+    if (waitFor(reactor, 0)) {
+        runtest.pass ("Reactor closes connections");
+    } else {
+        runtest.fail ("Reactor closes connections");
+    }
+
+    // Input that always ends with part of a message doesn't pile up.
+    short frameport;
+    int ffd = listenLocal(frameport);
+    reactor.addListener(ffd, makeFramer);
+    fd = connectLocal(frameport);
+    const string stream(8 * 1024 * 1024, 'm');
+    for (size_t sent = 0; sent < stream.size(); ) {
+        ssize_t ret = ::write(fd, stream.data() + sent,
+                              std::min<size_t>(1000, stream.size() - sent));
+        if (ret <= 0) {
+            break;
+        }
+        sent += ret;
+    }
+    for (int i = 0; i < 500 && framed < stream.size() / MESSAGE; ++i) {
+        std::this_thread::sleep_for(std::chrono::milliseconds(10));
+    }
+    if (framed == stream.size() / MESSAGE && buffered < 64 * 1024) {
+        runtest.pass ("Reactor drops consumed input");
+    } else {
+        runtest.fail ("Reactor drops consumed input");
+    }
+    ::close(fd);
+
+    reactor.stop();
+    ::close(lfd);
+    ::close(bfd);
+    ::close(ffd);
+
+    return 0;
+}
+
+#else
+
+int
+main (int /*argc*/, char** /*argv*/) {
+    runtest.unresolved ("Reactor needs epoll");
+    return 0;
+}
+
+#endif
@@ -0,0 +1,401 @@
+//
+//   Copyright (C) 2008, 2009, 2010, 2011, 2012 Free Software Foundation, Inc.
+//
+// This program is free software; you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation; either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program; if not, write to the Free Software
+// Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+//
+
+#ifdef HAVE_CONFIG_H
+#include "gnashconfig.h"
+#endif
+
+#include <chrono>
+#include <cstdint>
+#include <cstring>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <sys/socket.h>
+#include <sys/time.h>
+#include <netinet/in.h>
+#include <arpa/inet.h>
+#include <unistd.h>
+
+#ifdef HAVE_DEJAGNU_H
+#include "dejagnu.h"
+#else
+#include "check.h"
+#endif
+
+#include "log.h"
+#include "reactor.h"
+#include "relay.h"
+#include "rtmp.h"
+#include "rtmp_msg.h"
+
+using namespace std;
+using namespace gnash;
+
+TestState runtest;
+
+#ifdef HAVE_SYS_EPOLL_H
+
+namespace {
+
+const char *STREAM = "localhost/live/stream";
+
+// Throws away what the client sends.
+class Sink : public Reactor::Connection
+{
+public:
+    Sink(int fd) : Reactor::Connection(fd) {}
+
+    bool processInput() {
+        consume(bytesReady());
+        return true;
+    }
+};
+
+// The server end of each connection, in the order accepted.
+std::mutex accepted_mutex;
+vector<std::shared_ptr<Reactor::Connection> > accepted;
+
+std::shared_ptr<Reactor::Connection>
+makeSink(int fd)
+{
+    // Small buffers, so a client that doesn't read backs up quickly.
+    int size = 16 * 1024;
+    setsockopt(fd, SOL_SOCKET, SO_SNDBUF, &size, sizeof(size));
+    std::shared_ptr<Reactor::Connection> conn = std::make_shared<Sink>(fd);
+    std::lock_guard<std::mutex> lock(accepted_mutex);
+    accepted.push_back(conn);
+    return conn;
+}
+
+int
+listenLocal(short &port)
+{
+    int fd = socket(AF_INET, SOCK_STREAM, 0);
+    struct sockaddr_in addr;
+    std::memset(&addr, 0, sizeof(addr));
+    addr.sin_family = AF_INET;
+    addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    addr.sin_port = 0;
+    bind(fd, reinterpret_cast<struct sockaddr *>(&addr), sizeof(addr));
+    listen(fd, 1024);
+    socklen_t len = sizeof(addr);
+    getsockname(fd, reinterpret_cast<struct sockaddr *>(&addr), &len);
+    port = ntohs(addr.sin_port);
+    return fd;
+}
+
+// Connect, and wait for the server end to be accepted.
+int
+connectLocal(short port, std::shared_ptr<Reactor::Connection> &conn)
+{
+    int fd = socket(AF_INET, SOCK_STREAM, 0);
+    int size = 16 * 1024;
+    setsockopt(fd, SOL_SOCKET, SO_RCVBUF, &size, sizeof(size));
+    struct sockaddr_in addr;
+    std::memset(&addr, 0, sizeof(addr));
+    addr.sin_family = AF_INET;
+    addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    addr.sin_port = htons(port);
+    if (connect(fd, reinterpret_cast<struct sockaddr *>(&addr),
+                sizeof(addr)) < 0) {
+        ::close(fd);
+        return -1;
+    }
+    struct timeval tv = { 0, 300000 };
+    setsockopt(fd, SOL_SOCKET, SO_RCVTIMEO, &tv, sizeof(tv));
+    for (int i = 0; i < 500; ++i) {
+        std::lock_guard<std::mutex> lock(accepted_mutex);
+        if (!accepted.empty()) {
+            conn = accepted.back();
+            accepted.clear();
+            return fd;
+        }
+        std::this_thread::sleep_for(std::chrono::milliseconds(10));
+    }
+    ::close(fd);
+    return -1;
+}
+
+// Everything sent, until nothing more comes for a while.
+vector<std::uint8_t>
+readAll(int fd)
+{
+    vector<std::uint8_t> data;
+    std::uint8_t buf[4096];
+    while (true) {
+        ssize_t ret = ::read(fd, buf, sizeof(buf));
+        if (ret <= 0) {
+            break;
+        }
+        data.insert(data.end(), buf, buf + ret);
+    }
+    return data;
+}
+
+// A message as a subscriber got it.
+struct Received {
+    RTMP::rtmp_head_t head;
+    std::uint32_t timestamp;
+    std::uint32_t streamid;
+    vector<std::uint8_t> body;
+};
+
+// Parse what a subscriber got, at the relay's chunk size.
+bool
+parse(const vector<std::uint8_t> &data, vector<Received> &msgs)
+{
+    RTMP rtmp;
+    std::uint8_t setsize[RTMP_MAX_HEADER_SIZE + 4];
+    size_t nbytes = rtmp.encodeHeader(setsize, RTMP_SYSTEM_CHANNEL,
+                        RTMP::HEADER_12, 4, RTMP::CHUNK_SIZE,
+                        RTMPMsg::FROM_SERVER);
+    nbytes += rtmp.encodeChunkSize(setsize + nbytes, Relay::CHUNK_SIZE);
+
+    RTMP::msg_handler_t handler = [&rtmp, &msgs](const RTMP::rtmp_head_t &head,
+                                                 const std::uint8_t *body) {
+        if (head.type != RTMP::CHUNK_SIZE) {
+            Received msg;
+            msg.head = head;
+            msg.timestamp = rtmp.getMysteryWord();
+            std::memcpy(&msg.streamid, &head.src_dest, sizeof(msg.streamid));
+            msg.body.assign(body, body + head.bodysize);
+            msgs.push_back(msg);
+        }
+        return true;
+    };
+    if (rtmp.parse(setsize, nbytes, handler) != static_cast<int>(nbytes)) {
+        return false;
+    }
+    if (data.empty()) {
+        return true;
+    }
+    return rtmp.parse(&data[0], data.size(), handler)
+        == static_cast<int>(data.size());
+}
+
+// An FLV video tag body, numbered.
+vector<std::uint8_t>
+frame(bool key, std::uint32_t number, size_t size)
+{
+    vector<std::uint8_t> data(size);
+    for (size_t i = 0; i < size; ++i) {
+        data[i] = i * 7 + number;
+    }
+    // Frame type and Sorenson H.263.
+    data[0] = key ? 0x12 : 0x22;
+    std::memcpy(&data[1], &number, sizeof(number));
+    return data;
+}
+
+} // anonymous namespace
+
+int
+main (int /*argc*/, char** /*argv*/) {
+    gnash::LogFile& dbglogfile = gnash::LogFile::getDefaultInstance();
+    dbglogfile.setVerbosity(0);
+
+    short port;
+    int lfd = listenLocal(port);
+    Reactor reactor(1);
+    reactor.start();
+    reactor.addListener(lfd, makeSink);
+
+    Relay relay;
+    if (relay.addPublisher(STREAM) && !relay.addPublisher(STREAM)
+        && relay.isPublished(STREAM) && !relay.isPublished("other")) {
+        runtest.pass ("Relay::addPublisher()");
+    } else {
+        runtest.fail ("Relay::addPublisher()");
+    }
+
+    // Metadata published before anyone plays is kept for them.
+    const std::uint8_t meta[] = { 0x02, 0x00, 0x0a, 'o', 'n', 'M', 'e', 't',
+                                  'a', 'D', 'a', 't', 'a', 0x05 };
+    relay.publish(STREAM, RTMP::NOTIFY, 0, meta, sizeof(meta));
+
+    std::shared_ptr<Reactor::Connection> conn1, conn2;
+    int fd1 = connectLocal(port, conn1);
+    int fd2 = connectLocal(port, conn2);
+    if (fd1 >= 0 && fd2 >= 0 && relay.subscribe(STREAM, conn1, 1)
+        && relay.subscribe(STREAM, conn2, 7)
+        && !relay.subscribe("other", conn1, 1)
+        && relay.subscribers(STREAM) == 2) {
+        runtest.pass ("Relay::subscribe()");
+    } else {
+        runtest.fail ("Relay::subscribe()");
+    }
+
+    // Video waits for a keyframe, which is split into several chunks.
+    const vector<std::uint8_t> inter = frame(false, 1, 500);
+    const vector<std::uint8_t> key = frame(true, 2, 10000);
+    const vector<std::uint8_t> audio(300, 0x2f);
+    size_t sent = relay.publish(STREAM, RTMP::VIDEO_DATA, 40, &inter[0],
+                                inter.size());
+    sent += relay.publish(STREAM, RTMP::VIDEO_DATA, 80, &key[0], key.size());
+    sent += relay.publish(STREAM, RTMP::AUDIO_DATA, 90, &audio[0],
+                          audio.size());
+    if (sent == 4 && relay.dropped() == 2) {
+        runtest.pass ("Relay::publish() waits for a keyframe");
+    } else {
+        runtest.fail ("Relay::publish() waits for a keyframe");
+    }
+
+    vector<Received> msgs1, msgs2;
+    const bool parsed = parse(readAll(fd1), msgs1) && parse(readAll(fd2), msgs2);
+    if (parsed && msgs1.size() == 3 && msgs2.size() == 3) {
+        runtest.pass ("Relayed messages parse");
+    } else {
+        runtest.fail ("Relayed messages parse");
+    }
+
+    if (msgs1.size() == 3 && msgs2.size() == 3
+        && msgs1[0].head.type == RTMP::NOTIFY
+        && msgs1[0].body == vector<std::uint8_t>(meta, meta + sizeof(meta))
+        && msgs1[1].head.type == RTMP::VIDEO_DATA
+        && msgs1[1].head.channel == Relay::VIDEO_CHANNEL
+        && msgs1[1].timestamp == 80 && msgs1[1].body == key
+        && msgs1[2].head.type == RTMP::AUDIO_DATA
+        && msgs1[2].head.channel == Relay::AUDIO_CHANNEL
+        && msgs1[2].timestamp == 90 && msgs1[2].body == audio
+        && msgs2[1].body == key && msgs2[2].body == audio) {
+        runtest.pass ("Relayed messages are the same for all");
+    } else {
+        runtest.fail ("Relayed messages are the same for all");
+    }
+
+    if (msgs1.size() == 3 && msgs2.size() == 3
+        && msgs1[0].streamid == 1 && msgs1[1].streamid == 1
+        && msgs2[0].streamid == 7 && msgs2[1].streamid == 7) {
+        runtest.pass ("Relayed messages have each subscriber's stream ID");
+    } else {
+        runtest.fail ("Relayed messages have each subscriber's stream ID");
+    }
+
+    // A late subscriber gets the codec headers first. Only onMetaData
+    // is kept, without the @setDataFrame encoders send it with.
+    const std::uint8_t avc[] = { 0x17, 0x00, 0x00, 0x00, 0x00, 0x01, 0x42 };
+    relay.publish(STREAM, RTMP::VIDEO_DATA, 100, avc, sizeof(avc));
+    const std::uint8_t setmeta[] = { 0x02, 0x00, 0x0d, '@', 's', 'e', 't',
+                                     'D', 'a', 't', 'a', 'F', 'r', 'a', 'm',
+                                     'e', 0x02, 0x00, 0x0a, 'o', 'n', 'M',
+                                     'e', 't', 'a', 'D', 'a', 't', 'a',
+                                     0x01, 0x01 };
+    relay.publish(STREAM, RTMP::NOTIFY, 100, setmeta, sizeof(setmeta));
+    const std::uint8_t cue[] = { 0x02, 0x00, 0x0a, 'o', 'n', 'C', 'u', 'e',
+                                 'P', 'o', 'i', 'n', 't', 0x05 };
+    relay.publish(STREAM, RTMP::NOTIFY, 110, cue, sizeof(cue));
+    std::shared_ptr<Reactor::Connection> conn3;
+    int fd3 = connectLocal(port, conn3);
+    relay.subscribe(STREAM, conn3, 3);
+    vector<Received> msgs3;
+    if (parse(readAll(fd3), msgs3) && msgs3.size() == 2
+        && msgs3[0].head.type == RTMP::NOTIFY
+        && msgs3[0].body == vector<std::uint8_t>(setmeta + 16,
+                                                 setmeta + sizeof(setmeta))
+        && msgs3[1].body == vector<std::uint8_t>(avc, avc + sizeof(avc))) {
+        runtest.pass ("Relay::subscribe() sends the stream headers");
+    } else {
+        runtest.fail ("Relay::subscribe() sends the stream headers");
+    }
+    readAll(fd1);
+    readAll(fd2);
+
+    // Closed subscribers are dropped.
+    relay.unsubscribe(conn2.get());
+    conn3.reset();
+    ::close(fd3);
+    for (int i = 0; i < 100 && reactor.connections() > 2; ++i) {
+        std::this_thread::sleep_for(std::chrono::milliseconds(10));
+    }
+    relay.publish(STREAM, RTMP::AUDIO_DATA, 120, &audio[0], audio.size());
+    if (relay.subscribers(STREAM) == 1) {
+        runtest.pass ("Relay::unsubscribe()");
+    } else {
+        runtest.fail ("Relay::unsubscribe()");
+    }
+    readAll(fd1);
+    ::close(fd2);
+
+    // A subscriber that doesn't read has frames dropped, and its
+    // queue stays short.
+    Relay slow(64 * 1024);
+    slow.addPublisher(STREAM);
+    slow.subscribe(STREAM, conn1, 1);
+    size_t most = 0;
+    const std::uint32_t FRAMES = 200;
+    for (std::uint32_t i = 0; i < FRAMES; ++i) {
+        const vector<std::uint8_t> video = frame(i % 10 == 0, i, 20000);
+        slow.publish(STREAM, RTMP::VIDEO_DATA, i * 40, &video[0],
+                     video.size());
+        most = std::max(most, conn1->bytesQueued());
+    }
+    if (slow.dropped() > 0 && most <= 64 * 1024 + 20000 + 32) {
+        runtest.pass ("Relay drops frames for slow subscribers");
+    } else {
+        runtest.fail ("Relay drops frames for slow subscribers");
+    }
+
+    // After a dropped frame, video starts again at a keyframe.
+    vector<Received> msgs;
+    bool resumed = parse(readAll(fd1), msgs) && !msgs.empty()
+        && msgs.size() + slow.dropped() == FRAMES;
+    std::uint32_t last = 0;
+    for (size_t i = 0; resumed && i < msgs.size(); ++i) {
+        std::uint32_t number;
+        std::memcpy(&number, &msgs[i].body[1], sizeof(number));
+        if ((i == 0 || number != last + 1) && msgs[i].body[0] != 0x12) {
+            resumed = false;
+        }
+        last = number;
+    }
+    if (resumed) {
+        runtest.pass ("Relay resumes slow subscribers at a keyframe");
+    } else {
+        runtest.fail ("Relay resumes slow subscribers at a keyframe");
+    }
+
+    relay.removePublisher(STREAM);
+    if (!relay.isPublished(STREAM) && relay.publish(STREAM, RTMP::AUDIO_DATA,
+                                        0, &audio[0], audio.size()) == 0) {
+        runtest.pass ("Relay::removePublisher()");
+    } else {
+        runtest.fail ("Relay::removePublisher()");
+    }
+
+    ::close(fd1);
+    conn1.reset();
+    conn2.reset();
+    reactor.stop();
+    ::close(lfd);
+
+    return 0;
+}
+
+#else
+
+int
+main (int /*argc*/, char** /*argv*/) {
+    runtest.unresolved ("Relay needs epoll");
+    return 0;
+}
+
+#endif
@@ -32,6 +32,7 @@
 #include <fcntl.h>
 #include <iostream>
 #include <string>
+#include <vector>
 
 #include "as_object.h"
 #include "dejagnu.h"
@@ -71,6 +72,7 @@ static void test_results();
 static void test_system();
 static void test_client();
 static void test_split();
+static void test_parse();
 
 LogFile& dbglogfile = LogFile::getDefaultInstance();
 
@@ -132,6 +134,7 @@ main(int argc, char *argv[])
     test_system();
     test_client();
     test_results();
+    test_parse();
     // test_split();
 //    test_types();
 #if defined(HAVE_MALLINFO) && defined(USE_STATS_MEMORY)
@@ -611,6 +614,135 @@ test_header()
 //     head5->dump();
 }
 
+// Append a message to a stream as it is sent, in chunks of the
+// given size after the header.
+static void
+add_message(std::vector<std::uint8_t> &stream, RTMP &rtmp, int channel,
+            RTMP::content_types_e type, const std::string &body,
+            size_t chunksize)
+{
+    std::uint8_t head[RTMP_MAX_HEADER_SIZE];
+    size_t nbytes = rtmp.encodeHeader(head, channel, RTMP::HEADER_12,
+                                      body.size(), type, RTMPMsg::FROM_SERVER);
+    stream.insert(stream.end(), head, head + nbytes);
+    for (size_t i = 0; i < body.size(); i += chunksize) {
+        if (i) {
+            rtmp.encodeHeader(head, channel, RTMP::HEADER_1);
+            stream.push_back(head[0]);
+        }
+        size_t partial = std::min(chunksize, body.size() - i);
+        stream.insert(stream.end(), body.begin() + i, body.begin() + i + partial);
+    }
+}
+
+void
+test_parse()
+{
+    GNASH_REPORT_FUNCTION;
+    RTMPClient rtmp;
+
+    // The in place encoders write the same bytes as the others.
+    std::uint8_t head[RTMP_MAX_HEADER_SIZE];
+    std::shared_ptr<cygnal::Buffer> head1 = rtmp.encodeHeader(0x3, RTMP::HEADER_12, 287,
+                                        RTMP::INVOKE, RTMPMsg::FROM_CLIENT);
+    size_t size1 = rtmp.encodeHeader(head, 0x3, RTMP::HEADER_12, 287,
+                                     RTMP::INVOKE, RTMPMsg::FROM_CLIENT);
+    std::shared_ptr<cygnal::Buffer> ping = rtmp.encodeUserControl(RTMP::STREAM_PING, 0x1234);
+    std::uint8_t user[10];
+    size_t size2 = rtmp.encodeUserControl(user, RTMP::STREAM_PING, 0x1234);
+    if ((size1 == head1->allocated()) && (memcmp(head, head1->reference(), size1) == 0)
+        && (size2 == ping->allocated()) && (memcmp(user, ping->reference(), size2) == 0)) {
+        runtest.pass("RTMP::encodeHeader() in place");
+    } else {
+        runtest.fail("RTMP::encodeHeader() in place");
+    }
+
+    // An Invoke in three chunks, with an Audio message between the
+    // first two, then the chunk size is raised, and a Video message
+    // is sent in the new size.
+    std::string invoke(300, 'i');
+    std::string audio(50, 'a');
+    std::string video(300, 'v');
+    for (size_t i = 0; i < invoke.size(); ++i) {
+        invoke[i] = 'a' + i % 26;
+    }
+    // Each has its own timestamp, which the header encoder leaves 0.
+    std::vector<std::uint8_t> first;
+    add_message(first, rtmp, 3, RTMP::INVOKE, invoke, 128);
+    first[3] = 30;
+    std::vector<std::uint8_t> stream(first.begin(), first.begin() + 12 + 128);
+    add_message(stream, rtmp, 4, RTMP::AUDIO_DATA, audio, 128);
+    stream[12 + 128 + 3] = 40;
+    stream.insert(stream.end(), first.begin() + 12 + 128, first.end());
+    std::uint8_t chunksize[4];
+    rtmp.encodeChunkSize(chunksize, 256);
+    add_message(stream, rtmp, 2, RTMP::CHUNK_SIZE,
+                std::string(reinterpret_cast<char *>(chunksize), 4), 128);
+    add_message(stream, rtmp, 5, RTMP::VIDEO_DATA, video, 256);
+
+    // Parse it as it arrives, a few bytes at a time.
+    std::vector<std::string> bodies;
+    std::vector<int> channels;
+    std::vector<int> times;
+    RTMPServer server;
+    RTMP::msg_handler_t handler = [&](const RTMP::rtmp_head_t &head,
+                                      const std::uint8_t *body) {
+        bodies.push_back(std::string(reinterpret_cast<const char *>(body),
+                                     head.bodysize));
+        channels.push_back(head.channel);
+        times.push_back(server.getMysteryWord());
+        return true;
+    };
+    std::vector<std::uint8_t> input;
+    bool ok = true;
+    for (size_t i = 0; i < stream.size(); i += 7) {
+        input.insert(input.end(), stream.begin() + i,
+                     stream.begin() + std::min(i + 7, stream.size()));
+        int used = server.parse(&input[0], input.size(), handler);
+        if (used < 0) {
+            ok = false;
+            break;
+        }
+        input.erase(input.begin(), input.begin() + used);
+    }
+    if (ok && input.empty() && (bodies.size() == 4)
+        && (channels[0] == 4) && (bodies[0] == audio)
+        && (channels[1] == 3) && (bodies[1] == invoke)
+        && (channels[2] == 2) && (bodies[3] == video)) {
+        runtest.pass("RTMP::parse()");
+    } else {
+        runtest.fail("RTMP::parse()");
+    }
+
+    // A message split by another keeps the timestamp of its first chunk.
+    if (ok && (times.size() == 4) && (times[0] == 40) && (times[1] == 30)) {
+        runtest.pass("RTMP::parse() timestamps");
+    } else {
+        runtest.fail("RTMP::parse() timestamps");
+    }
+
+    // A continuation on a channel that has never had a message.
+    std::uint8_t bad[] = { 0xc9, 0x00, 0x00 };
+    if (server.parse(bad, sizeof(bad), handler) == -1) {
+        runtest.pass("RTMP::parse(corrupted)");
+    } else {
+        runtest.fail("RTMP::parse(corrupted)");
+    }
+
+    // The message is reused for each body decoded.
+    std::shared_ptr<cygnal::Buffer> hex(new Buffer("02 00 07 5f 72 65 73 75 6c 74 00 3f f0 00 00 00 00 00 00 05"));
+    std::shared_ptr<RTMPMsg> msg1 = rtmp.decodeMsgBody(*hex);
+    RTMPMsg msg;
+    msg.addObject(std::shared_ptr<cygnal::Element>(new cygnal::Element(true)));
+    if (rtmp.decodeMsgBody(hex->reference(), hex->allocated(), msg)
+        && (msg.getMethodName() == "_result") && (msg.getTransactionID() == 1)
+        && msg1 && (msg.size() == msg1->size())) {
+        runtest.pass("RTMP::decodeMsgBody(RTMPMsg &)");
+    } else {
+        runtest.fail("RTMP::decodeMsgBody(RTMPMsg &)");
+    }
+}
+
 void
 test_results()
 {
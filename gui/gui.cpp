@@ -1063,6 +1063,32 @@ Gui::setInvalidatedRegions(const InvalidatedRanges& ranges)
 
 #ifdef USE_SWFTREE
 
+namespace {
+
+/// Add a row with the number of pauses for each non-empty histogram bucket
+void
+addPauseRows(movie_root::InfoTree& tr, movie_root::InfoTree::iterator it,
+        const std::string& label, const GC::PauseHistogram& pauses)
+{
+    std::ostringstream ss;
+    ss << pauses.count << " (max " << pauses.max << "us)";
+    movie_root::InfoTree::iterator row =
+        tr.append_child(it, std::make_pair(label, ss.str()));
+
+    for (size_t i = 0; i < pauses.buckets.size(); ++i) {
+        if (!pauses.buckets[i]) continue;
+        std::ostringstream bucket;
+        if (i + 1 == pauses.buckets.size()) {
+            bucket << ">= " << (1UL << (i - 1)) << "us";
+        }
+        else bucket << "< " << (1UL << i) << "us";
+        tr.append_child(row, std::make_pair(bucket.str(),
+                    std::to_string(pauses.buckets[i])));
+    }
+}
+
+}
+
 std::unique_ptr<movie_root::InfoTree>
 Gui::getMovieInfo() const
 {
@@ -1157,8 +1183,27 @@ Gui::getMovieInfo() const
                     std::make_pair(lbl + typ, ss.str()));
     }
 
+    const GC& gc = _stage->gc();
+    addPauseRows(*tr, topIter, "GC mark pauses", gc.markPauses());
+    addPauseRows(*tr, topIter, "GC sweep pauses", gc.sweepPauses());
+
     tr->sort(firstLevelIter.begin(), firstLevelIter.end());
 
+    //
+    /// Renderer row
+    //
+    if (_renderer) {
+        Renderer::Stats stats;
+        _renderer->getStats(stats);
+        if (!stats.empty()) {
+            topIter = tr->insert(topIter,
+                    std::make_pair("Renderer Statistics", ""));
+            for (const auto& stat : stats) {
+                tr->append_child(topIter, stat);
+            }
+        }
+    }
+
     return tr;
 }
 
@@ -60,7 +60,8 @@ enum Type {
     UNSUPPORTED_AMF0  = 0x0d,
     RECORD_SET_AMF0   = 0x0e,
     XML_OBJECT_AMF0   = 0x0f,
-    TYPED_OBJECT_AMF0 = 0x10
+    TYPED_OBJECT_AMF0 = 0x10,
+    AVMPLUS_OBJECT_AMF0 = 0x11
 };
 
 /// Exception for handling malformed buffers.
@@ -0,0 +1,1009 @@
+// AMFCodec.cpp    Streaming AMF0 and AMF3 decoding and encoding.
+//
+//   Copyright (C) 2005, 2006, 2007, 2008, 2009, 2010, 2011, 2012
+//   Free Software Foundation, Inc
+//
+// This program is free software; you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation; either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program; if not, write to the Free Software
+// Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+
+#include "AMFCodec.h"
+
+#include <algorithm>
+#include <cassert>
+
+#include "log.h"
+#include "SimpleBuffer.h"
+
+namespace gnash {
+namespace amf {
+
+namespace {
+
+/// AMF3 integers are 29 bits.
+const std::int32_t MAX_INTEGER3 = 0x0fffffff;
+const std::int32_t MIN_INTEGER3 = -0x10000000;
+
+/// FNV-1a, for the AMF3 string table.
+std::uint32_t
+hashString(const std::uint8_t* str, size_t size)
+{
+    std::uint32_t h = 2166136261u;
+    for (size_t i = 0; i < size; ++i) {
+        h = (h ^ str[i]) * 16777619u;
+    }
+    return h;
+}
+
+}
+
+Decoder::Decoder(const std::uint8_t* pos, const std::uint8_t* end,
+        Encoding enc)
+    :
+    _pos(pos),
+    _end(end),
+    _encoding(enc),
+    _error(false),
+    _number(0),
+    _integer(0),
+    _boolean(false),
+    _count(0),
+    _index(0),
+    _objects(0)
+{
+}
+
+void
+Decoder::seek(const std::uint8_t* pos)
+{
+    _pos = pos;
+    _error = false;
+    _stack.clear();
+}
+
+void
+Decoder::reset(const std::uint8_t* pos, const std::uint8_t* end)
+{
+    _pos = pos;
+    _end = end;
+    _error = false;
+    _stack.clear();
+    _objects = 0;
+    _objects0.clear();
+    _strings3.clear();
+    _traits3.clear();
+    _names3.clear();
+    _objects3.clear();
+}
+
+Decoder::Event
+Decoder::next()
+{
+    if (_error) return NONE;
+
+    if (_stack.empty()) {
+        if (_pos >= _end) return NONE;
+        return readValue(_encoding);
+    }
+
+    Frame& f = _stack.back();
+
+    switch (f.kind) {
+
+        case Frame::OBJECT0:
+        case Frame::ECMA_ARRAY0:
+        {
+            if (!f.key) {
+                f.key = true;
+                return readValue0();
+            }
+
+            // Some encoders leave out the end of an ECMA_ARRAY at the
+            // end of a message.
+            if (_end - _pos < 2) {
+                if (_pos != _end || f.kind != Frame::ECMA_ARRAY0) {
+                    log_error(_("MALFORMED AMF: premature end of object"));
+                    return fail();
+                }
+                _stack.pop_back();
+                return END;
+            }
+
+            const std::uint16_t len = readNetworkShort(_pos);
+            _pos += 2;
+
+            // The end is an empty name followed by OBJECT_END_AMF0.
+            if (!len) {
+                if (_pos < _end) {
+                    if (*_pos != OBJECT_END_AMF0) {
+                        log_error(_("MALFORMED AMF: empty member name not "
+                                    "followed by OBJECT_END_AMF0 byte"));
+                    }
+                    ++_pos;
+                }
+                _stack.pop_back();
+                return END;
+            }
+
+            if (_end - _pos < len) return fail();
+            _string = Span(_pos, len);
+            _pos += len;
+            f.key = false;
+            return KEY;
+        }
+
+        case Frame::STRICT_ARRAY0:
+            if (!f.remaining) {
+                _stack.pop_back();
+                return END;
+            }
+            --f.remaining;
+            return readValue0();
+
+        case Frame::OBJECT3:
+        {
+            if (!f.key) {
+                f.key = true;
+                return readValue3();
+            }
+
+            const Traits& t = _traits3[f.traits];
+            if (f.sealed < t.count) {
+                _string = _names3[t.first + f.sealed];
+                ++f.sealed;
+                f.key = false;
+                return KEY;
+            }
+            if (!t.dynamic) {
+                _stack.pop_back();
+                return END;
+            }
+
+            Span name;
+            if (!readString3(name)) return fail();
+            if (!name.size) {
+                _stack.pop_back();
+                return END;
+            }
+            _string = name;
+            f.key = false;
+            return KEY;
+        }
+
+        case Frame::ARRAY3:
+        {
+            if (!f.dense) {
+                if (!f.key) {
+                    f.key = true;
+                    return readValue3();
+                }
+                Span name;
+                if (!readString3(name)) return fail();
+                if (name.size) {
+                    _string = name;
+                    f.key = false;
+                    return KEY;
+                }
+                f.dense = true;
+            }
+
+            if (!f.remaining) {
+                _stack.pop_back();
+                return END;
+            }
+            --f.remaining;
+            return readValue3();
+        }
+    }
+
+    return fail();
+}
+
+bool
+Decoder::skip(Event e)
+{
+    if (e != OBJECT && e != ARRAY && e != ECMA_ARRAY) return !_error;
+
+    const size_t d = _stack.size() - 1;
+    while (_stack.size() > d) {
+        if (next() == NONE) return false;
+    }
+    return true;
+}
+
+Decoder::Event
+Decoder::readValue(Encoding enc)
+{
+    return enc == AMF3 ? readValue3() : readValue0();
+}
+
+Decoder::Event
+Decoder::readValue0()
+{
+    if (_pos >= _end) return fail();
+
+    const std::uint8_t t = *_pos++;
+
+    switch (t) {
+
+        case NUMBER_AMF0:
+            if (!readDouble(_number)) return fail();
+            return NUMBER;
+
+        case BOOLEAN_AMF0:
+            if (_pos >= _end) return fail();
+            _boolean = *_pos++;
+            return BOOLEAN;
+
+        case STRING_AMF0:
+        {
+            if (_end - _pos < 2) return fail();
+            const std::uint16_t len = readNetworkShort(_pos);
+            _pos += 2;
+            if (_end - _pos < len) return fail();
+            _string = Span(_pos, len);
+            _pos += len;
+            return STRING;
+        }
+
+        case LONG_STRING_AMF0:
+        case XML_OBJECT_AMF0:
+        {
+            if (_end - _pos < 4) return fail();
+            const std::uint32_t len = readNetworkLong(_pos);
+            _pos += 4;
+            if (static_cast<std::uint32_t>(_end - _pos) < len) return fail();
+            _string = Span(_pos, len);
+            _pos += len;
+            return t == XML_OBJECT_AMF0 ? XML : STRING;
+        }
+
+        case NULL_AMF0:
+            return NULL_VALUE;
+
+        case UNSUPPORTED_AMF0:
+        case UNDEFINED_AMF0:
+            return UNDEFINED;
+
+        case REFERENCE_AMF0:
+        {
+            if (_end - _pos < 2) return fail();
+            const std::uint16_t ref = readNetworkShort(_pos);
+            _pos += 2;
+            // 1 for the first, etc...
+            if (ref < 1 || ref > _objects0.size()) {
+                log_error(_("AMF: invalid reference to object %d (%d known "
+                            "objects)"), ref, _objects0.size());
+                return fail();
+            }
+            _index = _objects0[ref - 1];
+            return REFERENCE;
+        }
+
+        case DATE_AMF0:
+            if (!readDouble(_number)) return fail();
+            // The timezone is never used.
+            if (_end - _pos < 2) return fail();
+            _pos += 2;
+            return DATE;
+
+        case OBJECT_AMF0:
+            _className = Span();
+            _objects0.push_back(_objects);
+            return push(Frame::OBJECT0, 0);
+
+        case TYPED_OBJECT_AMF0:
+        {
+            if (_end - _pos < 2) return fail();
+            const std::uint16_t len = readNetworkShort(_pos);
+            _pos += 2;
+            if (_end - _pos < len) return fail();
+            _className = Span(_pos, len);
+            _pos += len;
+            _objects0.push_back(_objects);
+            return push(Frame::OBJECT0, 0);
+        }
+
+        case ECMA_ARRAY_AMF0:
+            if (_end - _pos < 4) return fail();
+            _count = readNetworkLong(_pos);
+            _pos += 4;
+            _objects0.push_back(_objects);
+            return push(Frame::ECMA_ARRAY0, 0);
+
+        case STRICT_ARRAY_AMF0:
+        {
+            if (_end - _pos < 4) return fail();
+            const std::uint32_t count = readNetworkLong(_pos);
+            _pos += 4;
+            // Every value takes at least a byte.
+            if (static_cast<std::uint32_t>(_end - _pos) < count) {
+                return fail();
+            }
+            _count = count;
+            _objects0.push_back(_objects);
+            return push(Frame::STRICT_ARRAY0, count);
+        }
+
+        case AVMPLUS_OBJECT_AMF0:
+            // Each AMF3 value in AMF0 has its own references.
+            _strings3.clear();
+            _traits3.clear();
+            _names3.clear();
+            _objects3.clear();
+            return readValue3();
+
+        default:
+            log_error(_("Unknown AMF type %s! Cannot proceed"),
+                    static_cast<int>(t));
+            return fail();
+    }
+}
+
+Decoder::Event
+Decoder::readValue3()
+{
+    if (_pos >= _end) return fail();
+
+    const std::uint8_t t = *_pos++;
+    std::uint32_t ref;
+
+    switch (t) {
+
+        case UNDEFINED_AMF3:
+            return UNDEFINED;
+
+        case NULL_AMF3:
+            return NULL_VALUE;
+
+        case FALSE_AMF3:
+        case TRUE_AMF3:
+            _boolean = (t == TRUE_AMF3);
+            return BOOLEAN;
+
+        case INTEGER_AMF3:
+            if (!readU29(ref)) return fail();
+            // Sign-extend the 29 bits.
+            _integer = static_cast<std::int32_t>(ref << 3) >> 3;
+            return INTEGER;
+
+        case DOUBLE_AMF3:
+            if (!readDouble(_number)) return fail();
+            return NUMBER;
+
+        case STRING_AMF3:
+            if (!readString3(_string)) return fail();
+            return STRING;
+
+        case XML_DOC_AMF3:
+        case XML_AMF3:
+        case BYTE_ARRAY_AMF3:
+        case DATE_AMF3:
+        {
+            const Event type = (t == DATE_AMF3) ? DATE :
+                (t == BYTE_ARRAY_AMF3) ? BYTE_ARRAY : XML;
+
+            if (!readU29(ref)) return fail();
+            if (!(ref & 1)) {
+                ref >>= 1;
+                if (ref >= _objects3.size() || _objects3[ref].type != type) {
+                    log_error(_("AMF3: invalid object reference %d"), ref);
+                    return fail();
+                }
+                _number = _objects3[ref].number;
+                _string = _objects3[ref].string;
+                return type;
+            }
+
+            if (type == DATE) {
+                if (!readDouble(_number)) return fail();
+            }
+            else {
+                ref >>= 1;
+                if (static_cast<std::uint32_t>(_end - _pos) < ref) {
+                    return fail();
+                }
+                _string = Span(_pos, ref);
+                _pos += ref;
+            }
+            const Object3 o = { type, 0, _number, _string };
+            _objects3.push_back(o);
+            return type;
+        }
+
+        case ARRAY_AMF3:
+        case OBJECT_AMF3:
+        {
+            if (!readU29(ref)) return fail();
+            if (!(ref & 1)) {
+                ref >>= 1;
+                if (ref >= _objects3.size() || (_objects3[ref].type != OBJECT
+                            && _objects3[ref].type != ARRAY)) {
+                    log_error(_("AMF3: invalid object reference %d"), ref);
+                    return fail();
+                }
+                _index = _objects3[ref].index;
+                return REFERENCE;
+            }
+
+            if (t == ARRAY_AMF3) {
+                const std::uint32_t count = ref >> 1;
+                if (static_cast<std::uint32_t>(_end - _pos) < count) {
+                    return fail();
+                }
+                _count = count;
+                const Object3 o = { ARRAY, _objects, 0, Span() };
+                _objects3.push_back(o);
+                return push(Frame::ARRAY3, count);
+            }
+
+            size_t traits;
+            if (!(ref & 2)) {
+                traits = ref >> 2;
+                if (traits >= _traits3.size()) {
+                    log_error(_("AMF3: invalid traits reference %d"), traits);
+                    return fail();
+                }
+            }
+            else if (ref & 4) {
+                log_unimpl(_("AMF3 externalizable objects"));
+                return fail();
+            }
+            else {
+                Traits tr;
+                tr.dynamic = ref & 8;
+                tr.count = ref >> 4;
+                tr.first = _names3.size();
+                if (!readString3(tr.className)) return fail();
+                for (size_t i = 0; i < tr.count; ++i) {
+                    Span name;
+                    if (!readString3(name)) return fail();
+                    _names3.push_back(name);
+                }
+                traits = _traits3.size();
+                _traits3.push_back(tr);
+            }
+
+            _className = _traits3[traits].className;
+            const Object3 o = { OBJECT, _objects, 0, Span() };
+            _objects3.push_back(o);
+            return push(Frame::OBJECT3, 0, traits);
+        }
+
+        default:
+            log_error(_("Unknown AMF3 type %s! Cannot proceed"),
+                    static_cast<int>(t));
+            return fail();
+    }
+}
+
+bool
+Decoder::readU29(std::uint32_t& val)
+{
+    std::uint32_t v = 0;
+    for (int i = 0; i < 4; ++i) {
+        if (_pos >= _end) return false;
+        const std::uint8_t b = *_pos++;
+        // The fourth byte has all eight bits.
+        if (i == 3) {
+            v = (v << 8) | b;
+            break;
+        }
+        v = (v << 7) | (b & 0x7f);
+        if (!(b & 0x80)) break;
+    }
+    val = v;
+    return true;
+}
+
+bool
+Decoder::readString3(Span& str)
+{
+    std::uint32_t ref;
+    if (!readU29(ref)) return false;
+
+    if (!(ref & 1)) {
+        ref >>= 1;
+        if (ref >= _strings3.size()) {
+            log_error(_("AMF3: invalid string reference %d"), ref);
+            return false;
+        }
+        str = _strings3[ref];
+        return true;
+    }
+
+    ref >>= 1;
+    if (static_cast<std::uint32_t>(_end - _pos) < ref) return false;
+    str = Span(_pos, ref);
+    _pos += ref;
+
+    // The empty string is never referred to.
+    if (ref) _strings3.push_back(str);
+    return true;
+}
+
+bool
+Decoder::readDouble(double& d)
+{
+    if (_end - _pos < 8) return false;
+
+    std::uint64_t bits = 0;
+    for (int i = 0; i < 8; ++i) {
+        bits = (bits << 8) | _pos[i];
+    }
+    std::memcpy(&d, &bits, 8);
+    _pos += 8;
+    return true;
+}
+
+Decoder::Event
+Decoder::push(Frame::Kind kind, size_t remaining, size_t traits)
+{
+    Frame f;
+    f.kind = kind;
+    f.key = (kind != Frame::STRICT_ARRAY0);
+    f.dense = false;
+    f.remaining = remaining;
+    f.traits = traits;
+    f.sealed = 0;
+    _stack.push_back(f);
+
+    _index = _objects++;
+
+    switch (kind) {
+        case Frame::OBJECT0:
+        case Frame::OBJECT3:
+            return OBJECT;
+        case Frame::ECMA_ARRAY0:
+            return ECMA_ARRAY;
+        default:
+            return ARRAY;
+    }
+}
+
+Decoder::Event
+Decoder::fail()
+{
+    _error = true;
+    return NONE;
+}
+
+Encoder::Encoder(SimpleBuffer& buf, Encoding enc)
+    :
+    _buf(buf),
+    _encoding(enc),
+    _objects3(0),
+    _stringCount(0)
+{
+}
+
+void
+Encoder::reset()
+{
+    _stack.clear();
+    _objects.clear();
+    _objects3 = 0;
+    std::fill(_strings.begin(), _strings.end(), StringRef());
+    _stringCount = 0;
+    _traits.clear();
+}
+
+void
+Encoder::writeNumber(double d)
+{
+    value();
+    if (_encoding == AMF3) {
+        _buf.appendByte(DOUBLE_AMF3);
+    }
+    else {
+        _buf.appendByte(NUMBER_AMF0);
+    }
+    writePlainDouble(d);
+}
+
+void
+Encoder::writeInteger(std::int32_t i)
+{
+    if (_encoding != AMF3 || i > MAX_INTEGER3 || i < MIN_INTEGER3) {
+        writeNumber(i);
+        return;
+    }
+    value();
+    _buf.appendByte(INTEGER_AMF3);
+    writeU29(static_cast<std::uint32_t>(i));
+}
+
+void
+Encoder::writeBoolean(bool b)
+{
+    value();
+    if (_encoding == AMF3) {
+        _buf.appendByte(b ? TRUE_AMF3 : FALSE_AMF3);
+        return;
+    }
+    _buf.appendByte(BOOLEAN_AMF0);
+    _buf.appendByte(b ? 1 : 0);
+}
+
+void
+Encoder::writeString(const char* str, size_t size)
+{
+    value();
+    if (_encoding == AMF3) {
+        _buf.appendByte(STRING_AMF3);
+        writeString3(reinterpret_cast<const std::uint8_t*>(str), size);
+        return;
+    }
+    if (size < 65536) {
+        _buf.appendByte(STRING_AMF0);
+        _buf.appendNetworkShort(size);
+    }
+    else {
+        _buf.appendByte(LONG_STRING_AMF0);
+        _buf.appendNetworkLong(size);
+    }
+    _buf.append(str, size);
+}
+
+void
+Encoder::writeNull()
+{
+    value();
+    if (_encoding == AMF3) {
+        _buf.appendByte(NULL_AMF3);
+    }
+    else {
+        _buf.appendByte(NULL_AMF0);
+    }
+}
+
+void
+Encoder::writeUndefined()
+{
+    value();
+    if (_encoding == AMF3) {
+        _buf.appendByte(UNDEFINED_AMF3);
+    }
+    else {
+        _buf.appendByte(UNDEFINED_AMF0);
+    }
+}
+
+void
+Encoder::writeDate(double d)
+{
+    value();
+    if (_encoding == AMF3) {
+        _buf.appendByte(DATE_AMF3);
+        writeU29(1);
+        writePlainDouble(d);
+        ++_objects3;
+        return;
+    }
+    _buf.appendByte(DATE_AMF0);
+    writePlainDouble(d);
+    // This should be timezone
+    _buf.appendNetworkShort(0);
+}
+
+void
+Encoder::writeXML(const char* str, size_t size)
+{
+    value();
+    if (_encoding == AMF3) {
+        _buf.appendByte(XML_DOC_AMF3);
+        writeU29((size << 1) | 1);
+        ++_objects3;
+    }
+    else {
+        _buf.appendByte(XML_OBJECT_AMF0);
+        _buf.appendNetworkLong(size);
+    }
+    _buf.append(str, size);
+}
+
+void
+Encoder::writeByteArray(const std::uint8_t* data, size_t size)
+{
+    value();
+    if (_encoding == AMF3) {
+        _buf.appendByte(BYTE_ARRAY_AMF3);
+        writeU29((size << 1) | 1);
+        ++_objects3;
+    }
+    else {
+        _buf.appendByte(LONG_STRING_AMF0);
+        _buf.appendNetworkLong(size);
+    }
+    _buf.append(data, size);
+}
+
+size_t
+Encoder::startObject(const char* className, size_t size)
+{
+    value();
+
+    if (_encoding == AMF0) {
+        if (className) {
+            _buf.appendByte(TYPED_OBJECT_AMF0);
+            _buf.appendNetworkShort(size);
+            _buf.append(className, size);
+        }
+        else {
+            _buf.appendByte(OBJECT_AMF0);
+        }
+        const size_t idx = addObject(OBJECT_AMF0, _objects.size() + 1);
+        push(Frame::OBJECT);
+        return idx;
+    }
+
+    const std::uint8_t* cls = reinterpret_cast<const std::uint8_t*>(className);
+    if (!cls) size = 0;
+
+    _buf.appendByte(OBJECT_AMF3);
+
+    // All objects are written as dynamic, with no sealed members, so
+    // the traits only differ by class.
+    const std::uint8_t* data = _buf.data();
+    size_t traits = 0;
+    for (; traits < _traits.size(); ++traits) {
+        const StringRef& t = _traits[traits];
+        if (t.size == size && (!size ||
+                    !std::memcmp(data + t.offset, cls, size))) {
+            break;
+        }
+    }
+
+    if (traits < _traits.size()) {
+        writeU29((traits << 2) | 1);
+    }
+    else {
+        writeU29(0x0b);
+        StringRef t = StringRef();
+        t.offset = writeString3(cls, size);
+        t.size = size;
+        _traits.push_back(t);
+    }
+
+    const size_t idx = addObject(OBJECT_AMF3, _objects3++);
+    push(Frame::OBJECT);
+    return idx;
+}
+
+size_t
+Encoder::startArray(size_t count)
+{
+    value();
+
+    size_t idx;
+    if (_encoding == AMF3) {
+        _buf.appendByte(ARRAY_AMF3);
+        writeU29((count << 1) | 1);
+        idx = addObject(ARRAY_AMF3, _objects3++);
+    }
+    else {
+        _buf.appendByte(STRICT_ARRAY_AMF0);
+        _buf.appendNetworkLong(count);
+        idx = addObject(STRICT_ARRAY_AMF0, _objects.size() + 1);
+    }
+    push(Frame::ARRAY);
+    return idx;
+}
+
+size_t
+Encoder::startECMAArray(size_t count)
+{
+    value();
+
+    size_t idx;
+    if (_encoding == AMF3) {
+        _buf.appendByte(ARRAY_AMF3);
+        writeU29(1);
+        idx = addObject(ARRAY_AMF3, _objects3++);
+    }
+    else {
+        _buf.appendByte(ECMA_ARRAY_AMF0);
+        _buf.appendNetworkLong(count);
+        idx = addObject(ECMA_ARRAY_AMF0, _objects.size() + 1);
+    }
+    push(Frame::ECMA_ARRAY);
+    return idx;
+}
+
+void
+Encoder::writeKey(const char* str, size_t size)
+{
+    if (!_stack.empty()) _stack.back().key = true;
+
+    if (_encoding == AMF3) {
+        writeString3(reinterpret_cast<const std::uint8_t*>(str), size);
+        return;
+    }
+    _buf.appendNetworkShort(size);
+    _buf.append(str, size);
+}
+
+void
+Encoder::end()
+{
+    assert(!_stack.empty());
+    const Frame f = _stack.back();
+    _stack.pop_back();
+
+    if (_encoding == AMF3) {
+        // The empty string ends the dynamic members of an object, and
+        // the named members of an array.
+        if (f.kind != Frame::ARRAY || !f.dense) writeU29(1);
+        return;
+    }
+
+    if (f.kind != Frame::ARRAY) {
+        _buf.appendNetworkShort(0);
+        _buf.appendByte(OBJECT_END_AMF0);
+    }
+}
+
+void
+Encoder::writeReference(size_t index)
+{
+    assert(index < _objects.size());
+    value();
+
+    const ObjectRef& o = _objects[index];
+    if (_encoding == AMF3) {
+        _buf.appendByte(o.marker);
+        writeU29(o.wire << 1);
+        return;
+    }
+    _buf.appendByte(REFERENCE_AMF0);
+    _buf.appendNetworkShort(o.wire);
+}
+
+void
+Encoder::value()
+{
+    if (_stack.empty()) return;
+
+    Frame& f = _stack.back();
+    if (_encoding == AMF3 && f.kind == Frame::ARRAY && !f.key && !f.dense) {
+        writeU29(1);
+        f.dense = true;
+    }
+    f.key = false;
+}
+
+void
+Encoder::push(Frame::Kind kind)
+{
+    Frame f;
+    f.kind = kind;
+    f.dense = false;
+    f.key = false;
+    _stack.push_back(f);
+}
+
+void
+Encoder::writeU29(std::uint32_t val)
+{
+    val &= 0x1fffffff;
+    if (val < 0x80) {
+        _buf.appendByte(val);
+    }
+    else if (val < 0x4000) {
+        _buf.appendByte((val >> 7) | 0x80);
+        _buf.appendByte(val & 0x7f);
+    }
+    else if (val < 0x200000) {
+        _buf.appendByte((val >> 14) | 0x80);
+        _buf.appendByte(((val >> 7) & 0x7f) | 0x80);
+        _buf.appendByte(val & 0x7f);
+    }
+    else {
+        _buf.appendByte((val >> 22) | 0x80);
+        _buf.appendByte(((val >> 15) & 0x7f) | 0x80);
+        _buf.appendByte(((val >> 8) & 0x7f) | 0x80);
+        _buf.appendByte(val & 0xff);
+    }
+}
+
+void
+Encoder::writePlainDouble(double d)
+{
+    std::uint64_t bits;
+    std::memcpy(&bits, &d, 8);
+    std::uint8_t b[8];
+    for (int i = 7; i >= 0; --i) {
+        b[i] = bits & 0xff;
+        bits >>= 8;
+    }
+    _buf.append(b, 8);
+}
+
+size_t
+Encoder::addObject(std::uint8_t marker, std::uint32_t wire)
+{
+    const ObjectRef o = { wire, marker };
+    _objects.push_back(o);
+    return _objects.size() - 1;
+}
+
+std::uint32_t
+Encoder::writeString3(const std::uint8_t* str, size_t size)
+{
+    if (!size) {
+        writeU29(1);
+        return _buf.size();
+    }
+
+    const std::uint32_t hash = hashString(str, size);
+    const StringRef* s = findString(str, size, hash);
+    if (s) {
+        writeU29((s->index - 1) << 1);
+        return s->offset;
+    }
+
+    writeU29((size << 1) | 1);
+    const std::uint32_t offset = _buf.size();
+    _buf.append(str, size);
+    addString(offset, size, hash);
+    return offset;
+}
+
+const Encoder::StringRef*
+Encoder::findString(const std::uint8_t* str, size_t size,
+        std::uint32_t hash) const
+{
+    if (_strings.empty()) return nullptr;
+
+    const std::uint8_t* data = _buf.data();
+    const size_t mask = _strings.size() - 1;
+    for (size_t i = hash & mask; _strings[i].index; i = (i + 1) & mask) {
+        const StringRef& s = _strings[i];
+        if (s.hash == hash && s.size == size &&
+                !std::memcmp(data + s.offset, str, size)) {
+            return &s;
+        }
+    }
+    return nullptr;
+}
+
+void
+Encoder::addString(std::uint32_t offset, std::uint32_t size,
+        std::uint32_t hash)
+{
+    // Keep the table at most half full.
+    if ((_stringCount + 1) * 2 > _strings.size()) {
+        std::vector<StringRef> old(std::max<size_t>(64, _strings.size() * 2));
+        old.swap(_strings);
+        const size_t mask = _strings.size() - 1;
+        for (size_t i = 0; i < old.size(); ++i) {
+            if (!old[i].index) continue;
+            size_t j = old[i].hash & mask;
+            while (_strings[j].index) j = (j + 1) & mask;
+            _strings[j] = old[i];
+        }
+    }
+
+    const size_t mask = _strings.size() - 1;
+    size_t i = hash & mask;
+    while (_strings[i].index) i = (i + 1) & mask;
+
+    StringRef& s = _strings[i];
+    s.offset = offset;
+    s.size = size;
+    s.hash = hash;
+    s.index = ++_stringCount;
+}
+
+} // namespace amf
+} // namespace gnash
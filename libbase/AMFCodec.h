@@ -0,0 +1,440 @@
+// AMFCodec.h    Streaming AMF0 and AMF3 decoding and encoding.
+//
+//   Copyright (C) 2005, 2006, 2007, 2008, 2009, 2010, 2011, 2012
+//   Free Software Foundation, Inc
+//
+// This program is free software; you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation; either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program; if not, write to the Free Software
+// Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+
+// This file provides a decoder and an encoder for AMF that work on a
+// buffer one value at a time, without building any tree of values, so
+// each caller can build its own: as_values in libcore, Elements in
+// cygnal. It can be used without reliance on libcore.
+
+#ifndef GNASH_AMFCODEC_H
+#define GNASH_AMFCODEC_H
+
+#include <string>
+#include <vector>
+#include <cstdint>
+#include <cstring>
+
+#include "dsodefs.h"
+#include "AMF.h"
+
+namespace gnash {
+    class SimpleBuffer;
+}
+
+namespace gnash {
+namespace amf {
+
+/// The two versions of AMF.
+//
+/// These are the values of NetConnection.objectEncoding.
+enum Encoding {
+    AMF0 = 0,
+    AMF3 = 3
+};
+
+/// AMF3 type markers.
+enum Type3 {
+    UNDEFINED_AMF3  = 0x00,
+    NULL_AMF3       = 0x01,
+    FALSE_AMF3      = 0x02,
+    TRUE_AMF3       = 0x03,
+    INTEGER_AMF3    = 0x04,
+    DOUBLE_AMF3     = 0x05,
+    STRING_AMF3     = 0x06,
+    XML_DOC_AMF3    = 0x07,
+    DATE_AMF3       = 0x08,
+    ARRAY_AMF3      = 0x09,
+    OBJECT_AMF3     = 0x0a,
+    XML_AMF3        = 0x0b,
+    BYTE_ARRAY_AMF3 = 0x0c
+};
+
+/// A string or other bytes inside an AMF buffer.
+//
+/// The data is used where it is, so it is only valid as long as the
+/// buffer is.
+struct Span
+{
+    Span() : data(nullptr), size(0) {}
+
+    Span(const std::uint8_t* d, size_t s) : data(d), size(s) {}
+
+    std::string toString() const {
+        return std::string(reinterpret_cast<const char*>(data), size);
+    }
+
+    bool operator==(const char* str) const {
+        return std::strlen(str) == size && !std::memcmp(data, str, size);
+    }
+
+    const std::uint8_t* data;
+    size_t size;
+};
+
+/// Read AMF values from a buffer one part at a time.
+//
+/// Each call to next() reads one simple value, or the start or end of an
+/// object or array, or the name of the next member of one. Strings are
+/// not copied, but returned as Spans into the buffer. Objects are only
+/// numbered, so the caller can build what it wants from them, and
+/// resolve references to them.
+//
+/// AMF3 values are read when the decoder is made for AMF3, and inside
+/// AMF0 after an AVMPLUS_OBJECT_AMF0 marker. AMF3 string, traits and
+/// object references are resolved by the decoder.
+//
+/// The reference tables and the nesting are kept in vectors that are
+/// reused after reset(), so a decoder used for many messages stops
+/// allocating. Malformed AMF never throws; next() returns NONE and
+/// error() is set.
+class DSOEXPORT Decoder
+{
+public:
+
+    /// What next() read.
+    enum Event {
+        /// The end of the buffer, or an error.
+        NONE,
+        NUMBER,
+        /// An AMF3 integer.
+        INTEGER,
+        BOOLEAN,
+        STRING,
+        NULL_VALUE,
+        UNDEFINED,
+        /// A date, as milliseconds since the epoch in number().
+        DATE,
+        /// An XML document, as text in string().
+        XML,
+        /// An AMF3 ByteArray, in string().
+        BYTE_ARRAY,
+        /// An object or array that started earlier, numbered by index().
+        REFERENCE,
+        /// The start of an object. KEY events, each followed by a
+        /// value, come before its END.
+        OBJECT,
+        /// The start of a dense array of count() values. In AMF3 it
+        /// may have named members too, as KEY events before the
+        /// values.
+        ARRAY,
+        /// The start of an associative array. KEY events, each
+        /// followed by a value, come before its END.
+        ECMA_ARRAY,
+        /// The name of the next member, in string().
+        KEY,
+        /// The end of the innermost object or array.
+        END
+    };
+
+    /// Create a decoder for a buffer.
+    //
+    /// @param pos      The start of the AMF data.
+    /// @param end      The end of the buffer.
+    /// @param enc      The encoding of the top level values.
+    Decoder(const std::uint8_t* pos, const std::uint8_t* end,
+            Encoding enc = AMF0);
+
+    /// Read the next part of the buffer.
+    Event next();
+
+    /// Skip the rest of an object or array that has just started.
+    //
+    /// @param e    The event just read. Nothing is skipped for
+    ///             simple values.
+    /// @return     false if the buffer ends first, or is malformed.
+    bool skip(Event e);
+
+    /// The value of NUMBER and DATE.
+    double number() const { return _number; }
+
+    /// The value of INTEGER.
+    std::int32_t integer() const { return _integer; }
+
+    /// The value of BOOLEAN.
+    bool boolean() const { return _boolean; }
+
+    /// The value of STRING, KEY, XML and BYTE_ARRAY.
+    const Span& string() const { return _string; }
+
+    /// The class of a typed OBJECT, or an empty Span.
+    const Span& className() const { return _className; }
+
+    /// The number of dense values in an ARRAY, and the length of an
+    /// ECMA_ARRAY.
+    size_t count() const { return _count; }
+
+    /// The number of an OBJECT, ARRAY or ECMA_ARRAY, or of the one a
+    /// REFERENCE is to. They are numbered from 0 in the order they
+    /// start, in either encoding.
+    size_t index() const { return _index; }
+
+    /// How many objects and arrays the next part is inside.
+    size_t depth() const { return _stack.size(); }
+
+    /// The read position.
+    const std::uint8_t* position() const { return _pos; }
+
+    /// Move the read position, keeping the references.
+    //
+    /// This is for callers reading some parts of the buffer themselves.
+    /// Any object being read, and any error, is forgotten.
+    void seek(const std::uint8_t* pos);
+
+    /// Start on another buffer, forgetting all references.
+    void reset(const std::uint8_t* pos, const std::uint8_t* end);
+
+    /// Whether the AMF was malformed.
+    bool error() const { return _error; }
+
+private:
+
+    /// An object or array being read.
+    struct Frame {
+        enum Kind {
+            OBJECT0,
+            ECMA_ARRAY0,
+            STRICT_ARRAY0,
+            OBJECT3,
+            ARRAY3
+        };
+        Kind kind;
+        /// Whether a member name comes next, rather than a value.
+        bool key;
+        /// For AMF3 arrays, whether the named members have ended.
+        bool dense;
+        /// The dense values left.
+        size_t remaining;
+        /// The traits of an AMF3 object, and its next sealed member.
+        size_t traits;
+        size_t sealed;
+    };
+
+    /// The class of AMF3 objects.
+    struct Traits {
+        Span className;
+        bool dynamic;
+        /// The sealed member names, in _names3.
+        size_t first;
+        size_t count;
+    };
+
+    /// An entry in the AMF3 object reference table. Dates, XML and
+    /// ByteArrays are simply read again, objects and arrays become
+    /// REFERENCEs.
+    struct Object3 {
+        Event type;
+        size_t index;
+        double number;
+        Span string;
+    };
+
+    Event readValue(Encoding enc);
+    Event readValue0();
+    Event readValue3();
+    bool readU29(std::uint32_t& val);
+    bool readString3(Span& str);
+    bool readDouble(double& d);
+    Event push(Frame::Kind kind, size_t remaining, size_t traits = 0);
+    Event fail();
+
+    const std::uint8_t* _pos;
+    const std::uint8_t* _end;
+    Encoding _encoding;
+    bool _error;
+
+    double _number;
+    std::int32_t _integer;
+    bool _boolean;
+    Span _string;
+    Span _className;
+    size_t _count;
+    size_t _index;
+
+    std::vector<Frame> _stack;
+
+    /// The number the next object will be given.
+    size_t _objects;
+
+    /// The AMF0 reference table, giving the number of each object.
+    std::vector<size_t> _objects0;
+
+    /// The AMF3 reference tables.
+    std::vector<Span> _strings3;
+    std::vector<Traits> _traits3;
+    std::vector<Span> _names3;
+    std::vector<Object3> _objects3;
+};
+
+/// Write AMF values to a buffer one part at a time.
+//
+/// Objects and arrays are written by starting them, writing a key and
+/// a value for each member, and ending them. Each object and array
+/// is given a number when started, so it can be written again later
+/// as a reference. In AMF3, strings and the classes of typed objects
+/// are written once and referred to afterwards; the table of them
+/// points into the buffer, so costs no allocation per string.
+class DSOEXPORT Encoder
+{
+public:
+
+    /// Create an encoder.
+    //
+    /// @param buf  The buffer to append to.
+    /// @param enc  The encoding to write.
+    Encoder(SimpleBuffer& buf, Encoding enc = AMF0);
+
+    void writeNumber(double d);
+
+    /// Write an integer, which AMF0 and large AMF3 values store as
+    /// a number.
+    void writeInteger(std::int32_t i);
+
+    void writeBoolean(bool b);
+
+    /// Write a string, long or short as needed.
+    void writeString(const char* str, size_t size);
+    void writeString(const std::string& str) {
+        writeString(str.data(), str.size());
+    }
+
+    void writeNull();
+    void writeUndefined();
+
+    /// Write a date, as milliseconds since the epoch.
+    void writeDate(double d);
+
+    /// Write an XML document.
+    void writeXML(const char* str, size_t size);
+
+    /// Write a ByteArray, which in AMF0 is a long string.
+    void writeByteArray(const std::uint8_t* data, size_t size);
+
+    /// Start an object.
+    //
+    /// @param className    The class of a typed object, or 0.
+    /// @return             The number of the object.
+    size_t startObject(const char* className = nullptr, size_t size = 0);
+
+    /// Start a dense array.
+    //
+    /// @param count    The number of values that will be written.
+    /// @return         The number of the array.
+    size_t startArray(size_t count);
+
+    /// Start an associative array.
+    //
+    /// In AMF3 this is an array with only named members.
+    //
+    /// @param count    The length of the array.
+    /// @return         The number of the array.
+    size_t startECMAArray(size_t count);
+
+    /// Write the name of the next member of an object or array.
+    //
+    /// At the top level this writes a name to be followed by a value,
+    /// as SharedObject files have.
+    void writeKey(const char* str, size_t size);
+    void writeKey(const std::string& str) {
+        writeKey(str.data(), str.size());
+    }
+
+    /// End the innermost object or array.
+    void end();
+
+    /// Write an object or array again.
+    //
+    /// @param index    The number returned when it was started.
+    void writeReference(size_t index);
+
+    /// Forget all references, keeping the memory for them.
+    void reset();
+
+    /// How many objects and arrays are being written.
+    size_t depth() const { return _stack.size(); }
+
+    Encoding encoding() const { return _encoding; }
+
+private:
+
+    struct Frame {
+        enum Kind {
+            OBJECT,
+            ARRAY,
+            ECMA_ARRAY
+        };
+        Kind kind;
+        /// For AMF3 arrays, whether the named members have ended.
+        bool dense;
+        /// Whether a key has been written without its value.
+        bool key;
+    };
+
+    /// A string in the buffer, for AMF3 string references.
+    struct StringRef {
+        std::uint32_t offset;
+        std::uint32_t size;
+        std::uint32_t hash;
+        /// The reference index plus one, 0 for an empty slot.
+        std::uint32_t index;
+    };
+
+    /// An object or array, and how it is referred to.
+    struct ObjectRef {
+        std::uint32_t wire;
+        std::uint8_t marker;
+    };
+
+    /// Called before each value, to end the named part of an AMF3
+    /// array.
+    void value();
+
+    void push(Frame::Kind kind);
+    void writeU29(std::uint32_t val);
+    void writePlainDouble(double d);
+    size_t addObject(std::uint8_t marker, std::uint32_t wire);
+
+    /// Write an AMF3 string or a reference to it.
+    //
+    /// @return The offset of the string in the buffer.
+    std::uint32_t writeString3(const std::uint8_t* str, size_t size);
+
+    /// Find a string already written.
+    const StringRef* findString(const std::uint8_t* str, size_t size,
+                                std::uint32_t hash) const;
+
+    void addString(std::uint32_t offset, std::uint32_t size,
+                   std::uint32_t hash);
+
+    SimpleBuffer& _buf;
+    Encoding _encoding;
+    std::vector<Frame> _stack;
+    std::vector<ObjectRef> _objects;
+    /// The next AMF3 object reference index.
+    std::uint32_t _objects3;
+    /// An open hash table of the AMF3 strings written.
+    std::vector<StringRef> _strings;
+    std::uint32_t _stringCount;
+    /// The class names of AMF3 traits, in the buffer.
+    std::vector<StringRef> _traits;
+};
+
+} // namespace amf
+} // namespace gnash
+
+#endif
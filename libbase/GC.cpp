@@ -20,6 +20,9 @@
 #include "GC.h"
 
 #include <cstdlib>
+#include <chrono>
+#include <iostream>
+#include <iomanip>
 
 #include "utility.h" // for typeName()
 #include "GnashAlgorithm.h"
@@ -31,10 +34,54 @@
 
 namespace gnash {
 
+namespace {
+
+typedef std::chrono::steady_clock Clock;
+
+std::uint64_t
+elapsedMicroseconds(const Clock::time_point& start)
+{
+    return std::chrono::duration_cast<std::chrono::microseconds>(
+            Clock::now() - start).count();
+}
+
+void
+dumpHistogram(std::ostream& os, const std::string& label,
+        const GC::PauseHistogram& h)
+{
+    os << label << " pauses: " << h.count << ", total " << h.total
+       << "us, max " << h.max << "us" << std::endl;
+
+    for (size_t i = 0; i < h.buckets.size(); ++i) {
+        if (!h.buckets[i]) continue;
+        os << std::setw(10) << h.buckets[i] << ": ";
+        if (i + 1 == h.buckets.size()) os << ">= " << (1UL << (i - 1));
+        else os << "< " << (1UL << i);
+        os << "us" << std::endl;
+    }
+}
+
+}
+
+GC* GC::_current = nullptr;
+
+void
+GC::PauseHistogram::add(std::uint64_t usecs)
+{
+    size_t bucket = 0;
+    while (usecs >> bucket && bucket + 1 < buckets.size()) ++bucket;
+    ++buckets[bucket];
+    ++count;
+    total += usecs;
+    if (usecs > max) max = usecs;
+}
+
 GC::GC(GcRoot& root)
     :
     // might raise the default ...
     _maxNewCollectablesCount(64),
+    _budget(2000),
+    _marking(false),
     _resListSize(0),
     _root(root),
     _lastResCount(0)
@@ -50,6 +97,10 @@ GC::GC(GcRoot& root)
         const size_t gap = std::strtoul(gcgap, nullptr, 0);
         _maxNewCollectablesCount = gap;
     }
+    char* budget = std::getenv("GNASH_GC_BUDGET");
+    if (budget) {
+        _budget = std::strtoul(budget, nullptr, 0);
+    }
 }
 
 GC::~GC()
@@ -57,23 +108,43 @@ GC::~GC()
 #ifdef GNASH_GC_DEBUG 
     log_debug("GC deleted, deleting all managed resources - collector run %d times", _collectorRuns);
 #endif
+    if (std::getenv("GNASH_GC_STATS")) dumpPauses(std::cerr);
+
     for (ResList::const_iterator i = _resList.begin(), e = _resList.end();
             i != e; ++i) {
         delete *i;
     }
+    for (ResList::const_iterator i = _sweepList.begin(),
+            e = _sweepList.end(); i != e; ++i) {
+        delete *i;
+    }
 }
 
 size_t
-GC::cleanUnreachable()
+GC::sweep(std::uint32_t budget)
 {
 
 #if (GNASH_GC_DEBUG > 1)
     log_debug("GC: sweep scan started");
 #endif
 
+    const Clock::time_point start = Clock::now();
+
     size_t deleted = 0;
+    size_t visited = 0;
+
+    while (!_sweepList.empty()) {
+
+        // Looking at the clock is not free, so only do it every
+        // few resources.
+        if (budget && !(++visited % 64) &&
+                elapsedMicroseconds(start) >= budget) {
+            break;
+        }
+
+        const GcResource* res = _sweepList.front();
+        _sweepList.pop_front();
 
-    _resList.remove_if([&deleted](const GcResource* res) {
         if (!res->isReachable()) {
 
 #if GNASH_GC_DEBUG > 1
@@ -81,16 +152,20 @@ GC::cleanUnreachable()
 #endif
             ++deleted;
             delete res;
-            return true;
         }
         else {
             res->clearReachable();
-            return false;
+            _resList.push_front(res);
         }
-    });
+    }
 
     _resListSize -= deleted;
 
+    // The cycle is complete when everything is swept.
+    if (_sweepList.empty()) _lastResCount = _resListSize;
+
+    _sweepPauses.add(elapsedMicroseconds(start));
+
 #ifdef GNASH_GC_DEBUG 
     log_debug("GC: recycled %d unreachable resources - %d left",
             deleted, _resListSize);
@@ -99,12 +174,11 @@ GC::cleanUnreachable()
     return deleted;
 }
 
-void 
-GC::runCycle()
+void
+GC::startCycle()
 {
-    //
-    // Collection cycle
-    //
+    assert(_sweepList.empty());
+    assert(!_marking);
 
 #ifdef GNASH_GC_DEBUG 
     ++_collectorRuns;
@@ -117,14 +191,91 @@ GC::runCycle()
             _lastResCount, _resListSize);
 #endif // GNASH_GC_DEBUG
 
-    // Mark all resources as reachable
+    // Everything registered so far is to be swept. Anything registered
+    // from now on is kept until the next cycle.
+    _sweepList.swap(_resList);
+    _marking = true;
+}
+
+void
+GC::mark(std::uint32_t budget)
+{
+    assert(_marking);
+
+    const Clock::time_point start = Clock::now();
+
+    Marker m(*this);
+
+    // A partial mark always leaves something queued, so the queue is
+    // only empty at the start of a cycle.
+    if (_gray.empty()) markReachable();
+
+    size_t visited = 0;
+
+    while (!_gray.empty()) {
+
+        // Looking at the clock is not free, so only do it every
+        // few resources.
+        if (budget && !(++visited % 64) &&
+                elapsedMicroseconds(start) >= budget) {
+            _markPauses.add(elapsedMicroseconds(start));
+            return;
+        }
+
+        const GcResource* res = _gray.back();
+        _gray.pop_back();
+        res->markReachableResources();
+        if (!res->hasWriteBarrier()) _rescan.push_back(res);
+    }
+
+    // References stored since the start of the cycle are known to be
+    // marked only for resources using the write barrier. The others,
+    // and the root, are scanned again, in one go as they can change as
+    // soon as we return.
     markReachable();
 
-    // clean unreachable resources, and mark the others as reachable again
-    cleanUnreachable();
+    std::vector<const GcResource*> rescan;
+    rescan.swap(_rescan);
+    for (const GcResource* res : rescan) {
+        res->markReachableResources();
+    }
 
-    _lastResCount = _resListSize;
+    while (!_gray.empty()) {
+        const GcResource* res = _gray.back();
+        _gray.pop_back();
+        res->markReachableResources();
+    }
 
+    // Resources registered while marking are not swept, so their marks
+    // have to be cleared here.
+    for (const GcResource* res : _resList) {
+        res->clearReachable();
+    }
+
+    _marking = false;
+
+    _markPauses.add(elapsedMicroseconds(start));
+}
+
+void 
+GC::runCycle()
+{
+    //
+    // Collection cycle
+    //
+
+    // Complete any cycle in progress, as the marks must be cleared
+    // before marking again.
+    if (_marking) mark(0);
+    if (!_sweepList.empty()) sweep(0);
+
+    startCycle();
+
+    // Find all reachable resources.
+    mark(0);
+
+    // clean unreachable resources, and mark the others as reachable again
+    sweep(0);
 }
 
 void
@@ -133,6 +284,16 @@ GC::countCollectables(CollectablesCount& count) const
     for (const GcResource* resource : _resList) {
         ++count[typeName(*resource)];
     }
+    for (const GcResource* resource : _sweepList) {
+        ++count[typeName(*resource)];
+    }
+}
+
+void
+GC::dumpPauses(std::ostream& os) const
+{
+    dumpHistogram(os, "GC mark", _markPauses);
+    dumpHistogram(os, "GC sweep", _sweepPauses);
 }
 
 } // end of namespace gnash
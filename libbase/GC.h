@@ -32,6 +32,10 @@
 #include <forward_list>
 #include <map>
 #include <string>
+#include <array>
+#include <iosfwd>
+#include <vector>
+#include <cstdint>
 #include <cassert>
 
 #include "dsodefs.h"
@@ -84,32 +88,10 @@ public:
 
     /// Mark this resource as being reachable
     //
-    /// This can trigger further marking of all resources reachable by this
-    /// object.
-    //
-    /// If the object wasn't reachable before, this call triggers
-    /// scan of all contained objects too.
-    void setReachable() const {
-
-        if (_reachable) {
-
-#if GNASH_GC_DEBUG > 2
-            log_debug(_("Instance %p of class %s already reachable, "
-                    "setReachable doing nothing"), (void*)this,
-                    typeName(*this));
-#endif
-            return;
-        }
-
-#if GNASH_GC_DEBUG  > 2
-        log_debug(_("Instance %p of class %s set to reachable, scanning "
-                "reachable resources from it"), (void*)this,
-                typeName(*this));
-#endif
-
-        _reachable = true;
-        markReachableResources();
-    }
+    /// If the object wasn't reachable before, this queues it for
+    /// scanning of all resources reachable from it. It must only be
+    /// called while a GC is marking.
+    void setReachable() const;
 
     /// Return true if this object is marked as reachable
     bool isReachable() const { return _reachable; }
@@ -121,10 +103,10 @@ protected:
 
     /// Scan all GC resources reachable by this instance.
     //
-    /// This function is invoked everytime this object
-    /// switches from unreachable to reachable, and is
-    /// used to recursively mark all contained resources
-    /// as reachable.
+    /// This function is invoked by the GC some time after
+    /// this object switches from unreachable to reachable
+    /// (and once more if hasWriteBarrier() is false), and
+    /// is used to mark all contained resources as reachable.
     ///
     /// See setReachable(), which is the function to invoke
     /// against all reachable methods.
@@ -141,6 +123,19 @@ protected:
 #endif
     }
 
+    /// Whether all references taken by this resource go through a barrier
+    //
+    /// Marking is spread over several GC::fuzzyCollect() calls, so
+    /// references may change after a resource has been scanned. Resources
+    /// returning true promise to pass anything they start referencing to
+    /// GC::writeBarrier() while marking is in progress. All others are
+    /// scanned again when marking is finished.
+    ///
+    /// The default implementation returns false.
+    virtual bool hasWriteBarrier() const {
+        return false;
+    }
+
     /// Delete this resource.
     //
     /// This is protected to allow subclassing, but ideally it
@@ -161,11 +156,58 @@ private:
 ///
 /// Their reachability is detected starting from a root, which in turn
 /// marks all reachable resources.
+///
+/// A collection cycle is spread over as many fuzzyCollect() calls as
+/// needed to keep each of them within a time budget. The budget defaults
+/// to 2 milliseconds and can be changed by the GNASH_GC_BUDGET
+/// environment variable (in microseconds, 0 for no limit).
+///
+/// Resources found reachable are queued, and scanned a few at a time.
+/// References stored in resources already scanned are caught by
+/// writeBarrier() or, for resources not using it, by scanning them again
+/// once the queue is empty. This last step, which also scans the root
+/// again, is done in one go. Resources registered while marking are
+/// not swept by that cycle.
+///
+/// Unreachable resources can't become reachable again, so the sweep
+/// (destruction of the unreachable resources) is spread in the same way.
 class DSOEXPORT GC
 {
 
 public:
 
+    /// Histogram of collector pause times
+    //
+    /// Pauses are counted in buckets by duration: bucket 0 counts pauses
+    /// shorter than 1 microsecond, bucket n pauses of at least 2^(n-1)
+    /// and less than 2^n microseconds. The last bucket counts all longer
+    /// pauses.
+    struct PauseHistogram
+    {
+        PauseHistogram()
+            :
+            buckets(),
+            count(0),
+            total(0),
+            max(0)
+        {}
+
+        /// Record a pause of the given duration in microseconds.
+        void add(std::uint64_t usecs);
+
+        /// Number of pauses in each bucket
+        std::array<std::uint32_t, 24> buckets;
+
+        /// Number of pauses recorded
+        std::uint32_t count;
+
+        /// Sum of all pauses in microseconds
+        std::uint64_t total;
+
+        /// Longest pause in microseconds
+        std::uint64_t max;
+    };
+
     /// Create a garbage collector using the given root
     //
     /// @param root     The top level of the GC, which takes care of marking
@@ -238,6 +280,16 @@ public:
         //    runtime analisys
         //
 
+        // Finish the last cycle first.
+        if (_marking) {
+            mark(_budget);
+            return;
+        }
+        if (!_sweepList.empty()) {
+            sweep(_budget);
+            return;
+        }
+
         if (_resListSize <  _lastResCount + _maxNewCollectablesCount) {
 #if GNASH_GC_DEBUG  > 1
             log_debug(_("GC: collection cycle skipped - %d/%d new resources "
@@ -248,7 +300,8 @@ public:
             return;
         }
 
-        runCycle();
+        startCycle();
+        mark(_budget);
     }
 
     /// Run the collection cycle
@@ -257,17 +310,66 @@ public:
     ///
     void runCycle();
 
+    /// Whether a cycle is marking resources
+    bool marking() const { return _marking; }
+
+    /// Mark a resource about to be referenced by another
+    //
+    /// While marking, resources that have been scanned are not scanned
+    /// again, so anything stored in them must be passed here. Resources
+    /// that do so should say so in GcResource::hasWriteBarrier().
+    ///
+    /// @param ref  The resource, or anything else with a setReachable()
+    ///             function marking the resources it holds.
+    template<typename T>
+    void writeBarrier(const T& ref) {
+        if (!_marking) return;
+        Marker m(*this);
+        ref.setReachable();
+    }
+
+    /// Scan a resource again before marking is finished
+    //
+    /// This is for resources that start holding references in a way
+    /// writeBarrier() can't follow, so that hasWriteBarrier() changes.
+    /// Nothing is done if marking is not in progress or the resource
+    /// was not reached yet.
+    void rescan(const GcResource& res) {
+        if (_marking && res.isReachable()) _gray.push_back(&res);
+    }
+
     typedef std::map<std::string, unsigned int> CollectablesCount;
 
     /// Count collectables
     void countCollectables(CollectablesCount& count) const;
 
+    /// Pause times of each (partial) mark
+    const PauseHistogram& markPauses() const { return _markPauses; }
+
+    /// Pause times of each (partial) sweep
+    const PauseHistogram& sweepPauses() const { return _sweepPauses; }
+
+    /// Print the pause time histograms
+    void dumpPauses(std::ostream& os) const;
+
 private:
 
     /// List of collectables
     typedef std::forward_list<const GcResource*> ResList;
 
-    /// Mark all reachable resources
+    friend class GcResource;
+
+    /// Makes a GC the one resources are queued to by setReachable()
+    class Marker
+    {
+    public:
+        explicit Marker(GC& gc) : _previous(_current) { _current = &gc; }
+        ~Marker() { _current = _previous; }
+    private:
+        GC* _previous;
+    };
+
+    /// Queue all resources reachable from the root
     void markReachable() {
 #if GNASH_GC_DEBUG > 2
         log_debug(_("GC %p: MARK SCAN"), (void*)this);
@@ -275,19 +377,57 @@ private:
         _root.markReachableResources();
     }
 
-    /// Delete all unreachable objects, and mark the others unreachable again
+    /// Queue all resources for sweeping and start marking
     //
-    /// @return number of objects deleted
-    size_t cleanUnreachable();
+    /// Any previous sweep must have been completed.
+    void startCycle();
+
+    /// Scan queued resources, starting from the root
+    //
+    /// When the queue is empty, the root and resources without a write
+    /// barrier are scanned again, and marking is finished.
+    ///
+    /// @param budget   Maximum time to spend in microseconds, or 0 to
+    ///                 complete marking.
+    void mark(std::uint32_t budget);
+
+    /// Delete unreachable objects queued for sweeping
+    //
+    /// Reachable objects are marked unreachable again and moved back to
+    /// the list of collectables.
+    ///
+    /// @param budget   Maximum time to spend in microseconds, or 0 to
+    ///                 complete the sweep.
+    /// @return         number of objects deleted
+    size_t sweep(std::uint32_t budget);
 
     /// Number of newly registered collectable since last collection run
     /// triggering next collection.
     size_t _maxNewCollectablesCount;
 
+    /// Maximum time in microseconds to spend marking or sweeping in each
+    /// fuzzyCollect() call, 0 for no limit.
+    std::uint32_t _budget;
+
+    /// Whether a cycle is marking resources
+    bool _marking;
+
+    /// Resources found reachable but not scanned yet
+    std::vector<const GcResource*> _gray;
+
+    /// Resources to scan again when marking is finished
+    std::vector<const GcResource*> _rescan;
+
     /// List of collectable resources
     ResList _resList;
 
-    /// Size of the ResList to avoid the cost of computing it
+    /// Resources not yet swept since the start of the last cycle
+    //
+    /// Resources registered while a cycle is in progress go to _resList,
+    /// so they are never found unmarked here.
+    ResList _sweepList;
+
+    /// Number of resources in both lists to avoid the cost of computing it
     ResList::size_type _resListSize;
 
     /// The GcRoot.
@@ -297,12 +437,42 @@ private:
     /// collect() call.
     ResList::size_type _lastResCount;
 
+    PauseHistogram _markPauses;
+
+    PauseHistogram _sweepPauses;
+
 #ifdef GNASH_GC_DEBUG 
     /// Number of times the collector runs (stats/profiling)
     size_t _collectorRuns;
 #endif
+
+    /// The GC marking resources, if any
+    static GC* _current;
 };
 
+inline void
+GcResource::setReachable() const
+{
+    if (_reachable) {
+
+#if GNASH_GC_DEBUG > 2
+        log_debug(_("Instance %p of class %s already reachable, "
+                "setReachable doing nothing"), (void*)this,
+                typeName(*this));
+#endif
+        return;
+    }
+
+#if GNASH_GC_DEBUG  > 2
+    log_debug(_("Instance %p of class %s set to reachable, queueing "
+            "for scan of reachable resources from it"), (void*)this,
+            typeName(*this));
+#endif
+
+    assert(GC::_current);
+    _reachable = true;
+    GC::_current->_gray.push_back(this);
+}
 
 inline GcResource::GcResource(GC& gc)
     :
@@ -0,0 +1,269 @@
+// Inflater.cpp:  An IOChannel decompressing another one ahead of its reader.
+//
+//   Copyright (C) 2005, 2006, 2007, 2008, 2009, 2010, 2011, 2012
+//   Free Software Foundation, Inc
+//
+// This program is free software; you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation; either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program; if not, write to the Free Software
+// Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+//
+
+#include "Inflater.h"
+
+#include <algorithm>
+#include <cstring>
+
+#include "GnashException.h"
+#include "log.h"
+#include "rc.h"
+
+namespace gnash {
+
+const size_t Inflater::chunkSize;
+const size_t Inflater::checkpointInterval;
+
+namespace {
+
+size_t
+windowSize(size_t window)
+{
+    if (!window) {
+        const int kb = RcInitFile::getDefaultInstance().inflateWindow();
+        window = std::max(kb, 0) * 1024UL;
+    }
+    return std::max(window, Inflater::chunkSize);
+}
+
+}
+
+Inflater::Inflater(std::unique_ptr<Codec> codec, std::streampos start,
+        size_t window)
+    :
+    _codec(std::move(codec)),
+    _start(start),
+    _window(windowSize(window)),
+    _aheadBytes(0),
+    _stop(false),
+    _finished(false),
+    _windowStart(start),
+    _windowBytes(0),
+    _pos(start),
+    _done(false),
+    _bad(false)
+{
+    assert(_codec.get());
+    startThread(start);
+}
+
+Inflater::~Inflater()
+{
+    stopThread();
+}
+
+std::streamsize
+Inflater::read(void* dst, std::streamsize bytes)
+{
+    std::uint8_t* out = static_cast<std::uint8_t*>(dst);
+    std::streamsize got = 0;
+
+    while (got < bytes) {
+        if (_pos == windowEnd() && !nextChunk()) break;
+
+        const size_t offset = _pos - _windowStart;
+        const Chunk& chunk = _chunks[offset / chunkSize];
+        const size_t from = offset % chunkSize;
+        const size_t n = std::min<size_t>(chunk.size() - from, bytes - got);
+        std::memcpy(out + got, &chunk[from], n);
+        got += n;
+        _pos += n;
+    }
+    return got;
+}
+
+bool
+Inflater::seek(std::streampos pos)
+{
+    if (pos < _start) return false;
+
+    if (pos < _windowStart) restart(pos);
+
+    while (pos > windowEnd()) {
+        if (!nextChunk()) {
+            log_error("Trouble: can't seek any further.. ");
+            _pos = windowEnd();
+            return false;
+        }
+    }
+    _pos = pos;
+    return true;
+}
+
+void
+Inflater::go_to_end()
+{
+    if (_bad) {
+        throw IOException("Inflater is in error condition, "
+                "can't seek to end");
+    }
+    while (nextChunk()) {}
+    _pos = windowEnd();
+}
+
+bool
+Inflater::nextChunk()
+{
+    if (_done) return false;
+
+    Chunk chunk;
+    {
+        std::unique_lock<std::mutex> lock(_mutex);
+        _changed.wait(lock, [this] { return !_ahead.empty() || _finished; });
+        if (_ahead.empty()) {
+            if (_error) {
+                _bad = true;
+                std::rethrow_exception(_error);
+            }
+            _done = true;
+            return false;
+        }
+        chunk.swap(_ahead.front());
+        _ahead.pop_front();
+        _aheadBytes -= chunk.size();
+
+        // A short chunk is the last, unless an error follows.
+        _done = chunk.size() < chunkSize && !_error;
+    }
+    _changed.notify_all();
+
+    // Everything before is read, so keep a window of it.
+    while (!_chunks.empty() && _windowBytes - _chunks.front().size() +
+            chunk.size() > _window) {
+        _windowBytes -= _chunks.front().size();
+        _windowStart += static_cast<std::streamoff>(_chunks.front().size());
+        _chunks.pop_front();
+    }
+
+    _windowBytes += chunk.size();
+    _chunks.push_back(std::move(chunk));
+    return true;
+}
+
+void
+Inflater::restart(std::streampos pos)
+{
+    stopThread();
+
+    std::streampos from = _start;
+    const Checkpoint* checkpoint = nullptr;
+    auto it = _checkpoints.upper_bound(pos);
+    if (it != _checkpoints.begin()) {
+        --it;
+        from = it->first;
+        checkpoint = it->second.get();
+    }
+
+    log_debug("inflater restarting from %d due to seek back from %d to %d",
+            from, _pos, pos);
+
+    _chunks.clear();
+    _windowStart = from;
+    _windowBytes = 0;
+    _pos = from;
+    _done = false;
+    _bad = false;
+
+    _codec->restart(checkpoint);
+    startThread(from);
+}
+
+void
+Inflater::startThread(std::streampos from)
+{
+    _ahead.clear();
+    _aheadBytes = 0;
+    _stop = false;
+    _finished = false;
+    _error = nullptr;
+    _thread = std::thread(&Inflater::produce, this, from);
+}
+
+void
+Inflater::stopThread()
+{
+    {
+        std::lock_guard<std::mutex> lock(_mutex);
+        _stop = true;
+    }
+    _changed.notify_all();
+    if (_thread.joinable()) _thread.join();
+}
+
+void
+Inflater::produce(std::streampos pos)
+{
+    bool checkpoints = true;
+
+    for (;;) {
+        {
+            std::unique_lock<std::mutex> lock(_mutex);
+            _changed.wait(lock, [this] {
+                return _stop || _aheadBytes < _window;
+            });
+            if (_stop) return;
+        }
+
+        Chunk chunk(chunkSize);
+        size_t size = 0;
+        std::exception_ptr error;
+        try {
+            while (size < chunkSize) {
+                const size_t got = _codec->decompress(&chunk[size],
+                        chunkSize - size);
+                if (!got) break;
+                size += got;
+            }
+        }
+        catch (...) {
+            error = std::current_exception();
+        }
+        chunk.resize(size);
+        pos += size;
+
+        // Only this thread adds checkpoints.
+        std::unique_ptr<Checkpoint> checkpoint;
+        if (!error && size == chunkSize && checkpoints &&
+                (pos - _start) % checkpointInterval == 0 &&
+                !_checkpoints.count(pos)) {
+            checkpoint = _codec->checkpoint();
+            checkpoints = checkpoint.get();
+        }
+
+        {
+            std::lock_guard<std::mutex> lock(_mutex);
+            if (checkpoint) {
+                _checkpoints.insert(std::make_pair(pos,
+                            std::move(checkpoint)));
+            }
+            if (size) {
+                _aheadBytes += size;
+                _ahead.push_back(std::move(chunk));
+            }
+            _error = error;
+            _finished = error || size < chunkSize;
+        }
+        _changed.notify_all();
+        if (error || size < chunkSize) return;
+    }
+}
+
+} // namespace gnash
@@ -0,0 +1,185 @@
+// Inflater.h:  An IOChannel decompressing another one ahead of its reader.
+//
+//   Copyright (C) 2005, 2006, 2007, 2008, 2009, 2010, 2011, 2012
+//   Free Software Foundation, Inc
+//
+// This program is free software; you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation; either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program; if not, write to the Free Software
+// Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+//
+
+#ifndef GNASH_INFLATER_H
+#define GNASH_INFLATER_H
+
+#include "IOChannel.h"
+
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <exception>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace gnash {
+
+/// Reads the decompressed content of another IOChannel.
+//
+/// A thread of its own decompresses up to a window of data ahead of the
+/// reader, and the last window of data read is kept, so that seeking
+/// back within it costs nothing. Seeking back further restarts
+/// decompression from the nearest checkpoint saved by the Codec, or
+/// from the beginning if it can't save any.
+///
+/// Positions start from that of the compressed data in its channel, as
+/// SWF headers are not compressed.
+class Inflater : public IOChannel
+{
+public:
+
+    /// Saved state of a Codec.
+    class Checkpoint
+    {
+    public:
+        virtual ~Checkpoint() {}
+    };
+
+    /// A decompressor, only used by one thread at a time.
+    class Codec
+    {
+    public:
+        virtual ~Codec() {}
+
+        /// Decompress some data.
+        //
+        /// @return The number of bytes decompressed, which is 0 only at
+        ///         the end of the data.
+        /// @throw  ParserException if the data are corrupt.
+        virtual size_t decompress(std::uint8_t* dst, size_t size) = 0;
+
+        /// Save the state, to restart from here later.
+        //
+        /// @return The state, or null if this Codec can't save it.
+        virtual std::unique_ptr<Checkpoint> checkpoint() = 0;
+
+        /// Restart from a Checkpoint of this Codec, or the beginning.
+        //
+        /// @throw  ParserException if the compressed data can't be
+        ///         read again.
+        virtual void restart(const Checkpoint* from) = 0;
+    };
+
+    /// @param codec    Decompresses the data.
+    /// @param start    The position of the compressed data in its
+    ///                 channel, which is the first position here.
+    /// @param window   The number of bytes to decompress ahead, and to
+    ///                 keep once read. 0 uses the inflateWindow gnashrc
+    ///                 directive.
+    Inflater(std::unique_ptr<Codec> codec, std::streampos start,
+            size_t window = 0);
+
+    ~Inflater();
+
+    // See dox in IOChannel
+    virtual std::streamsize read(void* dst, std::streamsize bytes);
+
+    // See dox in IOChannel
+    virtual bool seek(std::streampos pos);
+
+    // See dox in IOChannel
+    virtual void go_to_end();
+
+    // See dox in IOChannel
+    virtual std::streampos tell() const {
+        return _pos;
+    }
+
+    // See dox in IOChannel
+    virtual bool eof() const {
+        return _done && _pos == windowEnd();
+    }
+
+    // See dox in IOChannel
+    virtual bool bad() const {
+        return _bad;
+    }
+
+    /// The number of bytes decompressed in one go.
+    static const size_t chunkSize = 64 * 1024;
+
+    /// The number of decompressed bytes between checkpoints.
+    static const size_t checkpointInterval = 1024 * 1024;
+
+private:
+
+    typedef std::vector<std::uint8_t> Chunk;
+
+    /// Decompress chunks until stopped or done.
+    void produce(std::streampos from);
+
+    void startThread(std::streampos from);
+
+    void stopThread();
+
+    /// Take the next chunk from the thread.
+    //
+    /// @return false at the end of the data.
+    bool nextChunk();
+
+    /// Restart from the nearest checkpoint before a position.
+    void restart(std::streampos pos);
+
+    std::streampos windowEnd() const {
+        return _windowStart + static_cast<std::streamoff>(_windowBytes);
+    }
+
+    std::unique_ptr<Codec> _codec;
+
+    const std::streampos _start;
+
+    const size_t _window;
+
+    // Shared with the thread.
+    std::mutex _mutex;
+    std::condition_variable _changed;
+    std::deque<Chunk> _ahead;
+    size_t _aheadBytes;
+    bool _stop;
+    bool _finished;
+    std::exception_ptr _error;
+
+    /// Codec states by the position they restart from.
+    std::map<std::streampos, std::unique_ptr<Checkpoint> > _checkpoints;
+
+    std::thread _thread;
+
+    // Used by the reader only.
+
+    /// The chunks read, all of chunkSize bytes but the last.
+    std::deque<Chunk> _chunks;
+    std::streampos _windowStart;
+    size_t _windowBytes;
+
+    std::streampos _pos;
+
+    /// Whether the window ends with the data.
+    bool _done;
+
+    bool _bad;
+};
+
+} // namespace gnash
+
+#endif
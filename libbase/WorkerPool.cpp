@@ -0,0 +1,77 @@
+// WorkerPool.cpp:  Threads running jobs in the background, for Gnash.
+//
+//   Copyright (C) 2005, 2006, 2007, 2008, 2009, 2010, 2011, 2012
+//   Free Software Foundation, Inc
+//
+// This program is free software; you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation; either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program; if not, write to the Free Software
+// Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+//
+
+#include "WorkerPool.h"
+
+#include <algorithm>
+
+namespace gnash {
+
+WorkerPool::WorkerPool(size_t threads)
+    :
+    _quit(false)
+{
+    if (!threads) {
+        threads = std::max(std::thread::hardware_concurrency(), 1u);
+    }
+    for (size_t i = 0; i < threads; ++i) {
+        _threads.emplace_back(&WorkerPool::work, this);
+    }
+}
+
+WorkerPool::~WorkerPool()
+{
+    {
+        std::lock_guard<std::mutex> lock(_mutex);
+        _quit = true;
+        _jobs.clear();
+    }
+    _wake.notify_all();
+    for (std::thread& t : _threads) t.join();
+}
+
+void
+WorkerPool::post(Job job)
+{
+    {
+        std::lock_guard<std::mutex> lock(_mutex);
+        _jobs.push_back(std::move(job));
+    }
+    _wake.notify_one();
+}
+
+void
+WorkerPool::work()
+{
+    std::unique_lock<std::mutex> lock(_mutex);
+    for (;;) {
+        _wake.wait(lock, [this] { return _quit || !_jobs.empty(); });
+        if (_quit) return;
+        Job job = std::move(_jobs.front());
+        _jobs.pop_front();
+        lock.unlock();
+        job();
+        // Drop anything the job holds before taking the lock again.
+        job = nullptr;
+        lock.lock();
+    }
+}
+
+} // namespace gnash
@@ -0,0 +1,89 @@
+// WorkerPool.h:  Threads running jobs in the background, for Gnash.
+//
+//   Copyright (C) 2005, 2006, 2007, 2008, 2009, 2010, 2011, 2012
+//   Free Software Foundation, Inc
+//
+// This program is free software; you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation; either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program; if not, write to the Free Software
+// Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+//
+
+#ifndef GNASH_WORKERPOOL_H
+#define GNASH_WORKERPOOL_H
+
+#include "dsodefs.h" // for DSOEXPORT
+
+#include <boost/noncopyable.hpp>
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <future>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace gnash {
+
+/// Threads running jobs in the order they are posted.
+//
+/// Jobs not started when the pool is destroyed are dropped, so anyone
+/// waiting on their futures gets a std::future_error.
+class DSOEXPORT WorkerPool : boost::noncopyable
+{
+public:
+
+    typedef std::function<void()> Job;
+
+    /// @param threads  The number of threads to start. 0 starts one
+    ///                 per processor.
+    explicit WorkerPool(size_t threads);
+
+    ~WorkerPool();
+
+    /// Queue a job to run on one of the threads.
+    void post(Job job);
+
+    /// Queue a function, returning a future for its result.
+    //
+    /// Exceptions thrown by the function are passed to the future.
+    template<typename F>
+    std::future<typename std::result_of<F()>::type> submit(F f) {
+        typedef typename std::result_of<F()>::type Result;
+        std::shared_ptr<std::packaged_task<Result()> > task =
+            std::make_shared<std::packaged_task<Result()> >(std::move(f));
+        std::future<Result> ret = task->get_future();
+        post([task] { (*task)(); });
+        return ret;
+    }
+
+    /// The number of threads.
+    size_t size() const { return _threads.size(); }
+
+private:
+
+    void work();
+
+    std::vector<std::thread> _threads;
+
+    std::mutex _mutex;
+    std::condition_variable _wake;
+
+    std::deque<Job> _jobs;
+
+    bool _quit;
+};
+
+} // namespace gnash
+
+#endif
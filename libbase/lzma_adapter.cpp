@@ -0,0 +1,199 @@
+// lzma_adapter.cpp:  Inflate LZMA compressed SWF data.
+//
+//   Copyright (C) 2005, 2006, 2007, 2008, 2009, 2010, 2011, 2012
+//   Free Software Foundation, Inc
+//
+// This program is free software; you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation; either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program; if not, write to the Free Software
+// Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+//
+
+#ifdef HAVE_CONFIG_H
+#include "gnashconfig.h"
+#endif
+
+#include "lzma_adapter.h"
+
+#include <cstdlib>
+#include <cstring>
+#include <sstream>
+
+#include "IOChannel.h"
+#include "Inflater.h"
+#include "log.h"
+#include "GnashException.h"
+
+#ifdef HAVE_LZMA_H
+#include <lzma.h>
+#endif
+
+namespace gnash {
+namespace lzma_adapter {
+
+#ifndef HAVE_LZMA_H
+
+std::unique_ptr<IOChannel>
+make_inflater(std::unique_ptr<IOChannel> /*in*/, std::uint32_t /*size*/)
+{
+    std::abort();
+}
+
+#else // HAVE_LZMA_H
+
+namespace {
+
+/// Decodes the LZMA data of a ZWS file as an .lzma file.
+//
+/// SWF files store the LZMA properties and the compressed data, and
+/// the uncompressed size in the SWF header. That makes the 13 byte
+/// header of the "alone" format liblzma reads.
+///
+/// liblzma can't copy the state of a decoder, so there are no
+/// checkpoints: going back restarts from the beginning.
+class LzmaCodec : public Inflater::Codec
+{
+public:
+
+    LzmaCodec(std::unique_ptr<IOChannel> in, std::uint32_t size);
+
+    ~LzmaCodec() {
+        lzma_end(&_stream);
+    }
+
+    virtual size_t decompress(std::uint8_t* dst, size_t size);
+
+    virtual std::unique_ptr<Inflater::Checkpoint> checkpoint() {
+        return std::unique_ptr<Inflater::Checkpoint>();
+    }
+
+    virtual void restart(const Inflater::Checkpoint* from);
+
+private:
+
+    static const size_t bufferSize = 64 * 1024;
+
+    static const size_t headerSize = 13;
+
+    std::unique_ptr<IOChannel> _in;
+
+    /// The position of the compressed data.
+    std::streampos _start;
+
+    std::uint8_t _buffer[bufferSize];
+
+    std::uint8_t _header[headerSize];
+
+    lzma_stream _stream;
+
+    bool _atEnd;
+};
+
+const size_t LzmaCodec::bufferSize;
+const size_t LzmaCodec::headerSize;
+
+LzmaCodec::LzmaCodec(std::unique_ptr<IOChannel> in, std::uint32_t size)
+    :
+    _in(std::move(in)),
+    _stream(),
+    _atEnd(false)
+{
+    // The compressed length, which isn't needed, then the properties.
+    std::uint8_t props[9];
+    if (_in->read(props, 9) != 9) {
+        throw ParserException(_("LZMA compressed SWF is too short"));
+    }
+    _start = _in->tell();
+
+    std::memcpy(_header, props + 4, 5);
+    for (size_t i = 0; i < 8; ++i) {
+        _header[5 + i] = i < 4 ? (size >> (8 * i)) & 0xff : 0;
+    }
+
+    restart(nullptr);
+}
+
+size_t
+LzmaCodec::decompress(std::uint8_t* dst, size_t size)
+{
+    if (_atEnd) return 0;
+
+    _stream.next_out = dst;
+    _stream.avail_out = size;
+
+    while (_stream.avail_out) {
+        if (!_stream.avail_in) {
+            const std::streamsize got = _in->read(_buffer, bufferSize);
+            if (got <= 0) {
+                log_error(_("LZMA compressed SWF data end early"));
+                _atEnd = true;
+                break;
+            }
+            _stream.next_in = _buffer;
+            _stream.avail_in = got;
+        }
+
+        const lzma_ret ret = lzma_code(&_stream, LZMA_RUN);
+        if (ret == LZMA_STREAM_END) {
+            _atEnd = true;
+            break;
+        }
+        if (ret != LZMA_OK) {
+            std::ostringstream ss;
+            ss << __FILE__ << ": lzma_code() returned " << ret;
+            throw ParserException(ss.str());
+        }
+    }
+
+    return size - _stream.avail_out;
+}
+
+void
+LzmaCodec::restart(const Inflater::Checkpoint* /*from*/)
+{
+    lzma_end(&_stream);
+    _stream = lzma_stream();
+    const lzma_ret ret = lzma_alone_decoder(&_stream, UINT64_MAX);
+    if (ret != LZMA_OK) {
+        std::ostringstream ss;
+        ss << __FILE__ << ": lzma_alone_decoder() returned " << ret;
+        throw ParserException(ss.str());
+    }
+    _atEnd = false;
+
+    if (!_in->seek(_start)) {
+        std::ostringstream ss;
+        ss << "LZMA inflater: unable to seek underlying stream to "
+            "position " << _start;
+        throw ParserException(ss.str());
+    }
+
+    // The header goes first.
+    _stream.next_in = _header;
+    _stream.avail_in = headerSize;
+}
+
+} // anonymous namespace
+
+std::unique_ptr<IOChannel>
+make_inflater(std::unique_ptr<IOChannel> in, std::uint32_t size)
+{
+    assert(in.get());
+    const std::streampos start = in->tell();
+    std::unique_ptr<Inflater::Codec> codec(new LzmaCodec(std::move(in), size));
+    return std::unique_ptr<IOChannel>(new Inflater(std::move(codec), start));
+}
+
+#endif // HAVE_LZMA_H
+
+} // namespace lzma_adapter
+} // namespace gnash
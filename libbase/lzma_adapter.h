@@ -0,0 +1,50 @@
+// lzma_adapter.h:  Inflate LZMA compressed SWF data.
+//
+//   Copyright (C) 2005, 2006, 2007, 2008, 2009, 2010, 2011, 2012
+//   Free Software Foundation, Inc
+//
+// This program is free software; you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation; either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program; if not, write to the Free Software
+// Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+//
+
+#ifndef GNASH_LZMA_ADAPTER_H
+#define GNASH_LZMA_ADAPTER_H
+
+#include "dsodefs.h"
+
+#include <cstdint>
+#include <memory>
+
+namespace gnash {
+
+class IOChannel;
+
+/// Code to wrap LZMA decompression around an IOChannel stream.
+namespace lzma_adapter
+{
+    // NOTE: make_inflater aborts if HAVE_LZMA_H is not defined
+
+    /// Returns a read-only IOChannel inflating the LZMA data of a "ZWS"
+    /// SWF file.
+    //
+    /// @param in       Positioned after the 8 bytes of SWF header, at the
+    ///                 compressed length and LZMA properties.
+    /// @param size     The number of bytes the data inflate to.
+    DSOEXPORT std::unique_ptr<IOChannel>
+        make_inflater(std::unique_ptr<IOChannel> in, std::uint32_t size);
+
+} // namespace gnash.lzma_adapter
+} // namespace gnash
+
+#endif
@@ -121,7 +121,14 @@ RcInitFile::RcInitFile()
     _ignoreShowMenu(true),
     _scriptsTimeout(15),
     _scriptsRecursionLimit(256),
-    _lockScriptLimits(false)
+    _lockScriptLimits(false),
+    _preDecodeActions(true),
+    _renderThreads(1),
+    _decodeThreads(0),
+    _bitmapCacheSize(131072),
+    _inflateWindow(1024),
+    _pathCacheSize(4096),
+    _resampleQuality(1)
 {
     expandPath(_solsandbox);
     loadFiles();
@@ -620,6 +627,27 @@ RcInitFile::parseFile(const std::string& filespec)
 			||
                  extractSetting(_lockScriptLimits, "lockScriptLimits", variable,
                            value)
+			||
+                 extractSetting(_preDecodeActions, "preDecodeActions",
+                           variable, value)
+			||
+                 extractNumber(_renderThreads, "renderThreads", variable,
+                           value)
+			||
+                 extractNumber(_decodeThreads, "decodeThreads", variable,
+                           value)
+			||
+                 extractNumber(_bitmapCacheSize, "bitmapCacheSize", variable,
+                           value)
+			||
+                 extractNumber(_inflateWindow, "inflateWindow", variable,
+                           value)
+			||
+                 extractNumber(_pathCacheSize, "pathCacheSize", variable,
+                           value)
+			||
+                 extractNumber(_resampleQuality, "resampleQuality", variable,
+                           value)
             ||
                  cerr << boost::format(_("Warning: unrecognized directive "
                              "\"%s\" in rcfile %s line %d")) 
@@ -785,6 +813,13 @@ RcInitFile::updateFile(const std::string& filespec)
     cmd << "scriptsTimeout " << _scriptsTimeout << endl <<
     cmd << "scriptsRecursionLimit " << _scriptsRecursionLimit << endl <<
     cmd << "lockScriptLimits " << _lockScriptLimits << endl <<
+    cmd << "preDecodeActions " << _preDecodeActions << endl <<
+    cmd << "renderThreads " << _renderThreads << endl <<
+    cmd << "decodeThreads " << _decodeThreads << endl <<
+    cmd << "bitmapCacheSize " << _bitmapCacheSize << endl <<
+    cmd << "inflateWindow " << _inflateWindow << endl <<
+    cmd << "pathCacheSize " << _pathCacheSize << endl <<
+    cmd << "resampleQuality " << _resampleQuality << endl <<
    
     // Strings.
 
@@ -358,6 +358,34 @@ public:
 
     bool lockScriptLimits() const { return _lockScriptLimits; }
 
+    void preDecodeActions(bool x) { _preDecodeActions = x; }
+
+    bool preDecodeActions() const { return _preDecodeActions; }
+
+    void renderThreads(int x) { _renderThreads = x; }
+
+    int renderThreads() const { return _renderThreads; }
+
+    void decodeThreads(int x) { _decodeThreads = x; }
+
+    int decodeThreads() const { return _decodeThreads; }
+
+    void bitmapCacheSize(int x) { _bitmapCacheSize = x; }
+
+    int bitmapCacheSize() const { return _bitmapCacheSize; }
+
+    void inflateWindow(int x) { _inflateWindow = x; }
+
+    int inflateWindow() const { return _inflateWindow; }
+
+    void pathCacheSize(int x) { _pathCacheSize = x; }
+
+    int pathCacheSize() const { return _pathCacheSize; }
+
+    void resampleQuality(int x) { _resampleQuality = x; }
+
+    int resampleQuality() const { return _resampleQuality; }
+
     void dump();    
 
 protected:
@@ -624,6 +652,34 @@ protected:
 
     /// Whether to ignore SWF ScriptLimits tags 
     bool _lockScriptLimits;
+
+    /// Whether to execute ActionScript from a table of actions decoded
+    /// once per action block, rather than from the raw bytes.
+    bool _preDecodeActions;
+
+    /// The number of threads drawing a frame in the AGG renderer.
+    /// 0 means one per processor.
+    int _renderThreads;
+
+    /// The number of threads decoding bitmaps while movies load.
+    /// 0 means one per processor, and a negative number none, so that
+    /// bitmaps are decoded when first used.
+    int _decodeThreads;
+
+    /// The memory in kilobytes decoded bitmaps may take before the
+    /// least recently used are dropped. 0 means no limit.
+    int _bitmapCacheSize;
+
+    /// The kilobytes of compressed movies decompressed ahead of the
+    /// parser, and kept after it for seeking back.
+    int _inflateWindow;
+
+    /// The memory in kilobytes the AGG renderer may use to keep
+    /// transformed shape paths. 0 disables caching.
+    int _pathCacheSize;
+
+    /// The quality of sound resampling, from 0 (fastest) to 2 (best).
+    int _resampleQuality;
 };
 
 // End of gnash namespace 
@@ -22,6 +22,7 @@
 #include "gnashconfig.h" // GNASH_STATS_STRING_TABLE_NOCASE
 #endif
 
+#include <functional>
 #include <boost/algorithm/string/case_conv.hpp>
 
 //#define DEBUG_STRING_TABLE 1
@@ -36,30 +37,153 @@ namespace gnash {
 
 const std::string string_table::_empty;
 
+namespace {
+
+inline std::size_t
+hashString(const std::string& s)
+{
+    return std::hash<std::string>()(s);
+}
+
+}
+
+string_table::Directory::Directory(std::size_t n)
+    :
+    size(n),
+    chunks(new std::atomic<Entry*>[n])
+{
+    for (std::size_t i = 0; i < n; ++i) chunks[i].store(nullptr);
+}
+
+string_table::Index::Index(std::size_t n)
+    :
+    mask(n - 1),
+    slots(new std::atomic<key>[n])
+{
+    for (std::size_t i = 0; i < n; ++i) slots[i].store(0);
+}
+
+string_table::string_table()
+    :
+    _directory(nullptr),
+    _index(nullptr),
+    _size(0),
+    _highestKey(0),
+    _highestKnownLowercase(0)
+{
+    _directories.emplace_back(new Directory(64));
+    _directory.store(_directories.back().get());
+    _indexes.emplace_back(new Index(1024));
+    _index.store(_indexes.back().get());
+}
+
+string_table::~string_table()
+{
+}
+
 string_table::key
 string_table::find(const std::string& t_f, bool insert_unfound)
 {
     if (t_f.empty()) return 0;
 
-	table::index<StringValue>::type::iterator i = 
-        _table.get<StringValue>().find(t_f);
+    const std::size_t h = hashString(t_f);
+    const key k = lookup(t_f, h);
+    if (k || !insert_unfound) return k;
 
-	if (i == _table.get<StringValue>().end()) {
+    std::lock_guard<std::mutex> lock(_lock);
+    return already_locked_insert(t_f);
+}
 
-		if (insert_unfound) {
-			// First we lock.
-			std::lock_guard<std::mutex> lock(_lock);
-			// Then we see if someone else managed to sneak past us.
-			i = _table.get<StringValue>().find(t_f);
-			// If they did, use that value.
-			if (i != _table.end()) return i->id;
+string_table::key
+string_table::lookup(const std::string& s, std::size_t hash) const
+{
+    // The index is never more than half full, so this always finds
+    // an empty slot eventually.
+    const Index* idx = _index.load(std::memory_order_acquire);
+    for (std::size_t i = hash & idx->mask; ; i = (i + 1) & idx->mask) {
+        const key k = idx->slots[i].load(std::memory_order_acquire);
+        if (!k) return 0;
+        const Entry* e = entry(k);
+        if (e->hash == hash && e->value == s) return k;
+    }
+}
 
-            return already_locked_insert(t_f);
-		}
-        return 0;
-	}
+string_table::Entry*
+string_table::add(key k, const std::string& s, std::size_t hash, key nocase)
+{
+    // Make room for the entry.
+    Directory* dir = _directory.load(std::memory_order_relaxed);
+    const std::size_t c = k >> chunkBits;
+    if (c >= dir->size) {
+        std::size_t n = dir->size;
+        while (n <= c) n *= 2;
+        _directories.emplace_back(new Directory(n));
+        Directory* grown = _directories.back().get();
+        for (std::size_t i = 0; i < dir->size; ++i) {
+            grown->chunks[i].store(dir->chunks[i].load(
+                        std::memory_order_relaxed), std::memory_order_relaxed);
+        }
+        _directory.store(grown, std::memory_order_release);
+        dir = grown;
+    }
 
-	return i->id;
+    Entry* chunk = dir->chunks[c].load(std::memory_order_relaxed);
+    if (!chunk) {
+        _chunks.emplace_back(new Entry[chunkSize]);
+        chunk = _chunks.back().get();
+        dir->chunks[c].store(chunk, std::memory_order_release);
+    }
+
+    Entry& e = chunk[k & (chunkSize - 1)];
+    if (e.used) return nullptr;
+    e.value = s;
+    e.hash = hash;
+    e.nocase = nocase;
+    e.used = true;
+
+    // Keep the index at most half full.
+    Index* idx = _index.load(std::memory_order_relaxed);
+    if ((_size + 1) * 2 > idx->mask + 1) {
+        _indexes.emplace_back(new Index((idx->mask + 1) * 2));
+        Index* grown = _indexes.back().get();
+        for (std::size_t i = 0; i <= idx->mask; ++i) {
+            const key old = idx->slots[i].load(std::memory_order_relaxed);
+            if (!old) continue;
+            std::size_t j = entry(old)->hash & grown->mask;
+            while (grown->slots[j].load(std::memory_order_relaxed)) {
+                j = (j + 1) & grown->mask;
+            }
+            grown->slots[j].store(old, std::memory_order_relaxed);
+        }
+        _index.store(grown, std::memory_order_release);
+        idx = grown;
+    }
+
+    // Publishing the key makes the entry visible to lookups.
+    std::size_t i = hash & idx->mask;
+    while (idx->slots[i].load(std::memory_order_relaxed)) {
+        i = (i + 1) & idx->mask;
+    }
+    idx->slots[i].store(k, std::memory_order_release);
+    ++_size;
+
+    return &e;
+}
+
+string_table::key
+string_table::addNoCase(const std::string& s)
+{
+    const std::string lower = boost::to_lower_copy(s);
+    if (lower == s) return 0;
+
+    // Find the caseless value in the table.
+    const std::size_t h = hashString(lower);
+    key nocase = lookup(lower, h);
+    if (!nocase) {
+        nocase = ++_highestKey;
+        add(nocase, lower, h, 0);
+    }
+    return nocase;
 }
 
 string_table::key
@@ -73,63 +197,51 @@ void
 string_table::insert_group(const svt* l, std::size_t size)
 {
     std::lock_guard<std::mutex> lock(_lock);
+
+    std::vector<Entry*> added;
     for (std::size_t i = 0; i < size; ++i) {
-        // Copy to avoid changing the original table.
-        const svt s = l[i];
+        const svt& s = l[i];
+
+        const std::size_t h = hashString(s.value);
+        if (lookup(s.value, h)) continue;
 
         // The keys don't have to be consecutive, so any time we find a key
         // that is too big, jump a few keys to avoid rewriting this on every
         // item.
-       if (s.id > _highestKey) _highestKey = s.id + 256;
-       _table.insert(s);
+        if (s.id > _highestKey) _highestKey = s.id + 256;
+        if (Entry* e = add(s.id, s.value, h, 0)) added.push_back(e);
     }
     
-    for (std::size_t i = 0; i < size; ++i) {
-        const svt s = l[i];
-        const std::string& t = boost::to_lower_copy(s.value);
-        if (t != s.value) {
-            _caseTable[s.id] = already_locked_insert(t);
-        }
+    // The caseless equivalents may be in the group, so look for them
+    // only once it's all in.
+    for (Entry* e : added) {
+        e->nocase = addNoCase(e->value);
     }
 #ifdef DEBUG_STRING_TABLE
-    std::cerr << "string_table group insert end -- size is " << _table.size() << " _caseTable size is " << _caseTable.size() << std::endl; 
+    std::cerr << "string_table group insert end -- size is " << _size << std::endl; 
 #endif
 
-
 }
 
 string_table::key
 string_table::already_locked_insert(const std::string& to_insert)
 {
-	const key ret = _table.insert(svt(to_insert, ++_highestKey)).first->id;
+    const std::size_t h = hashString(to_insert);
 
-#ifdef DEBUG_STRING_TABLE
-    int tscp = 100; // table size checkpoint
-    size_t ts = _table.size();
-    if ( ! (ts % tscp) ) { std::cerr << "string_table size grew to " << ts << std::endl; }
-#endif
+    // Someone else may have sneaked past us.
+    key ret = lookup(to_insert, h);
+    if (ret) return ret;
 
-    const std::string lower = boost::to_lower_copy(to_insert);
+    ret = ++_highestKey;
 
     // Insert the caseless equivalent if it's not there. We're locked for
     // the whole of this function, so we can do what we like.
-    if (lower != to_insert) {
-
-        // Find the caseless value in the table
-        table::index<StringValue>::type::iterator it = 
-            _table.get<StringValue>().find(lower);
-
-        const key nocase = (it == _table.end()) ? 
-            _table.insert(svt(lower, ++_highestKey)).first->id : it->id;
+    add(ret, to_insert, h, addNoCase(to_insert));
 
 #ifdef DEBUG_STRING_TABLE
-        ++ts;
-        if ( ! (ts % tscp) ) { std::cerr << "string_table size grew to " << ts << std::endl; }
-#endif // DEBUG_STRING_TABLE
-
-        _caseTable[ret] = nocase;
-
-    }
+    int tscp = 100; // table size checkpoint
+    if ( ! (_size % tscp) ) { std::cerr << "string_table size grew to " << _size << std::endl; }
+#endif
 
     return ret;
 }
@@ -150,7 +262,7 @@ string_table::noCase(key a) const
     // Avoid checking keys known to be lowercase
     if ( a <= _highestKnownLowercase ) {
 #if GNASH_PARANOIA_LEVEL > 2
-        assert(_caseTable.find(a) == _caseTable.end());
+        assert(!entry(a) || !entry(a)->nocase);
 #endif
         return a;
     }
@@ -160,12 +272,8 @@ string_table::noCase(key a) const
     kcl.check(a);
 #endif 
 
-    // TODO: an even/odd based rule to tell what's lowercase already
-    //       would speed things up even for unknown 
-    //       strings.
-
-    std::map<key, key>::const_iterator i = _caseTable.find(a);
-    if ( i != _caseTable.end() ) return i->second;
+    const Entry* e = entry(a);
+    if (e && e->nocase) return e->nocase;
 
     return a;
 }
@@ -20,17 +20,15 @@
 #ifndef GNASH_STRING_TABLE_H
 #define GNASH_STRING_TABLE_H
 
-// Thread Status: SAFE, except for group functions.
-// The group functions may have strange behavior when trying to automatically
-// lowercase the additions.
-
-#include <boost/multi_index_container.hpp>
-#include <boost/multi_index/hashed_index.hpp>
-#include <boost/multi_index/identity.hpp>
-#include <boost/multi_index/member.hpp>
+// Thread Status: SAFE. Lookups don't lock, insertions are serialized.
+// insert_group() must be called before the table is shared.
+
 #include <string>
-#include <map>
+#include <vector>
+#include <memory>
+#include <atomic>
 #include <mutex>
+#include <boost/noncopyable.hpp>
 #include "dsodefs.h"
 
 namespace gnash {
@@ -38,7 +36,16 @@ namespace gnash {
 // So many strings are duplicated (such as standard property names)
 // that a string table could give significant memory savings.
 /// A general use string table.
-class DSOEXPORT string_table
+//
+/// The strings are kept in an arena of fixed-size chunks indexed by key,
+/// so entries never move and value() needs neither a lock nor a search.
+/// Strings are found through an open-addressing hash index of keys,
+/// using the hash stored with each entry. Readers never lock: an insertion
+/// fills in its entry before publishing its key in the index, and a grown
+/// index replaces the old one atomically. Retired chunk directories and
+/// indexes are kept until the table is destroyed, so a reader can safely
+/// finish a lookup in them.
+class DSOEXPORT string_table : boost::noncopyable
 {
 public:
 
@@ -54,31 +61,6 @@ public:
 		std::string value;
 		std::size_t id;
 	};
-    
-    /// A tag to identify the key index.   
-    struct StringID {};
-
-    /// A tag to identify the string index.
-    struct StringValue {};
-
-    /// The container for indexing the strings
-    //
-    /// This contains two indices with no duplicate values:
-    /// 1. An index of unique, case-sensitive strings.
-    /// 2. An index of unique numeric keys.
-	typedef boost::multi_index_container<svt,
-		boost::multi_index::indexed_by<
-
-			boost::multi_index::hashed_unique<
-                boost::multi_index::tag<StringValue>,
-				boost::multi_index::member<svt, std::string, &svt::value> >,
-
-			boost::multi_index::hashed_unique<
-                boost::multi_index::tag<StringID>,
-				boost::multi_index::member<svt, std::size_t, &svt::id>
-
-        > 
-	> > table;
 
 	typedef std::size_t key;
 
@@ -101,11 +83,8 @@ public:
     ///             given.
 	const std::string& value(key to_find) const
 	{
-		if (_table.empty() || !to_find) return _empty;
-
-		table::index<StringID>::type::iterator r =
-            _table.get<StringID>().find(to_find);
-		return (r == _table.get<StringID>().end()) ? _empty : r->value;
+        const Entry* e = entry(to_find);
+        return e ? e->value : _empty;
 	}
 
 	/// Insert a string with auto-assigned id. 
@@ -116,8 +95,8 @@ public:
 	/// Insert a group of strings with their ids preset.
     //
 	/// @param pList    An array of svt objects, these should be fully
-    ///                 constructed, including their ids. If any id is
-    ///                 duplicated, the insertion will fail.
+    ///                 constructed, including their ids. Strings or ids
+    ///                 already in the table are skipped.
 	/// @param size      Number of elements in the svt objects array
 	void insert_group(const svt* pList, std::size_t size);
 
@@ -128,11 +107,9 @@ public:
 	key already_locked_insert(const std::string& to_insert);
 
 	/// Construct the empty string_table
-	string_table()
-        :
-		_highestKey(0),
-		_highestKnownLowercase(0)
-	{}
+	string_table();
+
+    ~string_table();
 
     /// Return a caseless equivalent of the passed key.
     //
@@ -147,12 +124,86 @@ public:
 
 private:
 
-	table _table;
+    /// A string in the table.
+    struct Entry
+    {
+        Entry() : hash(0), nocase(0), used(false) {}
+
+        std::string value;
+
+        /// The hash of value.
+        std::size_t hash;
+
+        /// The key of the lowercase equivalent, or 0 if value is lowercase.
+        key nocase;
+
+        bool used;
+    };
+
+    /// The number of bits of a key giving the position in its chunk.
+    static const std::size_t chunkBits = 8;
+
+    static const std::size_t chunkSize = 1 << chunkBits;
+
+    /// The chunks of entries, indexed by key >> chunkBits.
+    struct Directory
+    {
+        explicit Directory(std::size_t n);
+        const std::size_t size;
+        std::unique_ptr<std::atomic<Entry*>[]> chunks;
+    };
+
+    /// An open-addressing index of keys, by hash.
+    struct Index
+    {
+        explicit Index(std::size_t n);
+        const std::size_t mask;
+        std::unique_ptr<std::atomic<key>[]> slots;
+    };
+
+    /// Return the entry for a key, or 0 if there is none.
+    const Entry* entry(key k) const {
+        const Directory* dir = _directory.load(std::memory_order_acquire);
+        const std::size_t c = k >> chunkBits;
+        if (c >= dir->size) return nullptr;
+        const Entry* chunk = dir->chunks[c].load(std::memory_order_acquire);
+        if (!chunk) return nullptr;
+        const Entry& e = chunk[k & (chunkSize - 1)];
+        return e.used ? &e : nullptr;
+    }
+
+    /// Find a string without locking.
+    key lookup(const std::string& s, std::size_t hash) const;
+
+    /// Add a string with the given key. The lock must be held.
+    //
+    /// @return     The new entry, or 0 if the key is already used.
+    Entry* add(key k, const std::string& s, std::size_t hash, key nocase);
+
+    /// Find or add the lowercase equivalent of a string.
+    //
+    /// @return     The key of the lowercase string, or 0 if s is lowercase.
+    key addNoCase(const std::string& s);
+
 	static const std::string _empty;
+
+    std::atomic<Directory*> _directory;
+
+    std::atomic<Index*> _index;
+
+    /// All directories and indexes ever used, for destruction.
+    std::vector<std::unique_ptr<Directory>> _directories;
+    std::vector<std::unique_ptr<Index>> _indexes;
+
+    /// All chunks of entries, for destruction.
+    std::vector<std::unique_ptr<Entry[]>> _chunks;
+
+    /// The number of keys in the index.
+    std::size_t _size;
+
 	std::mutex _lock;
 	std::size_t _highestKey;
 
-    std::map<key, key> _caseTable;
     key _highestKnownLowercase;
 };
 
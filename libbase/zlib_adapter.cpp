@@ -13,7 +13,8 @@
 #include <sstream>
 #include <memory>
 
-#include "IOChannel.h" // for inheritance
+#include "IOChannel.h"
+#include "Inflater.h"
 #include "log.h"
 #include "GnashException.h"
 
@@ -38,282 +39,165 @@ extern "C" {
 
 namespace zlib_adapter {
 
-class InflaterIOChannel : public IOChannel 
-{
-public:
+namespace {
 
-    /// Constructor.
-    InflaterIOChannel(std::unique_ptr<IOChannel> in);
+struct ZlibCheckpoint : public Inflater::Checkpoint
+{
+    ZlibCheckpoint() : stream(), input(0) {}
 
-    ~InflaterIOChannel() {
-        rewind_unused_bytes();
-        inflateEnd(&(m_zstream));
+    ~ZlibCheckpoint() {
+        inflateEnd(&stream);
     }
 
-    // See dox in IOChannel
-    virtual bool seek(std::streampos pos);
+    z_stream stream;
 
-    // See dox in IOChannel
-    virtual std::streamsize read(void* dst, std::streamsize bytes) {
-        if (m_error) return 0;
-        return inflate_from_stream(dst, bytes);
-    }
+    // Position of the next compressed byte to feed to the stream.
+    std::streampos input;
+};
 
-    // See dox in IOChannel
-    virtual void go_to_end();
+class ZlibCodec : public Inflater::Codec
+{
+public:
 
-    // See dox in IOChannel
-    virtual std::streampos tell() const {
-        return m_logical_stream_pos;
-    }
+    ZlibCodec(std::unique_ptr<IOChannel> in);
 
-    // See dox in IOChannel
-    virtual bool eof() const {
-        return m_at_eof;
+    ~ZlibCodec() {
+        inflateEnd(&_zstream);
     }
 
-    // See dox in IOChannel
-    virtual bool bad() const {
-        return m_error;
-    }
+    virtual size_t decompress(std::uint8_t* dst, size_t size);
+
+    virtual std::unique_ptr<Inflater::Checkpoint> checkpoint();
+
+    virtual void restart(const Inflater::Checkpoint* from);
 
 private:
 
-    static const int ZBUF_SIZE = 4096;
+    static const size_t ZBUF_SIZE = 64 * 1024;
+
+    void fail(const char* what) const {
+        std::ostringstream ss;
+        ss << __FILE__ << ": " << what << ": " <<
+            (_zstream.msg ? _zstream.msg : "unknown error");
+        throw ParserException(ss.str());
+    }
 
-    std::unique_ptr<IOChannel> m_in;
+    std::unique_ptr<IOChannel> _in;
 
     // position of the input stream where we started inflating.
-    std::streampos m_initial_stream_pos;
-    
-    unsigned char m_rawdata[ZBUF_SIZE];
-    
-    z_stream m_zstream;
-
-    // current stream position of uncompressed data.
-    std::streampos m_logical_stream_pos;
-
-    bool m_at_eof;
-    bool m_error;
-
-    /// Discard current results and rewind to the beginning.
-    //
-    //
-    /// Necessary in order to seek backwards.
-    ///
-    /// might throw a ParserException if unable to reset the uderlying
-    /// stream to original position.
-    ///
-    void reset();
-
-    std::streamsize inflate_from_stream(void* dst, std::streamsize bytes);
-
-    // If we have unused bytes in our input buffer, rewind
-    // to before they started.
-    void rewind_unused_bytes();
+    const std::streampos _start;
 
-};
+    unsigned char _rawdata[ZBUF_SIZE];
 
-const int InflaterIOChannel::ZBUF_SIZE;
+    z_stream _zstream;
 
-void
-InflaterIOChannel::rewind_unused_bytes()
-{
-    if (m_zstream.avail_in > 0) {
-        const int pos = m_in->tell();
-        const int rewound_pos = pos - m_zstream.avail_in;
-        assert(pos >= 0);
-        assert(pos >= m_initial_stream_pos);
-        assert(rewound_pos >= 0);
-        assert(rewound_pos >= m_initial_stream_pos);
-
-        m_in->seek(rewound_pos);
-    }
-}
+    bool _ready;
+    bool _atEnd;
+};
 
-void
-InflaterIOChannel::reset()
+const size_t ZlibCodec::ZBUF_SIZE;
+
+ZlibCodec::ZlibCodec(std::unique_ptr<IOChannel> in)
+    :
+    _in(std::move(in)),
+    _start(_in->tell()),
+    _zstream(),
+    _ready(false),
+    _atEnd(false)
 {
-    m_error = 0;
-    m_at_eof = 0;
-    const int err = inflateReset(&m_zstream);
+    const int err = inflateInit(&_zstream);
     if (err != Z_OK) {
-	    log_error("inflater_impl::reset() inflateReset() returned %d",
-		      err);
-        m_error = 1;
+        log_error("inflateInit() returned %d", err);
         return;
     }
-
-    m_zstream.next_in = nullptr;
-    m_zstream.avail_in = 0;
-
-    m_zstream.next_out = nullptr;
-    m_zstream.avail_out = 0;
-
-    // Rewind the underlying stream.
-    if (!m_in->seek(m_initial_stream_pos))
-    {
-        std::stringstream ss;
-        ss << "inflater_impl::reset: unable to seek underlying "
-            "stream to position " <<  m_initial_stream_pos;
-        throw ParserException(ss.str());
-    }
-
-    m_logical_stream_pos = m_initial_stream_pos;
+    _ready = true;
 }
 
-std::streamsize
-InflaterIOChannel::inflate_from_stream(void* dst, std::streamsize bytes)
+size_t
+ZlibCodec::decompress(std::uint8_t* dst, size_t size)
 {
+    if (!_ready) fail("inflater not initialized");
+    if (_atEnd) return 0;
 
-    assert(bytes);
+    _zstream.next_out = dst;
+    _zstream.avail_out = size;
 
-    if (m_error) return 0;
-
-    m_zstream.next_out = static_cast<unsigned char*>(dst);
-    m_zstream.avail_out = bytes;
-
-    for (;;) {
-        if (m_zstream.avail_in == 0) {
+    while (_zstream.avail_out) {
+        if (_zstream.avail_in == 0) {
             // Get more raw data.
-            const int new_bytes = m_in->read(m_rawdata, ZBUF_SIZE);
-            if (new_bytes == 0) {
+            const std::streamsize got = _in->read(_rawdata, ZBUF_SIZE);
+            if (got <= 0) {
                 // The cupboard is bare!  We have nothing to feed to inflate().
                 break;
             }
-            else {
-                m_zstream.next_in = m_rawdata;
-                m_zstream.avail_in = new_bytes;
-            }
+            _zstream.next_in = _rawdata;
+            _zstream.avail_in = got;
         }
 
-        const int err = inflate(&m_zstream, Z_SYNC_FLUSH);
+        const int err = inflate(&_zstream, Z_SYNC_FLUSH);
         if (err == Z_STREAM_END) {
-            m_at_eof = true;
+            _atEnd = true;
             break;
         }
         if (err == Z_BUF_ERROR) {
-            std::ostringstream ss;
-            ss << __FILE__ << ":" << __LINE__ << ": " << m_zstream.msg;
-            log_error("%s", ss.str());
-            break;
-        }
-        if (err == Z_DATA_ERROR) {
-            std::ostringstream ss;
-            ss << __FILE__ << ":" << __LINE__ << ": " << m_zstream.msg;
-            throw ParserException(ss.str());
-            break;
-        }
-        if (err == Z_MEM_ERROR) {
-            std::ostringstream ss;
-            ss << __FILE__ << ":" << __LINE__ << ": " << m_zstream.msg;
-            throw ParserException(ss.str());
-            break;
-        }
-        if (err != Z_OK) {
-            // something's wrong.
-            std::ostringstream ss;
-            ss << __FILE__ << ":" << __LINE__ << ": " << m_zstream.msg;
-            throw ParserException(ss.str());
-            break;
-        }
-
-        if (m_zstream.avail_out == 0) {
+            log_error("%s: %s", __FILE__, _zstream.msg ? _zstream.msg : "");
             break;
         }
+        if (err != Z_OK) fail("inflate");
     }
 
-    if (m_error) return 0;
-
-    const int bytes_read = bytes - m_zstream.avail_out;
-    m_logical_stream_pos += bytes_read;
-
-    return bytes_read;
+    return size - _zstream.avail_out;
 }
 
-void
-InflaterIOChannel::go_to_end()
+std::unique_ptr<Inflater::Checkpoint>
+ZlibCodec::checkpoint()
 {
-    if (m_error) {
-        throw IOException("InflaterIOChannel is in error condition, "
-                "can't seek to end");
-    }
-
-    // Keep reading until we can't read any more.
-
-    unsigned char temp[ZBUF_SIZE];
-
-    // Seek forwards.
-    for (;;) {
-        const std::streamsize bytes_read = inflate_from_stream(temp, ZBUF_SIZE);
-        if (!bytes_read) {
-            // We've seeked as far as we can.
-            break;
-        }
+    std::unique_ptr<ZlibCheckpoint> cp(new ZlibCheckpoint);
+    if (inflateCopy(&cp->stream, &_zstream) != Z_OK) {
+        return std::unique_ptr<Inflater::Checkpoint>();
     }
+    cp->input = _in->tell() - static_cast<std::streamoff>(_zstream.avail_in);
+    return cp;
 }
 
-bool
-InflaterIOChannel::seek(std::streampos pos)
+void
+ZlibCodec::restart(const Inflater::Checkpoint* from)
 {
-    if (m_error) {
-	    log_error("Inflater is in error condition");
-        return false;
-    }
-
-    // If we're seeking backwards, then restart from the beginning.
-    if (pos < m_logical_stream_pos) {
-	    log_debug("inflater reset due to seek back from %d to %d",
-		      m_logical_stream_pos, pos );
-        reset();
+    std::streampos input = _start;
+    int err;
+    if (from) {
+        const ZlibCheckpoint& cp = static_cast<const ZlibCheckpoint&>(*from);
+        inflateEnd(&_zstream);
+        _zstream = z_stream();
+        err = inflateCopy(&_zstream, const_cast<z_stream*>(&cp.stream));
+        input = cp.input;
     }
+    else err = inflateReset(&_zstream);
 
-    unsigned char temp[ZBUF_SIZE];
+    _ready = err == Z_OK;
+    if (!_ready) fail("inflater restart");
+    _atEnd = false;
 
-    // Now seek forwards, by just reading data in blocks.
-    while (m_logical_stream_pos < pos) {
-        std::streamsize to_read = pos - m_logical_stream_pos;
-        assert(to_read > 0);
+    _zstream.next_in = nullptr;
+    _zstream.avail_in = 0;
 
-        std::streamsize readNow = std::min<std::streamsize>(to_read, ZBUF_SIZE);
-        assert(readNow > 0);
-
-        std::streamsize bytes_read = inflate_from_stream(temp, readNow);
-        assert(bytes_read <= readNow);
-        if (bytes_read == 0) {
-		log_error("Trouble: can't seek any further.. ");
-            return false;
-        }
+    // Rewind the underlying stream.
+    if (!_in->seek(input)) {
+        std::stringstream ss;
+        ss << "inflater restart: unable to seek underlying "
+            "stream to position " << input;
+        throw ParserException(ss.str());
     }
-
-    assert(m_logical_stream_pos == pos);
-
-    return true; 
 }
 
-InflaterIOChannel::InflaterIOChannel(std::unique_ptr<IOChannel> in)
-    :
-    m_in(std::move(in)),
-    m_initial_stream_pos(m_in->tell()),
-    m_zstream(),
-    m_logical_stream_pos(m_initial_stream_pos),
-    m_at_eof(false),
-    m_error(0)
-{
-    assert(m_in.get());
-
-    const int err = inflateInit(&m_zstream);
-    if (err != Z_OK) {
-	    log_error("inflateInit() returned %d", err);
-        m_error = 1;
-        return;
-    }
-}
+} // anonymous namespace
 
 std::unique_ptr<IOChannel> make_inflater(std::unique_ptr<IOChannel> in)
 {
     assert(in.get());
-    return std::unique_ptr<IOChannel>(new InflaterIOChannel(std::move(in)));
+    const std::streampos start = in->tell();
+    std::unique_ptr<Inflater::Codec> codec(new ZlibCodec(std::move(in)));
+    return std::unique_ptr<IOChannel>(new Inflater(std::move(codec), start));
 }
 
 }
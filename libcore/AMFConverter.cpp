@@ -114,7 +114,7 @@ private:
 bool
 Writer::writePropertyName(const std::string& name)
 {
-    writePlainString(_buf, name, STRING_AMF0);
+    _encoder.writeKey(name);
     return true;
 }
 
@@ -135,16 +135,11 @@ Writer::writeObject(as_object* obj)
         log_debug("amf: serializing object (or function) "
                     "as reference to %d", idx);
 #endif
-        _buf.appendByte(REFERENCE_AMF0);
-        _buf.appendNetworkShort(idx);
+        _encoder.writeReference(idx);
         return true;
     }
-     
-    // 1 for the first, etc...
-    const size_t idx = _offsets.size() + 1;
-    _offsets[obj] = idx;
 
-    /// Native objects are handled specially.
+    /// Native objects are handled specially. They can't be referred to.
     if (obj->relay()) {
         
         Date_as* date;
@@ -152,28 +147,20 @@ Writer::writeObject(as_object* obj)
 
             double d = date->getTimeValue(); 
 #ifdef GNASH_DEBUG_AMF_SERIALIZE
-            log_debug("amf: serializing date object "
-                        "with index %d and value %g", idx, d);
+            log_debug("amf: serializing date object with value %g", d);
 #endif
-            _buf.appendByte(DATE_AMF0);
-            writePlainNumber(_buf, d);
-
-            // This should be timezone
-            std::uint16_t tz = 0;
-            _buf.appendNetworkShort(tz);
-
+            _encoder.writeDate(d);
             return true;
         }
 
         /// XML is written like a long string (but with an XML marker).
         XML_as* xml;
         if (isNativeType(obj, xml)) {
-            _buf.appendByte(XML_OBJECT_AMF0);
             std::ostringstream s;
             xml->toString(s, true);
 
             const std::string& xmlstr = s.str();
-            writePlainString(_buf, xmlstr, LONG_STRING_AMF0);
+            _encoder.writeXML(xmlstr.data(), xmlstr.size());
 
             return true;
         }
@@ -197,13 +184,13 @@ Writer::writeObject(as_object* obj)
 
             if (s.strict()) {
 
+                const size_t idx = _encoder.startArray(len);
+                _offsets[obj] = idx;
 #ifdef GNASH_DEBUG_AMF_SERIALIZE
                 log_debug("amf: serializing array of %d "
                             "elements as STRICT_ARRAY (index %d)",
                             len, idx);
 #endif
-                _buf.appendByte(STRICT_ARRAY_AMF0);
-                _buf.appendNetworkLong(len);
 
                 as_value elem;
                 for (size_t i = 0; i < len; ++i) {
@@ -214,26 +201,28 @@ Writer::writeObject(as_object* obj)
                         return false;
                     }
                 }
+                _encoder.end();
                 return true;
             }
         }
 
         // A normal array.
+        const size_t idx = _encoder.startECMAArray(len);
+        _offsets[obj] = idx;
 #ifdef GNASH_DEBUG_AMF_SERIALIZE
         log_debug("amf: serializing array of %d "
                     "elements as ECMA_ARRAY (index %d) ",
                     len, idx);
 #endif
-        _buf.appendByte(ECMA_ARRAY_AMF0);
-        _buf.appendNetworkLong(len);
     }
     else {
         // It's a simple object
+        const size_t idx = _encoder.startObject();
+        _offsets[obj] = idx;
 #ifdef GNASH_DEBUG_AMF_SERIALIZE
         log_debug("amf: serializing object (or function) "
                     "with index %d", idx);
 #endif
-        _buf.appendByte(OBJECT_AMF0);
     }
 
     ObjectSerializer props(*this, vm);
@@ -242,29 +231,28 @@ Writer::writeObject(as_object* obj)
         log_error(_("Could not serialize object"));
         return false;
     }
-    _buf.appendNetworkShort(0);
-    _buf.appendByte(OBJECT_END_AMF0);
+    _encoder.end();
     return true;
 }
 
 bool
 Writer::writeString(const std::string& str)
 {
-    write(_buf, str);
+    _encoder.writeString(str);
     return true;
 }
 
 bool
 Writer::writeNumber(double d)
 {
-    write(_buf, d);
+    _encoder.writeNumber(d);
     return true;
 }
 
 bool
 Writer::writeBoolean(bool b)
 {
-    write(_buf, b);
+    _encoder.writeBoolean(b);
     return true;
 }
 
@@ -275,7 +263,7 @@ Writer::writeUndefined()
 #ifdef GNASH_DEBUG_AMF_SERIALIZE
     log_debug("amf: serializing undefined");
 #endif
-    _buf.appendByte(UNDEFINED_AMF0);
+    _encoder.writeUndefined();
     return true;
 }
 
@@ -285,7 +273,7 @@ Writer::writeNull()
 #ifdef GNASH_DEBUG_AMF_SERIALIZE
     log_debug("amf: serializing null");
 #endif
-    _buf.appendByte(NULL_AMF0);
+    _encoder.writeNull();
     return true;
 }
 
@@ -304,279 +292,215 @@ Reader::operator()(as_value& val, Type t)
         return false;
     }
 
-    // This may leave the read position at the _end of the buffer, but
-    // some types are complete with the type byte (null, undefined).
-    if (t == NOTYPE) {
-        t = static_cast<Type>(*_pos);
-        ++_pos;
-    }
-    
-    try {
-
-        switch (t) {
-            
-            default:
-                log_error(_("Unknown AMF type %s! Cannot proceed"), t);
-                // A fatal error, since we don't know how much to parse
-                return false;
-
-            // Simple types.
-            case BOOLEAN_AMF0:
-                val = readBoolean(_pos, _end);
-                return true;
-            
-            case STRING_AMF0:
-                val = readString(_pos, _end);
-                return true;
-            
-            case LONG_STRING_AMF0:
-                 val = readLongString(_pos, _end);
-                 return true;
-            
-            case NUMBER_AMF0:
-                val = readNumber(_pos, _end);
-                return true;
-            
-            case UNSUPPORTED_AMF0:
-            case UNDEFINED_AMF0:
-                val = as_value();
-                return true;
-            
-            case NULL_AMF0:
-                val = static_cast<as_object*>(nullptr);
-                return true;
-            
-            // Object types need access to Global_as to create objects.
-            case REFERENCE_AMF0:
-                val = readReference();
-                return true;
-            
-            case OBJECT_AMF0:
-                val = readObject();
-                return true;
-            
-            case ECMA_ARRAY_AMF0:
-                val = readArray();
-                return true;
-            
-            case STRICT_ARRAY_AMF0:
-                val = readStrictArray();
-                return true;
-            
-            case DATE_AMF0:
-                val = readDate();
-                return true;
-
-            case XML_OBJECT_AMF0:
-                val = readXML();
-                return true;
+    // Simple types can be read without their type byte.
+    if (t != NOTYPE) {
+        try {
+            switch (t) {
+                default:
+                    log_error(_("Cannot read AMF type %s without its "
+                                "marker"), t);
+                    return false;
+
+                case BOOLEAN_AMF0:
+                    val = readBoolean(_pos, _end);
+                    return true;
+
+                case STRING_AMF0:
+                    val = readString(_pos, _end);
+                    return true;
+
+                case LONG_STRING_AMF0:
+                    val = readLongString(_pos, _end);
+                    return true;
+
+                case NUMBER_AMF0:
+                    val = readNumber(_pos, _end);
+                    return true;
+
+                case UNSUPPORTED_AMF0:
+                case UNDEFINED_AMF0:
+                    val = as_value();
+                    return true;
+
+                case NULL_AMF0:
+                    val = static_cast<as_object*>(nullptr);
+                    return true;
+            }
+        }
+        catch (const AMFException& e) {
+            log_error(_("AMF parsing error: %s"), e.what());
+            return false;
         }
-    }
-    catch (const AMFException& e) {
-        log_error(_("AMF parsing error: %s"), e.what());
-        return false;
     }
 
-}
+    // Callers may have moved the read position.
+    _decoder.seek(_pos);
+    const Decoder::Event e = _decoder.next();
+    const bool ok = (e != Decoder::NONE) && readValue(e, val);
+    _pos = _decoder.position();
 
-/// Construct an XML object.
-//
-/// Note that the pp seems not to call the constructor or parseXML, but
-/// rather to create it magically. It could do this by calling an ASNative
-/// function.
-as_value
-Reader::readXML()
-{
-    as_value str = readLongString(_pos, _end);
-    as_function* ctor = getMember(_global, NSV::CLASS_XML).to_function();
-    
-    as_value xml;
-    if (ctor) {
-        fn_call::Args args;
-        args += str;
-        VM& vm = getVM(_global);
-        xml = constructInstance(*ctor, as_environment(vm), args);
+    if (!ok) {
+        log_error(_("AMF parsing error"));
     }
-    return xml;
+    return ok;
 }
 
-as_value
-Reader::readStrictArray()
+bool
+Reader::readValue(Decoder::Event e, as_value& val)
 {
-    if (_end - _pos < 4) {
-        throw AMFException(_("Read past _end of buffer for strict array length"));
-    }
+    switch (e) {
 
-    const std::uint32_t li = readNetworkLong(_pos);
-    _pos += 4;
+        default:
+            return false;
 
-#ifdef GNASH_DEBUG_AMF_DESERIALIZE
-    log_debug("amf0 starting read of STRICT_ARRAY with %i elements", li);
-#endif
-    
-    as_object* array = _global.createArray();
-    _objectRefs.push_back(array);
+        case Decoder::NUMBER:
+            val = _decoder.number();
+            return true;
 
-    as_value arrayElement;
-    for (size_t i = 0; i < li; ++i) {
+        case Decoder::INTEGER:
+            val = _decoder.integer();
+            return true;
 
-        // Recurse.
-        if (!operator()(arrayElement)) {
-            throw AMFException(_("Unable to read array elements"));
-        }
+        case Decoder::BOOLEAN:
+            val = _decoder.boolean();
+            return true;
 
-        callMethod(array, NSV::PROP_PUSH, arrayElement);
-    }
+        case Decoder::STRING:
+            val = _decoder.string().toString();
+            return true;
 
-    return as_value(array);
-}
+        case Decoder::NULL_VALUE:
+            val = static_cast<as_object*>(nullptr);
+            return true;
 
-// TODO: this function is inconsistent about when it interrupts parsing
-// if the AMF is truncated. If it doesn't interrupt, the next read will
-// fail.
-as_value
-Reader::readArray()
-{
+        case Decoder::UNDEFINED:
+            val = as_value();
+            return true;
 
-    if (_end - _pos < 4) {
-        throw AMFException(_("Read past _end of buffer for array length"));
-    }
+        case Decoder::DATE:
+            val = readDate(_decoder.number());
+            return true;
 
-    const std::uint32_t li = readNetworkLong(_pos);
-    _pos += 4;
-    
-    as_object* array = _global.createArray();
-    _objectRefs.push_back(array);
+        case Decoder::XML:
+            val = readXML(_decoder.string().toString());
+            return true;
 
-    // the count specifies array size, so to have that even if none
-    // of the members are indexed
-    // if short, will be incremented everytime an indexed member is
-    // found
-    array->set_member(NSV::PROP_LENGTH, li);
+        case Decoder::BYTE_ARRAY:
+            log_unimpl(_("AMF3 ByteArray"));
+            val = as_value();
+            return true;
 
+        case Decoder::REFERENCE:
+        {
+            const size_t idx = _decoder.index();
 #ifdef GNASH_DEBUG_AMF_DESERIALIZE
-    log_debug("amf0 starting read of ECMA_ARRAY with %i elements", li);
+            log_debug("readAMF0: reference #%d", idx);
 #endif
-
-    as_value objectElement;
-    VM& vm = getVM(_global);
-    for (;;) {
-
-        // It seems we don't mind about this situation, although it means
-        // the next read will fail.
-        if (_end - _pos < 2) {
-            log_error(_("MALFORMED AMF: premature _end of ECMA_ARRAY "
-                        "block"));
-            break;
-        }
-        const std::uint16_t strlen = readNetworkShort(_pos);
-        _pos += 2; 
-
-        // _end of ECMA_ARRAY is signalled by an empty string
-        // followed by an OBJECT_END_AMF0 (0x09) byte
-        if (!strlen) {
-            // expect an object terminator here
-            if (*_pos != OBJECT_END_AMF0) {
-                log_error(_("MALFORMED AMF: empty member name not "
-                            "followed by OBJECT_END_AMF0 byte"));
+            if (idx >= _objectRefs.size() || !_objectRefs[idx]) {
+                log_error(_("AMF: reference to object %d, which is not "
+                            "complete"), idx);
+                return false;
             }
-            ++_pos;
-            break;
-        }
-        
-        // Throw exception instead?
-        if (_end - _pos < strlen) {
-            log_error(_("MALFORMED AMF: premature _end of ECMA_ARRAY "
-                      "block"));
-            break;
+            val = _objectRefs[idx];
+            return true;
         }
 
-        const std::string name(reinterpret_cast<const char*>(_pos), strlen);
-
+        case Decoder::OBJECT:
+        {
 #ifdef GNASH_DEBUG_AMF_DESERIALIZE
-        log_debug("amf0 ECMA_ARRAY prop name is %s", name);
+            log_debug("amf starting read of OBJECT");
 #endif
+            as_object* obj = createObject(_global);
+            _objectRefs.resize(_decoder.index() + 1);
+            _objectRefs.back() = obj;
+            val = obj;
+            return readMembers(obj);
+        }
 
-        _pos += strlen;
-
-        // Recurse to read element.
-        if (!operator()(objectElement)) {
-            throw AMFException(_("Unable to read array element"));
+        case Decoder::ECMA_ARRAY:
+        case Decoder::ARRAY:
+        {
+#ifdef GNASH_DEBUG_AMF_DESERIALIZE
+            log_debug("amf starting read of array with %i elements",
+                    _decoder.count());
+#endif
+            as_object* array = _global.createArray();
+            _objectRefs.resize(_decoder.index() + 1);
+            _objectRefs.back() = array;
+
+            // the count specifies array size, so to have that even if
+            // none of the members are indexed
+            if (e == Decoder::ECMA_ARRAY) {
+                array->set_member(NSV::PROP_LENGTH, _decoder.count());
+            }
+            val = array;
+            return readMembers(array);
         }
-        array->set_member(getURI(vm, name), objectElement);
     }
-    return as_value(array);
 }
 
-as_value
-Reader::readObject()
+bool
+Reader::readMembers(as_object* obj)
 {
     VM& vm = getVM(_global);
-    as_object* obj = createObject(_global); 
+    as_value element;
 
-#ifdef GNASH_DEBUG_AMF_DESERIALIZE
-    log_debug("amf0 starting read of OBJECT");
-#endif
-
-    _objectRefs.push_back(obj);
-
-    as_value tmp;
-    std::string keyString;
     for (;;) {
+        Decoder::Event e = _decoder.next();
+        switch (e) {
 
-        if (!operator()(tmp, STRING_AMF0)) {
-            throw AMFException(_("Could not read object property name"));
-        }
-        keyString = tmp.to_string();
+            case Decoder::NONE:
+                log_error(_("MALFORMED AMF: unable to read object "
+                            "member"));
+                return false;
 
-        if (keyString.empty()) {
-            if (_pos < _end) {
-                // AMF0 has a redundant "object _end" byte
-                ++_pos; 
-            }
-            else {
-                // What is the point?
-                log_error(_("AMF buffer terminated just before "
-                            "object _end byte. continuing anyway."));
+            case Decoder::END:
+                return true;
+
+            case Decoder::KEY:
+            {
+                const std::string name = _decoder.string().toString();
+#ifdef GNASH_DEBUG_AMF_DESERIALIZE
+                log_debug("amf member name is %s", name);
+#endif
+                e = _decoder.next();
+                if (!readValue(e, element)) return false;
+                obj->set_member(getURI(vm, name), element);
+                break;
             }
-            return as_value(obj);
-        }
 
-        if (!operator()(tmp)) {
-            throw AMFException("Unable to read object member");
+            default:
+                if (!readValue(e, element)) return false;
+                callMethod(obj, NSV::PROP_PUSH, element);
         }
-        obj->set_member(getURI(vm, keyString), tmp);
     }
 }
 
+/// Construct an XML object.
+//
+/// Note that the pp seems not to call the constructor or parseXML, but
+/// rather to create it magically. It could do this by calling an ASNative
+/// function.
 as_value
-Reader::readReference()
+Reader::readXML(const std::string& str)
 {
-
-    if (_end - _pos < 2) {
-        throw AMFException("Read past _end of buffer for reference index");
-    }
-    const std::uint16_t si = readNetworkShort(_pos);
-    _pos += 2;
-
-#ifdef GNASH_DEBUG_AMF_DESERIALIZE
-    log_debug("readAMF0: reference #%d", si);
-#endif
-    if (si < 1 || si > _objectRefs.size()) {
-        log_error(_("readAMF0: invalid reference to object %d (%d known "
-                  "objects)"), si, _objectRefs.size());
-        throw AMFException("Reference to invalid object reference");
+    as_function* ctor = getMember(_global, NSV::CLASS_XML).to_function();
+    
+    as_value xml;
+    if (ctor) {
+        fn_call::Args args;
+        args += str;
+        VM& vm = getVM(_global);
+        xml = constructInstance(*ctor, as_environment(vm), args);
     }
-    return as_value(_objectRefs[si - 1]);
+    return xml;
 }
 
 as_value
-Reader::readDate()
+Reader::readDate(double d)
 {
-    const double d = readNumber(_pos, _end);
-
 #ifdef GNASH_DEBUG_AMF_DESERIALIZE
-    log_debug("amf0 read date: %e", dub);
+    log_debug("amf read date: %e", d);
 #endif
 
     as_function* ctor = getMember(_global, NSV::CLASS_DATE).to_function();
@@ -587,17 +511,6 @@ Reader::readDate()
         fn_call::Args args;
         args += d;
         date = constructInstance(*ctor, as_environment(vm), args);
-
-        if (_end - _pos < 2) {
-            throw AMFException("premature _end of input reading "
-                        "timezone from Date type");
-        }
-        const std::uint16_t tz = readNetworkShort(_pos);
-        if (tz != 0) {
-            log_error(_("Date type encoded timezone info %1%, even though "
-                "this field should not be used."), tz);
-        }
-        _pos += 2;
     }
     return date;
 }
@@ -26,6 +26,7 @@
 
 #include "dsodefs.h"
 #include "AMF.h"
+#include "AMFCodec.h"
 
 namespace gnash {
     class as_object;
@@ -60,6 +61,7 @@ public:
 
     Writer(SimpleBuffer& buf, bool strictArray = false)
         :
+        _encoder(buf),
         _buf(buf),
         _strictArray(strictArray)
     {}
@@ -96,7 +98,9 @@ public:
 
 private:
 
+    /// The objects written, and their numbers in the encoder.
     OffsetTable _offsets;
+    Encoder _encoder;
     SimpleBuffer& _buf;
     bool _strictArray;
 
@@ -134,6 +138,7 @@ public:
     /// @param gl       A global reference for creating objects when necessary.
     Reader(const std::uint8_t*& pos, const std::uint8_t* end, Global_as& gl)
         :
+        _decoder(pos, end),
         _pos(pos),
         _end(end),
         _global(gl)
@@ -142,7 +147,8 @@ public:
     /// Create a type from current position in the AMF buffer.
     //
     /// @param val      An as_value to be created from the AMF data.
-    /// @param type     The type of the data to read.
+    /// @param type     The type of the data to read. Only simple types
+    ///                 can be read without their type byte.
     /// @return         false if this read failed for any reason.
     ///                 The constructed as_value is then invalid. True if
     ///                 the read succeeded and the as_value is valid.
@@ -150,25 +156,24 @@ public:
 
 private:
 
-    /// Read an XML type.
-    as_value readXML();
-
-    /// Read a Date object type.
-    as_value readDate();
-    
-    /// Read a simple object type.
-    as_value readObject();
-    
-    /// Read an object reference type.
-    as_value readReference();
-    
-    /// Read an array object type.
-    as_value readArray();
-    
-    /// Read a strict array object type.
-    as_value readStrictArray();
-
-    /// Object references.
+    /// Create a value from what the decoder has just read.
+    bool readValue(Decoder::Event e, as_value& val);
+
+    /// Read the members of an object or array up to its end.
+    //
+    /// Named members are set, others are pushed onto the array.
+    bool readMembers(as_object* obj);
+
+    /// Construct an XML object.
+    as_value readXML(const std::string& str);
+
+    /// Construct a Date object.
+    as_value readDate(double d);
+
+    /// Reads the buffer, and resolves references to objects.
+    Decoder _decoder;
+
+    /// Object references, by their number in the decoder.
     std::vector<as_object*> _objectRefs;
 
     /// The current position in the buffer.
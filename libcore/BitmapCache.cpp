@@ -0,0 +1,188 @@
+// BitmapCache.cpp: decoded bitmaps kept within a memory budget.
+//
+//   Copyright (C) 2005, 2006, 2007, 2008, 2009, 2010, 2011, 2012
+//   Free Software Foundation, Inc
+//
+// This program is free software; you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation; either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program; if not, write to the Free Software
+// Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+
+#include "BitmapCache.h"
+
+#include <algorithm>
+#include <exception>
+
+#include "CachedBitmap.h"
+#include "GnashImage.h"
+#include "Renderer.h"
+#include "WorkerPool.h"
+#include "log.h"
+#include "rc.h"
+
+namespace gnash {
+
+LazyBitmap::LazyBitmap(Decoder decoder, BitmapCache& cache)
+    :
+    _decoder(std::move(decoder)),
+    _cache(cache),
+    _reserved(0),
+    _broken(false),
+    _bytes(0)
+{
+}
+
+LazyBitmap::~LazyBitmap()
+{
+    // A decode still running only holds its own copy of the decoder.
+    if (_reserved) _cache.release(_reserved);
+    _cache.remove(*this);
+}
+
+void
+LazyBitmap::prefetch(WorkerPool& workers, size_t bytes)
+{
+    if (!bytes || _prefetched.valid() || !_cache.reserve(bytes)) return;
+    _reserved = bytes;
+    const Decoder decoder(_decoder);
+    _prefetched = workers.submit([decoder] { return decoder(); });
+}
+
+CachedBitmap*
+LazyBitmap::get(Renderer& renderer)
+{
+    if (CachedBitmap* bitmap = _cache.touch(*this)) return bitmap;
+    if (_broken) return nullptr;
+
+    std::unique_ptr<image::GnashImage> im;
+    try {
+        if (_prefetched.valid()) {
+            _cache.release(_reserved);
+            _reserved = 0;
+            im = _prefetched.get();
+        }
+        else im = _decoder();
+    }
+    catch (const std::exception& e) {
+        log_error(_("Could not decode bitmap: %1%"), e.what());
+    }
+    if (!im) {
+        // Don't try again every frame.
+        _broken = true;
+        return nullptr;
+    }
+
+    const size_t bytes = im->size();
+    boost::intrusive_ptr<CachedBitmap> bitmap =
+        renderer.createCachedBitmap(std::move(im));
+    if (!bitmap) return nullptr;
+
+    _cache.insert(*this, bitmap, bytes);
+    return bitmap.get();
+}
+
+BitmapCache::BitmapCache(size_t limit)
+    :
+    _limit(limit),
+    _bytes(0),
+    _reserved(0)
+{
+}
+
+BitmapCache&
+BitmapCache::getDefaultInstance()
+{
+    // Never destroyed, as movies kept until exit still refer to it.
+    static BitmapCache* cache = new BitmapCache(std::max(0,
+                RcInitFile::getDefaultInstance().bitmapCacheSize()) * 1024UL);
+    return *cache;
+}
+
+void
+BitmapCache::trim()
+{
+    std::lock_guard<std::mutex> lock(_mutex);
+    while (_limit && _bytes > _limit && !_order.empty()) {
+        LazyBitmap& b = *_order.back();
+        _order.pop_back();
+        _bytes -= b._bytes;
+        b._bytes = 0;
+        b._bitmap.reset();
+    }
+}
+
+size_t
+BitmapCache::bytes() const
+{
+    std::lock_guard<std::mutex> lock(_mutex);
+    return _bytes;
+}
+
+size_t
+BitmapCache::size() const
+{
+    std::lock_guard<std::mutex> lock(_mutex);
+    return _order.size();
+}
+
+bool
+BitmapCache::reserve(size_t bytes)
+{
+    std::lock_guard<std::mutex> lock(_mutex);
+    if (_limit && _bytes + _reserved + bytes > _limit) return false;
+    _reserved += bytes;
+    return true;
+}
+
+void
+BitmapCache::release(size_t bytes)
+{
+    std::lock_guard<std::mutex> lock(_mutex);
+    _reserved -= bytes;
+}
+
+void
+BitmapCache::insert(LazyBitmap& b, boost::intrusive_ptr<CachedBitmap> bitmap,
+        size_t bytes)
+{
+    std::lock_guard<std::mutex> lock(_mutex);
+    if (b._bitmap) {
+        _order.erase(b._position);
+        _bytes -= b._bytes;
+    }
+    b._bitmap = bitmap;
+    b._bytes = bytes;
+    _order.push_front(&b);
+    b._position = _order.begin();
+    _bytes += bytes;
+}
+
+CachedBitmap*
+BitmapCache::touch(LazyBitmap& b)
+{
+    std::lock_guard<std::mutex> lock(_mutex);
+    if (!b._bitmap) return nullptr;
+    _order.splice(_order.begin(), _order, b._position);
+    return b._bitmap.get();
+}
+
+void
+BitmapCache::remove(LazyBitmap& b)
+{
+    std::lock_guard<std::mutex> lock(_mutex);
+    if (!b._bitmap) return;
+    _order.erase(b._position);
+    _bytes -= b._bytes;
+    b._bitmap.reset();
+}
+
+} // namespace gnash
@@ -0,0 +1,167 @@
+// BitmapCache.h: decoded bitmaps kept within a memory budget.
+//
+//   Copyright (C) 2005, 2006, 2007, 2008, 2009, 2010, 2011, 2012
+//   Free Software Foundation, Inc
+//
+// This program is free software; you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation; either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program; if not, write to the Free Software
+// Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+
+#ifndef GNASH_BITMAPCACHE_H
+#define GNASH_BITMAPCACHE_H
+
+#include "dsodefs.h" // for DSOEXPORT
+
+#include <boost/intrusive_ptr.hpp>
+#include <boost/noncopyable.hpp>
+#include <cstddef>
+#include <functional>
+#include <future>
+#include <list>
+#include <memory>
+#include <mutex>
+
+// Forward declarations
+namespace gnash {
+    class BitmapCache;
+    class CachedBitmap;
+    class Renderer;
+    class WorkerPool;
+    namespace image {
+        class GnashImage;
+    }
+}
+
+namespace gnash {
+
+/// A bitmap decoded when it is first used, and again after the
+/// BitmapCache drops it.
+//
+/// The compressed data stays with the decoder.
+class DSOEXPORT LazyBitmap : boost::noncopyable
+{
+public:
+
+    typedef std::function<std::unique_ptr<image::GnashImage>()> Decoder;
+
+    /// @param decoder  Decodes the bitmap. It may be called again
+    ///                 whenever the bitmap was dropped.
+    /// @param cache    The cache keeping the decoded bitmap.
+    LazyBitmap(Decoder decoder, BitmapCache& cache);
+
+    ~LazyBitmap();
+
+    /// Decode the bitmap on a worker thread now, if the cache has room
+    /// for it.
+    //
+    /// @param bytes    The expected size of the decoded image. 0 if
+    ///                 unknown, in which case nothing is done.
+    void prefetch(WorkerPool& workers, size_t bytes);
+
+    /// Get the bitmap, decoding it if needed.
+    //
+    /// Only one thread at a time may call this.
+    ///
+    /// @return The bitmap, which stays valid until the next
+    ///         BitmapCache::trim(), or null if it can't be decoded.
+    CachedBitmap* get(Renderer& renderer);
+
+private:
+
+    friend class BitmapCache;
+
+    typedef std::list<LazyBitmap*> Order;
+
+    const Decoder _decoder;
+
+    BitmapCache& _cache;
+
+    /// A decode started by prefetch(), and the bytes reserved for it.
+    std::future<std::unique_ptr<image::GnashImage> > _prefetched;
+    size_t _reserved;
+
+    /// Whether decoding failed.
+    bool _broken;
+
+    /// The decoded bitmap, if kept by the cache.
+    boost::intrusive_ptr<CachedBitmap> _bitmap;
+    size_t _bytes;
+    Order::iterator _position;
+};
+
+/// The decoded bitmaps of all movies, within a memory budget.
+//
+/// When the bitmaps take more than the budget, trim() drops the least
+/// recently used ones. A bitmap still used by a BitmapData or drawn
+/// elsewhere lives on until they let go of it.
+class DSOEXPORT BitmapCache : boost::noncopyable
+{
+public:
+
+    /// @param limit    The number of bytes decoded bitmaps may take.
+    ///                 0 means no limit.
+    explicit BitmapCache(size_t limit);
+
+    /// The cache set up by the bitmapCacheSize gnashrc directive.
+    static BitmapCache& getDefaultInstance();
+
+    /// Drop the least recently used bitmaps until they fit the budget.
+    //
+    /// Bitmaps returned by LazyBitmap::get() before are no longer
+    /// safe to use, so call this between frames.
+    void trim();
+
+    /// The bytes taken by decoded bitmaps.
+    size_t bytes() const;
+
+    /// The number of decoded bitmaps.
+    size_t size() const;
+
+    size_t limit() const { return _limit; }
+
+private:
+
+    friend class LazyBitmap;
+
+    /// Reserve room for a bitmap being decoded.
+    bool reserve(size_t bytes);
+
+    /// Release what reserve() took.
+    void release(size_t bytes);
+
+    /// Add a decoded bitmap as the most recently used.
+    void insert(LazyBitmap& b, boost::intrusive_ptr<CachedBitmap> bitmap,
+            size_t bytes);
+
+    /// Make a decoded bitmap the most recently used.
+    //
+    /// @return The bitmap, or null if it was dropped.
+    CachedBitmap* touch(LazyBitmap& b);
+
+    /// Forget a bitmap.
+    void remove(LazyBitmap& b);
+
+    const size_t _limit;
+
+    mutable std::mutex _mutex;
+
+    /// Decoded bitmaps, the most recently used first.
+    LazyBitmap::Order _order;
+
+    size_t _bytes;
+    size_t _reserved;
+};
+
+} // namespace gnash
+
+#endif
@@ -764,6 +764,22 @@ Button::getBounds() const
     return allBounds;
 }
 
+SWFRect
+Button::getMouseBounds() const
+{
+    SWFRect allBounds;
+
+    ConstDisplayObjects chars;
+    getActiveCharacters(chars);
+    chars.insert(chars.end(), _hitCharacters.begin(), _hitCharacters.end());
+
+    for (const DisplayObject* ch : chars) {
+        allBounds.expand_to_transformed_rect(getMatrix(*ch),
+                ch->getMouseBounds());
+    }
+    return allBounds;
+}
+
 bool
 Button::pointInShape(std::int32_t x, std::int32_t y) const
 {
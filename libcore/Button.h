@@ -106,6 +106,9 @@ public:
     void add_invalidated_bounds(InvalidatedRanges& ranges, bool force);
     
     virtual SWFRect getBounds() const;
+
+    /// Include the hit area, which is not drawn.
+    virtual SWFRect getMouseBounds() const;
     
     // See dox in DisplayObject.h
     bool pointInShape(std::int32_t x, std::int32_t y) const;
@@ -20,9 +20,12 @@
 
 #include <vector>
 #include <iostream>
+#include <cctype>
 
 #include "ConstantPool.h"
 #include "VM.h"
+#include "as_environment.h"
+#include "as_value.h"
 
 
 namespace gnash {
@@ -31,11 +34,62 @@ std::ostream&
 operator<<(std::ostream& os, const ConstantPool& p) {
     for (size_t i=0; i<p.size(); ++i) {
         if (i) os <<  ", ";
-        os << i << ':' << p[i];
+        os << i << ':' << p.c_str(i);
     }
     return os;
 }
 
+namespace {
+
+/// Make a SharedString, interned if it looks like a name.
+SharedString
+makeShared(const char* s)
+{
+    // Longer strings are rarely names.
+    const size_t maxIdentifier = 64;
+
+    size_t len = 0;
+    for (const char* c = s; *c; ++c, ++len) {
+        const unsigned char ch = *c;
+        if (len == maxIdentifier) return SharedString(s);
+        if (!std::isalnum(ch) && ch != '_' && ch != '$' && ch != '.' &&
+                ch != '/' && ch != ':') {
+            return SharedString(s);
+        }
+    }
+    return SharedString::intern(s);
+}
+
+} // anonymous namespace
+
+void
+ConstantPool::share(size_t i) const
+{
+    const Entry& e = _entries[i];
+    e.str = makeShared(e.chars);
+    _shared[e.str.identity()] = i;
+}
+
+const VariableName*
+ConstantPool::variableName(VM& vm, const as_value& val) const
+{
+    const void* id = val.stringIdentity();
+    if (!id) return nullptr;
+
+    const auto it = _shared.find(id);
+    if (it == _shared.end()) return nullptr;
+
+    // The names of another VM were interned in its string table.
+    if (_vm != &vm) {
+        for (const Entry& e : _entries) e.name.reset();
+        _vm = &vm;
+    }
+
+    const Entry& e = _entries[it->second];
+    if (!e.name) e.name = vm.variableName(e.chars);
+    return e.name.get();
+}
+
 
 PoolGuard::PoolGuard(VM& vm, const ConstantPool* pool)
     :
@@ -21,13 +21,84 @@
 
 #include <vector>
 #include <iosfwd>
+#include <memory>
+#include <unordered_map>
+
+#include "SharedString.h"
 
 namespace gnash {
 
 class VM;
+class VariableName;
+class as_value;
+
+/// An indexed list of strings, read from an ActionConstantPool.
+//
+/// The strings point into the action_buffer. Each is made into a
+/// SharedString when it is first pushed, which the values pushed after
+/// share, so entries a movie never pushes take no memory. Entries that
+/// look like identifiers or variable paths are interned, as the same
+/// names are in the pools of many action buffers. Entries naming
+/// variables are parsed once, the first time a value pushed from them
+/// is used as a name. The pool belongs to the thread running
+/// ActionScript.
+class ConstantPool
+{
+public:
+
+    ConstantPool() : _vm(nullptr) {}
+
+    /// Append a string, which must live as long as the pool.
+    void push_back(const char* s) {
+        _entries.push_back(Entry(s));
+    }
+
+    size_t size() const {
+        return _entries.size();
+    }
+
+    /// The string at an index, without making a SharedString.
+    const char* c_str(size_t i) const {
+        return _entries[i].chars;
+    }
+
+    /// The string at an index, shared by every value pushed from it.
+    const SharedString& operator[](size_t i) const {
+        const Entry& e = _entries[i];
+        if (e.str.empty() && *e.chars) share(i);
+        return e.str;
+    }
 
-/// An indexed list of strings (must match the definition in action_buffer.h)
-typedef std::vector<const char*> ConstantPool;
+    /// The parsed name of the entry a string value was pushed from.
+    //
+    /// @param vm       The VM whose string table is used for interning.
+    /// @param val      A value used as a variable name.
+    /// @return         null if the value was not pushed from this pool.
+    const VariableName* variableName(VM& vm, const as_value& val) const;
+
+private:
+
+    /// Make the SharedString of an entry, interned for identifiers.
+    void share(size_t i) const;
+
+    struct Entry
+    {
+        explicit Entry(const char* s) : chars(s) {}
+        const char* chars;
+        mutable SharedString str;
+
+        /// The entry as a variable name, once it has been used as one.
+        mutable std::shared_ptr<const VariableName> name;
+    };
+
+    std::vector<Entry> _entries;
+
+    /// The entry each shared string was made for.
+    mutable std::unordered_map<const void*, size_t> _shared;
+
+    /// The VM the names were parsed for.
+    mutable const VM* _vm;
+};
 
 std::ostream& operator<<(std::ostream& os, const ConstantPool& p);
 
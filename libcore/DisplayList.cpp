@@ -171,6 +171,7 @@ DisplayList::getDisplayObjectByName(string_table& st, const ObjectURI& uri,
 void
 DisplayList::placeDisplayObject(DisplayObject* ch, int depth)
 {
+    _mouseIndex.clear();
     assert(!ch->unloaded());
     ch->set_invalidated();
     ch->set_depth(depth);
@@ -211,6 +212,9 @@ DisplayList::placeDisplayObject(DisplayObject* ch, int depth)
 void
 DisplayList::add(DisplayObject* ch, bool replace)
 {
+    _mouseIndex.clear();
+    ch->boundsChanged();
+
     const int depth = ch->get_depth();
 
     container_type::iterator it =
@@ -231,6 +235,7 @@ DisplayList::replaceDisplayObject(DisplayObject* ch, int depth,
         bool use_old_cxform, bool use_old_matrix)
 {
     testInvariant();
+    _mouseIndex.clear();
 
     //GNASH_REPORT_FUNCTION;
     assert(!ch->unloaded());
@@ -331,6 +336,7 @@ void
 DisplayList::removeDisplayObject(int depth)
 {
     testInvariant();
+    _mouseIndex.clear();
 
 #ifndef NDEBUG
     container_type::size_type size = _charsByDepth.size();
@@ -372,6 +378,7 @@ void
 DisplayList::swapDepths(DisplayObject* ch1, int newdepth)
 {
     testInvariant();
+    _mouseIndex.clear();
 
     if (newdepth < DisplayObject::staticDepthOffset) {
         IF_VERBOSE_ASCODING_ERRORS(
@@ -447,6 +454,7 @@ void
 DisplayList::insertDisplayObject(DisplayObject* obj, int index)
 {
     testInvariant();
+    _mouseIndex.clear();
 
     assert(!obj->unloaded());
 
@@ -477,6 +485,7 @@ bool
 DisplayList::unload()
 {
     testInvariant();
+    _mouseIndex.clear();
 
     bool unloadHandler = false;
 
@@ -516,6 +525,7 @@ void
 DisplayList::destroy()
 {
     testInvariant();
+    _mouseIndex.clear();
 
     for (iterator it = _charsByDepth.begin(), itEnd = _charsByDepth.end();
             it != itEnd; ) {
@@ -586,7 +596,11 @@ DisplayList::display(Renderer& renderer, const Transform& base)
     	if (ch->isMaskLayer()) {
             const int clipDepth = ch->get_clip_depth();
             clipDepthStack.push(clipDepth);
-            renderer.begin_submit_mask();
+            SWFMatrix m = base.matrix;
+            m.concatenate(getMatrix(*ch));
+            SWFRect bounds = ch->getBounds();
+            m.transform(bounds);
+            renderer.begin_submit_mask(bounds);
         }
         
         if (ch->boundsInClippingArea(renderer)) {
@@ -732,6 +746,8 @@ void
 DisplayList::mergeDisplayList(DisplayList& newList, DisplayObject& o)
 {
     testInvariant();
+    _mouseIndex.clear();
+    o.boundsChanged();
 
     iterator itOld = beginNonRemoved(_charsByDepth);
     iterator itNew = beginNonRemoved(newList._charsByDepth);
@@ -893,6 +909,7 @@ DisplayList::mergeDisplayList(DisplayList& newList, DisplayObject& o)
 void
 DisplayList::reinsertRemovedCharacter(DisplayObject* ch)
 {
+    _mouseIndex.clear();
     assert(ch->unloaded());
     assert(!ch->isDestroyed());
     testInvariant();
@@ -917,6 +934,7 @@ void
 DisplayList::removeUnloaded()
 {
     testInvariant();
+    _mouseIndex.clear();
 
     _charsByDepth.remove_if(std::mem_fn(&DisplayObject::unloaded));
 
@@ -22,6 +22,7 @@
 
 #include <list>
 #include <iosfwd>
+#include <vector>
 #if GNASH_PARANOIA_LEVEL > 1 && !defined(NDEBUG)
 #include "DisplayObject.h"
 #include <set>  // for testInvariant
@@ -30,6 +31,7 @@
 #endif
 
 #include "snappingrange.h"
+#include "MouseIndex.h"
 #include "dsodefs.h" // for DSOTEXPORT
 
 
@@ -266,6 +268,39 @@ public:
 	template <class V> inline void visitAll(V& visitor);
 	template <class V> inline void visitAll(V& visitor) const;
 
+	/// Visit the DisplayObjects that may be hit at a point, in depth
+	/// order (lower depth first).
+	//
+	/// These are all masks and the DisplayObjects whose mouse bounds
+	/// contain the point; any other DisplayObject can't be hit there.
+	/// The visitor functor's return value is not used.
+	///
+	/// @param x        Point x coordinate in the space of the
+	///                 list's owner.
+	/// @param y        Point y coordinate in the space of the
+	///                 list's owner.
+	/// @param margin   Twips added around bounds, to allow for
+	///                 rounding.
+	template <class V> inline void visitAt(V& visitor, double x, double y,
+	        double margin) const;
+
+	/// The union of the mouse bounds of all DisplayObjects.
+	//
+	/// See DisplayObject::getMouseBounds().
+	const SWFRect& mouseBounds() const {
+		return mouseIndex().bounds();
+	}
+
+	/// Note that the bounds of a DisplayObject may have changed.
+	//
+	/// Called by DisplayObject::boundsChanged().
+	///
+	/// @return false if this was noted before and the index wasn't
+	///         refitted since.
+	bool childBoundsChanged(const DisplayObject& ch) {
+		return _mouseIndex.changed(ch);
+	}
+
     /// Like DisplayObject_instance::add_invalidated_bounds() this method calls the
     /// method with the same name of all childs.	
 	void add_invalidated_bounds(InvalidatedRanges& ranges, bool force);	
@@ -345,7 +380,16 @@ private:
     /// occupied
 	void reinsertRemovedCharacter(DisplayObject* ch);
 
+	/// The DisplayObjects by bounds, refitted or built when needed.
+	const MouseIndex& mouseIndex() const {
+		_mouseIndex.refit();
+		if (!_mouseIndex.valid()) _mouseIndex.build(_charsByDepth);
+		return _mouseIndex;
+	}
+
 	container_type _charsByDepth;
+
+	mutable MouseIndex _mouseIndex;
 };
 
 template <class V>
@@ -386,6 +430,17 @@ DisplayList::visitAll(V& visitor) const
 	}
 }
 
+template <class V>
+void
+DisplayList::visitAt(V& visitor, double x, double y, double margin) const
+{
+	std::vector<DisplayObject*> found;
+	mouseIndex().find(x, y, margin, found);
+	for (DisplayObject* ch : found) {
+		visitor(ch);
+	}
+}
+
 DSOTEXPORT std::ostream& operator<< (std::ostream&, const DisplayList&);
 
 } // namespace gnash
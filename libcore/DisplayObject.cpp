@@ -188,6 +188,8 @@ DisplayObject::set_invalidated()
 void
 DisplayObject::set_invalidated(const char* debug_file, int debug_line)
 {
+    boundsChanged();
+
     // Set the invalidated-flag of the parent. Note this does not mean that
     // the parent must re-draw itself, it just means that one of it's childs
     // needs to be re-drawn.
@@ -758,11 +760,26 @@ DisplayObject::setMask(DisplayObject* mask)
     }
 }
 
+void
+DisplayObject::boundsChanged()
+{
+    // The parent keeps the bounds of its children in its own space, so
+    // only its entry for this is stale. Its own bounds may change too,
+    // which its parent checks when it next refits.
+    const DisplayObject* ch = this;
+    for (DisplayObject* p = _parent; p; ch = p, p = p->_parent) {
+        if (!p->childBoundsChanged(*ch)) break;
+    }
+}
+
 void
 DisplayObject::setMaskee(DisplayObject* maskee)
 {
     if ( _maskee == maskee ) { return; }
 
+    // Whether this is a mask layer may change.
+    boundsChanged();
+
     if (_maskee) {
         // We don't want the maskee to call setMaskee(null)
         // on us again
@@ -973,10 +990,15 @@ DisplayObject::MaskRenderer::MaskRenderer(Renderer& r, const DisplayObject& o)
 {
     if (!_mask) return;
 
-    _renderer.begin_submit_mask();
     DisplayObject* p = _mask->parent();
     const Transform tr = p ?
         Transform(getWorldMatrix(*p), getWorldCxForm(*p)) : Transform(); 
+
+    SWFMatrix m = tr.matrix;
+    m.concatenate(getMatrix(*_mask));
+    SWFRect bounds = _mask->getBounds();
+    m.transform(bounds);
+    _renderer.begin_submit_mask(bounds);
     _mask->display(_renderer, tr);
     _renderer.end_submit_mask();
 }
@@ -377,6 +377,7 @@ public:
     /// See get_clip_depth()
     void set_clip_depth(int d)
     {
+        boundsChanged();
         m_clip_depth = d;
     }
         
@@ -479,6 +480,22 @@ public:
 
 	virtual SWFRect getBounds() const = 0;
 
+    /// Return the bounds of everything that may be hit by the mouse
+    //
+    /// This is getBounds() unless parts that aren't drawn can be hit, as
+    /// with the hit area of a Button.
+    ///
+    /// @return     Bounds in local space.
+    virtual SWFRect getMouseBounds() const {
+        return getBounds();
+    }
+
+    /// Tell the parents that the mouse bounds may change.
+    //
+    /// This is called by set_invalidated(), so only a change that doesn't
+    /// otherwise invalidate this DisplayObject needs to call it.
+    void boundsChanged();
+
     /// Return true if the given point falls in this DisplayObject's bounds
     //
     /// @param x        Point x coordinate in world space
@@ -977,6 +994,14 @@ protected:
 
     virtual bool unloadChildren() { return false; }
 
+    /// Note that the mouse bounds of a child may have changed.
+    //
+    /// @return false if the parents of this DisplayObject were already
+    ///         told that its own mouse bounds may change.
+    virtual bool childBoundsChanged(const DisplayObject& /*ch*/) {
+        return true;
+    }
+
     /// Get the movie_root to which this DisplayObject belongs.
     movie_root& stage() const {
         return _stage;
@@ -181,15 +181,9 @@ BitmapFill::operator=(const BitmapFill& other)
 const CachedBitmap*
 BitmapFill::bitmap() const
 {
-    if (_bitmapInfo) {
-        return  _bitmapInfo.get();
-    }
-    if (!_md) {
-        return nullptr;
-    }
-    _bitmapInfo = _md->getBitmap(_id);
-
-    // May still be 0!
+    // Bitmaps of the movie are looked up every time, so that the
+    // BitmapCache can drop them while unused.
+    if (_md) return _md->getBitmap(_id);
     return _bitmapInfo.get();
 }
     
@@ -139,8 +139,8 @@ private:
 
     SWFMatrix _matrix;
     
-    /// A Bitmap, used for dynamic fills and to cache parsed bitmaps.
-    mutable boost::intrusive_ptr<const CachedBitmap> _bitmapInfo;
+    /// A Bitmap, used for dynamic fills.
+    boost::intrusive_ptr<const CachedBitmap> _bitmapInfo;
 
     /// The movie definition containing the bitmap
     movie_definition* _md;
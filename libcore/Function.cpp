@@ -19,6 +19,7 @@
 #include "Function.h"
 
 #include <algorithm>
+#include <boost/algorithm/string/case_conv.hpp>
 
 #include "log.h"
 #include "fn_call.h"
@@ -30,9 +31,16 @@
 #include "namedStrings.h"
 #include "CallStack.h"
 #include "DisplayObject.h"
+#include "GnashException.h"
+#include "SWF.h"
 
 namespace gnash {
 
+namespace {
+    int scanCode(const action_buffer& code, size_t start, size_t end,
+            const ConstantPool* pool);
+}
+
 Function::Function(const action_buffer& ab, as_environment& env,
             size_t start, ScopeStack scopeStack)
     :
@@ -42,7 +50,8 @@ Function::Function(const action_buffer& ab, as_environment& env,
     _action_buffer(ab),
     _scopeStack(std::move(scopeStack)),
     _startPC(start),
-    _length(0)
+    _length(0),
+    _codeUses(-1)
 {
     assert( _startPC < _action_buffer.size() );
 }
@@ -123,22 +132,30 @@ Function::call(const fn_call& fn)
         }
     }
 
+    // The implicit variables are only made for code that may use them.
+    const int uses = codeUses();
+
     // Add 'this'
-    setLocal(cf, NSV::PROP_THIS, fn.this_ptr ? fn.this_ptr : as_value());
+    if (uses & USES_THIS) {
+        setLocal(cf, NSV::PROP_THIS, fn.this_ptr ? fn.this_ptr : as_value());
+    }
 
     as_object* super = fn.super ? fn.super :
         fn.this_ptr ? fn.this_ptr->get_super() : nullptr;
 
     // Add 'super' (SWF6+ only)
-    if (super && swfversion > 5) {
+    if (super && swfversion > 5 && (uses & USES_SUPER)) {
         setLocal(cf, NSV::PROP_SUPER, super);
     }
 
-    // Add 'arguments'
-    as_object* args = getGlobal(fn).createArray();
+    if (uses & USES_ARGUMENTS) {
+        // Add 'arguments'
+        as_object* args = getGlobal(fn).createArray();
 
-    // Put 'arguments' in a local var.
-    setLocal(cf, NSV::PROP_ARGUMENTS, getArguments(*this, *args, fn, caller));
+        // Put 'arguments' in a local var.
+        setLocal(cf, NSV::PROP_ARGUMENTS,
+                getArguments(*this, *args, fn, caller));
+    }
 
     // Execute the actions.
     as_value result;
@@ -151,6 +168,17 @@ Function::setLength(size_t len)
 {
     assert(_startPC + len <= _action_buffer.size());
     _length = len;
+    _codeUses = -1;
+}
+
+int
+Function::codeUses() const
+{
+    if (_codeUses < 0) {
+        _codeUses = scanCode(_action_buffer, _startPC, _startPC + _length,
+                _pool);
+    }
+    return _codeUses;
 }
 
 void
@@ -180,5 +208,434 @@ getArguments(Function& callee, as_object& args, const fn_call& fn,
 
 }
 
+namespace {
+
+/// The implicit variables a string may name, alone or in a path.
+//
+/// Names are compared without case, as in SWF6 and below.
+int
+namedIn(const std::string& str)
+{
+    const std::string s = boost::to_lower_copy(str);
+    int uses = 0;
+    if (s.find("arguments") != std::string::npos) {
+        uses |= Function::USES_ARGUMENTS;
+    }
+    if (s.find("this") != std::string::npos) uses |= Function::USES_THIS;
+    if (s.find("super") != std::string::npos) uses |= Function::USES_SUPER;
+    return uses;
+}
+
+/// What the scan knows of a value on the stack.
+enum StackValue
+{
+    /// Made by the code at runtime.
+    VALUE_UNKNOWN = -2,
+
+    /// Pushed by the code, but not a count.
+    VALUE_PUSHED = -1
+
+    // Pushed counts are kept as they are.
+};
+
+/// The stack position of the variable name or target path an action uses.
+//
+/// @return     The position of the name from the top, or -1 if the
+///             action uses none.
+int
+nameDepth(std::uint8_t opcode)
+{
+    switch (opcode) {
+        case SWF::ACTION_GETVARIABLE:
+        case SWF::ACTION_CALLFUNCTION:
+        case SWF::ACTION_NEW:
+        case SWF::ACTION_DELETE2:
+        case SWF::ACTION_ENUMERATE:
+        case SWF::ACTION_SETTARGETEXPRESSION:
+        case SWF::ACTION_REMOVECLIP:
+        case SWF::ACTION_STARTDRAGMOVIE:
+        case SWF::ACTION_GOTOEXPRESSION:
+        case SWF::ACTION_CALLFRAME:
+        case SWF::ACTION_GETURL2:
+        case SWF::ACTION_WAITFORFRAMEEXPRESSION:
+            return 0;
+        case SWF::ACTION_SETVARIABLE:
+        case SWF::ACTION_GETPROPERTY:
+            return 1;
+        case SWF::ACTION_SETPROPERTY:
+        case SWF::ACTION_DUPLICATECLIP:
+            return 2;
+        default:
+            // ActionVar and ActionVarEquals always set a local variable,
+            // whatever its name.
+            return -1;
+    }
+}
+
+/// The number of values an action pops and pushes, if always the same.
+bool
+stackEffect(std::uint8_t opcode, size_t& pops, size_t& pushes)
+{
+    pops = 0;
+    pushes = 0;
+    switch (opcode) {
+        case SWF::ACTION_NEXTFRAME:
+        case SWF::ACTION_PREVFRAME:
+        case SWF::ACTION_PLAY:
+        case SWF::ACTION_STOP:
+        case SWF::ACTION_TOGGLEQUALITY:
+        case SWF::ACTION_STOPSOUNDS:
+        case SWF::ACTION_STOPDRAGMOVIE:
+        case SWF::ACTION_GOTOFRAME:
+        case SWF::ACTION_GETURL:
+        case SWF::ACTION_SETTARGET:
+        case SWF::ACTION_GOTOLABEL:
+        case SWF::ACTION_SETREGISTER:
+        case SWF::ACTION_STRICTMODE:
+            return true;
+        case SWF::ACTION_GETTIMER:
+            pushes = 1;
+            return true;
+        case SWF::ACTION_LOGICALNOT:
+        case SWF::ACTION_STRINGLENGTH:
+        case SWF::ACTION_INT:
+        case SWF::ACTION_GETVARIABLE:
+        case SWF::ACTION_RANDOM:
+        case SWF::ACTION_MBLENGTH:
+        case SWF::ACTION_ORD:
+        case SWF::ACTION_CHR:
+        case SWF::ACTION_MBORD:
+        case SWF::ACTION_MBCHR:
+        case SWF::ACTION_DELETE2:
+        case SWF::ACTION_TYPEOF:
+        case SWF::ACTION_TARGETPATH:
+        case SWF::ACTION_TONUMBER:
+        case SWF::ACTION_TOSTRING:
+        case SWF::ACTION_INCREMENT:
+        case SWF::ACTION_DECREMENT:
+            pops = 1;
+            pushes = 1;
+            return true;
+        case SWF::ACTION_ADD:
+        case SWF::ACTION_SUBTRACT:
+        case SWF::ACTION_MULTIPLY:
+        case SWF::ACTION_DIVIDE:
+        case SWF::ACTION_EQUAL:
+        case SWF::ACTION_LESSTHAN:
+        case SWF::ACTION_LOGICALAND:
+        case SWF::ACTION_LOGICALOR:
+        case SWF::ACTION_STRINGEQ:
+        case SWF::ACTION_STRINGCONCAT:
+        case SWF::ACTION_GETPROPERTY:
+        case SWF::ACTION_STRINGCOMPARE:
+        case SWF::ACTION_CASTOP:
+        case SWF::ACTION_DELETE:
+        case SWF::ACTION_MODULO:
+        case SWF::ACTION_NEWADD:
+        case SWF::ACTION_NEWLESSTHAN:
+        case SWF::ACTION_NEWEQUALS:
+        case SWF::ACTION_GETMEMBER:
+        case SWF::ACTION_INSTANCEOF:
+        case SWF::ACTION_BITWISEAND:
+        case SWF::ACTION_BITWISEOR:
+        case SWF::ACTION_BITWISEXOR:
+        case SWF::ACTION_SHIFTLEFT:
+        case SWF::ACTION_SHIFTRIGHT:
+        case SWF::ACTION_SHIFTRIGHT2:
+        case SWF::ACTION_STRICTEQ:
+        case SWF::ACTION_GREATER:
+        case SWF::ACTION_STRINGGREATER:
+            pops = 2;
+            pushes = 1;
+            return true;
+        case SWF::ACTION_SUBSTRING:
+        case SWF::ACTION_MBSUBSTRING:
+            pops = 3;
+            pushes = 1;
+            return true;
+        case SWF::ACTION_POP:
+        case SWF::ACTION_SETTARGETEXPRESSION:
+        case SWF::ACTION_REMOVECLIP:
+        case SWF::ACTION_TRACE:
+        case SWF::ACTION_VAR:
+        case SWF::ACTION_BRANCHIFTRUE:
+        case SWF::ACTION_CALLFRAME:
+        case SWF::ACTION_GOTOEXPRESSION:
+            pops = 1;
+            return true;
+        case SWF::ACTION_SETVARIABLE:
+        case SWF::ACTION_VAREQUALS:
+        case SWF::ACTION_EXTENDS:
+        case SWF::ACTION_GETURL2:
+            pops = 2;
+            return true;
+        case SWF::ACTION_SETPROPERTY:
+        case SWF::ACTION_DUPLICATECLIP:
+        case SWF::ACTION_SETMEMBER:
+            pops = 3;
+            return true;
+        default:
+            return false;
+    }
+}
+
+/// Find what the code between start and end may refer to.
+//
+/// Variable names are usually pushed as strings or constants, which
+/// are all looked at. The scan follows the stack through each run of
+/// actions to check that every name an action uses is one of them: a
+/// name made at runtime, or one it can't follow, is taken to be
+/// anything. This looks at the code of nested functions too, which may
+/// see the variables of this one.
+int
+scanCode(const action_buffer& code, size_t start, size_t end,
+        const ConstantPool* pool)
+{
+    size_t index;
+    if (!code.findDecodedAction(start, index)) return Function::USES_ALL;
+
+    const action_buffer::DecodedActions& actions = code.decodedActions();
+
+    int uses = 0;
+
+    // The constants pushed, and the pools they may come from.
+    std::vector<size_t> constants;
+    std::vector<std::vector<int> > pools;
+
+    // The top of the stack as far as the scan knows it; what is below
+    // is unknown.
+    std::vector<int> stack;
+
+    try {
+
+        // Actions reached other than from the one before may find
+        // anything on the stack: jump targets, catch and finally blocks,
+        // and what follows the code of a nested function.
+        std::vector<size_t> entries;
+        for (size_t i = index; i < actions.size() && actions[i].pc < end;
+                ++i) {
+            const DecodedAction& action = actions[i];
+            const size_t next = action.nextPC;
+            switch (action.opcode) {
+                case SWF::ACTION_BRANCHALWAYS:
+                case SWF::ACTION_BRANCHIFTRUE:
+                    entries.push_back(next + action.branchOffset);
+                    break;
+                case SWF::ACTION_TRY:
+                {
+                    const size_t tryEnd = next +
+                        code.read_uint16(action.pc + 4);
+                    entries.push_back(tryEnd);
+                    entries.push_back(tryEnd +
+                            code.read_uint16(action.pc + 6));
+                    break;
+                }
+                case SWF::ACTION_DEFINEFUNCTION:
+                case SWF::ACTION_DEFINEFUNCTION2:
+                    entries.push_back(next + code.read_uint16(next - 2));
+                    break;
+                default:
+                    break;
+            }
+        }
+        std::sort(entries.begin(), entries.end());
+
+        // Code jumped to inside the data of another action isn't scanned.
+        for (size_t pc : entries) {
+            size_t found;
+            if (pc >= start && pc < end && !code.findDecodedAction(pc, found)) {
+                return Function::USES_ALL;
+            }
+        }
+
+        // Nor is code after an action that couldn't be decoded.
+        size_t reached = start;
+
+        for (; index < actions.size() && actions[index].pc < end; ++index) {
+
+            const DecodedAction& action = actions[index];
+            const size_t data = action.pc + 3;
+            const size_t next = action.nextPC;
+            reached = next;
+
+            if (std::binary_search(entries.begin(), entries.end(),
+                        action.pc)) {
+                stack.clear();
+            }
+
+            const int depth = nameDepth(action.opcode);
+            if (depth >= 0 && (stack.size() <= static_cast<size_t>(depth) ||
+                    stack[stack.size() - 1 - depth] == VALUE_UNKNOWN)) {
+                return Function::USES_ALL;
+            }
+
+            if (action.opcode == SWF::ACTION_VAR ||
+                    action.opcode == SWF::ACTION_VAREQUALS) {
+                uses |= Function::USES_ACTIVATION;
+            }
+
+            // Actions popping a count and the values counted, below
+            // any name and object.
+            size_t above = 0;
+            size_t slots = 1;
+            bool counts = true;
+            switch (action.opcode) {
+                case SWF::ACTION_CALLFUNCTION:
+                case SWF::ACTION_NEW:
+                    above = 1;
+                    break;
+                case SWF::ACTION_CALLMETHOD:
+                case SWF::ACTION_NEWMETHOD:
+                    above = 2;
+                    break;
+                case SWF::ACTION_INITARRAY:
+                    break;
+                case SWF::ACTION_INITOBJECT:
+                    slots = 2;
+                    break;
+                default:
+                    counts = false;
+                    break;
+            }
+            if (counts) {
+                const int count = stack.size() > above ?
+                    stack[stack.size() - 1 - above] : VALUE_UNKNOWN;
+                if (count < 0 || stack.size() < above + 1 + count * slots) {
+                    stack.clear();
+                }
+                else stack.resize(stack.size() - above - 1 - count * slots);
+                stack.push_back(VALUE_UNKNOWN);
+                continue;
+            }
+
+            size_t pops, pushes;
+            if (stackEffect(action.opcode, pops, pushes)) {
+                stack.resize(stack.size() > pops ? stack.size() - pops : 0);
+                stack.insert(stack.end(), pushes, VALUE_UNKNOWN);
+                continue;
+            }
+
+            switch (action.opcode) {
+                case SWF::ACTION_PUSHDATA:
+                    for (size_t i = data; i < next;) {
+                        int value = VALUE_PUSHED;
+                        double number = -1;
+                        switch (code[i++]) {
+                            case 0:
+                            {
+                                const std::string s(code.read_string(i));
+                                uses |= namedIn(s);
+                                i += s.size() + 1;
+                                break;
+                            }
+                            case 1:
+                                number = code.read_float_little(i);
+                                i += 4;
+                                break;
+                            case 2:
+                            case 3:
+                                break;
+                            case 4:
+                                // A register could hold anything.
+                                value = VALUE_UNKNOWN;
+                                ++i;
+                                break;
+                            case 5:
+                                ++i;
+                                break;
+                            case 6:
+                                number = code.read_double_wacky(i);
+                                i += 8;
+                                break;
+                            case 7:
+                                number = code.read_int32(i);
+                                i += 4;
+                                break;
+                            case 8:
+                                constants.push_back(code[i]);
+                                ++i;
+                                break;
+                            case 9:
+                                constants.push_back(code.read_uint16(i));
+                                i += 2;
+                                break;
+                            default:
+                                return Function::USES_ALL;
+                        }
+                        if (number >= 0 && number < 0x10000 &&
+                                number == static_cast<int>(number)) {
+                            value = static_cast<int>(number);
+                        }
+                        stack.push_back(value);
+                    }
+                    break;
+
+                case SWF::ACTION_DUP:
+                    stack.push_back(stack.empty() ? VALUE_UNKNOWN :
+                            stack.back());
+                    break;
+
+                case SWF::ACTION_SWAP:
+                    if (stack.size() < 2) stack.clear();
+                    else std::swap(stack.back(), stack[stack.size() - 2]);
+                    break;
+
+                case SWF::ACTION_CONSTANTPOOL:
+                {
+                    // Read here rather than with readConstantPool(), which
+                    // would change the pool used in disassembly.
+                    const size_t count = code.read_uint16(data);
+                    pools.push_back(std::vector<int>());
+                    for (size_t i = data + 2; i < next &&
+                            pools.back().size() < count;) {
+                        const std::string s(code.read_string(i));
+                        pools.back().push_back(namedIn(s));
+                        i += s.size() + 1;
+                    }
+                    break;
+                }
+
+                case SWF::ACTION_DEFINEFUNCTION:
+                case SWF::ACTION_DEFINEFUNCTION2:
+                    // The function name is set as a variable.
+                    uses |= namedIn(code.read_string(data));
+                    uses |= Function::USES_ACTIVATION;
+                    stack.clear();
+                    break;
+
+                case SWF::ACTION_TRY:
+                    // The exception is set as a local variable.
+                    if (!(code[data] & 4)) {
+                        uses |= namedIn(code.read_string(data + 7));
+                    }
+                    uses |= Function::USES_ACTIVATION;
+                    stack.clear();
+                    break;
+
+                default:
+                    // Jumps, returns, and actions popping as many values
+                    // as they find.
+                    stack.clear();
+                    break;
+            }
+        }
+        if (reached < end) return Function::USES_ALL;
+    }
+    catch (const ActionParserException&) {
+        return Function::USES_ALL;
+    }
+
+    for (size_t c : constants) {
+        // Read the text, so scanning makes no SharedStrings.
+        if (pool && c < pool->size()) uses |= namedIn(pool->c_str(c));
+        for (const std::vector<int>& p : pools) {
+            if (c < p.size()) uses |= p[c];
+        }
+    }
+    return uses;
+}
+
+} // anonymous namespace
+
 } // end of gnash namespace
 
@@ -119,6 +119,34 @@ public:
 	/// Dispatch.
 	virtual as_value call(const fn_call& fn);
 
+    /// What the code of a function may refer to.
+    enum CodeUse
+    {
+        /// The 'arguments' variable.
+        USES_ARGUMENTS = 0x01,
+
+        /// The 'this' variable.
+        USES_THIS = 0x02,
+
+        /// The 'super' variable.
+        USES_SUPER = 0x04,
+
+        /// Local variables it declares, or functions it defines that
+        /// may see them.
+        USES_ACTIVATION = 0x08,
+
+        USES_ALL = 0x0f
+    };
+
+    /// Return what the code of the function may refer to.
+    //
+    /// The code is scanned when this is first called. Any name the
+    /// code makes at runtime, rather than pushing it, could be any
+    /// variable, so such code is taken to use everything.
+    //
+    /// @return     A combination of CodeUse flags.
+    int codeUses() const;
+
 	/// Mark reachable resources. Override from as_object
 	//
 	/// Reachable resources from this object are its scope stack
@@ -127,6 +155,9 @@ public:
 	virtual void markReachableResources() const;
 
 protected:
+
+    /// The environment changes its references without a write barrier.
+    virtual bool hasWriteBarrier() const { return false; }
 	
     struct Argument
 	{
@@ -163,6 +194,9 @@ private:
 	/// to a DoAction block
 	size_t _length;
 
+    /// The CodeUse flags, or -1 until the code is scanned.
+    mutable int _codeUses;
+
 };
 
 /// Add properties to an 'arguments' object.
@@ -89,6 +89,10 @@ Function2::call(const fn_call& fn)
 
     // function2: most args go in registers; any others get pushed.
 
+    // Variables the flags don't suppress are only made for code that may
+    // use them.
+    const int uses = codeUses();
+
     // Handle the implicit args.
     // @@ why start at 1 ? Note that starting at 0 makes	
     // intro.swf movie fail to play correctly.
@@ -107,7 +111,7 @@ Function2::call(const fn_call& fn)
             cf.setLocalRegister(current_reg, fn.this_ptr); 
             ++current_reg;
         }
-        else {
+        else if (uses & USES_THIS) {
             // Put 'this' in a local var.
             setLocal(cf, NSV::PROP_THIS,
                     fn.this_ptr ? fn.this_ptr : as_value());
@@ -119,7 +123,8 @@ Function2::call(const fn_call& fn)
     // local variable, but if both preload and suppress arguments flags
     // are set, an empty array is still placed to the register.
     // This seems like a bug in the reference player.
-    if (!(_function2Flags & SUPPRESS_ARGUMENTS) ||
+    if ((!(_function2Flags & SUPPRESS_ARGUMENTS) &&
+                (uses & USES_ARGUMENTS)) ||
             (_function2Flags & PRELOAD_ARGUMENTS)) {
         
         as_object* args = getGlobal(fn).createArray();
@@ -153,7 +158,7 @@ Function2::call(const fn_call& fn)
             cf.setLocalRegister(current_reg, super);
             current_reg++;
         }
-        else if (super) {
+        else if (super && (uses & USES_SUPER)) {
             setLocal(cf, NSV::PROP_SUPER, super);
         }
     }
@@ -0,0 +1,249 @@
+// MouseIndex.cpp: DisplayObjects of a DisplayList by their bounds.
+//
+//   Copyright (C) 2005, 2006, 2007, 2008, 2009, 2010, 2011, 2012
+//   Free Software Foundation, Inc
+//
+// This program is free software; you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation; either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program; if not, write to the Free Software
+// Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+
+#include "MouseIndex.h"
+
+#include <algorithm>
+#include <cstdint>
+
+#include "DisplayObject.h"
+
+namespace gnash {
+
+namespace {
+
+/// The most entries in a leaf.
+const size_t leafSize = 4;
+
+bool
+near(const SWFRect& r, double x, double y, double margin)
+{
+    return x + margin >= r.get_x_min() && x - margin <= r.get_x_max() &&
+        y + margin >= r.get_y_min() && y - margin <= r.get_y_max();
+}
+
+bool
+same(const SWFRect& a, const SWFRect& b)
+{
+    if (a.is_null() || b.is_null()) return a.is_null() == b.is_null();
+    return a.get_x_min() == b.get_x_min() && a.get_x_max() == b.get_x_max() &&
+        a.get_y_min() == b.get_y_min() && a.get_y_max() == b.get_y_max();
+}
+
+}
+
+void
+MouseIndex::build(const std::list<DisplayObject*>& chars)
+{
+    _entries.clear();
+    _nodes.clear();
+    _always.clear();
+    _positions.clear();
+    _changed.clear();
+    _bounds.set_null();
+
+    bool world = false;
+    size_t order = 0;
+    for (DisplayObject* ch : chars) {
+        Entry e;
+        e.order = order++;
+        e.object = ch;
+        e.leaf = 0;
+        e.changed = false;
+
+        const SWFRect b = ch->getMouseBounds();
+        if (b.is_world()) {
+            world = true;
+            _always.push_back(e);
+            continue;
+        }
+        e.bounds.expand_to_transformed_rect(getMatrix(*ch), b);
+        _bounds.expand_to_rect(e.bounds);
+
+        if (ch->isMaskLayer()) _always.push_back(e);
+        else if (!e.bounds.is_null()) _entries.push_back(e);
+    }
+    if (world) _bounds.set_world();
+
+    _alwaysBounds.set_null();
+    for (const Entry& e : _always) _alwaysBounds.expand_to_rect(e.bounds);
+    if (world) _alwaysBounds.set_world();
+
+    if (!_entries.empty()) buildNode(0, _entries.size(), 0);
+    for (size_t i = 0; i < _entries.size(); ++i) {
+        _positions[_entries[i].object] = i;
+    }
+    _valid = true;
+}
+
+bool
+MouseIndex::changed(const DisplayObject& ch)
+{
+    // An index not built reads all bounds when it is.
+    if (!_valid) return true;
+
+    const std::unordered_map<const DisplayObject*, size_t>::const_iterator
+        it = _positions.find(&ch);
+
+    // Masks and DisplayObjects without bounds aren't in the hierarchy.
+    if (it == _positions.end()) {
+        _valid = false;
+        return true;
+    }
+
+    Entry& e = _entries[it->second];
+    if (e.changed) return false;
+    e.changed = true;
+    _changed.push_back(it->second);
+    return true;
+}
+
+void
+MouseIndex::refit()
+{
+    if (!_valid || _changed.empty()) return;
+
+    std::vector<size_t> changed;
+    changed.swap(_changed);
+
+    for (size_t i : changed) {
+        Entry& e = _entries[i];
+        e.changed = false;
+
+        const SWFRect b = e.object->getMouseBounds();
+        if (b.is_null() || b.is_world() || e.object->isMaskLayer()) {
+            _valid = false;
+            return;
+        }
+
+        SWFRect bounds;
+        bounds.expand_to_transformed_rect(getMatrix(*e.object), b);
+        if (same(bounds, e.bounds)) continue;
+
+        e.bounds = bounds;
+        refitNode(e.leaf);
+    }
+
+    _bounds = _alwaysBounds;
+    _bounds.expand_to_rect(_nodes.front().bounds);
+}
+
+void
+MouseIndex::refitNode(size_t index)
+{
+    for (;;) {
+        Node& node = _nodes[index];
+
+        SWFRect bounds;
+        if (node.count) {
+            for (size_t i = node.next, e = i + node.count; i != e; ++i) {
+                bounds.expand_to_rect(_entries[i].bounds);
+            }
+        }
+        else {
+            bounds = _nodes[index + 1].bounds;
+            bounds.expand_to_rect(_nodes[node.next].bounds);
+        }
+
+        if (same(bounds, node.bounds)) return;
+        node.bounds = bounds;
+
+        if (node.parent == index) return;
+        index = node.parent;
+    }
+}
+
+size_t
+MouseIndex::buildNode(size_t begin, size_t end, size_t parent)
+{
+    const size_t index = _nodes.size();
+    _nodes.push_back(Node());
+    _nodes[index].parent = parent;
+
+    SWFRect bounds;
+    for (size_t i = begin; i < end; ++i) {
+        bounds.expand_to_rect(_entries[i].bounds);
+    }
+
+    if (end - begin <= leafSize) {
+        Node& leaf = _nodes[index];
+        leaf.bounds = bounds;
+        leaf.next = begin;
+        leaf.count = end - begin;
+        for (size_t i = begin; i < end; ++i) _entries[i].leaf = index;
+        return index;
+    }
+
+    // Split at the middle of the centres along the longer side.
+    const bool wide = bounds.width() >= bounds.height();
+    const size_t middle = begin + (end - begin) / 2;
+    std::nth_element(_entries.begin() + begin, _entries.begin() + middle,
+            _entries.begin() + end, [wide](const Entry& a, const Entry& b) {
+        return wide ?
+            std::int64_t(a.bounds.get_x_min()) + a.bounds.get_x_max() <
+            std::int64_t(b.bounds.get_x_min()) + b.bounds.get_x_max() :
+            std::int64_t(a.bounds.get_y_min()) + a.bounds.get_y_max() <
+            std::int64_t(b.bounds.get_y_min()) + b.bounds.get_y_max();
+    });
+
+    buildNode(begin, middle, index);
+    const size_t second = buildNode(middle, end, index);
+
+    Node& inner = _nodes[index];
+    inner.bounds = bounds;
+    inner.next = second;
+    inner.count = 0;
+    return index;
+}
+
+void
+MouseIndex::find(double x, double y, double margin,
+        std::vector<DisplayObject*>& found) const
+{
+    std::vector<const Entry*> hits;
+    for (const Entry& e : _always) hits.push_back(&e);
+
+    if (!_nodes.empty()) {
+        std::vector<size_t> pending(1, 0);
+        while (!pending.empty()) {
+            const size_t i = pending.back();
+            pending.pop_back();
+            const Node& node = _nodes[i];
+            if (!near(node.bounds, x, y, margin)) continue;
+
+            if (!node.count) {
+                pending.push_back(node.next);
+                pending.push_back(i + 1);
+                continue;
+            }
+            for (size_t j = node.next, e = j + node.count; j != e; ++j) {
+                if (near(_entries[j].bounds, x, y, margin)) {
+                    hits.push_back(&_entries[j]);
+                }
+            }
+        }
+    }
+
+    std::sort(hits.begin(), hits.end(), [](const Entry* a, const Entry* b) {
+        return a->order < b->order;
+    });
+    for (const Entry* e : hits) found.push_back(e->object);
+}
+
+} // namespace gnash
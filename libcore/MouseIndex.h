@@ -0,0 +1,161 @@
+// MouseIndex.h: DisplayObjects of a DisplayList by their bounds.
+//
+//   Copyright (C) 2005, 2006, 2007, 2008, 2009, 2010, 2011, 2012
+//   Free Software Foundation, Inc
+//
+// This program is free software; you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation; either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program; if not, write to the Free Software
+// Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+
+#ifndef GNASH_MOUSEINDEX_H
+#define GNASH_MOUSEINDEX_H
+
+#include <cstddef>
+#include <list>
+#include <unordered_map>
+#include <vector>
+
+#include "SWFRect.h"
+
+// Forward declarations
+namespace gnash {
+    class DisplayObject;
+}
+
+namespace gnash {
+
+/// The DisplayObjects of a DisplayList by their bounds, to find those
+/// that may be under the mouse without looking at all of them.
+//
+/// Bounds are those of DisplayObject::getMouseBounds(), in the space of
+/// the DisplayList's owner, so moving the owner or its parents doesn't
+/// change them. A DisplayObject that may change tells its parent with
+/// DisplayObject::boundsChanged(), which marks its entry; refit() reads
+/// the bounds of marked entries again, and only updates the hierarchy
+/// above those that really changed. Adding or removing DisplayObjects
+/// drops the whole index, which is built again when next used.
+///
+/// The bounds are kept in a bounding volume hierarchy, so finding what
+/// contains a point takes logarithmic time.
+class MouseIndex
+{
+public:
+
+    MouseIndex() : _valid(false) {}
+
+    /// Forget the DisplayObjects, until build() is called again.
+    void clear() { _valid = false; }
+
+    bool valid() const { return _valid; }
+
+    /// Index DisplayObjects.
+    //
+    /// @param chars    The DisplayObjects, in depth order.
+    void build(const std::list<DisplayObject*>& chars);
+
+    /// Note that the bounds of a DisplayObject may have changed.
+    //
+    /// @return false if it was already noted and not refitted since,
+    ///         so the owner's parents know already too.
+    bool changed(const DisplayObject& ch);
+
+    /// Read the bounds of changed DisplayObjects again.
+    //
+    /// If one can't be refitted in place, for instance because it
+    /// became a mask, the index is dropped and must be built again.
+    void refit();
+
+    /// Append the DisplayObjects that may be hit at a point.
+    //
+    /// These are all masks, which hide what they mask when they aren't
+    /// hit, and the DisplayObjects whose bounds contain the point. They
+    /// come in depth order.
+    ///
+    /// @param margin   Twips added around bounds, so that rounding
+    ///                 doesn't lose a DisplayObject at the edge.
+    void find(double x, double y, double margin,
+            std::vector<DisplayObject*>& found) const;
+
+    /// The union of all bounds, masks included.
+    const SWFRect& bounds() const { return _bounds; }
+
+private:
+
+    struct Entry
+    {
+        SWFRect bounds;
+
+        /// The position of the DisplayObject in depth order.
+        size_t order;
+
+        DisplayObject* object;
+
+        /// The leaf holding the entry.
+        size_t leaf;
+
+        /// Whether the entry is waiting for refit().
+        bool changed;
+    };
+
+    /// A node of the hierarchy.
+    //
+    /// An inner node is followed by its first child, and the second
+    /// is at next.
+    struct Node
+    {
+        SWFRect bounds;
+
+        /// The first entry of a leaf, or the second child.
+        size_t next;
+
+        /// The number of entries of a leaf, 0 for an inner node.
+        size_t count;
+
+        /// The parent node. The root is its own parent.
+        size_t parent;
+    };
+
+    /// Build the node for entries from begin to end.
+    //
+    /// @return The position of the node.
+    size_t buildNode(size_t begin, size_t end, size_t parent);
+
+    /// Update the bounds of a node and its parents after an entry
+    /// changed, up to the first that doesn't change.
+    void refitNode(size_t node);
+
+    bool _valid;
+
+    /// Entries with bounds, in the order of the leaves.
+    std::vector<Entry> _entries;
+
+    std::vector<Node> _nodes;
+
+    /// Masks, and entries without bounds that can't be left out.
+    std::vector<Entry> _always;
+
+    /// The union of the bounds of _always.
+    SWFRect _alwaysBounds;
+
+    /// The position in _entries of each indexed DisplayObject.
+    std::unordered_map<const DisplayObject*, size_t> _positions;
+
+    /// The entries waiting for refit().
+    std::vector<size_t> _changed;
+
+    SWFRect _bounds;
+};
+
+} // namespace gnash
+
+#endif
@@ -26,6 +26,7 @@
 
 #include <vector>
 #include <string>
+#include <cmath>
 #include <algorithm> // for std::swap
 #include <boost/algorithm/string/case_conv.hpp>
 #include <functional>
@@ -497,6 +498,36 @@ private:
     KeyVisitor& _v;
 };
 
+/// Transform a point to the local space of a SWFMatrix, for
+/// DisplayList::visitAt().
+//
+/// @param margin   Set to the twips to add around local bounds, so that
+///                 what is hit after rounding in other spaces is found.
+/// @return         false if the SWFMatrix squashes the local space too
+///                 much to find anything by bounds.
+bool
+localPoint(const SWFMatrix& m, double& x, double& y, double& margin)
+{
+    const double a = m.a() / 65536.0;
+    const double b = m.b() / 65536.0;
+    const double c = m.c() / 65536.0;
+    const double d = m.d() / 65536.0;
+
+    // The smallest scale of the SWFMatrix in any direction.
+    const double det = a * d - b * c;
+    const double sum = a * a + b * b + c * c + d * d;
+    const double scale = std::sqrt(std::max(0.0,
+                (sum - std::sqrt(std::max(0.0, sum * sum - 4 * det * det))) / 2));
+    if (scale < 1e-3) return false;
+
+    const double dx = x - m.tx();
+    const double dy = y - m.ty();
+    x = (d * dx - c * dy) / det;
+    y = (a * dy - b * dx) / det;
+    margin = 40 / std::min(scale, 1.0);
+    return true;
+}
+
 } // anonymous namespace
 
 
@@ -1501,7 +1532,11 @@ MovieClip::topmostMouseEntity(std::int32_t x, std::int32_t y)
     m.transform(pp);
 
     MouseEntityFinder finder(wp, pp);
-    _displayList.visitAll(finder);
+    double lx = x, ly = y, margin;
+    if (localPoint(getMatrix(*this), lx, ly, margin)) {
+        _displayList.visitAt(finder, lx, ly, margin);
+    }
+    else _displayList.visitAll(finder);
     InteractiveObject* ch = finder.getEntity();
 
     // It doesn't make any sense to query _drawable, as it's
@@ -1518,7 +1553,11 @@ MovieClip::findDropTarget(std::int32_t x, std::int32_t y,
     if (!visible()) return nullptr; // isn't me !
 
     DropTargetFinder finder(x, y, dragging);
-    _displayList.visitAll(finder);
+    double lx = x, ly = y, margin;
+    if (localPoint(getWorldMatrix(*this), lx, ly, margin)) {
+        _displayList.visitAt(finder, lx, ly, margin);
+    }
+    else _displayList.visitAll(finder);
 
     // does it hit any child ?
     const DisplayObject* ch = finder.getDropChar();
@@ -1972,6 +2011,14 @@ MovieClip::removeMovieClip()
 
 }
 
+SWFRect
+MovieClip::getMouseBounds() const
+{
+    SWFRect bounds = _displayList.mouseBounds();
+    bounds.expand_to_rect(_drawable.getBounds());
+    return bounds;
+}
+
 SWFRect
 MovieClip::getBounds() const
 {
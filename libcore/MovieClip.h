@@ -145,6 +145,9 @@ public:
     /// Get the composite bounds of all component drawing elements
     virtual SWFRect getBounds() const;
 
+    // See dox in DisplayObject.h
+    virtual SWFRect getMouseBounds() const;
+
     // See dox in DisplayObject.h
     virtual bool pointInShape(std::int32_t x, std::int32_t y) const;
 
@@ -618,6 +621,11 @@ protected:
     /// Return true if there was an unloadHandler.
     virtual bool unloadChildren();
 
+    // See dox in DisplayObject.h
+    virtual bool childBoundsChanged(const DisplayObject& ch) {
+        return _displayList.childBoundsChanged(ch);
+    }
+
     /// Mark sprite-specific reachable resources.
     //
     /// sprite-specific reachable resources are:
@@ -194,8 +194,9 @@ getFileType(IOChannel& in)
         return GNASH_FILETYPE_GIF;
     }
 
-    // This is for SWF (FWS or CWS)
-    if (std::equal(buf, buf + 3, "FWS") || std::equal(buf, buf + 3, "CWS")) {
+    // This is for SWF (FWS, CWS or ZWS)
+    if (std::equal(buf, buf + 3, "FWS") || std::equal(buf, buf + 3, "CWS")
+            || std::equal(buf, buf + 3, "ZWS")) {
         in.seek(0);
         return GNASH_FILETYPE_SWF;
     }
@@ -214,7 +215,8 @@ getFileType(IOChannel& in)
             return GNASH_FILETYPE_UNKNOWN;
         }
 
-        while ((buf[0]!='F' && buf[0]!='C') || buf[1]!='W' || buf[2]!='S') {
+        while ((buf[0]!='F' && buf[0]!='C' && buf[0]!='Z') ||
+                buf[1]!='W' || buf[2]!='S') {
             buf[0] = buf[1];
             buf[1] = buf[2];
             buf[2] = in.read_byte();
@@ -22,6 +22,7 @@
 #include <functional>
 
 #include "VM.h"
+#include "movie_root.h"
 #include "as_function.h"
 #include "as_environment.h"
 #include "fn_call.h"
@@ -112,6 +113,7 @@ Property::getValue(const as_object& this_ptr) const
                 // The getter might have called the setter, and we
                 // should not override.
                 if (_destructive) {
+                    getRoot(this_ptr).gc().writeBarrier(ret);
                     _bound = ret;
                     _destructive = false;
                 }
@@ -132,6 +134,10 @@ Property::getCache() const
 bool
 Property::setValue(as_object& this_ptr, const as_value& value) const
 {
+    // The value may be stored here, or as the cache of a getter-setter,
+    // which may be inherited.
+    getRoot(this_ptr).gc().writeBarrier(value);
+
     if (readOnly(*this)) {
         if (_destructive) {
             _destructive = false;
@@ -22,6 +22,7 @@
 
 #include <boost/variant.hpp>
 #include <cassert>
+#include <cstdint>
 #include <functional>
 #include <typeinfo>
 
@@ -289,13 +290,17 @@ class Property
 
 public:
 
+    /// The slot of a property that isn't described by a shape.
+    static const std::uint32_t noSlot = 0xffffffff;
+
 	Property(ObjectURI uri, const as_value& value,
             PropFlags flags)
         :
         _bound(value),
 		_uri(std::move(uri)),
 		_flags(std::move(flags)),
-        _destructive(false)
+        _destructive(false),
+        _slot(noSlot)
 	{}
 
 	Property(ObjectURI uri,
@@ -305,7 +310,8 @@ public:
         _bound(GetterSetter(getter, setter)),
         _uri(std::move(uri)),
 		_flags(std::move(flags)), 
-		_destructive(destroy)
+		_destructive(destroy),
+        _slot(noSlot)
 	{}
 
 	Property(ObjectURI uri, as_c_function_ptr getter,
@@ -315,7 +321,8 @@ public:
         _bound(GetterSetter(getter, setter)),
         _uri(std::move(uri)),
 		_flags(std::move(flags)),
-        _destructive(destroy)
+        _destructive(destroy),
+        _slot(noSlot)
 	{}
 
 	/// accessor to the properties flags
@@ -326,6 +333,14 @@ public:
         _flags = flags;
     }
 
+    /// The slot of this property in its PropertyList's shape.
+    std::uint32_t slot() const { return _slot; }
+
+    /// Set the slot of this property in its PropertyList's shape.
+    void setSlot(std::uint32_t slot) const {
+        _slot = slot;
+    }
+
 	/// Get value of this property
 	//
 	/// @param this_ptr
@@ -353,6 +368,8 @@ public:
 	/// to watch for infinitely recurse on calling the getter
 	/// or setter; Native getter-setter has no cache,
 	/// nothing would happen for them.
+	///
+	/// The caller must pass the value to GC::writeBarrier().
 	void setCache(const as_value& v);
 
 	/// Set value of this property
@@ -410,6 +427,9 @@ private:
 	// overwritten if not readOnly)
 	mutable bool _destructive;
 
+    /// The slot of the property in the PropertyList's shape, or noSlot.
+    mutable std::uint32_t _slot;
+
 };
 	
 /// is this a read-only member ?
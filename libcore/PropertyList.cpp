@@ -34,6 +34,7 @@
 #include "as_function.h"
 #include "as_value.h" 
 #include "VM.h" 
+#include "movie_root.h"
 #include "string_table.h"
 #include "GnashAlgorithm.h"
 
@@ -70,6 +71,20 @@ iterator_find(const PropertyList::container& p, const ObjectURI& uri, VM& vm)
             p.get<PropertyList::NoCase>().find(uri));
 }
 
+/// Whether a property name is an array index.
+//
+/// Arrays get their elements in no fixed order, so these don't go into
+/// shapes.
+inline bool
+isIndexName(const std::string& name)
+{
+    if (name.empty()) return false;
+    for (char c : name) {
+        if (c < '0' || c > '9') return false;
+    }
+    return true;
+}
+
 }
     
 PropertyList::PropertyList(as_object& obj)
@@ -86,6 +101,7 @@ PropertyList::PropertyList(as_object& obj)
                 )
             )
         ),
+    _shape(PropertyShape::empty()),
     _owner(obj)
 {
 }
@@ -100,7 +116,7 @@ PropertyList::setValue(const ObjectURI& uri, const as_value& val,
 		// create a new member
 		Property a(uri, val, flagsIfMissing);
 		// Non slot properties are negative ordering in insertion order
-		_props.push_back(a);
+		append(a);
 #ifdef GNASH_DEBUG_PROPERTY
         ObjectURI::Logger l(getStringTable(_owner));
         log_debug("Simple AS property %s inserted with flags %s",
@@ -150,6 +166,26 @@ PropertyList::getProperty(const ObjectURI& uri) const
 	return const_cast<Property*>(&(*found));
 }
 
+Property*
+PropertyList::updateCache(const ObjectURI& uri, PropertyCache& cache) const
+{
+    if (!cache.active() || !_shape) return nullptr;
+    ++cache.misses;
+
+    const container::index<Case>::type& idx = _props.get<Case>();
+    container::index<Case>::type::const_iterator found = idx.find(uri);
+    if (found == idx.end()) return nullptr;
+
+    const Property* prop = &(*found);
+    if (prop->slot() == Property::noSlot) return const_cast<Property*>(prop);
+    assert(_slots[prop->slot()] == prop);
+
+    cache.shape = _shape->id();
+    cache.name = getName(uri);
+    cache.slot = prop->slot();
+    return const_cast<Property*>(prop);
+}
+
 std::pair<bool,bool>
 PropertyList::delProperty(const ObjectURI& uri)
 {
@@ -165,6 +201,11 @@ PropertyList::delProperty(const ObjectURI& uri)
 	}
 
 	_props.erase(found);
+
+    // Slots can't be reused, so the list has no layout any more.
+    _shape.reset();
+    _slots.clear();
+
 	return std::make_pair(true, true);
 }
 
@@ -206,6 +247,8 @@ PropertyList::addGetterSetter(const ObjectURI& uri, as_function& getter,
 		// copy flags from previous member (even if it's a normal member ?)
 		a.setFlags(found->getFlags());
 		a.setCache(found->getCache());
+		a.setSlot(found->slot());
+		getRoot(_owner).gc().writeBarrier(a);
 		_props.replace(found, a);
 
 #ifdef GNASH_DEBUG_PROPERTY
@@ -217,7 +260,7 @@ PropertyList::addGetterSetter(const ObjectURI& uri, as_function& getter,
 	}
 	else {
 		a.setCache(cacheVal);
-		_props.push_back(a);
+		append(a);
 #ifdef GNASH_DEBUG_PROPERTY
         ObjectURI::Logger l(getStringTable(_owner));
         log_debug("AS GetterSetter %s inserted with flags %s", l(uri),
@@ -239,6 +282,7 @@ PropertyList::addGetterSetter(const ObjectURI& uri, as_c_function_ptr getter,
 	{
 		// copy flags from previous member (even if it's a normal member ?)
 		a.setFlags(found->getFlags());
+		a.setSlot(found->slot());
 		_props.replace(found, a);
 
 #ifdef GNASH_DEBUG_PROPERTY
@@ -250,7 +294,7 @@ PropertyList::addGetterSetter(const ObjectURI& uri, as_c_function_ptr getter,
 	}
 	else
 	{
-		_props.push_back(a);
+		append(a);
 #ifdef GNASH_DEBUG_PROPERTY
 		string_table& st = getStringTable(_owner);
 		log_debug("Native GetterSetter %s in namespace %s inserted with "
@@ -277,7 +321,7 @@ PropertyList::addDestructiveGetter(const ObjectURI& uri, as_function& getter,
 	// destructive getter doesn't need a setter
 	Property a(uri, &getter, nullptr, flagsIfMissing, true);
 
-	_props.push_back(a);
+	append(a);
 
 #ifdef GNASH_DEBUG_PROPERTY
     ObjectURI::Logger l(getStringTable(_owner));
@@ -297,7 +341,7 @@ PropertyList::addDestructiveGetter(const ObjectURI& uri,
 
 	// destructive getter doesn't need a setter
 	Property a(uri, getter, nullptr, flagsIfMissing, true);
-	_props.push_back(a);
+	append(a);
 
 #ifdef GNASH_DEBUG_PROPERTY
     ObjectURI::Logger l(getStringTable(_owner));
@@ -311,6 +355,32 @@ void
 PropertyList::clear()
 {
 	_props.clear();
+    _shape = PropertyShape::empty();
+    _slots.clear();
+}
+
+void
+PropertyList::append(const Property& p)
+{
+    getRoot(_owner).gc().writeBarrier(p);
+
+    std::pair<iterator, bool> added = _props.push_back(p);
+    if (!added.second || !_shape) return;
+
+    const string_table::key name = getName(p.uri());
+    if (isIndexName(getStringTable(_owner).value(name))) return;
+
+    // Too many properties for a shape to help; use the list as a
+    // dictionary.
+    if (_slots.size() >= PropertyShape::maxSize) {
+        _shape.reset();
+        _slots.clear();
+        return;
+    }
+
+    _shape = _shape->append(name);
+    added.first->setSlot(_slots.size());
+    _slots.push_back(&(*added.first));
 }
 
 } // namespace gnash
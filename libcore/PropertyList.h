@@ -21,6 +21,7 @@
 
 #include <set> 
 #include <string> // for use within map 
+#include <vector>
 #include <cassert> // for inlines
 #include <utility> // for std::pair
 #include <cstdint>
@@ -33,6 +34,7 @@
 #include <algorithm>
 
 #include "Property.h" // for templated functions
+#include "PropertyShape.h"
 #include "dsodefs.h" // for DSOTEXPORT
 
 // Forward declaration
@@ -78,6 +80,14 @@ public:
 /// as_object, not just original as_object it was use with. Currently (as
 /// there is no use for this scenario) it is not possible to change the
 /// owner.
+//
+/// Besides the indexes used for ordinary lookups, a PropertyList keeps
+/// its properties in slots described by a shared PropertyShape, so that
+/// call sites can cache where a property is (see getCachedProperty()).
+/// Deleting a property gives up the shape for good, as lists that
+/// delete properties are rarely worth caching. So does growing beyond
+/// PropertyShape::maxSize properties. Array indices are never in the
+/// shape.
 class PropertyList : boost::noncopyable
 {
 public:
@@ -195,6 +205,34 @@ public:
     ///             not delete them.
     DSOTEXPORT Property* getProperty(const ObjectURI& uri) const;
 
+    /// Get a property through a call site cache.
+    //
+    /// If the cache holds the slot of the property in this list's
+    /// shape, the property is returned without a lookup. Otherwise the
+    /// property is looked up and, if the cache is still active, stored
+    /// in it.
+    //
+    /// The lookup is case-sensitive, so this must not be used for
+    /// SWF6 and below.
+    //
+    /// @param uri      Name of the property.
+    /// @param cache    The cache of the call site.
+    /// @return         The property, or 0 if it wasn't found or the
+    ///                 cache missed and was not updated.
+    Property* getCachedProperty(const ObjectURI& uri, PropertyCache& cache)
+        const {
+        if (cache.shape && cache.shape == shapeId() &&
+                cache.name == getName(uri)) {
+            return const_cast<Property*>(_slots[cache.slot]);
+        }
+        return updateCache(uri, cache);
+    }
+
+    /// The id of this list's shape, or 0 if it has none.
+    std::uint64_t shapeId() const {
+        return _shape ? _shape->id() : 0;
+    }
+
     /// Delete a Property, if existing and not protected from deletion.
     //
     ///
@@ -299,8 +337,20 @@ public:
 
 private:
 
+    /// Append a property, updating the shape.
+    void append(const Property& p);
+
+    /// Look up a property and store its slot in a cache.
+    Property* updateCache(const ObjectURI& uri, PropertyCache& cache) const;
+
     container _props;
 
+    /// The layout of _slots, or 0 if the list has no shape.
+    PropertyShape::Ptr _shape;
+
+    /// The properties in creation order, as described by _shape.
+    std::vector<const Property*> _slots;
+
     as_object& _owner;
 
 };
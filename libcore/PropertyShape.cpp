@@ -0,0 +1,78 @@
+// PropertyShape.cpp:  Shared layouts of ActionScript property lists.
+//
+//   Copyright (C) 2005, 2006, 2007, 2008, 2009, 2010, 2011, 2012
+//   Free Software Foundation, Inc
+//
+// This program is free software; you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation; either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program; if not, write to the Free Software
+// Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+
+#include "PropertyShape.h"
+
+#include <cassert>
+
+namespace gnash {
+
+namespace {
+    std::uint64_t nextShapeId = 1;
+}
+
+PropertyShape::PropertyShape(Ptr parent, string_table::key key)
+    :
+    _parent(std::move(parent)),
+    _key(key),
+    _size(_parent ? _parent->size() + 1 : 0),
+    _id(nextShapeId++)
+{
+}
+
+PropertyShape::~PropertyShape()
+{
+    assert(_transitions.empty());
+
+    Ptr parent = std::move(_parent);
+    string_table::key key = _key;
+
+    while (parent) {
+        parent->_transitions.erase(key);
+
+        // Someone else keeps the parent alive, so the chain ends here.
+        if (parent.use_count() > 1) break;
+
+        // Detach the parent's own parent before it dies, so that its
+        // destructor has nothing to release.
+        Ptr next = std::move(parent->_parent);
+        key = parent->_key;
+        parent = std::move(next);
+    }
+}
+
+const PropertyShape::Ptr&
+PropertyShape::empty()
+{
+    static const Ptr root(new PropertyShape(Ptr(), 0));
+    return root;
+}
+
+PropertyShape::Ptr
+PropertyShape::append(string_table::key key)
+{
+    Transitions::const_iterator it = _transitions.find(key);
+    if (it != _transitions.end()) return it->second->shared_from_this();
+
+    Ptr shape(new PropertyShape(shared_from_this(), key));
+    _transitions[key] = shape.get();
+    return shape;
+}
+
+} // namespace gnash
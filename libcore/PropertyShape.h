@@ -0,0 +1,139 @@
+//
+//   Copyright (C) 2005, 2006, 2007, 2008, 2009, 2010, 2011, 2012
+//   Free Software Foundation, Inc
+//
+// This program is free software; you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation; either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program; if not, write to the Free Software
+// Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+
+#ifndef GNASH_PROPERTYSHAPE_H
+#define GNASH_PROPERTYSHAPE_H
+
+#include <map>
+#include <memory>
+#include <cstdint>
+#include <boost/noncopyable.hpp>
+
+#include "string_table.h"
+
+namespace gnash {
+
+/// The layout of a PropertyList: which property is in which slot.
+//
+/// Shapes form a transition tree. Each shape is its parent with one
+/// more property appended, so all lists that got the same properties in
+/// the same order share a shape. Objects made by the same constructor
+/// usually do.
+//
+/// Each shape has an id that is never reused, so a cache keyed on it
+/// can't mistake a new shape for one that has died.
+//
+/// Shapes are only created by the thread running ActionScript.
+class PropertyShape : public std::enable_shared_from_this<PropertyShape>,
+                      boost::noncopyable
+{
+public:
+
+    typedef std::shared_ptr<PropertyShape> Ptr;
+
+    /// The largest number of properties a shape describes.
+    //
+    /// Lists growing beyond this are used as dictionaries, and are
+    /// better looked up directly than through a long transition chain.
+    static const size_t maxSize = 1024;
+
+    ~PropertyShape();
+
+    /// The shape with no properties, the root of the transition tree.
+    static const Ptr& empty();
+
+    /// Return the shape with one more property appended.
+    //
+    /// @param key  The name of the new property.
+    /// @return     The existing transition from this shape, or a new one.
+    Ptr append(string_table::key key);
+
+    /// The unique id of this shape. This is never 0.
+    std::uint64_t id() const {
+        return _id;
+    }
+
+    /// The number of properties in this shape.
+    size_t size() const {
+        return _size;
+    }
+
+private:
+
+    PropertyShape(Ptr parent, string_table::key key);
+
+    /// The shape this one was appended to, keeping it alive.
+    //
+    /// The destructor releases the chain of parents in a loop, so a
+    /// long chain can't overflow the stack.
+    Ptr _parent;
+
+    /// The name of the last property.
+    const string_table::key _key;
+
+    const size_t _size;
+
+    const std::uint64_t _id;
+
+    /// Shapes appended to this one.
+    //
+    /// A shape removes itself from its parent's transitions when it
+    /// dies, so these pointers are always valid.
+    typedef std::map<string_table::key, PropertyShape*> Transitions;
+    Transitions _transitions;
+
+};
+
+/// A property lookup cache for one ActionScript call site.
+//
+/// It remembers the slot of a property in one shape. A site that misses
+/// too often is considered polymorphic and isn't updated any more.
+struct PropertyCache
+{
+    PropertyCache()
+        :
+        shape(0),
+        name(0),
+        slot(0),
+        misses(0)
+    {}
+
+    /// The number of misses after which the cache stays as it is.
+    static const size_t maxMisses = 16;
+
+    /// Whether the cache should be updated on a miss.
+    bool active() const {
+        return misses < maxMisses;
+    }
+
+    /// The id of the cached shape, or 0 for none.
+    std::uint64_t shape;
+
+    /// The name of the cached property.
+    string_table::key name;
+
+    /// The slot of the named property in the cached shape.
+    size_t slot;
+
+    /// The number of times the cache was filled.
+    size_t misses;
+};
+
+} // namespace gnash
+
+#endif
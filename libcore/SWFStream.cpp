@@ -28,16 +28,27 @@
 
 #include <cstring>
 #include <climits>
-
-//#define USE_TU_FILE_BYTESWAPPING 1
+#include <algorithm>
 
 namespace gnash {
     
+namespace {
+
+/// Bytes read ahead from the IOChannel at a time inside a tag.
+const unsigned long blockSize = 64 * 1024;
+
+}
+
 SWFStream::SWFStream(IOChannel* input)
     :
     m_input(input),
-    m_current_byte(0),
-    m_unused_bits(0)
+    _bufStart(0),
+    _pos(nullptr),
+    _end(nullptr),
+    _limit(nullptr),
+    _bits(0),
+    _bitCount(0),
+    _tagEnd(ULONG_MAX)
 {
 }
 
@@ -47,146 +58,145 @@ SWFStream::~SWFStream()
 }
 
 void
-SWFStream::ensureBytes(unsigned long needed)
+SWFStream::prematureEnd(unsigned long needed, unsigned long left,
+        const char* what)
 {
-#ifndef GNASH_TRUST_SWF_INPUT
+    std::stringstream ss;
+    ss << "premature end of tag: need to read " << needed << " " << what
+       << ", but only " << left << " left in this tag";
+    throw ParserException(ss.str());
+}
 
-    // Not in a tag (should we check file length?)
-    if ( _tagBoundsStack.empty() ) return; 
+unsigned long
+SWFStream::inputPosition()
+{
+    int pos = m_input->tell();
+    // TODO: check return value? Could be negative.
+    return static_cast<unsigned long>(pos);
+}
 
-    unsigned long int left = get_tag_end_position() - tell();
-    if ( left < needed )
-    {
-        std::stringstream ss;
-        ss << "premature end of tag: need to read " << needed << 
-            " bytes, but only " << left << " left in this tag";
-        throw ParserException(ss.str());
-    }
-#endif
+void
+SWFStream::setLimit()
+{
+    const std::uint8_t* base = _buf.data();
+    const unsigned long size = _end - base;
+    const unsigned long tagLeft = _tagEnd > _bufStart ? _tagEnd - _bufStart : 0;
+    _limit = base + std::min(size, tagLeft);
 }
 
-unsigned SWFStream::read(char *buf, unsigned count)
+void
+SWFStream::dropBlock(unsigned long pos)
 {
-    align();
+    _bufStart = pos;
+    _pos = _end = _limit = _buf.data();
+}
 
-    // If we're in a tag, make sure we're not seeking outside the tag.
-    if ( ! _tagBoundsStack.empty() )
-    {
-        TagBoundaries& tb = _tagBoundsStack.back();
-        unsigned long endPos = tb.second;
-        unsigned long cur_pos = tell();
-        assert(endPos >= cur_pos);
-        unsigned long left = endPos - cur_pos;
-        if ( left < count ) count = left;
-    }
+void
+SWFStream::fillBlock(unsigned long count)
+{
+    assert(!_tagBoundsStack.empty());
 
-    if ( ! count ) return 0;
+    const std::uint8_t* base = _buf.data();
+    const unsigned long offset = _pos - base;
+    const unsigned long have = _end - _pos;
+    const unsigned long cur = _bufStart + offset;
+
+    // The block never goes past the outermost tag, as the bytes after
+    // it might not have arrived yet.
+    const unsigned long outerEnd = _tagBoundsStack.front().second;
+    const unsigned long want = std::min(std::max(count, blockSize),
+            outerEnd > cur ? outerEnd - cur : 0);
+
+    if (_buf.size() < want) _buf.resize(want);
+    std::uint8_t* data = _buf.data();
+    if (offset && have) std::memmove(data, data + offset, have);
+
+    std::streamsize got = 0;
+    if (want > have) {
+        got = m_input->read(data + have, want - have);
+        if (got < 0) got = 0;
+    }
 
-    return m_input->read(buf, count);
+    _bufStart = cur;
+    _pos = data;
+    _end = data + have + got;
+    setLimit();
 }
 
-bool SWFStream::read_bit()
+void
+SWFStream::readBytes(std::uint8_t* to, unsigned long count)
 {
-    if (!m_unused_bits)
-    {
-        m_current_byte = m_input->read_byte(); // don't want to align here
-        m_unused_bits = 7;
-        return (m_current_byte&0x80);
+    assert(!_bitCount);
+
+    if (_tagBoundsStack.empty()) {
+        if (count == 1) {
+            *to = m_input->read_byte();
+            return;
+        }
+        if (m_input->read(to, count) < static_cast<std::streamsize>(count)) {
+            throw ParserException(_("Unexpected end of stream while reading"));
+        }
+        return;
     }
-    else
-    {
-        return ( m_current_byte & (1<<(--m_unused_bits)) );
+
+    unsigned long have = _limit - _pos;
+    if (have < count) {
+        fillBlock(count);
+        have = _limit - _pos;
+        if (have < count) {
+            throw ParserException(_("Unexpected end of tag while reading"));
+        }
+    }
+    std::memcpy(to, _pos, count);
+    _pos += count;
+}
+
+void
+SWFStream::fillBits()
+{
+    while (_bitCount < 56 && _pos < _limit) {
+        _bits = (_bits << 8) | *_pos++;
+        _bitCount += 8;
     }
 }
 
-unsigned SWFStream::read_uint(unsigned short bitcount)
+void
+SWFStream::refillBits(unsigned short bitcount)
 {
     // htf_sweet.swf fails when this is set to 24. There seems to
     // be no reason why this should be limited to 32 other than
     // that it is higher than a movie is likely to need.
-    if (bitcount > 32)
-    {
-        // This might overflow a uint32_t or attempt to read outside
-        // the byte cache (relies on there being only 4 bytes after
-        // possible unused bits.)
+    if (bitcount > 32) {
         throw ParserException("Unexpectedly long value advertised.");
     }
 
-    // Optimization for multibyte read
-    if ( bitcount > m_unused_bits )
-    {
-        typedef unsigned char byte;
-
-        std::uint32_t value = 0;
-
-        if (m_unused_bits) // Consume all the unused bits.
-        {
-            int unusedMask = (1 << m_unused_bits)-1;
-            bitcount -= m_unused_bits; 
-            value |= ((m_current_byte&unusedMask) << bitcount);
+    // Outside a tag only the bytes needed are read, so that there
+    // are never whole bytes to give back.
+    if (_tagBoundsStack.empty()) {
+        while (_bitCount < bitcount) {
+            _bits = (_bits << 8) | m_input->read_byte();
+            _bitCount += 8;
         }
-
-        int bytesToRead = bitcount/8;
-        int spareBits = bitcount%8; // additional bits to read
-
-        //std::cerr << "BytesToRead: " << bytesToRead << " spareBits: " << spareBits << " unusedBits: " << (int)m_unused_bits << std::endl;
-
-        assert (bytesToRead <= 4);
-        byte cache[5]; // at most 4 bytes in the cache + eventual spare bits
-
-        if ( spareBits ) m_input->read(&cache, bytesToRead+1);
-        else m_input->read(&cache, bytesToRead);
-
-        for (int i=0; i<bytesToRead; ++i)
-        {
-            bitcount -= 8;
-            value |= cache[i] << bitcount; 
-        }
-
-        //assert(bitcount == spareBits);
-        if ( bitcount )
-        {
-            m_current_byte = cache[bytesToRead];
-            m_unused_bits = 8-bitcount;
-            value |= m_current_byte >> m_unused_bits;
-        }
-        else
-        {
-            m_unused_bits = 0;
-        }
-
-        return value;
-        
-    }
-
-    if (!m_unused_bits)
-    {
-        m_current_byte = m_input->read_byte();
-        m_unused_bits = 8;
+        return;
     }
 
-    // TODO: optimize unusedMask creation ?
-    //       (it's 0xFF if ! m_unused_bits above)
-    int unusedMask = (1 << m_unused_bits)-1;
+    fillBits();
+    if (_bitCount >= bitcount) return;
 
-    if (bitcount == m_unused_bits)
-    {
-        // Consume all the unused bits.
-        m_unused_bits = 0;
-        return (m_current_byte&unusedMask);
-    }
-    else
-    {
-        assert(bitcount < m_unused_bits);
-        // Consume some of the unused bits.
+    // Give back the whole bytes, so that the block starts with
+    // the partly read one.
+    const unsigned whole = _bitCount & ~7u;
+    _bits >>= whole;
+    _pos -= whole >> 3;
+    _bitCount -= whole;
 
-        m_unused_bits -= bitcount;
-        return ((m_current_byte&unusedMask) >> m_unused_bits);
+    fillBlock(8);
+    fillBits();
+    if (_bitCount < bitcount) {
+        throw ParserException(_("Unexpected end of tag while reading bits"));
     }
-
 }
 
-
 int
 SWFStream::read_sint(unsigned short bitcount)
 {
@@ -316,79 +326,41 @@ double SWFStream::read_d64()
 
 }
 
-std::uint8_t    SWFStream::read_u8()
-{
-    align();
-    return m_input->read_byte();
-}
-
-std::int8_t
-SWFStream::read_s8()
-{
-    // read_u8 will align
-    return read_u8();
-}
-
-std::uint16_t SWFStream::read_u16()
+unsigned SWFStream::read(char *buf, unsigned count)
 {
-#ifdef USE_TU_FILE_BYTESWAPPING 
     align();
-    return m_input->read_le16();
-#else
-    const unsigned short dataLength = 2;
-
-    unsigned char buf[dataLength];
 
-    // Should align:
-    if (read(reinterpret_cast<char*>(buf), dataLength) < dataLength)
-    {
-        throw ParserException(_("Unexpected end of stream while reading"));
+    if (_tagBoundsStack.empty()) {
+        if ( ! count ) return 0;
+        return m_input->read(buf, count);
     }
-    
-    std::uint32_t result = buf[0];
-    result |= (buf[1] << 8);
 
-    return result;
-#endif
-}
-
-std::int16_t SWFStream::read_s16()
-{
-    // read_u16 will align
-    return read_u16();
-}
-
-std::uint32_t    SWFStream::read_u32()
-{
-#ifdef USE_TU_FILE_BYTESWAPPING 
-    align();
-    return m_input->read_le32();
-#else
-    using std::uint32_t;
-
-    const unsigned short dataLength = 4;
-
-    unsigned char buf[dataLength];
-    
-    // Should align
-    if (read(reinterpret_cast<char*>(buf), dataLength) < dataLength)
-    {
-        throw ParserException(_("Unexpected end of stream while reading"));
+    // Make sure we're not reading outside the tag.
+    const unsigned long cur_pos = tell();
+    assert(_tagEnd >= cur_pos);
+    const unsigned long left = _tagEnd - cur_pos;
+    if ( left < count ) count = left;
+
+    unsigned long done = std::min<unsigned long>(_limit - _pos, count);
+    if (done) std::memcpy(buf, _pos, done);
+    _pos += done;
+    if (done == count) return count;
+
+    // Large reads, such as image data, skip the block.
+    if (count - done >= blockSize) {
+        assert(_pos == _end);
+        std::streamsize got = m_input->read(buf + done, count - done);
+        if (got < 0) got = 0;
+        dropBlock(_bufStart + (_end - _buf.data()) + got);
+        return done + got;
     }
-    
-    uint32_t result = buf[0];
-         result |= buf[1] << 8;
-         result |= buf[2] << 16;
-         result |= buf[3] << 24;
 
-    return result;
-#endif
-}
-
-std::int32_t    SWFStream::read_s32()
-{
-    // read_u32 will align
-    return read_u32();
+    fillBlock(count - done);
+    const unsigned long more = std::min<unsigned long>(_limit - _pos,
+            count - done);
+    std::memcpy(buf + done, _pos, more);
+    _pos += more;
+    return done + more;
 }
 
 void
@@ -424,9 +396,9 @@ void SWFStream::read_string_with_length(unsigned len, std::string& to)
     to.resize(len);
 
     ensureBytes(len);
-    for (unsigned int i = 0; i < len; ++i)
+    if (len && read(&to[0], len) < len)
     {
-        to[i] = read_u8();
+        throw ParserException(_("Unexpected end of stream while reading"));
     }
 
     // drop trailing nulls (see swf6/Bejeweled.swf)
@@ -443,15 +415,6 @@ void SWFStream::read_string_with_length(unsigned len, std::string& to)
 }
 
 
-unsigned long
-SWFStream::tell()
-{
-    int pos = m_input->tell();
-    // TODO: check return value? Could be negative.
-    return static_cast<unsigned long>(pos);
-}
-
-
 bool
 SWFStream::seek(unsigned long pos)
 {
@@ -477,6 +440,15 @@ SWFStream::seek(unsigned long pos)
             // throw ParserException ?
             return false;
         }
+
+        // Within the block there is nothing to read.
+        if (pos >= _bufStart && pos - _bufStart <=
+                static_cast<unsigned long>(_end - _buf.data()))
+        {
+            _pos = _buf.data() + (pos - _bufStart);
+            return true;
+        }
+        dropBlock(pos);
     }
 
     // Do the seek.
@@ -486,6 +458,7 @@ SWFStream::seek(unsigned long pos)
         //       we might be called from an exception handler
         //       so throwing here might be a double throw...
         log_swferror(_("Unexpected end of stream"));
+        if (!_tagBoundsStack.empty()) dropBlock(inputPosition());
         return false;
     }
 
@@ -513,7 +486,7 @@ SWFStream::open_tag()
     int tagHeader = read_u16();
     int tagType = tagHeader >> 6;
     int tagLength = tagHeader & 0x3F;
-    assert(m_unused_bits == 0);
+    assert(_bitCount == 0);
         
     if (tagLength == 0x3F)
     {
@@ -531,7 +504,8 @@ SWFStream::open_tag()
         //log_debug("Tag %d has a size of %d bytes !!", tagType, tagLength);
     }
 
-    unsigned long tagEnd = tell() + tagLength;
+    const unsigned long bodyStart = tell();
+    unsigned long tagEnd = bodyStart + tagLength;
     
     // Check end position doesn't overflow a signed int - that makes
     // zlib adapter's inflate_seek(int pos, void* appdata) unhappy.
@@ -567,7 +541,12 @@ SWFStream::open_tag()
         
     // Remember where the end of the tag is, so we can
     // fast-forward past it when we're done reading it.
+    // The body of an outermost tag is read into the block only when
+    // it is first needed.
+    if (_tagBoundsStack.empty()) dropBlock(bodyStart);
     _tagBoundsStack.push_back(std::make_pair(tagStart, tagEnd));
+    _tagEnd = tagEnd;
+    setLimit();
 
     IF_VERBOSE_PARSE (
 	    log_parse(_("SWF[%lu]: tag type = %d, tag length = %d, end tag = %lu"),
@@ -582,19 +561,36 @@ void
 SWFStream::close_tag()
 {
     assert(!_tagBoundsStack.empty());
-    std::streampos endPos = _tagBoundsStack.back().second;
+    const unsigned long endPos = _tagBoundsStack.back().second;
     _tagBoundsStack.pop_back();
 
     //log_debug("Close tag called at %d, stream size: %d", endPos);
 
+    _bitCount = 0;
+
+    if (_tagBoundsStack.empty()) {
+        _tagEnd = ULONG_MAX;
+        dropBlock(0);
+    }
+    else {
+        _tagEnd = _tagBoundsStack.back().second;
+
+        // A nested tag usually ends within the block.
+        if (endPos >= _bufStart && endPos - _bufStart <=
+                static_cast<unsigned long>(_end - _buf.data())) {
+            _pos = _buf.data() + (endPos - _bufStart);
+            setLimit();
+            return;
+        }
+        dropBlock(endPos);
+    }
+
     if (!m_input->seek(endPos))
     {
         // We'll go on reading right past the end of the stream
         // if we don't throw an exception.
         throw ParserException(_("Could not seek to reported end of tag"));
     }
-
-    m_unused_bits = 0;
 }
 
 void
@@ -610,6 +606,8 @@ SWFStream::consumeInput()
 			"go_to_end: %s"), ex.what());
 		// eh.. and now ?!
 	}
+	_bitCount = 0;
+	if (!_tagBoundsStack.empty()) dropBlock(inputPosition());
 }
 
 } // end namespace gnash
@@ -28,6 +28,7 @@
 #include <sstream>
 #include <vector> // for composition
 #include <cstdint> // for boost::?int??_t
+#include <climits>
 
 // Define the following macro if you want to want Gnash parser
 // to assume the underlying SWF is well-formed. It would make
@@ -54,6 +55,14 @@ namespace gnash {
 /// Provides 'aligned' and 'bitwise' read functions:
 /// - aligned reads always start on a byte boundary
 /// - bitwise reads can cross byte boundaries
+///
+/// Inside a tag the body is read from the IOChannel a block at a
+/// time, and reads are served from the block. The bounds of the
+/// innermost tag are applied once, when the block is filled or a tag
+/// opened or closed, so reading a value only compares two pointers.
+/// Bits are prefetched a whole 64-bit word at a time. Outside a tag
+/// nothing is read ahead, since the IOChannel might still be
+/// waiting for the bytes.
 /// 
 class DSOEXPORT SWFStream
 {
@@ -68,7 +77,15 @@ public:
 	//
 	/// bitwise read
 	///
-	unsigned read_uint(unsigned short bitcount);
+	unsigned read_uint(unsigned short bitcount)
+	{
+		if (bitcount > _bitCount || bitcount > 32) {
+			refillBits(bitcount);
+		}
+		_bitCount -= bitcount;
+		return (_bits >> _bitCount) &
+			((static_cast<std::uint64_t>(1) << bitcount) - 1);
+	}
 
 	/// \brief
 	/// Reads a single bit off the stream
@@ -76,7 +93,10 @@ public:
 	//
 	/// bitwise read
 	///
-	bool read_bit();
+	bool read_bit()
+	{
+		return read_uint(1);
+	}
 
 	/// \brief
 	/// Reads a bit-packed little-endian signed integer
@@ -134,8 +154,9 @@ public:
 	///
 	void	align()
 	{
-		m_unused_bits=0;
-		// m_current_byte = 0; // this is not needed
+		// Give back any whole bytes prefetched for bitwise reads.
+		_pos -= _bitCount >> 3;
+		_bitCount = 0;
 	}
 
 	/// Read <count> bytes from the source stream and copy that data to <buf>.
@@ -148,38 +169,77 @@ public:
 	//
 	/// aligned read
 	///
-	std::uint8_t  read_u8();
+	std::uint8_t  read_u8()
+	{
+		align();
+		if (_pos < _limit) return *_pos++;
+		std::uint8_t buf[1];
+		readBytes(buf, 1);
+		return buf[0];
+	}
 
 	/// Read a aligned signed 8-bit value from the stream.		
 	//
 	/// aligned read
 	///
-    std::int8_t read_s8();
+	std::int8_t read_s8()
+	{
+		return read_u8();
+	}
 
 	/// Read a aligned unsigned 16-bit value from the stream.		
 	//
 	/// aligned read
 	///
-	std::uint16_t read_u16();
+	std::uint16_t read_u16()
+	{
+		align();
+		std::uint8_t buf[2];
+		const std::uint8_t* p = buf;
+		if (_limit - _pos >= 2) {
+			p = _pos;
+			_pos += 2;
+		}
+		else readBytes(buf, 2);
+		return p[0] | (p[1] << 8);
+	}
 
 	/// Read a aligned signed 16-bit value from the stream.		
 	//
 	/// aligned read
 	///
-	std::int16_t  read_s16();
+	std::int16_t  read_s16()
+	{
+		return read_u16();
+	}
 
 	/// Read a aligned unsigned 32-bit value from the stream.		
 	//
 	/// aligned read
 	///
-	std::uint32_t read_u32();
+	std::uint32_t read_u32()
+	{
+		align();
+		std::uint8_t buf[4];
+		const std::uint8_t* p = buf;
+		if (_limit - _pos >= 4) {
+			p = _pos;
+			_pos += 4;
+		}
+		else readBytes(buf, 4);
+		return p[0] | (p[1] << 8) | (p[2] << 16) |
+			(static_cast<std::uint32_t>(p[3]) << 24);
+	}
 
 	/// \brief
 	/// Read a aligned signed 32-bit value from the stream.		
 	//
 	/// aligned read
 	///
-	std::int32_t  read_s32();
+	std::int32_t  read_s32()
+	{
+		return read_u32();
+	}
 
 	/// \brief
 	/// Read a variable length unsigned 32-bit value from the stream.
@@ -301,7 +361,11 @@ public:
 	/// - For aligned reads the current byte will not be used
 	///   (already used)
 	///
-	unsigned long tell();
+	unsigned long tell()
+	{
+		if (_tagBoundsStack.empty()) return inputPosition();
+		return _bufStart + (_pos - _buf.data()) - (_bitCount >> 3);
+	}
 
 	/// Set the file position to the given value (byte aligned)
 	//
@@ -367,7 +431,15 @@ public:
 	///
 	/// NOTE: if GNASH_TRUST_SWF_INPUT is defined this function is a no-op 
 	///
-	void ensureBytes(unsigned long needed);
+	void ensureBytes(unsigned long needed)
+	{
+#ifndef GNASH_TRUST_SWF_INPUT
+		// Not in a tag (should we check file length?)
+		if ( _tagBoundsStack.empty() ) return;
+		unsigned long int left = _tagEnd - tell();
+		if ( left < needed ) prematureEnd(needed, left, "bytes");
+#endif
+	}
 
 	/// \brief
 	/// Ensure the requested number of bits are available for a bitwise read
@@ -383,14 +455,9 @@ public:
 	{
 #ifndef GNASH_TRUST_SWF_INPUT
 		if ( _tagBoundsStack.empty() ) return; // not in a tag (should we check file length ?)
-		unsigned long int bytesLeft = get_tag_end_position() - tell();
-		unsigned long int bitsLeft = (bytesLeft*8)+m_unused_bits;
-		if ( bitsLeft < needed )
-		{
-			std::stringstream ss;
-			ss << "premature end of tag: need to read " << needed << " bytes, but only " << bitsLeft << " left in this tag";
-			throw ParserException(ss.str());
-		}
+		unsigned long int bytesLeft = _tagEnd - tell();
+		unsigned long int bitsLeft = (bytesLeft*8) + (_bitCount & 7);
+		if ( bitsLeft < needed ) prematureEnd(needed, bitsLeft, "bits");
 #endif
 	}
 
@@ -414,9 +481,56 @@ public:
 
 private:
 
+	/// Read exactly count bytes, filling the block as needed.
+	//
+	/// Throws ParserException if they are not all there.
+	///
+	void readBytes(std::uint8_t* to, unsigned long count);
+
+	/// Prefetch at least bitcount bits, or throw ParserException.
+	void refillBits(unsigned short bitcount);
+
+	/// Prefetch whole bytes of the block into the bit register.
+	void fillBits();
+
+	/// Read the block on from the current position, so that at
+	/// least count bytes are in it if the outermost tag has them.
+	void fillBlock(unsigned long count);
+
+	/// Forget the block; the next read starts at pos.
+	void dropBlock(unsigned long pos);
+
+	/// Point _limit at the end of the innermost tag or of the block.
+	void setLimit();
+
+	unsigned long inputPosition();
+
+	void prematureEnd(unsigned long needed, unsigned long left,
+			const char* what);
+
 	IOChannel*	m_input;
-	std::uint8_t	m_current_byte;
-	std::uint8_t	m_unused_bits;
+
+	/// The block being read, starting at file offset _bufStart.
+	//
+	/// The IOChannel is positioned at the end of the block.
+	std::vector<std::uint8_t> _buf;
+	unsigned long _bufStart;
+
+	/// The next byte to read.
+	const std::uint8_t* _pos;
+
+	/// The end of the bytes read into the block.
+	const std::uint8_t* _end;
+
+	/// The end of the bytes the innermost tag may read; never past _end.
+	const std::uint8_t* _limit;
+
+	/// Prefetched bits; the next to read is bit _bitCount - 1.
+	std::uint64_t _bits;
+	unsigned _bitCount;
+
+	/// The end of the innermost open tag.
+	unsigned long _tagEnd;
 
 	typedef std::pair<unsigned long,unsigned long> TagBoundaries;
 	// position of start and end of tag
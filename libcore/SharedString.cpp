@@ -0,0 +1,110 @@
+// SharedString.cpp: immutable strings shared by their copies.
+//
+//   Copyright (C) 2005, 2006, 2007, 2008, 2009, 2010, 2011, 2012
+//   Free Software Foundation, Inc
+//
+// This program is free software; you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation; either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program; if not, write to the Free Software
+// Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+
+#include "SharedString.h"
+
+#include <memory>
+#include <mutex>
+#include <unordered_map>
+#include <vector>
+
+namespace gnash {
+
+const size_t SharedString::ropeLimit;
+
+SharedString
+SharedString::intern(const std::string& s)
+{
+    SharedString ret;
+    if (s.empty()) return ret;
+
+    // Like the string_table, interned strings are never dropped.
+    static std::mutex mutex;
+    static std::unordered_map<std::string, std::unique_ptr<Rep> > table;
+
+    std::lock_guard<std::mutex> lock(mutex);
+    std::unique_ptr<Rep>& rep = table[s];
+    if (!rep) rep.reset(new Rep(s, 0));
+    ret._rep = rep.get();
+    return ret;
+}
+
+SharedString
+operator+(const SharedString& a, const SharedString& b)
+{
+    if (a.empty()) return b;
+    if (b.empty()) return a;
+
+    SharedString ret;
+    if (a.size() + b.size() < SharedString::ropeLimit) {
+        ret._rep = new SharedString::Rep(a.str() + b.str(), 1);
+    }
+    else ret._rep = new SharedString::Rep(a._rep, b._rep);
+    return ret;
+}
+
+const std::string&
+SharedString::flatten(const Rep* r)
+{
+    std::string s;
+    s.reserve(r->length);
+
+    // Ropes built by appends are deep, so don't recurse.
+    std::vector<const Rep*> parts(1, r);
+    while (!parts.empty()) {
+        const Rep* p = parts.back();
+        parts.pop_back();
+        if (p->left) {
+            parts.push_back(p->right);
+            parts.push_back(p->left);
+        }
+        else s += p->str;
+    }
+
+    r->str.swap(s);
+    Rep* left = r->left;
+    Rep* right = r->right;
+    r->left = r->right = nullptr;
+    release(left);
+    release(right);
+    return r->str;
+}
+
+void
+SharedString::destroy(Rep* r)
+{
+    std::vector<Rep*> dead(1, r);
+    while (!dead.empty()) {
+        Rep* p = dead.back();
+        dead.pop_back();
+        for (Rep* part : { p->left, p->right }) {
+            if (part && part->refs && !--part->refs) dead.push_back(part);
+        }
+        delete p;
+    }
+}
+
+const std::string&
+SharedString::emptyString()
+{
+    static const std::string empty;
+    return empty;
+}
+
+} // namespace gnash
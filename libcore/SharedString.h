@@ -0,0 +1,203 @@
+// SharedString.h: immutable strings shared by their copies.
+//
+//   Copyright (C) 2005, 2006, 2007, 2008, 2009, 2010, 2011, 2012
+//   Free Software Foundation, Inc
+//
+// This program is free software; you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation; either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program; if not, write to the Free Software
+// Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+
+#ifndef GNASH_SHAREDSTRING_H
+#define GNASH_SHAREDSTRING_H
+
+#include "dsodefs.h" // for DSOEXPORT
+
+#include <cstddef>
+#include <string>
+#include <utility>
+
+namespace gnash {
+    class as_value;
+}
+
+namespace gnash {
+
+/// An immutable string, shared by its copies.
+//
+/// Runtime strings are reference counted, without locking: like the
+/// as_values holding them, they belong to the thread running
+/// ActionScript. Interned strings, such as the identifiers of constant
+/// pools, are kept for the life of the process and may be copied
+/// from any thread.
+///
+/// The empty string takes no memory. Concatenations of long strings are
+/// ropes, made into one string when their characters are first read,
+/// so that building a string by repeated appends takes linear time.
+class DSOEXPORT SharedString
+{
+public:
+
+    /// The empty string.
+    SharedString() : _rep(nullptr) {}
+
+    explicit SharedString(std::string s)
+        :
+        _rep(share(std::move(s)))
+    {}
+
+    SharedString(const SharedString& s)
+        :
+        _rep(s._rep)
+    {
+        acquire(_rep);
+    }
+
+    SharedString(SharedString&& s)
+        :
+        _rep(s._rep)
+    {
+        s._rep = nullptr;
+    }
+
+    ~SharedString() {
+        release(_rep);
+    }
+
+    SharedString& operator=(SharedString s) {
+        std::swap(_rep, s._rep);
+        return *this;
+    }
+
+    /// The one interned copy of a string.
+    static SharedString intern(const std::string& s);
+
+    const std::string& str() const {
+        return str(_rep);
+    }
+
+    /// The length in bytes, known without reading a rope.
+    size_t size() const {
+        return size(_rep);
+    }
+
+    bool empty() const {
+        return !size();
+    }
+
+    bool interned() const {
+        return _rep && !_rep->refs;
+    }
+
+    /// Identifies this string and its copies, null if empty.
+    const void* identity() const {
+        return _rep;
+    }
+
+    friend bool operator==(const SharedString& a, const SharedString& b) {
+        return equal(a._rep, b._rep);
+    }
+
+    /// Concatenate two strings.
+    //
+    /// Short results are copied, longer ones refer to both strings.
+    friend DSOEXPORT SharedString operator+(const SharedString& a,
+            const SharedString& b);
+
+    /// Concatenations shorter than this are copied.
+    static const size_t ropeLimit = 256;
+
+private:
+
+    friend class as_value;
+
+    /// The shared representation.
+    struct Rep
+    {
+        Rep(std::string s, size_t r)
+            :
+            refs(r),
+            length(s.size()),
+            str(std::move(s)),
+            left(nullptr),
+            right(nullptr)
+        {}
+
+        /// A rope of two strings.
+        Rep(Rep* l, Rep* r)
+            :
+            refs(1),
+            length(l->length + r->length),
+            left(l),
+            right(r)
+        {
+            acquire(l);
+            acquire(r);
+        }
+
+        /// The number of copies, 0 if interned.
+        size_t refs;
+
+        const size_t length;
+
+        /// The characters, once there is no left and right.
+        mutable std::string str;
+
+        /// The parts of a rope not flattened yet.
+        mutable Rep* left;
+        mutable Rep* right;
+    };
+
+    /// A Rep for a new string, null for the empty string.
+    static Rep* share(std::string s) {
+        return s.empty() ? nullptr : new Rep(std::move(s), 1);
+    }
+
+    static void acquire(Rep* r) {
+        if (r && r->refs) ++r->refs;
+    }
+
+    static void release(Rep* r) {
+        if (r && r->refs && !--r->refs) {
+            if (r->left) destroy(r);
+            else delete r;
+        }
+    }
+
+    static const std::string& str(const Rep* r) {
+        if (!r) return emptyString();
+        return r->left ? flatten(r) : r->str;
+    }
+
+    static size_t size(const Rep* r) {
+        return r ? r->length : 0;
+    }
+
+    static bool equal(const Rep* a, const Rep* b) {
+        if (a == b) return true;
+        return size(a) == size(b) && str(a) == str(b);
+    }
+
+    /// Join the parts of a rope into its string.
+    static const std::string& flatten(const Rep* r);
+
+    /// Delete a rope, and the parts only it used, without recursing.
+    static void destroy(Rep* r);
+
+    static const std::string& emptyString();
+
+    Rep* _rep;
+};
+
+} // namespace gnash
+
+#endif
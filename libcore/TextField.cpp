@@ -1013,6 +1013,9 @@ TextField::insertTab(SWF::TextRecord& rec, std::int32_t& x, float scale)
 void
 TextField::format_text()
 {
+    // Autosize changes the bounds.
+    boundsChanged();
+
     _textRecords.clear();
     _line_starts.clear();
     _recordStarts.clear();
@@ -2510,6 +2513,7 @@ TextField::killFocus()
 void
 TextField::setWidth(double newwidth)
 {
+    set_invalidated();
 	const SWFRect& bounds = getBounds();
     _bounds.set_to_rect(bounds.get_x_min(),
             bounds.get_y_min(),
@@ -2520,6 +2524,7 @@ TextField::setWidth(double newwidth)
 void
 TextField::setHeight(double newheight)
 {
+    set_invalidated();
 	const SWFRect& bounds = getBounds();
     _bounds.set_to_rect(bounds.get_x_min(),
             bounds.get_y_min(),
@@ -27,7 +27,6 @@
 #include "ClassHierarchy.h"
 #include "Class.h"
 #include "namedStrings.h"
-#include "CodeStream.h"
 #include "action_buffer.h"
 #include "Machine.h"
 #include "Global_as.h"
@@ -1186,7 +1185,7 @@ AbcBlock::read_method_bodies()
 
         Method& method = *_methods[offset];
 
-		if (method.getBody()) {
+		if (method.hasBody()) {
 			log_error(_("ABC: Only one body per method."));
 			return false;
 		}
@@ -1207,12 +1206,11 @@ AbcBlock::read_method_bodies()
 		std::uint32_t clength = _stream->read_V32();
 		method.setBodyLength(clength);
 
-		// The code.
-		//TODO: Clean this up.
+		// The code, which is only checked when the method is first run.
 		std::string body;
 		_stream->read_string_with_length(clength, body);
 
-		method.setBody(new CodeStream(body));
+		method.setCode(std::move(body));
 		
         // Exception count and exceptions
         
@@ -1,4 +1,4 @@
-// CodeStream.cpp A class which allows bounds-checked reading from a char array
+// CodeStream.cpp A class which reads verified AS3 bytecode
 //
 //   Copyright (C) 2007, 2008, 2009, 2010, 2011, 2012
 //   Free Software Foundation, Inc.
@@ -18,114 +18,346 @@
 // Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
 
 #include "CodeStream.h"
-#include <iostream>
+
+#include <vector>
+
+#include "SWF.h"
 
 namespace gnash {
 
-/// Read a variable length encoded 32 bit unsigned integer
-std::uint32_t
-CodeStream::read_V32()
+namespace {
+
+/// The operands following an opcode.
+enum Operands
+{
+    OPERANDS_INVALID,
+    OPERANDS_NONE,
+    OPERANDS_U8,
+    OPERANDS_V32,
+    OPERANDS_V32_V32,
+    OPERANDS_BRANCH,
+    OPERANDS_SWITCH,
+    OPERANDS_DEBUG
+};
+
+Operands
+operands(std::uint8_t opcode)
 {
-	char data;
+    switch (static_cast<SWF::abc_action_type>(opcode))
+    {
+        case SWF::ABC_ACTION_BKPT:
+        case SWF::ABC_ACTION_NOP:
+        case SWF::ABC_ACTION_THROW:
+        case SWF::ABC_ACTION_DXNSLATE:
+        case SWF::ABC_ACTION_LABEL:
+        case SWF::ABC_ACTION_PUSHWITH:
+        case SWF::ABC_ACTION_POPSCOPE:
+        case SWF::ABC_ACTION_NEXTNAME:
+        case SWF::ABC_ACTION_HASNEXT:
+        case SWF::ABC_ACTION_PUSHNULL:
+        case SWF::ABC_ACTION_PUSHUNDEFINED:
+        case SWF::ABC_ACTION_NEXTVALUE:
+        case SWF::ABC_ACTION_PUSHTRUE:
+        case SWF::ABC_ACTION_PUSHFALSE:
+        case SWF::ABC_ACTION_PUSHNAN:
+        case SWF::ABC_ACTION_POP:
+        case SWF::ABC_ACTION_DUP:
+        case SWF::ABC_ACTION_SWAP:
+        case SWF::ABC_ACTION_PUSHSCOPE:
+        case SWF::ABC_ACTION_RETURNVOID:
+        case SWF::ABC_ACTION_RETURNVALUE:
+        case SWF::ABC_ACTION_NEWACTIVATION:
+        case SWF::ABC_ACTION_GETGLOBALSCOPE:
+        case SWF::ABC_ACTION_CONVERT_S:
+        case SWF::ABC_ACTION_ESC_XELEM:
+        case SWF::ABC_ACTION_ESC_XATTR:
+        case SWF::ABC_ACTION_CONVERT_I:
+        case SWF::ABC_ACTION_CONVERT_U:
+        case SWF::ABC_ACTION_CONVERT_D:
+        case SWF::ABC_ACTION_CONVERT_B:
+        case SWF::ABC_ACTION_CONVERT_O:
+        case SWF::ABC_ACTION_CHECKFILTER:
+        case SWF::ABC_ACTION_COERCE_B:
+        case SWF::ABC_ACTION_COERCE_A:
+        case SWF::ABC_ACTION_COERCE_I:
+        case SWF::ABC_ACTION_COERCE_D:
+        case SWF::ABC_ACTION_COERCE_S:
+        case SWF::ABC_ACTION_ASTYPELATE:
+        case SWF::ABC_ACTION_COERCE_U:
+        case SWF::ABC_ACTION_COERCE_O:
+        case SWF::ABC_ACTION_NEGATE:
+        case SWF::ABC_ACTION_INCREMENT:
+        case SWF::ABC_ACTION_DECREMENT:
+        case SWF::ABC_ACTION_ABC_TYPEOF:
+        case SWF::ABC_ACTION_NOT:
+        case SWF::ABC_ACTION_BITNOT:
+        case SWF::ABC_ACTION_ADD:
+        case SWF::ABC_ACTION_SUBTRACT:
+        case SWF::ABC_ACTION_MULTIPLY:
+        case SWF::ABC_ACTION_DIVIDE:
+        case SWF::ABC_ACTION_MODULO:
+        case SWF::ABC_ACTION_LSHIFT:
+        case SWF::ABC_ACTION_RSHIFT:
+        case SWF::ABC_ACTION_URSHIFT:
+        case SWF::ABC_ACTION_BITAND:
+        case SWF::ABC_ACTION_BITOR:
+        case SWF::ABC_ACTION_BITXOR:
+        case SWF::ABC_ACTION_EQUALS:
+        case SWF::ABC_ACTION_STRICTEQUALS:
+        case SWF::ABC_ACTION_LESSTHAN:
+        case SWF::ABC_ACTION_LESSEQUALS:
+        case SWF::ABC_ACTION_GREATERTHAN:
+        case SWF::ABC_ACTION_GREATEREQUALS:
+        case SWF::ABC_ACTION_INSTANCEOF:
+        case SWF::ABC_ACTION_ISTYPELATE:
+        case SWF::ABC_ACTION_IN:
+        case SWF::ABC_ACTION_INCREMENT_I:
+        case SWF::ABC_ACTION_DECREMENT_I:
+        case SWF::ABC_ACTION_NEGATE_I:
+        case SWF::ABC_ACTION_ADD_I:
+        case SWF::ABC_ACTION_SUBTRACT_I:
+        case SWF::ABC_ACTION_MULTIPLY_I:
+        case SWF::ABC_ACTION_GETLOCAL0:
+        case SWF::ABC_ACTION_GETLOCAL1:
+        case SWF::ABC_ACTION_GETLOCAL2:
+        case SWF::ABC_ACTION_GETLOCAL3:
+        case SWF::ABC_ACTION_SETLOCAL0:
+        case SWF::ABC_ACTION_SETLOCAL1:
+        case SWF::ABC_ACTION_SETLOCAL2:
+        case SWF::ABC_ACTION_SETLOCAL3:
+        case SWF::ABC_ACTION_TIMESTAMP:
+            return OPERANDS_NONE;
 
-	read(&data,1);
-	std::uint32_t result = data;
-	if (!(result & 0x00000080))	return result;
+        case SWF::ABC_ACTION_PUSHBYTE:
+        case SWF::ABC_ACTION_GETSCOPEOBJECT:
+            return OPERANDS_U8;
 
-	read(&data,1);
-	result = (result & 0x0000007F) | data << 7;
-	if (!(result & 0x00004000)) return result;
-	
-	read(&data,1);
-	result = (result & 0x00003FFF) | data << 14;
-	if (!(result & 0x00200000)) return result;
+        case SWF::ABC_ACTION_GETSUPER:
+        case SWF::ABC_ACTION_SETSUPER:
+        case SWF::ABC_ACTION_DXNS:
+        case SWF::ABC_ACTION_KILL:
+        case SWF::ABC_ACTION_PUSHSHORT:
+        case SWF::ABC_ACTION_PUSHSTRING:
+        case SWF::ABC_ACTION_PUSHINT:
+        case SWF::ABC_ACTION_PUSHUINT:
+        case SWF::ABC_ACTION_PUSHDOUBLE:
+        case SWF::ABC_ACTION_PUSHNAMESPACE:
+        case SWF::ABC_ACTION_NEWFUNCTION:
+        case SWF::ABC_ACTION_CALL:
+        case SWF::ABC_ACTION_CONSTRUCT:
+        case SWF::ABC_ACTION_CONSTRUCTSUPER:
+        case SWF::ABC_ACTION_NEWOBJECT:
+        case SWF::ABC_ACTION_NEWARRAY:
+        case SWF::ABC_ACTION_NEWCLASS:
+        case SWF::ABC_ACTION_GETDESCENDANTS:
+        case SWF::ABC_ACTION_NEWCATCH:
+        case SWF::ABC_ACTION_FINDPROPSTRICT:
+        case SWF::ABC_ACTION_FINDPROPERTY:
+        case SWF::ABC_ACTION_FINDDEF:
+        case SWF::ABC_ACTION_GETLEX:
+        case SWF::ABC_ACTION_SETPROPERTY:
+        case SWF::ABC_ACTION_GETLOCAL:
+        case SWF::ABC_ACTION_SETLOCAL:
+        case SWF::ABC_ACTION_GETPROPERTY:
+        case SWF::ABC_ACTION_INITPROPERTY:
+        case SWF::ABC_ACTION_DELETEPROPERTY:
+        case SWF::ABC_ACTION_GETSLOT:
+        case SWF::ABC_ACTION_SETSLOT:
+        case SWF::ABC_ACTION_GETGLOBALSLOT:
+        case SWF::ABC_ACTION_SETGLOBALSLOT:
+        case SWF::ABC_ACTION_COERCE:
+        case SWF::ABC_ACTION_ASTYPE:
+        case SWF::ABC_ACTION_INCLOCAL:
+        case SWF::ABC_ACTION_DECLOCAL:
+        case SWF::ABC_ACTION_ISTYPE:
+        case SWF::ABC_ACTION_INCLOCAL_I:
+        case SWF::ABC_ACTION_DECLOCAL_I:
+        case SWF::ABC_ACTION_DEBUGLINE:
+        case SWF::ABC_ACTION_DEBUGFILE:
+        case SWF::ABC_ACTION_BKPTLINE:
+            return OPERANDS_V32;
 
-	read(&data,1);
-	result = (result & 0x001FFFFF) | data << 21;
-	if (!(result & 0x10000000)) return result;
+        case SWF::ABC_ACTION_HASNEXT2:
+        case SWF::ABC_ACTION_CALLMETHOD:
+        case SWF::ABC_ACTION_CALLSTATIC:
+        case SWF::ABC_ACTION_CALLSUPER:
+        case SWF::ABC_ACTION_CALLPROPERTY:
+        case SWF::ABC_ACTION_CONSTRUCTPROP:
+        case SWF::ABC_ACTION_CALLPROPLEX:
+        case SWF::ABC_ACTION_CALLSUPERVOID:
+        case SWF::ABC_ACTION_CALLPROPVOID:
+            return OPERANDS_V32_V32;
 
-	read(&data,1);
-	return (result & 0x0FFFFFFF) | data << 28;
+        case SWF::ABC_ACTION_IFNLT:
+        case SWF::ABC_ACTION_IFNLE:
+        case SWF::ABC_ACTION_IFNGT:
+        case SWF::ABC_ACTION_IFNGE:
+        case SWF::ABC_ACTION_JUMP:
+        case SWF::ABC_ACTION_IFTRUE:
+        case SWF::ABC_ACTION_IFFALSE:
+        case SWF::ABC_ACTION_IFEQ:
+        case SWF::ABC_ACTION_IFNE:
+        case SWF::ABC_ACTION_IFLT:
+        case SWF::ABC_ACTION_IFLE:
+        case SWF::ABC_ACTION_IFGT:
+        case SWF::ABC_ACTION_IFGE:
+        case SWF::ABC_ACTION_IFSTRICTEQ:
+        case SWF::ABC_ACTION_IFSTRICTNE:
+            return OPERANDS_BRANCH;
 
+        case SWF::ABC_ACTION_LOOKUPSWITCH:
+            return OPERANDS_SWITCH;
+
+        case SWF::ABC_ACTION_DEBUG:
+            return OPERANDS_DEBUG;
+
+        default:
+            return OPERANDS_INVALID;
+    }
 }
 
-/// Read an opcode for ActionScript 3
-std::uint8_t
-CodeStream::read_as3op()
+/// Skip a checked number of bytes.
+bool
+skip(const std::uint8_t*& pos, const std::uint8_t* end, size_t bytes)
 {
-	char data;
-	read(&data,1);
-	if(eof()){
-		return 0;
-	}
-	else{
-		return static_cast<std::uint8_t> (data);
-	}
+    if (static_cast<size_t>(end - pos) < bytes) return false;
+    pos += bytes;
+    return true;
 }
 
-/// Change the current position by a relative value.
-void
-CodeStream::seekBy(int change)
+/// Read a checked V32, as CodeStream::read_V32() reads it.
+bool
+readV32(const std::uint8_t*& pos, const std::uint8_t* end,
+        std::uint32_t& value)
 {
-	seekg(change,ios_base::cur);
+    value = 0;
+    for (int i = 0; i < 5; ++i) {
+        if (pos == end) return false;
+        const std::uint8_t byte = *pos++;
+        value |= std::uint32_t(byte & (i < 4 ? 0x7F : 0xFF)) << (7 * i);
+        if (!(byte & 0x80)) break;
+    }
+    return true;
 }
 
-/// Set the current position to an absolute value (relative to the start)
-void
-CodeStream::seekTo(unsigned int set)
+bool
+skipV32(const std::uint8_t*& pos, const std::uint8_t* end)
 {
-	seekg(set);
+    std::uint32_t value;
+    return readV32(pos, end, value);
 }
 
-//TODO: Is there a better way to read a 24 bit signed int?
-std::int32_t
-CodeStream::read_S24()
+/// Read a checked S24.
+bool
+readS24(const std::uint8_t*& pos, const std::uint8_t* end, std::int32_t& value)
 {
-	char buffer[3];
-	read(buffer,3);
-	uint32_t result = buffer[0] & 0xFF;
-	result |= buffer[1] & 0xFF << 8;
-	result |= buffer[2] & 0xFF << 16;
-	if (result & (1 << 23)) {
-	       	result |= -1 << 24;
-   	}
-
-	return static_cast<std::int32_t>(result);
+    if (end - pos < 3) return false;
+    std::uint32_t result = pos[0] | pos[1] << 8 | pos[2] << 16;
+    if (result & (1 << 23)) result |= 0xFF000000;
+    value = static_cast<std::int32_t>(result);
+    pos += 3;
+    return true;
 }
-	
-/// Read a signed 8-bit character.
-int8_t
-CodeStream::read_s8()
-{
-	char data;
-	read(&data,1);
-	return static_cast<int8_t> (data);
+
 }
 
-/// Read an unsigned 8-bit character.
-std::uint8_t
-CodeStream::read_u8()
+bool
+CodeStream::verify() const
 {
-	char data;
-	read(&data,1);
-	return static_cast<std::uint8_t> (data);
+    // Where instructions start; the end counts as one, as it returns.
+    std::vector<bool> starts(size() + 1);
+    starts[size()] = true;
+
+    // Where jumps go.
+    std::vector<std::int64_t> targets;
+
+    const std::uint8_t* pos = _begin;
+    while (pos != _end) {
+        const std::uint8_t* const op = pos++;
+        starts[op - _begin] = true;
+
+        std::int32_t offset;
+        switch (operands(*op))
+        {
+            case OPERANDS_INVALID:
+                return false;
+
+            case OPERANDS_NONE:
+                break;
+
+            case OPERANDS_U8:
+                if (!skip(pos, _end, 1)) return false;
+                break;
+
+            case OPERANDS_V32:
+                if (!skipV32(pos, _end)) return false;
+                break;
+
+            case OPERANDS_V32_V32:
+                if (!skipV32(pos, _end) || !skipV32(pos, _end)) return false;
+                break;
+
+            case OPERANDS_BRANCH:
+                // Relative to the next instruction.
+                if (!readS24(pos, _end, offset)) return false;
+                targets.push_back((pos - _begin) + std::int64_t(offset));
+                break;
+
+            case OPERANDS_SWITCH:
+            {
+                // The default and each case are relative to the
+                // lookupswitch itself.
+                if (!readS24(pos, _end, offset)) return false;
+                targets.push_back((op - _begin) + std::int64_t(offset));
+
+                std::uint32_t count;
+                if (!readV32(pos, _end, count)) return false;
+                const std::uint64_t cases = count + 1ULL;
+
+                if (static_cast<std::uint64_t>(_end - pos) < cases * 3) {
+                    return false;
+                }
+                for (std::uint64_t i = 0; i < cases; ++i) {
+                    readS24(pos, _end, offset);
+                    targets.push_back((op - _begin) + std::int64_t(offset));
+                }
+                break;
+            }
+
+            case OPERANDS_DEBUG:
+                if (!skip(pos, _end, 1) || !skipV32(pos, _end) ||
+                        !skip(pos, _end, 1) || !skipV32(pos, _end)) {
+                    return false;
+                }
+                break;
+        }
+    }
+
+    for (std::int64_t target : targets) {
+        if (target < 0 || target > static_cast<std::int64_t>(size()) ||
+                !starts[target]) {
+            return false;
+        }
+    }
+    return true;
 }
 
-/// Same as read_V32(), but doesn't bother with the arithmetic for
-/// calculating the value.
-void 
-CodeStream::skip_V32()
+/// Change the current position by a relative value.
+void
+CodeStream::seekBy(int change)
 {
-	// shortcut evalution is mandated as standard.
-	//TODO: Make this more efficient.
-// 	if ((*mCurrent++ & 0x80) && (*mCurrent++ & 0x80) && (*mCurrent++ &0x80)
-// 		&& (*mCurrent++ & 0x80) && (*mCurrent++ & 0x80)){
-// 		return;
-// 	}
-	read_V32();
-	return;
+    if (change < _begin - _pos || change > _end - _pos) {
+        throw CodeStreamException();
+    }
+    _pos += change;
+}
 
+/// Set the current position to an absolute value (relative to the start)
+void
+CodeStream::seekTo(unsigned int set)
+{
+    if (set > size()) throw CodeStreamException();
+    _pos = _begin + set;
 }
 
 } // namespace gnash
-
@@ -1,4 +1,4 @@
-// CodeStream.h A class which allows bounds-checked reading from a char array
+// CodeStream.h A class which reads verified AS3 bytecode
 //
 //   Copyright (C) 2007, 2008, 2009, 2010, 2011, 2012
 //   Free Software Foundation, Inc.
@@ -22,9 +22,9 @@
 
 #include <string>
 #include <boost/utility.hpp>
+#include <cassert>
+#include <cstddef>
 #include <cstdint>
-#include <istream>
-#include <sstream>
 
 namespace gnash {
 
@@ -32,23 +32,55 @@ namespace gnash {
 /// violations.
 class CodeStreamException { };
 
-/// A checked read DisplayObject array
+/// Reads the bytecode of an AS3 method body.
 ///
-/// CodeStream provides a safe interface to read various things from a
-/// DisplayObject array of known size.  Any attempt to access memory outside
-/// of the given array will throw an exception of type CodeStreamException
-class CodeStream : public std::istream, private boost::noncopyable
+/// The code is read straight from memory. Reading operands is not checked
+/// against the end of the code, so verify() must accept the code before
+/// it is run: then every instruction and every operand lies within the
+/// code, and every jump lands on an instruction. Only reading an opcode
+/// at the end of the code, which returns ABC_ACTION_END, and seeking,
+/// which throws a CodeStreamException, are checked.
+class CodeStream : private boost::noncopyable
 {
 public:
-	CodeStream(std::string data): std::istream(new std::stringbuf(data)){
-		
+	explicit CodeStream(std::string data)
+		:
+		_data(std::move(data)),
+		_begin(reinterpret_cast<const std::uint8_t*>(_data.data())),
+		_end(_begin + _data.size()),
+		_pos(_begin)
+	{
 	}
 
+/// Check that the code can be run.
+//
+/// @return false if an opcode is unknown, an instruction runs past the
+///         end of the code or a jump doesn't land on an instruction.
+bool verify() const;
+
 /// Read a variable length encoded 32 bit unsigned integer
-std::uint32_t read_V32();
+std::uint32_t read_V32() {
+	std::uint32_t result = read_u8();
+	if (!(result & 0x00000080)) return result;
+
+	result = (result & 0x0000007F) | read_u8() << 7;
+	if (!(result & 0x00004000)) return result;
+
+	result = (result & 0x00003FFF) | read_u8() << 14;
+	if (!(result & 0x00200000)) return result;
+
+	result = (result & 0x001FFFFF) | read_u8() << 21;
+	if (!(result & 0x10000000)) return result;
+
+	return (result & 0x0FFFFFFF) | read_u8() << 28;
+}
 
 /// Read an opcode for ActionScript 3
-std::uint8_t read_as3op();
+//
+/// @return The opcode, or 0 (ABC_ACTION_END) at the end of the code.
+std::uint8_t read_as3op() {
+	return _pos == _end ? 0 : *_pos++;
+}
 
 /// Change the current position by a relative value.
 void seekBy(int change);
@@ -56,19 +88,53 @@ void seekBy(int change);
 /// Set the current position to an absolute value (relative to the start)
 void seekTo(unsigned int set);
 
+/// The current position, relative to the start.
+std::size_t tell() const {
+	return _pos - _begin;
+}
+
+/// The size of the code.
+std::size_t size() const {
+	return _end - _begin;
+}
+
 ///Read a signed 24 bit interger.
-std::int32_t read_S24();
+std::int32_t read_S24() {
+	std::uint32_t result = read_u8();
+	result |= read_u8() << 8;
+	result |= read_u8() << 16;
+	if (result & (1 << 23)) result |= 0xFF000000;
+	return static_cast<std::int32_t>(result);
+}
 
 /// Read a signed 8-bit character.
-int8_t read_s8();
+std::int8_t read_s8() {
+	return static_cast<std::int8_t>(read_u8());
+}
 
 /// Read an unsigned 8-bit character.
-std::uint8_t read_u8();
+std::uint8_t read_u8() {
+	assert(_pos < _end);
+	return *_pos++;
+}
 
 /// Same as read_V32(), but doesn't bother with the arithmetic for
 /// calculating the value.
-void skip_V32();
+void skip_V32() {
+	for (int i = 0; i < 5; ++i) {
+		if (!(read_u8() & 0x80)) return;
+	}
+}
+
+private:
+
+	const std::string _data;
+
+	const std::uint8_t* const _begin;
+
+	const std::uint8_t* const _end;
 
+	const std::uint8_t* _pos;
 };
 
 } // namespace gnash
@@ -52,10 +52,30 @@ Method::Method()
 {
 }
 
+CodeStream*
+Method::getBody()
+{
+	if (_body || _code.empty()) return _body;
+
+	CodeStream* body = new CodeStream(std::move(_code));
+	_code.clear();
+
+	if (!body->verify()) {
+		IF_VERBOSE_MALFORMED_SWF(
+			log_swferror(_("ABC: Method %u has invalid code; it will "
+					"not be run."), _methodID);
+		);
+		delete body;
+		return NULL;
+	}
+	_body = body;
+	return _body;
+}
+
 void
 Method::print_body()
 {
-		if (!_body) {
+		if (!getBody()) {
 			log_parse("Method has no body.");
 			return;
 		}
@@ -27,6 +27,7 @@
 #include "AbcBlock.h"
 
 #include <map>
+#include <string>
 #include <vector>
 #include <list>
 
@@ -118,7 +119,7 @@ public:
 	asBinding* getBinding(string_table::key name);
 
 	bool isNative() { return _isNative; }
-	bool hasBody() const { return _body != NULL; }
+	bool hasBody() const { return _body != NULL || !_code.empty(); }
 
 	as_object* construct(as_object* /*base_scope*/) {
         // TODO:
@@ -133,8 +134,14 @@ public:
         _needsActivation = true;
     }
 
-	CodeStream *getBody() { return _body; }
-	void setBody(CodeStream *b) { _body = b; }
+	/// Get the code to run, checking it the first time.
+	//
+	/// @return The code, or NULL if there is none or it fails
+	///         CodeStream::verify().
+	CodeStream* getBody();
+
+	/// Set the code, which is only checked when first run.
+	void setCode(std::string code) { _code = std::move(code); }
 
 	bool addValue(string_table::key name, Namespace *ns,
             std::uint32_t slotID, Class *type, as_value& val, bool isconst);
@@ -286,6 +293,10 @@ private:
 	std::list<as_value> _optionalArguments;
 	as_function* _implementation;
 	unsigned char _flags;
+
+	/// The code until getBody() is first called.
+	std::string _code;
+
 	CodeStream* _body;
 	std::uint32_t _maxRegisters;
 
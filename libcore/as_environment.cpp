@@ -55,9 +55,9 @@ namespace {
     /// Untouched if the variable is not found.
     ///
     /// @return true if the variable was found, false otherwise
-    bool getLocal(as_object& locals, const std::string& name, as_value& ret);
+    bool getLocal(as_object& locals, const ObjectURI& name, as_value& ret);
 
-    bool findLocal(as_object& locals, const std::string& varname, as_value& ret,
+    bool findLocal(as_object& locals, const ObjectURI& varname, as_value& ret,
             as_object** retTarget);
 
     /// Delete a local variable
@@ -77,7 +77,7 @@ namespace {
     /// Value to assign to the variable
     ///
     /// @return true if the variable was found, false otherwise
-    bool setLocal(as_object& locals, const std::string& varname,
+    bool setLocal(as_object& locals, const ObjectURI& varname,
         const as_value& val);
 
     as_object* getElement(as_object* obj, const ObjectURI& uri);
@@ -86,11 +86,11 @@ namespace {
     /// If not NULL, the pointer will be set to the actual object containing the
     /// found variable (if found).
     as_value getVariableRaw(const as_environment& env,
-        const std::string& varname,
+        const VariableName& varname,
         const as_environment::ScopeStack& scope,
         as_object** retTarget = nullptr);
 
-    void setVariableRaw(const as_environment& env, const std::string& varname,
+    void setVariableRaw(const as_environment& env, const VariableName& varname,
         const as_value& val, const as_environment::ScopeStack& scope);
 
     // Search for next '.' or '/' character in this word.  Return
@@ -112,53 +112,28 @@ as_environment::as_environment(VM& vm)
 {
 }
 
-as_object*
-findObject(const as_environment& ctx, const std::string& path,
-        const as_environment::ScopeStack* scope)
+ObjectPath::ObjectPath(VM& vm, const std::string& path)
+    :
+    _path(path),
+    _absolute(false),
+    _error(ERROR_NONE),
+    _errorPos(0)
 {
-    if (path.empty()) {
-        return getObject(ctx.target());
-    }
-    
-    VM& vm = ctx.getVM();
-    string_table& st = vm.getStringTable();
-    const int swfVersion = vm.getSWFVersion();
-    ObjectURI globalURI(NSV::PROP_uGLOBAL);
+    if (path.empty()) return;
 
-    bool firstElementParsed = false;
     bool dot_allowed = true;
-
-    // This points to the current object being used for lookup.
-    as_object* env; 
     const char* p = path.c_str();
 
     // Check if it's an absolute path
     if (*p == '/') {
+        _absolute = true;
 
-        MovieClip* root = nullptr;
-        if (ctx.target()) root = ctx.target()->getAsRoot();
-        else {
-            if (ctx.get_original_target()) {
-                root = ctx.get_original_target()->getAsRoot();
-            }
-            return nullptr;
-        }
-
-        // If the path is just "/" return the root.
-        if (!*(++p)) return getObject(root);
+        // If the path is just "/" it's the root.
+        if (!*(++p)) return;
 
-        // Otherwise we start at the root for lookup.
-        env = getObject(root);
-        firstElementParsed = true;
         dot_allowed = false;
-
-    }
-    else {
-        env = getObject(ctx.target());
     }
     
-    assert (*p);
-
     std::string subpart;
 
     while (1) {
@@ -166,11 +141,8 @@ findObject(const as_environment& ctx, const std::string& path,
         // Skip past all colons (why?)
         while (*p == ':') ++p;
 
-        if (!*p) {
-            // No more components to scan, so return the currently found
-            // object.
-            return env;
-        }
+        // No more components to scan.
+        if (!*p) return;
 
         // Search for the next '/', ':' or '.'.
         const char* next_slash = next_slash_or_dot(p);
@@ -178,22 +150,17 @@ findObject(const as_environment& ctx, const std::string& path,
 
         // Check whether p was pointing to one of those characters already.
         if (next_slash == p) {
-            IF_VERBOSE_ASCODING_ERRORS(
-                log_aserror(_("invalid path '%s' (p=next_slash=%s)"),
-                path, next_slash);
-            );
-            return nullptr;
+            _error = ERROR_EMPTY_ELEMENT;
+            _errorPos = next_slash - path.c_str();
+            return;
         }
 
         if (next_slash) {
             if (*next_slash == '.') {
 
                 if (!dot_allowed) {
-                    IF_VERBOSE_ASCODING_ERRORS(
-                        log_aserror(_("invalid path '%s' (dot not allowed "
-                                "after having seen a slash)"), path);
-                    );
-                    return nullptr;
+                    _error = ERROR_DOT_AFTER_SLASH;
+                    return;
                 }
                 // No dot allowed after a double-dot.
                 if (next_slash[1] == '.') dot_allowed = false;
@@ -209,9 +176,113 @@ findObject(const as_environment& ctx, const std::string& path,
         assert(subpart[0] != ':');
 
         // No more components to scan
-        if (subpart.empty()) break;
+        if (subpart.empty()) return;
+
+        _elements.push_back(getURI(vm, subpart));
+
+        if (!next_slash) return;
+        
+        p = next_slash + 1;
+    }
+}
+
+bool
+ObjectPath::error() const
+{
+    switch (_error) {
+        case ERROR_NONE:
+            return false;
+        case ERROR_EMPTY_ELEMENT:
+            IF_VERBOSE_ASCODING_ERRORS(
+                log_aserror(_("invalid path '%s' (p=next_slash=%s)"),
+                    _path, _path.substr(_errorPos));
+            );
+            return true;
+        case ERROR_DOT_AFTER_SLASH:
+            IF_VERBOSE_ASCODING_ERRORS(
+                log_aserror(_("invalid path '%s' (dot not allowed "
+                        "after having seen a slash)"), _path);
+            );
+            return true;
+    }
+    return true;
+}
+
+VariableName::VariableName(VM& vm, const std::string& name)
+    :
+    _name(name),
+    _kind(RAW),
+    _path(vm, std::string()),
+    _validRaw(validRawVariableName(name))
+{
+    std::string path;
+    std::string var;
+
+    if (parsePath(name, path, var)) {
+        _kind = MEMBER;
+        _path = ObjectPath(vm, path);
+        _member = getURI(vm, var);
+        return;
+    }
+
+    if (name.find('/') != std::string::npos &&
+            name.find(':') == std::string::npos) {
+        _kind = SLASH_PATH;
+        _path = ObjectPath(vm, name);
+    }
+
+    if (_validRaw) _raw = getURI(vm, name);
+}
+
+as_object*
+findObject(const as_environment& ctx, const std::string& path,
+        const as_environment::ScopeStack* scope)
+{
+    if (path.empty()) {
+        return getObject(ctx.target());
+    }
+    return findObject(ctx, ObjectPath(ctx.getVM(), path), scope);
+}
+
+as_object*
+findObject(const as_environment& ctx, const ObjectPath& path,
+        const as_environment::ScopeStack* scope)
+{
+    if (path.str().empty()) {
+        return getObject(ctx.target());
+    }
+    
+    VM& vm = ctx.getVM();
+    string_table& st = vm.getStringTable();
+    const int swfVersion = vm.getSWFVersion();
+    ObjectURI globalURI(NSV::PROP_uGLOBAL);
+
+    bool firstElementParsed = false;
+
+    // This points to the current object being used for lookup.
+    as_object* env; 
+
+    // Check if it's an absolute path
+    if (path.absolute()) {
+
+        MovieClip* root = nullptr;
+        if (ctx.target()) root = ctx.target()->getAsRoot();
+        else {
+            if (ctx.get_original_target()) {
+                root = ctx.get_original_target()->getAsRoot();
+            }
+            return nullptr;
+        }
 
-        const ObjectURI subpartURI(getURI(vm, subpart));
+        // We start at the root for lookup.
+        env = getObject(root);
+        firstElementParsed = true;
+    }
+    else {
+        env = getObject(ctx.target());
+    }
+    
+    for (const ObjectURI& subpartURI : path.elements()) {
 
         if (!firstElementParsed) {
             as_object* element(nullptr);
@@ -264,11 +335,12 @@ findObject(const as_environment& ctx, const std::string& path,
             if (!element) return nullptr;
             env = element;
         }
-
-        if (!next_slash) break;
-        
-        p = next_slash + 1;
     }
+
+    // The elements before a malformed part of the path are looked up
+    // anyway, as they may have side effects.
+    if (path.error()) return nullptr;
+
     return env;
 }
 
@@ -289,18 +361,23 @@ as_value
 getVariable(const as_environment& env, const std::string& varname,
         const as_environment::ScopeStack& scope, as_object** retTarget)
 {
-    // Path lookup rigamarole.
-    std::string path;
-    std::string var;
+    return getVariable(env, VariableName(env.getVM(), varname), scope,
+            retTarget);
+}
 
-    if (parsePath(varname, path, var)) {
+as_value
+getVariable(const as_environment& env, const VariableName& varname,
+        const as_environment::ScopeStack& scope, as_object** retTarget)
+{
+    // Path lookup rigamarole.
+    if (varname.kind() == VariableName::MEMBER) {
         // TODO: let find_target return generic as_objects, or use 'with' stack,
         //       see player2.swf or bug #18758 (strip.swf)
-        as_object* target = findObject(env, path, &scope); 
+        as_object* target = findObject(env, varname.path(), &scope); 
 
         if (target) {
             as_value val;
-            target->get_member(getURI(env.getVM(), var), &val);
+            target->get_member(varname.member(), &val);
             if (retTarget) *retTarget = target;
             return val;
         }
@@ -309,11 +386,10 @@ getVariable(const as_environment& env, const std::string& varname,
         }
     }
 
-    if (varname.find('/') != std::string::npos &&
-            varname.find(':') == std::string::npos) {
+    if (varname.kind() == VariableName::SLASH_PATH) {
 
         // Consider it all a path ...
-        as_object* target = findObject(env, varname, &scope); 
+        as_object* target = findObject(env, varname.path(), &scope); 
         if (target) {
             // ... but only if it resolves to a sprite
             DisplayObject* d = target->displayObject();
@@ -327,24 +403,28 @@ getVariable(const as_environment& env, const std::string& varname,
 void
 setVariable(const as_environment& env, const std::string& varname,
     const as_value& val, const as_environment::ScopeStack& scope)
+{
+    setVariable(env, VariableName(env.getVM(), varname), val, scope);
+}
+
+void
+setVariable(const as_environment& env, const VariableName& varname,
+    const as_value& val, const as_environment::ScopeStack& scope)
 {
     IF_VERBOSE_ACTION(
-        log_action(_("-------------- %s = %s"), varname, val);
+        log_action(_("-------------- %s = %s"), varname.str(), val);
     );
 
     // Path lookup rigamarole.
-    std::string path;
-    std::string var;
-
-    if (parsePath(varname, path, var)) {
-        as_object* target = findObject(env, path, &scope); 
+    if (varname.kind() == VariableName::MEMBER) {
+        as_object* target = findObject(env, varname.path(), &scope); 
         if (target) {
-            target->set_member(getURI(env.getVM(), var), val);
+            target->set_member(varname.member(), val);
         }
         else {
             IF_VERBOSE_ASCODING_ERRORS(
             log_aserror(_("Path target '%s' not found while setting %s=%s"),
-                path, varname, val);
+                varname.path().str(), varname.str(), val);
             );
         }
         return;
@@ -377,7 +457,8 @@ delVariable(const as_environment& ctx, const std::string& varname,
     }
 
     // Check locals for deletion.
-    if (vm.calling() && deleteLocal(vm.currentCall().locals(), varname)) {
+    if (vm.calling() && vm.currentCall().hasLocals() &&
+            deleteLocal(vm.currentCall().locals(), varname)) {
         return true;
     }
 
@@ -436,19 +517,20 @@ validRawVariableName(const std::string& varname)
 
 // No path rigamarole.
 void
-setVariableRaw(const as_environment& env, const std::string& varname,
+setVariableRaw(const as_environment& env, const VariableName& varname,
     const as_value& val, const as_environment::ScopeStack& scope)
 {
 
-    if (!validRawVariableName(varname)) {
+    if (!varname.validRaw()) {
         IF_VERBOSE_ASCODING_ERRORS(
-            log_aserror(_("Won't set invalid raw variable name: %s"), varname);
+            log_aserror(_("Won't set invalid raw variable name: %s"),
+                varname.str());
         );
         return;
     }
 
     VM& vm = env.getVM();
-    const ObjectURI& varkey = getURI(vm, varname);
+    const ObjectURI& varkey = varname.raw();
 
     // in SWF5 and lower, scope stack should just contain 'with' elements 
 
@@ -461,8 +543,8 @@ setVariableRaw(const as_environment& env, const std::string& varname,
     }
     
     const int swfVersion = vm.getSWFVersion();
-    if (swfVersion < 6 && vm.calling()) {
-       if (setLocal(vm.currentCall().locals(), varname, val)) return;
+    if (swfVersion < 6 && vm.calling() && vm.currentCall().hasLocals()) {
+       if (setLocal(vm.currentCall().locals(), varkey, val)) return;
     }
     
     // TODO: shouldn't _target be in the scope chain ?
@@ -472,18 +554,19 @@ setVariableRaw(const as_environment& env, const std::string& varname,
     }
     else {
         log_error(_("as_environment::setVariableRaw(%s, %s): neither current target nor original target are defined, can't set the variable"),
-           varname, val);
+           varname.str(), val);
     }
 }
 
 as_value
-getVariableRaw(const as_environment& env, const std::string& varname,
+getVariableRaw(const as_environment& env, const VariableName& varname,
     const as_environment::ScopeStack& scope, as_object** retTarget)
 {
 
-    if (!validRawVariableName(varname)) {
+    if (!varname.validRaw()) {
         IF_VERBOSE_ASCODING_ERRORS(
-            log_aserror(_("Won't get invalid raw variable name: %s"), varname);
+            log_aserror(_("Won't get invalid raw variable name: %s"),
+                varname.str());
         );
         return as_value();
     }
@@ -492,7 +575,7 @@ getVariableRaw(const as_environment& env, const std::string& varname,
 
     VM& vm = env.getVM();
     const int swfVersion = vm.getSWFVersion();
-    const ObjectURI& key = getURI(vm, varname);
+    const ObjectURI& key = varname.raw();
 
     // Check the scope stack.
     for (size_t i = scope.size(); i > 0; --i) {
@@ -506,8 +589,8 @@ getVariableRaw(const as_environment& env, const std::string& varname,
 
     // Check locals for getting them
     // for SWF6 and up locals should be in the scope stack
-    if (swfVersion < 6 && vm.calling()) {
-       if (findLocal(vm.currentCall().locals(), varname, val, retTarget)) {
+    if (swfVersion < 6 && vm.calling() && vm.currentCall().hasLocals()) {
+       if (findLocal(vm.currentCall().locals(), key, val, retTarget)) {
            return val;
        }
     }
@@ -546,7 +629,7 @@ getVariableRaw(const as_environment& env, const std::string& varname,
     as_object* global = vm.getGlobal();
     if (swfVersion > 5 && eq(key, NSV::PROP_uGLOBAL)) {
 #ifdef GNASH_DEBUG_GET_VARIABLE
-        log_debug("Took %s as _global, returning _global", varname);
+        log_debug("Took %s as _global, returning _global", varname.str());
 #endif
         // The "_global" ref was added in SWF6
         if (retTarget) *retTarget = nullptr; // correct ??
@@ -555,7 +638,7 @@ getVariableRaw(const as_environment& env, const std::string& varname,
 
     if (global->get_member(key, &val)) {
 #ifdef GNASH_DEBUG_GET_VARIABLE
-        log_debug("Found %s in _global", varname);
+        log_debug("Found %s in _global", varname.str());
 #endif
         if (retTarget) *retTarget = global;
         return val;
@@ -564,20 +647,21 @@ getVariableRaw(const as_environment& env, const std::string& varname,
     // Fallback.
     // FIXME, should this be log_error?  or log_swferror?
     IF_VERBOSE_ASCODING_ERRORS(
-        log_aserror(_("reference to non-existent variable '%s'"), varname);
+        log_aserror(_("reference to non-existent variable '%s'"),
+            varname.str());
     );
 
     return as_value();
 }
 
 bool
-getLocal(as_object& locals, const std::string& name, as_value& ret)
+getLocal(as_object& locals, const ObjectURI& name, as_value& ret)
 {
-    return locals.get_member(getURI(getVM(locals), name), &ret);
+    return locals.get_member(name, &ret);
 }
 
 bool
-findLocal(as_object& locals, const std::string& varname, as_value& ret,
+findLocal(as_object& locals, const ObjectURI& varname, as_value& ret,
         as_object** retTarget) 
 {
 
@@ -596,9 +680,9 @@ deleteLocal(as_object& locals, const std::string& varname)
 }
 
 bool
-setLocal(as_object& locals, const std::string& varname, const as_value& val)
+setLocal(as_object& locals, const ObjectURI& varname, const as_value& val)
 {
-    Property* prop = locals.getOwnProperty(getURI(getVM(locals), varname));
+    Property* prop = locals.getOwnProperty(varname);
     if (!prop) return false;
     prop->setValue(locals, val);
     return true;
@@ -26,6 +26,7 @@
 #include "dsodefs.h" // for DSOTEXPORT
 #include "as_value.h" 
 #include "SafeStack.h"
+#include "ObjectURI.h"
 
 // Forward declarations
 namespace gnash {
@@ -143,6 +144,137 @@ private:
         
 };
 
+/// A target path split into interned elements.
+//
+/// This is the sequence of lookups findObject() does for a path like
+/// "/a/b", "a.b" or "a:b". A malformed path keeps the elements before
+/// the error, which is reported when the lookup gets there.
+class ObjectPath
+{
+public:
+
+    /// Split a path
+    //
+    /// @param vm       The VM whose string table is used for interning.
+    /// @param path     The path to split.
+    ObjectPath(VM& vm, const std::string& path);
+
+    /// The path as given.
+    const std::string& str() const {
+        return _path;
+    }
+
+    /// Whether the path is relative to the root.
+    bool absolute() const {
+        return _absolute;
+    }
+
+    /// The elements to look up, in order.
+    const std::vector<ObjectURI>& elements() const {
+        return _elements;
+    }
+
+    /// Report the error found while splitting, if any.
+    //
+    /// @return     true if the path is malformed.
+    bool error() const;
+
+private:
+
+    enum Error
+    {
+        ERROR_NONE,
+        ERROR_EMPTY_ELEMENT,
+        ERROR_DOT_AFTER_SLASH
+    };
+
+    std::string _path;
+
+    bool _absolute;
+
+    std::vector<ObjectURI> _elements;
+
+    Error _error;
+
+    /// Where the error was found in the path.
+    size_t _errorPos;
+};
+
+/// A variable name parsed for lookups.
+//
+/// getVariable() and setVariable() need to split names like
+/// "_root.foo.bar" or "/a/b:c" into a target path and a member, and
+/// to intern every part of them. A VariableName does this once, so it
+/// can be reused for all accesses to the same name.
+class VariableName
+{
+public:
+
+    /// How the name is resolved.
+    enum Kind
+    {
+        /// A plain variable name.
+        RAW,
+
+        /// A member of the object at path().
+        MEMBER,
+
+        /// A slash path without a variable, which refers to the
+        /// object at path() if that is a MovieClip and otherwise to a
+        /// plain variable.
+        SLASH_PATH
+    };
+
+    /// Parse a variable name
+    //
+    /// @param vm       The VM whose string table is used for interning.
+    /// @param name     The name to parse.
+    VariableName(VM& vm, const std::string& name);
+
+    /// The name as given.
+    const std::string& str() const {
+        return _name;
+    }
+
+    Kind kind() const {
+        return _kind;
+    }
+
+    /// The target path, for MEMBER and SLASH_PATH names.
+    const ObjectPath& path() const {
+        return _path;
+    }
+
+    /// The member of the target, for MEMBER names.
+    const ObjectURI& member() const {
+        return _member;
+    }
+
+    /// Whether the name is a valid plain variable name.
+    bool validRaw() const {
+        return _validRaw;
+    }
+
+    /// The whole name as a plain variable, if validRaw().
+    const ObjectURI& raw() const {
+        return _raw;
+    }
+
+private:
+
+    std::string _name;
+
+    Kind _kind;
+
+    ObjectPath _path;
+
+    ObjectURI _member;
+
+    bool _validRaw;
+
+    ObjectURI _raw;
+};
+
 /// Return the (possibly undefined) value of the named var.
 //
 /// @param ctx         Timeline context to use for variable finding.
@@ -167,6 +299,18 @@ as_value getVariable(const as_environment& ctx, const std::string& varname,
 void setVariable(const as_environment& ctx, const std::string& path,
     const as_value& val, const as_environment::ScopeStack& scope);
 
+/// Return the (possibly undefined) value of a parsed variable name.
+//
+/// This is equivalent to getVariable() with the name as a string.
+as_value getVariable(const as_environment& ctx, const VariableName& varname,
+    const as_environment::ScopeStack& scope, as_object** retTarget = nullptr);
+
+/// Set the value of a variable by parsed name.
+//
+/// This is equivalent to setVariable() with the name as a string.
+void setVariable(const as_environment& ctx, const VariableName& varname,
+    const as_value& val, const as_environment::ScopeStack& scope);
+
 /// Delete a variable, without support for the path, using a ScopeStack.
 //
 /// @param ctx      Timeline context to use for variable finding.
@@ -208,6 +352,14 @@ DSOEXPORT bool parsePath(const std::string& var_path, std::string& path,
 DSOEXPORT as_object* findObject(const as_environment& ctx, const std::string& path,
         const as_environment::ScopeStack* scope = nullptr);
 
+/// Find the object referenced by the given split path.
+//
+/// @param ctx     Timeline context to use for variable finding.
+/// @param path    Split variable path.
+/// @param scope   The Scope stack to use for lookups.
+as_object* findObject(const as_environment& ctx, const ObjectPath& path,
+        const as_environment::ScopeStack* scope = nullptr);
+
 /// Find the DisplayObject referenced by the given path.
 //
 /// Supports both /slash/syntax and dot.syntax. This is a wrapper round
@@ -111,6 +111,9 @@ protected:
     /// Construct a function.
 	as_function(Global_as& gl);
 
+    /// Functions only hold references of their own in derived classes.
+    virtual bool hasWriteBarrier() const { return !relay(); }
+
 };
 
 
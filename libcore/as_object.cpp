@@ -21,6 +21,7 @@
 
 #include <set>
 #include <string>
+#include <typeinfo>
 #include <boost/algorithm/string/case_conv.hpp>
 #include <utility> // for std::pair
 
@@ -359,6 +360,7 @@ as_object::add_property(const std::string& name, as_function& getter,
                 log_debug("Property %s deleted by trigger on create (getter-setter)", name);
                 return;
             }
+            getRoot(*this).gc().writeBarrier(v);
             prop->setCache(v);
         }
         return;
@@ -440,6 +442,34 @@ as_object::get_member(const ObjectURI& uri, as_value* val)
     }
 }
 
+bool
+as_object::get_member(const ObjectURI& uri, as_value* val,
+        PropertyCache& cache)
+{
+    assert(val);
+
+    const int version = getSWFVersion(*this);
+
+    // Caseless lookups aren't cached.
+    if (version > 6) {
+        Property* prop = _members.getCachedProperty(uri, cache);
+        if (prop && visible(*prop, version)) {
+            try {
+                *val = prop->getValue(*this);
+                return true;
+            }
+            catch (const ActionTypeError& exc) {
+                IF_VERBOSE_ASCODING_ERRORS(
+                    log_aserror(_("Caught exception: %s"), exc.what());
+                );
+                return false;
+            }
+        }
+    }
+
+    return get_member(uri, val);
+}
+
 
 as_object*
 as_object::get_super(const ObjectURI& fname)
@@ -664,6 +694,35 @@ as_object::set_member(const ObjectURI& uri, const as_value& val, bool ifFound)
     return false;
 }
 
+bool
+as_object::set_member(const ObjectURI& uri, const as_value& val,
+        PropertyCache& cache)
+{
+    const int version = getSWFVersion(*this);
+
+    // Text field variables, array lengths and watches need the full
+    // treatment of set_member(). Caseless lookups aren't cached.
+    if (displayObject() || array() || _trigs.get() || version < 7) {
+        return set_member(uri, val);
+    }
+
+    Property* prop = _members.getCachedProperty(uri, cache);
+    if (!prop || readOnly(*prop)) return set_member(uri, val);
+
+    try {
+        prop->setValue(*this, val);
+        prop->clearVisible(version);
+    }
+    catch (const ActionTypeError& exc) {
+        IF_VERBOSE_ASCODING_ERRORS(
+            log_aserror(
+            _("%s: %s"), getStringTable(*this).value(getName(uri)), exc.what());
+        );
+    }
+
+    return true;
+}
+
 
 void
 as_object::init_member(const std::string& key1, const as_value& val, int flags)
@@ -761,10 +820,29 @@ as_object::addInterface(as_object* obj)
     assert(obj);
     if (std::find(_interfaces.begin(), _interfaces.end(), obj) ==
         _interfaces.end()) {
+        getRoot(*this).gc().writeBarrier(*obj);
         _interfaces.push_back(obj);
     }
 }
 
+void
+as_object::setRelay(Relay* p)
+{
+    if (p) _array = false;
+    if (_relay) _relay->clean();
+    _relay.reset(p);
+
+    // A Relay changes its references without a write barrier.
+    if (p) getRoot(*this).gc().rescan(*this);
+}
+
+void
+as_object::setDisplayObject(DisplayObject* d)
+{
+    if (d) getRoot(*this).gc().writeBarrier(*d);
+    _displayObject = d;
+}
+
 bool
 as_object::instanceOf(as_object* ctor)
 {
@@ -977,12 +1055,14 @@ as_object::watch(const ObjectURI& uri, as_function& trig,
 
     if (!_trigs.get()) _trigs.reset(new TriggerContainer);
 
+    const Trigger t(propname, trig, cust);
+    getRoot(*this).gc().writeBarrier(t);
+
     TriggerContainer::iterator it = _trigs->find(uri);
     if (it == _trigs->end()) {
-        return _trigs->insert(
-            std::make_pair(uri, Trigger(propname, trig, cust))).second;
+        return _trigs->insert(std::make_pair(uri, t)).second;
     }
-    it->second = Trigger(propname, trig, cust);
+    it->second = t;
     return true;
 }
 
@@ -1028,6 +1108,12 @@ as_object::markReachableResources() const
     if (_displayObject) _displayObject->setReachable();
 }
 
+bool
+as_object::hasWriteBarrier() const
+{
+    return !_relay && typeid(*this) == typeid(as_object);
+}
+
 void
 Trigger::setReachable() const
 {
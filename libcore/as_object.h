@@ -228,6 +228,18 @@ public:
     virtual bool set_member(const ObjectURI& uri, const as_value& val,
         bool ifFound = false);
 
+    /// Set a member value through a call site cache
+    //
+    /// This is equivalent to set_member(), but an existing plain member
+    /// found through the cache is set without a lookup.
+    //
+    /// @param uri      Property identifier.
+    /// @param val      Value to assign to the named property.
+    /// @param cache    The property cache of the call site.
+    /// @return         As set_member().
+    bool set_member(const ObjectURI& uri, const as_value& val,
+            PropertyCache& cache);
+
     /// Initialize a member value by string
     //
     /// This is just a wrapper around the other init_member method
@@ -426,6 +438,18 @@ public:
     /// @return         true if the named property was found, false otherwise.
     virtual bool get_member(const ObjectURI& uri, as_value* val);
 
+    /// Get a property by name through a call site cache
+    //
+    /// This is equivalent to get_member(), but an own property found
+    /// through the cache is returned without a lookup.
+    //
+    /// @param uri      Property identifier.
+    /// @param val      Variable to assign an existing value to.
+    /// @param cache    The property cache of the call site.
+    /// @return         As get_member().
+    bool get_member(const ObjectURI& uri, as_value* val,
+            PropertyCache& cache);
+
     /// Get the super object of this object.
     ///
     /// The super should be __proto__ if this is a prototype object
@@ -601,11 +625,7 @@ public:
     /// This function also removes Array typing from an object when a Relay
     /// is assigned. There are tests verifying this behaviour in
     /// actionscript.all and the swfdec testsuite.
-    void setRelay(Relay* p) {
-        if (p) _array = false;
-        if (_relay) _relay->clean();
-        _relay.reset(p);
-    }
+    void setRelay(Relay* p);
 
     /// Access the as_object's Relay object.
     //
@@ -640,9 +660,7 @@ public:
     }
 
     /// Set the DisplayObject associated with this as_object.
-    void setDisplayObject(DisplayObject* d) {
-        _displayObject = d;
-    }
+    void setDisplayObject(DisplayObject* d);
 
 protected:
 
@@ -667,6 +685,17 @@ protected:
     /// this function directly as the last step.
     virtual void markReachableResources() const;
 
+    /// Whether all references of this object go through a write barrier
+    //
+    /// This is true of plain objects, which only change their references
+    /// through PropertyList and the functions of this class. Relays may
+    /// hold references of their own, and so may derived classes, which
+    /// are scanned again at the end of each mark unless they override
+    /// this. They should only do so if every reference they mark in
+    /// markReachableResources() is set while they are constructed or
+    /// passed to GC::writeBarrier().
+    virtual bool hasWriteBarrier() const;
+
 private:
 
     /// Find an existing property for update
@@ -223,6 +223,27 @@ as_value::to_string(int version) const
             return "null";
         case BOOLEAN:
             return getBool() ? "true" : "false";
+        case OBJECT:
+            return toSharedString(version).str();
+
+        default:
+            return "[exception]";
+    }
+    
+}
+
+SharedString
+as_value::toSharedString(int version) const
+{
+    switch (_type)
+    {
+        case STRING:
+        {
+            SharedString ret;
+            ret._rep = _value.str;
+            SharedString::acquire(ret._rep);
+            return ret;
+        }
         case OBJECT:
         {
             as_object* obj = getObj();
@@ -230,22 +251,20 @@ as_value::to_string(int version) const
             if (isNativeType(obj, s)) return s->value();
 
             try {
-                as_value ret = to_primitive(STRING);
+                const as_value ret = to_primitive(STRING);
                 // This additional is_string test is NOT compliant with ECMA-262
                 // specification, but seems required for compatibility with the
                 // reference player.
-                if (ret.is_string()) return ret.getStr();
+                if (ret.is_string()) return ret.toSharedString(version);
             }
             catch (const ActionTypeError& e) {}
            
-            return is_function() ? "[type Function]" : "[type Object]";
-
+            return SharedString(is_function() ? "[type Function]" :
+                    "[type Object]");
         }
-
         default:
-            return "[exception]";
+            return SharedString(to_string(version));
     }
-    
 }
 
 as_value::AsType
@@ -462,7 +481,7 @@ as_value::to_object(VM& vm) const
             return getObject(toDisplayObject());
 
         case STRING:
-            return constructObject(vm, getStr(), NSV::CLASS_STRING);
+            return constructObject(vm, *this, NSV::CLASS_STRING);
 
         case NUMBER:
             return constructObject(vm, getNum(), NSV::CLASS_NUMBER);
@@ -518,15 +537,15 @@ as_value::get_object() const
 void
 as_value::set_undefined()
 {
+    release();
     _type = UNDEFINED;
-    _value = boost::blank();
 }
 
 void
 as_value::set_null()
 {
+    release();
     _type = NULLTYPE;
-    _value = boost::blank();
 }
 
 void
@@ -540,15 +559,20 @@ as_value::set_as_object(as_object* obj)
     if (obj->displayObject()) {
         // The static cast is fine as long as the as_object is genuinely
         // a DisplayObject.
+        DisplayObject* d = obj->displayObject();
+        if (_type == DISPLAYOBJECT && _value.proxy->proxy.get(true) == d) {
+            return;
+        }
+        SharedProxy* proxy = new SharedProxy(CharacterProxy(d, getRoot(*obj)));
+        release();
         _type = DISPLAYOBJECT;
-        _value = CharacterProxy(obj->displayObject(), getRoot(*obj));
+        _value.proxy = proxy;
         return;
     }
 
-    if (_type != OBJECT || getObj() != obj) {
-        _type = OBJECT;
-        _value = obj;
-    }
+    release();
+    _type = OBJECT;
+    _value.obj = obj;
 }
 
 bool
@@ -658,9 +682,13 @@ as_value::equalsSameType(const as_value& v) const
             return true;
 
         case OBJECT:
+            return getObj() == v.getObj();
+
         case BOOLEAN:
+            return getBool() == v.getBool();
+
         case STRING:
-            return _value == v._value;
+            return SharedString::equal(_value.str, v._value.str);
 
         case DISPLAYOBJECT:
             return toDisplayObject() == v.toDisplayObject(); 
@@ -700,8 +728,7 @@ as_value::setReachable() const
         }
         case DISPLAYOBJECT:
         {
-            CharacterProxy sp = getCharacterProxy();
-            sp.setReachable();
+            getCharacterProxy().setReachable();
             break;
         }
         default: break;
@@ -712,14 +739,14 @@ as_object*
 as_value::getObj() const
 {
     assert(_type == OBJECT);
-    return boost::get<as_object*>(_value);
+    return _value.obj;
 }
 
-CharacterProxy
+const CharacterProxy&
 as_value::getCharacterProxy() const
 {
     assert(_type == DISPLAYOBJECT);
-    return boost::get<CharacterProxy>(_value);
+    return _value.proxy->proxy;
 }
 
 DisplayObject*
@@ -731,22 +758,27 @@ as_value::getCharacter(bool allowUnloaded) const
 void
 as_value::set_string(const std::string& str)
 {
+    // The string may be our own.
+    SharedString::Rep* rep = SharedString::share(str);
+    release();
     _type = STRING;
-    _value = str;
+    _value.str = rep;
 }
 
 void
 as_value::set_double(double val)
 {
+    release();
     _type = NUMBER;
-    _value = val;
+    _value.num = val;
 }
 
 void
 as_value::set_bool(bool val)
 {
+    release();
     _type = BOOLEAN;
-    _value = val;
+    _value.flag = val;
 }
 
 bool
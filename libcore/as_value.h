@@ -21,7 +21,6 @@
 
 #include <limits>
 #include <string>
-#include <boost/variant.hpp>
 #include <iosfwd> // for inlined output operator
 #include <type_traits>
 #include <cstdint>
@@ -29,6 +28,7 @@
 #include "dsodefs.h" // for DSOTEXPORT
 #include "CharacterProxy.h"
 #include "GnashNumeric.h" // for isNaN
+#include "SharedString.h"
 
 
 // Forward declarations
@@ -118,58 +118,76 @@ public:
     /// Construct an undefined value
     DSOEXPORT as_value()
         :
-        _type(UNDEFINED),
-        _value(boost::blank())
+        _type(UNDEFINED)
     {
+        _value.num = 0;
     }
     
     /// Copy constructor.
+    //
+    /// Strings and DisplayObject references are shared, not copied.
     DSOEXPORT as_value(const as_value& v)
         :
         _type(v._type),
         _value(v._value)
     {
+        acquire();
     }
 
     /// Move constructor.
     DSOEXPORT as_value(as_value&& other)
         : _type(other._type),
-          _value(std::move(other._value))
+          _value(other._value)
     {
         other._type = UNDEFINED;
     }
 
-    ~as_value() {}
+    ~as_value() {
+        release();
+    }
     
     /// Construct a primitive String value 
     DSOEXPORT as_value(const char* str)
         :
-        _type(STRING),
-        _value(std::string(str))
-    {}
+        _type(STRING)
+    {
+        _value.str = SharedString::share(str);
+    }
 
     /// Construct a primitive String value 
     DSOEXPORT as_value(std::string str)
         :
-        _type(STRING),
-        _value(std::move(str))
-    {}
+        _type(STRING)
+    {
+        _value.str = SharedString::share(std::move(str));
+    }
+
+    /// Construct a primitive String value sharing a string
+    DSOEXPORT as_value(const SharedString& str)
+        :
+        _type(STRING)
+    {
+        _value.str = str._rep;
+        acquire();
+    }
     
     /// Construct a primitive Boolean value
     template <typename T, typename U =
         typename std::enable_if<std::is_same<bool, T>::value>::type>
     as_value(T val)
         :
-        _type(BOOLEAN),
-        _value(val)
-    {}
+        _type(BOOLEAN)
+    {
+        _value.flag = val;
+    }
 
     /// Construct a primitive Number value
     as_value(double num)
         :
-        _type(NUMBER),
-        _value(num)
-    {}
+        _type(NUMBER)
+    {
+        _value.num = num;
+    }
     
     /// Construct a null, Object, or DisplayObject value
     as_value(as_object* obj)
@@ -182,6 +200,8 @@ public:
     /// Assign to an as_value.
     DSOEXPORT as_value& operator=(const as_value& v)
     {
+        v.acquire();
+        release();
         _type = v._type;
         _value = v._value;
         return *this;
@@ -189,9 +209,12 @@ public:
 
     DSOEXPORT as_value& operator=(as_value&& other)
     {
-        _type = other._type;
-        _value = std::move(other._value);
-        other._type = UNDEFINED;
+        if (this != &other) {
+            release();
+            _type = other._type;
+            _value = other._value;
+            other._type = UNDEFINED;
+        }
         return *this;
     }
 
@@ -234,6 +257,17 @@ public:
     //
     /// TODO: drop the default argument.
     DSOTEXPORT std::string to_string(int version = 7) const;
+
+    /// Get a string representation for this value, as to_string() does.
+    //
+    /// The string of a String value or object is shared rather than
+    /// copied, and a rope isn't read.
+    DSOTEXPORT SharedString toSharedString(int version) const;
+
+    /// The SharedString::identity() of a String value, otherwise null.
+    const void* stringIdentity() const {
+        return _type == STRING ? _value.str : nullptr;
+    }
     
     /// Get a number representation for this value
     //
@@ -410,22 +444,58 @@ public:
 
 private:
 
-    /// AsValueType handles the following AS types:
+    /// A CharacterProxy shared by the copies of a DisplayObject value.
+    struct SharedProxy
+    {
+        explicit SharedProxy(const CharacterProxy& p) : refs(1), proxy(p) {}
+        size_t refs;
+        const CharacterProxy proxy;
+    };
+
+    /// The value of each type, including its exception type.
     //
-    /// 1. undefined / null
-    /// 2. Number
-    /// 3. Boolean
-    /// 4. Object
-    /// 5. MovieClip
-    /// 6. String
-    typedef boost::variant<boost::blank,
-                           double,
-                           bool,
-                           as_object*,
-                           CharacterProxy,
-                           std::string>
-    AsValueType;
-    
+    /// Strings and SharedProxies are counted references.
+    union Value
+    {
+        double num;
+        bool flag;
+        as_object* obj;
+        SharedProxy* proxy;
+        SharedString::Rep* str;
+    };
+
+    /// Take a reference to the shared part of this value, if any.
+    void acquire() const {
+        switch (_type) {
+            case STRING:
+            case STRING_EXCEPT:
+                SharedString::acquire(_value.str);
+                break;
+            case DISPLAYOBJECT:
+            case DISPLAYOBJECT_EXCEPT:
+                ++_value.proxy->refs;
+                break;
+            default:
+                break;
+        }
+    }
+
+    /// Drop the reference to the shared part of this value, if any.
+    void release() {
+        switch (_type) {
+            case STRING:
+            case STRING_EXCEPT:
+                SharedString::release(_value.str);
+                break;
+            case DISPLAYOBJECT:
+            case DISPLAYOBJECT_EXCEPT:
+                if (!--_value.proxy->refs) delete _value.proxy;
+                break;
+            default:
+                break;
+        }
+    }
+
     /// Use the relevant equality function, not operator==
     bool operator==(const as_value& v) const;
     
@@ -440,45 +510,45 @@ private:
     
     AsType _type;
     
-    AsValueType _value;
+    Value _value;
     
-    /// Get the object pointer variant member.
+    /// Get the object pointer member.
     //
     /// Callers must check that this is an Object (including DisplayObjects).
     as_object* getObj() const;
     
-    /// Get the DisplayObject variant member.
+    /// Get the DisplayObject member.
     //
     /// The caller must check that this is a DisplayObject.
     DisplayObject* getCharacter(bool skipRebinding = false) const;
 
-    /// Get the DisplayObject proxy variant member.
+    /// Get the DisplayObject proxy member.
     //
     /// The caller must check that this value is a DisplayObject
-    CharacterProxy getCharacterProxy() const;
+    const CharacterProxy& getCharacterProxy() const;
 
-    /// Get the number variant member.
+    /// Get the number member.
     //
     /// The caller must check that this value is a Number.
     double getNum() const {
         assert(_type == NUMBER);
-        return boost::get<double>(_value);
+        return _value.num;
     }
     
-    /// Get the boolean variant member.
+    /// Get the boolean member.
     //
     /// The caller must check that this value is a Boolean.
     bool getBool() const {
         assert(_type == BOOLEAN);
-        return boost::get<bool>(_value);
+        return _value.flag;
     }
 
-    /// Get the boolean variant member.
+    /// Get the boolean member.
     //
     /// The caller must check that this value is a String.
     const std::string& getStr() const {
         assert(_type == STRING);
-        return boost::get<std::string>(_value);
+        return SharedString::str(_value.str);
     }
     
 };
@@ -21,6 +21,7 @@
 #include "Array_as.h"
 
 #include <string>
+#include <list>
 #include <algorithm>
 #include <cmath>
 #include <functional>
@@ -69,11 +69,11 @@ namespace {
             const std::string& function);
 
     inline int getStringVersioned(const fn_call& fn, const as_value& arg,
-            std::string& str);
+            SharedString& str);
 
 }
 
-String_as::String_as(std::string s)
+String_as::String_as(SharedString s)
     :
     _string(std::move(s))
 {
@@ -154,11 +154,11 @@ string_concat(const fn_call& fn)
 {
     as_value val(fn.this_ptr);
 
-    std::string str;
+    SharedString str;
     const int version = getStringVersioned(fn, val, str);
 
     for (size_t i = 0; i < fn.nargs; i++) {
-        str += fn.arg(i).to_string(version);
+        str = str + fn.arg(i).toSharedString(version);
     }
 
     return as_value(str);
@@ -171,8 +171,9 @@ string_slice(const fn_call& fn)
 {
     as_value val(fn.this_ptr);
     
-    std::string str;
-    const int version = getStringVersioned(fn, val, str);
+    SharedString shared;
+    const int version = getStringVersioned(fn, val, shared);
+    const std::string& str = shared.str();
 
     std::wstring wstr = utf8::decodeCanonicalString(str, version);
 
@@ -226,8 +227,9 @@ string_split(const fn_call& fn)
 {
     as_value val(fn.this_ptr);
     
-    std::string str;
-    const int version = getStringVersioned(fn, val, str);
+    SharedString shared;
+    const int version = getStringVersioned(fn, val, shared);
+    const std::string& str = shared.str();
     
     std::wstring wstr = utf8::decodeCanonicalString(str, version);
 
@@ -237,7 +239,7 @@ string_split(const fn_call& fn)
     if (fn.nargs == 0)
     {
         // Condition 1:
-        callMethod(array, NSV::PROP_PUSH, str);
+        callMethod(array, NSV::PROP_PUSH, shared);
         return as_value(array);
     }
 
@@ -249,7 +251,7 @@ string_split(const fn_call& fn)
         (version >= 6 && fn.arg(0).is_undefined()))
     {
         // Condition 2:
-        callMethod(array, NSV::PROP_PUSH, str);
+        callMethod(array, NSV::PROP_PUSH, shared);
         return as_value(array);
     }
 
@@ -273,7 +275,7 @@ string_split(const fn_call& fn)
         {
             // Condition 3 (plus a shortcut if the string itself
             // is empty).
-            callMethod(array, NSV::PROP_PUSH, str);
+            callMethod(array, NSV::PROP_PUSH, shared);
             return as_value(array);            
         }
     }
@@ -285,7 +287,7 @@ string_split(const fn_call& fn)
             // If the string itself is empty, SWF6 returns a 0-sized
             // array only if the delimiter is also empty. Otherwise
             // it returns an array with 1 empty element.
-            if (delimiterSize) callMethod(array, NSV::PROP_PUSH, str);
+            if (delimiterSize) callMethod(array, NSV::PROP_PUSH, shared);
             return as_value(array);
         }
 
@@ -341,8 +343,9 @@ string_lastIndexOf(const fn_call& fn)
 {
     as_value val(fn.this_ptr);
     
-    std::string str;
-    const int version = getStringVersioned(fn, val, str);
+    SharedString shared;
+    const int version = getStringVersioned(fn, val, shared);
+    const std::string& str = shared.str();
     const std::wstring& wstr = utf8::decodeCanonicalString(str, version);
 
     if (!checkArgs(fn, 1, 2, "String.lastIndexOf()")) return as_value(-1);
@@ -379,12 +382,13 @@ string_substr(const fn_call& fn)
 {
     as_value val(fn.this_ptr);
     
-    std::string str;
-    const int version = getStringVersioned(fn, val, str);
+    SharedString shared;
+    const int version = getStringVersioned(fn, val, shared);
+    const std::string& str = shared.str();
 
     std::wstring wstr = utf8::decodeCanonicalString(str, version);
 
-    if (!checkArgs(fn, 1, 2, "String.substr()")) return as_value(str);
+    if (!checkArgs(fn, 1, 2, "String.substr()")) return as_value(shared);
     
     int start = validIndex(wstr, toInt(fn.arg(0), getVM(fn)));
 
@@ -417,8 +421,9 @@ string_substring(const fn_call& fn)
 {
     as_value val(fn.this_ptr);
     
-    std::string str;
-    const int version = getStringVersioned(fn, val, str);
+    SharedString shared;
+    const int version = getStringVersioned(fn, val, shared);
+    const std::string& str = shared.str();
 
     const std::wstring& wstr = utf8::decodeCanonicalString(str, version);
 
@@ -471,8 +476,9 @@ string_indexOf(const fn_call& fn)
  
     /// Do not return before this, because the toString method should always
     /// be called. (TODO: test).   
-    std::string str;
-    const int version = getStringVersioned(fn, val, str);
+    SharedString shared;
+    const int version = getStringVersioned(fn, val, shared);
+    const std::string& str = shared.str();
 
     if (!checkArgs(fn, 1, 2, "String.indexOf")) return as_value(-1);
 
@@ -559,8 +565,9 @@ string_charCodeAt(const fn_call& fn)
 {
     as_value val(fn.this_ptr);
     
-    std::string str;
-    const int version = getStringVersioned(fn, val, str);
+    SharedString shared;
+    const int version = getStringVersioned(fn, val, shared);
+    const std::string& str = shared.str();
 
     const std::wstring& wstr = utf8::decodeCanonicalString(str, version);
 
@@ -595,8 +602,9 @@ string_charAt(const fn_call& fn)
 {
     as_value val(fn.this_ptr);
     
-    std::string str;
-    const int version = getStringVersioned(fn, val, str);
+    SharedString shared;
+    const int version = getStringVersioned(fn, val, shared);
+    const std::string& str = shared.str();
 
     if (!checkArgs(fn, 1, 1, "String.charAt()")) return as_value("");
 
@@ -629,8 +637,9 @@ string_toUpperCase(const fn_call& fn)
 {
     as_value val(fn.this_ptr);
 
-    std::string str;
-    const int version = getStringVersioned(fn, val, str);
+    SharedString shared;
+    const int version = getStringVersioned(fn, val, shared);
+    const std::string& str = shared.str();
 
     std::wstring wstr = utf8::decodeCanonicalString(str, version);
 
@@ -655,8 +664,9 @@ string_toLowerCase(const fn_call& fn)
 {
     as_value val(fn.this_ptr);
     
-    std::string str;
-    const int version = getStringVersioned(fn, val, str);
+    SharedString shared;
+    const int version = getStringVersioned(fn, val, shared);
+    const std::string& str = shared.str();
 
     std::wstring wstr = utf8::decodeCanonicalString(str, version);
 
@@ -721,10 +731,10 @@ string_ctor(const fn_call& fn)
 {
     const int version = getSWFVersion(fn);
 
-    std::string str;
+    SharedString str;
 
     if (fn.nargs) {
-        str = fn.arg(0).to_string(version);
+        str = fn.arg(0).toSharedString(version);
     }
 
     if (!fn.isInstantiation())
@@ -735,14 +745,15 @@ string_ctor(const fn_call& fn)
     as_object* obj = fn.this_ptr;
 
     obj->setRelay(new String_as(str));
-    std::wstring wstr = utf8::decodeCanonicalString(str, getSWFVersion(fn));
+    std::wstring wstr = utf8::decodeCanonicalString(str.str(),
+            getSWFVersion(fn));
     obj->init_member(NSV::PROP_LENGTH, wstr.size(), as_object::DefaultFlags);
 
     return as_value();
 }
     
 inline int
-getStringVersioned(const fn_call& fn, const as_value& val, std::string& str)
+getStringVersioned(const fn_call& fn, const as_value& val, SharedString& str)
 {
 
     /// version to use is the one of the SWF containing caller code.
@@ -759,7 +770,7 @@ getStringVersioned(const fn_call& fn, const as_value& val, std::string& str)
     const int version = fn.callerDef ? fn.callerDef->get_version() :
         getSWFVersion(fn);
     
-    str = val.to_string(version);
+    str = val.toSharedString(version);
 
     return version;
 
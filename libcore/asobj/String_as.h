@@ -21,8 +21,8 @@
 #ifndef GNASH_STRING_H
 #define GNASH_STRING_H
 
-#include <string>
 #include "Relay.h"
+#include "SharedString.h"
 
 namespace gnash {
 
@@ -35,14 +35,14 @@ class String_as : public Relay
 
 public:
 
-    explicit String_as(std::string s);
+    explicit String_as(SharedString s);
 
-    const std::string& value() {
+    const SharedString& value() const {
         return _string;
     }
 
 private:
-    std::string _string;
+    const SharedString _string;
 };
 
 /// Initialize the global String class
@@ -51,6 +51,7 @@
 #include "IOChannel.h"
 #include "RunResources.h"
 #include "Renderer.h"
+#include "BitmapCache.h"
 #include "ExternalInterface.h"
 #include "TextField.h"
 #include "Button.h"
@@ -1016,28 +1017,34 @@ movie_root::display()
     Renderer* renderer = _runResources.renderer();
     if (!renderer) return;
 
-    Renderer::External ex(*renderer, m_background_color,
-            _stageWidth, _stageHeight,
-            frame_size.get_x_min(), frame_size.get_x_max(),
-            frame_size.get_y_min(), frame_size.get_y_max());
+    {
+        Renderer::External ex(*renderer, m_background_color,
+                _stageWidth, _stageHeight,
+                frame_size.get_x_min(), frame_size.get_x_max(),
+                frame_size.get_y_min(), frame_size.get_y_max());
 
-    for (auto& elem : _movies) {
-        MovieClip* movie = elem.second;
+        for (auto& elem : _movies) {
+            MovieClip* movie = elem.second;
 
-        movie->clear_invalidated();
+            movie->clear_invalidated();
 
-        if (movie->visible() == false) continue;
+            if (movie->visible() == false) continue;
 
-        // null frame size ? don't display !
-        const SWFRect& sub_frame_size = movie->get_frame_size();
+            // null frame size ? don't display !
+            const SWFRect& sub_frame_size = movie->get_frame_size();
 
-        if (sub_frame_size.is_null()) {
-            log_debug("_level%u has null frame size, skipping", elem.first);
-            continue;
-        }
+            if (sub_frame_size.is_null()) {
+                log_debug("_level%u has null frame size, skipping",
+                        elem.first);
+                continue;
+            }
 
-        movie->display(*renderer, Transform());
+            movie->display(*renderer, Transform());
+        }
     }
+
+    // The frame is drawn, so bitmaps it used can go.
+    BitmapCache::getDefaultInstance().trim();
 }
 
 bool
@@ -1803,15 +1810,11 @@ movie_root::markReachableResources() const
 
     // NOTE: cleanupDisplayList() should have cleaned up all
     // unloaded live characters. The remaining ones should be marked
-    // by their parents.
-#if ( GNASH_PARANOIA_LEVEL > 1 ) || defined(ALLOW_GC_RUN_DURING_ACTIONS_EXECUTION)
+    // by their parents, which are only queued for scanning here.
+#ifdef ALLOW_GC_RUN_DURING_ACTIONS_EXECUTION
     for (LiveChars::const_iterator i=_liveChars.begin(), e=_liveChars.end();
             i!=e; ++i) {
-#ifdef ALLOW_GC_RUN_DURING_ACTIONS_EXECUTION
         (*i)->setReachable();
-#else
-        assert((*i)->isReachable());
-#endif
     }
 #endif
 
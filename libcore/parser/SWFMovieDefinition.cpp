@@ -36,6 +36,7 @@
 #include "GnashSleep.h"
 #include "movie_definition.h" 
 #include "zlib_adapter.h"
+#include "lzma_adapter.h"
 #include "IOChannel.h"
 #include "SWFStream.h"
 #include "RunResources.h"
@@ -52,6 +53,7 @@
 #include "namedStrings.h"
 #include "as_function.h"
 #include "CachedBitmap.h"
+#include "Renderer.h"
 #include "TypesParser.h"
 #include "GnashImageJpeg.h"
 
@@ -206,18 +208,56 @@ SWFMovieDefinition::get_font(const std::string& name, bool bold, bool italic)
 CachedBitmap*
 SWFMovieDefinition::getBitmap(int id) const
 {
-    const Bitmaps::const_iterator it = _bitmaps.find(id);
-    if (it == _bitmaps.end()) return nullptr;
-    return it->second.get();
+    LazyBitmap* lazy;
+    {
+        std::lock_guard<std::mutex> lock(_bitmapsMutex);
+
+        const Bitmaps::const_iterator it = _bitmaps.find(id);
+        if (it != _bitmaps.end()) return it->second.get();
+
+        const LazyBitmaps::const_iterator l = _lazyBitmaps.find(id);
+        if (l == _lazyBitmaps.end()) return nullptr;
+
+        // Bitmaps are never removed, so this stays valid after
+        // unlocking. Decoding without the lock lets the loader go on
+        // adding bitmaps.
+        lazy = l->second.get();
+    }
+
+    Renderer* renderer = _runResources.renderer();
+    if (!renderer) {
+        IF_VERBOSE_PARSE(
+            log_parse(_("No renderer, not decoding bitmap %1%"), id)
+        );
+        return nullptr;
+    }
+    return lazy->get(*renderer);
+}
+
+bool
+SWFMovieDefinition::hasBitmap(int id) const
+{
+    std::lock_guard<std::mutex> lock(_bitmapsMutex);
+    return _bitmaps.count(id) || _lazyBitmaps.count(id);
 }
 
 void
 SWFMovieDefinition::addBitmap(int id, boost::intrusive_ptr<CachedBitmap> im)
 {
     assert(im);
+    std::lock_guard<std::mutex> lock(_bitmapsMutex);
     _bitmaps.insert(std::make_pair(id, im));
 }
 
+void
+SWFMovieDefinition::addBitmap(int id, std::unique_ptr<LazyBitmap> im)
+{
+    assert(im);
+    std::lock_guard<std::mutex> lock(_bitmapsMutex);
+    if (_bitmaps.count(id)) return;
+    _lazyBitmaps.insert(std::make_pair(id, std::move(im)));
+}
+
 sound_sample*
 SWFMovieDefinition::get_sound_sample(int id) const
 {
@@ -261,13 +301,15 @@ SWFMovieDefinition::readHeader(std::unique_ptr<IOChannel> in,
 
     m_version = (header >> 24) & 255;
     if ((header & 0x0FFFFFF) != 0x00535746
-        && (header & 0x0FFFFFF) != 0x00535743) {
+        && (header & 0x0FFFFFF) != 0x00535743
+        && (header & 0x0FFFFFF) != 0x0053575A) {
         // ERROR
         log_error(_("gnash::SWFMovieDefinition::read() -- "
             "file does not start with a SWF header"));
         return false;
     }
     const bool compressed = (header & 255) == 'C';
+    const bool lzma = (header & 255) == 'Z';
 
     IF_VERBOSE_PARSE(
         log_parse(_("version: %d, file_length: %d"), m_version, m_file_length);
@@ -287,6 +329,34 @@ SWFMovieDefinition::readHeader(std::unique_ptr<IOChannel> in,
         _in = zlib_adapter::make_inflater(std::move(_in));
 #endif
     }
+    else if (lzma) {
+#ifndef HAVE_LZMA_H
+        log_error(_("SWFMovieDefinition::read(): unable to read "
+            "LZMA compressed SWF data; Gnash was compiled without "
+            "LZMA support"));
+        return false;
+#else
+        IF_VERBOSE_PARSE(
+            log_parse(_("file is LZMA compressed"));
+        );
+
+        if (m_file_length < 8) {
+            log_error(_("SWFMovieDefinition::read(): bad file length %d"),
+                    m_file_length);
+            return false;
+        }
+
+        // The uncompressed size doesn't count the SWF header.
+        try {
+            _in = lzma_adapter::make_inflater(std::move(_in),
+                    m_file_length - 8);
+        }
+        catch (const ParserException& e) {
+            log_error("%s", e.what());
+            return false;
+        }
+#endif
+    }
 
     assert(_in.get());
 
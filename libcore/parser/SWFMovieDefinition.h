@@ -248,9 +248,15 @@ public:
     // See dox in movie_definition.h
     DSOTEXPORT CachedBitmap* getBitmap(int DisplayObject_id) const;
 
+    // See dox in movie_definition.h
+    bool hasBitmap(int DisplayObject_id) const;
+
     // See dox in movie_definition.h
     void addBitmap(int DisplayObject_id, boost::intrusive_ptr<CachedBitmap> im);
 
+    // See dox in movie_definition.h
+    void addBitmap(int DisplayObject_id, std::unique_ptr<LazyBitmap> im);
+
     // See dox in movie_definition.h
     sound_sample* get_sound_sample(int DisplayObject_id) const;
 
@@ -402,7 +408,14 @@ private:
     FontMap m_fonts;
 
     typedef std::map<int, boost::intrusive_ptr<CachedBitmap> > Bitmaps;
-    Bitmaps _bitmaps;
+    mutable Bitmaps _bitmaps;
+
+    /// Bitmaps decoded when used, and kept by the BitmapCache.
+    typedef std::map<int, std::unique_ptr<LazyBitmap> > LazyBitmaps;
+    LazyBitmaps _lazyBitmaps;
+
+    /// Mutex protecting _bitmaps and _lazyBitmaps
+    mutable std::mutex _bitmapsMutex;
 
     typedef std::map<int, boost::intrusive_ptr<sound_sample> > SoundSampleMap;
     SoundSampleMap m_sound_samples;
@@ -22,6 +22,7 @@
 
 #include <string>
 #include <cstring> // for memcpy
+#include <algorithm>
 
 #include "log.h"
 #include "SWFStream.h"
@@ -40,6 +41,8 @@ namespace {
 action_buffer::action_buffer(const movie_definition& md)
     :
     _pools(),
+    _decoded(),
+    _decodeDone(false),
     _src(md)
 {
 }
@@ -79,6 +82,10 @@ action_buffer::read(SWFStream& in, unsigned long endPos)
     //
     in.read(reinterpret_cast<char*>(buf), size);
 
+    // Any previously decoded actions refer to the old contents.
+    _decoded.clear();
+    _decodeDone = false;
+
     // Consistency checks here
     //
     // NOTE: it is common to find such movies, swfmill is known to write
@@ -117,12 +124,10 @@ action_buffer::readConstantPool(size_t start_pc, size_t stop_pc) const
     
     assert(start_pc + 3 + length == stop_pc);
     
-    pool.resize(count);
-    
     // Index the strings.
     for (int ct = 0; ct < count; ct++) {
         // Point into the current action buffer.
-        pool[ct] = reinterpret_cast<const char*>(&m_buffer[3 + i]);
+        const char* str = reinterpret_cast<const char*>(&m_buffer[3 + i]);
 
         // TODO: rework this "safety" thing here (doesn't look all that safe)
         while (m_buffer[3 + i]) {
@@ -131,19 +136,115 @@ action_buffer::readConstantPool(size_t start_pc, size_t stop_pc) const
                 log_error(_("action buffer dict length exceeded"));
                 // Jam something into the remaining (invalid) entries.
                 while (ct < count) {
-                    pool[ct] = "<invalid>";
+                    pool.push_back("<invalid>");
                     ct++;
                 }
                 return pool;
             }
             i++;
         }
+        pool.push_back(str);
         i++;
     }
 
     return pool;
 }
 
+bool
+action_buffer::decodeAction(size_t pc, DecodedAction& action) const
+{
+    const size_t bufSize = m_buffer.size();
+    if (pc >= bufSize) return false;
+
+    const std::uint8_t id = m_buffer[pc];
+
+    action.pc = pc;
+    action.opcode = id;
+    action.kind = DecodedAction::KIND_CALL;
+    action.branchOffset = 0;
+    action.handler = &SWF::SWFHandlers::instance()[
+        static_cast<SWF::ActionType>(id)];
+    action.pool = nullptr;
+    action.cache = PropertyCache();
+
+    if ((id & 0x80) == 0) {
+        // action with no extra data
+        action.nextPC = pc + 1;
+        return true;
+    }
+
+    // action with extra data
+    if (pc + 2 >= bufSize) return false;
+    const std::uint16_t length = m_buffer[pc + 1] | (m_buffer[pc + 2] << 8);
+    action.nextPC = pc + length + 3;
+
+    // Anything overflowing the buffer is left to the handler (and the
+    // executor's own checks) to complain about.
+    if (action.nextPC > bufSize) return true;
+
+    switch (id) {
+        case SWF::ACTION_BRANCHALWAYS:
+        case SWF::ACTION_BRANCHIFTRUE:
+            if (length < 2) break;
+            action.branchOffset = read_int16(pc + 3);
+            action.kind = (id == SWF::ACTION_BRANCHALWAYS) ?
+                DecodedAction::KIND_BRANCH :
+                DecodedAction::KIND_BRANCH_IF_TRUE;
+            break;
+        case SWF::ACTION_CONSTANTPOOL:
+            // The pool itself is parsed on first execution, as for
+            // the handler.
+            if (length < 4) break;
+            action.kind = DecodedAction::KIND_CONSTANT_POOL;
+            break;
+        default:
+            break;
+    }
+    return true;
+}
+
+const action_buffer::DecodedActions&
+action_buffer::decodedActions() const
+{
+    if (_decodeDone) return _decoded;
+    _decodeDone = true;
+
+    const size_t bufSize = m_buffer.size();
+    size_t pc = 0;
+    DecodedAction action;
+
+    try {
+        while (pc < bufSize) {
+            if (!decodeAction(pc, action)) break;
+            _decoded.push_back(action);
+            pc = action.nextPC;
+        }
+    }
+    catch (const ActionParserException& e) {
+        // Keep what was decoded so far, the rest will be decoded
+        // on the fly by the executor.
+        IF_VERBOSE_MALFORMED_SWF(
+            log_swferror(_("Malformed action code at pc %d: %s"), pc,
+                e.what());
+        );
+    }
+
+    return _decoded;
+}
+
+bool
+action_buffer::findDecodedAction(size_t pc, size_t& index) const
+{
+    const DecodedActions& actions = decodedActions();
+
+    DecodedActions::const_iterator it = std::lower_bound(actions.begin(),
+            actions.end(), pc,
+            [](const DecodedAction& a, size_t off) { return a.pc < off; });
+
+    if (it == actions.end() || it->pc != pc) return false;
+    index = it - actions.begin();
+    return true;
+}
 
 // Disassemble one instruction to the log. The maxBufferLength
 // argument is the number of bytes remaining in the action_buffer
@@ -27,6 +27,7 @@
 
 #include "GnashException.h"
 #include "ConstantPool.h"
+#include "PropertyShape.h"
 #include "log.h"
 
 // Forward declarations
@@ -34,10 +35,62 @@ namespace gnash {
 	class as_value;
 	class movie_definition;
 	class SWFStream; // for read signature
+    namespace SWF {
+        class ActionHandler;
+    }
 }
 
 namespace gnash {
 
+/// An action tag decoded once for repeated execution.
+//
+/// The decoded form keeps everything the executor needs to step over
+/// the action without looking at the raw bytes again: the offset of the
+/// following action, the resolved handler and, for control flow
+/// actions, the pre-computed branch target.
+struct DecodedAction
+{
+    /// How the executor should dispatch the action.
+    enum Kind
+    {
+        /// Call the resolved handler.
+        KIND_CALL,
+
+        /// ActionJump, with a resolved target.
+        KIND_BRANCH,
+
+        /// ActionIf, with a resolved target.
+        KIND_BRANCH_IF_TRUE,
+
+        /// ActionConstantPool, with the pool cached after first use.
+        KIND_CONSTANT_POOL
+    };
+
+    /// Offset of the action tag in the buffer.
+    size_t pc;
+
+    /// Offset of the next action tag in the buffer.
+    size_t nextPC;
+
+    /// The action id.
+    std::uint8_t opcode;
+
+    /// The dispatch kind.
+    Kind kind;
+
+    /// Branch offset, relative to nextPC (branches only).
+    std::int16_t branchOffset;
+
+    /// The handler for KIND_CALL actions.
+    const SWF::ActionHandler* handler;
+
+    /// The parsed pool for KIND_CONSTANT_POOL actions, once executed.
+    mutable const ConstantPool* pool;
+
+    /// The property cache for member access actions.
+    mutable PropertyCache cache;
+};
+
 /// A code segment.
 //
 /// This currently holds the actions in a memory
@@ -156,7 +209,7 @@ public:
         // We'll query the last inserted one for now (highest PC)
         const ConstantPool& pool = _pools.rbegin()->second;
 
-        if ( n < pool.size() ) return pool[n];
+        if ( n < pool.size() ) return pool.c_str(n);
 
         else return nullptr;
 	}
@@ -186,6 +239,34 @@ public:
         return _src;
     }
 
+    /// The sequence of actions in this buffer, in offset order.
+    typedef std::vector<DecodedAction> DecodedActions;
+
+    /// Return the decoded actions of this buffer.
+    //
+    /// The buffer is decoded on first call by a linear sweep from
+    /// its start. The sweep stops at the first action whose length
+    /// can't be read; actions past that point (and jump targets
+    /// inside another action's data) are not in the table.
+    const DecodedActions& decodedActions() const;
+
+    /// Find the index of the decoded action at the given offset
+    //
+    /// @param pc       The offset to look up.
+    /// @param index    Set to the index in decodedActions() if found.
+    /// @return         false if no action starts at the given offset.
+    bool findDecodedAction(size_t pc, size_t& index) const;
+
+    /// Decode the action at the given offset without caching it
+    //
+    /// This is used for building the decoded table and by the executor
+    /// for offsets that aren't in it.
+    ///
+    /// @param pc       The offset of the action to decode.
+    /// @param action   The DecodedAction to fill in.
+    /// @return         false if the action header can't be read.
+    bool decodeAction(size_t pc, DecodedAction& action) const;
+
 private:
 
 	/// the code itself, as read from the SWF
@@ -195,6 +276,12 @@ private:
 	typedef std::map<size_t, ConstantPool> PoolsMap;
 	mutable PoolsMap _pools;
 
+    /// The decoded actions, built on first request.
+    mutable DecodedActions _decoded;
+
+    /// Whether _decoded has been built.
+    mutable bool _decodeDone;
+
 	/// The movie_definition containing this action buffer
 	//
 	/// This pointer will be used to determine domain-based
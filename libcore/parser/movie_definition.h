@@ -59,6 +59,7 @@
 #include <cstdint>
 
 #include "DefinitionTag.h"
+#include "BitmapCache.h"
 #include "log.h"
 
 // Forward declarations
@@ -321,6 +322,9 @@ public:
 	/// SWFMovieDefinition. The other derived class, sprite_definition
 	/// will seek for DisplayObjects in its base SWFMovieDefinition.
 	///
+	/// This may decode the bitmap, so only the thread running the movie
+	/// should call it.
+	///
 	/// @return 0 if no DisplayObject with the given ID is found, or
 	///	    if the corresponding DisplayObject is not a bitmap.
 	///
@@ -331,6 +335,18 @@ public:
 		return nullptr;
 	}
 
+	/// Whether a bitmap with the given DisplayObject id was added.
+	//
+	/// Unlike getBitmap() this never decodes a bitmap, so the loader
+	/// can use it to check for duplicate ids.
+	///
+	/// The default implementation returns false.
+	///
+	virtual bool hasBitmap(int /*DisplayObject_id*/) const
+	{
+		return false;
+	}
+
 	/// \brief
 	/// Add a bitmap DisplayObject in the dictionary, with the specified
 	/// DisplayObject id.
@@ -341,6 +357,20 @@ public:
 	{
 	}
 
+	/// \brief
+	/// Add a bitmap decoded when used in the dictionary, with the
+	/// specified DisplayObject id.
+	//
+	/// getBitmap() decodes it, or waits for a prefetched decode, and
+	/// may return another CachedBitmap after the BitmapCache dropped
+	/// the last one.
+	///
+	/// The default implementation is a no-op (drops the bitmap).
+	///
+	virtual void addBitmap(int /*id*/, std::unique_ptr<LazyBitmap> /*im*/)
+	{
+	}
+
 	/// Get the sound sample with given ID.
 	//
 	/// @return NULL if the given DisplayObject ID isn't found in the
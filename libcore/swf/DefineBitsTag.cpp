@@ -26,6 +26,8 @@
 
 #include <limits>
 #include <cassert>
+#include <cstring>
+#include <vector>
 
 #include "IOChannel.h"
 #include "utility.h"
@@ -41,6 +43,9 @@
 #include "CachedBitmap.h"
 #include "GnashImage.h"
 #include "GnashImageJpeg.h"
+#include "WorkerPool.h"
+#include "BitmapCache.h"
+#include "rc.h"
 
 #ifdef HAVE_ZLIB_H
 #include <zlib.h>
@@ -59,6 +64,8 @@ namespace {
     /// DefineBitsJpeg3, also DefineBitsJpeg4!
     std::unique_ptr<image::GnashImage> readDefineBitsJpeg3(SWFStream& in, TagType tag);
     std::unique_ptr<image::GnashImage> readLossless(SWFStream& in, TagType tag);
+    std::unique_ptr<image::GnashImage> readImage(SWFStream& in, TagType tag);
+    WorkerPool* decodeWorkers();
 
 }
 
@@ -138,6 +145,136 @@ public:
     }
 };
 
+/// A copy of the rest of a tag, as a tag of its own, for decoding it
+/// on another thread.
+class TagCopy : public IOChannel
+{
+public:
+
+    TagCopy(TagType tag, size_t length)
+        :
+        _data(6 + length),
+        _pos(0)
+    {
+        const std::uint16_t header = (tag << 6) | 0x3f;
+        _data[0] = header & 0xff;
+        _data[1] = header >> 8;
+        for (size_t i = 0; i < 4; ++i) _data[2 + i] = length >> (i * 8);
+    }
+
+    /// The tag body.
+    char* body() {
+        return reinterpret_cast<char*>(&_data[6]);
+    }
+
+    virtual std::streamsize read(void* dst, std::streamsize bytes) {
+        bytes = std::min<std::streamsize>(bytes, _data.size() - _pos);
+        std::memcpy(dst, &_data[_pos], bytes);
+        _pos += bytes;
+        return bytes;
+    }
+
+    virtual void go_to_end() {
+        _pos = _data.size();
+    }
+
+    virtual bool eof() const {
+        return _pos == _data.size();
+    }
+
+    virtual bool seek(std::streampos pos) {
+        if (pos < 0 || static_cast<size_t>(pos) > _data.size()) return false;
+        _pos = pos;
+        return true;
+    }
+
+    virtual size_t size() const {
+        return _data.size();
+    }
+
+    virtual std::streampos tell() const {
+        return _pos;
+    }
+
+    virtual bool bad() const {
+        return false;
+    }
+
+private:
+    std::vector<std::uint8_t> _data;
+    size_t _pos;
+};
+
+// Numbers in image headers.
+size_t le16(const std::uint8_t* p) { return p[0] | p[1] << 8; }
+size_t be16(const std::uint8_t* p) { return p[0] << 8 | p[1]; }
+size_t be32(const std::uint8_t* p) { return be16(p) << 16 | be16(p + 2); }
+
+/// The size of the image in a copied bitmap tag, as far as can be told
+/// without decoding it, or 0.
+size_t
+decodedSize(TagCopy& copy, TagType tag)
+{
+    const std::uint8_t* p = reinterpret_cast<std::uint8_t*>(copy.body());
+    size_t n = copy.size() - 6;
+
+    if (tag == SWF::DEFINELOSSLESS || tag == SWF::DEFINELOSSLESS2) {
+        if (n < 5) return 0;
+        const size_t channels = tag == SWF::DEFINELOSSLESS2 ? 4 : 3;
+        return le16(p + 1) * le16(p + 3) * channels;
+    }
+
+    size_t channels = 3;
+    if (tag != SWF::DEFINEBITSJPEG2) {
+        const size_t skip = tag == SWF::DEFINEBITSJPEG4 ? 6 : 4;
+        if (n < skip) return 0;
+        p += skip;
+        n -= skip;
+        channels = 4;
+    }
+
+    // PNG, GIF or JPEG.
+    if (n >= 24 && p[0] == 0x89 && p[1] == 'P') {
+        return be32(p + 16) * be32(p + 20) * 4;
+    }
+    if (n >= 10 && p[0] == 'G' && p[1] == 'I' && p[2] == 'F') {
+        return le16(p + 6) * le16(p + 8) * 4;
+    }
+    for (size_t i = 0; i + 8 < n; ++i) {
+        if (p[i] != 0xff) continue;
+        const std::uint8_t marker = p[i + 1];
+        if (marker == 0xda) break;
+        if (marker >= 0xc0 && marker <= 0xc3) {
+            return be16(p + i + 5) * be16(p + i + 7) * channels;
+        }
+    }
+    return 0;
+}
+
+/// Decode a bitmap tag copied by DefineBitsTag::loader().
+std::unique_ptr<image::GnashImage>
+decodeCopy(TagCopy& copy, TagType tag, std::uint16_t id)
+{
+    copy.seek(0);
+    SWFStream in(&copy);
+    std::unique_ptr<image::GnashImage> im;
+    try {
+        in.open_tag();
+        im = readImage(in, tag);
+        in.close_tag();
+    }
+    catch (const ParserException& e) {
+        log_error(_("Parsing exception: %s"), e.what());
+    }
+
+    if (!im.get()) {
+        IF_VERBOSE_MALFORMED_SWF(
+            log_swferror(_("Failed to parse bitmap for character %1%"), id);
+        );
+    }
+    return im;
+}
+
 } // anonymous namespace
 
 // Load JPEG compression tables that can be used to load
@@ -199,7 +336,7 @@ DefineBitsTag::loader(SWFStream& in, TagType tag, movie_definition& m,
     in.ensureBytes(2);
     const std::uint16_t id = in.read_u16();
 
-    if (m.getBitmap(id)) {
+    if (m.hasBitmap(id)) {
         IF_VERBOSE_MALFORMED_SWF(
             log_swferror(_("DEFINEBITS: Duplicate id (%d) for bitmap "
                     "DisplayObject - discarding it"), id);
@@ -207,27 +344,29 @@ DefineBitsTag::loader(SWFStream& in, TagType tag, movie_definition& m,
         return;
     }
 
-    std::unique_ptr<image::GnashImage> im;
+    // DefineBits images are read with the movie's JPEG tables, by the
+    // loader. Others are kept compressed, and decoded from a copy of the
+    // tag when first used, or before by the workers if the BitmapCache
+    // has room for them.
+    if (tag != SWF::DEFINEBITS) {
+        const unsigned long length = in.get_tag_end_position() - in.tell();
+        std::shared_ptr<TagCopy> copy = std::make_shared<TagCopy>(tag, length);
+        if (in.read(copy->body(), length) < length) {
+            throw ParserException(_("Unexpected end of stream while reading"));
+        }
+        std::unique_ptr<LazyBitmap> lazy(new LazyBitmap([copy, tag, id] {
+            return decodeCopy(*copy, tag, id);
+        }, BitmapCache::getDefaultInstance()));
 
-    switch (tag) {
-        case SWF::DEFINEBITS:
-            im = readDefineBitsJpeg(in, m);
-            break;
-        case SWF::DEFINEBITSJPEG2:
-            im = readDefineBitsJpeg2(in);
-            break;
-        case SWF::DEFINEBITSJPEG3:
-        case SWF::DEFINEBITSJPEG4:
-            im = readDefineBitsJpeg3(in, tag);
-            break;
-        case SWF::DEFINELOSSLESS:
-        case SWF::DEFINELOSSLESS2:
-            im = readLossless(in, tag);
-            break;
-        default:
-            std::abort();
+        if (WorkerPool* workers = decodeWorkers()) {
+            lazy->prefetch(*workers, decodedSize(*copy, tag));
+        }
+        m.addBitmap(id, std::move(lazy));
+        return;
     }
 
+    std::unique_ptr<image::GnashImage> im = readDefineBitsJpeg(in, m);
+
     if (!im.get()) {
         IF_VERBOSE_MALFORMED_SWF(
             log_swferror(_("Failed to parse bitmap for character %1%"), id);
@@ -253,6 +392,35 @@ DefineBitsTag::loader(SWFStream& in, TagType tag, movie_definition& m,
 
 namespace {
 
+/// The threads decoding bitmaps, or null if they are only decoded when
+/// used.
+WorkerPool*
+decodeWorkers()
+{
+    static const int threads = RcInitFile::getDefaultInstance().decodeThreads();
+    if (threads < 0) return nullptr;
+    static WorkerPool workers(threads);
+    return &workers;
+}
+
+/// Read any bitmap tag but DefineBits.
+std::unique_ptr<image::GnashImage>
+readImage(SWFStream& in, TagType tag)
+{
+    switch (tag) {
+        case SWF::DEFINEBITSJPEG2:
+            return readDefineBitsJpeg2(in);
+        case SWF::DEFINEBITSJPEG3:
+        case SWF::DEFINEBITSJPEG4:
+            return readDefineBitsJpeg3(in, tag);
+        case SWF::DEFINELOSSLESS:
+        case SWF::DEFINELOSSLESS2:
+            return readLossless(in, tag);
+        default:
+            std::abort();
+    }
+}
+
 // A JPEG image without included tables; those should be in an
 // existing image::JpegInput object stored in the movie.
 std::unique_ptr<image::GnashImage>
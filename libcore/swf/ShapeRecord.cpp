@@ -20,6 +20,7 @@
 #include "ShapeRecord.h"
 
 #include <vector>
+#include <atomic>
 
 #include "TypesParser.h"
 #include "utility.h"
@@ -69,15 +70,21 @@ private:
     const double _ratio;
 };
 
+std::atomic<std::uint64_t> nextVersion(1);
+
 } // anonymous namespace
 
 ShapeRecord::ShapeRecord(SWFStream& in, SWF::TagType tag, movie_definition& m,
         const RunResources& r)
+    :
+    _version(nextVersion++)
 {
     read(in, tag, m, r);
 }
 
 ShapeRecord::ShapeRecord()
+    :
+    _version(nextVersion++)
 {
 }
 
@@ -85,11 +92,18 @@ ShapeRecord::~ShapeRecord()
 {
 }
 
+void
+ShapeRecord::changed()
+{
+    _version = nextVersion++;
+}
+
 void
 ShapeRecord::clear()
 {
     _bounds.set_null();
     _subshapes.clear();
+    changed();
 }
 
 void
@@ -136,6 +150,8 @@ ShapeRecord::setLerp(const ShapeRecord& aa, const ShapeRecord& bb,
        return;
     }
 
+    changed();
+
     // Update current bounds.
     _bounds.set_lerp(aa.getBounds(), bb.getBounds(), ratio);
     const Subshape& a = aa.subshapes().front();
@@ -225,6 +241,7 @@ void
 ShapeRecord::read(SWFStream& in, SWF::TagType tag, movie_definition& m,
         const RunResources& r)
 {
+    changed();
 
     /// TODO: is this correct?
     const bool styleInfo = (tag == SWF::DEFINESHAPE ||
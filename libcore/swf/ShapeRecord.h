@@ -26,6 +26,7 @@
 #include "SWFRect.h"
 
 #include <vector>
+#include <cstdint>
 
 
 namespace gnash {
@@ -161,6 +162,7 @@ public:
 
     void addSubshape(const Subshape& subshape) {
     	_subshapes.push_back(subshape);
+        changed();
     }
 
     const SWFRect& getBounds() const {
@@ -180,6 +182,16 @@ public:
         _bounds = bounds;
     }
 
+    /// A number identifying the current shape data.
+    //
+    /// It changes whenever the paths or styles change, and is never the
+    /// same for records with different data, so it can be used to cache
+    /// things computed from the shape. Copies have the same version
+    /// until one of them changes.
+    std::uint64_t version() const {
+        return _version;
+    }
+
     bool pointTest(std::int32_t x, std::int32_t y,
                    const SWFMatrix& wm) const {
         for (const Subshape& subshape : _subshapes) {
@@ -195,6 +207,9 @@ private:
 
     unsigned readStyleChange(SWFStream& in, size_t num_fill_bits, size_t numStyles);
 
+    /// Give the shape data a new version.
+    void changed();
+
     /// Shape record flags for use in parsing.
     enum ShapeRecordFlags {
         SHAPE_END = 0x00,
@@ -207,6 +222,7 @@ private:
 
     SWFRect _bounds;
     Subshapes _subshapes;
+    std::uint64_t _version;
 };
 
 std::ostream& operator<<(std::ostream& o, const ShapeRecord& sh);
@@ -92,6 +92,11 @@ namespace {
     /// @param thread           The current execution thread.
     void commonSetTarget(ActionExec& thread, const std::string& target_name);
 
+    /// The parsed name of a value pushed from the current constant pool.
+    //
+    /// @return     null if the value was not pushed from the pool.
+    const VariableName* pooledName(as_environment& env, const as_value& val);
+
     
     void ActionEnd(ActionExec& thread);
     void ActionNextFrame(ActionExec& thread);
@@ -949,13 +954,21 @@ ActionGetVariable(ActionExec& thread)
     as_environment& env = thread.env;
 
     as_value& top_value = env.top(0);
-    const std::string& var_string = top_value.to_string();
-    if (var_string.empty()) {
-        top_value.set_undefined();
-        return;
-    }
 
-    top_value = thread.getVariable(var_string);
+    // Names pushed from the constant pool are parsed once, for the entry.
+    const VariableName* pooled = pooledName(env, top_value);
+    std::string var_string;
+    if (pooled) {
+        top_value = thread.getVariable(*pooled);
+    }
+    else {
+        var_string = top_value.to_string();
+        if (var_string.empty()) {
+            top_value.set_undefined();
+            return;
+        }
+        top_value = thread.getVariable(var_string);
+    }
     if (env.get_version() < 5 && top_value.is_sprite()) {
         // See http://www.ferryhalim.com/orisinal/g2/penguin.htm
         IF_VERBOSE_ASCODING_ERRORS(
@@ -967,7 +980,8 @@ ActionGetVariable(ActionExec& thread)
     }
 
     IF_VERBOSE_ACTION(
-        log_action(_("-- get var: %s=%s"), var_string, top_value);
+        log_action(_("-- get var: %s=%s"),
+            pooled ? pooled->str() : var_string, top_value);
     );
 }
 
@@ -976,19 +990,28 @@ ActionSetVariable(ActionExec& thread)
 {
     as_environment& env = thread.env;
 
-    const std::string& name = env.top(1).to_string();
-    if (name.empty()) {
-        IF_VERBOSE_ASCODING_ERRORS (
-            // Invalid object, can't set.
-            log_aserror(_("ActionSetVariable: %s=%s: variable name "
-                    "evaluates to invalid (empty) string"),
-                    env.top(1), env.top(0));
-        );
+    // Names pushed from the constant pool are parsed once, for the entry.
+    const VariableName* pooled = pooledName(env, env.top(1));
+    std::string name;
+    if (pooled) {
+        thread.setVariable(*pooled, env.top(0));
+    }
+    else {
+        name = env.top(1).to_string();
+        if (name.empty()) {
+            IF_VERBOSE_ASCODING_ERRORS (
+                // Invalid object, can't set.
+                log_aserror(_("ActionSetVariable: %s=%s: variable name "
+                        "evaluates to invalid (empty) string"),
+                        env.top(1), env.top(0));
+            );
+        }
+        thread.setVariable(name, env.top(0));
     }
-    thread.setVariable(name, env.top(0));
 
     IF_VERBOSE_ACTION(
-        log_action(_("-- set var: %s = %s"), name, env.top(0));
+        log_action(_("-- set var: %s = %s"),
+            pooled ? pooled->str() : name, env.top(0));
     );
 
     env.drop(2);
@@ -1019,10 +1042,10 @@ ActionStringConcat(ActionExec& thread)
     as_environment& env = thread.env;
     const int version = getSWFVersion(env);
 
-    const std::string& op1 = env.top(0).to_string(version);
-    const std::string& op2 = env.top(1).to_string(version);
+    const SharedString op1 = env.top(0).toSharedString(version);
+    const SharedString op2 = env.top(1).toSharedString(version);
 
-    env.top(1).set_string(op2 + op1);
+    env.top(1) = as_value(op2 + op1);
     env.drop(1);
 }
 
@@ -1715,6 +1738,14 @@ ActionWaitForFrameExpression(ActionExec& thread)
 
 }
 
+const VariableName*
+pooledName(as_environment& env, const as_value& val)
+{
+    VM& vm = getVM(env);
+    const ConstantPool* pool = vm.getConstantPool();
+    return pool ? pool->variableName(vm, val) : nullptr;
+}
+
 void
 pushConstant(ActionExec& thread, unsigned int id)
 {
@@ -2593,7 +2624,11 @@ ActionGetMember(ActionExec& thread)
 
     const ObjectURI& k = getURI(getVM(env), member_name.to_string());
 
-    if (!obj->get_member(k, &env.top(1))) {
+    PropertyCache* cache = thread.propertyCache();
+    const bool found = cache ? obj->get_member(k, &env.top(1), *cache) :
+                               obj->get_member(k, &env.top(1));
+
+    if (!found) {
         IF_VERBOSE_ASCODING_ERRORS(
             log_aserror("Reference to undefined member %s of object %s",
                 member_name, target);
@@ -2627,7 +2662,10 @@ ActionSetMember(ActionExec& thread)
         );
     }
     else if (obj) {
-        obj->set_member(getURI(getVM(env), member_name), member_value);
+        const ObjectURI& k = getURI(getVM(env), member_name);
+        PropertyCache* cache = thread.propertyCache();
+        if (cache) obj->set_member(k, member_value, *cache);
+        else obj->set_member(k, member_value);
 
         IF_VERBOSE_ACTION (
             log_action(_("-- set_member %s.%s=%s"),
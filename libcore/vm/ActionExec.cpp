@@ -34,6 +34,7 @@
 #include "as_environment.h"
 #include "SystemClock.h"
 #include "CallStack.h"
+#include "rc.h"
 
 #include <sstream>
 #include <string>
@@ -56,8 +57,61 @@
 
 #endif
 
+namespace {
+gnash::RcInitFile& rcfile = gnash::RcInitFile::getDefaultInstance();
+}
+
 namespace gnash {
 
+namespace {
+
+/// Return the decoded action starting at the given offset
+//
+/// @param hint     Index of the expected action in the decoded table.
+///                 This is updated to the index of the returned action,
+///                 or to the table size if it had to be decoded on the
+///                 fly.
+/// @param scratch  Storage for an action decoded on the fly.
+/// @return         The action, or null if it can't be decoded.
+const DecodedAction*
+decodedActionAt(const action_buffer& code, size_t pc, size_t& hint,
+        DecodedAction& scratch)
+{
+    const action_buffer::DecodedActions& actions = code.decodedActions();
+
+    // Straight-line execution and resolved branches usually land on
+    // the expected entry.
+    if (hint < actions.size() && actions[hint].pc == pc) {
+        return &actions[hint];
+    }
+    if (code.findDecodedAction(pc, hint)) return &actions[hint];
+
+    hint = actions.size();
+    return code.decodeAction(pc, scratch) ? &scratch : nullptr;
+}
+
+/// Sets the decoded action being executed for the guard's lifetime.
+class CurrentActionGuard
+{
+public:
+    CurrentActionGuard(const DecodedAction*& current,
+            const DecodedAction& action)
+        :
+        _current(current),
+        _from(current)
+    {
+        _current = &action;
+    }
+
+    ~CurrentActionGuard() { _current = _from; }
+
+private:
+    const DecodedAction*& _current;
+    const DecodedAction* _from;
+};
+
+}
+
 ActionExec::ActionExec(const Function& func, as_environment& newEnv,
         as_value* nRetVal, as_object* this_ptr)
     :
@@ -73,6 +127,7 @@ ActionExec::ActionExec(const Function& func, as_environment& newEnv,
     _origExecSWFVersion(0),
     _returning(false),
     _abortOnUnload(false),
+    _currentAction(nullptr),
     pc(func.getStartPC()),
     next_pc(pc),
     stop_pc(pc + func.getLength())
@@ -96,7 +151,13 @@ ActionExec::ActionExec(const Function& func, as_environment& newEnv,
         // top element of the CallFrame stack
         CallFrame& topFrame = getVM(newEnv).currentCall();
         assert(&topFrame.function() == &func);
-        _scopeStack.push_back(&topFrame.locals());
+
+        // Without local variables, and code that could declare them,
+        // there's nothing to find in it.
+        if (topFrame.hasLocals() ||
+                (func.codeUses() & Function::USES_ACTIVATION)) {
+            _scopeStack.push_back(&topFrame.locals());
+        }
     }
 }
 
@@ -115,6 +176,7 @@ ActionExec::ActionExec(const action_buffer& abuf, as_environment& newEnv,
     _origExecSWFVersion(0),
     _returning(false),
     _abortOnUnload(abortOnUnloaded),
+    _currentAction(nullptr),
     pc(0),
     next_pc(0),
     stop_pc(abuf.size())
@@ -166,6 +228,15 @@ ActionExec::operator()()
     const size_t maxTime = getRoot(vm).getTimeoutLimit() * 1000;
     SystemClock clock; // TODO: should we use a CPUClock here ?
 
+    // Whether to run the actions decoded once per action_buffer, or
+    // to decode each action from the raw bytes every time.
+    const bool decoded = rcfile.preDecodeActions();
+
+    // Index of the expected action in the decoded table, and
+    // storage for actions decoded on the fly.
+    size_t actionIndex = 0;
+    DecodedAction scratch;
+
     try {
 
         // We might not stop at stop_pc, if we are trying.
@@ -213,8 +284,13 @@ ActionExec::operator()()
                 _scopeStack.pop_back();
             }
 
+            // Use the pre-decoded action if there is one. Anything that
+            // can't be decoded goes through the raw bytes as usual.
+            const DecodedAction* action = decoded ?
+                decodedActionAt(code, pc, actionIndex, scratch) : nullptr;
+
             // Get the opcode.
-            std::uint8_t action_id = code[pc];
+            std::uint8_t action_id = action ? action->opcode : code[pc];
 
             IF_VERBOSE_ACTION (
                 log_action(_("PC:%d - EX: %s"), pc, code.disasm(pc));
@@ -222,7 +298,21 @@ ActionExec::operator()()
 
             // Set default next_pc offset, control flow action handlers
             // will be able to reset it.
-            if ((action_id & 0x80) == 0) {
+            if (action) {
+                next_pc = action->nextPC;
+                if (next_pc > stop_pc) {
+                    IF_VERBOSE_MALFORMED_SWF(
+                    log_swferror(_("Length %u of action tag"
+                                   " id %u at pc %d"
+                                   " overflows actions buffer size %d"),
+                          next_pc - pc - 3,
+                          static_cast<unsigned>(action_id), pc,
+                          stop_pc);
+                    );
+                    break;
+                }
+            }
+            else if ((action_id & 0x80) == 0) {
                 // action with no extra data
                 next_pc = pc+1;
             }
@@ -255,7 +345,13 @@ ActionExec::operator()()
                 break;
             }
 
-            ash.execute(static_cast<SWF::ActionType>(action_id), *this);
+            if (action) {
+                executeDecoded(*action);
+                ++actionIndex;
+            }
+            else {
+                ash.execute(static_cast<SWF::ActionType>(action_id), *this);
+            }
 
             // Code round here has to do with bugs: #20974, #21069, #20996,
             // but since there is so much disabled code it's not clear exactly
@@ -523,6 +619,48 @@ ActionExec::processExceptions(TryBlock& t)
     return true;
 }
 
+void
+ActionExec::executeDecoded(const DecodedAction& action)
+{
+    try {
+        switch (action.kind) {
+            case DecodedAction::KIND_BRANCH:
+                adjustNextPC(action.branchOffset);
+                break;
+
+            case DecodedAction::KIND_BRANCH_IF_TRUE:
+                if (toBool(env.pop(), getVM(env))) {
+                    adjustNextPC(action.branchOffset);
+                    if (next_pc > stop_pc) {
+                        IF_VERBOSE_MALFORMED_SWF(
+                            log_swferror(_("branch to offset %d  -- "
+                                " this section only runs to %d"),
+                                next_pc, stop_pc);
+                        );
+                    }
+                }
+                break;
+
+            case DecodedAction::KIND_CONSTANT_POOL:
+                if (!action.pool) {
+                    action.pool = &code.readConstantPool(pc, next_pc);
+                }
+                getVM(env).setConstantPool(action.pool);
+                break;
+
+            default:
+            {
+                const CurrentActionGuard guard(_currentAction, action);
+                action.handler->execute(*this);
+                break;
+            }
+        }
+    }
+    catch (const ActionParserException& e) {
+        log_swferror(_("Malformed action code: %s"), e.what());
+    }
+}
+
 void
 ActionExec::cleanupAfterRun() 
 {
@@ -613,12 +751,26 @@ ActionExec::delVariable(const std::string& name)
 
 void
 ActionExec::setVariable(const std::string& name, const as_value& val)
+{
+    gnash::setVariable(env, *getVM(env).variableName(name), val,
+            getScopeStack());
+}
+
+void
+ActionExec::setVariable(const VariableName& name, const as_value& val)
 {
     gnash::setVariable(env, name, val, getScopeStack());
 }
 
 as_value
 ActionExec::getVariable(const std::string& name, as_object** target)
+{
+    return gnash::getVariable(env, *getVM(env).variableName(name),
+            getScopeStack(), target);
+}
+
+as_value
+ActionExec::getVariable(const VariableName& name, as_object** target)
 {
     return gnash::getVariable(env, name, getScopeStack(), target);
 }
@@ -632,7 +784,8 @@ ActionExec::setLocalVariable(const std::string& name, const as_value& val)
     } else {
         // TODO: set target member  ?
         //       what about 'with' stack ?
-        gnash::setVariable(env, name, val, getScopeStack());
+        gnash::setVariable(env, *getVM(env).variableName(name), val,
+                getScopeStack());
     }
 }
 
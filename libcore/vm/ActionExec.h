@@ -190,6 +190,9 @@ public:
 	/// @param name     Name of the variable. Supports slash and dot syntax.
 	void setVariable(const std::string& name, const as_value& val);
 
+	/// Set a variable by parsed name, as setVariable() does.
+	void setVariable(const VariableName& name, const as_value& val);
+
 	/// Set a function-local variable
     //
     /// If we're not in a function, set a normal variable.
@@ -207,6 +210,10 @@ public:
     ///                 to an object, target will be set to null.
 	as_value getVariable(const std::string& name, as_object** target = nullptr);
 
+	/// Get a variable by parsed name, as getVariable() does.
+	as_value getVariable(const VariableName& name,
+            as_object** target = nullptr);
+
 	/// Get current target.
 	//
 	/// This function returns top 'with' stack entry, if any.
@@ -236,6 +243,14 @@ public:
 	void setNextPC(size_t pc) { next_pc = pc; }
 	
 	size_t getStopPC() const { return stop_pc; }
+
+    /// The property cache of the executing action
+    //
+    /// @return     0 if the action isn't executed from the decoded
+    ///             actions of the buffer.
+    PropertyCache* propertyCache() const {
+        return _currentAction ? &_currentAction->cache : nullptr;
+    }
 	
 private: 
 
@@ -269,6 +284,12 @@ private:
     /// @param t the try block to process.
     bool processExceptions(TryBlock& t);
 
+    /// Execute a pre-decoded action
+    //
+    /// Control flow actions are handled here using their resolved
+    /// operands, all others are passed to their handler.
+    void executeDecoded(const DecodedAction& action);
+
 	/// Run after a complete run, or after an run interrupted by 
 	/// a bail-out exception (ActionLimitException, for example)
 	//
@@ -318,6 +339,9 @@ private:
 
 	bool _abortOnUnload;
 
+    /// The decoded action being executed, if any.
+    const DecodedAction* _currentAction;
+
     /// Program counter (offset of current action tag)
 	size_t pc;
 
@@ -29,13 +29,36 @@ namespace gnash {
 
 CallFrame::CallFrame(UserFunction* f)
     :
-    _locals(new as_object(getGlobal(*f))),
+    _locals(nullptr),
     _func(f),
     _registers(_func->registers())
 {
     assert(_func);
 }
 
+void
+CallFrame::reset(UserFunction* f)
+{
+    assert(f);
+    assert(!_locals);
+    _func = f;
+    _registers.resize(_func->registers());
+}
+
+void
+CallFrame::clear()
+{
+    _locals = nullptr;
+    _registers.clear();
+}
+
+as_object&
+CallFrame::locals()
+{
+    if (!_locals) _locals = new as_object(getGlobal(*_func));
+    return *_locals;
+}
+
 /// Mark all reachable resources
 //
 /// Reachable resources would be registers and
@@ -49,8 +72,7 @@ CallFrame::markReachableResources() const
     std::for_each(_registers.begin(), _registers.end(),
             std::mem_fun_ref(&as_value::setReachable));
 
-    assert(_locals);
-    _locals->setReachable();
+    if (_locals) _locals->setReachable();
 }
 
 void
@@ -92,10 +114,27 @@ setLocal(CallFrame& c, const ObjectURI& name, const as_value& val)
     locals.set_member(name, val);
 }
 
+CallFrame&
+CallStack::push(UserFunction& func)
+{
+    if (_size == _frames.size()) {
+        _frames.emplace_back(new CallFrame(&func));
+    }
+    else _frames[_size]->reset(&func);
+    return *_frames[_size++];
+}
+
+void
+CallStack::pop()
+{
+    assert(_size);
+    _frames[--_size]->clear();
+}
+
 std::ostream&
 operator<<(std::ostream& o, const CallFrame& fr)
 {
-    CallFrame::Registers r = fr._registers;
+    const CallFrame::Registers& r = fr._registers;
 
     for (size_t i = 0; i < r.size(); ++i) {
         if (i) o << ", ";
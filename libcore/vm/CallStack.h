@@ -19,6 +19,9 @@
 #ifndef GNASH_VM_CALL_STACK_H
 #define GNASH_VM_CALL_STACK_H
 
+#include <boost/noncopyable.hpp>
+#include <cassert>
+#include <memory>
 #include <vector>
 
 #include "as_value.h"
@@ -38,9 +41,12 @@ namespace gnash {
 /// have no call frame.
 //
 /// The CallFrame provides space for local registers and local variables.
-/// These values are discarded when the CallFrame is destroyed at the end of
+/// These values are discarded when the CallFrame is popped at the end of
 /// a function call. It provides a scope for the function's execution.
-class CallFrame
+//
+/// The object holding the local variables is only created when one is
+/// first set, or when the function's code needs it in its scope.
+class CallFrame : boost::noncopyable
 {
 public:
 
@@ -52,26 +58,17 @@ public:
     ///                 must provide information about the amount of registers
     ///                 to allocate.
     CallFrame(UserFunction* func);
-    
-    /// Copy constructor for containers
-    CallFrame(const CallFrame& other)
-        :
-        _locals(other._locals),
-        _func(other._func),
-        _registers(other._registers)
-    {}
-
-    /// Assignment operator for containers.
-    CallFrame& operator=(const CallFrame& other) {
-        _locals = other._locals;
-        _func = other._func;
-        _registers = other._registers;
-        return *this;
-    }
 
     /// Access the local variables for this function call.
-    as_object& locals() {
-        return *_locals;
+    //
+    /// The object is created if there isn't one yet.
+    as_object& locals();
+
+    /// Whether any local variables object was created.
+    //
+    /// Until it is, looking up a local variable finds nothing.
+    bool hasLocals() const {
+        return _locals;
     }
 
     /// Get the function for which this CallFrame provides a scope.
@@ -111,12 +108,18 @@ public:
     /// locals (expected to be empty?) and function.
     void markReachableResources() const;
 
-
 private:
 
+    friend class CallStack;
     friend std::ostream& operator<<(std::ostream&, const CallFrame&);
 
-    /// Local variables.
+    /// Reuse the frame for a call to another function.
+    void reset(UserFunction* func);
+
+    /// Drop the values of the finished call, keeping the storage.
+    void clear();
+
+    /// Local variables, or null until there are some.
     as_object* _locals;
 
     UserFunction* _func;
@@ -126,6 +129,59 @@ private:
 
 };
 
+/// The frames of the functions being called.
+//
+/// Frames are kept when a call returns and reused by later calls at the
+/// same depth, with their register storage, so that once the stack has
+/// been as deep a call allocates no frame. Frames don't move while
+/// deeper calls are made.
+class CallStack : boost::noncopyable
+{
+public:
+
+    typedef size_t size_type;
+
+    CallStack() : _size(0) {}
+
+    bool empty() const {
+        return !_size;
+    }
+
+    size_type size() const {
+        return _size;
+    }
+
+    CallFrame& operator[](size_type i) {
+        assert(i < _size);
+        return *_frames[i];
+    }
+
+    const CallFrame& operator[](size_type i) const {
+        assert(i < _size);
+        return *_frames[i];
+    }
+
+    /// The frame of the function being called.
+    CallFrame& back() {
+        assert(_size);
+        return *_frames[_size - 1];
+    }
+
+    /// Add a frame for a call to a function.
+    CallFrame& push(UserFunction& func);
+
+    /// Remove the frame of the function returning.
+    void pop();
+
+private:
+
+    /// The frames in use, then those kept for reuse.
+    std::vector<std::unique_ptr<CallFrame> > _frames;
+
+    /// The number of frames in use.
+    size_type _size;
+};
+
 /// Declare a local variable in this CallFrame
 //
 /// The variable is declared and set to undefined if it doesn't exist already.
@@ -143,8 +199,6 @@ void declareLocal(CallFrame& c, const ObjectURI& name);
 /// @param val  The value to set the variable to.
 void setLocal(CallFrame& c, const ObjectURI& name, const as_value& val);
 
-typedef std::vector<CallFrame> CallStack;
-
 std::ostream& operator<<(std::ostream& o, const CallFrame& fr);
 
 } // namespace gnash
@@ -384,10 +384,11 @@ Machine::execute()
     // This automatically switches back again when we leave this scope.
     AVM2Switcher avm2(_vm);
 
-    assert(mStream);
+    // No code, or code that failed verification.
+    if (!mStream) return;
 
 	for (;;) {
-		std::size_t opStart = mStream->tellg();
+		std::size_t opStart = mStream->tell();
         
         try {
 
@@ -851,37 +852,31 @@ Machine::execute()
                 }
 
                 /// 0x18 ABC_ACTION_LOOKUPSWITCH
-                /// Stream: 3 bytes | V32 count as 'case_count - 1' |
+                /// Stream: S24 'default' | V32 count as 'case_count - 1' |
                 /// case_count of S24 as 'cases'
                 /// Stack In:
                 ///  index -- an integer object
                 /// Stack Out:
                 ///  .
-                /// Do: If index >= case_count, reset stream to position on
-                /// op entry. Otherwise, move by cases[index] - 1 from stream
-                /// position on op entry.
+                /// Do: If index >= case_count, move by default from stream
+                /// position on op entry. Otherwise, move by cases[index]
+                /// from there.
                 case SWF::ABC_ACTION_LOOKUPSWITCH:
                 {
-                    std::size_t npos = mStream->tellg();
                     if (!_stack.top(0).is_number()) throw ASException();
 
                     std::uint32_t index =
                         toNumber(_stack.top(0), getVM(fn));
                     _stack.drop(1);
 
-                    mStream->seekBy(3); // Skip the intial offset.
-                    std::uint32_t cases = mStream->read_V32();
-                    // Read from our original position and use it to skip
-                    // if the case is out of range.
-                    if (index > cases) {
-                        mStream->seekTo(npos);
-                        mStream->seekTo(npos + mStream->read_S24());
-                    }
-                    else {
-                        mStream->seekTo(npos + 3 * (index + 1));
-                        std::uint32_t newpos = mStream->read_S24();
-                        mStream->seekTo(npos - 1 + newpos);
+                    std::int32_t offset = mStream->read_S24();
+                    const std::uint32_t cases = mStream->read_V32();
+                    if (index <= cases) {
+                        mStream->seekBy(3 * index);
+                        offset = mStream->read_S24();
                     }
+                    // CodeStream::verify() checked the targets.
+                    mStream->seekTo(opStart + offset);
                     break;
                 }
 
@@ -2878,11 +2873,14 @@ Machine::execute()
                 }
 
             /// 0xEF ABC_ACTION_DEBUG
-            /// Stream: 7 bytes of unknown stuff to be skipped
-            /// Do: skip ahead 7 bytes in stream
+            /// Stream: UI8 'type' | V32 'name' | UI8 'register' | V32 'extra'
+            /// Do: Nothing, but the values are for the debugger if wanted.
                 case SWF::ABC_ACTION_DEBUG:
                 {
-                    mStream->seekBy(7);
+                    mStream->read_u8();
+                    mStream->skip_V32();
+                    mStream->read_u8();
+                    mStream->skip_V32();
                     break;
                 }
             /// 0xF0 ABC_ACTION_DEBUGLINE
@@ -3174,9 +3172,11 @@ Machine::executeFunction(Method* method, const fn_call& fn)
 	
     //TODO: Figure out a good way to use the State object to handle
     //returning values.
+	CodeStream *stream = method->getBody();
+    if (!stream) return as_value();
+
 	mCurrentFunction = method->getPrototype();
 	bool prev_ext = mExitWithReturn;
-	CodeStream *stream = method->getBody();
     
     // Protect the current stack from alteration
     // TODO: use saveState only, but not before checking other effects.
@@ -3210,6 +3210,7 @@ Machine::executeFunction(Method* method, const fn_call& fn)
 void
 Machine::executeCodeblock(CodeStream* stream)
 {
+	if (!stream) return;
 	mStream = stream;
 	execute();
 }
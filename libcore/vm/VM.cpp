@@ -43,6 +43,7 @@
 #include "namedStrings.h"
 #include "VirtualClock.h" // for getTime()
 #include "GnashNumeric.h"
+#include "as_environment.h"
 
 namespace {
 gnash::RcInitFile& rcfile = gnash::RcInitFile::getDefaultInstance();
@@ -70,6 +71,30 @@ VM::~VM()
 {
 }
 
+std::shared_ptr<const VariableName>
+VM::variableName(const std::string& name)
+{
+    // Names are rarely built at runtime, so this limit is only reached
+    // by unusual movies.
+    const size_t maxVariableNames = 4096;
+
+    VariableNames::const_iterator it = _variableNames.find(name);
+    if (it != _variableNames.end()) return it->second;
+
+    std::shared_ptr<const VariableName> v;
+    it = _oldVariableNames.find(name);
+    if (it != _oldVariableNames.end()) v = it->second;
+    else v.reset(new VariableName(*this, name));
+
+    // Only names unused since the last turnover are dropped.
+    if (_variableNames.size() >= maxVariableNames) {
+        _oldVariableNames.swap(_variableNames);
+        _variableNames.clear();
+    }
+    _variableNames.emplace(name, v);
+    return v;
+}
+
 void
 VM::setSWFVersion(int v) 
 {
@@ -253,15 +278,14 @@ VM::pushCallFrame(UserFunction& func)
         throw ActionLimitException(ss.str()); 
     }
 
-    _callStack.emplace_back(&func);
-    return _callStack.back();
+    return _callStack.push(func);
 }
 
 void 
 VM::popCallFrame()
 {
     assert(!_callStack.empty());
-    _callStack.pop_back();
+    _callStack.pop();
 }
 
 void
@@ -336,10 +360,9 @@ VM::dumpState(std::ostream& out, size_t limit)
     if (_callStack.empty()) return;
 
     out << "Local registers: ";
-    for (CallStack::const_iterator it = _callStack.begin(),
-            e = _callStack.end(); it != e; ++it) {
-        if (it != _callStack.begin()) out << " | ";
-        out << *it;
+    for (CallStack::size_type i = 0, n = _callStack.size(); i < n; ++i) {
+        if (i) out << " | ";
+        out << _callStack[i];
     }
     out << "\n";
 
@@ -377,7 +400,8 @@ newAdd(as_value& op1, const as_value& op2, const VM& vm)
 		// use string semantic
 		const int version = vm.getSWFVersion();
 		convertToString(op1, vm);
-		op1.set_string(op1.to_string(version) + r.to_string(version));
+		op1 = as_value(op1.toSharedString(version) +
+                r.toSharedString(version));
         return;
 	}
 
@@ -492,7 +516,7 @@ convertToNumber(as_value& v, const VM& vm)
 as_value&
 convertToString(as_value& v, const VM& vm)
 {
-    v.set_string(v.to_string(vm.getSWFVersion()));
+    v = as_value(v.toSharedString(vm.getSWFVersion()));
     return v;
 }
 
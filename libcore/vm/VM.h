@@ -26,6 +26,8 @@
 
 #include <map>
 #include <memory> 
+#include <string>
+#include <unordered_map>
 #include <array>
 #include <cstdint>
 #include <boost/random/mersenne_twister.hpp>  // for mt11213b
@@ -51,6 +53,7 @@ namespace gnash {
     class as_object;
     class VirtualClock;
     class UserFunction;
+    class VariableName;
 }
 
 namespace gnash {
@@ -248,6 +251,13 @@ public:
 
     const ConstantPool *getConstantPool() const { return _constantPool; }
 
+    /// Get the parsed form of a variable name.
+    //
+    /// Names are parsed when first used and kept for reuse. Names not
+    /// used for a while are dropped when the cache gets large, so
+    /// callers hold on to the returned pointer while they use it.
+    std::shared_ptr<const VariableName> variableName(const std::string& name);
+
 private:
 
 	/// Stage associated with this VM
@@ -281,6 +291,16 @@ private:
     RNG _rng;
 
     const ConstantPool* _constantPool;
+
+    typedef std::unordered_map<std::string,
+            std::shared_ptr<const VariableName>> VariableNames;
+
+    /// Parsed variable names, see variableName().
+    //
+    /// When _variableNames is full it becomes _oldVariableNames, and
+    /// the names found there again are moved back.
+    VariableNames _variableNames;
+    VariableNames _oldVariableNames;
 };
 
 // @param lowerCaseHint if true the caller guarantees
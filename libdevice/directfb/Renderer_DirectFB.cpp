@@ -203,7 +203,7 @@ Renderer_DirectFB::set_antialiased(bool /* enable */)
 }
 
 void
-Renderer_DirectFB::begin_submit_mask()
+Renderer_DirectFB::begin_submit_mask(const SWFRect& /*bounds*/)
 {
 }
 
@@ -77,7 +77,7 @@ public:
                    const SWFMatrix& mat);
 
     void set_antialiased(bool enable);
-    void begin_submit_mask();
+    void begin_submit_mask(const SWFRect& bounds);
     void end_submit_mask();
     void apply_mask();
     void disable_mask();
@@ -29,6 +29,8 @@
 #include "log.h"
 
 #include <algorithm> // for std::swap
+#include <cstring>
+#include <vector>
 
 namespace gnash {
 namespace media {
@@ -148,9 +150,9 @@ private:
 public:
 
 	// Utility function: uncompress ADPCM data from in BitReader to
-	// out_data[]. Returns the output samplecount.
+	// data. Returns the output samplecount.
 	static std::uint32_t adpcm_expand(
-		unsigned char* &data,
+		std::vector<std::int16_t>& data,
 		BitsReader& in,
 		unsigned int insize,
 		bool stereo)
@@ -166,8 +168,8 @@ public:
 		unsigned int n_bits = in.read_uint(2) + 2; // 2 to 5 bits 
 
 		// The compression ratio is 4:1, so this should be enough...
-		std::int16_t* out_data = new std::int16_t[insize * 5];
-		data = reinterpret_cast<unsigned char *>(out_data);
+		data.resize(insize * 5);
+		std::int16_t* out_data = data.data();
 
 		std::uint32_t sample_count = 0;
 
@@ -257,24 +259,32 @@ int ADPCMDecoder::s_stepsize[STEPSIZE_CT] = {
 //
 // Unsigned 8-bit expansion (128 is silence)
 //
-// u8_expand allocates the memory for its "data" pointer.
-//
 
 static void
-u8_expand(unsigned char * &data,
+u8_expand(std::vector<std::int16_t>& data,
 	const unsigned char* input,
 	std::uint32_t input_size) // This is also the number of u8bit samples
 {
-	std::int16_t	*out_data = new std::int16_t[input_size];
+	data.resize(input_size);
 
 	// Convert 8-bit to 16
 	const std::uint8_t *inp = input;
-	std::int16_t *outp = out_data;
+	std::int16_t *outp = data.data();
 	for (unsigned int i = input_size; i>0; i--) {
 		*outp++ = ((std::int16_t)(*inp++) - 128) * 256;
 	}
-	
-	data = (unsigned char *)out_data;
+}
+
+// Flash sound rates are 44100 Hz divided by 1, 2, 4 or 8, even where
+// they are given as 5500, 5512 or 11000. Returns 0 for other rates.
+static unsigned int
+flashRateDivisor(unsigned int rate)
+{
+	for (unsigned int d = 1; d <= 8; d *= 2) {
+		const unsigned int r = 44100 / d;
+		if (rate + r / 100 >= r && rate <= r + r / 100) return d;
+	}
+	return 0;
 }
 
 
@@ -330,6 +340,7 @@ AudioDecoderSimple::setup(const SoundInfo& info)
                 % (int)_codec % _codec;
             throw MediaException(err.str());
 	}
+	setupResampler();
 }
 
 void
@@ -361,36 +372,54 @@ AudioDecoderSimple::setup(const AudioInfo& info)
                 % (int)_codec % _codec;
             throw MediaException(err.str());
 	}
+	setupResampler();
+}
+
+void
+AudioDecoderSimple::setupResampler()
+{
+	if (_sampleRate == 44100 && _stereo) {
+		_resampler.reset();
+		return;
+	}
+
+	const unsigned int divisor = flashRateDivisor(_sampleRate);
+	if (divisor) {
+		_resampler.reset(new AudioResampler(1, _stereo, divisor, true));
+	}
+	else if (_sampleRate) {
+		_resampler.reset(new AudioResampler(_sampleRate, _stereo, 44100,
+				true));
+	}
 }
 
 std::uint8_t*
 AudioDecoderSimple::decode(const std::uint8_t* input, std::uint32_t inputSize,
         std::uint32_t& outputSize, std::uint32_t& decodedBytes)
 {
-
-	unsigned char* decodedData = nullptr;
-	std::uint32_t outsize = 0;
+	// Samples are decoded to _samples, which is kept for the next
+	// call, and only the output is allocated.
+	std::uint32_t sample_count = 0;
 
     switch (_codec) {
 	case AUDIO_CODEC_ADPCM:
 		{
-		//std::uint32_t sample_count = inputSize * ( _stereo ? 1 : 2 ); //(_sampleCount == 0 ? inputSize / ( _stereo ? 4 : 2 ) : _sampleCount);
 		BitsReader br(input, inputSize);
-		std::uint32_t sample_count = ADPCMDecoder::adpcm_expand(decodedData, br, inputSize, _stereo);
-		outsize = sample_count * (_stereo ? 4 : 2);
+		sample_count = ADPCMDecoder::adpcm_expand(_samples, br, inputSize, _stereo);
+		if (_stereo) sample_count *= 2;
 		}
 		break;
 	case AUDIO_CODEC_RAW:
 		if (_is16bit) {
 			// FORMAT_RAW 16-bit is exactly what we want!
-			decodedData = new unsigned char[inputSize];
-			memcpy(decodedData, input, inputSize);
-			outsize = inputSize;
+			sample_count = inputSize / 2;
+			_samples.resize(sample_count);
+			memcpy(_samples.data(), input, sample_count * 2);
 		} else {
 			// Convert 8-bit unsigned to 16-bit signed range
 			// Allocate as many shorts as there are samples
-			u8_expand(decodedData, input, inputSize);
-			outsize = inputSize * 2;
+			u8_expand(_samples, input, inputSize);
+			sample_count = inputSize;
 		}
 		break;
 	case AUDIO_CODEC_UNCOMPRESSED:
@@ -400,14 +429,13 @@ AudioDecoderSimple::decode(const std::uint8_t* input, std::uint32_t inputSize,
 		{
 			// Convert 8-bit unsigned to 16-bit signed range
 			// Allocate as many shorts as there are 8-bit samples
-			u8_expand(decodedData, input, inputSize);
-			outsize = inputSize * 2;
+			u8_expand(_samples, input, inputSize);
+			sample_count = inputSize;
 
 		} else {
-			// Allocate a destination buffer
 			// Read 16-bit data into buffer
-			decodedData = new unsigned char[inputSize];
-			outsize = inputSize;
+			sample_count = inputSize / 2;
+			_samples.resize(sample_count);
 			
 			// Convert 16-bit little-endian data to host-endian.
 
@@ -429,22 +457,13 @@ AudioDecoderSimple::decode(const std::uint8_t* input, std::uint32_t inputSize,
 				case 0x01:	// Little-endian host: sample is already native.
 					// If the input data is the output data, then we probably
 					// can't move the data faster than memcpy.
-					memcpy((char *)decodedData, input, inputSize);
+					memcpy(_samples.data(), input, sample_count * 2);
 					break;
 				case 0x00:  // Big-endian host
 					// Swap sample bytes to get big-endian format.
-					assert((inputSize & 1) == 0);
-
-					// Cast the buffers to help the compiler understand that we
-					// swapping 16-bit words. This should produce a single-instruction
-					// swap for each 16-bit word.
-					const std::uint16_t* input16 = reinterpret_cast<const std::uint16_t*>(input);
-					std::uint16_t* decodedData16 = reinterpret_cast<std::uint16_t*>(decodedData);
-					unsigned inputSize16 = inputSize / sizeof(std::uint16_t);
-					for ( unsigned i = 0; i < inputSize16; i++ )
+					for (unsigned i = 0; i < sample_count; i++)
 					{
-						std::uint16_t sample = input16[i];
-						decodedData16[i] = ((sample << 8) & 0xFF00) | ((sample >> 8) & 0x00FF);
+						_samples[i] = input[i * 2] | (input[i * 2 + 1] << 8);
 					}
 					break;
 			}
@@ -455,45 +474,26 @@ AudioDecoderSimple::decode(const std::uint8_t* input, std::uint32_t inputSize,
 		// ???, this should only decode ADPCM, RAW and UNCOMPRESSED
 	}
 
-	std::uint8_t* tmp_raw_buffer = decodedData;
-	std::uint32_t tmp_raw_buffer_size = 0;
-
-	// If we need to convert samplerate or/and from mono to stereo...
-	if (outsize > 0 && (_sampleRate != 44100 || !_stereo)) {
-
-		std::int16_t* adjusted_data = nullptr;
-		int	adjusted_size = 0;
-		int sample_count = outsize / (_stereo ? 4 : 2); // samples are of size 2
-
-		// Convert to needed samplerate - this converter only support standard flash samplerates
-		AudioResampler::convert_raw_data(&adjusted_data, &adjusted_size,
-                tmp_raw_buffer,
-                sample_count, 2,  // input sample size is 2 !
-				_sampleRate, _stereo,
-				44100,  true /* stereo */);
-
-		// Hopefully this wont happen
-		if (!adjusted_data) {
-			log_error(_("Error in sound sample conversion"));
-			delete[] tmp_raw_buffer;
-			outputSize = 0;
-			decodedBytes = 0;
-			return nullptr;
-		}
-
-		// Move the new data to the sound-struct
-		delete[] tmp_raw_buffer;
-		tmp_raw_buffer = reinterpret_cast<std::uint8_t*>(adjusted_data);
-		tmp_raw_buffer_size = adjusted_size;
+	decodedBytes = inputSize;
 
-	} else {
-		tmp_raw_buffer_size = outsize;
+	if (!sample_count) {
+		outputSize = 0;
+		return nullptr;
 	}
 
-	outputSize = tmp_raw_buffer_size;
+	// If we need to convert samplerate or/and from mono to stereo...
+	if (_resampler) {
+		const size_t frames = sample_count / (_stereo ? 2 : 1);
+		std::int16_t* out =
+			new std::int16_t[_resampler->maxOutput(frames) * 2];
+		outputSize = _resampler->process(_samples.data(), frames, out) * 4;
+		return reinterpret_cast<std::uint8_t*>(out);
+	}
 
-	decodedBytes = inputSize;
-	return tmp_raw_buffer;
+	std::uint8_t* out = new std::uint8_t[sample_count * 2];
+	memcpy(out, _samples.data(), sample_count * 2);
+	outputSize = sample_count * 2;
+	return out;
 }
 
 } // gnash.media namespace 
@@ -21,7 +21,12 @@
 #ifndef GNASH_AUDIODECODERSIMPLE_H
 #define GNASH_AUDIODECODERSIMPLE_H
 
+#include <cstdint>
+#include <memory>
+#include <vector>
+
 #include "AudioDecoder.h" // for inheritance
+#include "AudioResampler.h" // for composition
 #include "MediaParser.h" // for audioCodecType enum (composition)
 
 // Forward declarations
@@ -71,6 +76,9 @@ private:
     // throws MediaException on failure
 	void setup(const SoundInfo& info);
 
+	/// Convert to 44100 Hz stereo if the sound isn't.
+	void setupResampler();
+
 	// codec
 	audioCodecType _codec;
 
@@ -86,8 +94,11 @@ private:
 	// samplesize: 8 or 16 bit
 	bool _is16bit;
 
+	/// The decoded samples, before conversion.
+	std::vector<std::int16_t> _samples;
 
-	// 
+	/// Converts decoded samples to 44100 Hz stereo, if needed.
+	std::unique_ptr<AudioResampler> _resampler;
 };
 	
 } // gnash.media namespace 
@@ -16,17 +16,17 @@
 // along with this program; if not, write to the Free Software
 // Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
 
+#include <cstdint>
+#include <vector>
+
 #include "AudioDecoder.h"
+#include "AudioResampler.h"
 
 #ifdef HAVE_CONFIG_H
 # include "gnashconfig.h"
 #endif
 #include <speex/speex.h> 
 
-#ifdef RESAMPLING_SPEEX
-# include <speex/speex_resampler.h>
-#endif
-
 #ifndef GNASH_MEDIA_DECODER_SPEEX
 #define GNASH_MEDIA_DECODER_SPEEX
 
@@ -35,8 +35,7 @@ namespace media {
 
 /// Audio decoder for the speex codec 
 //
-/// This class will use the speex resampler if available
-///
+/// Speex sound is 16000 Hz mono, which is resampled to 44100 Hz stereo.
 class AudioDecoderSpeex : public AudioDecoder
 {
 public:
@@ -52,11 +51,13 @@ private:
     void* _speex_dec_state;
     int _speex_framesize;
 
-#ifdef RESAMPLING_SPEEX
-    SpeexResamplerState* _resampler;
-    /// Number of samples in a resampled 44kHz stereo frame.
-    std::uint32_t _target_frame_size;
-#endif
+    AudioResampler _resampler;
+
+    /// A decoded frame.
+    std::vector<std::int16_t> _frame;
+
+    /// The resampled output of a decode call.
+    std::vector<std::int16_t> _output;
 };
 
 } // namespace media
@@ -1,163 +1,338 @@
 // AudioResampler.cpp -- custom audio resampler
-// 
+//
 //   Copyright (C) 2005, 2006, 2007, 2008, 2009, 2010, 2011, 2012
 //   Free Software Foundation, Inc
-// 
+//
 // This program is free software; you can redistribute it and/or modify
 // it under the terms of the GNU General Public License as published by
 // the Free Software Foundation; either version 3 of the License, or
 // (at your option) any later version.
-// 
+//
 // This program is distributed in the hope that it will be useful,
 // but WITHOUT ANY WARRANTY; without even the implied warranty of
 // MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
 // GNU General Public License for more details.
-// 
+//
 // You should have received a copy of the GNU General Public License
 // along with this program; if not, write to the Free Software
 // Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
 
 #include "AudioResampler.h"
 
-#include <cstring>
+#include <algorithm>
 #include <cassert>
+#include <cmath>
+#include <map>
+#include <mutex>
+#include <tuple>
+
+#include "rc.h"
+
+#if defined(__SSE__)
+# include <xmmintrin.h>
+#elif defined(__ARM_NEON) || defined(__ARM_NEON__)
+# include <arm_neon.h>
+# define GNASH_RESAMPLE_NEON 1
+#endif
 
 namespace gnash {
 namespace media {
 
-void 
-AudioResampler::convert_raw_data(
-    std::int16_t** adjusted_data,
-    int* adjusted_size,
-    void* data,
-    int sample_count,	// A stereo pair counts as one
-    int sample_size,	// Should now always == 2
-    // sample_rate and stereo are those of the incoming sample
-    int sample_rate, 
-    bool stereo,
-    // m_sample_rate, m_stereo are the format we must convert to.
-    int m_sample_rate,
-    bool m_stereo)
+struct AudioResampler::Filter
+{
+    /// The number of phases, by which the input is upsampled.
+    size_t phases;
+
+    /// The input advance per output, at the upsampled rate.
+    size_t step;
+
+    /// The taps of each phase, a multiple of 4.
+    size_t taps;
+
+    /// The coefficients of each phase, reversed so that they line up
+    /// with the input in order.
+    std::vector<float> coefficients;
+};
+
+namespace {
+
+/// The most phases a filter has. Ratios needing more are approximated.
+const size_t maxPhases = 1024;
+
+/// Approximate out / in by phases / step with no more than maxPhases
+/// phases.
+void
+ratio(unsigned int in, unsigned int out, size_t& phases, size_t& step)
 {
+    std::uint64_t a = out, b = in;
+    while (b) {
+        std::swap(a, b);
+        b %= a;
+    }
+    phases = out / a;
+    step = in / a;
+    if (phases <= maxPhases) return;
 
-    assert(sample_size == 2); // at least it seems the code relies on this...
-
-    // simple hack to handle dup'ing mono to stereo
-    if ( !stereo && m_stereo)
-    {
-	sample_rate >>= 1;
-    }
-
-    // simple hack to lose half the samples to get mono from stereo
-    if ( stereo && !m_stereo)
-    {
-	sample_rate <<= 1;
-    }
-
-    // Brain-dead sample-rate conversion: duplicate or
-    // skip input samples an integral number of times.
-    int	inc = 1;	// increment
-    int	dup = 1;	// duplicate
-    if (sample_rate > m_sample_rate)
-    {
-	inc = sample_rate / m_sample_rate;
-    }
-    else if (sample_rate < m_sample_rate)
-    {
-	dup = m_sample_rate / sample_rate;
-    }
-
-    int	output_sample_count = (sample_count * dup * (stereo ? 2 : 1)) / inc;
-    std::int16_t*	out_data = new std::int16_t[output_sample_count];
-    *adjusted_data = out_data;
-    *adjusted_size = output_sample_count * sizeof(std::int16_t); // in bytes
-
-    // Either inc > 1 (decimate the audio)
-    // or dup > 1 (repeat samples)
-    // or both == 1 (no transformation required)
-    if (inc == 1 && dup == 1)
-    {
-	    // No tranformation required
-	    std::memcpy(out_data, data, output_sample_count * sizeof(std::int16_t));
-    }
-    else if (inc > 1)
-    {
-	// Downsample by skipping samples from the input
-	std::int16_t*	in = (std::int16_t*) data;
-	for (int i = output_sample_count; i > 0; i--)
-	{
-	    *out_data++ = *in;
-	    in += inc;
-	}
-    }
-    else if (dup > 1)
-    {
-	// Upsample by duplicating input samples in the output.
-
-	// The straight sample-replication code handles mono-to-stereo (sort of)
-	// and upsampling of mono but would make a botch of stereo-to-stereo
-	// upsampling, giving the left sample in both channels
-	// then the right sample in both channels alternately.
-	// So for stereo-stereo transforms we have a stereo routine.
-
-	std::int16_t*	in = (std::int16_t*) data;
-
-	if (stereo && m_stereo) {
-	    // Stereo-to-stereo upsampling: Replicate pairs of samples
-	    for (int i = output_sample_count / dup / 2; i > 0; i--)
-	    {
-		for (int j = dup; j > 0; j--)
-		{
-			out_data[0] = in[0];
-			out_data[1] = in[1];
-			out_data += 2;
-		}
-		in += 2;
-	    }
-	} else {
-
-	    // Linear upsampling, either to increase a sample rate
-	    // or to convert a mono file to stereo or both:
-	    // replicate each sample several times.
-	    switch (dup)
-	    {
-	    case 2:
-		for (int i = output_sample_count / dup; i > 0; i--)
-		{
-		    *out_data++ = *in;
-		    *out_data++ = *in;
-		    in++;
-		}
-		break;
-	    case 4:
-		for (int i = output_sample_count / dup; i > 0; i--)
-		{
-		    *out_data++ = *in;
-		    *out_data++ = *in;
-		    *out_data++ = *in;
-		    *out_data++ = *in;
-		    in++;
-		}
-		break;
-	    default:
-		for (int i = output_sample_count / dup; i > 0; i--)
-		{
-		    for (int j = dup; j > 0; j--)
-		    {
-			    *out_data++ = *in;
-		    }
-		    in++;
-		}
-		break;
-	    }
-	}
+    // The last convergent of the continued fraction of out / in whose
+    // numerator isn't too big.
+    std::uint64_t p0 = 0, q0 = 1, p1 = 1, q1 = 0;
+    std::uint64_t num = out, den = in;
+    while (den) {
+        const std::uint64_t term = num / den;
+        const std::uint64_t p2 = term * p1 + p0;
+        const std::uint64_t q2 = term * q1 + q0;
+        if (p2 > maxPhases) break;
+        p0 = p1; q0 = q1; p1 = p2; q1 = q2;
+        std::swap(num, den);
+        den %= num;
     }
+    phases = p1;
+    step = std::max<std::uint64_t>(q1, 1);
 }
 
-} // namespace media
-} // namespace gnash 
+/// The zeroth order modified Bessel function, for the Kaiser window.
+double
+besselI0(double x)
+{
+    double sum = 1, term = 1;
+    for (int k = 1; k < 50 && term > sum * 1e-12; ++k) {
+        term *= (x / (2 * k)) * (x / (2 * k));
+        sum += term;
+    }
+    return sum;
+}
+
+std::shared_ptr<const AudioResampler::Filter>
+makeFilter(size_t phases, size_t step, AudioResampler::Quality quality)
+{
+    // Taps at the input rate, window shape and passband for each quality.
+    static const size_t baseTaps[] = { 4, 16, 32 };
+    static const double beta[] = { 5, 7, 9 };
+    static const double rolloff[] = { 0.8, 0.9, 0.94 };
+
+    std::shared_ptr<AudioResampler::Filter> f =
+        std::make_shared<AudioResampler::Filter>();
+    f->phases = phases;
+    f->step = step;
+
+    // Downsampling needs a longer filter for the same steepness.
+    const size_t factor = (step + phases - 1) / phases;
+    f->taps = std::min<size_t>(baseTaps[quality] * factor, 256);
+    f->taps = (f->taps + 3) & ~size_t(3);
+
+    const size_t length = f->taps * phases;
+    const double cutoff = rolloff[quality] * 0.5 / std::max(phases, step);
+    const double center = (length - 1) / 2.0;
+    const double norm = besselI0(beta[quality]);
+
+    std::vector<double> h(length);
+    for (size_t n = 0; n < length; ++n) {
+        const double x = n - center;
+        const double sinc = x ? std::sin(2 * M_PI * cutoff * x) / (M_PI * x) :
+            2 * cutoff;
+        const double r = length > 1 ? 2.0 * n / (length - 1) - 1 : 0;
+        h[n] = sinc * besselI0(beta[quality] * std::sqrt(1 - r * r)) / norm;
+    }
+
+    // Each phase has unity gain, so silence and constant levels stay
+    // as they are.
+    f->coefficients.resize(length);
+    for (size_t phase = 0; phase < phases; ++phase) {
+        double sum = 0;
+        for (size_t j = 0; j < f->taps; ++j) sum += h[j * phases + phase];
+        float* c = &f->coefficients[phase * f->taps];
+        for (size_t t = 0; t < f->taps; ++t) {
+            c[t] = h[(f->taps - 1 - t) * phases + phase] / sum;
+        }
+    }
+    return f;
+}
+
+/// Filters are shared by all resamplers using them.
+std::shared_ptr<const AudioResampler::Filter>
+getFilter(size_t phases, size_t step, AudioResampler::Quality quality)
+{
+    typedef std::tuple<size_t, size_t, int> Key;
+    static std::map<Key, std::weak_ptr<const AudioResampler::Filter> > filters;
+    static std::mutex mutex;
+
+    std::lock_guard<std::mutex> lock(mutex);
+    std::weak_ptr<const AudioResampler::Filter>& cached =
+        filters[Key(phases, step, quality)];
+    std::shared_ptr<const AudioResampler::Filter> f = cached.lock();
+    if (!f) {
+        f = makeFilter(phases, step, quality);
+        cached = f;
+    }
+    return f;
+}
+
+/// The dot product of two arrays of a multiple of 4 floats.
+//
+/// All versions add in 4 lanes and then the lanes in pairs, so they give
+/// the same results.
+inline float
+dot(const float* a, const float* b, size_t n)
+{
+#if defined(__SSE__)
+    __m128 sum = _mm_setzero_ps();
+    for (size_t i = 0; i < n; i += 4) {
+        sum = _mm_add_ps(sum, _mm_mul_ps(_mm_loadu_ps(a + i),
+                    _mm_loadu_ps(b + i)));
+    }
+    float lanes[4];
+    _mm_storeu_ps(lanes, sum);
+#elif defined(GNASH_RESAMPLE_NEON)
+    float32x4_t sum = vdupq_n_f32(0);
+    for (size_t i = 0; i < n; i += 4) {
+        sum = vaddq_f32(sum, vmulq_f32(vld1q_f32(a + i), vld1q_f32(b + i)));
+    }
+    float lanes[4];
+    vst1q_f32(lanes, sum);
+#else
+    float lanes[4] = { 0, 0, 0, 0 };
+    for (size_t i = 0; i < n; i += 4) {
+        for (size_t l = 0; l < 4; ++l) lanes[l] += a[i + l] * b[i + l];
+    }
+#endif
+    return (lanes[0] + lanes[1]) + (lanes[2] + lanes[3]);
+}
+
+inline std::int16_t
+toSample(float v)
+{
+    v += v < 0 ? -0.5f : 0.5f;
+    if (v >= 32767) return 32767;
+    if (v <= -32768) return -32768;
+    return static_cast<std::int16_t>(v);
+}
 
-// Local Variables:
-// mode: C++
-// indent-tabs-mode: t
-// End:
+} // anonymous namespace
+
+AudioResampler::AudioResampler(unsigned int inRate, bool inStereo,
+        unsigned int outRate, bool outStereo, Quality quality)
+    :
+    _inStereo(inStereo),
+    _outStereo(outStereo),
+    _channels(inStereo && outStereo ? 2 : 1),
+    _position(0)
+{
+    assert(inRate && outRate);
+
+    size_t phases, step;
+    ratio(inRate, outRate, phases, step);
+    if (phases != step) {
+        _filter = getFilter(phases, step, quality);
+    }
+    reset();
+}
+
+AudioResampler::~AudioResampler()
+{
+}
+
+void
+AudioResampler::reset()
+{
+    _position = 0;
+    if (!_filter) return;
+    for (size_t c = 0; c < _channels; ++c) {
+        _buffer[c].assign(_filter->taps - 1, 0);
+    }
+}
+
+size_t
+AudioResampler::maxOutput(size_t frames) const
+{
+    if (!_filter) return frames;
+    return (frames * _filter->phases + _filter->step - 1) / _filter->step;
+}
+
+size_t
+AudioResampler::process(const std::int16_t* in, size_t frames,
+        std::int16_t* out)
+{
+    if (!_filter) {
+        for (size_t i = 0; i < frames; ++i) {
+            if (_inStereo == _outStereo) {
+                out[i * _channels] = in[i * _channels];
+                if (_channels == 2) out[i * 2 + 1] = in[i * 2 + 1];
+            }
+            else if (_outStereo) {
+                out[i * 2] = out[i * 2 + 1] = in[i];
+            }
+            else {
+                out[i] = (in[i * 2] + in[i * 2 + 1]) / 2;
+            }
+        }
+        return frames;
+    }
+
+    const Filter& f = *_filter;
+    const size_t history = f.taps - 1;
+
+    // The input goes after the history of each channel.
+    for (size_t c = 0; c < _channels; ++c) {
+        _buffer[c].resize(history + frames);
+    }
+    float* left = &_buffer[0][history];
+    if (_channels == 2) {
+        float* right = &_buffer[1][history];
+        for (size_t i = 0; i < frames; ++i) {
+            left[i] = in[i * 2];
+            right[i] = in[i * 2 + 1];
+        }
+    }
+    else if (_inStereo) {
+        for (size_t i = 0; i < frames; ++i) {
+            left[i] = (in[i * 2] + in[i * 2 + 1]) * 0.5f;
+        }
+    }
+    else {
+        std::copy(in, in + frames, left);
+    }
+
+    // Each output is the input up to its position, filtered by the
+    // phase of its position between two inputs.
+    size_t written = 0;
+    const std::uint64_t end = static_cast<std::uint64_t>(frames) * f.phases;
+    for (; _position < end; _position += f.step, ++written) {
+
+        const size_t base = _position / f.phases;
+        const float* c = &f.coefficients[(_position % f.phases) * f.taps];
+
+        const std::int16_t l = toSample(dot(c, &_buffer[0][base], f.taps));
+        if (_channels == 2) {
+            out[written * 2] = l;
+            out[written * 2 + 1] =
+                toSample(dot(c, &_buffer[1][base], f.taps));
+        }
+        else if (_outStereo) {
+            out[written * 2] = out[written * 2 + 1] = l;
+        }
+        else {
+            out[written] = l;
+        }
+    }
+    _position -= end;
+
+    // Keep the end of the input for the next block.
+    for (size_t c = 0; c < _channels; ++c) {
+        std::vector<float>& b = _buffer[c];
+        std::copy(b.end() - history, b.end(), b.begin());
+        b.resize(history);
+    }
+
+    assert(written <= maxOutput(frames));
+    return written;
+}
+
+AudioResampler::Quality
+AudioResampler::defaultQuality()
+{
+    const int q = RcInitFile::getDefaultInstance().resampleQuality();
+    return static_cast<Quality>(std::max(0, std::min(q, 2)));
+}
+
+} // namespace media
+} // namespace gnash
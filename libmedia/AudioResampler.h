@@ -2,83 +2,116 @@
 //
 //   Copyright (C) 2005, 2006, 2007, 2008, 2009, 2010, 2011, 2012
 //   Free Software Foundation, Inc
-// 
+//
 // This program is free software; you can redistribute it and/or modify
 // it under the terms of the GNU General Public License as published by
 // the Free Software Foundation; either version 3 of the License, or
 // (at your option) any later version.
-// 
+//
 // This program is distributed in the hope that it will be useful,
 // but WITHOUT ANY WARRANTY; without even the implied warranty of
 // MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
 // GNU General Public License for more details.
-// 
+//
 // You should have received a copy of the GNU General Public License
 // along with this program; if not, write to the Free Software
 // Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
 
 
-#ifndef __GNASH_UTIL_H
-#define __GNASH_UTIL_H
+#ifndef GNASH_MEDIA_AUDIORESAMPLER_H
+#define GNASH_MEDIA_AUDIORESAMPLER_H
 
 #include <cstdint> // for std::int16_t
+#include <cstddef>
+#include <memory>
+#include <vector>
+#include <boost/noncopyable.hpp>
+
+#include "dsodefs.h"
 
 namespace gnash {
 namespace media {
 
+/// Sample-rate and stereo conversion of a stream of 16-bit samples.
+//
+/// Samples go through a windowed-sinc polyphase filter. The filter
+/// history is kept from one block to the next, so a sound converted in
+/// blocks sounds the same as when converted at once. Output is written
+/// to buffers given by the caller.
+//
+/// The filter delays the sound by half its length, which is a few
+/// samples at the input rate.
+class DSOEXPORT AudioResampler : boost::noncopyable
+{
+public:
 
-/// VERY crude audio resampler
-class AudioResampler {
+    /// The length of the filter, trading quality for speed.
+    enum Quality
+    {
+        QUALITY_FAST = 0,
+        QUALITY_MEDIUM = 1,
+        QUALITY_BEST = 2
+    };
 
-public:
+    /// Create a resampler.
+    //
+    /// Only the ratio of the rates matters, so rates that are not a whole
+    /// number of Hz can be given in other units.
+    //
+    /// @param inRate       The sample rate of the input.
+    /// @param inStereo     Whether the input has two interleaved channels.
+    /// @param outRate      The sample rate of the output.
+    /// @param outStereo    Whether the output has two interleaved channels.
+    /// @param quality      The length of the filter.
+    AudioResampler(unsigned int inRate, bool inStereo, unsigned int outRate,
+            bool outStereo, Quality quality = defaultQuality());
+
+    ~AudioResampler();
+
+    /// The most frames process() writes for a number of input frames.
+    //
+    /// A frame is one sample for each channel.
+    size_t maxOutput(size_t frames) const;
+
+    /// Convert a block of input.
+    //
+    /// @param in       The input samples, in host byte order.
+    /// @param frames   The number of input frames.
+    /// @param out      Where to write the output, with room for
+    ///                 maxOutput(frames) frames.
+    /// @return         The number of frames written.
+    size_t process(const std::int16_t* in, size_t frames, std::int16_t* out);
 
-	/// VERY crude sample-rate and stereo conversion.
-	//
-	/// Converts input data to output format.
-	//
-	/// @param adjusted_data
-	/// Where the converted data is placed (output). WARNING: even though
-	/// the type of the output data is int16, the adjusted_size output
-	/// parameter is in bytes.
-	///
-	/// @param adjusted_size
-	/// The size of the converted data (output) in bytes.
-	///
-	/// @param data
-	/// Data that needs to be converted (input).
-	///
-	/// @param sample_count
-	/// The datas current sample count (input).
-	/// 
-	/// @param sample_size
-	/// The datas current sample size (input) in bytes.
-	///
-	/// @param sample_rate
-	/// The datas current sample rate (input).
-	///
-	/// @param stereo
-	/// Whether the current data is in stereo (input).
-	///
-	/// @param m_sample_rate
-	/// The samplerate we which to convert to (output).
-	///
-	/// @param m_stereo
-	/// Do we want the output data to be in stereo (output)?
-	static void convert_raw_data(std::int16_t** adjusted_data,
-		  int* adjusted_size, void* data, int sample_count,
-		  int sample_size, int sample_rate, bool stereo,
-		  int m_sample_rate, bool m_stereo);
+    /// Forget the filter history, as when a sound starts again.
+    void reset();
+
+    /// The quality set in gnashrc.
+    static Quality defaultQuality();
+
+    /// The coefficients for one ratio and quality.
+    struct Filter;
+
+private:
+
+    /// The filter, shared by all resamplers with the same ratio and
+    /// quality. Null if only channels are converted.
+    std::shared_ptr<const Filter> _filter;
+
+    const bool _inStereo;
+    const bool _outStereo;
+
+    /// The number of channels filtered.
+    const size_t _channels;
+
+    /// The input of each filtered channel, after the history.
+    std::vector<float> _buffer[2];
+
+    /// The position of the next output at the filter's rate, relative to
+    /// the start of the next block.
+    std::uint64_t _position;
 };
 
 } // namespace media
 } // namespace gnash
 
-#endif // __GNASH_UTIL_H
-
-
-// Local Variables:
-// mode: C++
-// c-basic-offset: 8 
-// tab-width: 8
-// indent-tabs-mode: t
-// End:
+#endif // GNASH_MEDIA_AUDIORESAMPLER_H
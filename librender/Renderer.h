@@ -142,6 +142,8 @@
 
 
 #include <vector>
+#include <string>
+#include <utility>
 #include <boost/noncopyable.hpp>
 
 #include "dsodefs.h" // for DSOEXPORT
@@ -358,6 +360,18 @@ public:
             { return _render_images.end(); }
     
     ///@}
+
+    /// ==================================================================
+    /// Statistics
+    /// ==================================================================
+
+    typedef std::vector<std::pair<std::string, std::string> > Stats;
+
+    /// Append statistics about the renderer as label and value pairs.
+    //
+    /// These are shown in the movie info of the GUI. The default
+    /// implementation adds nothing.
+    virtual void getStats(Stats& /*stats*/) const {}
         
     ///@{ Masks
     ///
@@ -372,7 +386,11 @@ public:
     /// by a call to begin_submit_mask(). The resulting mask shall be an
     /// intersection of the previously created mask. disable_mask() shall
     /// result in the disabling or destruction of the last created mask.
-    virtual void begin_submit_mask() = 0;
+    ///
+    /// @param bounds   The world bounds of the shapes of the mask.
+    ///                 Nothing outside them is visible through the
+    ///                 mask, so a renderer needs no mask there.
+    virtual void begin_submit_mask(const SWFRect& bounds) = 0;
     virtual void end_submit_mask() = 0;
     virtual void disable_mask() = 0;
     ///@}
@@ -75,10 +75,6 @@ What could and should be /optimized/
   - EASY: Do not even start rendering shapes that are abviously out of the
     invalidated bounds!  
     
-  - The alpha mask buffers (masks) are allocated and freed for each mask which
-    results in many large-size buffer allocations during a second. Maybe this
-    should be optimized.
-    
   - Matrix-transformed paths (generated before drawing a shape) should be cached
     and re-used to avoid recalculation of the same coordinates.
     
@@ -115,6 +111,17 @@ AGG resources
 #include <math.h> // We use round()!
 #include <climits>
 #include <functional>
+#include <algorithm>
+#include <memory>
+#include <mutex>
+#include <condition_variable>
+#include <thread>
+#include <list>
+#include <iterator>
+#include <unordered_map>
+#include <string>
+#include <cstdint>
+#include <cstring>
 
 #pragma GCC diagnostic push
 #pragma GCC diagnostic ignored "-Wunused-parameter"
@@ -157,6 +164,7 @@ AGG resources
 #include "FillStyle.h"
 #include "Transform.h"
 #include "IOChannel.h"
+#include "rc.h"
 
 #ifdef HAVE_VA_VA_H
 #include "GnashVaapiImage.h"
@@ -172,6 +180,7 @@ AGG resources
 
 #include <boost/numeric/conversion/converter.hpp>
 #include <boost/ptr_container/ptr_vector.hpp>
+#include <boost/noncopyable.hpp>
 
 namespace gnash {
 
@@ -204,6 +213,343 @@ inline void applyClipBox(Rasterizer& ras, const geometry::Range2d<int>& bounds)
             );  
 }
 
+/// A rasterizer sweeping only the scanlines of one band of rows.
+//
+/// The wrapped rasterizer is given the same paths and clip box as when
+/// drawing the whole stage, so the coverage of every pixel in the band
+/// is exactly the same. Scanlines above the band are skipped, and
+/// sweeping stops after the band, though the scanline after it may
+/// still be swept: the renderer must clip to the band as well.
+//
+/// This has the interface the AGG scanline render functions use.
+template<typename Rasterizer>
+class BandRasterizer
+{
+public:
+
+    BandRasterizer(Rasterizer& ras, const geometry::Range2d<int>& band)
+        :
+        _ras(ras),
+        _first(band.getMinY()),
+        _last(band.getMaxY()),
+        _y(INT_MIN)
+    {}
+
+    bool rewind_scanlines() {
+        _y = INT_MIN;
+        if (!_ras.rewind_scanlines()) return false;
+        if (_first <= _ras.min_y()) return true;
+        return _ras.navigate_scanline(_first);
+    }
+
+    int min_x() const { return _ras.min_x(); }
+    int max_x() const { return _ras.max_x(); }
+    int min_y() const { return _ras.min_y(); }
+    int max_y() const { return _ras.max_y(); }
+
+    template<typename Scanline>
+    bool sweep_scanline(Scanline& sl) {
+        if (_y >= _last) return false;
+        return swept(_ras.sweep_scanline(sl), sl);
+    }
+
+    // Compound rasterizers only.
+    unsigned sweep_styles() {
+        if (_y >= _last) return 0;
+        return _ras.sweep_styles();
+    }
+
+    template<typename Scanline>
+    bool sweep_scanline(Scanline& sl, int style_idx) {
+        return swept(_ras.sweep_scanline(sl, style_idx), sl);
+    }
+
+    unsigned style(unsigned style_idx) const {
+        return _ras.style(style_idx);
+    }
+
+    int scanline_start() const { return _ras.scanline_start(); }
+    unsigned scanline_length() const { return _ras.scanline_length(); }
+
+    agg::cover_type* allocate_cover_buffer(unsigned len) {
+        return _ras.allocate_cover_buffer(len);
+    }
+
+private:
+
+    template<typename Scanline>
+    bool swept(bool ret, const Scanline& sl) {
+        if (ret) _y = sl.y();
+        return ret;
+    }
+
+    Rasterizer& _ras;
+    const int _first;
+    const int _last;
+
+    /// The last scanline swept.
+    int _y;
+};
+
+/// A vertex source reading a path without changing it.
+//
+/// A path_storage keeps the position it is read from, so paths shared by
+/// the band renderers are read through one of these each.
+class PathReader
+{
+public:
+
+    explicit PathReader(const agg::path_storage& path)
+        :
+        _path(path),
+        _next(0)
+    {}
+
+    void rewind(unsigned path_id) {
+        _next = path_id;
+    }
+
+    unsigned vertex(double* x, double* y) {
+        if (_next >= _path.total_vertices()) return agg::path_cmd_stop;
+        return _path.vertex(_next++, x, y);
+    }
+
+private:
+    const agg::path_storage& _path;
+    unsigned _next;
+};
+
+/// A vertex source leaving out the parts of a path away from a band of
+/// rows, so that the rasterizer doesn't make and sort their cells.
+//
+/// A run of segments that all lie above the band, or all below it, is
+/// replaced by one segment between the ends of the run, which lies on
+/// the same side. Cells of a row only depend on the segments crossing
+/// it, and the segments touching the band are passed on unchanged, so
+/// the band is drawn exactly as from the whole path.
+//
+/// This must be given the vertices in pixels, after curves are flattened
+/// and strokes made.
+template<typename VertexSource>
+class BandFilter
+{
+public:
+
+    BandFilter(VertexSource& source, const geometry::Range2d<int>& band)
+        :
+        _source(source),
+        _top(band.getMinY() * agg::poly_subpixel_scale),
+        _bottom((band.getMaxY() + 1) * agg::poly_subpixel_scale),
+        _side(0),
+        _held(false),
+        _queued(false)
+    {}
+
+    void rewind(unsigned path_id) {
+        _source.rewind(path_id);
+        _side = 0;
+        _held = false;
+        _queued = false;
+    }
+
+    unsigned vertex(double* x, double* y) {
+        if (_queued) {
+            _queued = false;
+            *x = _qx;
+            *y = _qy;
+            return _qcmd;
+        }
+
+        for (;;) {
+            const unsigned cmd = _source.vertex(x, y);
+            if (!agg::is_line_to(cmd)) {
+                _side = agg::is_move_to(cmd) ? side(*y) : 0;
+                return release(cmd, x, y);
+            }
+
+            const int s = side(*y);
+            const bool away = s && s == _side;
+            _side = s;
+
+            // The end of a segment away from the band is only needed if
+            // the next one touches the band.
+            if (away) {
+                _held = true;
+                _hx = *x;
+                _hy = *y;
+                continue;
+            }
+            return release(cmd, x, y);
+        }
+    }
+
+private:
+
+    /// Return the vertex held back, if any, and queue the command read.
+    unsigned release(unsigned cmd, double* x, double* y) {
+        if (!_held) return cmd;
+        _held = false;
+        _queued = true;
+        _qcmd = cmd;
+        _qx = *x;
+        _qy = *y;
+        *x = _hx;
+        *y = _hy;
+        return agg::path_cmd_line_to;
+    }
+
+    /// -1 above the band, 1 below it and 0 in it, rounded to subpixels
+    /// as the rasterizer does.
+    int side(double y) const {
+        const int sub = agg::iround(y * agg::poly_subpixel_scale);
+        if (sub < _top) return -1;
+        if (sub >= _bottom) return 1;
+        return 0;
+    }
+
+    VertexSource& _source;
+    const int _top;
+    const int _bottom;
+
+    /// The side of the last vertex read.
+    int _side;
+
+    /// The last vertex read, when held back.
+    bool _held;
+    double _hx;
+    double _hy;
+
+    /// A command read while returning the vertex held back.
+    bool _queued;
+    unsigned _qcmd;
+    double _qx;
+    double _qy;
+};
+
+/// A copy of a video frame owned by the recorded draw call.
+std::shared_ptr<image::GnashImage>
+copyFrame(const image::GnashImage& frame)
+{
+    std::shared_ptr<image::GnashImage> copy;
+    switch (frame.type()) {
+        case image::TYPE_RGB:
+            copy.reset(new image::ImageRGB(frame.width(), frame.height()));
+            break;
+        case image::TYPE_RGBA:
+            copy.reset(new image::ImageRGBA(frame.width(), frame.height()));
+            break;
+        default:
+            return copy;
+    }
+
+    const size_t bytes = std::min(frame.stride(), copy->stride());
+    for (size_t row = 0; row < frame.height(); ++row) {
+        const image::GnashImage::const_iterator from =
+            image::scanline(frame, row);
+        std::copy(from, from + bytes, image::scanline(*copy, row));
+    }
+    return copy;
+}
+
+/// Threads drawing the bands of a frame.
+//
+/// The threads wait for work between frames. The thread calling run()
+/// draws bands too.
+class RenderWorkers : boost::noncopyable
+{
+public:
+
+    typedef std::function<void()> Job;
+
+    /// @param threads  The number of threads to start.
+    explicit RenderWorkers(size_t threads)
+        :
+        _jobs(nullptr),
+        _next(0),
+        _pending(0),
+        _quit(false)
+    {
+        for (size_t i = 0; i < threads; ++i) {
+            _threads.emplace_back(&RenderWorkers::work, this);
+        }
+    }
+
+    ~RenderWorkers()
+    {
+        {
+            std::lock_guard<std::mutex> lock(_mutex);
+            _quit = true;
+        }
+        _wake.notify_all();
+        for (std::thread& t : _threads) t.join();
+    }
+
+    /// Run all jobs, returning when they are done.
+    void run(std::vector<Job>& jobs)
+    {
+        std::unique_lock<std::mutex> lock(_mutex);
+        _jobs = &jobs;
+        _next = 0;
+        _pending = jobs.size();
+        _wake.notify_all();
+
+        runJobs(lock);
+        _done.wait(lock, [this] { return !_pending; });
+        _jobs = nullptr;
+    }
+
+private:
+
+    void work()
+    {
+        std::unique_lock<std::mutex> lock(_mutex);
+        for (;;) {
+            _wake.wait(lock, [this] {
+                    return _quit || (_jobs && _next < _jobs->size());
+                });
+            if (_quit) return;
+            runJobs(lock);
+        }
+    }
+
+    /// Take jobs and run them until none are left.
+    void runJobs(std::unique_lock<std::mutex>& lock)
+    {
+        while (_jobs && _next < _jobs->size()) {
+            Job& job = (*_jobs)[_next++];
+            lock.unlock();
+            job();
+            lock.lock();
+            if (!--_pending) _done.notify_all();
+        }
+    }
+
+    std::vector<std::thread> _threads;
+
+    std::mutex _mutex;
+    std::condition_variable _wake;
+    std::condition_variable _done;
+
+    std::vector<Job>* _jobs;
+
+    /// The next job to take.
+    size_t _next;
+
+    /// The number of jobs not yet done.
+    size_t _pending;
+
+    bool _quit;
+};
+
+/// The number of threads drawing a frame, from gnashrc.
+unsigned int
+renderThreads()
+{
+    const int threads = RcInitFile::getDefaultInstance().renderThreads();
+    if (threads > 0) return threads;
+    return std::max(std::thread::hardware_concurrency(), 1u);
+}
+
 /// Analyzes a set of paths to detect real presence of fills and/or outlines
 /// TODO: This should be something the character tells us and should be 
 /// cached. 
@@ -305,14 +651,278 @@ buildPaths(AggPaths& dest, const GnashPaths& paths)
     std::for_each(paths.begin(), paths.end(), GnashToAggPath(dest, 0.05));
 } 
 
+/// Move paths by a whole number of TWIPS.
+void
+translatePaths(GnashPaths& paths, std::int32_t dx, std::int32_t dy)
+{
+    for (Path& path : paths) {
+        path.ap.x += dx;
+        path.ap.y += dy;
+        for (Edge& edge : path.m_edges) {
+            edge.cp.x += dx;
+            edge.cp.y += dy;
+            edge.ap.x += dx;
+            edge.ap.y += dy;
+        }
+    }
+}
+
+/// Shape paths transformed to the stage, kept from frame to frame.
+//
+/// Most characters are drawn with the same matrix in every frame, or are
+/// only moved, so their paths don't need to be transformed and converted
+/// again. Entries are keyed on the version of the shape, so a shape that
+/// changed is never drawn from stale paths. The least recently used
+/// entries are dropped when the cache grows over its limit.
+//
+/// The paths of a moved shape are those it had before shifted by the
+/// translation. Transforms are done in whole TWIPS, so this gives exactly
+/// the paths a new transform would.
+class PathCache : boost::noncopyable
+{
+public:
+
+    struct Entry
+    {
+        Entry() : haveFills(false), haveOutlines(false), bytes(0) {}
+
+        /// The transformed paths, in TWIPS.
+        GnashPaths paths;
+
+        /// The AGG paths for fills, if built.
+        AggPaths fills;
+        bool haveFills;
+
+        /// The AGG paths for outlines, if built.
+        AggPaths outlines;
+        bool haveOutlines;
+
+        size_t bytes;
+    };
+
+    /// @param limit    The number of bytes the entries may use. If 0,
+    ///                 nothing is kept.
+    explicit PathCache(size_t limit)
+        :
+        _limit(limit),
+        _bytes(0),
+        _hits(0),
+        _misses(0),
+        _moved(0)
+    {}
+
+    /// Return the paths of a subshape transformed by a matrix.
+    //
+    /// The entry stays valid until the next call.
+    //
+    /// @param version  The version of the shape.
+    /// @param subshape The index of the subshape in the shape.
+    /// @param paths    The paths of the subshape.
+    /// @param mat      The matrix from the shape to the stage in TWIPS.
+    Entry& get(std::uint64_t version, size_t subshape,
+            const GnashPaths& paths, const SWFMatrix& mat)
+    {
+        if (!_limit) {
+            ++_misses;
+            _scratch = Entry();
+            transform(_scratch.paths, paths, mat);
+            return _scratch;
+        }
+
+        const Key key(version, subshape, mat);
+        const Index::iterator found = _index.find(key);
+        if (found != _index.end()) {
+            ++_hits;
+            _entries.splice(_entries.begin(), _entries, found->second);
+            return found->second->second;
+        }
+
+        _entries.emplace_front();
+        Entries::iterator it = _entries.begin();
+        it->first = key;
+        _index[key] = it;
+
+        Key linear(key);
+        linear.tx = linear.ty = 0;
+        const Index::iterator moved = _linear.find(linear);
+        if (moved != _linear.end()) {
+            ++_moved;
+            const Key& from = moved->second->first;
+            it->second.paths = moved->second->second.paths;
+            translatePaths(it->second.paths, key.tx - from.tx,
+                    key.ty - from.ty);
+            moved->second = it;
+        }
+        else {
+            ++_misses;
+            transform(it->second.paths, paths, mat);
+            _linear[linear] = it;
+        }
+        update(it->second);
+        return it->second;
+    }
+
+    /// Return the entry for the paths of a subshape, or null if not kept.
+    //
+    /// Unlike get(), this changes nothing, so any number of threads may
+    /// call it while the cache is not otherwise used.
+    const Entry* find(std::uint64_t version, size_t subshape,
+            const SWFMatrix& mat) const
+    {
+        const Index::const_iterator found =
+            _index.find(Key(version, subshape, mat));
+        if (found == _index.end()) return nullptr;
+        return &found->second->second;
+    }
+
+    /// Account for the AGG paths built for an entry.
+    //
+    /// Entries are dropped if the cache is over its limit, but never the
+    /// one updated.
+    void update(Entry& entry)
+    {
+        if (!_limit) return;
+
+        _bytes -= entry.bytes;
+        entry.bytes = pathBytes(entry.paths) + aggBytes(entry.fills) +
+            aggBytes(entry.outlines);
+        _bytes += entry.bytes;
+
+        while (_bytes > _limit && _entries.size() > 1) {
+            const Entries::iterator last = std::prev(_entries.end());
+            assert(&last->second != &entry);
+            _bytes -= last->second.bytes;
+            _index.erase(last->first);
+            Key linear(last->first);
+            linear.tx = linear.ty = 0;
+            const Index::iterator l = _linear.find(linear);
+            if (l != _linear.end() && l->second == last) _linear.erase(l);
+            _entries.erase(last);
+        }
+    }
+
+    /// Change the number of bytes the entries may use.
+    //
+    /// This is only done before the cache is used.
+    void setLimit(size_t limit)
+    {
+        assert(_entries.empty());
+        _limit = limit;
+    }
+
+    size_t hits() const { return _hits; }
+    size_t misses() const { return _misses; }
+    size_t moved() const { return _moved; }
+    size_t entries() const { return _entries.size(); }
+    size_t bytes() const { return _bytes; }
+
+private:
+
+    struct Key
+    {
+        Key() : version(0), subshape(0), a(0), b(0), c(0), d(0), tx(0), ty(0)
+        {}
+
+        Key(std::uint64_t v, size_t s, const SWFMatrix& m)
+            :
+            version(v),
+            subshape(s),
+            a(m.a()), b(m.b()), c(m.c()), d(m.d()),
+            tx(m.tx()), ty(m.ty())
+        {}
+
+        bool operator==(const Key& o) const {
+            return version == o.version && subshape == o.subshape &&
+                a == o.a && b == o.b && c == o.c && d == o.d &&
+                tx == o.tx && ty == o.ty;
+        }
+
+        std::uint64_t version;
+        size_t subshape;
+        std::int32_t a, b, c, d, tx, ty;
+    };
+
+    struct KeyHash
+    {
+        size_t operator()(const Key& k) const {
+            std::uint64_t h = k.version * 0x9e3779b97f4a7c15ULL + k.subshape;
+            const std::int32_t v[] = { k.a, k.b, k.c, k.d, k.tx, k.ty };
+            for (std::int32_t i : v) {
+                h = (h ^ static_cast<std::uint32_t>(i)) * 0x100000001b3ULL;
+            }
+            return static_cast<size_t>(h ^ (h >> 32));
+        }
+    };
+
+    typedef std::list<std::pair<Key, Entry> > Entries;
+    typedef std::unordered_map<Key, Entries::iterator, KeyHash> Index;
+
+    static void transform(GnashPaths& out, const GnashPaths& in,
+            const SWFMatrix& mat)
+    {
+        out = in;
+        for (Path& path : out) path.transform(mat);
+    }
+
+    static size_t pathBytes(const GnashPaths& paths)
+    {
+        size_t bytes = 0;
+        for (const Path& path : paths) {
+            bytes += sizeof(Path) + path.m_edges.size() * sizeof(Edge);
+        }
+        return bytes;
+    }
+
+    static size_t aggBytes(const AggPaths& paths)
+    {
+        size_t bytes = 0;
+        for (const agg::path_storage& path : paths) {
+            // Each vertex is two coordinates and a command byte.
+            bytes += sizeof(agg::path_storage) +
+                path.total_vertices() * (2 * sizeof(double) + 1);
+        }
+        return bytes;
+    }
+
+    size_t _limit;
+    size_t _bytes;
+
+    /// The entries, most recently used first.
+    Entries _entries;
+
+    /// The entries by key.
+    Index _index;
+
+    /// The most recent entry for each key without its translation.
+    Index _linear;
+
+    /// The entry returned when nothing is kept.
+    Entry _scratch;
+
+    size_t _hits;
+    size_t _misses;
+    size_t _moved;
+};
+
+/// The memory in bytes for transformed paths, from gnashrc.
+size_t
+pathCacheSize()
+{
+    const int kb = RcInitFile::getDefaultInstance().pathCacheSize();
+    return kb > 0 ? static_cast<size_t>(kb) * 1024 : 0;
+}
+
 // --- ALPHA MASK BUFFER CONTAINER ---------------------------------------------
-// How masks are implemented: A mask is basically a full alpha buffer. Each 
+// How masks are implemented: A mask is basically an alpha buffer. Each 
 // pixel in the alpha buffer defines the fraction of color values that are
 // copied to the main buffer. The alpha mask buffer has 256 alpha levels per
-// pixel, which is good as it allows anti-aliased masks. A full size buffer
-// is allocated for each mask even if the invalidated bounds may be much 
-// smaller. The advantage of this is that the alpha mask adaptor does not need
-// to do any clipping which results in better performance.
+// pixel, which is good as it allows anti-aliased masks. The buffer only
+// covers the area of the stage where the mask is needed: the bounds of its
+// shapes inside the invalidated area, and inside the mask it is nested in.
+// Outside that area, the mask adaptor hides everything. Only the invalidated
+// bounds are cleared and drawn to, as nothing is drawn outside them while
+// the mask is active. Masks are kept in a pool when they are discarded, and
+// their buffers reused for the next ones.
 // Masks can be nested, which means the intersection of all masks should be 
 // visible (logical AND). To allow this we hold a stack of alpha masks and the 
 // topmost mask is used itself as a mask to draw any new mask. When rendering 
@@ -324,53 +934,129 @@ buildPaths(AggPaths& dest, const GnashPaths& paths)
 // anything we can draw otherwise (except lines, which are excluded 
 // explicitly).    
 
+/// An alpha mask adaptor for a buffer that starts at an offset.
+//
+/// Pixels outside the buffer are hidden.
+class OffsetMask
+{
+public:
+
+    typedef agg::alpha_mask_gray8 Mask;
+    typedef Mask::cover_type cover_type;
+
+    /// @param x    The column of the first pixel of the mask.
+    /// @param y    The row of the first pixel of the mask.
+    OffsetMask(const Mask& mask, int x, int y)
+        :
+        _mask(&mask),
+        _x(x),
+        _y(y)
+    {}
+
+    void combine_hspan(int x, int y, cover_type* dst, int num_pix) const {
+        _mask->combine_hspan(x - _x, y - _y, dst, num_pix);
+    }
+
+private:
+    const Mask* _mask;
+    int _x;
+    int _y;
+};
+
 class AlphaMask 
 {
 
     typedef agg::renderer_base<agg::pixfmt_gray8> Renderer;
-    typedef agg::alpha_mask_gray8 Mask;
 
 public:
 
-    AlphaMask(int width, int height)
+    AlphaMask()
         :
-        _rbuf(nullptr, width, height, width),
+        _rbuf(nullptr, 0, 0, 0),
         _pixf(_rbuf),
         _rbase(_pixf),
         _amask(_rbuf),
-        _buffer(new std::uint8_t[width * height]())
-    {
+        _stage(_amask, 0, 0),
+        _size(0)
+    {}
+
+    /// Cover the given area of the stage.
+    //
+    /// The buffer is kept if it is large enough, and not cleared. A mask
+    /// with a null area hides everything.
+    void setArea(const geometry::Range2d<int>& area) {
+        _area = area;
+        const int width = area.isNull() ? 0 : area.width() + 1;
+        const int height = area.isNull() ? 0 : area.height() + 1;
+
+        const size_t size = static_cast<size_t>(width) * height;
+        if (size > _size) {
+            _buffer.reset(new std::uint8_t[size]);
+            _size = size;
+        }
         _rbuf.attach(_buffer.get(), width, height, width);
+        _rbase.reset_clipping(true);
+        _stage = OffsetMask(_amask, left(), top());
+    }
+
+    /// The area of the stage covered, null if none.
+    const geometry::Range2d<int>& area() const {
+        return _area;
+    }
+
+    /// The area covered, with the buffer's coordinates.
+    geometry::Range2d<int> bufferArea() const {
+        if (_area.isNull()) return _area;
+        return geometry::Range2d<int>(0, 0, _area.width(), _area.height());
+    }
+
+    /// The column of the stage where the buffer starts.
+    int left() const {
+        return _area.isNull() ? 0 : _area.getMinX();
+    }
+
+    /// The row of the stage where the buffer starts.
+    int top() const {
+        return _area.isNull() ? 0 : _area.getMinY();
+    }
+
+    /// The bytes allocated for the buffer.
+    size_t size() const {
+        return _size;
     }
     
-    void clear(const geometry::Range2d<int>& region)
+    /// Clear a region of the stage, returning the number of bytes cleared.
+    size_t clear(const geometry::Range2d<int>& region)
     {
-        if (region.isNull()) return;
-        assert(region.isFinite());
-
-        const agg::gray8 black(0);
-                
-        // region can't be world as it should be intersected with 
-        // the visible SWFRect
-        assert(!region.isWorld());
+        const geometry::Range2d<int> r = Intersection(region, _area);
+        if (r.isNull()) return 0;
+        assert(r.isFinite());
 
-        unsigned int left = region.getMinX();
-        unsigned int width = region.width() + 1;
+        const size_t x = r.getMinX() - left();
+        const size_t width = r.width() + 1;
 
-        const unsigned int max_y = region.getMaxY();
-        for (unsigned int y=region.getMinY(); y <= max_y; ++y) 
-        {
-             _pixf.copy_hline(left, y, width, black);
+        // The rows of gray8 pixels are plain bytes.
+        const int max_y = r.getMaxY() - top();
+        for (int y = r.getMinY() - top(); y <= max_y; ++y) {
+            std::memset(_rbuf.row_ptr(y) + x, 0, width);
         }
+        return width * (r.height() + 1);
     }
-    
+
+    /// The renderer drawing to the mask, with the buffer's coordinates.
     Renderer& get_rbase() {
         return _rbase;
     }
     
-    const Mask& getMask() const {
-        return _amask;
+    /// The mask read with the stage's coordinates.
+    const OffsetMask& getMask() const {
+        return _stage;
     }    
+
+    /// The mask read with the buffer coordinates of another mask.
+    OffsetMask getMask(const AlphaMask& other) const {
+        return OffsetMask(_amask, left() - other.left(), top() - other.top());
+    }
     
 private:
 
@@ -384,10 +1070,19 @@ private:
     Renderer _rbase;
     
     // alpha mask
-    Mask _amask;
+    OffsetMask::Mask _amask;
+
+    // The alpha mask at stage coordinates.
+    OffsetMask _stage;
+
+    // The area of the stage covered.
+    geometry::Range2d<int> _area;
     
     // in-memory buffer
     std::unique_ptr<std::uint8_t[]> _buffer;
+
+    // The bytes allocated for the buffer.
+    size_t _size;
     
 };
 
@@ -470,7 +1165,7 @@ public:
         }
         else {
             // Untested.
-            typedef agg::scanline_u8_am<agg::alpha_mask_gray8> Scanline;
+            typedef agg::scanline_u8_am<OffsetMask> Scanline;
             Scanline sl(masks.back().getMask());
             renderScanlines(path, rbase, sl);
         }
@@ -615,7 +1310,7 @@ private:
         }
         else {
             // Untested.
-            typedef agg::scanline_u8_am<agg::alpha_mask_gray8> Scanline;
+            typedef agg::scanline_u8_am<OffsetMask> Scanline;
             Scanline sl(masks.back().getMask());
             renderScanlines(path, rbase, sl, sg);
         }
@@ -727,6 +1422,20 @@ public:
     void drawVideoFrame(image::GnashImage* frame, const Transform& xform,
         const SWFRect* bounds, bool smooth)
     {
+        if (_recording) {
+            // The Video may replace its frame before the bands are
+            // drawn, so they draw a copy.
+            std::shared_ptr<image::GnashImage> copy = copyFrame(*frame);
+            if (!copy) {
+                log_error(_("Can't render this type of frame"));
+                return;
+            }
+            const SWFRect b = *bounds;
+            _drawCalls.push_back([copy, xform, b, smooth](Renderer_agg& r) {
+                    r.drawVideoFrame(copy.get(), xform, &b, smooth);
+                });
+            return;
+        }
     
         // NOTE: Assuming that the source image is RGB 8:8:8
         // TODO: keep heavy instances alive accross frames for performance!
@@ -802,7 +1511,13 @@ public:
       yres(1),
       bpp(bits_per_pixel),
       scale_set(false),
-      m_drawing_mask(false)
+      m_drawing_mask(false),
+      _maskBytes(0),
+      _lastMaskBytes(0),
+      _renderThreads(renderThreads()),
+      _recording(false),
+      _pathCache(pathCacheSize()),
+      _sharedPaths(nullptr)
   {
     // TODO: we really don't want to set the scale here as the core should
     // tell us the right values before rendering anything. However this is
@@ -831,6 +1546,7 @@ public:
     // allocate pixel format accessor and renderer_base
     m_pixf.reset(new PixelFormat(m_rbuf));
     m_rbase.reset(new renderer_base(*m_pixf));  
+    _band = geometry::Range2d<int>(0, 0, xres - 1, yres - 1);
     
     // by default allow drawing everywhere
     set_invalidated_region_world();
@@ -849,13 +1565,24 @@ public:
     // them for display after ::end_display()
     _render_images.clear();
 
+    _maskBytes = 0;
+
+    // With more threads the frame is recorded, and drawn in bands by
+    // end_display().
+    if (_renderThreads > 1 && !_clipbounds.empty()) {
+        _background = bg;
+        _recording = true;
+        return;
+    }
+
     // clear the stage using the background color
     if ( ! _clipbounds.empty() )
     {
         const agg::rgba8& col = agg::rgba8_pre(bg.m_r, bg.m_g, bg.m_b, bg.m_a);
         for (const auto& bounds : _clipbounds)
         {
-            clear_framebuffer(bounds, col);
+            const geometry::Range2d<int> rows = Intersection(bounds, _band);
+            if (!rows.isNull()) clear_framebuffer(rows, col);
         }
     }
     
@@ -922,6 +1649,14 @@ public:
     // Clean up after rendering a frame. 
     void end_display()
     {
+        _lastMaskBytes = _maskBytes;
+
+        if (_recording) {
+            _recording = false;
+            drawBands();
+            return;
+        }
+
         if (m_drawing_mask) {
             log_debug("Warning: rendering ended while drawing a mask");
         }
@@ -933,6 +1668,82 @@ public:
         }
     }
 
+    /// Draw the recorded frame in bands of rows, one per thread.
+    //
+    /// Each band is drawn by a renderer sharing this one's buffer, which
+    /// replays all draw calls but only writes to the rows of its band.
+    /// As every pixel goes through the same operations as when drawing
+    /// serially, the result is exactly the same.
+    void drawBands()
+    {
+        int top = yres;
+        int bottom = -1;
+        for (const auto& bounds : _clipbounds) {
+            top = std::min(top, bounds.getMinY());
+            bottom = std::max(bottom, bounds.getMaxY());
+        }
+
+        const int rows = bottom - top + 1;
+        const size_t bands = std::min<size_t>(_renderThreads, rows);
+
+        while (_bandRenderers.size() < bands) {
+            _bandRenderers.emplace_back(new Renderer_agg(bpp));
+            _bandRenderers.back()->_renderThreads = 1;
+            _bandRenderers.back()->_pathCache.setLimit(0);
+            _bandRenderers.back()->_sharedPaths = &_pathCache;
+        }
+        if (!_workers) _workers.reset(new RenderWorkers(_renderThreads - 1));
+
+        std::vector<RenderWorkers::Job> jobs;
+        for (size_t i = 0; i < bands; ++i) {
+
+            Renderer_agg& r = *_bandRenderers[i];
+            r.init_buffer(m_rbuf.buf(), 0, xres, yres, m_rbuf.stride());
+            r._clipbounds = _clipbounds;
+            r.stage_matrix = stage_matrix;
+            r.scale_set = scale_set;
+            r._quality = _quality;
+            r.setBand(geometry::Range2d<int>(0, top + rows * i / bands,
+                        xres - 1, top + rows * (i + 1) / bands - 1));
+
+            jobs.push_back([this, &r] {
+                    r.begin_display(_background, 0, 0, 0, 0, 0, 0);
+                    for (const DrawCall& call : _drawCalls) call(r);
+                    r.end_display();
+                });
+        }
+
+        _workers->run(jobs);
+        _drawCalls.clear();
+
+        for (size_t i = 0; i < bands; ++i) {
+            _lastMaskBytes += _bandRenderers[i]->_lastMaskBytes;
+        }
+
+        // Every band has the same images.
+        const RenderImages& images = _bandRenderers.front()->_render_images;
+        _render_images.insert(_render_images.end(), images.begin(),
+                images.end());
+    }
+
+    /// Only draw to the given band of rows.
+    //
+    /// The invalidated bounds are reduced to those touching the band,
+    /// but are not cut to fit it.
+    void setBand(const geometry::Range2d<int>& band)
+    {
+        _band = band;
+        m_rbase->clip_box(band.getMinX(), band.getMinY(), band.getMaxX(),
+                band.getMaxY());
+
+        ClipBounds::iterator it = std::remove_if(_clipbounds.begin(),
+                _clipbounds.end(), [&band](const geometry::Range2d<int>& b) {
+                    return b.getMaxY() < band.getMinY() ||
+                        b.getMinY() > band.getMaxY();
+                });
+        _clipbounds.erase(it, _clipbounds.end());
+    }
+
     // Draw the line strip formed by the sequence of points.
     void drawLine(const std::vector<point>& coords, const rgba& color,
             const SWFMatrix& line_mat)
@@ -943,6 +1754,13 @@ public:
         if (_clipbounds.empty()) return;
         if (coords.empty()) return;
 
+        if (_recording) {
+            _drawCalls.push_back([coords, color, line_mat](Renderer_agg& r) {
+                    r.drawLine(coords, color, line_mat);
+                });
+            return;
+        }
+
         SWFMatrix mat = stage_matrix;
         mat.concatenate(line_mat);    
 
@@ -981,7 +1799,7 @@ public:
         }
         else {
             // Mask is active!
-            typedef agg::scanline_u8_am<agg::alpha_mask_gray8> sl_type;
+            typedef agg::scanline_u8_am<OffsetMask> sl_type;
             sl_type sl(_alphaMasks.back().getMask());      
             lr.render(sl, stroke, color);
         }
@@ -989,29 +1807,88 @@ public:
     } 
 
 
-    void begin_submit_mask()
+    void begin_submit_mask(const SWFRect& bounds)
     {
         // Set flag so that rendering of shapes is simplified (only solid fill) 
         m_drawing_mask = true;
 
-        _alphaMasks.push_back(new AlphaMask(xres, yres));
+        if (_recording) {
+            _drawCalls.push_back([bounds](Renderer_agg& r) {
+                    r.begin_submit_mask(bounds);
+                });
+            return;
+        }
+
+        // Nothing is drawn outside the invalidated bounds of the band, so
+        // the mask is only needed there.
+        geometry::Range2d<int> area;
+        for (const auto& clip : _clipbounds) {
+            area.expandTo(Intersection(clip, _band));
+        }
+
+        // Nothing is visible outside the shapes of the mask, allowing a
+        // pixel for anti-aliasing, or outside the mask it is nested in.
+        geometry::Range2d<int> shapes = world_to_pixel(bounds);
+        shapes.growBy(1);
+        area = Intersection(area, shapes);
+        if (!_alphaMasks.empty()) {
+            area = Intersection(area, _alphaMasks.back().area());
+        }
+
+        _alphaMasks.push_back(takeMask(area).release());
         AlphaMask& new_mask = _alphaMasks.back();
 
-        for (const auto& bounds : _clipbounds ) {
-            new_mask.clear(bounds);
+        // The area between the bounds may be drawn to, but is never used.
+        for (const auto& clip : _clipbounds) {
+            _maskBytes += new_mask.clear(Intersection(clip, _band));
         }
 
     }
 
+    /// A mask covering an area, with a buffer from the pool if any.
+    //
+    /// A buffer large enough is used if there is one, otherwise one
+    /// is grown.
+    std::unique_ptr<AlphaMask> takeMask(const geometry::Range2d<int>& area)
+    {
+        std::unique_ptr<AlphaMask> mask;
+        if (_maskPool.empty()) mask.reset(new AlphaMask);
+        else {
+            const size_t size = area.isNull() ? 0 :
+                static_cast<size_t>(area.width() + 1) * (area.height() + 1);
+            auto it = std::find_if(_maskPool.begin(), _maskPool.end(),
+                    [size](const std::unique_ptr<AlphaMask>& m) {
+                        return m->size() >= size;
+                    });
+            if (it == _maskPool.end()) --it;
+            mask = std::move(*it);
+            _maskPool.erase(it);
+        }
+        mask->setArea(area);
+        return mask;
+    }
+
     void end_submit_mask()
     {
         m_drawing_mask = false;
+
+        if (_recording) {
+            _drawCalls.push_back([](Renderer_agg& r) {
+                    r.end_submit_mask();
+                });
+        }
     }
 
     void disable_mask()
     {
+        if (_recording) {
+            _drawCalls.push_back([](Renderer_agg& r) {
+                    r.disable_mask();
+                });
+            return;
+        }
         assert(!_alphaMasks.empty());
-        _alphaMasks.pop_back();
+        _maskPool.emplace_back(_alphaMasks.pop_back().release());
     }
   
 
@@ -1020,7 +1897,7 @@ public:
   {
     if (shape.subshapes().empty()) return;
     assert(shape.subshapes().size() == 1);
-    
+
     // select relevant clipping bounds
     if (shape.getBounds().is_null()) {
         return;
@@ -1028,9 +1905,22 @@ public:
     select_clipbounds(shape.getBounds(), mat);
     
     if (_clipbounds_selected.empty()) return; 
-      
-    GnashPaths paths;
-    apply_matrix_to_path(shape.subshapes().front().paths(), paths, mat);
+
+    // convert gnash paths to agg paths, unless it's a mask.
+    const PathCache::Entry& entry = subshapePaths(shape.version(), 0,
+            shape.subshapes().front().paths(), mat, !m_drawing_mask,
+            nullptr);
+
+    if (_recording) {
+        _clipbounds_selected.clear();
+        const SWF::ShapeRecord* rec = &shape;
+        _drawCalls.push_back([rec, color, mat](Renderer_agg& r) {
+                r.drawGlyph(*rec, color, mat);
+            });
+        return;
+    }
+
+    const GnashPaths& paths = entry.paths;
 
     // If it's a mask, we don't need the rest.
     if (m_drawing_mask) {
@@ -1038,9 +1928,7 @@ public:
       return;
     }
 
-    // convert gnash paths to agg paths.
-    AggPaths agg_paths;    
-    buildPaths(agg_paths, paths);
+    const AggPaths& agg_paths = entry.fills;
  
     std::vector<FillStyle> v(1, FillStyle(SolidFill(color)));
 
@@ -1105,6 +1993,42 @@ public:
   }
 
     void drawShape(const SWF::ShapeRecord& shape, const Transform& xform)
+    {
+        if (_recording) {
+            // Bitmap fills look their bitmap up in the BitmapCache,
+            // which the band threads must not use, so it is done here.
+            ShapeBitmaps bitmaps;
+            for (const SWF::Subshape& subshape : shape.subshapes()) {
+                bitmaps.emplace_back();
+                for (const FillStyle& style : subshape.fillStyles()) {
+                    const BitmapFill* f = boost::get<BitmapFill>(&style.fill);
+                    bitmaps.back().push_back(f ? f->bitmap() : nullptr);
+                }
+            }
+
+            cachePaths(shape, xform.matrix);
+
+            const SWF::ShapeRecord* rec = &shape;
+            _drawCalls.push_back([rec, xform, bitmaps](Renderer_agg& r) {
+                    r.drawSubshapes(*rec, xform, &bitmaps);
+                });
+            return;
+        }
+
+        drawSubshapes(shape, xform, nullptr);
+    }
+
+    /// The bitmaps of the fill styles of each subshape of a shape.
+    //
+    /// Fill styles that are not bitmaps have a null entry.
+    typedef std::vector<std::vector<const CachedBitmap*> > ShapeBitmaps;
+
+    /// Draw all subshapes of a shape.
+    //
+    /// @param bitmaps  The bitmaps of the fills, looked up before, or
+    ///                 null to look them up now.
+    void drawSubshapes(const SWF::ShapeRecord& shape, const Transform& xform,
+            const ShapeBitmaps* bitmaps)
     {
         // check if the character needs to be rendered at all
         SWFRect cur_bounds;
@@ -1116,8 +2040,10 @@ public:
             return; // no need to draw
         }
 
-        for (const SWF::Subshape& subshape : shape.subshapes()) {
+        const SWF::ShapeRecord::Subshapes& subshapes = shape.subshapes();
+        for (size_t i = 0; i < subshapes.size(); ++i) {
 
+            const SWF::Subshape& subshape = subshapes[i];
             const SWF::ShapeRecord::FillStyles& fillStyles = subshape.fillStyles();
             const SWF::ShapeRecord::LineStyles& lineStyles = subshape.lineStyles();
             const SWF::ShapeRecord::Paths& paths = subshape.paths();
@@ -1126,15 +2052,94 @@ public:
             select_clipbounds(shape.getBounds(), xform.matrix);
 
             // render the DisplayObject's subshape.
-            drawShape(fillStyles, lineStyles, paths, xform.matrix,
-                      xform.colorTransform);
+            drawShape(shape, i, fillStyles, lineStyles, paths, xform.matrix,
+                      xform.colorTransform, bitmaps ? &(*bitmaps)[i] : nullptr);
+        }
+    }
+
+    /// Build the paths of a recorded shape the bands will draw.
+    //
+    /// The band renderers only read this renderer's path cache, so
+    /// whatever they need is built here, before they start.
+    void cachePaths(const SWF::ShapeRecord& shape, const SWFMatrix& mat)
+    {
+        SWFRect cur_bounds;
+        cur_bounds.expand_to_transformed_rect(mat, shape.getBounds());
+        if (!bounds_in_clipping_area(cur_bounds.getRange())) return;
+
+        select_clipbounds(shape.getBounds(), mat);
+        const bool visible = !_clipbounds_selected.empty();
+        _clipbounds_selected.clear();
+
+        const SWF::ShapeRecord::Subshapes& subshapes = shape.subshapes();
+        for (size_t i = 0; i < subshapes.size(); ++i) {
+
+            const SWF::Subshape& subshape = subshapes[i];
+            bool have_shape, have_outline;
+            analyzePaths(subshape.paths(), have_shape, have_outline);
+            if (!have_shape && !have_outline) continue;
+
+            if (m_drawing_mask) {
+                subshapePaths(shape.version(), i, subshape.paths(), mat,
+                        false, nullptr);
+            }
+            else if (visible) {
+                subshapePaths(shape.version(), i, subshape.paths(), mat,
+                        have_shape,
+                        have_outline ? &subshape.lineStyles() : nullptr);
+            }
+        }
+    }
+
+    /// Return the transformed paths of a subshape with the AGG paths
+    /// asked for.
+    //
+    /// A band renderer takes them from the recording renderer's cache if
+    /// they are there, and otherwise builds them in its own scratch entry.
+    //
+    /// @param fills        Whether the AGG paths for fills are needed.
+    /// @param lineStyles   The line styles of the outlines, or null if
+    ///                     the AGG paths for outlines are not needed.
+    const PathCache::Entry& subshapePaths(std::uint64_t version,
+            size_t subshape, const GnashPaths& objpaths,
+            const SWFMatrix& mat, bool fills,
+            const std::vector<LineStyle>* lineStyles)
+    {
+        const SWFMatrix stageMat = pathMatrix(mat);
+
+        if (_sharedPaths) {
+            const PathCache::Entry* shared =
+                _sharedPaths->find(version, subshape, stageMat);
+            if (shared && (!fills || shared->haveFills) &&
+                    (!lineStyles || shared->haveOutlines)) {
+                return *shared;
+            }
+        }
+
+        PathCache::Entry& entry = _pathCache.get(version, subshape,
+                objpaths, stageMat);
+
+        // Flash only aligns outlines. Probably this is done at rendering
+        // level.
+        if (lineStyles && !entry.haveOutlines) {
+            buildPaths_rounded(entry.outlines, entry.paths, *lineStyles);
+            entry.haveOutlines = true;
+        }
+
+        if (fills && !entry.haveFills) {
+            buildPaths(entry.fills, entry.paths);
+            entry.haveFills = true;
         }
+        _pathCache.update(entry);
+
+        return entry;
     }
 
-    void drawShape(const std::vector<FillStyle>& FillStyles,
+    void drawShape(const SWF::ShapeRecord& shape, size_t subshape,
+        const std::vector<FillStyle>& FillStyles,
         const std::vector<LineStyle>& line_styles,
         const std::vector<Path>& objpaths, const SWFMatrix& mat,
-        const SWFCxForm& cx)
+        const SWFCxForm& cx, const std::vector<const CachedBitmap*>* bitmaps)
     {
 
         bool have_shape, have_outline;
@@ -1146,33 +2151,17 @@ public:
             return; 
         }
 
-        GnashPaths paths;
-        apply_matrix_to_path(objpaths, paths, mat);
-
         // Masks apparently do not use agg_paths, so return
         // early
         if (m_drawing_mask) {
 
             // Shape is drawn inside a mask, skip sub-shapes handling and
             // outlines
-            draw_mask_shape(paths, false); 
+            draw_mask_shape(subshapePaths(shape.version(), subshape,
+                        objpaths, mat, false, nullptr).paths, false); 
             return;
         }
 
-        AggPaths agg_paths;    
-        AggPaths agg_paths_rounded;    
-
-        // Flash only aligns outlines. Probably this is done at rendering
-        // level.
-        if (have_outline) {
-            buildPaths_rounded(agg_paths_rounded, paths, line_styles);     
-        }
-
-        if (have_shape) {
-            buildPaths(agg_paths, paths);
-        }
-        
-
         if (_clipbounds_selected.empty()) {
 #ifdef GNASH_WARN_WHOLE_CHARACTER_SKIP
             log_debug("Warning: AGG renderer skipping a whole character");
@@ -1180,9 +2169,17 @@ public:
             return; 
         }
 
+        const PathCache::Entry& entry = subshapePaths(shape.version(),
+                subshape, objpaths, mat, have_shape,
+                have_outline ? &line_styles : nullptr);
+        const GnashPaths& paths = entry.paths;
+
+        const AggPaths& agg_paths = entry.fills;
+        const AggPaths& agg_paths_rounded = entry.outlines;
+
         // prepare fill styles
         StyleHandler sh;
-        if (have_shape) build_agg_styles(sh, FillStyles, mat, cx);
+        if (have_shape) build_agg_styles(sh, FillStyles, mat, cx, bitmaps);
 
 
             if (have_shape) {
@@ -1197,27 +2194,62 @@ public:
         _clipbounds_selected.clear();
     }
 
-    /// Takes a path and translates it using the given SWFMatrix. The new path
-    /// is stored in paths_out. Both paths_in and paths_out are expected to
-    /// be in TWIPS.
-    void apply_matrix_to_path(const GnashPaths &paths_in, 
-          GnashPaths& paths_out, const SWFMatrix &source_mat) 
+    /// The bytes allocated for the buffers of masks.
+    size_t maskBufferBytes() const
+    {
+        size_t bytes = 0;
+        for (const auto& m : _maskPool) bytes += m->size();
+        for (const AlphaMask& m : _alphaMasks) bytes += m.size();
+        return bytes;
+    }
+
+    void getStats(Stats& stats) const
     {
+        size_t hits = _pathCache.hits();
+        size_t misses = _pathCache.misses();
+        size_t moved = _pathCache.moved();
+        size_t entries = _pathCache.entries();
+        size_t bytes = _pathCache.bytes();
+        size_t masks = _maskPool.size() + _alphaMasks.size();
+        size_t maskBytes = maskBufferBytes();
+        for (const auto& r : _bandRenderers) {
+            masks += r->_maskPool.size() + r->_alphaMasks.size();
+            maskBytes += r->maskBufferBytes();
+            hits += r->_pathCache.hits();
+            misses += r->_pathCache.misses();
+            moved += r->_pathCache.moved();
+            entries += r->_pathCache.entries();
+            bytes += r->_pathCache.bytes();
+        }
 
+        stats.push_back(std::make_pair("Path cache hits",
+                    std::to_string(hits)));
+        stats.push_back(std::make_pair("Path cache misses",
+                    std::to_string(misses)));
+        stats.push_back(std::make_pair("Path cache moved shapes",
+                    std::to_string(moved)));
+        stats.push_back(std::make_pair("Path cache entries",
+                    std::to_string(entries)));
+        stats.push_back(std::make_pair("Path cache kilobytes",
+                    std::to_string(bytes / 1024)));
+        stats.push_back(std::make_pair("Mask buffers",
+                    std::to_string(masks)));
+        stats.push_back(std::make_pair("Mask buffer kilobytes",
+                    std::to_string(maskBytes / 1024)));
+        stats.push_back(std::make_pair("Mask kilobytes cleared per frame",
+                    std::to_string(_lastMaskBytes / 1024)));
+    }
+
+    /// The matrix transforming paths to the stage. The transformed
+    /// paths are kept in TWIPS for accuracy.
+    SWFMatrix pathMatrix(const SWFMatrix& source_mat) const
+    {
         SWFMatrix mat;
-        // make sure paths_out is also in TWIPS to keep accuracy.
         mat.concatenate_scale(20.0,  20.0);
         mat.concatenate(stage_matrix);
         mat.concatenate(source_mat);
-
-        // Copy paths for in-place transform
-        paths_out = paths_in;
-
-        /// Transform all the paths using the matrix.
-        std::for_each(paths_out.begin(), paths_out.end(), 
-                std::bind(&Path::transform, std::placeholders::_1,
-		    std::ref(mat)));
-    } 
+        return mat;
+    }
 
   // Version of buildPaths that uses rounded coordinates (pixel hinting)
   // for line styles that want it.  
@@ -1374,9 +2406,13 @@ public:
   } //buildPaths_rounded
 
     // Initializes the internal styles class for AGG renderer
+    //
+    // If given, bitmaps has the bitmap of each bitmap fill, so they are
+    // not looked up again.
     void build_agg_styles(StyleHandler& sh,
         const std::vector<FillStyle>& FillStyles,
-        const SWFMatrix& fillstyle_matrix, const SWFCxForm& cx) {
+        const SWFMatrix& fillstyle_matrix, const SWFCxForm& cx,
+        const std::vector<const CachedBitmap*>* bitmaps = nullptr) {
     
         SWFMatrix inv_stage_matrix = stage_matrix;
         inv_stage_matrix.invert();
@@ -1386,7 +2422,9 @@ public:
         for (size_t fno = 0; fno < fcount; ++fno) {
             const AddStyles st(stage_matrix, fillstyle_matrix, cx, sh,
                     _quality);
-            boost::apply_visitor(st, FillStyles[fno].fill);
+            const BitmapFill* f = boost::get<BitmapFill>(&FillStyles[fno].fill);
+            if (f && bitmaps) st.addBitmap(*f, (*bitmaps)[fno]);
+            else boost::apply_visitor(st, FillStyles[fno].fill);
         } 
     } 
   
@@ -1425,7 +2463,7 @@ public:
     
       // Mask is active, use alpha mask scanline renderer
       
-      typedef agg::scanline_u8_am<agg::alpha_mask_gray8> scanline_type;
+      typedef agg::scanline_u8_am<OffsetMask> scanline_type;
       
       scanline_type sl(_alphaMasks.back().getMask());
       
@@ -1486,10 +2524,9 @@ public:
       for (size_t pno=0; pno<pcount; ++pno) {
           
         const Path &this_path_gnash = paths[pno];
-        agg::path_storage &this_path_agg = 
-          const_cast<agg::path_storage&>(agg_paths[pno]);
+        PathReader this_path_agg(agg_paths[pno]);
         
-        agg::conv_curve<agg::path_storage> curve(this_path_agg);        
+        agg::conv_curve<PathReader> curve(this_path_agg);        
 
         if ((this_path_gnash.m_fill0==0) && (this_path_gnash.m_fill1==0)) {
           // Skip this path as it contains no fill style
@@ -1503,11 +2540,13 @@ public:
         rasc.styles(this_path_gnash.m_fill0-1, this_path_gnash.m_fill1-1);
                 
         // add path to the compound rasterizer
-        rasc.add_path(curve);
+        BandFilter<agg::conv_curve<PathReader> > banded(curve, _band);
+        rasc.add_path(banded);
       
       }
 
-      agg::render_scanlines_compound_layered(rasc, sl, rbase, alloc, sh);
+      BandRasterizer<ras_type> ras(rasc, _band);
+      agg::render_scanlines_compound_layered(ras, sl, rbase, alloc, sh);
     }
     
   } // draw_shape_impl
@@ -1521,6 +2560,9 @@ public:
   {
 
     const AlphaMasks::size_type mask_count = _alphaMasks.size();
+
+    // The mask is not needed anywhere in the band.
+    if (_alphaMasks.back().area().isNull()) return;
     
     if (mask_count < 2) {
     
@@ -1538,9 +2580,11 @@ public:
       // Woohoo! We're drawing a nested mask! Use the previous mask while 
       // drawing the new one, the result will be the intersection.
       
-      typedef agg::scanline_u8_am<agg::alpha_mask_gray8> scanline_type;
+      typedef agg::scanline_u8_am<OffsetMask> scanline_type;
       
-      scanline_type sl(_alphaMasks[mask_count - 2].getMask());
+      const OffsetMask previous =
+          _alphaMasks[mask_count - 2].getMask(_alphaMasks.back());
+      scanline_type sl(previous);
       
       draw_mask_shape_impl(paths, even_odd, sl);
         
@@ -1571,9 +2615,17 @@ public:
     if (even_odd) rasc.filling_rule(agg::fill_even_odd);
     else rasc.filling_rule(agg::fill_non_zero);
       
-    // push paths to AGG
+    AlphaMask& mask = _alphaMasks.back();
+
+    // push paths to AGG, moved to the mask's buffer
+    typedef agg::conv_curve<agg::path_storage> Curve;
+    typedef agg::conv_transform<Curve> Moved;
     agg::path_storage path; 
-    agg::conv_curve<agg::path_storage> curve(path);
+    Curve curve(path);
+    agg::trans_affine offset =
+        agg::trans_affine_translation(-mask.left(), -mask.top());
+    Moved moved(curve, offset);
+    BandFilter<Moved> banded(moved, mask.bufferArea());
 
     for (const Path& this_path : paths) {
 
@@ -1592,12 +2644,12 @@ public:
               EdgeToPath(path));
       
       // add to rasterizer
-      rasc.add_path(curve);
+      rasc.add_path(banded);
     
     } // for path
     
     // renderer base
-    renderer_base& rbase = _alphaMasks.back().get_rbase();
+    renderer_base& rbase = mask.get_rbase();
     
     // span allocator
     typedef agg::span_allocator<agg::gray8> alloc_type;
@@ -1605,7 +2657,8 @@ public:
       
     
     // now render that thing!
-    agg::render_scanlines_compound_layered (rasc, sl, rbase, alloc, sh);
+    BandRasterizer<rasc_type> ras(rasc, mask.bufferArea());
+    agg::render_scanlines_compound_layered (ras, sl, rbase, alloc, sh);
         
   } // draw_mask_shape
 
@@ -1632,7 +2685,7 @@ public:
     
       // Mask is active, use alpha mask scanline renderer
       
-      typedef agg::scanline_u8_am<agg::alpha_mask_gray8> scanline_type;
+      typedef agg::scanline_u8_am<OffsetMask> scanline_type;
       
       scanline_type sl(_alphaMasks.back().getMask());
       
@@ -1685,16 +2738,15 @@ public:
 
         const Path& this_path_gnash = paths[pno];
 
-        agg::path_storage &this_path_agg = 
-          const_cast<agg::path_storage&>(agg_paths[pno]);
+        PathReader this_path_agg(agg_paths[pno]);
         
         if (this_path_gnash.m_line==0) {
           // Skip this path as it contains no line style
           continue;
         } 
         
-        agg::conv_curve< agg::path_storage > curve(this_path_agg); // to render curves
-        agg::conv_stroke< agg::conv_curve < agg::path_storage > > 
+        agg::conv_curve< PathReader > curve(this_path_agg); // to render curves
+        agg::conv_stroke< agg::conv_curve < PathReader > > 
           stroke(curve);  // to get an outline
 
         const LineStyle& lstyle = line_styles[this_path_gnash.m_line-1];
@@ -1737,12 +2789,15 @@ public:
         stroke.miter_limit(lstyle.miterLimitFactor());
                 
         ras.reset();
-        ras.add_path(stroke);
+        BandFilter<agg::conv_stroke<agg::conv_curve<PathReader> > >
+            banded(stroke, _band);
+        ras.add_path(banded);
         
         rgba color = cx.transform(lstyle.get_color());
         ren_sl.color(agg::rgba8_pre(color.m_r, color.m_g, color.m_b, color.m_a));       
                 
-        agg::render_scanlines(ras, sl, ren_sl);
+        BandRasterizer<ras_type> band(ras, _band);
+        agg::render_scanlines(band, sl, ren_sl);
         
       }
     
@@ -1836,12 +2891,20 @@ public:
   
   void draw_poly(const std::vector<point>& corners, const rgba& fill, 
     const rgba& outline, const SWFMatrix& mat, bool masked) {
+
+    if (_recording) {
+        _drawCalls.push_back([corners, fill, outline, mat, masked]
+                (Renderer_agg& r) {
+                r.draw_poly(corners, fill, outline, mat, masked);
+            });
+        return;
+    }
     
     if (masked && !_alphaMasks.empty()) {
     
       // apply mask
       
-      typedef agg::scanline_u8_am<agg::alpha_mask_gray8> sl_type; 
+      typedef agg::scanline_u8_am<OffsetMask> sl_type; 
       
       sl_type sl(_alphaMasks.back().getMask());
          
@@ -2015,10 +3078,47 @@ private:  // private variables
 
     // Alpha mask stack
     AlphaMasks _alphaMasks;
+
+    /// Masks no longer used, kept for the next ones.
+    std::vector<std::unique_ptr<AlphaMask> > _maskPool;
+
+    /// The bytes of masks cleared in the frame being drawn.
+    size_t _maskBytes;
+
+    /// The bytes of masks cleared in the last frame, by all bands.
+    size_t _lastMaskBytes;
     
     /// Cached fill style list with just one entry used for font rendering
     std::vector<FillStyle> m_single_FillStyles;
 
+    /// The rows this renderer draws to.
+    geometry::Range2d<int> _band;
+
+    /// The number of threads drawing a frame.
+    unsigned int _renderThreads;
+
+    /// Whether draw calls are recorded, to be drawn in bands.
+    bool _recording;
+
+    /// The background of the recorded frame.
+    rgba _background;
+
+    typedef std::function<void(Renderer_agg&)> DrawCall;
+
+    /// The draw calls of the recorded frame.
+    std::vector<DrawCall> _drawCalls;
+
+    /// Renderers for the bands of a frame, sharing this one's buffer.
+    std::vector<std::unique_ptr<Renderer_agg> > _bandRenderers;
+
+    std::unique_ptr<RenderWorkers> _workers;
+
+    /// Transformed paths kept between frames.
+    PathCache _pathCache;
+
+    /// For a band renderer, the cache of the renderer recording the
+    /// frame. It is only read while the bands are drawn.
+    const PathCache* _sharedPaths;
 
 };
 
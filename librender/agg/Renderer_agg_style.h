@@ -619,6 +619,13 @@ struct AddStyles : boost::static_visitor<>
     }
 
     void operator()(const BitmapFill& f) const {
+        addBitmap(f, f.bitmap());
+    }
+
+    /// Add a bitmap fill drawing the given bitmap.
+    //
+    /// @param bm   The bitmap of the fill, looked up before.
+    void addBitmap(const BitmapFill& f, const CachedBitmap* bm) const {
         SWFMatrix m = f.matrix();
         m.concatenate(_fillMatrix);
         m.concatenate(_stageMatrix);
@@ -648,8 +655,6 @@ struct AddStyles : boost::static_visitor<>
 
         const bool tiled = (f.type() == BitmapFill::TILED);
 
-        const CachedBitmap* bm = f.bitmap(); 
-
         if (!bm) {
             // See misc-swfmill.all/missing_bitmap.swf
             _sh.add_color(agg::rgba8_pre(255,0,0,255));
@@ -759,7 +759,7 @@ Renderer_cairo::set_antialiased(bool /*enable*/)
 }
     
 void
-Renderer_cairo::begin_submit_mask()
+Renderer_cairo::begin_submit_mask(const SWFRect& /*bounds*/)
 {
     PathVec mask;
     _masks.push_back(mask);
@@ -83,7 +83,7 @@ public:
 
     void set_antialiased(bool enable);
 
-    void begin_submit_mask();
+    void begin_submit_mask(const SWFRect& bounds);
     void end_submit_mask();
     void disable_mask();
 
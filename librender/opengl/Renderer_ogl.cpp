@@ -1142,7 +1142,7 @@ public:
       log_unimpl(_("set_antialiased"));
   }
     
-  virtual void begin_submit_mask()
+  virtual void begin_submit_mask(const SWFRect& /*bounds*/)
   {
     PathVec mask;
     _masks.push_back(mask);
@@ -231,7 +231,7 @@ Renderer_gles1::set_antialiased(bool /* enable */)
 }
 
 void
-Renderer_gles1::begin_submit_mask()
+Renderer_gles1::begin_submit_mask(const SWFRect& /*bounds*/)
 {
 #if 0
     GnashDevice::PathVec mask;
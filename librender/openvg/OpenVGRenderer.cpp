@@ -571,7 +571,7 @@ Renderer_ovg::set_antialiased(bool /* enable */)
 }
 
 void
-Renderer_ovg::begin_submit_mask()
+Renderer_ovg::begin_submit_mask(const SWFRect& /*bounds*/)
 {
     // GNASH_REPORT_FUNCTION;
 
@@ -0,0 +1,160 @@
+// Mixer.cpp: mixing of 16-bit samples
+//
+//   Copyright (C) 2005, 2006, 2007, 2008, 2009, 2010, 2011, 2012
+//   Free Software Foundation, Inc
+//
+// This program is free software; you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation; either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program; if not, write to the Free Software
+// Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+
+#include "Mixer.h"
+
+#include <cassert>
+
+#if defined(__AVX2__)
+# include <immintrin.h>
+#elif defined(__SSE2__)
+# include <emmintrin.h>
+#elif defined(__ARM_NEON) || defined(__ARM_NEON__)
+# include <arm_neon.h>
+# define GNASH_MIX_NEON 1
+#endif
+
+namespace gnash {
+namespace sound {
+
+namespace {
+
+inline void
+mixPlain(std::int16_t* to, const std::int16_t* from, size_t n, int volume)
+{
+    for (size_t i = 0; i < n; ++i) {
+        const int sample = to[i] + from[i] * volume / maxMixVolume;
+        to[i] = sample > 32767 ? 32767 : sample < -32768 ? -32768 : sample;
+    }
+}
+
+#if defined(__SSE2__)
+
+/// Scale 32-bit products down by maxMixVolume, rounding towards zero.
+inline __m128i
+scale(__m128i p)
+{
+    const __m128i bias = _mm_set1_epi32(maxMixVolume - 1);
+    p = _mm_add_epi32(p, _mm_and_si128(_mm_srai_epi32(p, 31), bias));
+    return _mm_srai_epi32(p, 7);
+}
+
+/// Mix 8 samples.
+inline void
+mix8(std::int16_t* to, const std::int16_t* from, __m128i volume)
+{
+    const __m128i in = _mm_loadu_si128(reinterpret_cast<const __m128i*>(from));
+    const __m128i lo = _mm_mullo_epi16(in, volume);
+    const __m128i hi = _mm_mulhi_epi16(in, volume);
+    const __m128i scaled = _mm_packs_epi32(scale(_mm_unpacklo_epi16(lo, hi)),
+            scale(_mm_unpackhi_epi16(lo, hi)));
+
+    __m128i* out = reinterpret_cast<__m128i*>(to);
+    _mm_storeu_si128(out, _mm_adds_epi16(_mm_loadu_si128(out), scaled));
+}
+
+#endif
+
+#if defined(__AVX2__)
+
+inline __m256i
+scale(__m256i p)
+{
+    const __m256i bias = _mm256_set1_epi32(maxMixVolume - 1);
+    p = _mm256_add_epi32(p, _mm256_and_si256(_mm256_srai_epi32(p, 31), bias));
+    return _mm256_srai_epi32(p, 7);
+}
+
+/// Mix 16 samples. Unpacking and packing both work within 128-bit
+/// lanes, so the samples keep their order.
+inline void
+mix16(std::int16_t* to, const std::int16_t* from, __m256i volume)
+{
+    const __m256i in =
+        _mm256_loadu_si256(reinterpret_cast<const __m256i*>(from));
+    const __m256i lo = _mm256_mullo_epi16(in, volume);
+    const __m256i hi = _mm256_mulhi_epi16(in, volume);
+    const __m256i scaled = _mm256_packs_epi32(
+            scale(_mm256_unpacklo_epi16(lo, hi)),
+            scale(_mm256_unpackhi_epi16(lo, hi)));
+
+    __m256i* out = reinterpret_cast<__m256i*>(to);
+    _mm256_storeu_si256(out, _mm256_adds_epi16(_mm256_loadu_si256(out),
+                scaled));
+}
+
+#endif
+
+#if defined(GNASH_MIX_NEON)
+
+inline int16x4_t
+scale(int32x4_t p)
+{
+    const int32x4_t bias = vdupq_n_s32(maxMixVolume - 1);
+    p = vaddq_s32(p, vandq_s32(vshrq_n_s32(p, 31), bias));
+    return vqmovn_s32(vshrq_n_s32(p, 7));
+}
+
+/// Mix 8 samples.
+inline void
+mix8(std::int16_t* to, const std::int16_t* from, std::int16_t volume)
+{
+    const int16x8_t in = vld1q_s16(from);
+    const int16x8_t scaled = vcombine_s16(
+            scale(vmull_n_s16(vget_low_s16(in), volume)),
+            scale(vmull_n_s16(vget_high_s16(in), volume)));
+    vst1q_s16(to, vqaddq_s16(vld1q_s16(to), scaled));
+}
+
+#endif
+
+} // anonymous namespace
+
+void
+mixSamples(std::int16_t* to, const std::int16_t* from, size_t nSamples,
+        int volume)
+{
+    assert(volume >= 0 && volume <= maxMixVolume);
+    if (!volume) return;
+
+    size_t i = 0;
+
+#if defined(__AVX2__)
+    const __m256i volume16 = _mm256_set1_epi16(volume);
+    for (; i + 16 <= nSamples; i += 16) {
+        mix16(to + i, from + i, volume16);
+    }
+#endif
+
+#if defined(__SSE2__)
+    const __m128i volume8 = _mm_set1_epi16(volume);
+    for (; i + 8 <= nSamples; i += 8) {
+        mix8(to + i, from + i, volume8);
+    }
+#elif defined(GNASH_MIX_NEON)
+    for (; i + 8 <= nSamples; i += 8) {
+        mix8(to + i, from + i, volume);
+    }
+#endif
+
+    mixPlain(to + i, from + i, nSamples - i, volume);
+}
+
+} // namespace sound
+} // namespace gnash
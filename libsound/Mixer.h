@@ -0,0 +1,53 @@
+// Mixer.h: mixing of 16-bit samples
+//
+//   Copyright (C) 2005, 2006, 2007, 2008, 2009, 2010, 2011, 2012
+//   Free Software Foundation, Inc
+//
+// This program is free software; you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation; either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program; if not, write to the Free Software
+// Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+
+#ifndef GNASH_SOUND_MIXER_H
+#define GNASH_SOUND_MIXER_H
+
+#include <cstdint>
+#include <cstddef>
+
+#include "dsodefs.h"
+
+namespace gnash {
+namespace sound {
+
+/// The volume at which mixSamples adds samples unchanged.
+const int maxMixVolume = 128;
+
+/// Mix 16-bit samples into others.
+//
+/// Each sample becomes the sum of itself and the matching input sample
+/// scaled by volume / maxMixVolume, clipped to the 16-bit range. Scaled
+/// samples are rounded towards zero.
+//
+/// This uses SSE2, AVX2 or NEON instructions when the build targets
+/// them, with the same results as the plain version.
+//
+/// @param to       The samples to mix into, in native byte order.
+/// @param from     The samples to add, in native byte order.
+/// @param nSamples The number of samples in both buffers.
+/// @param volume   The volume, from 0 to maxMixVolume.
+DSOEXPORT void mixSamples(std::int16_t* to, const std::int16_t* from,
+        size_t nSamples, int volume);
+
+} // namespace sound
+} // namespace gnash
+
+#endif
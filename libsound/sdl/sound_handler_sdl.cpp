@@ -282,17 +282,6 @@ SDL_sound_handler::sdl_audio_callback(void *udata, Uint8 *buf, int bufLenIn)
     handler->fetchSamples(samples, nSamples);
 }
 
-void
-SDL_sound_handler::mix(std::int16_t* outSamples, std::int16_t* inSamples,
-            unsigned int nSamples, float volume)
-{
-    Uint8* out = reinterpret_cast<Uint8*>(outSamples);
-    Uint8* in = reinterpret_cast<Uint8*>(inSamples);
-    unsigned int nBytes = nSamples*2;
-    
-    SDL_MixAudio(out, in, nBytes, SDL_MIX_MAXVOLUME*volume);
-}
-
 void
 SDL_sound_handler::plugInputStream(std::unique_ptr<InputStream> newStreamer)
 {
@@ -59,11 +59,6 @@ private:
     /// Mutex for making sure threads doesn't mess things up
     mutable std::mutex _mutex;
 
-    // See dox in sound_handler.h
-    void mix(std::int16_t* outSamples, std::int16_t* inSamples,
-                unsigned int nSamples, float volume);
-
-
     /// Callback invoked by the SDL audio thread.
     //
     /// This is basically a wrapper around fetchSamples
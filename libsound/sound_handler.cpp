@@ -22,6 +22,7 @@
 #include <cstdint> // For C99 int types
 #include <vector> 
 #include <cmath> 
+#include <algorithm>
 
 #include "EmbedSound.h" // for use
 #include "InputStream.h" // for use
@@ -29,6 +30,7 @@
 #include "log.h" // for use
 #include "StreamingSound.h"
 #include "StreamingSoundData.h"
+#include "Mixer.h"
 #include "SimpleBuffer.h"
 #include "MediaHandler.h"
 
@@ -73,74 +75,6 @@ ensurePadding(SimpleBuffer& data, media::MediaHandler* m)
     }
 }
 
-/* The volume ranges from 0 - 128 */
-#define MIX_MAXVOLUME 128
-#define ADJUST_VOLUME(s, v)	(s = (s*v)/MIX_MAXVOLUME)
-
-void 
-mixAudio(std::uint8_t *dst, const std::uint8_t *src, std::uint32_t len, int volume)
-{
-  if ( volume == 0 ) return;
-
-  union {
-    int16_t i;
-    char c[2];
-  } isbig;
-  isbig.i = 1;
-
-  int lsb = ( isbig.c[0] == 1 );
-
-  std::int16_t src1, src2;
-  int dst_sample;
-  const int max_audioval = ((1<<(16-1))-1);
-  const int min_audioval = -(1<<(16-1));
-
-  if ( lsb )
-  {
-    // AUDIO_S16LSB
-    len /= 2;
-    while ( len-- ) {
-      src1 = ((src[1])<<8|src[0]);
-      ADJUST_VOLUME(src1, volume);
-      src2 = ((dst[1])<<8|dst[0]);
-      src += 2;
-      dst_sample = src1+src2;
-      if ( dst_sample > max_audioval ) {
-        dst_sample = max_audioval;
-      } else
-      if ( dst_sample < min_audioval ) {
-        dst_sample = min_audioval;
-      }
-      dst[0] = dst_sample&0xFF;
-      dst_sample >>= 8;
-      dst[1] = dst_sample&0xFF;
-      dst += 2;
-    }
-  }
-  else
-  {
-    // AUDIO_S16MSB
-    len /= 2;
-    while ( len-- ) {
-      src1 = ((src[0])<<8|src[1]);
-      ADJUST_VOLUME(src1, volume);
-      src2 = ((dst[0])<<8|dst[1]);
-      src += 2;
-      dst_sample = src1+src2;
-      if ( dst_sample > max_audioval ) {
-        dst_sample = max_audioval;
-      } else
-      if ( dst_sample < min_audioval ) {
-        dst_sample = min_audioval;
-      }
-      dst[1] = dst_sample&0xFF;
-      dst_sample >>= 8;
-      dst[0] = dst_sample&0xFF;
-      dst += 2;
-    }
-  }
-}
-
 } // anonymous namespace
 
 sound_handler::StreamBlockId
@@ -654,8 +588,10 @@ sound_handler::fetchSamples(std::int16_t* to, unsigned int nSamples)
     // call NetStream or Sound audio callbacks
     if (!_inputStreams.empty()) {
 
-        // A buffer to fetch InputStream samples into
-        std::unique_ptr<std::int16_t[]> buf(new std::int16_t[nSamples]);
+        // A buffer to fetch InputStream samples into, kept for the
+        // next call.
+        if (_mixBuffer.size() < nSamples) _mixBuffer.resize(nSamples);
+        std::int16_t* buf = _mixBuffer.data();
 
 #ifdef GNASH_DEBUG_SAMPLES_FETCHING 
         log_debug("Fetching %d samples from each of %d input streams", nSamples, _inputStreams.size());
@@ -664,11 +600,9 @@ sound_handler::fetchSamples(std::int16_t* to, unsigned int nSamples)
         // Loop through the aux streamers sounds
         for (InputStream* is : _inputStreams)
         {
-            unsigned int wrote = is->fetchSamples(buf.get(), nSamples);
-            if (wrote < nSamples) {
-                // fill what wasn't written
-                std::fill(buf.get()+wrote, buf.get()+nSamples, 0);
-            }
+            // Samples that weren't written would be mixed as silence,
+            // which changes nothing.
+            unsigned int wrote = is->fetchSamples(buf, nSamples);
 
 #if GNASH_DEBUG_SAMPLES_FETCHING > 1
             log_debug("  fetched %d/%d samples from input stream %p"
@@ -676,7 +610,7 @@ sound_handler::fetchSamples(std::int16_t* to, unsigned int nSamples)
                     wrote, nSamples, is, is->samplesFetched());
 #endif
 
-            mix(to, buf.get(), nSamples, finalVolumeFact);
+            mix(to, buf, wrote, finalVolumeFact);
         }
 
         unplugCompletedInputStreams();
@@ -840,12 +774,9 @@ sound_handler::~sound_handler()
 void
 sound_handler::mix(std::int16_t* outSamples, std::int16_t* inSamples, unsigned int nSamples, float volume)
 {
-  unsigned int nBytes = nSamples*2;
-
-  std::uint8_t *out = reinterpret_cast<std::uint8_t*>(outSamples);
-  std::uint8_t* in = reinterpret_cast<std::uint8_t*>(inSamples);
-
-  mixAudio(out, in, nBytes, static_cast<int>(MIX_MAXVOLUME*volume));
+    const int vol = static_cast<int>(maxMixVolume * volume);
+    mixSamples(outSamples, inSamples, nSamples,
+            std::max(0, std::min(vol, maxMixVolume)));
 }
 
 } // gnash.sound namespace 
@@ -530,6 +530,9 @@ private:
     /// Elements owned by this class.
     InputStreams _inputStreams;
 
+    /// The buffer input streams are fetched into before mixing.
+    std::vector<std::int16_t> _mixBuffer;
+
     media::MediaHandler* _mediaHandler;
 
     /// Unplug any completed input stream
@@ -0,0 +1,107 @@
+//
+//   Copyright (C) 2005, 2006, 2007, 2008, 2009, 2010, 2011, 2012
+//   Free Software Foundation, Inc.
+//
+// This program is free software; you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation; either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program; if not, write to the Free Software
+// Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+
+#ifndef GNASH_DUMMYRENDERER_H
+#define GNASH_DUMMYRENDERER_H
+
+#include "Renderer.h" // for inheritance
+#include "CachedBitmap.h" // for inheritance
+#include "GnashImage.h" // for composition
+#include "Transform.h"
+
+#include <memory> // for unique_ptr
+#include <string>
+#include <vector>
+
+namespace gnash
+{
+
+/// A bitmap that only keeps its image, for use by unit tests
+class DummyBitmap : public CachedBitmap
+{
+public:
+
+    explicit DummyBitmap(std::unique_ptr<image::GnashImage> im)
+        :
+        _image(std::move(im))
+    {}
+
+    virtual image::GnashImage& image() { return *_image; }
+
+    virtual void dispose() { _image.reset(); }
+
+    virtual bool disposed() const { return !_image; }
+
+private:
+
+    std::unique_ptr<image::GnashImage> _image;
+};
+
+/// A renderer that keeps bitmaps and draws nothing, for use by unit tests
+class DummyRenderer : public Renderer
+{
+public:
+
+    virtual std::string description() const { return "dummy"; }
+
+    virtual CachedBitmap* createCachedBitmap(
+            std::unique_ptr<image::GnashImage> im) {
+        return new DummyBitmap(std::move(im));
+    }
+
+    virtual void drawVideoFrame(image::GnashImage*, const Transform&,
+            const SWFRect*, bool) {}
+
+    virtual void drawLine(const std::vector<point>&, const rgba&,
+            const SWFMatrix&) {}
+
+    virtual void draw_poly(const std::vector<point>&, const rgba&,
+            const rgba&, const SWFMatrix&, bool) {}
+
+    virtual void drawShape(const SWF::ShapeRecord&, const Transform&) {}
+
+    virtual void drawGlyph(const SWF::ShapeRecord&, const rgba&,
+            const SWFMatrix&) {}
+
+    virtual void begin_submit_mask(const SWFRect&) {}
+
+    virtual void end_submit_mask() {}
+
+    virtual void disable_mask() {}
+
+    virtual geometry::Range2d<int> world_to_pixel(const SWFRect&) const {
+        return geometry::Range2d<int>();
+    }
+
+    virtual point pixel_to_world(int, int) const { return point(); }
+
+    virtual void begin_display(const rgba&, int, int, float, float, float,
+            float) {}
+
+    virtual void end_display() {}
+
+    virtual Renderer* startInternalRender(image::GnashImage&) {
+        return nullptr;
+    }
+
+    virtual void endInternalRender() {}
+};
+
+} // namespace gnash
+
+#endif // GNASH_DUMMYRENDERER_H
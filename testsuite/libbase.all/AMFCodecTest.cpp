@@ -0,0 +1,358 @@
+//
+//   Copyright (C) 2005, 2006, 2007, 2008, 2009, 2010, 2011, 2012
+//   Free Software Foundation, Inc
+//
+// This program is free software; you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation; either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program; if not, write to the Free Software
+// Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+
+#ifdef HAVE_CONFIG_H
+#include "gnashconfig.h"
+#endif
+
+#include "AMFCodec.h"
+#include "AMF.h"
+#include "SimpleBuffer.h"
+#include "log.h"
+
+#include <iostream>
+#include <string>
+
+#include "check.h"
+
+using namespace gnash;
+using namespace gnash::amf;
+
+namespace {
+
+// Writes a connect() invoke, with every kind of value.
+void
+writeInvoke(Encoder& e)
+{
+    e.writeString("connect");
+    e.writeNumber(1);
+    const size_t obj = e.startObject();
+    e.writeKey("app");
+    e.writeString("live");
+    e.writeKey("tcUrl");
+    e.writeString("rtmp://localhost/live");
+    e.writeKey("fpad");
+    e.writeBoolean(false);
+    e.writeKey("audioCodecs");
+    e.writeInteger(3575);
+    e.writeKey("list");
+    e.startArray(3);
+    e.writeInteger(-5);
+    e.writeNull();
+    e.writeString("live");
+    e.end();
+    e.writeKey("map");
+    e.startECMAArray(1);
+    e.writeKey("a");
+    e.writeUndefined();
+    e.end();
+    e.writeKey("when");
+    e.writeDate(1e12);
+    e.end();
+    e.writeReference(obj);
+}
+
+// Reads it back.
+void
+checkInvoke(Decoder& d, Encoding enc)
+{
+    check_equals(d.next(), Decoder::STRING);
+    check(d.string() == "connect");
+    check_equals(d.next(), Decoder::NUMBER);
+    check_equals(d.number(), 1);
+
+    check_equals(d.next(), Decoder::OBJECT);
+    const size_t obj = d.index();
+    check_equals(d.depth(), 1);
+    check_equals(d.next(), Decoder::KEY);
+    check(d.string() == "app");
+    check_equals(d.next(), Decoder::STRING);
+    check(d.string() == "live");
+    check_equals(d.next(), Decoder::KEY);
+    check(d.string() == "tcUrl");
+    check_equals(d.next(), Decoder::STRING);
+    check_equals(d.string().toString(), "rtmp://localhost/live");
+    check_equals(d.next(), Decoder::KEY);
+    check_equals(d.next(), Decoder::BOOLEAN);
+    check_equals(d.boolean(), false);
+    check_equals(d.next(), Decoder::KEY);
+    check(d.string() == "audioCodecs");
+
+    // AMF0 has no integers.
+    if (enc == AMF3) {
+        check_equals(d.next(), Decoder::INTEGER);
+        check_equals(d.integer(), 3575);
+    }
+    else {
+        check_equals(d.next(), Decoder::NUMBER);
+        check_equals(d.number(), 3575);
+    }
+
+    check_equals(d.next(), Decoder::KEY);
+    check(d.string() == "list");
+    check_equals(d.next(), Decoder::ARRAY);
+    check_equals(d.count(), 3);
+    check_equals(d.depth(), 2);
+    if (enc == AMF3) {
+        check_equals(d.next(), Decoder::INTEGER);
+        check_equals(d.integer(), -5);
+    }
+    else {
+        check_equals(d.next(), Decoder::NUMBER);
+        check_equals(d.number(), -5);
+    }
+    check_equals(d.next(), Decoder::NULL_VALUE);
+    check_equals(d.next(), Decoder::STRING);
+    check(d.string() == "live");
+    check_equals(d.next(), Decoder::END);
+
+    check_equals(d.next(), Decoder::KEY);
+    check(d.string() == "map");
+    if (enc == AMF3) {
+        check_equals(d.next(), Decoder::ARRAY);
+        check_equals(d.count(), 0);
+    }
+    else {
+        check_equals(d.next(), Decoder::ECMA_ARRAY);
+        check_equals(d.count(), 1);
+    }
+    check_equals(d.next(), Decoder::KEY);
+    check(d.string() == "a");
+    check_equals(d.next(), Decoder::UNDEFINED);
+    check_equals(d.next(), Decoder::END);
+
+    check_equals(d.next(), Decoder::KEY);
+    check(d.string() == "when");
+    check_equals(d.next(), Decoder::DATE);
+    check_equals(d.number(), 1e12);
+    check_equals(d.next(), Decoder::END);
+    check_equals(d.depth(), 0);
+
+    check_equals(d.next(), Decoder::REFERENCE);
+    check_equals(d.index(), obj);
+    check_equals(d.next(), Decoder::NONE);
+    check(!d.error());
+}
+
+}
+
+TRYMAIN(_runtest);
+int
+trymain(int /*argc*/, char** /*argv*/)
+{
+    LogFile& lgf = LogFile::getDefaultInstance();
+    lgf.setVerbosity(0);
+
+    // AMF0 is written as the older functions write it.
+    {
+        SimpleBuffer expected;
+        write(expected, std::string("connect"));
+        write(expected, 1.5);
+        write(expected, true);
+
+        SimpleBuffer buf;
+        Encoder e(buf);
+        e.writeString("connect");
+        e.writeNumber(1.5);
+        e.writeBoolean(true);
+        check_equals(buf.size(), expected.size());
+        check(std::equal(buf.data(), buf.data() + buf.size(),
+                    expected.data()));
+    }
+
+    // AMF0
+    {
+        SimpleBuffer buf;
+        Encoder e(buf);
+        writeInvoke(e);
+        check_equals(e.depth(), 0);
+        Decoder d(buf.data(), buf.data() + buf.size());
+        checkInvoke(d, AMF0);
+
+        // The same decoder reads another message.
+        d.reset(buf.data(), buf.data() + buf.size());
+        checkInvoke(d, AMF0);
+    }
+
+    // AMF3
+    {
+        SimpleBuffer buf;
+        Encoder e(buf, AMF3);
+        writeInvoke(e);
+        Decoder d(buf.data(), buf.data() + buf.size(), AMF3);
+        checkInvoke(d, AMF3);
+    }
+
+    // AMF3 inside AMF0.
+    {
+        SimpleBuffer buf;
+        Encoder e0(buf);
+        e0.writeString("onMetaData");
+        buf.appendByte(AVMPLUS_OBJECT_AMF0);
+        Encoder e3(buf, AMF3);
+        e3.startObject();
+        e3.writeKey("duration");
+        e3.writeNumber(2.5);
+        e3.end();
+        e0.writeNull();
+
+        Decoder d(buf.data(), buf.data() + buf.size());
+        check_equals(d.next(), Decoder::STRING);
+        check_equals(d.next(), Decoder::OBJECT);
+        check_equals(d.next(), Decoder::KEY);
+        check(d.string() == "duration");
+        check_equals(d.next(), Decoder::NUMBER);
+        check_equals(d.number(), 2.5);
+        check_equals(d.next(), Decoder::END);
+        check_equals(d.next(), Decoder::NULL_VALUE);
+        check_equals(d.next(), Decoder::NONE);
+        check(!d.error());
+    }
+
+    // AMF3 strings and classes are written once.
+    {
+        SimpleBuffer buf;
+        Encoder e(buf, AMF3);
+        for (int i = 0; i < 100; ++i) {
+            e.startObject("flash.geom.Point", 16);
+            e.writeKey("x");
+            e.writeInteger(i);
+            e.writeKey("name");
+            e.writeString("a point");
+            e.end();
+        }
+        check(buf.size() < 100 * 16);
+
+        Decoder d(buf.data(), buf.data() + buf.size(), AMF3);
+        bool ok = true;
+        for (int i = 0; i < 100; ++i) {
+            ok = ok && d.next() == Decoder::OBJECT;
+            ok = ok && d.className() == "flash.geom.Point";
+            ok = ok && d.index() == static_cast<size_t>(i);
+            ok = ok && d.next() == Decoder::KEY && d.string() == "x";
+            ok = ok && d.next() == Decoder::INTEGER && d.integer() == i;
+            ok = ok && d.next() == Decoder::KEY && d.string() == "name";
+            ok = ok && d.next() == Decoder::STRING && d.string() == "a point";
+            ok = ok && d.next() == Decoder::END;
+        }
+        check(ok);
+        check_equals(d.next(), Decoder::NONE);
+        check(!d.error());
+    }
+
+    // AMF3 integers use as few bytes as they can, and large ones are
+    // numbers.
+    {
+        const std::int32_t ints[] = { 0, 0x7f, 0x80, 0x3fff, 0x4000,
+            0x1fffff, 0x200000, 0x0fffffff, -1, -0x10000000 };
+        const size_t sizes[] = { 2, 2, 3, 3, 4, 4, 5, 5, 5, 5 };
+        for (size_t i = 0; i < sizeof(ints) / sizeof(ints[0]); ++i) {
+            SimpleBuffer buf;
+            Encoder e(buf, AMF3);
+            e.writeInteger(ints[i]);
+            check_equals(buf.size(), sizes[i]);
+            Decoder d(buf.data(), buf.data() + buf.size(), AMF3);
+            check_equals(d.next(), Decoder::INTEGER);
+            check_equals(d.integer(), ints[i]);
+        }
+
+        SimpleBuffer buf;
+        Encoder e(buf, AMF3);
+        e.writeInteger(0x10000000);
+        Decoder d(buf.data(), buf.data() + buf.size(), AMF3);
+        check_equals(d.next(), Decoder::NUMBER);
+        check_equals(d.number(), 0x10000000);
+    }
+
+    // AMF3 arrays with named and dense members.
+    {
+        SimpleBuffer buf;
+        Encoder e(buf, AMF3);
+        e.startArray(2);
+        e.writeKey("name");
+        e.writeString("value");
+        e.writeInteger(1);
+        e.writeInteger(2);
+        e.end();
+        e.startArray(0);
+        e.end();
+
+        Decoder d(buf.data(), buf.data() + buf.size(), AMF3);
+        check_equals(d.next(), Decoder::ARRAY);
+        check_equals(d.count(), 2);
+        check_equals(d.next(), Decoder::KEY);
+        check(d.string() == "name");
+        check_equals(d.next(), Decoder::STRING);
+        check_equals(d.next(), Decoder::INTEGER);
+        check_equals(d.next(), Decoder::INTEGER);
+        check_equals(d.integer(), 2);
+        check_equals(d.next(), Decoder::END);
+        check_equals(d.next(), Decoder::ARRAY);
+        check_equals(d.count(), 0);
+        check_equals(d.next(), Decoder::END);
+        check_equals(d.next(), Decoder::NONE);
+    }
+
+    // Skipping objects.
+    {
+        SimpleBuffer buf;
+        Encoder e(buf);
+        writeInvoke(e);
+        Decoder d(buf.data(), buf.data() + buf.size());
+        check_equals(d.next(), Decoder::STRING);
+        check_equals(d.next(), Decoder::NUMBER);
+        const Decoder::Event ev = d.next();
+        check(d.skip(ev));
+        check_equals(d.depth(), 0);
+        check_equals(d.next(), Decoder::REFERENCE);
+    }
+
+    // Malformed AMF.
+    {
+        SimpleBuffer buf;
+        Encoder e(buf);
+        writeInvoke(e);
+
+        // Every truncation inside the object is noticed, without
+        // reading past the end. Only a missing OBJECT_END_AMF0 at
+        // the very end is forgiven.
+        bool ok = true;
+        for (size_t len = 20; len < buf.size() - 4; ++len) {
+            Decoder d(buf.data(), buf.data() + len);
+            while (d.next() != Decoder::NONE) {}
+            if (!d.error()) {
+                ok = false;
+                std::cerr << "Truncation at " << len << " not noticed"
+                          << std::endl;
+            }
+        }
+        check(ok);
+
+        const std::uint8_t badref[] = { REFERENCE_AMF0, 0, 1 };
+        Decoder d(badref, badref + sizeof(badref));
+        check_equals(d.next(), Decoder::NONE);
+        check(d.error());
+
+        const std::uint8_t badstring3[] = { STRING_AMF3, 0 };
+        Decoder d3(badstring3, badstring3 + sizeof(badstring3), AMF3);
+        check_equals(d3.next(), Decoder::NONE);
+        check(d3.error());
+    }
+
+    return 0;
+}
@@ -0,0 +1,222 @@
+//
+//   Copyright (C) 2005, 2006, 2007, 2008, 2009, 2010, 2011, 2012
+//   Free Software Foundation, Inc
+//
+// This program is free software; you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation; either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program; if not, write to the Free Software
+// Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+
+#ifdef HAVE_CONFIG_H
+#include "gnashconfig.h"
+#endif
+
+#include "check.h"
+#include "GC.h"
+
+#include <cstdlib>
+#include <set>
+#include <vector>
+
+using namespace gnash;
+
+namespace {
+
+size_t liveResources = 0;
+
+class Resource : public GcResource
+{
+public:
+    Resource(GC& gc) : GcResource(gc) { ++liveResources; }
+    ~Resource() { --liveResources; }
+};
+
+/// A resource referencing others
+class Node : public Resource
+{
+public:
+    Node(GC& gc, bool barrier)
+        :
+        Resource(gc),
+        barrier(barrier)
+    {
+        live.insert(this);
+    }
+
+    ~Node() { live.erase(this); }
+
+    static bool alive(const Node* n) { return live.count(n); }
+
+    std::vector<const Node*> refs;
+
+    bool barrier;
+
+protected:
+
+    void markReachableResources() const {
+        for (const Node* n : refs) n->setReachable();
+    }
+
+    bool hasWriteBarrier() const { return barrier; }
+
+private:
+
+    static std::set<const Node*> live;
+};
+
+std::set<const Node*> Node::live;
+
+class Root : public GcRoot
+{
+public:
+    virtual void markReachableResources() const {
+        for (const Resource* r : held) r->setReachable();
+    }
+    std::vector<const Resource*> held;
+};
+
+}
+
+int
+main(int /*argc*/, char** /*argv*/)
+{
+    // Keep every call to fuzzyCollect() as short as possible and run
+    // a cycle every time.
+    setenv("GNASH_GC_BUDGET", "1", 1);
+    setenv("GNASH_GC_TRIGGER_THRESHOLD", "0", 1);
+
+    Root root;
+    GC gc(root);
+
+    // A complete cycle keeps reachable resources only.
+    for (size_t i = 0; i < 1000; ++i) {
+        Resource* r = new Resource(gc);
+        if (i % 10 == 0) root.held.push_back(r);
+    }
+    check_equals(liveResources, 1000);
+
+    gc.runCycle();
+    check_equals(liveResources, 100);
+    check_equals(gc.markPauses().count, 1);
+
+    // Drop everything and sweep bit by bit, registering new resources
+    // in between. These are never marked, but mustn't be swept.
+    root.held.clear();
+    for (size_t i = 0; i < 10000; ++i) new Resource(gc);
+
+    Resource* late = nullptr;
+    for (size_t i = 0; i < 100000 && liveResources > 1; ++i) {
+        gc.fuzzyCollect();
+        if (!late) {
+            late = new Resource(gc);
+            root.held.push_back(late);
+        }
+    }
+    check_equals(liveResources, 1);
+
+    GC::CollectablesCount count;
+    gc.countCollectables(count);
+    check_equals(count.size(), 1);
+
+    // All sweeps have been recorded.
+    const GC::PauseHistogram& sweeps = gc.sweepPauses();
+    std::uint32_t total = 0;
+    for (std::uint32_t b : sweeps.buckets) total += b;
+    check_equals(total, sweeps.count);
+    check(sweeps.max <= sweeps.total);
+
+    // Marking a long list takes many calls, between which references
+    // change. The list is queued last, so the nodes held by the root
+    // are scanned first.
+    root.held.clear();
+    gc.runCycle();
+
+    Node* head = new Node(gc, true);
+    Node* tail = head;
+    for (size_t i = 0; i < 10000; ++i) {
+        Node* n = new Node(gc, true);
+        tail->refs.push_back(n);
+        tail = n;
+    }
+
+    Node* withBarrier = new Node(gc, true);
+    Node* withoutBarrier = new Node(gc, false);
+    Node* changing = new Node(gc, true);
+    root.held.push_back(head);
+    root.held.push_back(withBarrier);
+    root.held.push_back(withoutBarrier);
+    root.held.push_back(changing);
+
+    // Only referenced by the end of the list until it is reached.
+    Node* moved = new Node(gc, true);
+    Node* movedOut = new Node(gc, true);
+    Node* movedLater = new Node(gc, true);
+    Node* dropped = new Node(gc, true);
+    Node* garbage = new Node(gc, true);
+    tail->refs.push_back(moved);
+    tail->refs.push_back(movedOut);
+    tail->refs.push_back(movedLater);
+    tail->refs.push_back(dropped);
+
+    const std::uint32_t marks = gc.markPauses().count;
+    gc.fuzzyCollect();
+    check(gc.marking());
+
+    // Stored with a barrier.
+    gc.writeBarrier(*moved);
+    withBarrier->refs.push_back(moved);
+
+    // Stored without a barrier, in a node scanned again at the end.
+    withoutBarrier->refs.push_back(movedOut);
+
+    // Stored in a node that has just lost its barrier.
+    changing->barrier = false;
+    gc.rescan(*changing);
+    gc.fuzzyCollect();
+    changing->refs.push_back(movedLater);
+
+    // Registered while marking, and stored with a barrier.
+    Node* created = new Node(gc, true);
+    gc.writeBarrier(*created);
+    withBarrier->refs.push_back(created);
+    created->refs.push_back(dropped);
+
+    tail->refs.clear();
+
+    for (size_t i = 0; i < 100000 && gc.marking(); ++i) gc.fuzzyCollect();
+    check(!gc.marking());
+    check(gc.markPauses().count > marks + 2);
+
+    for (size_t i = 0; i < 100000 && Node::alive(garbage); ++i) {
+        gc.fuzzyCollect();
+    }
+    check(!Node::alive(garbage));
+    check(Node::alive(tail));
+    check(Node::alive(moved));
+    check(Node::alive(movedOut));
+    check(Node::alive(movedLater));
+    check(Node::alive(created));
+    check(Node::alive(dropped));
+
+    // Nothing stays marked for the next cycle, so what the node
+    // registered while marking references is still found.
+    gc.runCycle();
+    check(Node::alive(dropped));
+
+    created->refs.clear();
+    gc.runCycle();
+    check(!Node::alive(dropped));
+    check(Node::alive(created));
+
+    return 0;
+}
+
@@ -0,0 +1,252 @@
+// InflaterBench.cpp: timing of reading FWS, CWS and ZWS movie bodies.
+//
+//   Copyright (C) 2005, 2006, 2007, 2008, 2009, 2010, 2011, 2012
+//   Free Software Foundation, Inc
+//
+// This program is free software; you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation; either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program; if not, write to the Free Software
+// Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+
+// This is not a test: it measures how fast movie bodies read when
+// stored, zlib and LZMA compressed, reading straight through and
+// seeking back as the parser does. Build it with "make InflaterBench".
+
+#ifdef HAVE_CONFIG_H
+#include "gnashconfig.h"
+#endif
+
+#include "IOChannel.h"
+#include "zlib_adapter.h"
+#include "lzma_adapter.h"
+#include "rc.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <memory>
+#include <random>
+#include <vector>
+#include <zlib.h>
+#ifdef HAVE_LZMA_H
+#include <lzma.h>
+#endif
+
+using namespace gnash;
+
+namespace {
+
+typedef std::chrono::steady_clock Clock;
+
+double
+msSince(Clock::time_point start)
+{
+    return std::chrono::duration<double, std::milli>(Clock::now() - start)
+        .count();
+}
+
+/// Reads bytes held in memory.
+class MemoryChannel : public IOChannel
+{
+public:
+    explicit MemoryChannel(const std::vector<std::uint8_t>& data)
+        :
+        _data(data),
+        _pos(0)
+    {}
+
+    std::streamsize read(void* dst, std::streamsize bytes) {
+        bytes = std::min<std::streamsize>(bytes, _data.size() - _pos);
+        std::memcpy(dst, &_data[_pos], bytes);
+        _pos += bytes;
+        return bytes;
+    }
+    std::streampos tell() const { return _pos; }
+    bool seek(std::streampos pos) {
+        if (pos > static_cast<std::streampos>(_data.size())) return false;
+        _pos = pos;
+        return true;
+    }
+    void go_to_end() { _pos = _data.size(); }
+    bool eof() const { return _pos == _data.size(); }
+    bool bad() const { return false; }
+
+private:
+    const std::vector<std::uint8_t>& _data;
+    size_t _pos;
+};
+
+/// Something like tag data: runs of repeated records, and some noise.
+std::vector<std::uint8_t>
+body(size_t size)
+{
+    std::vector<std::uint8_t> data(size);
+    std::mt19937 rng(42);
+    for (size_t i = 0; i < size; ++i) {
+        data[i] = rng() % 8 ? (i * 31 + (i >> 12)) & 0xff : rng() & 0xff;
+    }
+    return data;
+}
+
+std::vector<std::uint8_t>
+header(char kind, size_t size)
+{
+    std::vector<std::uint8_t> out;
+    out.push_back(kind);
+    out.push_back('W');
+    out.push_back('S');
+    out.push_back(10);
+    for (size_t i = 0; i < 4; ++i) out.push_back((size + 8) >> (8 * i));
+    return out;
+}
+
+std::vector<std::uint8_t>
+cws(const std::vector<std::uint8_t>& data)
+{
+    std::vector<std::uint8_t> out = header('C', data.size());
+    uLongf size = compressBound(data.size());
+    out.resize(8 + size);
+    compress2(&out[8], &size, &data[0], data.size(), 9);
+    out.resize(8 + size);
+    return out;
+}
+
+#ifdef HAVE_LZMA_H
+std::vector<std::uint8_t>
+zws(const std::vector<std::uint8_t>& data)
+{
+    lzma_options_lzma options;
+    lzma_lzma_preset(&options, 6);
+    lzma_stream s = LZMA_STREAM_INIT;
+    if (lzma_alone_encoder(&s, &options) != LZMA_OK) std::abort();
+
+    std::vector<std::uint8_t> alone(data.size() + data.size() / 2 + 1024);
+    s.next_in = &data[0];
+    s.avail_in = data.size();
+    s.next_out = &alone[0];
+    s.avail_out = alone.size();
+    while (lzma_code(&s, LZMA_FINISH) == LZMA_OK) {}
+    alone.resize(s.total_out);
+    lzma_end(&s);
+
+    std::vector<std::uint8_t> out = header('Z', data.size());
+    const size_t length = alone.size() - 13;
+    for (size_t i = 0; i < 4; ++i) out.push_back(length >> (8 * i));
+    out.insert(out.end(), alone.begin(), alone.begin() + 5);
+    out.insert(out.end(), alone.begin() + 13, alone.end());
+    return out;
+}
+#endif
+
+std::unique_ptr<IOChannel>
+open(const std::vector<std::uint8_t>& file, size_t size)
+{
+    std::unique_ptr<IOChannel> in(new MemoryChannel(file));
+    in->seek(8);
+    switch (file[0]) {
+        case 'C':
+            return zlib_adapter::make_inflater(std::move(in));
+#ifdef HAVE_LZMA_H
+        case 'Z':
+            return lzma_adapter::make_inflater(std::move(in), size);
+#endif
+        default:
+            return in;
+    }
+}
+
+void
+run(const char* name, const std::vector<std::uint8_t>& file, size_t size)
+{
+    std::vector<std::uint8_t> buf(4096);
+    size_t sum = 0;
+
+    // Straight through, in pieces like tag bodies.
+    Clock::time_point start = Clock::now();
+    {
+        std::unique_ptr<IOChannel> in = open(file, size);
+        while (std::streamsize got = in->read(&buf[0], buf.size())) {
+            sum += buf[got - 1];
+        }
+    }
+    const double straight = msSince(start);
+
+    // Going back a little now and then, as when the parser skips back
+    // over a tag it peeked at.
+    start = Clock::now();
+    {
+        std::unique_ptr<IOChannel> in = open(file, size);
+        for (size_t reads = 1; in->read(&buf[0], buf.size()); ++reads) {
+            // Back 32KB every 256KB, so 1/8 is read twice.
+            if (reads % 64 == 0) in->seek(in->tell() - std::streamoff(32768));
+            sum += buf[0];
+        }
+    }
+    const double peeks = msSince(start);
+
+    // Jumping back far, as when a movie is reloaded from a point.
+    start = Clock::now();
+    {
+        std::unique_ptr<IOChannel> in = open(file, size);
+        std::mt19937 rng(7);
+        for (size_t i = 0; i < 8; ++i) {
+            in->seek(8 + size / 2 + rng() % (size / 2));
+            in->read(&buf[0], buf.size());
+            in->seek(8 + rng() % (size / 2));
+            in->read(&buf[0], buf.size());
+            sum += buf[0];
+        }
+    }
+    const double jumps = msSince(start);
+
+    const double mb = size / (1024.0 * 1024.0);
+    std::cout << name << " (" << file.size() / 1024 << " KB): straight "
+              << mb * 1000 / straight << " MB/s, with short seeks back "
+              << mb * 1000 / peeks << " MB/s, 8 pairs of jumps "
+              << jumps << " ms (" << sum % 10 << ")" << std::endl;
+}
+
+} // anonymous namespace
+
+int
+main(int argc, char** argv)
+{
+    const size_t mb = argc > 1 ? std::strtoul(argv[1], nullptr, 10) : 32;
+    const std::vector<std::uint8_t> data = body(mb * 1024 * 1024);
+
+    const std::vector<std::uint8_t> fws = header('F', data.size());
+    std::vector<std::uint8_t> stored(fws);
+    stored.insert(stored.end(), data.begin(), data.end());
+    const std::vector<std::uint8_t> zipped = cws(data);
+#ifdef HAVE_LZMA_H
+    const std::vector<std::uint8_t> lzma = zws(data);
+#endif
+
+    RcInitFile& rc = RcInitFile::getDefaultInstance();
+    std::cout << mb << " MB movie body, inflateWindow "
+              << rc.inflateWindow() << " KB" << std::endl;
+
+    run("FWS", stored, data.size());
+    run("CWS", zipped, data.size());
+#ifdef HAVE_LZMA_H
+    run("ZWS", lzma, data.size());
+#endif
+
+    // Keeping a single chunk makes short seeks back restart zlib from
+    // a checkpoint.
+    rc.inflateWindow(16);
+    std::cout << "inflateWindow 16 KB" << std::endl;
+    run("CWS", zipped, data.size());
+    return 0;
+}
@@ -0,0 +1,353 @@
+//
+//   Copyright (C) 2005, 2006, 2007, 2008, 2009, 2010, 2011, 2012
+//   Free Software Foundation, Inc
+//
+// This program is free software; you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation; either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program; if not, write to the Free Software
+// Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+
+#ifdef HAVE_CONFIG_H
+#include "gnashconfig.h"
+#endif
+
+#include "check.h"
+#include "GnashException.h"
+#include "Inflater.h"
+#include "IOChannel.h"
+#include "zlib_adapter.h"
+#include "lzma_adapter.h"
+
+#include <algorithm>
+#include <cstdlib>
+#include <cstring>
+#include <memory>
+#include <vector>
+#include <zlib.h>
+#ifdef HAVE_LZMA_H
+#include <lzma.h>
+#endif
+
+using namespace gnash;
+
+namespace {
+
+std::uint8_t
+byteAt(size_t i)
+{
+    return (i * 31 + (i >> 16)) & 0xff;
+}
+
+std::vector<std::uint8_t>
+payload(size_t size)
+{
+    std::vector<std::uint8_t> data(size);
+    std::uint32_t seed = 1;
+    for (size_t i = 0; i < size; ++i) {
+        seed = seed * 1103515245 + 12345;
+        // Compressible, but not too much.
+        data[i] = (seed >> 16) % 4 ? byteAt(i) : seed >> 24;
+    }
+    return data;
+}
+
+/// Reads bytes held in memory.
+class MemoryChannel : public IOChannel
+{
+public:
+    explicit MemoryChannel(std::vector<std::uint8_t> data)
+        :
+        _data(std::move(data)),
+        _pos(0)
+    {}
+
+    std::streamsize read(void* dst, std::streamsize bytes) {
+        bytes = std::min<std::streamsize>(bytes, _data.size() - _pos);
+        std::memcpy(dst, &_data[_pos], bytes);
+        _pos += bytes;
+        return bytes;
+    }
+    std::streampos tell() const { return _pos; }
+    bool seek(std::streampos pos) {
+        if (pos > static_cast<std::streampos>(_data.size())) return false;
+        _pos = pos;
+        return true;
+    }
+    void go_to_end() { _pos = _data.size(); }
+    bool eof() const { return _pos == _data.size(); }
+    bool bad() const { return false; }
+
+private:
+    std::vector<std::uint8_t> _data;
+    size_t _pos;
+};
+
+struct SequenceCheckpoint : public Inflater::Checkpoint
+{
+    explicit SequenceCheckpoint(size_t p) : pos(p) {}
+    size_t pos;
+};
+
+/// Makes byteAt() bytes, a little at a time, and records restarts.
+class SequenceCodec : public Inflater::Codec
+{
+public:
+    SequenceCodec(size_t size, bool checkpoints, size_t failAt = -1)
+        :
+        restarts(0),
+        restartedFrom(0),
+        _size(size),
+        _checkpoints(checkpoints),
+        _failAt(failAt),
+        _pos(0)
+    {}
+
+    size_t decompress(std::uint8_t* dst, size_t size) {
+        if (_pos == _failAt) throw ParserException("corrupt data");
+        const size_t n = std::min(std::min<size_t>(size, 1000),
+                std::min(_size, _failAt) - _pos);
+        for (size_t i = 0; i < n; ++i) dst[i] = byteAt(_pos + i);
+        _pos += n;
+        return n;
+    }
+
+    std::unique_ptr<Inflater::Checkpoint> checkpoint() {
+        if (!_checkpoints) return std::unique_ptr<Inflater::Checkpoint>();
+        return std::unique_ptr<Inflater::Checkpoint>(
+                new SequenceCheckpoint(_pos));
+    }
+
+    void restart(const Inflater::Checkpoint* from) {
+        _pos = from ? static_cast<const SequenceCheckpoint*>(from)->pos : 0;
+        ++restarts;
+        restartedFrom = _pos;
+    }
+
+    // Only changed by the reading thread.
+    int restarts;
+    size_t restartedFrom;
+
+private:
+    const size_t _size;
+    const bool _checkpoints;
+    const size_t _failAt;
+    size_t _pos;
+};
+
+/// Whether the next bytes read are those of a payload from a position.
+bool
+readsFrom(IOChannel& in, const std::vector<std::uint8_t>& data,
+        size_t pos, size_t bytes)
+{
+    std::vector<std::uint8_t> buf(bytes);
+    if (in.read(&buf[0], bytes) != static_cast<std::streamsize>(bytes)) {
+        return false;
+    }
+    return std::equal(buf.begin(), buf.end(), data.begin() + pos);
+}
+
+/// Whether the whole payload reads back in odd sized pieces.
+bool
+readsAll(IOChannel& in, const std::vector<std::uint8_t>& data)
+{
+    size_t pos = 0;
+    while (pos < data.size()) {
+        const size_t n = std::min<size_t>(7777, data.size() - pos);
+        if (!readsFrom(in, data, pos, n)) return false;
+        pos += n;
+    }
+    std::uint8_t b;
+    return !in.read(&b, 1) && in.eof();
+}
+
+/// A CWS movie, positioned after its header.
+std::unique_ptr<IOChannel>
+zlibMovie(const std::vector<std::uint8_t>& data)
+{
+    uLongf size = compressBound(data.size());
+    std::vector<std::uint8_t> out(8 + size);
+    compress2(&out[8], &size, &data[0], data.size(), 9);
+    out.resize(8 + size);
+    std::unique_ptr<IOChannel> in(new MemoryChannel(out));
+    in->seek(8);
+    return in;
+}
+
+#ifdef HAVE_LZMA_H
+/// A ZWS movie, positioned after its header.
+std::unique_ptr<IOChannel>
+lzmaMovie(const std::vector<std::uint8_t>& data)
+{
+    lzma_options_lzma options;
+    lzma_lzma_preset(&options, 6);
+    lzma_stream s = LZMA_STREAM_INIT;
+    if (lzma_alone_encoder(&s, &options) != LZMA_OK) std::abort();
+
+    std::vector<std::uint8_t> alone(data.size() + data.size() / 2 + 1024);
+    s.next_in = &data[0];
+    s.avail_in = data.size();
+    s.next_out = &alone[0];
+    s.avail_out = alone.size();
+    while (lzma_code(&s, LZMA_FINISH) == LZMA_OK) {}
+    alone.resize(s.total_out);
+    lzma_end(&s);
+
+    // The SWF header, the compressed length and the properties, then
+    // the data after the 13 byte .lzma header.
+    std::vector<std::uint8_t> out(8);
+    const size_t length = alone.size() - 13;
+    for (size_t i = 0; i < 4; ++i) out.push_back(length >> (8 * i));
+    out.insert(out.end(), alone.begin(), alone.begin() + 5);
+    out.insert(out.end(), alone.begin() + 13, alone.end());
+
+    std::unique_ptr<IOChannel> in(new MemoryChannel(out));
+    in->seek(8);
+    return in;
+}
+#endif
+
+} // anonymous namespace
+
+int
+main(int /*argc*/, char** /*argv*/)
+{
+    const size_t size = 3 * Inflater::checkpointInterval + 123;
+    std::vector<std::uint8_t> sequence(size);
+    for (size_t i = 0; i < size; ++i) sequence[i] = byteAt(i);
+
+    {
+        SequenceCodec* codec = new SequenceCodec(size, true);
+        Inflater in(std::unique_ptr<Inflater::Codec>(codec), 8,
+                128 * 1024);
+        check_equals(in.tell(), 8);
+        check(readsAll(in, sequence));
+        check_equals(in.tell(), 8 + size);
+
+        // The last window read is kept.
+        check(in.seek(8 + size - 100000));
+        check(readsFrom(in, sequence, size - 100000, 1000));
+        check_equals(codec->restarts, 0);
+
+        // Further back restarts from the checkpoint before.
+        check(in.seek(8 + 3 * Inflater::checkpointInterval / 2));
+        check_equals(codec->restarts, 1);
+        check_equals(codec->restartedFrom, Inflater::checkpointInterval);
+        check(readsFrom(in, sequence, 3 * Inflater::checkpointInterval / 2,
+                    200000));
+
+        // Or from the beginning.
+        check(in.seek(8 + 100));
+        check_equals(codec->restarts, 2);
+        check_equals(codec->restartedFrom, 0);
+        check(readsFrom(in, sequence, 100, 100));
+
+        // Forward within the data.
+        check(in.seek(8 + 2 * Inflater::checkpointInterval + 5));
+        check(readsFrom(in, sequence, 2 * Inflater::checkpointInterval + 5,
+                    10));
+        check_equals(codec->restarts, 2);
+
+        check(!in.seek(8 + size + 1));
+        check(!in.seek(7));
+        in.go_to_end();
+        check_equals(in.tell(), 8 + size);
+        check(in.eof());
+    }
+
+    {
+        // Without checkpoints, going back restarts from the beginning.
+        SequenceCodec* codec = new SequenceCodec(size, false);
+        Inflater in(std::unique_ptr<Inflater::Codec>(codec), 0,
+                128 * 1024);
+        check(in.seek(size - 10));
+        check(in.seek(size - 2 * Inflater::checkpointInterval));
+        check_equals(codec->restarts, 1);
+        check_equals(codec->restartedFrom, 0);
+        check(readsFrom(in, sequence, size - 2 * Inflater::checkpointInterval,
+                    1000));
+    }
+
+    {
+        // Errors reach the reader once it gets to them.
+        Inflater in(std::unique_ptr<Inflater::Codec>(
+                    new SequenceCodec(size, true, 200000)), 0, 64 * 1024);
+        check(readsFrom(in, sequence, 0, 150000));
+        check(!in.bad());
+        bool thrown = false;
+        try {
+            std::vector<std::uint8_t> buf(100000);
+            in.read(&buf[0], buf.size());
+        }
+        catch (const ParserException&) {
+            thrown = true;
+        }
+        check(thrown);
+        check(in.bad());
+        check_equals(in.tell(), 200000);
+
+        // Data before the error can still be read.
+        check(in.seek(190000));
+        check(readsFrom(in, sequence, 190000, 10000));
+    }
+
+    const std::vector<std::uint8_t> data = payload(size);
+
+    {
+        std::unique_ptr<IOChannel> in =
+            zlib_adapter::make_inflater(zlibMovie(data));
+        check_equals(in->tell(), 8);
+        check(readsAll(*in, data));
+
+        // Back to a checkpoint, and to the beginning.
+        check(in->seek(8 + 2 * Inflater::checkpointInterval + 1000));
+        check(readsFrom(*in, data, 2 * Inflater::checkpointInterval + 1000,
+                    100000));
+        check(in->seek(8));
+        check(readsAll(*in, data));
+    }
+
+    {
+        // A zlib header followed by garbage.
+        bool thrown = false;
+        std::vector<std::uint8_t> corrupt(8);
+        corrupt.push_back(0x78);
+        corrupt.push_back(0xda);
+        corrupt.insert(corrupt.end(), 1000, 0xff);
+        std::unique_ptr<IOChannel> bad(new MemoryChannel(corrupt));
+        bad->seek(8);
+        std::unique_ptr<IOChannel> in =
+            zlib_adapter::make_inflater(std::move(bad));
+        try {
+            std::uint8_t b;
+            in->read(&b, 1);
+        }
+        catch (const ParserException&) {
+            thrown = true;
+        }
+        check(thrown);
+    }
+
+#ifdef HAVE_LZMA_H
+    {
+        std::unique_ptr<IOChannel> in =
+            lzma_adapter::make_inflater(lzmaMovie(data), data.size());
+        check_equals(in->tell(), 8);
+        check(readsAll(*in, data));
+
+        // No checkpoints, so this starts over.
+        check(in->seek(8 + Inflater::checkpointInterval));
+        check(readsFrom(*in, data, Inflater::checkpointInterval, 100000));
+    }
+#endif
+
+    return 0;
+}
@@ -75,7 +75,33 @@ trymain (int /*argc*/, char** /*argv*/) {
     } else {
         runtest.fail ("rc.qualityLevel() != -1");
     }
-    
+
+    // Frames are drawn by a single thread by default
+    if (rc.renderThreads() == 1) {
+        runtest.pass ("rc.renderThreads() == 1");
+    } else {
+        runtest.fail ("rc.renderThreads() != 1");
+    }
+
+    // Bitmaps are decoded by one thread per processor by default
+    if (rc.decodeThreads() == 0) {
+        runtest.pass ("rc.decodeThreads() == 0");
+    } else {
+        runtest.fail ("rc.decodeThreads() != 0");
+    }
+
+    if (rc.bitmapCacheSize() == 131072) {
+        runtest.pass ("rc.bitmapCacheSize() == 131072");
+    } else {
+        runtest.fail ("rc.bitmapCacheSize() != 131072");
+    }
+
+    if (rc.inflateWindow() == 1024) {
+        runtest.pass ("rc.inflateWindow() == 1024");
+    } else {
+        runtest.fail ("rc.inflateWindow() != 1024");
+    }
+
     // Parse the test config file
     if (rc.parseFile("gnashrc")) {
         runtest.pass ("rc.parseFile()");
@@ -312,6 +338,48 @@ trymain (int /*argc*/, char** /*argv*/) {
         runtest.fail ("getScriptsRecursionLimit doesn't gives 256");
     }
 
+    if ( ! rc.preDecodeActions() ) {
+        runtest.pass ("preDecodeActions gives false");
+    } else {
+        runtest.fail ("preDecodeActions doesn't give false");
+    }
+
+    if (rc.renderThreads() == 4) {
+        runtest.pass ("renderThreads gives 4");
+    } else {
+        runtest.fail ("renderThreads doesn't give 4");
+    }
+
+    if (rc.pathCacheSize() == 0) {
+        runtest.pass ("pathCacheSize gives 0");
+    } else {
+        runtest.fail ("pathCacheSize doesn't give 0");
+    }
+
+    if (rc.resampleQuality() == 2) {
+        runtest.pass ("resampleQuality gives 2");
+    } else {
+        runtest.fail ("resampleQuality doesn't give 2");
+    }
+
+    if (rc.decodeThreads() == -1) {
+        runtest.pass ("decodeThreads gives -1");
+    } else {
+        runtest.fail ("decodeThreads doesn't give -1");
+    }
+
+    if (rc.bitmapCacheSize() == 32768) {
+        runtest.pass ("bitmapCacheSize gives 32768");
+    } else {
+        runtest.fail ("bitmapCacheSize doesn't give 32768");
+    }
+
+    if (rc.inflateWindow() == 4096) {
+        runtest.pass ("inflateWindow gives 4096");
+    } else {
+        runtest.fail ("inflateWindow doesn't give 4096");
+    }
+
 
     // Parse a second file
     if (rc.parseFile("gnashrc-local")) {
@@ -0,0 +1,125 @@
+//
+//   Copyright (C) 2005, 2006, 2007, 2008, 2009, 2010, 2011, 2012
+//   Free Software Foundation, Inc
+//
+// This program is free software; you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation; either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program; if not, write to the Free Software
+// Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+
+#ifdef HAVE_CONFIG_H
+#include "gnashconfig.h"
+#endif
+
+#include "check.h"
+#include "WorkerPool.h"
+
+#include <atomic>
+#include <future>
+#include <memory>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+using namespace gnash;
+
+int
+main(int /*argc*/, char** /*argv*/)
+{
+    {
+        WorkerPool pool(0);
+        check(pool.size() >= 1);
+    }
+
+    {
+        WorkerPool pool(4);
+        check_equals(pool.size(), 4);
+
+        std::future<int> f = pool.submit([] { return 6 * 7; });
+        check_equals(f.get(), 42);
+
+        std::future<std::unique_ptr<std::string> > s = pool.submit([] {
+            return std::unique_ptr<std::string>(new std::string("gnash"));
+        });
+        check_equals(*s.get(), "gnash");
+
+        // Exceptions reach whoever waits.
+        std::future<int> e = pool.submit([]() -> int {
+            throw std::runtime_error("failed");
+        });
+        bool thrown = false;
+        try {
+            e.get();
+        }
+        catch (const std::runtime_error&) {
+            thrown = true;
+        }
+        check(thrown);
+
+        // Many jobs at once.
+        std::atomic<int> done(0);
+        std::vector<std::future<int> > results;
+        for (int i = 0; i < 1000; ++i) {
+            results.push_back(pool.submit([i, &done] {
+                ++done;
+                return i * 2;
+            }));
+        }
+        int sum = 0;
+        for (std::future<int>& r : results) sum += r.get();
+        check_equals(sum, 999 * 1000);
+        check_equals(done.load(), 1000);
+    }
+
+    // One thread runs jobs in order.
+    {
+        WorkerPool pool(1);
+        std::vector<int> order;
+        std::vector<std::future<void> > results;
+        for (int i = 0; i < 100; ++i) {
+            results.push_back(pool.submit([i, &order] { order.push_back(i); }));
+        }
+        results.back().get();
+        bool inOrder = order.size() == 100;
+        for (size_t i = 0; inOrder && i < order.size(); ++i) {
+            inOrder = order[i] == static_cast<int>(i);
+        }
+        check(inOrder);
+    }
+
+    // Jobs dropped by the destructor break their promises. The second
+    // job can't start while the first waits, and dropping it lets the
+    // first go on.
+    {
+        std::future<void> dropped;
+        std::promise<void> release;
+        std::shared_future<void> wait(release.get_future());
+        {
+            WorkerPool pool(1);
+            std::shared_ptr<std::promise<void> > guard(&release,
+                    [](std::promise<void>* p) { p->set_value(); });
+            pool.submit([wait] { wait.get(); });
+            dropped = pool.submit([guard] {});
+            guard.reset();
+        }
+        bool broken = false;
+        try {
+            dropped.get();
+        }
+        catch (const std::future_error&) {
+            broken = true;
+        }
+        check(broken);
+    }
+
+    return 0;
+}
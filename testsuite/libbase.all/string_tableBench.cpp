@@ -0,0 +1,186 @@
+// string_tableBench.cpp: timing of string_table on identifier workloads.
+//
+//   Copyright (C) 2005, 2006, 2007, 2008, 2009, 2010, 2011, 2012
+//   Free Software Foundation, Inc
+//
+// This program is free software; you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation; either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program; if not, write to the Free Software
+// Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+
+// This is not a test: it compares string_table with the mutex-guarded
+// multi_index table it replaced. Build it with "make string_tableBench".
+
+#ifdef HAVE_CONFIG_H
+#include "gnashconfig.h"
+#endif
+
+#include "string_table.h"
+
+#include <boost/multi_index_container.hpp>
+#include <boost/multi_index/hashed_index.hpp>
+#include <boost/multi_index/member.hpp>
+#include <boost/algorithm/string/case_conv.hpp>
+#include <chrono>
+#include <cstdlib>
+#include <iostream>
+#include <map>
+#include <mutex>
+#include <random>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <vector>
+
+using namespace gnash;
+
+namespace {
+
+/// The previous string_table implementation, for reference.
+class MultiIndexTable
+{
+public:
+    typedef std::size_t key;
+
+    MultiIndexTable() : _highestKey(0) {}
+
+    // The old table searched without locking, which isn't safe while
+    // another thread inserts, so this locks for all searches.
+    key find(const std::string& s) {
+        if (s.empty()) return 0;
+        std::lock_guard<std::mutex> lock(_lock);
+        Table::iterator i = _table.get<Value>().find(s);
+        if (i != _table.end()) return i->id;
+        const key ret = _table.insert(Svt(s, ++_highestKey)).first->id;
+        const std::string lower = boost::to_lower_copy(s);
+        if (lower != s) {
+            Table::iterator it = _table.get<Value>().find(lower);
+            _caseTable[ret] = (it == _table.end()) ?
+                _table.insert(Svt(lower, ++_highestKey)).first->id : it->id;
+        }
+        return ret;
+    }
+
+    key noCase(key a) const {
+        std::map<key, key>::const_iterator i = _caseTable.find(a);
+        return i == _caseTable.end() ? a : i->second;
+    }
+
+private:
+    struct Svt {
+        Svt(std::string v, std::size_t i) : value(std::move(v)), id(i) {}
+        std::string value;
+        std::size_t id;
+    };
+    struct Value {};
+    struct Id {};
+    typedef boost::multi_index_container<Svt,
+        boost::multi_index::indexed_by<
+            boost::multi_index::hashed_unique<boost::multi_index::tag<Value>,
+                boost::multi_index::member<Svt, std::string, &Svt::value> >,
+            boost::multi_index::hashed_unique<boost::multi_index::tag<Id>,
+                boost::multi_index::member<Svt, std::size_t, &Svt::id> >
+        > > Table;
+
+    Table _table;
+    std::mutex _lock;
+    std::size_t _highestKey;
+    std::map<key, key> _caseTable;
+};
+
+typedef std::chrono::steady_clock Clock;
+
+double
+msSince(Clock::time_point start)
+{
+    return std::chrono::duration<double, std::milli>(Clock::now() - start)
+        .count();
+}
+
+/// Identifiers as they come in SWFs: a few hot property names, many
+/// numbered variables and some mixed case ones.
+std::vector<std::string>
+identifiers(size_t count)
+{
+    static const char* stems[] = { "_root", "_parent", "this", "onEnterFrame",
+        "length", "mc", "item", "myVar", "getURL", "TextField", "x", "_x" };
+    std::vector<std::string> ids;
+    for (size_t i = 0; i < count; ++i) {
+        std::ostringstream ss;
+        ss << stems[i % (sizeof stems / sizeof *stems)];
+        if (i >= 12) ss << i;
+        ids.push_back(ss.str());
+    }
+    return ids;
+}
+
+template<typename T>
+void
+run(const char* name, const std::vector<std::string>& ids,
+        const std::vector<size_t>& accesses)
+{
+    T table;
+    size_t sum = 0;
+
+    Clock::time_point start = Clock::now();
+    for (const std::string& s : ids) sum += table.find(s);
+    const double intern = msSince(start);
+
+    start = Clock::now();
+    for (size_t i : accesses) sum += table.find(ids[i]);
+    const double lookup = msSince(start);
+
+    start = Clock::now();
+    for (size_t i : accesses) sum += table.noCase(i + 1);
+    const double nocase = msSince(start);
+
+    // Lookups while another thread interns new identifiers, as the
+    // main thread does while a SWF is being loaded.
+    std::thread loader([&table, &ids]() {
+            for (const std::string& s : ids) table.find(s + "_loaded");
+        });
+    start = Clock::now();
+    for (size_t i : accesses) sum += table.find(ids[i]);
+    const double contended = msSince(start);
+    loader.join();
+
+    std::cout << name << ": intern " << intern << "ms, lookup " << lookup
+              << "ms, noCase " << nocase << "ms, lookup while loading "
+              << contended << "ms (" << sum % 10 << ")" << std::endl;
+}
+
+}
+
+int
+main(int argc, char** argv)
+{
+    const size_t count = argc > 1 ? std::strtoul(argv[1], nullptr, 10) : 20000;
+    const size_t lookups = argc > 2 ? std::strtoul(argv[2], nullptr, 10) :
+        2000000;
+
+    const std::vector<std::string> ids = identifiers(count);
+
+    // Hot names are accessed much more often than the rest.
+    std::mt19937 rng(42);
+    std::geometric_distribution<size_t> dist(0.01);
+    std::vector<size_t> accesses;
+    for (size_t i = 0; i < lookups; ++i) {
+        accesses.push_back(dist(rng) % count);
+    }
+
+    std::cout << count << " identifiers, " << lookups << " accesses"
+              << std::endl;
+    run<MultiIndexTable>("multi_index + mutex", ids, accesses);
+    run<string_table>("string_table", ids, accesses);
+
+    return 0;
+}
@@ -28,6 +28,7 @@
 #include <cassert>
 #include <cmath>
 #include <string>
+#include <vector>
 
 #include "check.h"
 
@@ -59,5 +60,35 @@ trymain(int /*argc*/, char** /*argv*/)
     check(!equal(st, st.find("AbAb"), st.find("abaB"), false));
     check(!equal(st, st.find("AbAb"), st.find("ABAB"), false));
 
+    // Preset keys keep their ids, and caseless equivalents in the group
+    // are used.
+    const string_table::svt group[] = {
+        string_table::svt("preset", 5000),
+        string_table::svt("PreSet", 5001)
+    };
+    st.insert_group(group, 2);
+    check_equals(st.find("preset"), 5000);
+    check_equals(st.value(5001), "PreSet");
+    check_equals(st.noCase(5001), 5000);
+    check_equals(st.value(0), "");
+    check_equals(st.value(100000), "");
+
+    // Many strings, so that the table grows.
+    std::vector<string_table::key> keys;
+    for (size_t i = 0; i < 10000; ++i) {
+        std::ostringstream ss;
+        ss << "Name" << i;
+        keys.push_back(st.find(ss.str()));
+    }
+    bool same = true;
+    for (size_t i = 0; i < keys.size(); ++i) {
+        std::ostringstream ss;
+        ss << "Name" << i;
+        same = same && st.find(ss.str(), false) == keys[i] &&
+            st.value(keys[i]) == ss.str() &&
+            st.value(st.noCase(keys[i])) == "name" + ss.str().substr(4);
+    }
+    check(same);
+
     return 0;
 }
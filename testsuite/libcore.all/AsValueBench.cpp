@@ -0,0 +1,194 @@
+// AsValueBench.cpp: timing of the as_value operations AVM1 handlers do.
+//
+//   Copyright (C) 2005, 2006, 2007, 2008, 2009, 2010, 2011, 2012
+//   Free Software Foundation, Inc
+//
+// This program is free software; you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation; either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program; if not, write to the Free Software
+// Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+
+// This is not a test: it repeats what the AVM1 action handlers do with
+// values, pushing and popping them on a SafeStack, copying them to and
+// from registers and object properties, comparing and adding them, and
+// reports the time each takes. It then builds a 1 MB string by
+// repeated +=, as scripts assembling XML or logs do. Build it with
+// "make AsValueBench".
+//
+//	AsValueBench [-n iterations]
+
+#ifdef HAVE_CONFIG_H
+#include "gnashconfig.h"
+#endif
+
+#include "as_value.h"
+#include "as_object.h"
+#include "DummyMovieDefinition.h"
+#include "Global_as.h"
+#include "ManualClock.h"
+#include "Movie.h"
+#include "movie_root.h"
+#include "RunResources.h"
+#include "SafeStack.h"
+#include "StreamProvider.h"
+#include "VM.h"
+
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <functional>
+#include <memory>
+#include <string>
+#include <vector>
+
+using namespace gnash;
+
+namespace {
+
+typedef std::chrono::steady_clock Clock;
+
+size_t iterations = 1000000;
+
+/// Run an operation and print the time it takes per iteration.
+void
+bench(const char* name, const std::function<void(size_t)>& op)
+{
+    const Clock::time_point start = Clock::now();
+    for (size_t i = 0; i < iterations; ++i) op(i);
+    const double ns = std::chrono::duration<double, std::nano>(
+            Clock::now() - start).count();
+    std::printf("%-24s %8.2f ns\n", name, ns / iterations);
+}
+
+} // anonymous namespace
+
+int
+main(int argc, char** argv)
+{
+    for (int i = 1; i + 1 < argc; i += 2) {
+        if (!std::strcmp(argv[i], "-n")) iterations = std::atoi(argv[i + 1]);
+    }
+
+    RunResources runResources;
+    const URL url("");
+    runResources.setStreamProvider(
+            std::shared_ptr<StreamProvider>(new StreamProvider(url, url)));
+    movie_definition* md = new DummyMovieDefinition(runResources, 7);
+    ManualClock clock;
+    movie_root stage(clock, runResources);
+    MovieClip::MovieVariables variables;
+    stage.init(md, variables);
+
+    VM& vm = stage.getVM();
+    const int version = vm.getSWFVersion();
+
+    std::printf("sizeof(as_value): %zu\n", sizeof(as_value));
+
+    // Longer than strings kept inside a std::string.
+    const as_value name("onEnterFrameHandler");
+    const as_value other("onEnterFrameHandler");
+    const as_value number(12.5);
+    const as_value clip(getObject(&stage.getRootMovie()));
+
+    SafeStack<as_value> stack;
+    std::vector<as_value> registers(4);
+    as_object* obj = createObject(*vm.getGlobal());
+    const ObjectURI uri = getURI(vm, "property");
+
+    size_t sink = 0;
+
+    // ActionPushData of a constant, then a handler popping it.
+    bench("push/pop string", [&](size_t) {
+        stack.push(name);
+        const as_value v = stack.pop();
+        sink += v.is_string();
+    });
+
+    bench("push/pop number", [&](size_t) {
+        stack.push(number);
+        const as_value v = stack.pop();
+        sink += v.is_number();
+    });
+
+    bench("push/pop clip", [&](size_t) {
+        stack.push(clip);
+        const as_value v = stack.pop();
+        sink += v.is_object();
+    });
+
+    // ActionStoreRegister and a push of the register.
+    bench("register string", [&](size_t i) {
+        registers[i & 3] = name;
+        stack.push(registers[i & 3]);
+        stack.drop(1);
+    });
+
+    // ActionSetMember and ActionGetMember.
+    bench("set/get member string", [&](size_t) {
+        obj->set_member(uri, name);
+        as_value v;
+        obj->get_member(uri, &v);
+        sink += v.is_string();
+    });
+
+    // ActionStrictEquals.
+    bench("strict equals string", [&](size_t) {
+        stack.push(name);
+        stack.push(other);
+        sink += stack.top(1).strictly_equals(stack.top(0));
+        stack.drop(2);
+    });
+
+    // ActionNewAdd on numbers.
+    bench("add numbers", [&](size_t i) {
+        stack.push(number);
+        stack.push(as_value(static_cast<double>(i)));
+        const double d = stack.top(1).to_number(version) +
+            stack.top(0).to_number(version);
+        stack.drop(1);
+        stack.top(0) = d;
+        sink += stack.pop().is_number();
+    });
+
+    // ActionNewAdd on strings, which makes a new one.
+    bench("add strings", [&](size_t) {
+        stack.push(name);
+        stack.push(other);
+        std::string s = stack.top(1).to_string(version);
+        s += stack.top(0).to_string(version);
+        stack.drop(1);
+        stack.top(0) = s;
+        sink += stack.pop().is_string();
+    });
+
+    // s += piece, until s is 1 MB, then read it once.
+    const as_value piece("<item id='42'/>\n");
+    as_value s("");
+    const Clock::time_point start = Clock::now();
+    size_t appends = 0;
+    for (size_t size = 0; size < 1024 * 1024; size += 16, ++appends) {
+        stack.push(s);
+        stack.push(piece);
+        const as_value& op2 = stack.pop();
+        as_value op1 = stack.pop();
+        newAdd(op1, op2, vm);
+        s = op1;
+    }
+    sink += s.to_string(version).size() == appends * 16;
+    const double ms = std::chrono::duration<double, std::milli>(
+            Clock::now() - start).count();
+    std::printf("%-24s %8.2f ms for %zu appends\n", "build 1 MB string", ms,
+            appends);
+
+    return sink ? EXIT_SUCCESS : EXIT_FAILURE;
+}
@@ -28,12 +28,14 @@
 #include "movie_definition.h"
 #include "dejagnu.h"
 #include "as_value.h"
+#include "ConstantPool.h"
 #include "StreamProvider.h"
 #include "as_object.h"
 #include "arg_parser.h"
 #include "Global_as.h"
 #include "GnashNumeric.h"
 #include "movie_root.h"
+#include "Movie.h"
 #include "RunResources.h"
 #include <string>
 #include <sys/types.h>
@@ -56,6 +58,7 @@ static void usage (void);
 
 static void test_isnan();
 static void test_conversion();
+static void test_sharing(movie_root& stage);
 
 TestState runtest;
 LogFile& dbglogfile = LogFile::getDefaultInstance();
@@ -119,6 +122,7 @@ trymain(int argc, char *argv[])
     // run the tests
     test_isnan();
     test_conversion();
+    test_sharing(stage);
    
     return 0;
 }
@@ -181,6 +185,96 @@ test_conversion()
     
 }
 
+void
+test_sharing(movie_root& stage)
+{
+    // Copies share the string, but changing one leaves the others.
+    const std::string text("longer than what a std::string keeps inline");
+    as_value a(text);
+    as_value b(a);
+    b.set_string("other");
+    check_equals(a.to_string(), text);
+    check_equals(b.to_string(), "other");
+    b = a;
+    check(b.strictly_equals(a));
+    b.set_string(b.to_string() + "!");
+    check_equals(b.to_string(), text + "!");
+
+    // The exception flag keeps the string.
+    as_value e(a);
+    e.flag_exception();
+    as_value e2(e);
+    check(e2.is_exception());
+    e2.unflag_exception();
+    check(e2.is_string());
+    check_equals(e2.to_string(), text);
+
+    // A moved from value is undefined.
+    as_value moved(std::move(e2));
+    check(moved.is_string());
+    check(e2.is_undefined());
+
+    // Interned strings equal runtime ones.
+    const SharedString s1 = SharedString::intern("onEnterFrame");
+    const SharedString s2 = SharedString::intern("onEnterFrame");
+    check(s1.interned());
+    check_equals(&s1.str(), &s2.str());
+    check(as_value(s1).strictly_equals(as_value("onEnterFrame")));
+    check(!as_value(s1).strictly_equals(as_value("onenterframe")));
+
+    // Constant pool names are interned when first pushed, text isn't.
+    ConstantPool pool;
+    pool.push_back("onEnterFrame");
+    pool.push_back("_root.clip/a:b");
+    pool.push_back("Game over!");
+    pool.push_back("");
+    check_equals(&pool[0].str(), &s1.str());
+    check(pool[1].interned());
+    check(!pool[2].interned());
+    check_equals(pool[2].str(), "Game over!");
+    check_equals(&pool[2].str(), &pool[2].str());
+    check(pool[3].empty());
+    check_equals(std::string(pool.c_str(2)), "Game over!");
+
+    // Empty strings.
+    check(as_value("").is_string());
+    check(as_value(std::string()).strictly_equals(as_value(SharedString())));
+    check(!as_value("").strictly_equals(as_value()));
+    check_equals(as_value("").to_string(), "");
+
+    // Long concatenations are read when first used.
+    const SharedString piece(std::string(100, 'x'));
+    SharedString rope;
+    for (size_t i = 0; i < 100000; ++i) rope = rope + piece;
+    check_equals(rope.size(), 100000 * 100);
+    const as_value ropeValue(rope);
+    check(ropeValue.strictly_equals(as_value(std::string(100000 * 100, 'x'))));
+    check(!ropeValue.strictly_equals(as_value(std::string(100, 'x'))));
+    check_equals(ropeValue.to_string(), rope.str());
+
+    // Short ones are copied.
+    const SharedString ab = SharedString(std::string("a")) +
+        SharedString(std::string("b"));
+    check_equals(ab.str(), "ab");
+    check_equals((ab + SharedString()).str(), "ab");
+    check_equals(as_value(rope + ab).to_string().substr(9999998), "xxab");
+
+    // An unread rope of many parts can go away.
+    SharedString unread;
+    for (size_t i = 0; i < 100000; ++i) unread = unread + piece;
+    unread = SharedString();
+    check(unread.empty());
+
+    // Copies of a DisplayObject value refer to the same one.
+    const as_value clip(getObject(&stage.getRootMovie()));
+    check(clip.is_sprite());
+    as_value clip2(clip);
+    check(clip2.strictly_equals(clip));
+    check_equals(clip2.toDisplayObject(), &stage.getRootMovie());
+    clip2.set_double(1);
+    check(clip.is_sprite());
+    check(clip2.is_number());
+}
 
 void
 test_isnan()
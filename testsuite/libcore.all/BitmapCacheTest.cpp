@@ -0,0 +1,138 @@
+//
+//   Copyright (C) 2005, 2006, 2007, 2008, 2009, 2010, 2011, 2012
+//   Free Software Foundation, Inc
+//
+// This program is free software; you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation; either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program; if not, write to the Free Software
+// Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+
+#ifdef HAVE_CONFIG_H
+#include "gnashconfig.h"
+#endif
+
+#include "check.h"
+#include "BitmapCache.h"
+#include "CachedBitmap.h"
+#include "DummyRenderer.h"
+#include "GnashImage.h"
+#include "WorkerPool.h"
+
+#include <memory>
+#include <string>
+#include <vector>
+
+using namespace gnash;
+
+namespace {
+
+/// Makes a 32x32 RGBA image of 4096 bytes, counting calls.
+LazyBitmap::Decoder
+decoder(int& calls)
+{
+    return [&calls] {
+        ++calls;
+        return std::unique_ptr<image::GnashImage>(
+                new image::ImageRGBA(32, 32));
+    };
+}
+
+} // anonymous namespace
+
+int
+main(int /*argc*/, char** /*argv*/)
+{
+    DummyRenderer renderer;
+
+    // Room for two bitmaps.
+    BitmapCache cache(8192);
+
+    int callsA = 0, callsB = 0, callsC = 0;
+    LazyBitmap a(decoder(callsA), cache);
+    LazyBitmap b(decoder(callsB), cache);
+    std::unique_ptr<LazyBitmap> c(new LazyBitmap(decoder(callsC), cache));
+
+    // Nothing is decoded until used.
+    check_equals(callsA, 0);
+    check_equals(cache.bytes(), 0);
+
+    CachedBitmap* bitmap = a.get(renderer);
+    check(bitmap);
+    check_equals(bitmap->image().width(), 32);
+    check_equals(callsA, 1);
+    check_equals(cache.bytes(), 4096);
+
+    // Decoded once.
+    check_equals(a.get(renderer), bitmap);
+    check_equals(callsA, 1);
+
+    b.get(renderer);
+    c->get(renderer);
+    check_equals(cache.size(), 3);
+    check_equals(cache.bytes(), 3 * 4096);
+
+    // Bitmaps are only dropped by trim(), least recently used first.
+    a.get(renderer);
+    cache.trim();
+    check_equals(cache.size(), 2);
+    check_equals(cache.bytes(), 2 * 4096);
+
+    a.get(renderer);
+    c->get(renderer);
+    check_equals(callsA, 1);
+    check_equals(callsC, 1);
+    b.get(renderer);
+    check_equals(callsB, 2);
+
+    // A bitmap going away leaves the cache.
+    c.reset();
+    check_equals(cache.size(), 2);
+    check_equals(cache.bytes(), 2 * 4096);
+
+    // A bitmap that can't be decoded is tried once.
+    int broken = 0;
+    LazyBitmap d([&broken] {
+        ++broken;
+        return std::unique_ptr<image::GnashImage>();
+    }, cache);
+    check(!d.get(renderer));
+    check(!d.get(renderer));
+    check_equals(broken, 1);
+
+    // Prefetching only happens when the cache has room.
+    {
+        WorkerPool workers(1);
+        int calls = 0;
+        LazyBitmap e(decoder(calls), cache);
+        e.prefetch(workers, 4096);
+        check(e.get(renderer));
+        check_equals(calls, 1);
+        check_equals(cache.bytes(), 3 * 4096);
+
+        int none = 0;
+        LazyBitmap f(decoder(none), cache);
+        f.prefetch(workers, 4096);
+        check_equals(none, 0);
+    }
+    cache.trim();
+    check_equals(cache.bytes(), 2 * 4096);
+
+    // No limit.
+    BitmapCache unlimited(0);
+    int calls = 0;
+    LazyBitmap g(decoder(calls), unlimited);
+    g.get(renderer);
+    unlimited.trim();
+    check_equals(unlimited.size(), 1);
+
+    return 0;
+}
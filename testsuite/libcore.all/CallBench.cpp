@@ -0,0 +1,352 @@
+// CallBench.cpp: timing of calls to ActionScript functions.
+//
+//   Copyright (C) 2005, 2006, 2007, 2008, 2009, 2010, 2011, 2012
+//   Free Software Foundation, Inc
+//
+// This program is free software; you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation; either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program; if not, write to the Free Software
+// Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+
+// This is not a test: it assembles a DoAction block defining a
+// recursive fib() and an event handler, each as a DefineFunction and
+// a DefineFunction2 the way compilers write them, runs it on the root
+// movie and reports the time a call takes when fib(n) calls itself
+// and when the handler is called from outside ActionScript, as events
+// are dispatched. Build it with "make CallBench".
+//
+//	CallBench [-n fib argument] [-e events]
+
+#ifdef HAVE_CONFIG_H
+#include "gnashconfig.h"
+#endif
+
+#include "action_buffer.h"
+#include "ActionExec.h"
+#include "as_environment.h"
+#include "as_object.h"
+#include "DummyMovieDefinition.h"
+#include "Global_as.h"
+#include "IOChannel.h"
+#include "ManualClock.h"
+#include "Movie.h"
+#include "movie_root.h"
+#include "RunResources.h"
+#include "StreamProvider.h"
+#include "SWF.h"
+#include "SWFStream.h"
+#include "VM.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <functional>
+#include <memory>
+#include <string>
+#include <vector>
+
+using namespace gnash;
+
+namespace {
+
+typedef std::chrono::steady_clock Clock;
+
+typedef std::vector<std::uint8_t> Bytes;
+
+/// Reads bytes held in memory.
+class MemoryChannel : public IOChannel
+{
+public:
+    explicit MemoryChannel(const Bytes& data)
+        :
+        _data(data),
+        _pos(0)
+    {}
+
+    std::streamsize read(void* dst, std::streamsize bytes) {
+        bytes = std::min<std::streamsize>(bytes, _data.size() - _pos);
+        std::memcpy(dst, &_data[_pos], bytes);
+        _pos += bytes;
+        return bytes;
+    }
+    std::streampos tell() const { return _pos; }
+    bool seek(std::streampos pos) {
+        if (pos > static_cast<std::streampos>(_data.size())) return false;
+        _pos = pos;
+        return true;
+    }
+    void go_to_end() { _pos = _data.size(); }
+    bool eof() const { return _pos == _data.size(); }
+    bool bad() const { return false; }
+
+private:
+    const Bytes& _data;
+    size_t _pos;
+};
+
+void
+put16(Bytes& b, size_t v)
+{
+    b.push_back(v & 0xff);
+    b.push_back((v >> 8) & 0xff);
+}
+
+void
+putString(Bytes& b, const std::string& s)
+{
+    b.insert(b.end(), s.begin(), s.end());
+    b.push_back(0);
+}
+
+void
+action(Bytes& code, std::uint8_t id, const Bytes& data = Bytes())
+{
+    code.push_back(id);
+    if (id & 0x80) {
+        put16(code, data.size());
+        code.insert(code.end(), data.begin(), data.end());
+    }
+}
+
+/// The data of an ActionPushData.
+class Push
+{
+public:
+    Push& str(const std::string& s) {
+        _data.push_back(0);
+        putString(_data, s);
+        return *this;
+    }
+    Push& num(std::int32_t i) {
+        _data.push_back(7);
+        for (size_t n = 0; n < 4; ++n) _data.push_back((i >> (8 * n)) & 0xff);
+        return *this;
+    }
+    Push& reg(std::uint8_t r) {
+        _data.push_back(4);
+        _data.push_back(r);
+        return *this;
+    }
+    void to(Bytes& code) const {
+        action(code, SWF::ACTION_PUSHDATA, _data);
+    }
+private:
+    Bytes _data;
+};
+
+/// Push the one argument, by name or from register 1.
+void
+pushArgument(Bytes& code, bool reg)
+{
+    if (reg) {
+        Push().reg(1).to(code);
+        return;
+    }
+    Push().str("n").to(code);
+    action(code, SWF::ACTION_GETVARIABLE);
+}
+
+/// if (n < 2) return n; return name(n - 1) + name(n - 2);
+Bytes
+fibBody(const std::string& name, bool reg)
+{
+    Bytes recurse;
+    for (std::int32_t d = 1; d <= 2; ++d) {
+        pushArgument(recurse, reg);
+        Push().num(d).to(recurse);
+        action(recurse, SWF::ACTION_SUBTRACT);
+        Push().num(1).str(name).to(recurse);
+        action(recurse, SWF::ACTION_CALLFUNCTION);
+    }
+    action(recurse, SWF::ACTION_NEWADD);
+    action(recurse, SWF::ACTION_RETURN);
+
+    Bytes small;
+    pushArgument(small, reg);
+    action(small, SWF::ACTION_RETURN);
+
+    Bytes body;
+    pushArgument(body, reg);
+    Push().num(2).to(body);
+    action(body, SWF::ACTION_NEWLESSTHAN);
+    action(body, SWF::ACTION_LOGICALNOT);
+    Bytes offset;
+    put16(offset, small.size());
+    action(body, SWF::ACTION_BRANCHIFTRUE, offset);
+    body.insert(body.end(), small.begin(), small.end());
+    body.insert(body.end(), recurse.begin(), recurse.end());
+    return body;
+}
+
+/// this.count = this.count + n;
+Bytes
+handlerBody(bool reg)
+{
+    Bytes body;
+    for (size_t i = 0; i < 2; ++i) {
+        if (reg) Push().reg(1).to(body);
+        else {
+            Push().str("this").to(body);
+            action(body, SWF::ACTION_GETVARIABLE);
+        }
+        Push().str("count").to(body);
+    }
+    action(body, SWF::ACTION_GETMEMBER);
+    if (reg) Push().reg(2).to(body);
+    else {
+        Push().str("n").to(body);
+        action(body, SWF::ACTION_GETVARIABLE);
+    }
+    action(body, SWF::ACTION_NEWADD);
+    action(body, SWF::ACTION_SETMEMBER);
+    return body;
+}
+
+/// A DefineFunction of a function taking n.
+void
+defineFunction(Bytes& code, const std::string& name, const Bytes& body)
+{
+    Bytes data;
+    putString(data, name);
+    put16(data, 1);
+    putString(data, "n");
+    put16(data, body.size());
+    action(code, SWF::ACTION_DEFINEFUNCTION, data);
+    code.insert(code.end(), body.begin(), body.end());
+}
+
+/// A DefineFunction2 of a function taking n in the last register.
+void
+defineFunction2(Bytes& code, const std::string& name, std::uint16_t flags,
+        std::uint8_t registers, const Bytes& body)
+{
+    Bytes data;
+    putString(data, name);
+    put16(data, 1);
+    data.push_back(registers);
+    put16(data, flags);
+    data.push_back(registers - 1);
+    putString(data, "n");
+    put16(data, body.size());
+    action(code, SWF::ACTION_DEFINEFUNCTION2, data);
+    code.insert(code.end(), body.begin(), body.end());
+}
+
+/// A DoAction tag defining the functions.
+Bytes
+doAction()
+{
+    Bytes code;
+    defineFunction(code, "fib", fibBody("fib", false));
+
+    // Suppress this, arguments and super.
+    defineFunction2(code, "fib2", 0x2a, 2, fibBody("fib2", true));
+
+    defineFunction(code, "handler", handlerBody(false));
+
+    // Preload this, suppress arguments and super.
+    defineFunction2(code, "handler2", 0x29, 3, handlerBody(true));
+    action(code, SWF::ACTION_END);
+
+    Bytes tag;
+    put16(tag, SWF::DOACTION << 6 | 0x3f);
+    put16(tag, code.size());
+    put16(tag, 0);
+    tag.insert(tag.end(), code.begin(), code.end());
+    return tag;
+}
+
+double
+fib(double n)
+{
+    return n < 2 ? n : fib(n - 1) + fib(n - 2);
+}
+
+/// Make the given number of calls and print the time each takes.
+void
+bench(const char* name, size_t calls, const std::function<bool()>& run)
+{
+    const Clock::time_point start = Clock::now();
+    const bool ok = run();
+    const double ns = std::chrono::duration<double, std::nano>(
+            Clock::now() - start).count();
+    std::printf("%-24s %8.2f ns per call%s\n", name, ns / calls,
+            ok ? "" : " (wrong result)");
+}
+
+} // anonymous namespace
+
+int
+main(int argc, char** argv)
+{
+    double n = 20;
+    size_t events = 200000;
+    for (int i = 1; i + 1 < argc; i += 2) {
+        if (!std::strcmp(argv[i], "-n")) n = std::atoi(argv[i + 1]);
+        else if (!std::strcmp(argv[i], "-e")) events = std::atoi(argv[i + 1]);
+    }
+
+    RunResources runResources;
+    const URL url("");
+    runResources.setStreamProvider(
+            std::shared_ptr<StreamProvider>(new StreamProvider(url, url)));
+    movie_definition* md = new DummyMovieDefinition(runResources, 7);
+    ManualClock clock;
+    movie_root stage(clock, runResources);
+    MovieClip::MovieVariables variables;
+    stage.init(md, variables);
+
+    VM& vm = stage.getVM();
+    Movie& root = stage.getRootMovie();
+    as_object* obj = getObject(&root);
+
+    const Bytes tag = doAction();
+    MemoryChannel channel(tag);
+    SWFStream in(&channel);
+    in.open_tag();
+    action_buffer code(*md);
+    code.read(in, in.get_tag_end_position());
+    in.close_tag();
+
+    as_environment env(vm);
+    env.set_target(&root);
+    env.set_original_target(&root);
+    ActionExec(code, env)();
+
+    // fib(n) makes this many calls.
+    const size_t calls = 2 * fib(n + 1) - 1;
+    const double expected = fib(n);
+
+    for (const char* f : { "fib", "fib2" }) {
+        const ObjectURI uri = getURI(vm, f);
+        bench(f, calls, [&]() {
+            return callMethod(obj, uri, n).to_number(7) == expected;
+        });
+    }
+
+    const ObjectURI count = getURI(vm, "count");
+    for (const char* f : { "handler", "handler2" }) {
+        const ObjectURI uri = getURI(vm, f);
+        obj->set_member(count, 0.0);
+        bench(f, events, [&]() {
+            for (size_t i = 0; i < events; ++i) callMethod(obj, uri, 1.0);
+            as_value v;
+            return obj->get_member(count, &v) &&
+                v.to_number(7) == static_cast<double>(events);
+        });
+    }
+
+    return EXIT_SUCCESS;
+}
@@ -0,0 +1,249 @@
+// CodeStreamBench.cpp: timing of AS3 bytecode verification and decoding.
+//
+//   Copyright (C) 2005, 2006, 2007, 2008, 2009, 2010, 2011, 2012
+//   Free Software Foundation, Inc
+//
+// This program is free software; you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation; either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program; if not, write to the Free Software
+// Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+
+// This is not a test: it makes the method bodies of a large ABC block,
+// verifies them as Method::getBody() does when each is first run, and
+// decodes every instruction of each, as Machine::execute() does,
+// through a CodeStream and through an istream over a copy of the code.
+// Build it with "make CodeStreamBench".
+//
+//	CodeStreamBench [-m methods] [-n runs]
+
+#ifdef HAVE_CONFIG_H
+#include "gnashconfig.h"
+#endif
+
+#include "CodeStream.h"
+#include "SWF.h"
+
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <memory>
+#include <sstream>
+#include <string>
+#include <vector>
+
+using namespace gnash;
+
+namespace {
+
+typedef std::chrono::steady_clock Clock;
+
+double
+msSince(Clock::time_point start)
+{
+    return std::chrono::duration<double, std::milli>(Clock::now() - start)
+        .count();
+}
+
+/// Reads code as CodeStream did, through an istream.
+class IstreamCode : public std::istream
+{
+public:
+    explicit IstreamCode(const std::string& data)
+        :
+        std::istream(&_buf),
+        _buf(data)
+    {}
+
+    std::uint8_t read_u8() {
+        char c;
+        read(&c, 1);
+        return static_cast<std::uint8_t>(c);
+    }
+
+    std::uint8_t read_as3op() {
+        const std::uint8_t op = read_u8();
+        return eof() ? 0 : op;
+    }
+
+    std::uint32_t read_V32() {
+        std::uint32_t result = read_u8();
+        if (!(result & 0x00000080)) return result;
+        result = (result & 0x0000007F) | read_u8() << 7;
+        if (!(result & 0x00004000)) return result;
+        result = (result & 0x00003FFF) | read_u8() << 14;
+        if (!(result & 0x00200000)) return result;
+        result = (result & 0x001FFFFF) | read_u8() << 21;
+        if (!(result & 0x10000000)) return result;
+        return (result & 0x0FFFFFFF) | read_u8() << 28;
+    }
+
+    std::int32_t read_S24() {
+        std::uint32_t result = read_u8();
+        result |= read_u8() << 8;
+        result |= read_u8() << 16;
+        if (result & (1 << 23)) result |= 0xFF000000;
+        return static_cast<std::int32_t>(result);
+    }
+
+private:
+    std::stringbuf _buf;
+};
+
+void
+putV32(std::string& code, std::uint32_t v)
+{
+    while (v >= 0x80) {
+        code += static_cast<char>((v & 0x7F) | 0x80);
+        v >>= 7;
+    }
+    code += static_cast<char>(v);
+}
+
+/// A method body of about the given size, made of a typical mix of
+/// instructions, with a forward jump in each block.
+std::string
+makeBody(size_t bytes, unsigned seed)
+{
+    std::string code;
+    while (code.size() < bytes) {
+        code += static_cast<char>(SWF::ABC_ACTION_GETLOCAL0);
+        code += static_cast<char>(SWF::ABC_ACTION_PUSHSCOPE);
+        code += static_cast<char>(SWF::ABC_ACTION_FINDPROPSTRICT);
+        putV32(code, 100 + seed % 300);
+        code += static_cast<char>(SWF::ABC_ACTION_PUSHBYTE);
+        code += static_cast<char>(seed & 0x7F);
+        code += static_cast<char>(SWF::ABC_ACTION_GETLOCAL);
+        putV32(code, 1 + seed % 20);
+        code += static_cast<char>(SWF::ABC_ACTION_ADD);
+        code += static_cast<char>(SWF::ABC_ACTION_CALLPROPVOID);
+        putV32(code, 200 + seed % 3000);
+        putV32(code, 1);
+
+        // Skip the pop.
+        code += static_cast<char>(SWF::ABC_ACTION_IFFALSE);
+        code += '\x01';
+        code += '\x00';
+        code += '\x00';
+        code += static_cast<char>(SWF::ABC_ACTION_POP);
+
+        code += static_cast<char>(SWF::ABC_ACTION_GETPROPERTY);
+        putV32(code, 5000 + seed % 10000);
+        code += static_cast<char>(SWF::ABC_ACTION_SETLOCAL);
+        putV32(code, 2);
+        seed = seed * 1103515245 + 12345;
+    }
+    code += static_cast<char>(SWF::ABC_ACTION_RETURNVOID);
+    return code;
+}
+
+/// Decode every instruction, following no jumps.
+template<typename Stream>
+std::uint64_t
+decode(Stream& s, size_t& instructions)
+{
+    std::uint64_t sum = 0;
+    for (;;) {
+        ++instructions;
+        switch (s.read_as3op()) {
+            case SWF::ABC_ACTION_END:
+            case SWF::ABC_ACTION_RETURNVOID:
+                return sum;
+            case SWF::ABC_ACTION_PUSHBYTE:
+                sum += s.read_u8();
+                break;
+            case SWF::ABC_ACTION_FINDPROPSTRICT:
+            case SWF::ABC_ACTION_GETLOCAL:
+            case SWF::ABC_ACTION_GETPROPERTY:
+            case SWF::ABC_ACTION_SETLOCAL:
+                sum += s.read_V32();
+                break;
+            case SWF::ABC_ACTION_CALLPROPVOID:
+                sum += s.read_V32();
+                sum += s.read_V32();
+                break;
+            case SWF::ABC_ACTION_IFFALSE:
+                sum += s.read_S24();
+                break;
+            default:
+                ++sum;
+                break;
+        }
+    }
+}
+
+} // anonymous namespace
+
+int
+main(int argc, char** argv)
+{
+    size_t methods = 2000;
+    size_t runs = 10;
+    for (int i = 1; i + 1 < argc; i += 2) {
+        if (!std::strcmp(argv[i], "-m")) methods = std::atoi(argv[i + 1]);
+        else if (!std::strcmp(argv[i], "-n")) runs = std::atoi(argv[i + 1]);
+    }
+
+    std::vector<std::string> bodies;
+    size_t bytes = 0;
+    for (size_t i = 0; i < methods; ++i) {
+        bodies.push_back(makeBody(256 + (i * 7919) % 8192, i));
+        bytes += bodies.back().size();
+    }
+    std::printf("%zu method bodies, %zu bytes of code\n", methods, bytes);
+
+    // What the first run of every method costs.
+    Clock::time_point start = Clock::now();
+    std::vector<std::unique_ptr<CodeStream> > streams;
+    for (const std::string& body : bodies) {
+        streams.emplace_back(new CodeStream(body));
+        if (!streams.back()->verify()) {
+            std::fprintf(stderr, "Verification failed\n");
+            return EXIT_FAILURE;
+        }
+    }
+    double ms = msSince(start);
+    std::printf("verify:   %8.2f ms, %8.1f MB/s\n", ms, bytes / ms / 1e3);
+
+    std::uint64_t sum = 0;
+    size_t instructions = 0;
+    start = Clock::now();
+    for (size_t r = 0; r < runs; ++r) {
+        for (const std::unique_ptr<CodeStream>& s : streams) {
+            s->seekTo(0);
+            sum += decode(*s, instructions);
+        }
+    }
+    ms = msSince(start);
+    std::printf("span:     %8.2f ms, %8.2f ns/instruction\n", ms,
+            ms * 1e6 / instructions);
+
+    std::uint64_t sum2 = 0;
+    size_t instructions2 = 0;
+    start = Clock::now();
+    for (size_t r = 0; r < runs; ++r) {
+        for (const std::string& body : bodies) {
+            IstreamCode s(body);
+            sum2 += decode(s, instructions2);
+        }
+    }
+    ms = msSince(start);
+    std::printf("istream:  %8.2f ms, %8.2f ns/instruction\n", ms,
+            ms * 1e6 / instructions2);
+
+    if (sum != sum2 || instructions != instructions2) {
+        std::fprintf(stderr, "Decoding differs\n");
+        return EXIT_FAILURE;
+    }
+    return EXIT_SUCCESS;
+}
@@ -57,7 +57,6 @@ main(int /*argc*/, char** /*argv*/)
 
 	//Reset stream.
 	stream->seekTo(0);
-	stream->clear();
 
 	//Test seekTo
 	stream->seekTo(5);
@@ -67,7 +66,6 @@ main(int /*argc*/, char** /*argv*/)
 
 	//Reset stream.
 	stream->seekTo(0);
-	stream->clear();	
 
 	//Test read_u8.
 	i=0;
@@ -77,7 +75,7 @@ main(int /*argc*/, char** /*argv*/)
 		i++;
 	}
 	
-	char newData[6] = {0x5,0xC5,0x0,0x0,0x1,0x2}; 
+	char newData[6] = {0x5,'\xC5',0x0,0x0,0x1,0x2};
 	CodeStream* streamA = new CodeStream(std::string(newData,6));
 	
 	std::uint8_t byteA = streamA->read_u8();
@@ -87,6 +85,84 @@ main(int /*argc*/, char** /*argv*/)
 	std::int32_t byteB = streamA->read_S24();
 	check_equals(byteB,197);
 
+	// Negative S24.
+	const char negative[3] = { '\xFE', '\xFF', '\xFF' };
+	CodeStream streamB(std::string(negative, 3));
+	check_equals(streamB.read_S24(), -2);
+
+	// Multi-byte V32.
+	const char v32[3] = { '\x81', '\x01', '\x7F' };
+	CodeStream streamC(std::string(v32, 3));
+	check_equals(streamC.read_V32(), 129u);
+	check_equals(streamC.tell(), 2u);
+
+	// Seeking outside the code throws.
+	bool thrown = false;
+	try { streamC.seekTo(4); }
+	catch (const CodeStreamException&) { thrown = true; }
+	check(thrown);
+	thrown = false;
+	try { streamC.seekBy(-3); }
+	catch (const CodeStreamException&) { thrown = true; }
+	check(thrown);
+	check_equals(streamC.tell(), 2u);
+
+	// getlocal0, pushscope, pushbyte 1, iftrue +2, pushbyte 2, pop,
+	// getlocal 300, returnvoid
+	const char good[] = { '\xD0', '\x30', '\x24', '\x01', '\x11', '\x02',
+		'\x00', '\x00', '\x24', '\x02', '\x29', '\x62', '\xAC', '\x02',
+		'\x47' };
+	check(CodeStream(std::string(good, sizeof(good))).verify());
+
+	// An operand running past the end.
+	check(!CodeStream(std::string(good, 13)).verify());
+	check(!CodeStream(std::string(good, 6)).verify());
+
+	// A jump into an operand.
+	std::string bad(good, sizeof(good));
+	bad[5] = '\x01';
+	check(!CodeStream(bad).verify());
+
+	// A jump out of the code.
+	bad[5] = '\x7F';
+	check(!CodeStream(bad).verify());
+
+	// A jump back to the start, and one to the end.
+	bad[5] = '\xF8';
+	bad[6] = bad[7] = '\xFF';
+	check(CodeStream(bad).verify());
+	bad[5] = '\x07';
+	bad[6] = bad[7] = '\x00';
+	check(CodeStream(bad).verify());
+
+	// An unknown opcode.
+	bad = std::string(good, sizeof(good));
+	bad[1] = '\x3F';
+	check(!CodeStream(bad).verify());
+
+	// pushbyte 0, lookupswitch default +14, 3 cases: -2, +14, +15,
+	// pushnull, returnvoid
+	const char lookup[] = { '\x24', '\x00', '\x1B', '\x0E', '\x00',
+		'\x00', '\x02', '\xFE', '\xFF', '\xFF', '\x0E', '\x00', '\x00',
+		'\x0F', '\x00', '\x00', '\x20', '\x47' };
+	check(CodeStream(std::string(lookup, sizeof(lookup))).verify());
+
+	// A case into the middle of pushbyte.
+	bad = std::string(lookup, sizeof(lookup));
+	bad[7] = '\xFF';
+	check(!CodeStream(bad).verify());
+
+	// Fewer cases than counted.
+	bad = std::string(lookup, sizeof(lookup));
+	bad[6] = '\x05';
+	check(!CodeStream(bad).verify());
+
+	// debug 1, 300, 2, 0
+	const char debug[] = { '\xEF', '\x01', '\xAC', '\x02', '\x02',
+		'\x00', '\x47' };
+	check(CodeStream(std::string(debug, sizeof(debug))).verify());
+	check(!CodeStream(std::string(debug, 5)).verify());
+
 	
 	
 	return 0;
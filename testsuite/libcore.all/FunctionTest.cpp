@@ -0,0 +1,325 @@
+//
+//   Copyright (C) 2005, 2006, 2007, 2008, 2009, 2010, 2011, 2012
+//   Free Software Foundation, Inc
+//
+// This program is free software; you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation; either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program; if not, write to the Free Software
+// Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+
+#ifdef HAVE_CONFIG_H
+#include "gnashconfig.h"
+#endif
+
+#include "action_buffer.h"
+#include "ActionExec.h"
+#include "as_environment.h"
+#include "as_object.h"
+#include "DummyMovieDefinition.h"
+#include "Function.h"
+#include "Global_as.h"
+#include "IOChannel.h"
+#include "ManualClock.h"
+#include "Movie.h"
+#include "movie_root.h"
+#include "RunResources.h"
+#include "StreamProvider.h"
+#include "SWF.h"
+#include "SWFStream.h"
+#include "VM.h"
+
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "check.h"
+
+using namespace gnash;
+
+namespace {
+
+typedef std::vector<std::uint8_t> Bytes;
+
+/// Reads bytes held in memory.
+class MemoryChannel : public IOChannel
+{
+public:
+    explicit MemoryChannel(const Bytes& data)
+        :
+        _data(data),
+        _pos(0)
+    {}
+
+    std::streamsize read(void* dst, std::streamsize bytes) {
+        bytes = std::min<std::streamsize>(bytes, _data.size() - _pos);
+        std::memcpy(dst, &_data[_pos], bytes);
+        _pos += bytes;
+        return bytes;
+    }
+    std::streampos tell() const { return _pos; }
+    bool seek(std::streampos pos) {
+        if (pos > static_cast<std::streampos>(_data.size())) return false;
+        _pos = pos;
+        return true;
+    }
+    void go_to_end() { _pos = _data.size(); }
+    bool eof() const { return _pos == _data.size(); }
+    bool bad() const { return false; }
+
+private:
+    const Bytes& _data;
+    size_t _pos;
+};
+
+/// Assembles action code.
+class Code
+{
+public:
+
+    Code& op(std::uint8_t id, const Bytes& data = Bytes()) {
+        _code.push_back(id);
+        if (id & 0x80) {
+            put16(_code, data.size());
+            _code.insert(_code.end(), data.begin(), data.end());
+        }
+        return *this;
+    }
+
+    Code& str(const std::string& s) {
+        Bytes data(1, 0);
+        putString(data, s);
+        return op(SWF::ACTION_PUSHDATA, data);
+    }
+
+    Code& num(std::int32_t i) {
+        Bytes data(1, 7);
+        for (size_t n = 0; n < 4; ++n) data.push_back((i >> (8 * n)) & 0xff);
+        return op(SWF::ACTION_PUSHDATA, data);
+    }
+
+    Code& reg(std::uint8_t r) {
+        Bytes data(1, 4);
+        data.push_back(r);
+        return op(SWF::ACTION_PUSHDATA, data);
+    }
+
+    Code& constant(std::uint8_t c) {
+        Bytes data(1, 8);
+        data.push_back(c);
+        return op(SWF::ACTION_PUSHDATA, data);
+    }
+
+    Code& pool(const std::vector<std::string>& strings) {
+        Bytes data;
+        put16(data, strings.size());
+        for (const std::string& s : strings) putString(data, s);
+        return op(SWF::ACTION_CONSTANTPOOL, data);
+    }
+
+    /// Get a variable named by a string.
+    Code& get(const std::string& name) {
+        return str(name).op(SWF::ACTION_GETVARIABLE);
+    }
+
+    /// A DefineFunction of a function taking n.
+    Code& function(const std::string& name, const Code& body) {
+        Bytes data;
+        putString(data, name);
+        put16(data, 1);
+        putString(data, "n");
+        put16(data, body._code.size());
+        op(SWF::ACTION_DEFINEFUNCTION, data);
+        _code.insert(_code.end(), body._code.begin(), body._code.end());
+        return *this;
+    }
+
+    /// A DefineFunction2 of a function taking n in register 1.
+    Code& function2(const std::string& name, std::uint16_t flags,
+            const Code& body) {
+        Bytes data;
+        putString(data, name);
+        put16(data, 1);
+        data.push_back(2);
+        put16(data, flags);
+        data.push_back(1);
+        putString(data, "n");
+        put16(data, body._code.size());
+        op(SWF::ACTION_DEFINEFUNCTION2, data);
+        _code.insert(_code.end(), body._code.begin(), body._code.end());
+        return *this;
+    }
+
+    /// The code as a DoAction tag.
+    Bytes tag() const {
+        Bytes tag;
+        put16(tag, SWF::DOACTION << 6 | 0x3f);
+        put16(tag, _code.size() + 1);
+        put16(tag, 0);
+        tag.insert(tag.end(), _code.begin(), _code.end());
+        tag.push_back(SWF::ACTION_END);
+        return tag;
+    }
+
+private:
+
+    static void put16(Bytes& b, size_t v) {
+        b.push_back(v & 0xff);
+        b.push_back((v >> 8) & 0xff);
+    }
+
+    static void putString(Bytes& b, const std::string& s) {
+        b.insert(b.end(), s.begin(), s.end());
+        b.push_back(0);
+    }
+
+    Bytes _code;
+};
+
+} // anonymous namespace
+
+TRYMAIN(_runtest);
+int
+trymain(int /*argc*/, char** /*argv*/)
+{
+    RunResources ri;
+    const URL url("");
+    ri.setStreamProvider(
+            std::shared_ptr<StreamProvider>(new StreamProvider(url, url)));
+
+    boost::intrusive_ptr<movie_definition> md(new DummyMovieDefinition(ri, 7));
+
+    ManualClock clock;
+    movie_root stage(clock, ri);
+
+    MovieClip::MovieVariables v;
+    stage.init(md.get(), v);
+
+    VM& vm = stage.getVM();
+    Movie& root = stage.getRootMovie();
+    as_object* obj = getObject(&root);
+
+    Code code;
+
+    // return n + 1;
+    code.function("plain", Code().get("n").num(1).op(SWF::ACTION_NEWADD)
+            .op(SWF::ACTION_RETURN));
+
+    // return this;
+    code.function("self", Code().get("this").op(SWF::ACTION_RETURN));
+
+    // return arguments.length;
+    code.function("count", Code().get("arguments").str("length")
+            .op(SWF::ACTION_GETMEMBER).op(SWF::ACTION_RETURN));
+
+    // return eval(n);
+    code.function("lookup", Code().get("n").op(SWF::ACTION_GETVARIABLE)
+            .op(SWF::ACTION_RETURN));
+
+    // var x = n * 2; return x;
+    code.function("local", Code().str("x").get("n").num(2)
+            .op(SWF::ACTION_MULTIPLY).op(SWF::ACTION_VAREQUALS)
+            .get("x").op(SWF::ACTION_RETURN));
+
+    // r = plain(n); return r;
+    code.function("call", Code().str("r").get("n").num(1).str("plain")
+            .op(SWF::ACTION_CALLFUNCTION).op(SWF::ACTION_SETVARIABLE)
+            .get("r").op(SWF::ACTION_RETURN));
+
+    // The name of 'arguments' is a constant.
+    code.function("pooled", Code().pool({ "length", "arguments" })
+            .constant(1).op(SWF::ACTION_GETVARIABLE).constant(0)
+            .op(SWF::ACTION_GETMEMBER).op(SWF::ACTION_RETURN));
+
+    // No flags suppress anything, but only n is used.
+    code.function2("plain2", 0, Code().reg(1).num(1)
+            .op(SWF::ACTION_NEWADD).op(SWF::ACTION_RETURN));
+
+    // No flags suppress 'arguments', which is used.
+    code.function2("count2", 0, Code().get("arguments").str("length")
+            .op(SWF::ACTION_GETMEMBER).op(SWF::ACTION_RETURN));
+
+    const Bytes tag = code.tag();
+    MemoryChannel channel(tag);
+    SWFStream in(&channel);
+    in.open_tag();
+    action_buffer buffer(*md);
+    buffer.read(in, in.get_tag_end_position());
+    in.close_tag();
+
+    as_environment env(vm);
+    env.set_target(&root);
+    env.set_original_target(&root);
+    ActionExec(buffer, env)();
+
+    const int version = vm.getSWFVersion();
+
+    struct Expected {
+        const char* name;
+        int uses;
+    };
+    const Expected expected[] = {
+        { "plain", 0 },
+        { "self", Function::USES_THIS },
+        { "count", Function::USES_ARGUMENTS },
+        { "lookup", Function::USES_ALL },
+        { "local", Function::USES_ACTIVATION },
+        { "call", 0 },
+        { "pooled", Function::USES_ARGUMENTS },
+        { "plain2", 0 },
+        { "count2", Function::USES_ARGUMENTS }
+    };
+
+    for (const Expected& e : expected) {
+        as_value val;
+        obj->get_member(getURI(vm, e.name), &val);
+        const Function* f = dynamic_cast<Function*>(val.to_function());
+        check(f);
+        if (f) check_equals_label(std::string(e.name), f->codeUses(), e.uses);
+    }
+
+    // The variables are there when they are used.
+    check_equals(callMethod(obj, getURI(vm, "plain"), 2.0).to_number(version),
+            3);
+    check_equals(callMethod(obj, getURI(vm, "self"), 2.0).to_object(vm),
+            obj);
+    check_equals(callMethod(obj, getURI(vm, "count"), 2.0, 3.0, 4.0)
+            .to_number(version), 3);
+    check_equals(callMethod(obj, getURI(vm, "local"), 2.0).to_number(version),
+            4);
+    check_equals(callMethod(obj, getURI(vm, "call"), 2.0).to_number(version),
+            3);
+    check_equals(callMethod(obj, getURI(vm, "pooled"), 2.0, 3.0)
+            .to_number(version), 2);
+    check_equals(callMethod(obj, getURI(vm, "plain2"), 2.0)
+            .to_number(version), 3);
+    check_equals(callMethod(obj, getURI(vm, "count2"), 2.0, 3.0)
+            .to_number(version), 2);
+
+    // Names made at runtime find them too.
+    as_value args = callMethod(obj, getURI(vm, "lookup"), "arguments");
+    check(args.is_object());
+    as_value length;
+    if (args.is_object()) {
+        args.to_object(vm)->get_member(getURI(vm, "length"), &length);
+    }
+    check_equals(length.to_number(version), 1);
+
+    // A function running again is given a frame used before.
+    check_equals(callMethod(obj, getURI(vm, "count"), 2.0).to_number(version),
+            1);
+    check(!vm.calling());
+
+    return 0;
+}
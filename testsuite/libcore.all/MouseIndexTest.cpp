@@ -0,0 +1,210 @@
+//
+//   Copyright (C) 2005, 2006, 2007, 2008, 2009, 2010, 2011, 2012
+//   Free Software Foundation, Inc
+//
+// This program is free software; you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation; either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program; if not, write to the Free Software
+// Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+
+#ifdef HAVE_CONFIG_H
+#include "gnashconfig.h"
+#endif
+
+#include "DisplayObject.h"
+#include "DummyMovieDefinition.h"
+#include "InteractiveObject.h"
+#include "ManualClock.h"
+#include "Movie.h"
+#include "RunResources.h"
+#include "SWFMatrix.h"
+#include "StreamProvider.h"
+#include "VM.h"
+#include "log.h"
+#include "movie_root.h"
+
+#include <cstdlib>
+#include <memory>
+#include <sstream>
+#include <vector>
+
+#include "check.h"
+
+using namespace gnash;
+
+namespace {
+
+/// A rectangle hit anywhere within its bounds.
+class Box : public InteractiveObject
+{
+public:
+
+    Box(as_object* object, DisplayObject* parent, const SWFRect& bounds)
+        :
+        InteractiveObject(object, parent),
+        _bounds(bounds)
+    {}
+
+    virtual void display(Renderer&, const Transform&) {}
+
+    virtual SWFRect getBounds() const { return _bounds; }
+
+    virtual bool mouseEnabled() const { return true; }
+
+    virtual void mouseEvent(const event_id&) {}
+
+    virtual InteractiveObject* topmostMouseEntity(std::int32_t x,
+            std::int32_t y) {
+        point p(x, y);
+        SWFMatrix m = getMatrix(*this);
+        m.invert().transform(p);
+        return _bounds.point_test(p.x, p.y) ? this : nullptr;
+    }
+
+    virtual bool pointInShape(std::int32_t x, std::int32_t y) const {
+        point p(x, y);
+        getWorldMatrix(*this).invert().transform(p);
+        return _bounds.point_test(p.x, p.y);
+    }
+
+    void add_invalidated_bounds(InvalidatedRanges&, bool) {}
+
+private:
+    const SWFRect _bounds;
+};
+
+/// The topmost Box hit at a point, looking at all of them.
+InteractiveObject*
+bruteForce(const std::vector<Box*>& boxes, std::int32_t x, std::int32_t y)
+{
+    for (std::vector<Box*>::const_reverse_iterator it = boxes.rbegin(),
+            e = boxes.rend(); it != e; ++it) {
+        if (InteractiveObject* hit = (*it)->topmostMouseEntity(x, y)) {
+            return hit;
+        }
+    }
+    return nullptr;
+}
+
+} // anonymous namespace
+
+TRYMAIN(_runtest);
+int
+trymain(int /*argc*/, char** /*argv*/)
+{
+    RunResources ri;
+    const URL url("");
+    ri.setStreamProvider(
+            std::shared_ptr<StreamProvider>(new StreamProvider(url, url)));
+
+    boost::intrusive_ptr<movie_definition> md(new DummyMovieDefinition(ri, 6));
+
+    ManualClock clock;
+    movie_root stage(clock, ri);
+
+    MovieClip::MovieVariables v;
+    stage.init(md.get(), v);
+
+    MovieClip* root = const_cast<Movie*>(&stage.getRootMovie());
+    Global_as& gl = getGlobal(*getObject(root));
+
+    // Boxes of all sizes, some of them turned.
+    std::srand(1);
+    std::vector<Box*> boxes;
+    for (int i = 0; i < 500; ++i) {
+        const int x = std::rand() % 20000;
+        const int y = std::rand() % 20000;
+        const int w = 20 + std::rand() % 2000;
+        const int h = 20 + std::rand() % 2000;
+        Box* box = new Box(createObject(gl), root, SWFRect(0, 0, w, h));
+        root->attachCharacter(*box, i + 1, nullptr);
+
+        SWFMatrix m;
+        if (i % 5 == 0) m.set_rotation(0.3 * (i % 7));
+        if (i % 3 == 0) m.set_scale(0.5 + (i % 4), 1.5);
+        m.set_translation(x, y);
+        box->setMatrix(m);
+        boxes.push_back(box);
+    }
+
+    int mismatches = 0;
+    int hits = 0;
+    for (int i = 0; i < 5000; ++i) {
+        const int x = std::rand() % 22000;
+        const int y = std::rand() % 22000;
+        InteractiveObject* found = root->topmostMouseEntity(x, y);
+        if (found != bruteForce(boxes, x, y)) ++mismatches;
+        if (found) ++hits;
+    }
+    check_equals(mismatches, 0);
+    check(hits > 1000);
+
+    // Moving a box is seen.
+    Box* last = boxes.back();
+    check(!root->topmostMouseEntity(30010, 30010));
+    SWFMatrix m;
+    m.set_translation(30000, 30000);
+    last->setMatrix(m);
+    check_equals(root->topmostMouseEntity(30010, 30010), last);
+
+    // So is a moved parent.
+    SWFMatrix rm;
+    rm.set_translation(1000, 0);
+    root->setMatrix(rm);
+    check_equals(root->topmostMouseEntity(31010, 30010), last);
+    check(!root->topmostMouseEntity(30010, 30010));
+    root->setMatrix(SWFMatrix());
+
+    // A mask not hit hides what it masks.
+    Box* mask = new Box(createObject(gl), root, SWFRect(0, 0, 100, 100));
+    root->attachCharacter(*mask, 1000, nullptr);
+    m.set_translation(40000, 40000);
+    mask->setMatrix(m);
+    mask->set_clip_depth(1001);
+
+    Box* masked = new Box(createObject(gl), root, SWFRect(0, 0, 1000, 1000));
+    root->attachCharacter(*masked, 1001, nullptr);
+    masked->setMatrix(m);
+
+    check_equals(root->topmostMouseEntity(40050, 40050), masked);
+    check(!root->topmostMouseEntity(40500, 40500));
+
+    // Not once it's no longer a mask.
+    mask->set_clip_depth(DisplayObject::noClipDepthValue);
+    check_equals(root->topmostMouseEntity(40500, 40500), masked);
+
+    // A box moving in a clip is found where it goes, also when the
+    // clip's bounds grow with it.
+    MovieClip* clip = new MovieClip(createObject(gl), nullptr,
+            root->get_root(), root);
+    root->addDisplayListObject(clip, 2000);
+    m.set_translation(50000, 50000);
+    clip->setMatrix(m);
+    Box* still = new Box(createObject(gl), clip, SWFRect(0, 0, 100, 100));
+    clip->attachCharacter(*still, 1, nullptr);
+    Box* moving = new Box(createObject(gl), clip, SWFRect(0, 0, 100, 100));
+    clip->attachCharacter(*moving, 2, nullptr);
+
+    check_equals(root->topmostMouseEntity(50050, 50050), moving);
+    for (int i = 1; i <= 20; ++i) {
+        SWFMatrix bm;
+        bm.set_translation(i * 1000, 0);
+        moving->setMatrix(bm);
+        check_equals(root->topmostMouseEntity(50050 + i * 1000, 50050),
+                moving);
+        InteractiveObject* behind = i == 1 ? still : nullptr;
+        check_equals(root->topmostMouseEntity(50050 + (i - 1) * 1000, 50050),
+                behind);
+    }
+
+    return 0;
+}
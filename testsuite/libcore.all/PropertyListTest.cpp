@@ -26,6 +26,9 @@
 #include "movie_root.h"
 #include "as_object.h" // need to set as owner of PropertyList
 #include "as_value.h"
+#include "Global_as.h"
+#include "as_function.h"
+#include "Relay.h"
 #include "log.h"
 #include "PropFlags.h"
 #include "ManualClock.h"
@@ -35,8 +38,10 @@
 #include <iostream>
 #include <sstream>
 #include <cassert>
+#include <cstdlib>
 #include <string>
 #include <utility> // for make_pair
+#include <vector>
 
 #include "check.h"
 
@@ -45,6 +50,35 @@
 using namespace std;
 using namespace gnash;
 
+/// Records the destruction of its object.
+class DeathFlag : public Relay
+{
+public:
+    explicit DeathFlag(bool& dead) : _dead(dead) {}
+    ~DeathFlag() { _dead = true; }
+private:
+    bool& _dead;
+};
+
+/// Holds a reference of its own, stored without a write barrier.
+class Holder : public as_object
+{
+public:
+    explicit Holder(Global_as& gl) : as_object(gl), held(nullptr) {}
+    as_object* held;
+protected:
+    virtual void markReachableResources() const {
+        if (held) held->setReachable();
+        as_object::markReachableResources();
+    }
+};
+
+as_value
+nothing(const fn_call&)
+{
+    return as_value();
+}
+
 bool
 getVal(PropertyList& p, const ObjectURI& k, as_value& val, as_object& obj)
 {
@@ -65,6 +99,9 @@ trymain(int /*argc*/, char** /*argv*/)
 	gnash::LogFile& dbglogfile = gnash::LogFile::getDefaultInstance();
 	dbglogfile.setVerbosity();
 
+    // Mark as little as possible in each call to the collector.
+    setenv("GNASH_GC_BUDGET", "1", 1);
+
     // We don't care about the base URL.
     RunResources runResources;
     const URL url("");
@@ -203,6 +240,167 @@ trymain(int /*argc*/, char** /*argv*/)
 		check_equals(props.size(), 3);
 
 	}
+
+    // Lists getting the same properties in the same order share a shape,
+    // so a call site cache filled by one finds properties in the other.
+    const ObjectURI& x = getURI(vm, "x");
+    const ObjectURI& y = getURI(vm, "y");
+
+    PropertyList a(*obj);
+    PropertyList b(*obj);
+    check_equals(a.shapeId(), b.shapeId());
+    a.setValue(x, val);
+    a.setValue(y, val2);
+    b.setValue(x, val3);
+    b.setValue(y, val3);
+    check(a.shapeId() != 0);
+    check_equals(a.shapeId(), b.shapeId());
+
+    PropertyCache cache;
+    check_equals(a.getCachedProperty(y, cache), a.getProperty(y));
+    check_equals(cache.misses, 1);
+    check_equals(b.getCachedProperty(y, cache), b.getProperty(y));
+    check_equals(cache.misses, 1);
+    check_equals(b.getCachedProperty(x, cache), b.getProperty(x));
+    check_equals(cache.misses, 2);
+
+    // A different order is a different shape.
+    PropertyList c(*obj);
+    c.setValue(y, val);
+    c.setValue(x, val);
+    check(c.shapeId() != a.shapeId());
+    check_equals(c.getCachedProperty(x, cache), c.getProperty(x));
+    check_equals(cache.misses, 3);
+
+    // Deleting a property drops the shape, and the list isn't cached.
+    check(a.delProperty(x).second);
+    check_equals(a.shapeId(), 0);
+    check(!a.getCachedProperty(y, cache));
+    check(a.getProperty(y));
+
+    // A polymorphic site stops being updated.
+    for (size_t i = 0; i < PropertyCache::maxMisses; ++i) {
+        b.getCachedProperty(i % 2 ? x : y, cache);
+    }
+    check(!cache.active());
+    check(!b.getCachedProperty(cache.name == getName(x) ? y : x, cache));
+
+    // Array elements don't go into the shape, but other properties do.
+    PropertyList d(*obj);
+    d.setValue(x, val);
+    const std::uint64_t xShape = d.shapeId();
+    d.setValue(getURI(vm, "0"), val);
+    d.setValue(getURI(vm, "1"), val);
+    check_equals(d.shapeId(), xShape);
+    d.setValue(y, val);
+    check_equals(d.shapeId(), b.shapeId());
+    PropertyCache cache2;
+    check_equals(d.getCachedProperty(getURI(vm, "1"), cache2),
+            d.getProperty(getURI(vm, "1")));
+    check_equals(cache2.shape, 0);
+    check_equals(d.getCachedProperty(y, cache2), d.getProperty(y));
+    check_equals(cache2.shape, d.shapeId());
+
+    // A list with too many properties is a dictionary without a shape.
+    PropertyList e(*obj);
+    for (size_t i = 0; i < PropertyShape::maxSize; ++i) {
+        e.setValue(getURI(vm, "p" + std::to_string(i)), val);
+    }
+    check(e.shapeId() != 0);
+    e.setValue(getURI(vm, "last"), val);
+    check_equals(e.shapeId(), 0);
+    check(e.getProperty(getURI(vm, "p0")));
+
+    // A long chain of shapes is released without deep recursion.
+    {
+        PropertyShape::Ptr shape = PropertyShape::empty();
+        for (size_t i = 0; i < 200000; ++i) {
+            shape = shape->append(i + 1);
+        }
+        check_equals(shape->size(), 200000);
+    }
+
+    // An object stored in a property while the collector is marking is
+    // kept, even if the property's owner has been scanned already.
+    {
+        Global_as& gl = getGlobal(vm);
+        GC& gc = root.gc();
+        gc.runCycle();
+
+        const ObjectURI next = getURI(vm, "next");
+        const ObjectURI held = getURI(vm, "held");
+
+        // Before the middle are a derived object holding a reference
+        // of its own, and a function.
+        std::vector<as_object*> list;
+        Holder* holder = new Holder(gl);
+        as_function* fn = gl.createFunction(nothing);
+        for (size_t i = 0; i < 5000; ++i) {
+            if (i == 1000) list.push_back(holder);
+            else if (i == 2000) list.push_back(fn);
+            else list.push_back(new as_object(gl));
+            if (i) list[i - 1]->set_member(next, list[i]);
+        }
+        gl.set_member(getURI(vm, "list"), list.front());
+
+        bool movedDead = false;
+        as_object* moved = new as_object(gl);
+        moved->setRelay(new DeathFlag(movedDead));
+        list.back()->set_member(held, moved);
+
+        bool droppedDead = false;
+        as_object* dropped = new as_object(gl);
+        dropped->setRelay(new DeathFlag(droppedDead));
+        list.back()->set_member(getURI(vm, "dropped"), dropped);
+
+        bool heldDead = false;
+        as_object* held2 = new as_object(gl);
+        held2->setRelay(new DeathFlag(heldDead));
+        list.back()->set_member(getURI(vm, "held2"), held2);
+
+        bool calledDead = false;
+        as_object* called = new as_object(gl);
+        called->setRelay(new DeathFlag(calledDead));
+        list.back()->set_member(getURI(vm, "called"), called);
+
+        // Marking goes down the list; stop when it is past the middle.
+        as_object* scanned = list[list.size() / 2];
+        as_object* after = list[list.size() / 2 + 1];
+        for (size_t i = 0; i < 100000 && !after->isReachable(); ++i) {
+            gc.fuzzyCollect();
+        }
+        check(gc.marking());
+
+        scanned->set_member(held, moved);
+        list.back()->set_member(held, as_value());
+        list.back()->delProperty(getURI(vm, "dropped"));
+
+        // The derived object is scanned again, and the function has a
+        // write barrier.
+        check(holder->isReachable());
+        check(fn->isReachable());
+        holder->held = held2;
+        list.back()->delProperty(getURI(vm, "held2"));
+        fn->set_member(held, called);
+        list.back()->delProperty(getURI(vm, "called"));
+
+        // Finish this cycle, and run another.
+        gc.runCycle();
+        check(!movedDead);
+        check(droppedDead);
+        check(!heldDead);
+        check(!calledDead);
+
+        as_value val;
+        check(scanned->get_member(held, &val));
+        check_equals(val.to_object(vm), moved);
+
+        // The flags go before the objects.
+        moved->setRelay(nullptr);
+        held2->setRelay(nullptr);
+        called->setRelay(nullptr);
+    }
+
 	return 0;
 }
 
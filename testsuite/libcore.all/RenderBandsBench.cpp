@@ -0,0 +1,132 @@
+//
+//   Copyright (C) 2005, 2006, 2007, 2008, 2009, 2010, 2011, 2012
+//   Free Software Foundation, Inc
+//
+// This program is free software; you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation; either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program; if not, write to the Free Software
+// Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+
+// This is not a test: it draws frames full of filled and outlined
+// shapes with the AGG renderer, using from one up to the given number
+// of threads, and reports the time a frame takes. Build it with
+// "make RenderBandsBench".
+//
+//	RenderBandsBench [-t threads] [-s shapes] [-f frames]
+
+#ifdef HAVE_CONFIG_H
+#include "gnashconfig.h"
+#endif
+
+#include "FillStyle.h"
+#include "LineStyle.h"
+#include "Renderer_agg.h"
+#include "RGBA.h"
+#include "SWFMatrix.h"
+#include "SWFRect.h"
+#include "ShapeRecord.h"
+#include "Transform.h"
+#include "rc.h"
+
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <memory>
+#include <vector>
+
+using namespace gnash;
+
+namespace {
+
+typedef std::chrono::steady_clock Clock;
+
+const int width = 1280;
+const int height = 720;
+
+/// A curved blob, filled and outlined.
+SWF::ShapeRecord
+blob(const rgba& fill, const rgba& line)
+{
+    SWF::Subshape s;
+    s.addFillStyle(FillStyle(SolidFill(fill)));
+    s.addLineStyle(LineStyle(40, line));
+
+    Path p(0, -1000, 0, 1, 1);
+    p.drawCurveTo(1000, -1000, 1000, 0);
+    p.drawCurveTo(1000, 1000, 0, 1000);
+    p.drawCurveTo(-1000, 1000, -1000, 0);
+    p.drawCurveTo(-1000, -1000, 0, -1000);
+    s.addPath(p);
+
+    SWF::ShapeRecord shape;
+    shape.setBounds(SWFRect(-1000, -1000, 1000, 1000));
+    shape.addSubshape(s);
+    return shape;
+}
+
+/// Draw the frames with the given number of threads and print the time
+/// each takes.
+void
+bench(int threads, const SWF::ShapeRecord& shape,
+        const std::vector<SWFMatrix>& places, size_t frames)
+{
+    RcInitFile::getDefaultInstance().renderThreads(threads);
+    std::unique_ptr<Renderer_agg_base> r(create_Renderer_agg("RGBA32"));
+
+    const size_t stride = width * r->getBytesPerPixel();
+    std::vector<unsigned char> buf(stride * height);
+    r->init_buffer(buf.data(), buf.size(), width, height, stride);
+    r->set_scale(1.0f, 1.0f);
+
+    const Clock::time_point start = Clock::now();
+    for (size_t i = 0; i < frames; ++i) {
+        Renderer::External e(*r, rgba(255, 255, 255, 255));
+        for (const SWFMatrix& m : places) r->drawShape(shape, Transform(m));
+    }
+    const double ms = std::chrono::duration<double, std::milli>(
+            Clock::now() - start).count();
+    std::printf("%2d threads %10.2f ms per frame\n", threads, ms / frames);
+}
+
+} // anonymous namespace
+
+int
+main(int argc, char** argv)
+{
+    int threads = 4;
+    size_t shapes = 2000;
+    size_t frames = 50;
+    for (int i = 1; i + 1 < argc; i += 2) {
+        if (!std::strcmp(argv[i], "-t")) threads = std::atoi(argv[i + 1]);
+        else if (!std::strcmp(argv[i], "-s")) shapes = std::atoi(argv[i + 1]);
+        else if (!std::strcmp(argv[i], "-f")) frames = std::atoi(argv[i + 1]);
+    }
+
+    const SWF::ShapeRecord shape = blob(rgba(200, 40, 40, 160),
+            rgba(0, 0, 120, 255));
+
+    std::srand(1);
+    std::vector<SWFMatrix> places;
+    for (size_t i = 0; i < shapes; ++i) {
+        SWFMatrix m;
+        const double size = 0.05 + (std::rand() % 100) / 100.0;
+        m.set_scale(size, size * (0.5 + (std::rand() % 100) / 100.0));
+        m.set_translation(std::rand() % (width * 20),
+                std::rand() % (height * 20));
+        places.push_back(m);
+    }
+
+    for (int t = 1; t <= threads; t *= 2) bench(t, shape, places, frames);
+
+    return 0;
+}
@@ -0,0 +1,374 @@
+//
+//   Copyright (C) 2005, 2006, 2007, 2008, 2009, 2010, 2011, 2012
+//   Free Software Foundation, Inc
+//
+// This program is free software; you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation; either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program; if not, write to the Free Software
+// Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+
+#ifdef HAVE_CONFIG_H
+#include "gnashconfig.h"
+#endif
+
+#include "CachedBitmap.h"
+#include "DummyMovieDefinition.h"
+#include "FillStyle.h"
+#include "GnashImage.h"
+#include "LineStyle.h"
+#include "Renderer_agg.h"
+#include "RGBA.h"
+#include "SWFMatrix.h"
+#include "SWFRect.h"
+#include "RunResources.h"
+#include "ShapeRecord.h"
+#include "Transform.h"
+#include "log.h"
+#include "rc.h"
+
+#include <algorithm>
+#include <atomic>
+#include <memory>
+#include <sstream>
+#include <thread>
+#include <vector>
+#include <boost/intrusive_ptr.hpp>
+
+#include "check.h"
+
+using namespace gnash;
+
+namespace {
+
+const int width = 317;
+const int height = 241;
+
+/// A star with curved tips, filled and outlined.
+SWF::ShapeRecord
+star(const rgba& fill, const rgba& line, std::uint16_t thickness)
+{
+    SWF::Subshape s;
+    s.addFillStyle(FillStyle(SolidFill(fill)));
+    s.addLineStyle(LineStyle(thickness, line));
+
+    Path p(2000, 200, 0, 1, 1);
+    p.drawCurveTo(2600, 1600, 3800, 1800);
+    p.drawLineTo(2800, 2700);
+    p.drawCurveTo(3300, 3900, 3100, 4600);
+    p.drawLineTo(2000, 3800);
+    p.drawCurveTo(1500, 4000, 900, 4600);
+    p.drawLineTo(1200, 2700);
+    p.drawLineTo(200, 1800);
+    p.drawCurveTo(1000, 1700, 1600, 1600);
+    p.drawLineTo(2000, 200);
+    s.addPath(p);
+
+    SWF::ShapeRecord shape;
+    shape.setBounds(SWFRect(200, 200, 3800, 4600));
+    shape.addSubshape(s);
+    return shape;
+}
+
+/// The bounds of a shape drawn as a mask, or the whole stage.
+SWFRect
+maskBounds(const SWF::ShapeRecord& shape, const SWFMatrix& m, bool tight)
+{
+    if (!tight) return SWFRect(-20000, -20000, 20000, 20000);
+    SWFRect bounds = shape.getBounds();
+    m.transform(bounds);
+    return bounds;
+}
+
+/// Draw the same frame with the given number of threads.
+//
+/// Masks are given the bounds of their shapes if tight, otherwise
+/// bounds larger than the stage.
+std::vector<unsigned char>
+draw(const char* pixelFormat, int threads, image::GnashImage& frame,
+        bool tight = true)
+{
+    RcInitFile::getDefaultInstance().renderThreads(threads);
+    std::unique_ptr<Renderer_agg_base> r(create_Renderer_agg(pixelFormat));
+
+    const size_t stride = width * r->getBytesPerPixel();
+    std::vector<unsigned char> buf(stride * height);
+    r->init_buffer(buf.data(), buf.size(), width, height, stride);
+    r->set_scale(1.0f, 1.0f);
+
+    const SWF::ShapeRecord a = star(rgba(200, 40, 40, 255),
+            rgba(0, 0, 120, 255), 60);
+    const SWF::ShapeRecord b = star(rgba(40, 200, 40, 128),
+            rgba(250, 250, 0, 200), 0);
+
+    std::vector<unsigned char> pixels(frame.begin(), frame.end());
+
+    {
+        Renderer::External e(*r, rgba(255, 255, 255, 255));
+
+        // Plain, turned, and scaled shapes, some of them across every band.
+        r->drawShape(a, Transform());
+        for (int i = 0; i < 6; ++i) {
+            SWFMatrix m;
+            m.set_rotation(0.4 * i);
+            m.set_scale(0.5 + 0.3 * i, 1.3 - 0.15 * i);
+            m.set_translation(400 + 700 * i, 300 + 150 * i);
+            r->drawShape(i % 2 ? a : b, Transform(m));
+        }
+
+        // A video frame, which is changed before the frame is done.
+        SWFMatrix vm;
+        vm.set_rotation(0.2);
+        vm.set_translation(1200, 600);
+        const SWFRect vbounds(0, 0, 2400, 1800);
+        r->drawVideoFrame(&frame, Transform(vm), &vbounds, true);
+        std::fill(frame.begin(), frame.end(), 0);
+
+        // A masked shape.
+        SWFMatrix mm;
+        mm.set_scale(1.4, 1.0);
+        mm.set_translation(500, 200);
+        r->begin_submit_mask(maskBounds(a, mm, tight));
+        r->drawShape(a, Transform(mm));
+        r->end_submit_mask();
+        SWFMatrix sm;
+        sm.set_scale(1.7, 1.1);
+        r->drawShape(b, Transform(sm));
+
+        // A shape under a nested mask, which only partly overlaps it.
+        SWFMatrix nm;
+        nm.set_rotation(0.7);
+        nm.set_translation(3000, -400);
+        r->begin_submit_mask(maskBounds(b, nm, tight));
+        r->drawShape(b, Transform(nm));
+        r->end_submit_mask();
+        r->drawShape(a, Transform(sm));
+        r->disable_mask();
+        r->disable_mask();
+    }
+
+    std::copy(pixels.begin(), pixels.end(), frame.begin());
+    return buf;
+}
+
+/// A movie with one bitmap, counting the lookups made by other threads
+/// than the one which made it.
+class BitmapMovie : public DummyMovieDefinition
+{
+public:
+
+    BitmapMovie(const RunResources& ri, CachedBitmap* bitmap)
+        :
+        DummyMovieDefinition(ri),
+        _bitmap(bitmap),
+        _thread(std::this_thread::get_id()),
+        _offThread(0)
+    {}
+
+    virtual CachedBitmap* getBitmap(int /*id*/) const {
+        if (std::this_thread::get_id() != _thread) ++_offThread;
+        return _bitmap.get();
+    }
+
+    /// The lookups made by other threads.
+    size_t offThread() const {
+        return _offThread;
+    }
+
+private:
+    const boost::intrusive_ptr<CachedBitmap> _bitmap;
+    const std::thread::id _thread;
+    mutable std::atomic<size_t> _offThread;
+};
+
+/// Draw a turned bitmap tiled over the whole stage.
+//
+/// The band threads must not look the bitmap up in the movie.
+std::vector<unsigned char>
+drawBitmap(const char* pixelFormat, int threads,
+        const image::GnashImage& image)
+{
+    RcInitFile::getDefaultInstance().renderThreads(threads);
+    std::unique_ptr<Renderer_agg_base> r(create_Renderer_agg(pixelFormat));
+
+    const size_t stride = width * r->getBytesPerPixel();
+    std::vector<unsigned char> buf(stride * height);
+    r->init_buffer(buf.data(), buf.size(), width, height, stride);
+    r->set_scale(1.0f, 1.0f);
+
+    std::unique_ptr<image::GnashImage> copy(
+            new image::ImageRGB(image.width(), image.height()));
+    std::copy(image.begin(), image.end(), copy->begin());
+
+    RunResources ri;
+    boost::intrusive_ptr<BitmapMovie> md(
+            new BitmapMovie(ri, r->createCachedBitmap(std::move(copy))));
+
+    SWFMatrix fm;
+    fm.set_rotation(0.3);
+    fm.set_scale(30, 30);
+
+    SWF::Subshape s;
+    s.addFillStyle(FillStyle(BitmapFill(SWF::FILL_TILED_BITMAP, md.get(),
+                    1, fm)));
+    Path p(0, 0, 0, 1, 0);
+    p.drawLineTo(width * 20, 0);
+    p.drawLineTo(width * 20, height * 20);
+    p.drawLineTo(0, height * 20);
+    p.drawLineTo(0, 0);
+    s.addPath(p);
+
+    SWF::ShapeRecord shape;
+    shape.setBounds(SWFRect(0, 0, width * 20, height * 20));
+    shape.addSubshape(s);
+
+    {
+        Renderer::External e(*r, rgba(255, 255, 255, 255));
+        r->drawShape(shape, Transform());
+    }
+
+    std::ostringstream label;
+    label << pixelFormat << " bitmap with " << threads << " threads";
+    check_equals_label(label.str(), md->offThread(), 0u);
+    return buf;
+}
+
+/// A rectangle filled with a colour, in whole pixels.
+SWF::ShapeRecord
+rectangle(const rgba& fill, int left, int top, int right, int bottom)
+{
+    SWF::Subshape s;
+    s.addFillStyle(FillStyle(SolidFill(fill)));
+
+    Path p(left * 20, top * 20, 0, 1, 0);
+    p.drawLineTo(right * 20, top * 20);
+    p.drawLineTo(right * 20, bottom * 20);
+    p.drawLineTo(left * 20, bottom * 20);
+    p.drawLineTo(left * 20, top * 20);
+    s.addPath(p);
+
+    SWF::ShapeRecord shape;
+    shape.setBounds(SWFRect(left * 20, top * 20, right * 20, bottom * 20));
+    shape.addSubshape(s);
+    return shape;
+}
+
+/// Check that a mask the size of its rectangle hides exactly the pixels
+/// outside it, which tests where its buffer is placed on the stage.
+void
+checkMaskEdges(int threads)
+{
+    RcInitFile::getDefaultInstance().renderThreads(threads);
+    std::unique_ptr<Renderer_agg_base> r(create_Renderer_agg("RGBA32"));
+
+    const size_t stride = width * r->getBytesPerPixel();
+    std::vector<unsigned char> buf(stride * height);
+    r->init_buffer(buf.data(), buf.size(), width, height, stride);
+    r->set_scale(1.0f, 1.0f);
+
+    const int left = 37, top = 53, right = 211, bottom = 190;
+    const SWF::ShapeRecord mask = rectangle(rgba(0, 0, 0, 255),
+            left, top, right, bottom);
+    const SWF::ShapeRecord fill = rectangle(rgba(255, 0, 0, 255),
+            0, 0, width, height);
+
+    {
+        Renderer::External e(*r, rgba(255, 255, 255, 255));
+        r->begin_submit_mask(mask.getBounds());
+        r->drawShape(mask, Transform());
+        r->end_submit_mask();
+        r->drawShape(fill, Transform());
+        r->disable_mask();
+    }
+
+    // Whether the pixel was drawn, which leaves little green. Pixels
+    // along the far edges are not quite covered after anti-aliasing.
+    auto drawn = [&](int x, int y) {
+        return buf[y * stride + x * 4 + 1] < 128;
+    };
+
+    std::ostringstream label;
+    label << "Mask edges with " << threads << " threads";
+    const std::string l = label.str();
+
+    check_equals_label(l, drawn(left, top), true);
+    check_equals_label(l, drawn(right - 1, bottom - 1), true);
+    check_equals_label(l, drawn(left - 1, top), false);
+    check_equals_label(l, drawn(left, top - 1), false);
+    check_equals_label(l, drawn(right, bottom - 1), false);
+    check_equals_label(l, drawn(right - 1, bottom), false);
+}
+
+} // anonymous namespace
+
+TRYMAIN(_runtest);
+int
+trymain(int /*argc*/, char** /*argv*/)
+{
+    image::ImageRGB frame(64, 48);
+    for (size_t y = 0; y < frame.height(); ++y) {
+        image::GnashImage::iterator row = scanline(frame, y);
+        for (size_t x = 0; x < frame.width() * 3; ++x) {
+            row[x] = (x * 7 + y * 13) & 0xff;
+        }
+    }
+
+    const char* formats[] = { "RGB24", "RGBA32" };
+    for (const char* format : formats) {
+
+        const std::vector<unsigned char> serial = draw(format, 1, frame);
+        check(std::count(serial.begin(), serial.end(), 0xff) !=
+                static_cast<std::ptrdiff_t>(serial.size()));
+
+        // Masks only the size of their shapes hide the same.
+        const std::vector<unsigned char> stage =
+            draw(format, 1, frame, false);
+        check_equals_label(std::string(format), stage.size(), serial.size());
+        if (stage.size() == serial.size()) {
+            const size_t differs = std::mismatch(serial.begin(),
+                    serial.end(), stage.begin()).first - serial.begin();
+            check_equals_label(std::string(format), differs, serial.size());
+        }
+
+        for (int threads = 2; threads <= 7; threads += 5) {
+            const std::vector<unsigned char> bands =
+                draw(format, threads, frame);
+
+            std::ostringstream s;
+            s << format << " with " << threads << " threads";
+            check_equals_label(s.str(), bands.size(), serial.size());
+            if (bands.size() != serial.size()) continue;
+
+            // The offset of the first byte that differs.
+            const size_t differs = std::mismatch(serial.begin(),
+                    serial.end(), bands.begin()).first - serial.begin();
+            check_equals_label(s.str(), differs, serial.size());
+        }
+
+        // A bitmap fill across every band.
+        const std::vector<unsigned char> bitmap =
+            drawBitmap(format, 1, frame);
+        const std::vector<unsigned char> bitmapBands =
+            drawBitmap(format, 4, frame);
+        check_equals_label(std::string(format), bitmapBands.size(),
+                bitmap.size());
+        if (bitmapBands.size() == bitmap.size()) {
+            const size_t differs = std::mismatch(bitmap.begin(),
+                    bitmap.end(), bitmapBands.begin()).first - bitmap.begin();
+            check_equals_label(std::string(format), differs, bitmap.size());
+        }
+    }
+
+    checkMaskEdges(1);
+    checkMaskEdges(3);
+
+    return 0;
+}
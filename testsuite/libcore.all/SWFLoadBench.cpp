@@ -0,0 +1,336 @@
+// SWFLoadBench.cpp: timing of the SWF loader thread.
+//
+//   Copyright (C) 2005, 2006, 2007, 2008, 2009, 2010, 2011, 2012
+//   Free Software Foundation, Inc
+//
+// This program is free software; you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation; either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program; if not, write to the Free Software
+// Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+
+// This is not a test: it loads each SWF given on the command line, or
+// a generated one made of large shapes and bitmaps, and reports how
+// fast the loader thread parses it, how long it takes to reach the
+// first frame, and how long until every bitmap is decoded. Build it
+// with "make SWFLoadBench".
+//
+//	SWFLoadBench [-n iterations] [file.swf ...]
+
+#ifdef HAVE_CONFIG_H
+#include "gnashconfig.h"
+#endif
+
+#include "MovieFactory.h"
+#include "movie_definition.h"
+#include "DefaultTagLoaders.h"
+#include "RunResources.h"
+#include "StreamProvider.h"
+#include "SWF.h"
+#include "TagLoadersTable.h"
+#include "GnashException.h"
+#include "tu_file.h"
+#include "IOChannel.h"
+#include "URL.h"
+#include "log.h"
+#include "BitmapCache.h"
+#include "DummyRenderer.h"
+
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <zlib.h>
+#include <iostream>
+#include <memory>
+#include <string>
+#include <vector>
+
+using namespace gnash;
+
+namespace {
+
+typedef std::chrono::steady_clock Clock;
+
+double
+msSince(Clock::time_point start)
+{
+    return std::chrono::duration<double, std::milli>(Clock::now() - start)
+        .count();
+}
+
+/// Writes SWF bit fields, most significant bit first.
+class BitWriter
+{
+public:
+    explicit BitWriter(std::vector<std::uint8_t>& out)
+        :
+        _out(out),
+        _count(0)
+    {}
+
+    void write(std::uint32_t value, unsigned bits) {
+        while (bits--) {
+            if (!_count) _out.push_back(0);
+            if (value & (1u << bits)) _out.back() |= 0x80 >> _count;
+            _count = (_count + 1) & 7;
+        }
+    }
+
+    void align() { _count = 0; }
+
+    void u8(std::uint8_t v) { align(); _out.push_back(v); }
+    void u16(std::uint16_t v) { u8(v & 0xff); u8(v >> 8); }
+    void u32(std::uint32_t v) { u16(v & 0xffff); u16(v >> 16); }
+
+private:
+    std::vector<std::uint8_t>& _out;
+    unsigned _count;
+};
+
+void
+writeTagHeader(std::vector<std::uint8_t>& swf, SWF::TagType type,
+        std::uint32_t length)
+{
+    BitWriter w(swf);
+    w.u16((type << 6) | 0x3f);
+    w.u32(length);
+}
+
+/// A DefineShape3 with one fill and one line style and many edges.
+void
+writeShape(std::vector<std::uint8_t>& swf, int id, int edges)
+{
+    std::vector<std::uint8_t> body;
+    BitWriter w(body);
+    w.u16(id);
+
+    // Bounds.
+    w.write(15, 5);
+    w.write(0, 15);
+    w.write(10000, 15);
+    w.write(0, 15);
+    w.write(10000, 15);
+
+    w.u8(1);
+    w.u8(0x00);
+    w.u32(0xff0000ff);
+    w.u8(1);
+    w.u16(20);
+    w.u32(0x000000ff);
+
+    w.align();
+    w.write(1, 4);
+    w.write(1, 4);
+
+    // Move to the start with the styles.
+    w.write(0, 1);
+    w.write(0x0d, 5);
+    w.write(14, 5);
+    w.write(5000, 14);
+    w.write(5000, 14);
+    w.write(1, 1);
+    w.write(1, 1);
+
+    // A zigzag of general lines.
+    for (int i = 0; i < edges; ++i) {
+        const int dx = (i % 7) * 13 - 40;
+        const int dy = (i & 1) ? 35 : -35;
+        w.write(1, 1);
+        w.write(1, 1);
+        w.write(8 - 2, 4);
+        w.write(1, 1);
+        w.write(dx & 0xff, 8);
+        w.write(dy & 0xff, 8);
+    }
+    w.write(0, 6);
+
+    writeTagHeader(swf, SWF::DEFINESHAPE3, body.size());
+    swf.insert(swf.end(), body.begin(), body.end());
+}
+
+/// A DefineBitsLossless2 of a noisy 512x512 image.
+void
+writeBitmap(std::vector<std::uint8_t>& swf, int id)
+{
+    const size_t side = 512;
+    std::vector<std::uint8_t> argb(side * side * 4);
+    std::uint32_t seed = id;
+    for (size_t i = 0; i < argb.size(); i += 4) {
+        seed = seed * 1103515245 + 12345;
+        argb[i] = 0xff;
+        argb[i + 1] = (i / 4 % side) ^ (seed >> 24);
+        argb[i + 2] = i / 4 / side;
+        argb[i + 3] = seed >> 16;
+    }
+    uLongf size = compressBound(argb.size());
+    std::vector<std::uint8_t> z(size);
+    compress(&z[0], &size, &argb[0], argb.size());
+
+    writeTagHeader(swf, SWF::DEFINELOSSLESS2, 7 + size);
+    BitWriter w(swf);
+    w.u16(id);
+    w.u8(5);
+    w.u16(side);
+    w.u16(side);
+    swf.insert(swf.end(), z.begin(), z.begin() + size);
+}
+
+/// Writes an uncompressed SWF to a temporary file: a first frame with
+/// a shape, and a second with large shapes and bitmaps.
+std::string
+writeCorpus()
+{
+    std::vector<std::uint8_t> swf;
+    BitWriter w(swf);
+    w.u8('F');
+    w.u8('W');
+    w.u8('S');
+    w.u8(8);
+    w.u32(0);
+
+    w.write(15, 5);
+    w.write(0, 15);
+    w.write(11000, 15);
+    w.write(0, 15);
+    w.write(8000, 15);
+    w.u16(12 << 8);
+    w.u16(2);
+
+    writeShape(swf, 1, 100);
+    for (int i = 2; i <= 41; ++i) {
+        writeBitmap(swf, i);
+    }
+    writeTagHeader(swf, SWF::SHOWFRAME, 0);
+    for (int i = 42; i <= 241; ++i) {
+        writeShape(swf, i, 5000);
+    }
+    writeTagHeader(swf, SWF::SHOWFRAME, 0);
+    writeTagHeader(swf, SWF::END, 0);
+
+    const std::uint32_t size = swf.size();
+    std::memcpy(&swf[4], &size, 4);
+
+    char name[] = "/tmp/SWFLoadBenchXXXXXX";
+    const int fd = mkstemp(name);
+    if (fd < 0) return std::string();
+    FILE* f = fdopen(fd, "wb");
+    std::fwrite(swf.data(), 1, swf.size(), f);
+    std::fclose(f);
+    return name;
+}
+
+bool
+load(const std::string& file, int iterations,
+        std::shared_ptr<SWF::TagLoadersTable> loaders)
+{
+    RunResources r;
+    r.setTagLoaders(loaders);
+    r.setRenderer(std::make_shared<DummyRenderer>());
+    r.setStreamProvider(std::make_shared<StreamProvider>(URL(file),
+                URL(file)));
+
+    double first = 0;
+    double loaded = 0;
+    double decoded = 0;
+    size_t bytes = 0;
+    size_t frames = 0;
+    size_t bitmaps = 0;
+    size_t kept = 0;
+    size_t trimmed = 0;
+    for (int i = 0; i < iterations; ++i) {
+        std::unique_ptr<IOChannel> in(makeFileChannel(file.c_str(), "rb"));
+        if (!in) {
+            std::cerr << file << ": can't open" << std::endl;
+            return false;
+        }
+        const Clock::time_point start = Clock::now();
+        boost::intrusive_ptr<movie_definition> md;
+        try {
+            md = MovieFactory::makeMovie(std::move(in), file, r, false);
+        }
+        catch (const GnashException& e) {
+            std::cerr << file << ": " << e.what() << std::endl;
+        }
+        if (!md) {
+            std::cerr << file << ": can't load" << std::endl;
+            return false;
+        }
+        md->completeLoad();
+        md->ensure_frame_loaded(1);
+        first += msSince(start);
+        md->ensure_frame_loaded(md->get_frame_count());
+        loaded += msSince(start);
+
+        // Wait for every bitmap.
+        bitmaps = 0;
+        for (int id = 1; id < 65536; ++id) {
+            bitmaps += md->getBitmap(id) != nullptr;
+        }
+        decoded += msSince(start);
+
+        BitmapCache& cache = BitmapCache::getDefaultInstance();
+        kept = cache.bytes();
+        cache.trim();
+        trimmed = cache.bytes();
+
+        bytes = md->get_bytes_total();
+        frames = md->get_loading_frame();
+    }
+    std::cout << file << ": " << bytes << " bytes, " << frames
+              << " frames, " << bitmaps << " bitmaps" << std::endl
+              << "  first frame " << first / iterations << " ms, loaded "
+              << loaded / iterations << " ms ("
+              << bytes * iterations / loaded * 1000 / (1024 * 1024)
+              << " MB/s), bitmaps decoded " << decoded / iterations
+              << " ms" << std::endl
+              << "  decoded bitmaps " << kept / 1024 << " KB, "
+              << trimmed / 1024 << " KB after trimming" << std::endl;
+    return true;
+}
+
+} // anonymous namespace
+
+int
+main(int argc, char* argv[])
+{
+    int iterations = 5;
+    std::vector<std::string> files;
+    for (int i = 1; i < argc; ++i) {
+        if (!std::strcmp(argv[i], "-n") && i + 1 < argc) {
+            iterations = std::atoi(argv[++i]);
+        }
+        else files.push_back(argv[i]);
+    }
+
+    LogFile::getDefaultInstance().setVerbosity(0);
+
+    std::string corpus;
+    if (files.empty()) {
+        corpus = writeCorpus();
+        if (corpus.empty()) return EXIT_FAILURE;
+        files.push_back(corpus);
+    }
+
+    std::shared_ptr<SWF::TagLoadersTable> loaders(
+        std::make_shared<SWF::TagLoadersTable>());
+    addDefaultLoaders(*loaders);
+
+    bool ok = true;
+    for (const std::string& file : files) {
+        ok = load(file, iterations, loaders) && ok;
+    }
+
+    if (!corpus.empty()) std::remove(corpus.c_str());
+    MovieFactory::clear();
+    return ok ? EXIT_SUCCESS : EXIT_FAILURE;
+}
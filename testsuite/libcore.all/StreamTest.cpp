@@ -35,6 +35,8 @@
 #include <cstdio>
 #include <iostream>
 #include <cassert>
+#include <vector>
+#include <algorithm>
 
 #include "GnashSystemIOHeaders.h"
 #include <sys/types.h>
@@ -104,6 +106,63 @@ struct ByteReader : public IOChannel
 	
 };
 
+/// Reads SWF data held in memory.
+struct MemoryReader : public IOChannel
+{
+	std::vector<unsigned char> data;
+	size_t pos;
+
+	MemoryReader()
+		:
+		pos(0)
+	{}
+
+	std::streamsize read(void* dst, std::streamsize bytes)
+	{
+		bytes = std::min<std::streamsize>(bytes, data.size() - pos);
+		memcpy(dst, &data[pos], bytes);
+		pos += bytes;
+		return bytes;
+	}
+
+	std::streampos tell() const
+	{
+		return pos;
+	}
+
+	bool seek(std::streampos newPos)
+	{
+		if (newPos > static_cast<std::streampos>(data.size())) return false;
+		pos = newPos;
+		return true;
+	}
+
+	void go_to_end() { pos = data.size(); }
+
+	bool eof() const { return pos == data.size(); }
+
+	bool bad() const { return false; }
+
+	size_t size() const { return data.size(); }
+
+	void u8(unsigned char b) { data.push_back(b); }
+	void u16(unsigned v) { u8(v & 0xff); u8(v >> 8); }
+	void u32(unsigned v) { u16(v & 0xffff); u16(v >> 16); }
+};
+
+/// Whether reading a byte throws a ParserException.
+bool
+readFails(SWFStream& s)
+{
+	try {
+		s.read_u8();
+	}
+	catch (const ParserException&) {
+		return true;
+	}
+	return false;
+}
+
 TRYMAIN(_runtest);
 int
 trymain(int /*argc*/, char** /*argv*/)
@@ -480,6 +539,112 @@ trymain(int /*argc*/, char** /*argv*/)
 
 	}
 
+	// Reading inside tags.
+	{
+	MemoryReader mr;
+	mr.u16((39 << 6) | 0x3f);	// long header
+	mr.u32(14);
+	mr.u16(0x1234);			// 6
+	mr.u8(0xab);			// 8
+	mr.u8(0xcd);
+	mr.u8(0xef);
+	mr.u16((1 << 6) | 3);		// 11, short header
+	mr.u8(1);			// 13
+	mr.u8(2);
+	mr.u8(3);
+	mr.u32(0xdeadbeef);		// 16
+	mr.u16(0);			// 20
+
+	SWFStream s(&mr);
+	check_equals(s.open_tag(), 39);
+	check_equals(s.tell(), 6);
+	check_equals(s.get_tag_end_position(), 20);
+	check_equals(s.read_u16(), 0x1234);
+	check_equals(s.tell(), 8);
+
+	check_equals(s.read_uint(4), 0xa);
+	check_equals(s.tell(), 9);
+	check_equals(s.read_uint(8), 0xbc);
+	check_equals(s.tell(), 10);
+	check_equals(s.read_bit(), true);
+	check_equals(s.tell(), 10);
+	s.ensureBits(83);
+	bool threw = false;
+	try { s.ensureBits(84); }
+	catch (const ParserException&) { threw = true; }
+	check(threw);
+	s.align();
+	check_equals(s.tell(), 10);
+	check_equals(s.read_u8(), 0xef);
+
+	check_equals(s.open_tag(), 1);
+	check_equals(s.tell(), 13);
+	check_equals(s.get_tag_end_position(), 16);
+	check_equals(s.read_u8(), 1);
+	check(s.seek(15));
+	check_equals(s.read_u8(), 3);
+	check(readFails(s));
+	check(!s.seek(17));
+	s.close_tag();
+	check_equals(s.tell(), 16);
+
+	check_equals(s.read_u32(), 0xdeadbeef);
+	check_equals(s.tell(), 20);
+	check(readFails(s));
+
+	check(s.seek(8));
+	check_equals(s.read_uint(16), 0xabcd);
+	check_equals(s.tell(), 10);
+	check(!s.seek(21));
+
+	s.close_tag();
+	check_equals(s.tell(), 20);
+	check_equals(s.open_tag(), 0);
+	s.close_tag();
+	}
+
+	// Tags larger than the block.
+	{
+	const size_t len = 300000;
+	MemoryReader mr;
+	mr.u16((2 << 6) | 0x3f);
+	mr.u32(len);
+	for (size_t i = 0; i < len; ++i) mr.u8(i % 251);
+
+	SWFStream s(&mr);
+	check_equals(s.open_tag(), 2);
+	bool same = true;
+	for (size_t i = 0; i < 100000; ++i) {
+		same = same && s.read_u8() == i % 251;
+	}
+	check(same);
+	check_equals(s.tell(), 100006);
+
+	// Bits across the end of the block.
+	check(s.seek(6 + 65530));
+	for (size_t i = 65530; i < 65550; ++i) {
+		same = same && s.read_uint(4) == (i % 251) >> 4;
+		same = same && s.read_uint(4) == ((i % 251) & 0xf);
+	}
+	check(same);
+
+	std::vector<char> buf(150000);
+	check(s.seek(6 + 1000));
+	check_equals(s.read(&buf[0], buf.size()), buf.size());
+	for (size_t i = 0; i < buf.size(); ++i) {
+		same = same && static_cast<unsigned char>(buf[i]) ==
+			(i + 1000) % 251;
+	}
+	check(same);
+	check_equals(s.tell(), 6 + 1000 + buf.size());
+	check_equals(s.read_u8(), (1000 + buf.size()) % 251);
+
+	check(s.seek(6 + len - 2));
+	check_equals(s.read(&buf[0], 10), 2);
+	s.close_tag();
+	check_equals(s.tell(), 6 + len);
+	}
+
 	return 0;
 }
 
@@ -0,0 +1,309 @@
+//
+//   Copyright (C) 2005, 2006, 2007, 2008, 2009, 2010, 2011, 2012
+//   Free Software Foundation, Inc
+//
+// This program is free software; you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation; either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program; if not, write to the Free Software
+// Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+
+#ifdef HAVE_CONFIG_H
+#include "gnashconfig.h"
+#endif
+
+#include "action_buffer.h"
+#include "ActionExec.h"
+#include "as_environment.h"
+#include "as_object.h"
+#include "as_value.h"
+#include "ConstantPool.h"
+#include "DummyMovieDefinition.h"
+#include "Global_as.h"
+#include "IOChannel.h"
+#include "ManualClock.h"
+#include "Movie.h"
+#include "movie_root.h"
+#include "RunResources.h"
+#include "StreamProvider.h"
+#include "SWF.h"
+#include "SWFStream.h"
+#include "VM.h"
+
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+#include <memory>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include "check.h"
+
+using namespace gnash;
+
+namespace {
+
+typedef std::vector<std::uint8_t> Bytes;
+
+/// Reads bytes held in memory.
+class MemoryChannel : public IOChannel
+{
+public:
+    explicit MemoryChannel(const Bytes& data)
+        :
+        _data(data),
+        _pos(0)
+    {}
+
+    std::streamsize read(void* dst, std::streamsize bytes) {
+        bytes = std::min<std::streamsize>(bytes, _data.size() - _pos);
+        std::memcpy(dst, &_data[_pos], bytes);
+        _pos += bytes;
+        return bytes;
+    }
+    std::streampos tell() const { return _pos; }
+    bool seek(std::streampos pos) {
+        if (pos > static_cast<std::streampos>(_data.size())) return false;
+        _pos = pos;
+        return true;
+    }
+    void go_to_end() { _pos = _data.size(); }
+    bool eof() const { return _pos == _data.size(); }
+    bool bad() const { return false; }
+
+private:
+    const Bytes& _data;
+    size_t _pos;
+};
+
+/// Assembles action code.
+class Code
+{
+public:
+
+    Code& op(std::uint8_t id, const Bytes& data = Bytes()) {
+        _code.push_back(id);
+        if (id & 0x80) {
+            put16(_code, data.size());
+            _code.insert(_code.end(), data.begin(), data.end());
+        }
+        return *this;
+    }
+
+    Code& num(std::int32_t i) {
+        Bytes data(1, 7);
+        for (size_t n = 0; n < 4; ++n) data.push_back((i >> (8 * n)) & 0xff);
+        return op(SWF::ACTION_PUSHDATA, data);
+    }
+
+    Code& constant(std::uint8_t c) {
+        Bytes data(1, 8);
+        data.push_back(c);
+        return op(SWF::ACTION_PUSHDATA, data);
+    }
+
+    Code& pool(const std::vector<std::string>& strings) {
+        Bytes data;
+        put16(data, strings.size());
+        for (const std::string& s : strings) putString(data, s);
+        return op(SWF::ACTION_CONSTANTPOOL, data);
+    }
+
+    /// Set the variable named by a constant to a number.
+    Code& set(std::uint8_t c, std::int32_t i) {
+        return constant(c).num(i).op(SWF::ACTION_SETVARIABLE);
+    }
+
+    /// Set the variable named by a constant to another variable.
+    Code& copy(std::uint8_t to, std::uint8_t from) {
+        return constant(to).constant(from).op(SWF::ACTION_GETVARIABLE)
+            .op(SWF::ACTION_SETVARIABLE);
+    }
+
+    /// The code as a DoAction tag.
+    Bytes tag() const {
+        Bytes tag;
+        put16(tag, SWF::DOACTION << 6 | 0x3f);
+        put16(tag, _code.size() + 1);
+        put16(tag, 0);
+        tag.insert(tag.end(), _code.begin(), _code.end());
+        tag.push_back(SWF::ACTION_END);
+        return tag;
+    }
+
+private:
+
+    static void put16(Bytes& b, size_t v) {
+        b.push_back(v & 0xff);
+        b.push_back((v >> 8) & 0xff);
+    }
+
+    static void putString(Bytes& b, const std::string& s) {
+        b.insert(b.end(), s.begin(), s.end());
+        b.push_back(0);
+    }
+
+    Bytes _code;
+};
+
+double
+member(VM& vm, as_object& obj, const std::string& name)
+{
+    as_value val;
+    obj.get_member(getURI(vm, name), &val);
+    return val.to_number(vm.getSWFVersion());
+}
+
+} // anonymous namespace
+
+TRYMAIN(_runtest);
+int
+trymain(int /*argc*/, char** /*argv*/)
+{
+    RunResources ri;
+    const URL url("");
+    ri.setStreamProvider(
+            std::shared_ptr<StreamProvider>(new StreamProvider(url, url)));
+
+    boost::intrusive_ptr<movie_definition> md(new DummyMovieDefinition(ri, 7));
+
+    ManualClock clock;
+    movie_root stage(clock, ri);
+
+    MovieClip::MovieVariables v;
+    stage.init(md.get(), v);
+
+    VM& vm = stage.getVM();
+    Movie& root = stage.getRootMovie();
+    as_object* obj = getObject(&root);
+
+    // Names are split into a target path and a member.
+    struct Parsed {
+        const char* name;
+        VariableName::Kind kind;
+        const char* path;
+        const char* member;
+    };
+    const Parsed parsed[] = {
+        { "a", VariableName::RAW, "", "" },
+        { "a.b", VariableName::MEMBER, "a", "b" },
+        { "_root.a.b", VariableName::MEMBER, "_root.a", "b" },
+        { "a:b", VariableName::MEMBER, "a", "b" },
+        { "/a/b:c", VariableName::MEMBER, "/a/b", "c" },
+        { "/:c", VariableName::MEMBER, "/", "c" },
+        { "/a/b", VariableName::SLASH_PATH, "/a/b", "" },
+        { "a/b", VariableName::SLASH_PATH, "a/b", "" }
+    };
+
+    for (const Parsed& p : parsed) {
+        const VariableName name(vm, p.name);
+        const std::string label(p.name);
+        check_equals_label(label, name.str(), p.name);
+        check_equals_label(label, name.kind(), p.kind);
+        check_equals_label(label, name.path().str(), p.path);
+        if (name.kind() == VariableName::MEMBER) {
+            check_equals_label(label, toString(vm, name.member()), p.member);
+        }
+    }
+
+    // A name is parsed once, and kept while it is used.
+    std::shared_ptr<const VariableName> dropped = vm.variableName("dropped");
+    std::shared_ptr<const VariableName> kept = vm.variableName("kept");
+    check_equals(vm.variableName("kept"), kept);
+
+    // Each turnover of the cache keeps the names used since the last,
+    // so only a name unused for two of them is parsed again. This is
+    // more names than two turnovers take.
+    for (size_t i = 0; i < 3 * 4096; ++i) {
+        std::ostringstream s;
+        s << "name" << i;
+        vm.variableName(s.str());
+        if (i % 100 == 0) vm.variableName("kept");
+    }
+    check_equals(vm.variableName("kept"), kept);
+    check(vm.variableName("dropped") != dropped);
+
+    // A pool entry is parsed for the values pushed from it, while other
+    // strings with the same text are not known to come from it.
+    ConstantPool pool;
+    pool.push_back("a.b");
+    pool.push_back("not a name");
+    pool.push_back("/a/b:c");
+
+    const VariableName* pooled = pool.variableName(vm, as_value(pool[0]));
+    check(pooled);
+    if (pooled) {
+        check_equals(pooled->str(), "a.b");
+        check_equals(pooled->kind(), VariableName::MEMBER);
+    }
+    check_equals(pool.variableName(vm, as_value(pool[0])), pooled);
+    check(!pool.variableName(vm, as_value(std::string("a.b"))));
+    check(!pool.variableName(vm, as_value(2.0)));
+
+    const VariableName* text = pool.variableName(vm, as_value(pool[1]));
+    check(text);
+    if (text) check_equals(text->kind(), VariableName::RAW);
+
+    // Interned names are the same in every pool.
+    ConstantPool other;
+    other.push_back("/a/b:c");
+    const VariableName* path = pool.variableName(vm, as_value(other[0]));
+    check(!path);
+    check(pool[2].interned());
+    path = pool.variableName(vm, as_value(other[0]));
+    check(path);
+    if (path) check_equals(path->path().str(), "/a/b");
+
+    // Variables named by constants are found with their parsed names.
+    as_object* o = createObject(getGlobal(*obj));
+    obj->set_member(getURI(vm, "o"), o);
+
+    Code code;
+    code.pool({ "o.a", "o:b", "/o:c", "/:d", "e", "f", "g" })
+        .set(0, 1)
+        .set(1, 2)
+        .set(2, 3)
+        .set(3, 4)
+        .copy(4, 0)
+        .copy(5, 1)
+        .copy(6, 2);
+
+    const Bytes tag = code.tag();
+    MemoryChannel channel(tag);
+    SWFStream in(&channel);
+    in.open_tag();
+    action_buffer buffer(*md);
+    buffer.read(in, in.get_tag_end_position());
+    in.close_tag();
+
+    as_environment env(vm);
+    env.set_target(&root);
+    env.set_original_target(&root);
+
+    // The second run uses the names parsed by the first.
+    for (size_t run = 0; run < 2; ++run) {
+        ActionExec(buffer, env)();
+
+        check_equals(member(vm, *o, "a"), 1);
+        check_equals(member(vm, *o, "b"), 2);
+        check_equals(member(vm, *o, "c"), 3);
+        check_equals(member(vm, *obj, "d"), 4);
+        check_equals(member(vm, *obj, "e"), 1);
+        check_equals(member(vm, *obj, "f"), 2);
+        check_equals(member(vm, *obj, "g"), 3);
+
+        o->set_member(getURI(vm, "a"), as_value());
+    }
+
+    return 0;
+}
+
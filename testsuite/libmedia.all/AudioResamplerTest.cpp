@@ -0,0 +1,185 @@
+//
+//   Copyright (C) 2005, 2006, 2007, 2008, 2009, 2010, 2011, 2012
+//   Free Software Foundation, Inc
+//
+// This program is free software; you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation; either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program; if not, write to the Free Software
+// Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+
+#ifdef HAVE_CONFIG_H
+#include "gnashconfig.h"
+#endif
+
+#include "AudioResampler.h"
+#include "log.h"
+
+#include <cmath>
+#include <cstdint>
+#include <cstdlib>
+#include <vector>
+
+#include "check.h"
+
+using namespace gnash;
+using namespace gnash::media;
+
+namespace {
+
+/// Resample all input in blocks of the given number of frames.
+std::vector<std::int16_t>
+resample(AudioResampler& r, const std::vector<std::int16_t>& in,
+        bool stereo, size_t block)
+{
+    const size_t channels = stereo ? 2 : 1;
+    const size_t frames = in.size() / channels;
+    std::vector<std::int16_t> out;
+    std::vector<std::int16_t> buf;
+    for (size_t i = 0; i < frames; i += block) {
+        const size_t n = std::min(block, frames - i);
+        buf.resize(r.maxOutput(n) * 2);
+        const size_t wrote = r.process(&in[i * channels], n, &buf[0]);
+        out.insert(out.end(), buf.begin(), buf.begin() + wrote * 2);
+    }
+    return out;
+}
+
+std::vector<std::int16_t>
+tone(double freq, double rate, size_t frames)
+{
+    std::vector<std::int16_t> samples(frames);
+    for (size_t i = 0; i < frames; ++i) {
+        samples[i] = 10000 * std::sin(2 * M_PI * freq * i / rate);
+    }
+    return samples;
+}
+
+/// The RMS difference between the left channel of output at 44100 Hz
+/// and a tone, ignoring the first samples that the filter delays.
+double
+error(const std::vector<std::int16_t>& out, double freq, size_t delay)
+{
+    double sum = 0;
+    size_t n = 0;
+    for (size_t i = 200; i < out.size() / 2 - 200; ++i, ++n) {
+        const double expected =
+            10000 * std::sin(2 * M_PI * freq * (double(i) - delay) / 44100);
+        const double d = out[i * 2] - expected;
+        sum += d * d;
+    }
+    return std::sqrt(sum / n);
+}
+
+}
+
+TRYMAIN(_runtest);
+int
+trymain(int /*argc*/, char** /*argv*/)
+{
+    LogFile& lgf = LogFile::getDefaultInstance();
+    lgf.setVerbosity(1);
+
+    // Nothing changes at the output format.
+    {
+        std::vector<std::int16_t> in(200);
+        for (size_t i = 0; i < in.size(); ++i) in[i] = std::rand() % 65536;
+        AudioResampler r(44100, true, 44100, true);
+        check_equals(r.maxOutput(100), 100);
+        std::vector<std::int16_t> out(200);
+        check_equals(r.process(&in[0], 100, &out[0]), 100);
+        check(in == out);
+    }
+
+    // Flash rates give exact multiples of their input.
+    {
+        const std::vector<std::int16_t> in = tone(440, 11025, 11025);
+        AudioResampler r(11025, false, 44100, true,
+                AudioResampler::QUALITY_FAST);
+        const std::vector<std::int16_t> out = resample(r, in, false, 1000);
+        check_equals(out.size(), 11025u * 4 * 2);
+
+        bool sameChannels = true;
+        for (size_t i = 0; i < out.size(); i += 2) {
+            if (out[i] != out[i + 1]) sameChannels = false;
+        }
+        check(sameChannels);
+    }
+
+    // Blocks of any size give the same output.
+    for (int q = 0; q <= 2; ++q) {
+        const AudioResampler::Quality quality =
+            static_cast<AudioResampler::Quality>(q);
+        std::vector<std::int16_t> in(4000);
+        for (size_t i = 0; i < in.size(); ++i) {
+            in[i] = 8000 * std::sin(i * 0.05) + (i % 2 ? 3000 : -3000);
+        }
+        AudioResampler whole(16000, true, 44100, true, quality);
+        AudioResampler blocks(16000, true, 44100, true, quality);
+        check(resample(whole, in, true, 2000) ==
+                resample(blocks, in, true, 7));
+    }
+
+    // Speex sounds resample 16000 Hz to 44100 Hz, an uneven ratio.
+    // A tone comes out at the same pitch, delayed by half the filter.
+    {
+        const std::vector<std::int16_t> in = tone(1000, 16000, 8000);
+        AudioResampler r(16000, false, 44100, true,
+                AudioResampler::QUALITY_MEDIUM);
+        const std::vector<std::int16_t> out = resample(r, in, false, 320);
+        check_equals(out.size(), 22050u * 2);
+
+        double best = 1e9;
+        for (size_t delay = 0; delay < 60; ++delay) {
+            best = std::min(best, error(out, 1000, delay));
+        }
+        check(best < 200);
+    }
+
+    // A constant level stays constant, after the filter delay.
+    {
+        std::vector<std::int16_t> in(2000, 12345);
+        AudioResampler r(22050, false, 44100, false,
+                AudioResampler::QUALITY_BEST);
+        std::vector<std::int16_t> out(r.maxOutput(in.size()));
+        const size_t n = r.process(&in[0], in.size(), &out[0]);
+        check_equals(n, 4000u);
+        check_equals(out[n - 1], 12345);
+        check_equals(out[n / 2], 12345);
+
+        // A new sound starts from silence.
+        r.reset();
+        r.process(&in[0], 1, &out[0]);
+        check(out[0] < 12345);
+    }
+
+    // Stereo to mono averages the channels.
+    {
+        const std::int16_t in[4] = { 1000, 3000, -1000, -3000 };
+        std::int16_t out[2];
+        AudioResampler r(44100, true, 44100, false);
+        check_equals(r.process(in, 2, out), 2);
+        check_equals(out[0], 2000);
+        check_equals(out[1], -2000);
+    }
+
+    // Rates without a small ratio are approximated.
+    {
+        std::vector<std::int16_t> in(44099, 100);
+        AudioResampler r(44099, false, 44100, false);
+        std::vector<std::int16_t> out(r.maxOutput(in.size()));
+        const size_t n = r.process(&in[0], in.size(), &out[0]);
+        check(n >= 44098 && n <= 44101);
+        check_equals(out[n - 1], 100);
+    }
+
+    return 0;
+}
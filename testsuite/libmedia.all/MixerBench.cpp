@@ -0,0 +1,200 @@
+// MixerBench.cpp: timing of mixing many sounds.
+//
+//   Copyright (C) 2005, 2006, 2007, 2008, 2009, 2010, 2011, 2012
+//   Free Software Foundation, Inc
+//
+// This program is free software; you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation; either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program; if not, write to the Free Software
+// Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+
+// This is not a test: it times a sound_handler mixing N input streams,
+// as when many event sounds play at once, and compares mixSamples with
+// the byte-wise mixing it replaced. Build it with "make MixerBench".
+
+#ifdef HAVE_CONFIG_H
+#include "gnashconfig.h"
+#endif
+
+#include "Mixer.h"
+#include "NullSoundHandler.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdint>
+#include <cstdlib>
+#include <iostream>
+#include <vector>
+
+using namespace gnash;
+using namespace gnash::sound;
+
+namespace {
+
+typedef std::chrono::steady_clock Clock;
+
+double
+msSince(Clock::time_point start)
+{
+    return std::chrono::duration<double, std::milli>(Clock::now() - start)
+        .count();
+}
+
+/// The previous mixing: per byte pair, with the byte order checked on
+/// every call.
+void
+mixBytes(std::uint8_t* dst, const std::uint8_t* src, std::uint32_t len,
+        int volume)
+{
+    if (volume == 0) return;
+
+    union {
+        std::int16_t i;
+        char c[2];
+    } isbig;
+    isbig.i = 1;
+    const bool lsb = (isbig.c[0] == 1);
+
+    len /= 2;
+    while (len--) {
+        std::int16_t src1 = lsb ? (src[1] << 8 | src[0]) :
+            (src[0] << 8 | src[1]);
+        src1 = (src1 * volume) / 128;
+        const std::int16_t src2 = lsb ? (dst[1] << 8 | dst[0]) :
+            (dst[0] << 8 | dst[1]);
+        src += 2;
+        int sample = src1 + src2;
+        if (sample > 32767) sample = 32767;
+        else if (sample < -32768) sample = -32768;
+        dst[lsb ? 0 : 1] = sample & 0xff;
+        dst[lsb ? 1 : 0] = (sample >> 8) & 0xff;
+        dst += 2;
+    }
+}
+
+/// A stream playing a tone forever.
+struct Tone
+{
+    explicit Tone(double freq) : samples(4410) {
+        for (size_t i = 0; i < samples.size(); ++i) {
+            samples[i] = 8000 * std::sin(i * freq * 2 * M_PI / 44100);
+        }
+    }
+
+    static unsigned int fetch(void* udata, std::int16_t* to,
+            unsigned int nSamples, bool& eof)
+    {
+        Tone& t = *static_cast<Tone*>(udata);
+        for (unsigned int i = 0; i < nSamples; ) {
+            const size_t n = std::min<size_t>(nSamples - i,
+                    t.samples.size() - t.pos);
+            std::copy(&t.samples[t.pos], &t.samples[t.pos] + n, to + i);
+            t.pos = (t.pos + n) % t.samples.size();
+            i += n;
+        }
+        eof = false;
+        return nSamples;
+    }
+
+    std::vector<std::int16_t> samples;
+    size_t pos = 0;
+};
+
+/// The byte-wise mixer in a handler, for comparison.
+class ByteMixer : public NullSoundHandler
+{
+public:
+    ByteMixer() : NullSoundHandler(nullptr) {}
+
+    void mix(std::int16_t* outSamples, std::int16_t* inSamples,
+            unsigned int nSamples, float volume)
+    {
+        mixBytes(reinterpret_cast<std::uint8_t*>(outSamples),
+                reinterpret_cast<const std::uint8_t*>(inSamples),
+                nSamples * 2, static_cast<int>(128 * volume));
+    }
+};
+
+/// Fetch a number of seconds of stereo sound, in callbacks of 1024
+/// samples as the SDL handler asks for.
+double
+run(sound_handler& handler, std::vector<Tone>& tones, int seconds)
+{
+    for (Tone& t : tones) {
+        handler.attach_aux_streamer(Tone::fetch, &t);
+    }
+
+    std::vector<std::int16_t> out(1024);
+    const size_t calls = seconds * 44100 * 2 / out.size();
+
+    Clock::time_point start = Clock::now();
+    for (size_t i = 0; i < calls; ++i) {
+        handler.fetchSamples(&out[0], out.size());
+    }
+    return msSince(start);
+}
+
+}
+
+int
+main(int argc, char** argv)
+{
+    const int seconds = argc > 1 ? std::atoi(argv[1]) : 10;
+
+    std::cout << "Mixing " << seconds << " seconds of 44.1kHz stereo"
+              << std::endl;
+
+    for (size_t streams : { 1, 4, 8, 16, 32 }) {
+
+        std::vector<Tone> tones;
+        for (size_t i = 0; i < streams; ++i) {
+            tones.push_back(Tone(220 + 110 * i));
+        }
+
+        ByteMixer bytes;
+        bytes.setFinalVolume(80);
+        const double before = run(bytes, tones, seconds);
+
+        NullSoundHandler handler(nullptr);
+        handler.setFinalVolume(80);
+        const double after = run(handler, tones, seconds);
+
+        std::cout << streams << " streams: byte-wise " << before
+                  << "ms, mixSamples " << after << "ms" << std::endl;
+    }
+
+    // The kernel alone, without fetching.
+    std::vector<std::int16_t> to(1024), from(1024);
+    for (size_t i = 0; i < from.size(); ++i) from[i] = i * 37;
+    const size_t blocks = seconds * 44100 * 2 * 32 / to.size();
+
+    Clock::time_point start = Clock::now();
+    for (size_t i = 0; i < blocks; ++i) {
+        mixBytes(reinterpret_cast<std::uint8_t*>(&to[0]),
+                reinterpret_cast<const std::uint8_t*>(&from[0]),
+                to.size() * 2, 100);
+    }
+    const double before = msSince(start);
+
+    start = Clock::now();
+    for (size_t i = 0; i < blocks; ++i) {
+        mixSamples(&to[0], &from[0], to.size(), 100);
+    }
+    const double after = msSince(start);
+
+    std::cout << "Kernel, 32 streams: byte-wise " << before
+              << "ms, mixSamples " << after << "ms (" << to[7] << ")"
+              << std::endl;
+
+    return 0;
+}
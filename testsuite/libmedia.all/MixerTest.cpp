@@ -0,0 +1,133 @@
+//
+//   Copyright (C) 2005, 2006, 2007, 2008, 2009, 2010, 2011, 2012
+//   Free Software Foundation, Inc
+//
+// This program is free software; you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation; either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program; if not, write to the Free Software
+// Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+
+#ifdef HAVE_CONFIG_H
+#include "gnashconfig.h"
+#endif
+
+#include "Mixer.h"
+#include "NullSoundHandler.h"
+#include "log.h"
+
+#include <algorithm>
+#include <cstdint>
+#include <cstdlib>
+#include <vector>
+
+#include "check.h"
+
+using namespace gnash;
+using namespace gnash::sound;
+
+namespace {
+
+/// Mixing one sample at a time, as sound_handler used to.
+void
+mixReference(std::int16_t* to, const std::int16_t* from, size_t n,
+        int volume)
+{
+    for (size_t i = 0; i < n; ++i) {
+        const std::int16_t scaled = from[i] * volume / 128;
+        const int sample = to[i] + scaled;
+        to[i] = sample > 32767 ? 32767 : sample < -32768 ? -32768 : sample;
+    }
+}
+
+unsigned int
+loudStream(void*, std::int16_t* samples, unsigned int nSamples, bool& eof)
+{
+    std::fill(samples, samples + nSamples, 20000);
+    eof = false;
+    return nSamples;
+}
+
+/// Gives 10 samples and ends.
+unsigned int
+shortStream(void* udata, std::int16_t* samples, unsigned int nSamples,
+        bool& eof)
+{
+    unsigned int& left = *static_cast<unsigned int*>(udata);
+    const unsigned int n = std::min(left, nSamples);
+    std::fill(samples, samples + n, 20000);
+    left -= n;
+    eof = !left;
+    return n;
+}
+
+}
+
+TRYMAIN(_runtest);
+int
+trymain(int /*argc*/, char** /*argv*/)
+{
+    LogFile& lgf = LogFile::getDefaultInstance();
+    lgf.setVerbosity(1);
+
+    std::srand(42);
+
+    // Compare with the reference for all volumes, lengths not filling
+    // whole vectors and unaligned buffers, including the extremes.
+    bool same = true;
+    for (int volume = 0; volume <= maxMixVolume; ++volume) {
+        for (size_t n : { 0, 1, 7, 8, 9, 16, 31, 33, 1027 }) {
+            std::vector<std::int16_t> to(n + 1), from(n + 1);
+            for (size_t i = 0; i <= n; ++i) {
+                to[i] = std::rand() % 65536 - 32768;
+                from[i] = i % 5 ? std::rand() % 65536 - 32768 :
+                    i % 2 ? 32767 : -32768;
+            }
+            std::vector<std::int16_t> expected(to);
+            mixReference(&expected[1], &from[1], n, volume);
+            mixSamples(&to[1], &from[1], n, volume);
+            if (to != expected) {
+                same = false;
+            }
+        }
+    }
+    check(same);
+
+    std::int16_t to[3] = { 32000, -32000, 100 };
+    const std::int16_t from[3] = { 32000, -32000, -300 };
+    mixSamples(to, from, 3, maxMixVolume);
+    check_equals(to[0], 32767);
+    check_equals(to[1], -32768);
+    check_equals(to[2], -200);
+
+    mixSamples(to, from, 3, 0);
+    check_equals(to[2], -200);
+
+    // A handler mixes its streams, each as far as it wrote.
+    NullSoundHandler handler(nullptr);
+    unsigned int left = 10;
+    handler.attach_aux_streamer(loudStream, &handler);
+    handler.attach_aux_streamer(shortStream, &left);
+
+    std::vector<std::int16_t> out(64, 1);
+    handler.fetchSamples(&out[0], out.size());
+    check_equals(out[0], 32767);
+    check_equals(out[9], 32767);
+    check_equals(out[10], 20000);
+    check_equals(out[63], 20000);
+
+    handler.setFinalVolume(50);
+    handler.fetchSamples(&out[0], out.size());
+    check_equals(out[0], 10000);
+    check_equals(out[63], 10000);
+
+    return 0;
+}